@@ -2,13 +2,16 @@
  * Arduino I2C Slave for MKS DLC32 V2.1
  * 
  * This sketch implements an I2C slave interface to work with GRBL_ESP32 on MKS DLC32 V2.1
- * The Arduino responds to I2C requests from the ESP32 master with JSON data containing
- * the current machine mode.
+ * The Arduino responds to I2C requests from the ESP32 master with a small binary status
+ * message containing the current machine mode, and pulses a ready line when it changes.
+ * The ESP32 moves the color carousel with binary color messages. Both are defined in
+ * I2CProtocol.h, which the ESP32 firmware includes too.
  * 
  * Hardware configuration:
  * - Arduino UNO or MEGA as I2C slave at address 0x08
  * - SDA connected to ESP32 IO0
  * - SCL connected to ESP32 IO4
+ * - Pin 7 (ready, optional) connected to the ESP32 GPIO set as I2C_SLAVE_READY_PIN
  * 
  * Mode Selection:
  * - Pin 4 HIGH = Spindle mode
@@ -18,25 +21,30 @@
  */
 
 #include <Wire.h>
-#include <ArduinoJson.h>
+#include "I2CProtocol.h"
 
 // I2C slave address (must match the master's request address)
 #define I2C_SLAVE_ADDRESS 0x08
 
 // Available machine modes
-#define MODE_NONE     0  // No specific mode
-#define MODE_SPINDLE  1  // Spindle mode (CNC)
-#define MODE_LASER    2  // Laser mode
-#define MODE_DRAWING  3  // Drawing/pen plotter mode
+#define MODE_NONE     I2C_MODE_NONE
+#define MODE_SPINDLE  I2C_MODE_SPINDLE
+#define MODE_LASER    I2C_MODE_LASER
+#define MODE_DRAWING  I2C_MODE_DRAWING
 
 // Current mode - default to MODE_NONE
 uint8_t currentMode = MODE_NONE;
 
-// JSON buffer for response
-char jsonBuffer[32];
+// Status message sent to the master
+volatile i2c_status_msg_t statusMsg;
+uint8_t currentColor = I2C_COLOR_NONE;
+
+// Ready line, pulsed low when the status message changes
+const int PIN_READY = 7;
+const int READY_PULSE_US = 50;
 
 // I2C receive buffer
-char receiveBuffer[32];
+i2c_color_msg_t receiveMsg;
 volatile bool newCommandReceived = false;
 
 // Flag to indicate if mode has changed and needs to be reported
@@ -61,14 +69,14 @@ struct ColorPosition {
   int position;
 };
 
-// Color positions array (absolute positions in steps)
+// Color positions array (absolute positions in steps), indexed by I2C_COLOR_*
 ColorPosition colorPositions[] = {
   {"cyan", 0},
   {"magenta", 200},
   {"yellow", 400},
   {"black", 600}
 };
-const int NUM_COLORS = 4;
+const int NUM_COLORS = I2C_COLOR_COUNT;
 
 // Stepper movement parameters
 const int STEP_DELAY = 500;      // Microseconds between steps (500µs = 1000 steps/sec)
@@ -96,6 +104,10 @@ void setup() {
   
   // Setup status LED
   pinMode(LED_STATUS, OUTPUT);
+
+  // Setup ready line, idle high
+  pinMode(PIN_READY, OUTPUT);
+  digitalWrite(PIN_READY, HIGH);
   
   // Setup stepper pins
   pinMode(STEP_PIN, OUTPUT);
@@ -112,8 +124,8 @@ void setup() {
   delay(500);
   digitalWrite(LED_STATUS, LOW);
   
-  // Prepare initial JSON response
-  updateJsonBuffer();
+  // Prepare initial status message
+  updateStatusMsg();
   
   Serial.println("Arduino I2C Slave Ready at address 0x08");
   Serial.println("Pin 4 HIGH = Spindle mode");
@@ -127,9 +139,9 @@ void loop() {
   // Check pins for mode changes
   checkModePins();
   
-  // If mode has changed, update JSON
+  // If mode has changed, update the status message and tell the master
   if (modeChanged) {
-    updateJsonBuffer();
+    updateStatusMsg();
     modeChanged = false;
     
     // Blink status LED to indicate mode change
@@ -153,8 +165,8 @@ void loop() {
 
 // Function called when ESP32 master requests data
 void requestEvent() {
-  // Send the JSON string
-  Wire.write(jsonBuffer);
+  // Send the status message. The master reads either just the sequence number or all of it.
+  Wire.write((const uint8_t*)&statusMsg, sizeof(statusMsg));
   
   // Quick flash of LED to show I2C activity
   digitalWrite(LED_STATUS, HIGH);
@@ -163,72 +175,52 @@ void requestEvent() {
 
 // Function called when ESP32 master sends data
 void receiveEvent(int byteCount) {
-  int i = 0;
-  
-  // Clear previous buffer content
-  memset(receiveBuffer, 0, sizeof(receiveBuffer));
-  
-  // Read bytes into buffer
-  while (Wire.available() && i < sizeof(receiveBuffer) - 1) {
-    receiveBuffer[i++] = Wire.read();
+  if (newCommandReceived) {
+    // The last one is not done yet
+    while (Wire.available()) {
+      Wire.read();
+    }
+    return;
+  }
+
+  uint8_t* bytes = (uint8_t*)&receiveMsg;
+  size_t i = 0;
+  while (Wire.available() && i < sizeof(receiveMsg)) {
+    bytes[i++] = Wire.read();
   }
-  
-  // Ensure null termination
-  receiveBuffer[i] = '\0';
   
   // Read any remaining bytes to clear the buffer
   while (Wire.available()) {
     Wire.read();
   }
   
-  if (i > 0) {
+  if (i == sizeof(receiveMsg)) {
     newCommandReceived = true;
-    Serial.print("Received: ");
-    Serial.println(receiveBuffer);
   }
 }
 
-// Process the received JSON command
+// Process the received color message
 void processReceivedCommand() {
-  // Parse JSON
-  StaticJsonDocument<32> doc;
-  DeserializationError error = deserializeJson(doc, receiveBuffer);
-  
-  if (error) {
-    Serial.print("JSON parsing error: ");
-    Serial.println(error.c_str());
+  if ((receiveMsg.version != I2C_PROTOCOL_VERSION) || (receiveMsg.type != I2C_MSG_COLOR) ||
+      !i2c_crc_ok(&receiveMsg, sizeof(receiveMsg))) {
+    Serial.println("Bad color message");
     return;
   }
-  
-  // Check for color command
-  if (doc.containsKey("color")) {
-    const char* color = doc["color"];
-    if (color) {
-      Serial.print("Color command received: ");
-      Serial.println(color);
-      moveToColor(color);
-    }
+  if (receiveMsg.color >= NUM_COLORS) {
+    Serial.print("Unknown color: ");
+    Serial.println(receiveMsg.color);
+    return;
   }
+
+  Serial.print("Color command received: ");
+  Serial.println(colorPositions[receiveMsg.color].name);
+  moveToColor(receiveMsg.color);
 }
 
 // Move stepper to the position for the specified color using STEP/DIR/ENA
-void moveToColor(const char* color) {
+void moveToColor(uint8_t color) {
   // Find target position for the requested color
-  int targetPosition = -1;
-  
-  for (int i = 0; i < NUM_COLORS; i++) {
-    if (strcmp(color, colorPositions[i].name) == 0) {
-      targetPosition = colorPositions[i].position;
-      break;
-    }
-  }
-  
-  // If color not found, return
-  if (targetPosition == -1) {
-    Serial.print("Unknown color: ");
-    Serial.println(color);
-    return;
-  }
+  int targetPosition = colorPositions[color].position;
   
   // Calculate steps to move
   int stepsToMove = targetPosition - currentPosition;
@@ -274,10 +266,14 @@ void moveToColor(const char* color) {
     digitalWrite(LED_STATUS, LOW);
     
     Serial.print("Now at color position: ");
-    Serial.println(color);
+    Serial.println(colorPositions[color].name);
   } else {
     Serial.println("Already at the requested color position");
   }
+
+  // Tell the master the color is reached
+  currentColor = color;
+  updateStatusMsg();
 }
 
 // Check input pins and update mode if needed
@@ -317,14 +313,22 @@ const char* getModeString() {
   }
 }
 
-// Update the JSON buffer with current mode
-void updateJsonBuffer() {
-  // Create JSON document
-  StaticJsonDocument<32> doc;
-  
-  // Set the mode value
-  doc["mode"] = getModeString();
-  
-  // Serialize to the buffer
-  serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
-}
\ No newline at end of file
+// Update the status message with the current mode and color, and pulse the ready line
+void updateStatusMsg() {
+  i2c_status_msg_t msg;
+  msg.seq = statusMsg.seq + 1;
+  msg.version = I2C_PROTOCOL_VERSION;
+  msg.type = I2C_MSG_STATUS;
+  msg.mode = currentMode;
+  msg.color = currentColor;
+  msg.position = currentPosition;
+  msg.crc = i2c_crc8(&msg, sizeof(msg) - 1);
+
+  noInterrupts();  // requestEvent() runs from the I2C interrupt
+  memcpy((void*)&statusMsg, &msg, sizeof(msg));
+  interrupts();
+
+  digitalWrite(PIN_READY, LOW);
+  delayMicroseconds(READY_PULSE_US);
+  digitalWrite(PIN_READY, HIGH);
+}
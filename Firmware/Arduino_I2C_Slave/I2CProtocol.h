@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * I2CProtocol.h - Messages between GRBL_ESP32 on the MKS DLC32 and the Arduino I2C slave
+ *
+ * This one file is included by both sides: by Arduino_I2C_Slave.ino and, through
+ * src/mks/MKS_I2C_Slave.h, by the ESP32 firmware. Bump I2C_PROTOCOL_VERSION on any change
+ * to the layouts below; each side drops messages of another version.
+ *
+ * Status (slave to master), served on every read request:
+ *   seq       Bumped by the slave whenever anything else in the message changes. First,
+ *             so the master can poll it on its own and read the rest only on a change.
+ *   version   I2C_PROTOCOL_VERSION
+ *   type      I2C_MSG_STATUS
+ *   mode      I2C_MODE_*
+ *   color     Last color reached, I2C_COLOR_*, or I2C_COLOR_NONE
+ *   position  Carousel position in steps
+ *   crc       CRC-8 of the bytes before it
+ *
+ * Color (master to slave), written to move the carousel:
+ *   version, type (I2C_MSG_COLOR), seq (the master's own count), color, crc
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define I2C_PROTOCOL_VERSION 2
+
+#define I2C_MSG_STATUS 1
+#define I2C_MSG_COLOR  2
+
+// Machine operating modes
+#define I2C_MODE_NONE     0  // No specific mode
+#define I2C_MODE_SPINDLE  1  // Spindle mode (CNC)
+#define I2C_MODE_LASER    2  // Laser mode
+#define I2C_MODE_DRAWING  3  // Drawing/pen plotter mode
+
+// Carousel colors
+#define I2C_COLOR_CYAN     0
+#define I2C_COLOR_MAGENTA  1
+#define I2C_COLOR_YELLOW   2
+#define I2C_COLOR_BLACK    3
+#define I2C_COLOR_COUNT    4
+#define I2C_COLOR_NONE     0xFF
+
+typedef struct __attribute__((packed)) {
+    uint8_t  seq;
+    uint8_t  version;
+    uint8_t  type;
+    uint8_t  mode;
+    uint8_t  color;
+    uint16_t position;  // Little endian on both sides
+    uint8_t  crc;
+} i2c_status_msg_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t type;
+    uint8_t seq;
+    uint8_t color;
+    uint8_t crc;
+} i2c_color_msg_t;
+
+// CRC-8, polynomial 0x07
+static inline uint8_t i2c_crc8(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t        crc   = 0;
+    while (len--) {
+        crc ^= *bytes++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// True when the last byte of a message is the CRC of the rest
+static inline bool i2c_crc_ok(const void* msg, size_t len) {
+    return ((const uint8_t*)msg)[len - 1] == i2c_crc8(msg, len - 1);
+}
@@ -254,13 +254,23 @@ bool user_defined_homing(uint8_t cycle_mask) {
     return true;
 }
 
+// X and Y are mixed in step space. Each is rounded to whole steps of the motor first, so the
+// motor targets are always the image of a cartesian step position and the two motors never
+// round differently. The planner then converts them back to exactly these step counts.
 static void transform_cartesian_to_motors(float* motors, float* cartesian) {
-    motors[X_AXIS] = geometry_factor * cartesian[X_AXIS] + cartesian[Y_AXIS];
-    motors[Y_AXIS] = geometry_factor * cartesian[X_AXIS] - cartesian[Y_AXIS];
+    const float* steps_per_mm = motion_config.steps_per_mm;
+    const int    factor       = geometry_factor;
+
+    int32_t a_x    = lroundf(cartesian[X_AXIS] * steps_per_mm[X_AXIS]);
+    int32_t a_y    = lroundf(cartesian[Y_AXIS] * steps_per_mm[X_AXIS]);
+    int32_t b_x    = lroundf(cartesian[X_AXIS] * steps_per_mm[Y_AXIS]);
+    int32_t b_y    = lroundf(cartesian[Y_AXIS] * steps_per_mm[Y_AXIS]);
+    motors[X_AXIS] = (factor * a_x + a_y) / steps_per_mm[X_AXIS];
+    motors[Y_AXIS] = (factor * b_x - b_y) / steps_per_mm[Y_AXIS];
 
     auto n_axis = number_axis->get();
 
-    for (uint8_t axis = Z_AXIS; axis <= n_axis; axis++) {
+    for (uint8_t axis = Z_AXIS; axis < n_axis; axis++) {
         motors[axis] = cartesian[axis];
     }
 }
@@ -277,13 +287,11 @@ bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* positi
     dz         = target[Z_AXIS] - position[Z_AXIS];
     float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
 
-    auto n_axis = number_axis->get();
-
-    float motors[n_axis];
+    float motors[MAX_N_AXIS];
     transform_cartesian_to_motors(motors, target);
 
     if (!pl_data->motion.rapidMotion) {
-        float last_motors[n_axis];
+        float last_motors[MAX_N_AXIS];
         transform_cartesian_to_motors(last_motors, position);
         pl_data->feed_rate *= (three_axis_dist(motors, last_motors) / dist);
     }
@@ -63,12 +63,53 @@ enum class KinematicError : uint8_t {
     ANGLE_TOO_POSITIVE = 3,
 };
 
+// With a tolerance, lines are first cut into pieces of up to $Kinematics/SegmentLengthMax, and
+// each piece is split further only as much as the bend of the arm angles over it needs. The
+// tolerance is the most a segment's arm angles may stray from the straight line (radians).
+#ifndef KINEMATIC_SEGMENT_TOLERANCE
+#    define KINEMATIC_SEGMENT_TOLERANCE 0.0  // 0 cuts every line at $Kinematics/SegmentLength
+#endif
+#ifndef KINEMATIC_SEGMENT_LENGTH_MAX
+#    define KINEMATIC_SEGMENT_LENGTH_MAX 10.0
+#endif
+
+// $Delta/LookupPoints > 0 replaces the arm angle solution by trilinear interpolation in a grid
+// of precomputed angles, spanning $Delta/LookupRadius around the center and the Z range between
+// the arms all up and all down. Points outside it, or next to unreachable ones, are solved as
+// before. The grid is built at boot and again after a geometry change, and the interpolation
+// error is reported then.
+#ifndef DELTA_LOOKUP_POINTS
+#    define DELTA_LOOKUP_POINTS 0  // along Y and Z, half that along X. 0 is off
+#endif
+#ifndef DELTA_LOOKUP_RADIUS
+#    define DELTA_LOOKUP_RADIUS 100.0
+#endif
+#ifndef DELTA_LOOKUP_TOLERANCE
+#    define DELTA_LOOKUP_TOLERANCE 0.0005  // radians, cells that interpolate worse are solved exactly
+#endif
+
+// Soft limits let a target inside the envelope pass without solving the arms. The envelope is
+// a stack of cylinders around the Z axis, one per slab of the Z range between the arms all up
+// and all down, each one ring narrower than the rings found reachable at the slab's ends and
+// middle. By the symmetry of the arms, the rings are tried over the 60 degrees between two of
+// the mirror lines. Targets outside it are solved as before.
+const int DELTA_ENVELOPE_SLABS  = 32;
+const int DELTA_ENVELOPE_RINGS  = 32;  // Radial steps out to the crank and link lengths together
+const int DELTA_ENVELOPE_SPOKES = 7;   // 10 degrees apart
+
+// Segments whose inverse kinematics are computed together, before they are sent to the planner
+const int KINEMATIC_BATCH_SIZE = 8;
+
 // Create custom run time $ settings
 FloatSetting* kinematic_segment_len;
+FloatSetting* kinematic_segment_len_max;
+FloatSetting* kinematic_segment_tolerance;
 FloatSetting* delta_crank_len;
 FloatSetting* delta_link_len;
 FloatSetting* delta_crank_side_len;
 FloatSetting* delta_effector_side_len;
+IntSetting*   delta_lookup_points;
+FloatSetting* delta_lookup_radius;
 
 // trigonometric constants to speed up calculations
 const float sqrt3  = 1.732050807;
@@ -85,6 +126,30 @@ float re;  // radius of end effector side (length of linkages)
 float f;   // sized of fixed side triangel
 float e;   // size of end effector side triangle
 
+// Derived from the geometry by read_settings(), for delta_calcAngleYZ()
+static float delta_y1;       // Y of the crank axis in the arm's frame, -f/2 * tg 30
+static float delta_y_shift;  // effector joint offset from the effector center, e/2 * tg 30
+static float delta_k;        // rf^2 - re^2 - y1^2
+
+// The lookup grid, in the frame of an arm. The angle only depends on X through X^2, so the grid
+// covers X >= 0. Points that are unreachable or past the angle limits hold NAN.
+typedef struct {
+    float*   angle;  // [z][y][x]
+    uint8_t* exact;  // One bit per cell, set where the cell is solved exactly
+    int      n_x, n_y, n_z;
+    float    y_min, z_min;  // The grid starts at x = 0
+    float    inv_step;      // 1 / grid spacing, the same on all three axes
+    float    built_for[6];  // rf, re, f, e, points and radius it was built for
+} delta_lookup_t;
+static delta_lookup_t delta_lookup;
+
+typedef struct {
+    float z_min;
+    float inv_slab;                          // 0 until it is built
+    float radius_sqr[DELTA_ENVELOPE_SLABS];  // Negative for a slab with none
+} delta_envelope_t;
+static delta_envelope_t delta_envelope;
+
 static float last_angle[3]          = { 0.0, 0.0, 0.0 };  // A place to save the previous motor angles for distance/feed rate calcs
 static float last_cartesian[N_AXIS] = {
     0.0, 0.0, 0.0
@@ -93,8 +158,20 @@ static float last_cartesian[N_AXIS] = {
 // prototypes for helper functions
 KinematicError delta_calcInverse(float* cartesian, float* angles);
 KinematicError delta_calcAngleYZ(float x0, float y0, float z0, float& theta);
+KinematicError delta_calcInverseLine(const float* start, const float* step, uint32_t count, float (*angles)[3]);
 float          three_axis_dist(float* point1, float* point2);
 void           read_settings();
+static bool    delta_arm_angle(float x0, float y0, float z0, float& theta);
+static void    delta_lookup_build();
+static void    delta_envelope_build();
+
+// The machine position is cached by system_get_mpos() until the motors move
+static bool post_geometry_setting(char* value) {
+    if (!value) {
+        system_mpos_invalidate();
+    }
+    return true;
+}
 
 void machine_init() {
     float angles[N_AXIS]    = { 0.0, 0.0, 0.0 };
@@ -102,10 +179,18 @@ void machine_init() {
 
     // Custom $ settings
     kinematic_segment_len   = new FloatSetting(EXTENDED, WG, NULL, "Kinematics/SegmentLength", KINEMATIC_SEGMENT_LENGTH, 0.2, 1000.0);
-    delta_crank_len         = new FloatSetting(EXTENDED, WG, NULL, "Delta/CrankLength", RADIUS_FIXED, 50.0, 500.0);
-    delta_link_len          = new FloatSetting(EXTENDED, WG, NULL, "Delta/LinkLength", RADIUS_EFF, 50.0, 500.0);
-    delta_crank_side_len    = new FloatSetting(EXTENDED, WG, NULL, "Delta/CrankSideLength", LENGTH_FIXED_SIDE, 20.0, 500.0);
-    delta_effector_side_len = new FloatSetting(EXTENDED, WG, NULL, "Delta/EffectorSideLength", LENGTH_EFF_SIDE, 20.0, 500.0);
+    kinematic_segment_len_max =
+        new FloatSetting(EXTENDED, WG, NULL, "Kinematics/SegmentLengthMax", KINEMATIC_SEGMENT_LENGTH_MAX, 0.2, 1000.0);
+    kinematic_segment_tolerance =
+        new FloatSetting(EXTENDED, WG, NULL, "Kinematics/SegmentTolerance", KINEMATIC_SEGMENT_TOLERANCE, 0.0, 0.1);
+    delta_crank_len = new FloatSetting(EXTENDED, WG, NULL, "Delta/CrankLength", RADIUS_FIXED, 50.0, 500.0, post_geometry_setting);
+    delta_link_len  = new FloatSetting(EXTENDED, WG, NULL, "Delta/LinkLength", RADIUS_EFF, 50.0, 500.0, post_geometry_setting);
+    delta_crank_side_len =
+        new FloatSetting(EXTENDED, WG, NULL, "Delta/CrankSideLength", LENGTH_FIXED_SIDE, 20.0, 500.0, post_geometry_setting);
+    delta_effector_side_len =
+        new FloatSetting(EXTENDED, WG, NULL, "Delta/EffectorSideLength", LENGTH_EFF_SIDE, 20.0, 500.0, post_geometry_setting);
+    delta_lookup_points     = new IntSetting(EXTENDED, WG, NULL, "Delta/LookupPoints", DELTA_LOOKUP_POINTS, 0, 64);
+    delta_lookup_radius     = new FloatSetting(EXTENDED, WG, NULL, "Delta/LookupRadius", DELTA_LOOKUP_RADIUS, 1.0, 500.0);
 
     // Calculate the Z offset at the arm zero angles ...
     // Z offset is the z distance from the motor axes to the end effector axes at zero angle
@@ -136,9 +221,7 @@ bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* positi
     float dx, dy, dz;  // distances in each cartesian axis
     float motor_angles[3];
 
-    float seg_target[3];                    // The target of the current segment
-    float feed_rate  = pl_data->feed_rate;  // save original feed rate
-    bool  show_error = true;                // shows error once
+    float feed_rate = pl_data->feed_rate;  // save original feed rate
 
     KinematicError status;
 
@@ -170,50 +253,93 @@ bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* positi
     dz         = target[Z_AXIS] - position[Z_AXIS];
     float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
 
-    // determine the number of segments we need	... round up so there is at least 1 (except when dist is 0)
-    uint32_t segment_count = ceil(dist / kinematic_segment_len->get());
-
-    float segment_dist = dist / ((float)segment_count);  // distance of each segment...will be used for feedrate conversion
-
-    for (uint32_t segment = 1; segment <= segment_count; segment++) {
-        // determine this segment's target
-        seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment);
-        seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-        seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment);
-
-        // calculate the delta motor angles
-        KinematicError status = delta_calcInverse(seg_target, motor_angles);
-
-        if (status != KinematicError ::NONE) {
-            if (show_error) {
-                // grbl_msg_sendf(CLIENT_SERIAL,
-                //                MsgLevel::Info,
-                //                "Error:%d, Angs X:%4.3f Y:%4.3f Z:%4.3f",
-                //                status,
-                //                motor_angles[0],
-                //                motor_angles[1],
-                //                motor_angles[2]);
-                show_error = false;
+    if (dist == 0) {
+        return true;
+    }
+
+    // Without a tolerance the whole line is one piece, cut into segments of $Kinematics/SegmentLength
+    float    segment_len = kinematic_segment_len->get();
+    float    tolerance   = kinematic_segment_tolerance->get();
+    uint32_t piece_count = ceil(dist / (tolerance > 0 ? kinematic_segment_len_max->get() : dist));
+    float    piece_step[3];
+    piece_step[X_AXIS] = dx / piece_count;
+    piece_step[Y_AXIS] = dy / piece_count;
+    piece_step[Z_AXIS] = dz / piece_count;
+    float piece_dist   = dist / piece_count;
+    float piece_start[3];
+    memcpy(piece_start, position, sizeof(piece_start));
+
+    for (uint32_t piece = 0; piece < piece_count; piece++) {
+        uint32_t segment_count = ceil(piece_dist / segment_len);  // The most the piece is cut into
+        float    piece_end_angles[3];
+        if (tolerance > 0) {
+            // The arm angles at the middle and the end of the piece. Their departure from the
+            // straight line falls with the square of the number of segments.
+            float half_step[3] = { piece_step[X_AXIS] / 2, piece_step[Y_AXIS] / 2, piece_step[Z_AXIS] / 2 };
+            float probe[2][3];
+            if (delta_calcInverseLine(piece_start, half_step, 2, probe) != KinematicError::NONE) {
+                return false;
             }
-            return false;
-        }
-        if (pl_data->motion.rapidMotion) {
-            pl_data->feed_rate = feed_rate;
-        } else {
-            float delta_distance = three_axis_dist(motor_angles, last_angle);
-            pl_data->feed_rate   = (feed_rate * delta_distance / segment_dist);
+            float deviation = 0;
+            for (int arm = 0; arm < 3; arm++) {
+                deviation = MAX(deviation, fabsf(probe[0][arm] - (last_angle[arm] + probe[1][arm]) / 2));
+            }
+            segment_count = MIN(segment_count, (uint32_t)ceilf(sqrtf(deviation / tolerance)));
+            segment_count = MAX(segment_count, 1);
+            memcpy(piece_end_angles, probe[1], sizeof(piece_end_angles));
         }
 
-        // mc_line() returns false if a jog is cancelled.
-        // In that case we stop sending segments to the planner.
-        if (!mc_line(motor_angles, pl_data)) {
-            return false;
+        float segment_step[3];
+        segment_step[X_AXIS] = piece_step[X_AXIS] / segment_count;
+        segment_step[Y_AXIS] = piece_step[Y_AXIS] / segment_count;
+        segment_step[Z_AXIS] = piece_step[Z_AXIS] / segment_count;
+        float segment_dist   = piece_dist / segment_count;  // distance of each segment...will be used for feedrate conversion
+
+        for (uint32_t segment = 0; segment < segment_count;) {
+            // calculate the delta motor angles for the next batch of segments
+            uint32_t batch_count = MIN(segment_count - segment, (uint32_t)KINEMATIC_BATCH_SIZE);
+            float    batch_angles[KINEMATIC_BATCH_SIZE][3];
+            float    batch_start[3];
+            batch_start[X_AXIS] = piece_start[X_AXIS] + segment_step[X_AXIS] * segment;
+            batch_start[Y_AXIS] = piece_start[Y_AXIS] + segment_step[Y_AXIS] * segment;
+            batch_start[Z_AXIS] = piece_start[Z_AXIS] + segment_step[Z_AXIS] * segment;
+            bool have_end       = tolerance > 0 && segment + batch_count == segment_count;  // Already probed
+            if (batch_count > (have_end ? 1 : 0)) {
+                status = delta_calcInverseLine(batch_start, segment_step, batch_count - (have_end ? 1 : 0), batch_angles);
+                if (status != KinematicError::NONE) {
+                    return false;
+                }
+            }
+            if (have_end) {
+                memcpy(batch_angles[batch_count - 1], piece_end_angles, sizeof(piece_end_angles));
+            }
+
+            for (uint32_t i = 0; i < batch_count; i++) {
+                float* motor_angles = batch_angles[i];
+                if (pl_data->motion.rapidMotion) {
+                    pl_data->feed_rate = feed_rate;
+                } else {
+                    float delta_distance = three_axis_dist(motor_angles, last_angle);
+                    pl_data->feed_rate   = (feed_rate * delta_distance / segment_dist);
+                }
+
+                // mc_line() returns false if a jog is cancelled.
+                // In that case we stop sending segments to the planner.
+                if (!mc_line(motor_angles, pl_data)) {
+                    return false;
+                }
+
+                // save angles for next distance calc
+                // This is after mc_line() so that we do not update
+                // last_angle if the segment was discarded.
+                memcpy(last_angle, motor_angles, sizeof(last_angle));
+            }
+            segment += batch_count;
         }
 
-        // save angles for next distance calc
-        // This is after mc_line() so that we do not update
-        // last_angle if the segment was discarded.
-        memcpy(last_angle, motor_angles, sizeof(motor_angles));
+        piece_start[X_AXIS] = position[X_AXIS] + piece_step[X_AXIS] * (piece + 1);
+        piece_start[Y_AXIS] = position[Y_AXIS] + piece_step[Y_AXIS] * (piece + 1);
+        piece_start[Z_AXIS] = position[Z_AXIS] + piece_step[Z_AXIS] * (piece + 1);
     }
     return true;
 }
@@ -224,7 +350,12 @@ bool limitsCheckTravel(float* target) {
 
     read_settings();
 
-    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Kin Soft Check %3.3f, %3.3f, %3.3f", target[0], target[1], target[2]);
+    const delta_envelope_t& env  = delta_envelope;
+    float                   slab = (target[Z_AXIS] - env.z_min) * env.inv_slab;
+    if (env.inv_slab > 0 && slab >= 0 && slab < DELTA_ENVELOPE_SLABS &&
+        target[X_AXIS] * target[X_AXIS] + target[Y_AXIS] * target[Y_AXIS] <= env.radius_sqr[(int)slab]) {
+        return false;
+    }
 
     switch (delta_calcInverse(target, motor_angles)) {
         case KinematicError::OUT_OF_RANGE:
@@ -274,6 +405,37 @@ KinematicError delta_calcInverse(float* cartesian, float* angles) {
     return status;
 }
 
+// inverse kinematics of count points along a line, start + i * step for i = 1..count, into
+// angles[i - 1]. The rotations into the frames of the other two arms are linear, so they are
+// applied to the start and the step once instead of to every point.
+KinematicError delta_calcInverseLine(const float* start, const float* step, uint32_t count, float (*angles)[3]) {
+    float frame_start[3][2], frame_step[3][2];  // X and Y in the frame of each arm
+    frame_start[0][0] = start[X_AXIS];
+    frame_start[0][1] = start[Y_AXIS];
+    frame_step[0][0]  = step[X_AXIS];
+    frame_step[0][1]  = step[Y_AXIS];
+    for (int arm = 1; arm < 3; arm++) {
+        float s             = arm == 1 ? sin120 : -sin120;  // rotate coords to +120 deg, then -120 deg
+        frame_start[arm][0] = start[X_AXIS] * cos120 + start[Y_AXIS] * s;
+        frame_start[arm][1] = start[Y_AXIS] * cos120 - start[X_AXIS] * s;
+        frame_step[arm][0]  = step[X_AXIS] * cos120 + step[Y_AXIS] * s;
+        frame_step[arm][1]  = step[Y_AXIS] * cos120 - step[X_AXIS] * s;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        float n = i + 1;
+        float z = start[Z_AXIS] + step[Z_AXIS] * n;
+        for (int arm = 0; arm < 3; arm++) {
+            KinematicError status = delta_calcAngleYZ(
+                frame_start[arm][0] + frame_step[arm][0] * n, frame_start[arm][1] + frame_step[arm][1] * n, z, angles[i][arm]);
+            if (status != KinematicError ::NONE) {
+                return status;
+            }
+        }
+    }
+    return KinematicError::NONE;
+}
+
 // inverse kinematics: angles -> cartesian
 void motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
     read_settings();
@@ -322,31 +484,242 @@ void motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
     cartesian[Y_AXIS] = (a2 * cartesian[Z_AXIS] + b2) / dnm;
 }
 
+// Arm angle from the lookup grid. Returns false when the point is not covered by it.
+static bool delta_lookup_angle(float x0, float y0, float z0, float& theta) {
+    const delta_lookup_t& lu = delta_lookup;
+    if (lu.angle == NULL) {
+        return false;
+    }
+    float gx = fabsf(x0) * lu.inv_step;
+    float gy = (y0 - lu.y_min) * lu.inv_step;
+    float gz = (z0 - lu.z_min) * lu.inv_step;
+    if (!(gx <= lu.n_x - 1 && gy >= 0 && gy <= lu.n_y - 1 && gz >= 0 && gz <= lu.n_z - 1)) {
+        return false;
+    }
+    int ix = MIN((int)gx, lu.n_x - 2);
+    int iy = MIN((int)gy, lu.n_y - 2);
+    int iz = MIN((int)gz, lu.n_z - 2);
+    int cell = (iz * (lu.n_y - 1) + iy) * (lu.n_x - 1) + ix;
+    if (lu.exact[cell / 8] & bit(cell % 8)) {
+        return false;
+    }
+    gx -= ix;
+    gy -= iy;
+    gz -= iz;
+
+    const float* c = &lu.angle[(iz * lu.n_y + iy) * lu.n_x + ix];
+    int          row = lu.n_x, plane = lu.n_x * lu.n_y;
+    float        c00 = c[0] + gx * (c[1] - c[0]);
+    float        c10 = c[row] + gx * (c[row + 1] - c[row]);
+    float        c01 = c[plane] + gx * (c[plane + 1] - c[plane]);
+    float        c11 = c[plane + row] + gx * (c[plane + row + 1] - c[plane + row]);
+    float        c0  = c00 + gy * (c10 - c00);
+    float        c1  = c01 + gy * (c11 - c01);
+    theta            = c0 + gz * (c1 - c0);
+    return true;
+}
+
 // helper functions, calculates angle theta1 (for YZ-pane)
 KinematicError delta_calcAngleYZ(float x0, float y0, float z0, float& theta) {
-    float y1 = -0.5 * 0.57735 * f;  // f/2 * tg 30
-    y0 -= 0.5 * 0.57735 * e;        // shift center to edge
+    if (!delta_lookup_angle(x0, y0, z0, theta) && !delta_arm_angle(x0, y0, z0, theta)) {
+        return KinematicError::OUT_OF_RANGE;  // non-existing point
+    }
+
+    if (theta < (float)MAX_NEGATIVE_ANGLE) {
+        return KinematicError::ANGLE_TOO_NEGATIVE;
+    }
+
+    if (theta > (float)MAX_POSITIVE_ANGLE) {
+        return KinematicError::ANGLE_TOO_POSITIVE;
+    }
+
+    return KinematicError::NONE;
+}
+
+// The arm angle solved exactly, before the angle limits are applied. Returns false for a point
+// the arm cannot reach. Single precision throughout, as the ESP32 has no double precision FPU.
+static bool delta_arm_angle(float x0, float y0, float z0, float& theta) {
+    float y1 = delta_y1;  // f/2 * tg 30
+    y0 -= delta_y_shift;  // shift center to edge
     // z = a + b*y
-    float a = (x0 * x0 + y0 * y0 + z0 * z0 + rf * rf - re * re - y1 * y1) / (2 * z0);
+    float a = (x0 * x0 + y0 * y0 + z0 * z0 + delta_k) / (2 * z0);
     float b = (y1 - y0) / z0;
     // discriminant
     float d = -(a + b * y1) * (a + b * y1) + rf * (b * b * rf + rf);
     if (d < 0)
-        return KinematicError::OUT_OF_RANGE;          // non-existing point
-    float yj = (y1 - a * b - sqrt(d)) / (b * b + 1);  // choosing outer point
+        return false;                                  // non-existing point
+    float yj = (y1 - a * b - sqrtf(d)) / (b * b + 1);  // choosing outer point
     float zj = a + b * yj;
     //theta    = 180.0 * atan(-zj / (y1 - yj)) / M_PI + ((yj > y1) ? 180.0 : 0.0);
-    theta = atan(-zj / (y1 - yj)) + ((yj > y1) ? M_PI : 0.0);
+    theta = atanf(-zj / (y1 - yj)) + ((yj > y1) ? (float)M_PI : 0.0f);
+    return true;
+}
 
-    if (theta < MAX_NEGATIVE_ANGLE) {
-        return KinematicError::ANGLE_TOO_NEGATIVE;
+// All three arms solved exactly, within the angle limits
+static bool delta_reachable(float x, float y, float z) {
+    float frame[3][2] = {
+        { x, y },
+        { x * cos120 + y * sin120, y * cos120 - x * sin120 },  // rotate coords to +120 deg
+        { x * cos120 - y * sin120, y * cos120 + x * sin120 },  // rotate coords to -120 deg
+    };
+    for (int arm = 0; arm < 3; arm++) {
+        float theta;
+        if (!delta_arm_angle(frame[arm][0], frame[arm][1], z, theta) || theta < (float)MAX_NEGATIVE_ANGLE ||
+            theta > (float)MAX_POSITIVE_ANGLE) {
+            return false;
+        }
     }
+    return true;
+}
 
-    if (theta > MAX_POSITIVE_ANGLE) {
-        return KinematicError::ANGLE_TOO_POSITIVE;
+// Finds the radius of each slab of the envelope, from the center out to the first ring with a
+// point that cannot be reached
+static void delta_envelope_build() {
+    delta_envelope_t& env = delta_envelope;
+    env.inv_slab          = 0;
+
+    float up[3]   = { (float)MAX_NEGATIVE_ANGLE, (float)MAX_NEGATIVE_ANGLE, (float)MAX_NEGATIVE_ANGLE };
+    float down[3] = { (float)MAX_POSITIVE_ANGLE, (float)MAX_POSITIVE_ANGLE, (float)MAX_POSITIVE_ANGLE };
+    float z_up[N_AXIS], z_down[N_AXIS];
+    motors_to_cartesian(z_up, up, 3);
+    motors_to_cartesian(z_down, down, 3);
+    float z_min = MIN(z_up[Z_AXIS], z_down[Z_AXIS]);
+    float z_max = MAX(z_up[Z_AXIS], z_down[Z_AXIS]);
+    if (!(z_max > z_min)) {
+        return;
     }
 
-    return KinematicError::NONE;
+    float slab = (z_max - z_min) / DELTA_ENVELOPE_SLABS;
+    float ring = (rf + re) / DELTA_ENVELOPE_RINGS;
+    float spoke[DELTA_ENVELOPE_SPOKES][2];
+    for (int i = 0; i < DELTA_ENVELOPE_SPOKES; i++) {
+        float a     = (30 + 60.0f * i / (DELTA_ENVELOPE_SPOKES - 1)) * dtr;
+        spoke[i][0] = cosf(a);
+        spoke[i][1] = sinf(a);
+    }
+    float r_min = INFINITY, r_max = 0;
+    for (int s = 0; s < DELTA_ENVELOPE_SLABS; s++) {
+        int n = 0;  // Rings reachable all around
+        for (; n <= DELTA_ENVELOPE_RINGS; n++) {
+            bool reachable = true;
+            for (int i = 0; reachable && i < DELTA_ENVELOPE_SPOKES; i++) {
+                for (int k = 0; reachable && k < 3; k++) {
+                    reachable = delta_reachable(n * ring * spoke[i][0], n * ring * spoke[i][1], z_min + (s + k * 0.5f) * slab);
+                }
+            }
+            if (!reachable) {
+                break;
+            }
+        }
+        float r              = (n - 2) * ring;  // The last one reachable, less one ring
+        env.radius_sqr[s]    = r < 0 ? -1 : r * r;
+        r_min                = MIN(r_min, MAX(r, 0.0f));
+        r_max                = MAX(r_max, r);
+    }
+    env.z_min    = z_min;
+    env.inv_slab = 1 / slab;
+    grbl_msg_sendf(
+        CLIENT_SERIAL, MsgLevel::Info, "Delta soft limit envelope Z %4.3f to %4.3f, radius %4.3f to %4.3f", z_min, z_max, r_min, r_max);
+}
+
+// Fills the lookup grid from the current geometry. Then compares the interpolation against the
+// exact solution at the center of each cell, where it is at its worst, and leaves the cells that
+// miss DELTA_LOOKUP_TOLERANCE or touch an unusable point to be solved exactly.
+static void delta_lookup_build() {
+    delta_lookup_t& lu = delta_lookup;
+    free(lu.angle);
+    free(lu.exact);
+    lu.angle = NULL;
+    lu.exact = NULL;
+
+    int   points = delta_lookup_points->get();
+    float radius = delta_lookup_radius->get();
+    if (points < 2) {
+        return;
+    }
+
+    // The Z range of the effector, from the arms all up to all down
+    float up[3]   = { (float)MAX_NEGATIVE_ANGLE, (float)MAX_NEGATIVE_ANGLE, (float)MAX_NEGATIVE_ANGLE };
+    float down[3] = { (float)MAX_POSITIVE_ANGLE, (float)MAX_POSITIVE_ANGLE, (float)MAX_POSITIVE_ANGLE };
+    float z_up[N_AXIS], z_down[N_AXIS];
+    motors_to_cartesian(z_up, up, 3);
+    motors_to_cartesian(z_down, down, 3);
+    float z_min = MIN(z_up[Z_AXIS], z_down[Z_AXIS]);
+    float z_max = MAX(z_up[Z_AXIS], z_down[Z_AXIS]);
+
+    float step  = 2 * radius / (points - 1);
+    lu.n_x      = points / 2 + 1;
+    lu.n_y      = points;
+    lu.n_z      = MAX(2, (int)ceilf((z_max - z_min) / step) + 1);
+    lu.y_min    = -radius;
+    lu.z_min    = z_min;
+    lu.inv_step = 1 / step;
+
+    int      n_cell     = (lu.n_x - 1) * (lu.n_y - 1) * (lu.n_z - 1);
+    int      angle_size = sizeof(float) * lu.n_x * lu.n_y * lu.n_z;
+    int      size       = angle_size + (n_cell + 7) / 8;
+    float*   angle      = (float*)heap_caps_malloc(angle_size, MALLOC_CAP_SPIRAM);  // In PSRAM when there is some
+    uint8_t* exact      = (uint8_t*)calloc((n_cell + 7) / 8, 1);
+    if (angle == NULL) {
+        angle = (float*)malloc(angle_size);
+    }
+    if (angle == NULL || exact == NULL) {
+        free(angle);
+        free(exact);
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Delta IK lookup needs %d bytes, not available", size);
+        return;
+    }
+
+    int i = 0;
+    for (int iz = 0; iz < lu.n_z; iz++) {
+        for (int iy = 0; iy < lu.n_y; iy++) {
+            for (int ix = 0; ix < lu.n_x; ix++) {
+                // Points past the angle limits are not interpolated either, as the solution
+                // bends sharply where the arm runs out of reach
+                float& a = angle[i++];
+                if (!delta_arm_angle(ix * step, lu.y_min + iy * step, lu.z_min + iz * step, a) || a < (float)MAX_NEGATIVE_ANGLE ||
+                    a > (float)MAX_POSITIVE_ANGLE) {
+                    a = NAN;
+                }
+            }
+        }
+    }
+    lu.angle = angle;
+    lu.exact = exact;
+
+    float max_error = 0, total_error = 0;
+    int   cell = 0, interpolated_cells = 0;
+    for (int iz = 0; iz < lu.n_z - 1; iz++) {
+        for (int iy = 0; iy < lu.n_y - 1; iy++) {
+            for (int ix = 0; ix < lu.n_x - 1; ix++, cell++) {
+                float x = (ix + 0.5f) * step, y = lu.y_min + (iy + 0.5f) * step, z = lu.z_min + (iz + 0.5f) * step;
+                float exact_angle, interpolated;
+                float error = NAN;
+                if (delta_lookup_angle(x, y, z, interpolated) && delta_arm_angle(x, y, z, exact_angle)) {
+                    error = fabsf(interpolated - exact_angle);
+                }
+                if (!(error <= DELTA_LOOKUP_TOLERANCE)) {  // Also catches NAN corners
+                    exact[cell / 8] |= bit(cell % 8);
+                    continue;
+                }
+                max_error = MAX(max_error, error);
+                total_error += error;
+                interpolated_cells++;
+            }
+        }
+    }
+    grbl_msg_sendf(CLIENT_SERIAL,
+                   MsgLevel::Info,
+                   "Delta IK lookup %dx%dx%d, %d bytes, Z %4.3f to %4.3f, %d%% of cells, error max %.6f mean %.6f rad",
+                   lu.n_x,
+                   lu.n_y,
+                   lu.n_z,
+                   size,
+                   lu.z_min,
+                   lu.z_min + (lu.n_z - 1) * step,
+                   n_cell ? interpolated_cells * 100 / n_cell : 0,
+                   max_error,
+                   interpolated_cells ? total_error / interpolated_cells : 0.0f);
 }
 
 // Determine the unit distance between (2) 3D points
@@ -405,4 +778,17 @@ void read_settings() {
     re = delta_link_len->get();           // radius of end effector side (length of linkages)
     f  = delta_crank_side_len->get();     // sized of fixed side triangel
     e  = delta_effector_side_len->get();  // size of end effector side triangle
+
+    delta_y1      = -0.5f * 0.57735f * f;
+    delta_y_shift = 0.5f * 0.57735f * e;
+    delta_k       = rf * rf - re * re - delta_y1 * delta_y1;
+
+    // Rebuild the lookup grid and the envelope when they are out of date. built_for is updated first, as the build
+    // itself reads the settings through motors_to_cartesian().
+    float built_for[6] = { rf, re, f, e, (float)delta_lookup_points->get(), delta_lookup_radius->get() };
+    if (memcmp(built_for, delta_lookup.built_for, sizeof(built_for)) != 0) {
+        memcpy(delta_lookup.built_for, built_for, sizeof(built_for));
+        delta_lookup_build();
+        delta_envelope_build();
+    }
 }
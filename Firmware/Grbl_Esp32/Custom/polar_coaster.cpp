@@ -103,26 +103,32 @@ bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* positi
     dz = target[Z_AXIS] - position[Z_AXIS];
     // calculate the total X,Y axis move distance
     // Z axis is the same in both coord systems, so it is ignored
-    dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+    dist = sqrtf((dx * dx) + (dy * dy) + (dz * dz));
     if (pl_data->motion.rapidMotion) {
         segment_count = 1;  // rapid G0 motion is not used to draw, so skip the segmentation
     } else {
         segment_count = ceil(dist / SEGMENT_LENGTH);  // determine the number of segments we need	... round up so there is at least 1
     }
     dist /= segment_count;  // segment distance
+    // per segment steps, and the start with the offsets removed, so each target is a multiply-add
+    float seg_dx  = dx / segment_count;
+    float seg_dy  = dy / segment_count;
+    float seg_dz  = dz / segment_count;
+    float start_x = position[X_AXIS] - x_offset;
+    float start_z = position[Z_AXIS] - z_offset;
     for (uint32_t segment = 1; segment <= segment_count; segment++) {
         // determine this segment's target
-        seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment) - x_offset;
-        seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-        seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment) - z_offset;
+        seg_target[X_AXIS] = start_x + seg_dx * segment;
+        seg_target[Y_AXIS] = position[Y_AXIS] + seg_dy * segment;
+        seg_target[Z_AXIS] = start_z + seg_dz * segment;
         calc_polar(seg_target, polar, last_angle);
         // begin determining new feed rate
         // calculate move distance for each axis
         p_dx                      = polar[RADIUS_AXIS] - last_radius;
         p_dy                      = polar[POLAR_AXIS] - last_angle;
         p_dz                      = dz;
-        polar_dist                = sqrt((p_dx * p_dx) + (p_dy * p_dy) + (p_dz * p_dz));  // calculate the total move distance
-        float polar_rate_multiply = 1.0;                                                  // fail safe rate
+        polar_dist                = sqrtf((p_dx * p_dx) + (p_dy * p_dy) + (p_dz * p_dz));  // calculate the total move distance
+        float polar_rate_multiply = 1.0;                                                   // fail safe rate
         if (polar_dist == 0 || dist == 0) {
             // prevent 0 feed rate and division by 0
             polar_rate_multiply = 1.0;  // default to same feed rate
@@ -186,6 +192,9 @@ void motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
 *   This means the angle could accumulate to very high positive or negative values over the coarse of
 *   a long job.
 *
+*   Single precision throughout, as the ESP32 has no double precision FPU and this runs for
+*   every segment.
+*
 */
 void calc_polar(float* target_xyz, float* polar, float last_angle) {
     float delta_ang;  // the difference from the last and next angle
@@ -193,29 +202,29 @@ void calc_polar(float* target_xyz, float* polar, float last_angle) {
     if (polar[RADIUS_AXIS] == 0) {
         polar[POLAR_AXIS] = last_angle;  // don't care about angle at center
     } else {
-        polar[POLAR_AXIS] = atan2(target_xyz[Y_AXIS], target_xyz[X_AXIS]) * 180.0 / M_PI;
+        polar[POLAR_AXIS] = atan2f(target_xyz[Y_AXIS], target_xyz[X_AXIS]) * (180.0f / (float)M_PI);
         // no negative angles...we want the absolute angle not -90, use 270
         polar[POLAR_AXIS] = abs_angle(polar[POLAR_AXIS]);
     }
     polar[Z_AXIS] = target_xyz[Z_AXIS];  // Z is unchanged
     delta_ang     = polar[POLAR_AXIS] - abs_angle(last_angle);
     // if the delta is above 180 degrees it means we are crossing the 0 degree line
-    if (fabs(delta_ang) <= 180.0)
+    if (fabsf(delta_ang) <= 180.0f)
         polar[POLAR_AXIS] = last_angle + delta_ang;
     else {
-        if (delta_ang > 0.0) {
+        if (delta_ang > 0.0f) {
             // crossing zero counter clockwise
-            polar[POLAR_AXIS] = last_angle - (360.0 - delta_ang);
+            polar[POLAR_AXIS] = last_angle - (360.0f - delta_ang);
         } else
-            polar[POLAR_AXIS] = last_angle + delta_ang + 360.0;
+            polar[POLAR_AXIS] = last_angle + delta_ang + 360.0f;
     }
 }
 
 // Return a 0-360 angle ... fix above 360 and below zero
 float abs_angle(float ang) {
-    ang = fmod(ang, 360.0);  // 0-360 or 0 to -360
-    if (ang < 0.0)
-        ang = 360.0 + ang;
+    ang = fmodf(ang, 360.0f);  // 0-360 or 0 to -360
+    if (ang < 0.0f)
+        ang = 360.0f + ang;
     return ang;
 }
 
@@ -0,0 +1,61 @@
+/*
+  Boot.cpp - Startup phases and their timing, for $SS
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+#include <esp_timer.h>
+
+static const char* boot_phase_names[] = {
+    "Grbl", "I2SOut", "Client", "Display", "Settings", "Planner", "Stepper", "Motors", "UI", "Logo", "SdCard", "WiFi",
+};
+
+// From esp_timer_get_time(), which counts from reset. An end of 0 means not done yet.
+static volatile int64_t boot_start_us[int(BootPhase::Count)];
+static volatile int64_t boot_end_us[int(BootPhase::Count)];
+
+void boot_phase_begin(BootPhase phase) {
+    boot_start_us[int(phase)] = esp_timer_get_time();
+}
+
+void boot_phase_end(BootPhase phase) {
+    boot_end_us[int(phase)] = esp_timer_get_time();
+}
+
+bool boot_phase_done(BootPhase phase) {
+    return boot_end_us[int(phase)] != 0;
+}
+
+bool boot_is_ready() {
+    return boot_phase_done(BootPhase::Grbl) && boot_phase_done(BootPhase::SdCard);
+}
+
+void boot_report(uint8_t client) {
+    for (int i = 0; i < int(BootPhase::Count); i++) {
+        if (boot_start_us[i] == 0) {
+            continue;  // Not run, WiFi after an update file was found for example
+        }
+        if (boot_end_us[i] == 0) {
+            grbl_sendf(client, "%-8s at %7.1f ms, running\r\n", boot_phase_names[i], boot_start_us[i] / 1000.0);
+        } else {
+            grbl_sendf(client,
+                       "%-8s at %7.1f ms, took %7.1f ms\r\n",
+                       boot_phase_names[i],
+                       boot_start_us[i] / 1000.0,
+                       (boot_end_us[i] - boot_start_us[i]) / 1000.0);
+        }
+    }
+}
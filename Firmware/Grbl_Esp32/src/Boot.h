@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+  Boot.h - Startup phases and their timing, for $SS
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// Startup runs on three tasks. grbl_init() brings up the motion side on the loop task. Then the
+// display task draws the logo while the boot task, on core 0 with the radio, checks the SD card
+// for a configuration update and associates with the WiFi network, and the loop task goes on
+// into the protocol loop. The logo is taken down once the motion side is up and the SD card has
+// been checked, since the page that follows depends on what was found there.
+//
+//   Grbl      grbl_init() as a whole, the phases up to Motors fall in it
+//   UI        LVGL and the logo, then Logo until the first page is drawn
+//   SdCard    The configuration update check, then WiFi
+enum class BootPhase : uint8_t {
+    Grbl = 0,
+    I2SOut,
+    Client,
+    Display,
+    Settings,
+    Planner,
+    Stepper,
+    Motors,
+    UI,
+    Logo,
+    SdCard,
+    WiFi,
+    Count,
+};
+
+#ifndef BOOT_TASK_CORE
+#    define BOOT_TASK_CORE 0  // With the WiFi stack, off the motion core
+#endif
+
+void boot_phase_begin(BootPhase phase);
+void boot_phase_end(BootPhase phase);
+bool boot_phase_done(BootPhase phase);
+
+// The motion side is up and the SD card has been checked
+bool boot_is_ready();
+
+// Prints the start and duration of each phase, in ms since reset
+void boot_report(uint8_t client);
@@ -47,7 +47,56 @@ Some features should not be changed. See notes below.
 // that the machine file might choose to undefine.
 
 // Note: HOMING_CYCLES are now settings
-#define SUPPORT_TASK_CORE 1  // Reference: CONFIG_ARDUINO_RUNNING_CORE = 1
+
+// Task layout. The WiFi, lwIP and Bluetooth stacks run on core 0. The Arduino loop task, which
+// runs the protocol loop, runs on core 1 (CONFIG_ARDUINO_RUNNING_CORE), as does the stepper
+// prep task (STEPPER_PREP_TASK_CORE).
+//
+//   Task             Production  Legacy
+//   clientCheckTask  0           1       Web server, websockets, telnet, client input
+//   clientSendTask   0           1       Client output
+//   lvglTask         0           1       Display and touch
+//   sdReaderTask     0           0       SD card read-ahead
+//   workerTask       0           0       File previews and framing scans, see Worker.h
+//   bootTask         0           0       SD card update check and WiFi, once at startup
+//   stepperPrepTask  1           1       Segment generator
+//   loopTask         1           1       Protocol loop, G-code parser, planner
+//
+// A machine file can place the display task by defining DISPLAY_TASK_CORE itself. $UI/HeadlessJob cuts the display work further during jobs.
+//
+// The production layout keeps the network and display work on core 0, so a browser loading the
+// WebUI during a job does not take time from the motion tasks. Comment this out for the legacy
+// layout, which keeps everything but the radio stacks on core 1.
+#define TASK_PROFILE_PRODUCTION
+
+#ifdef TASK_PROFILE_PRODUCTION
+#    define CLIENT_TASK_CORE 0
+#    define UI_TASK_CORE 0
+#else
+#    define CLIENT_TASK_CORE 1
+#    define UI_TASK_CORE 1
+#endif
+#define SUPPORT_TASK_CORE 1  // Motor driver and spindle support tasks
+#ifndef WORKER_TASK_CORE
+#    define WORKER_TASK_CORE 0  // In both layouts, away from the motion tasks
+#endif
+
+// The step timer and I2S interrupts are allocated on STEPPER_ISR_CORE, and above level 1, where
+// the WiFi and Bluetooth interrupts are, so the radios do not delay the steps.
+#ifndef STEPPER_ISR_CORE
+#    define STEPPER_ISR_CORE 1
+#endif
+#ifndef STEPPER_ISR_LEVEL
+#    define STEPPER_ISR_LEVEL 3  // 1 to 3, the highest a handler in C can have
+#endif
+// Each handler and everything it calls is in IRAM. With this, the interrupts also keep running
+// while the flash is written, as when a setting is saved, instead of waiting for it to finish.
+// #define STEPPER_ISR_IRAM
+#ifdef STEPPER_ISR_IRAM
+#    define STEPPER_ISR_FLAGS ((ESP_INTR_FLAG_LEVEL1 << (STEPPER_ISR_LEVEL - 1)) | ESP_INTR_FLAG_IRAM)
+#else
+#    define STEPPER_ISR_FLAGS (ESP_INTR_FLAG_LEVEL1 << (STEPPER_ISR_LEVEL - 1))
+#endif
 #define SUPPORT_LVGL_CORE 0  // Reference: CONFIG_ARDUINO_RUNNING_CORE = 0
 // Inverts pin logic of the control command pins based on a mask. This essentially means you can use
 // normally-closed switches on the specified pins, rather than the default normally-open switches.
@@ -61,6 +110,21 @@ Some features should not be changed. See notes below.
 
 #define USE_RMT_STEPS
 
+// With RMT steps, load each run of step events into the RMT channel memory and let the hardware
+// play it back, so the stepper ISR fires once per run instead of once per step. Probing and
+// homing still run one event per ISR so that switches are checked at every step.
+// #define USE_RMT_BURST
+
+// Count the step pulses on GPIO step pins with the PCNT units and compare them with the
+// position at the end of every segment, reporting steps the timed stepper failed to send.
+// See StepVerify.h. Costs a register read per axis per segment.
+// #define USE_STEP_PCNT
+
+// Record timestamped events from the parser, planner, segment prep, stepper ISR, SD reader and
+// client RX into a ring, dumped by $Trace/Dump. See Trace.h. Costs 16 KB of RAM and a few
+// cycles per event.
+// #define USE_TRACE
+
 // Include the file that loads the machine-specific config file.
 // machine.h must be edited to choose the desired file.
 #include "Machine.h"
@@ -74,6 +138,9 @@ Some features should not be changed. See notes below.
 #        undef USE_RMT_STEPS
 #    endif
 #endif
+#ifndef USE_RMT_STEPS
+#    undef USE_RMT_BURST
+#endif
 
 const int MAX_N_AXIS = 6;
 
@@ -117,6 +184,10 @@ const int MAX_N_AXIS = 6;
 #define ENABLE_SERIAL2SOCKET_IN
 #define ENABLE_SERIAL2SOCKET_OUT
 
+// LittleFS instead of SPIFFS for the WebUI files, on the same partition, see WebUI/LocalFS.h.
+// It needs the LittleFS_esp32 library, and board_build.filesystem = littlefs for uploadfs.
+#define USE_LITTLEFS
+
 // Captive portal is used when WiFi is in access point mode.  It lets the
 // WebUI come up automatically in the browser, instead of requiring the user
 // to browse manually to a default URL.  It works like airport and hotel
@@ -236,9 +307,9 @@ static const uint8_t NHomingLocateCycle = 1;  // Integer (1-128)
 // homing cycle while on the limit switch and not have to move the machine off of it.
 // #define LIMITS_TWO_SWITCHES_ON_AXES
 
-// Allows GRBL to track and report gcode line numbers.  Enabling this means that the planning buffer
-// goes from 16 to 15 to make room for the additional line number data in the plan_block_t struct
-// #define USE_LINE_NUMBERS // Disabled by default. Uncomment to enable.
+// Allows GRBL to track and report gcode line numbers, the N words, as |Ln: in the status report.
+// They are kept in an array beside the planner ring, so the planner keeps its size.
+#define USE_LINE_NUMBERS  // Enabled by default. Comment to disable.
 
 // Upon a successful probe cycle, this option provides immediately feedback of the probe coordinates
 // through an automatically generated message. If disabled, users can still access the last probe
@@ -333,6 +404,8 @@ namespace SpindleSpeedOverride {
 #define REPORT_FIELD_WORK_COORD_OFFSET   // Default enabled. Comment to disable.
 #define REPORT_FIELD_OVERRIDES           // Default enabled. Comment to disable.
 #define REPORT_FIELD_LINE_NUMBERS        // Default enabled. Comment to disable.
+// #define REPORT_FIELD_SEGMENT_BUFFER   // Default disabled. Uncomment to report |Sb:segments,ms with the buffer state.
+// #define REPORT_FIELD_PERF             // Default disabled. Uncomment to report |Perf:planner empty,segment empty,min blocks,slow %
 
 // Some status report data isn't necessary for realtime, only intermittently, because the values don't
 // change often. The following macros configures how many times a status report needs to be called before
@@ -355,7 +428,8 @@ const int REPORT_WCO_REFRESH_IDLE_COUNT = 10;  // (2-255) Must be less than or e
 // NOTE: Changing this value also changes the execution time of a segment in the step segment buffer.
 // When increasing this value, this stores less overall time in the segment buffer and vice versa. Make
 // certain the step segment buffer is increased/decreased to account for these changes.
-// const int ACCELERATION_TICKS_PER_SECOND = 100;
+// This is the default for $Stepper/AccelTicks, which can be changed at run time; the segment
+// buffer grows at boot to hold $Stepper/BufferTime milliseconds at that rate.
 const int ACCELERATION_TICKS_PER_SECOND = 100;
 // Sets the maximum step rate allowed to be written as a Grbl setting. This option enables an error
 // check in the settings module to prevent settings values that will exceed this limitation. The maximum
@@ -453,6 +527,7 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // available RAM, like when re-compiling for a Mega2560. Or decrease if the Arduino begins to
 // crash due to the lack of available RAM or if the CPU is having trouble keeping up with planning
 // new incoming motions as they are executed.
+// The buffer is allocated at boot with $Planner/Blocks entries; this only sets the default.
 // #define BLOCK_BUFFER_SIZE 16 // Uncomment to override default in planner.h.
 
 // Governs the size of the intermediary step segment buffer between the step execution algorithm
@@ -461,6 +536,8 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // block velocity profile is traced exactly. The size of this buffer governs how much step
 // execution lead time there is for other Grbl processes have to compute and do their thing
 // before having to come back and refill this buffer, currently at ~50msec of step moves.
+// The buffer is allocated at boot with at least $Stepper/Segments entries, more if $Stepper/BufferTime
+// needs them; this only sets the default.
 // #define SEGMENT_BUFFER_SIZE 6 // Uncomment to override default in stepper.h.
 
 // Line buffer size from the serial input stream to be executed. Also, governs the size of
@@ -480,14 +557,16 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // 115200 baud will take 5 msec to transmit a typical 55 character report. Worst case reports are
 // around 90-100 characters. As long as the serial TX buffer doesn't get continually maxed, Grbl
 // will continue operating efficiently. Size the TX buffer around the size of a worst-case report.
-// #define RX_BUFFER_SIZE 128 // (1-254) Uncomment to override defaults in serial.h
+// #define RX_BUFFER_SIZE 128 // (up to SERIAL_RX_RING_SIZE) Uncomment to override defaults in serial.h
 // #define TX_BUFFER_SIZE 100 // (1-254)
 
 // A simple software debouncing feature for hard limit switches. When enabled, the limit
-// switch interrupt unblock a waiting task which will recheck the limit switch pins after
-// a short delay. Default disabled
+// switch interrupt starts a one shot timer which rechecks the limit switch pins after
+// LIMIT_DEBOUNCE_US, so the steppers stop that long after the switch settles. Default disabled
 //#define ENABLE_SOFTWARE_DEBOUNCE // Default disabled. Uncomment to enable.
-const int DEBOUNCE_PERIOD = 32;  // in milliseconds default 32 microseconds
+#ifndef LIMIT_DEBOUNCE_US
+#    define LIMIT_DEBOUNCE_US 2000  // microseconds
+#endif
 
 // Configures the position after a probing cycle during Grbl's check mode. Disabled sets
 // the position to the probe target, when enabled sets the position to the start position.
@@ -101,12 +101,12 @@ void coolant_stop() {
     coolant_write(disable);
 }
 
-// Main program only. Immediately sets flood coolant running state and also mist coolant,
-// if enabled. Also sets a flag to report an update to a coolant state.
+// Immediately sets flood coolant running state and also mist coolant, if enabled. Also sets a
+// flag to report an update to a coolant state.
 // Called by coolant toggle override, parking restore, parking retract, sleep mode, g-code
-// parser program end, and g-code parser coolant_sync().
+// parser program end, and the stepper for the changes coolant_sync() queues.
 
-void coolant_set_state(CoolantState state) {
+void IRAM_ATTR coolant_set_state(CoolantState state) {
     if (sys.abort) {
         return;  // Block during abort.
     }
@@ -119,12 +119,11 @@ void coolant_off() {
     coolant_set_state(disable);
 }
 
-// G-code parser entry-point for setting coolant state. Forces a planner buffer sync and bails
-// if an abort or check-mode is active.
+// G-code parser entry-point for setting coolant state. The change is queued to take effect
+// when the motion before it is done, and bails if check-mode is active.
 void coolant_sync(CoolantState state) {
     if (sys.state == State::CheckMode) {
         return;
     }
-    protocol_buffer_synchronize();  // Ensure coolant turns on when specified in program.
-    coolant_set_state(state);
+    plan_queue_output(PlanOutput::Coolant, 0, state.Mist | (state.Flood << 1));
 }
@@ -50,6 +50,38 @@
 #    define STEP_PULSE_DELAY 0
 #endif
 
+#ifndef DEFAULT_SERIAL_BAUD_RATE
+#    define DEFAULT_SERIAL_BAUD_RATE BAUD_RATE  // $Serial/Baud, applied at boot
+#endif
+
+#ifndef DEFAULT_SERIAL_FLOW_CONTROL
+#    define DEFAULT_SERIAL_FLOW_CONTROL 0  // $Serial/FlowControl, RTS/CTS on SERIAL_RTS_PIN and SERIAL_CTS_PIN
+#endif
+
+#ifndef DEFAULT_SD_READ_AHEAD
+#    define DEFAULT_SD_READ_AHEAD 32  // lines queued ahead of the parser when running from SD
+#endif
+
+#ifndef DEFAULT_I2S_OUT_PROFILE
+#    define DEFAULT_I2S_OUT_PROFILE int8_t(I2SOutProfile::Default)  // $I2SO/Profile, DMA buffering for ST_I2S_STREAM
+#endif
+
+#ifndef DEFAULT_I2S_OUT_USEC_PER_PULSE
+#    define DEFAULT_I2S_OUT_USEC_PER_PULSE I2S_OUT_USEC_PER_PULSE  // $I2SO/Resolution, usec per I2S sample: 4, 2 or 1 (16-bit only)
+#endif
+
+#ifndef DEFAULT_SD_SPI_FREQ
+#    define DEFAULT_SD_SPI_FREQ (GRBL_SPI_FREQ / 1000)  // kHz, lowered at run time if the card fails at it
+#endif
+
+#ifndef DEFAULT_SD_QUEUE_PAUSE
+#    define DEFAULT_SD_QUEUE_PAUSE 0  // $SD/Queue/Pause, feed hold before each queued job until cycle start
+#endif
+
+#ifndef DEFAULT_SD_JOB_LOG
+#    define DEFAULT_SD_JOB_LOG 1  // $SD/JobLog, run history in JobLog.h's JOBLOG_PATH
+#endif
+
 #ifndef DEFAULT_STEPPER_IDLE_LOCK_TIME
 #    define DEFAULT_STEPPER_IDLE_LOCK_TIME 250  // $1 msec (0-254, 255 keeps steppers enabled)
 #endif
@@ -74,10 +106,70 @@
 #    define DEFAULT_INVERT_PROBE_PIN 0  // $6 boolean
 #endif
 
+#ifndef DEFAULT_PROBE_TWO_STAGE
+#    define DEFAULT_PROBE_TWO_STAGE 0  // $Probe/TwoStage, G38.2 and G38.3 retract and latch again before they report
+#endif
+
+#ifndef DEFAULT_PROBE_RETRACT
+#    define DEFAULT_PROBE_RETRACT 2.0  // $Probe/Retract mm, back along the probe move between the two contacts
+#endif
+
+#ifndef DEFAULT_PROBE_LATCH_RATE
+#    define DEFAULT_PROBE_LATCH_RATE 25.0  // $Probe/LatchRate mm/min, the second contact, which is reported
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_SEEK_RATE
+#    define DEFAULT_PROBE_GRID_SEEK_RATE 300.0  // $Probe/Grid/SeekRate mm/min, first contact at each point
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_LATCH_RATE
+#    define DEFAULT_PROBE_GRID_LATCH_RATE 30.0  // $Probe/Grid/LatchRate mm/min, the contact that is recorded
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_BACKOFF
+#    define DEFAULT_PROBE_GRID_BACKOFF 0.5  // $Probe/Grid/Backoff mm, lift between seek and latch
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_CLEARANCE
+#    define DEFAULT_PROBE_GRID_CLEARANCE 1.0  // $Probe/Grid/Clearance mm above the last contact while moving to the next point
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_DEPTH
+#    define DEFAULT_PROBE_GRID_DEPTH 5.0  // $Probe/Grid/Depth mm, deepest contact below the starting Z
+#endif
+
+#ifndef DEFAULT_PROBE_GRID_COMPENSATE
+#    define DEFAULT_PROBE_GRID_COMPENSATE 0  // $Probe/Grid/Compensate, moves follow the probed height map
+#endif
+
 #ifndef DEFAULT_STATUS_REPORT_MASK
 #    define DEFAULT_STATUS_REPORT_MASK 1  // $10
 #endif
 
+#ifndef DEFAULT_UI_HEADLESS_JOB
+#    define DEFAULT_UI_HEADLESS_JOB 0  // $UI/HeadlessJob, a plain progress screen replaces the UI while in cycle
+#endif
+
+#ifndef DEFAULT_REPORT_INTERVAL
+#    define DEFAULT_REPORT_INTERVAL 0  // $Report/Interval msec between pushed status reports, 0 for polling only
+#endif
+
+#ifndef DEFAULT_REPORT_DELTA
+#    define DEFAULT_REPORT_DELTA 0  // $Report/Delta, pushed reports carry only the changed fields
+#endif
+
+#ifndef DEFAULT_REPORT_OK_BATCH
+#    define DEFAULT_REPORT_OK_BATCH 0  // $Report/OkBatch msec a network client's acks are held to go in one write, 0 for one each
+#endif
+
+#ifndef DEFAULT_CPU_IDLE_MHZ
+#    define DEFAULT_CPU_IDLE_MHZ 240  // $CPU/IdleMHz, 80, 160 or 240. 240 keeps the full clock while idle
+#endif
+
+#ifndef DEFAULT_REPORT_OK_CREDIT
+#    define DEFAULT_REPORT_OK_CREDIT 0  // $Report/OkCredit, a batch is sent as ok:<count>,<free RX bytes> instead of plain oks
+#endif
+
 #ifndef DEFAULT_VERBOSE_ERRORS
 #    define DEFAULT_VERBOSE_ERRORS 0
 #endif
@@ -90,6 +182,18 @@
 #    define DEFAULT_ARC_TOLERANCE 0.002  // $12 mm
 #endif
 
+#ifndef DEFAULT_PLANNER_BLEND_TOLERANCE
+#    define DEFAULT_PLANNER_BLEND_TOLERANCE 0.0  // mm, 0 disables merging of short lines
+#endif
+
+#ifndef DEFAULT_PLANNER_COALESCE_TOLERANCE
+#    define DEFAULT_PLANNER_COALESCE_TOLERANCE 0.0  // mm, 0 disables merging of collinear lines ahead of the planner
+#endif
+
+#ifndef DEFAULT_ARC_TOLERANCE_MAX
+#    define DEFAULT_ARC_TOLERANCE_MAX 0.0  // mm, 0 never coarsens arcs past $12
+#endif
+
 #ifndef DEFAULT_REPORT_INCHES
 #    define DEFAULT_REPORT_INCHES 0  // $13 false
 #endif
@@ -126,6 +230,24 @@
 #    define DEFAULT_HOMING_PULLOFF 1.0  // $27 mm
 #endif
 
+// Merges the homing cycles without squared axes into one, so those axes seek, pull off and locate
+// together. Off keeps the cycle order, which normally clears Z before X and Y move.
+#ifndef DEFAULT_HOMING_PARALLEL
+#    define DEFAULT_HOMING_PARALLEL 0  // false
+#endif
+
+// While the position is still good from the last homing, $H rapids to the pull-off position and
+// only does the slow locate pass. Any alarm, reset in motion or motor disable makes it seek again.
+#ifndef DEFAULT_HOMING_QUICK
+#    define DEFAULT_HOMING_QUICK 0  // false
+#endif
+
+// Trinamic StallGuard homing: a stall is a filtered SG_RESULT under this percentage of the value
+// learned at the start of each approach. 0 uses the driver's DIAG1 stall output only.
+#ifndef DEFAULT_HOMING_SENSORLESS_THRESHOLD
+#    define DEFAULT_HOMING_SENSORLESS_THRESHOLD 0  // %
+#endif
+
 #ifndef DEFAULT_HOMING_SQUARED_AXES
 #    define DEFAULT_HOMING_SQUARED_AXES 0
 #endif
@@ -171,6 +293,70 @@
 #    define DEFAULT_LASER_FULL_POWER 1000
 #endif
 
+#ifndef DEFAULT_STEPPER_S_CURVE
+#    define DEFAULT_STEPPER_S_CURVE 0  // false, trapezoidal ramps
+#endif
+
+#ifndef DEFAULT_STEPPER_PULSE_TIMER
+#    define DEFAULT_STEPPER_PULSE_TIMER 0  // false, Timed and I2S static steps spin for the pulse
+#endif
+
+#ifndef DEFAULT_SHAPER_X_TYPE
+#    define DEFAULT_SHAPER_X_TYPE ShaperType::None
+#endif
+
+#ifndef DEFAULT_SHAPER_X_FREQUENCY
+#    define DEFAULT_SHAPER_X_FREQUENCY 40.0  // Hz
+#endif
+
+#ifndef DEFAULT_SHAPER_X_DAMPING
+#    define DEFAULT_SHAPER_X_DAMPING 0.1  // damping ratio
+#endif
+
+#ifndef DEFAULT_SHAPER_Y_TYPE
+#    define DEFAULT_SHAPER_Y_TYPE ShaperType::None
+#endif
+
+#ifndef DEFAULT_SHAPER_Y_FREQUENCY
+#    define DEFAULT_SHAPER_Y_FREQUENCY 40.0  // Hz
+#endif
+
+#ifndef DEFAULT_SHAPER_Y_DAMPING
+#    define DEFAULT_SHAPER_Y_DAMPING 0.1  // damping ratio
+#endif
+
+#ifndef DEFAULT_LASER_DYNAMIC_POWER
+#    define DEFAULT_LASER_DYNAMIC_POWER 0  // false
+#endif
+
+#ifndef DEFAULT_LASER_CURVE
+#    define DEFAULT_LASER_CURVE LaserCurve::Linear
+#endif
+
+#ifndef DEFAULT_LASER_GAMMA
+#    define DEFAULT_LASER_GAMMA 1.0
+#endif
+
+#ifndef DEFAULT_LASER_POWER_MIN
+#    define DEFAULT_LASER_POWER_MIN 0.0  // percent of full duty where marking starts, for S above 0
+#endif
+
+#ifndef DEFAULT_LASER_SCAN_OFFSET
+#    define DEFAULT_LASER_SCAN_OFFSET 0  // us, how much earlier laser power changes are made
+#endif
+
+#ifndef DEFAULT_LASER_PULSES_PER_MM
+#    define DEFAULT_LASER_PULSES_PER_MM 0.0  // 0 sets power by duty, else pulses per mm of cut
+#endif
+
+#ifndef DEFAULT_LASER_PULSE_WIDTH
+#    define DEFAULT_LASER_PULSE_WIDTH 100  // us, length of each laser pulse
+#endif
+
+#ifndef DEFAULT_LASER_TRAVEL_FEED
+#    define DEFAULT_LASER_TRAVEL_FEED 0.0  // mm/min, 0 runs S0 moves at their own feed
+#endif
+
 #ifndef DEFAULT_SPINDLE_RPM_MAX             // $30
 #    define DEFAULT_SPINDLE_RPM_MAX 1000.0  // rpm
 #endif
@@ -195,6 +381,22 @@
 #    define DEFAULT_SPINDLE_DELAY_SPINUP 0
 #endif
 
+#ifndef DEFAULT_SPINDLE_AT_SPEED_TOLERANCE
+#    define DEFAULT_SPINDLE_AT_SPEED_TOLERANCE 2.5  // percent of the speed range
+#endif
+
+#ifndef DEFAULT_SPINDLE_AT_SPEED_TIMEOUT
+#    define DEFAULT_SPINDLE_AT_SPEED_TIMEOUT 10.0  // seconds
+#endif
+
+#ifndef DEFAULT_SPINDLE_SPEED_QUEUED
+#    define DEFAULT_SPINDLE_SPEED_QUEUED 0  // false, S changes drain the planner
+#endif
+
+#ifndef DEFAULT_SPINDLE_SPEED_LEAD
+#    define DEFAULT_SPINDLE_SPEED_LEAD 0  // milliseconds, about the VFD's Modbus round trip
+#endif
+
 #ifndef DEFAULT_COOLANT_DELAY_TURNON
 #    define DEFAULT_COOLANT_DELAY_TURNON 1.0
 #endif
@@ -477,6 +679,14 @@
 #    define SDCARD_DET_PIN UNDEFINED_PIN
 #endif
 
+#ifndef SERIAL_RTS_PIN
+#    define SERIAL_RTS_PIN UNDEFINED_PIN
+#endif
+
+#ifndef SERIAL_CTS_PIN
+#    define SERIAL_CTS_PIN UNDEFINED_PIN
+#endif
+
 #ifndef STEPPERS_DISABLE_PIN
 #    define STEPPERS_DISABLE_PIN UNDEFINED_PIN
 #endif
@@ -61,6 +61,10 @@ std::map<Error, const char*> ErrorNames = {
     { Error::GcodeG43DynamicAxisError, "Gcode G43 dynamic axis error" },
     { Error::GcodeMaxValueExceeded, "Gcode max value exceeded" },
     { Error::PParamMaxExceeded, "P param max exceeded" },
+    { Error::ExpressionSyntax, "Bad parameter or expression" },
+    { Error::OwordUnknownSub, "Subroutine not defined" },
+    { Error::OwordNesting, "O-word nesting" },
+    { Error::OwordMemory, "No memory for O-word body" },
     { Error::FsFailedMount, "Failed to mount device" },
     { Error::FsFailedRead, "Failed to read" },
     { Error::FsFailedOpenDir, "Failed to open directory" },
@@ -81,4 +85,5 @@ std::map<Error, const char*> ErrorNames = {
     { Error::AuthenticationFailed, "Authentication failed!" },
     { Error::AnotherInterfaceBusy, "Another interface is busy" },
     { Error::JogCancelled, "Jog Cancelled" },
+    { Error::Cancelled, "Cancelled" },
 };
@@ -64,6 +64,10 @@ enum class Error : uint8_t {
     GcodeG43DynamicAxisError    = 37,
     GcodeMaxValueExceeded       = 38,
     PParamMaxExceeded           = 39,
+    ExpressionSyntax            = 40,  // Bad #parameter or [expression]
+    OwordUnknownSub             = 41,  // Call of a subroutine not defined
+    OwordNesting                = 42,  // End without its start, start without its end, or nested too deep
+    OwordMemory                 = 43,  // No heap left for a body
     FsFailedMount               = 60,  // SD Failed to mount
     FsFailedRead                = 61,  // SD Failed to read file
     FsFailedOpenDir             = 62,  // SD card failed to open directory
@@ -85,6 +89,7 @@ enum class Error : uint8_t {
     Eol                         = 111,
     AnotherInterfaceBusy        = 120,
     JogCancelled                = 130,
+    Cancelled                   = 131,  // Stopped by the user
 };
 
 extern std::map<Error, const char*> ErrorNames;
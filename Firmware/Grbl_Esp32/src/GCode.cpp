@@ -24,6 +24,8 @@
 
 #include "Grbl.h"
 
+#include <xtensa/core-macros.h>
+
 // Allow iteration over CoordIndex values
 CoordIndex& operator++(CoordIndex& i) {
     i = static_cast<CoordIndex>(static_cast<uint8_t>(i) + 1);
@@ -38,6 +40,7 @@ static const uint8_t MaxToolNumber = 255;  // Limited by max unsigned 8-bit valu
 
 // Declare gc extern struct
 parser_state_t gc_state;
+bool           gc_sandbox = false;
 parser_block_t gc_block;
 
 #define FAIL(status) return (status);
@@ -48,12 +51,49 @@ void gc_init() {
     // Load default G54 coordinate system.
     gc_state.modal.coord_select = CoordIndex::G54;
     coords[gc_state.modal.coord_select]->get(gc_state.coord_system);
+    gc_update_wco();
+    oword_reset();
+}
+
+void gc_update_wco() {
+    auto n_axis = number_axis->get();
+    for (int idx = 0; idx < n_axis; idx++) {
+        gc_state.wco[idx] = gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+        if (idx == TOOL_LENGTH_OFFSET_AXIS) {
+            gc_state.wco[idx] += gc_state.tool_length_offset;
+        }
+    }
+    gc_update_transform();
+}
+
+void gc_update_transform() {
+    float position[MAX_N_AXIS];
+    gc_get_machine_position(position);  // The tool stays where it is
+    transform_compose(&gc_state.transform_map, &gc_state.transform, gc_state.wco);
+    gc_set_machine_position(position);
+}
+
+void gc_get_machine_position(float* position) {
+    memcpy(position, gc_state.position, sizeof(gc_state.position));
+    if (gc_state.transform_map.active) {
+        transform_apply(&gc_state.transform_map, position);
+    }
+}
+
+void gc_set_machine_position(const float* position) {
+    memcpy(gc_state.position, position, sizeof(gc_state.position));
+    if (gc_state.transform_map.active) {
+        transform_invert(&gc_state.transform_map, gc_state.position);
+    }
 }
 
 // Sets g-code parser position in mm. Input in steps. Called by the system abort and hard
 // limit pull-off routines.
 void gc_sync_position() {
-    system_convert_array_steps_to_mpos(gc_state.position, sys_position);
+    float position[MAX_N_AXIS];
+    system_convert_array_steps_to_mpos(position, sys_position);
+    position[Z_AXIS] -= heightmap_offset(position);  // The g-code position is uncompensated
+    gc_set_machine_position(position);               // And untransformed
 }
 
 // Edit GCode line in-place, removing whitespace and comments and
@@ -115,6 +155,227 @@ void collapseGCode(char* line) {
     *outPtr = '\0';
 }
 
+// Words of the block being executed, split from the text line by gc_execute_line().
+static gc_word_t gc_words[GC_MAX_WORDS];
+
+// Splits a collapsed line into letter/value words. A g-code word is a letter followed by
+// a number. Fails on anything else, or if the line has more than max_words words.
+Error gc_parse_words(const char* line, gc_word_t* words, uint8_t max_words, uint8_t* n_words) {
+    uint8_t char_counter = 0;
+    *n_words             = 0;
+    while (line[char_counter] != 0) {  // Loop until no more g-code words in line.
+        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+        char letter = line[char_counter];
+        if ((letter < 'A') || (letter > 'Z')) {
+            FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
+        }
+        char_counter++;
+        float value;
+        bool  is_value = oword_is_expression(line + char_counter) ? oword_read_value(line, &char_counter, &value)
+                                                                  : read_float(line, &char_counter, &value);
+        if (!is_value) {
+            FAIL(Error::BadNumberFormat);  // [Expected word value]
+        }
+        if (*n_words == max_words) {
+            FAIL(Error::Overflow);
+        }
+        words[*n_words].letter = letter;
+        words[*n_words].value  = value;
+        (*n_words)++;
+    }
+    return Error::Ok;
+}
+
+static Error gc_execute_block(const gc_word_t* words, uint8_t n_words, bool is_jog, uint8_t client);
+
+// How far above the last peck G83 comes back down at rapid before feeding again
+static const float PeckClearance = 0.254;  // mm
+
+static bool gc_is_cycle(Motion motion) {
+    return motion == Motion::DrillCycle || motion == Motion::DrillDwellCycle || motion == Motion::PeckDrillCycle;
+}
+
+// One move of a canned cycle, from and then updating gc_state.position
+static void gc_cycle_move(float* target, plan_line_data_t* pl_data, bool rapid) {
+    pl_data->motion.rapidMotion = rapid;
+    mc_job_line(target, pl_data, gc_state.position);
+    memcpy(gc_state.position, target, sizeof(gc_state.position));
+}
+
+// Drills the holes of a G81/G82/G83 block as planned moves, the first at gc_block.values.xyz in the
+// plane and, in G91, each repeat one more step of the same length further on. Levels are along
+// axis_linear in machine coordinates. Retracts to the level the block started at with G98, if
+// above R, or to R with G99.
+static void gc_execute_cycle(plan_line_data_t* pl_data, uint8_t axis_linear, float r_level, float bottom, uint8_t repeats) {
+    float old_level = gc_state.position[axis_linear];
+    float retract   = gc_state.modal.cycle_return == CycleReturn::OldZ ? MAX(old_level, r_level) : r_level;
+    float step[MAX_N_AXIS];
+    float target[MAX_N_AXIS];
+    for (int idx = 0; idx < MAX_N_AXIS; idx++) {
+        step[idx] = gc_block.values.xyz[idx] - gc_state.position[idx];
+    }
+    step[axis_linear] = 0.0;
+    memcpy(target, gc_state.position, sizeof(target));
+    if (old_level < r_level) {
+        target[axis_linear] = r_level;  // Never cross the plane below R
+        gc_cycle_move(target, pl_data, true);
+    }
+    for (uint8_t hole = 0; hole < repeats && !sys.abort; hole++) {
+        if (hole == 0) {
+            memcpy(target, gc_block.values.xyz, sizeof(target));
+        } else if (gc_block.modal.distance == Distance::Incremental) {
+            for (int idx = 0; idx < MAX_N_AXIS; idx++) {
+                target[idx] += step[idx];
+            }
+        }
+        target[axis_linear] = gc_state.position[axis_linear];
+        gc_cycle_move(target, pl_data, true);
+        target[axis_linear] = r_level;
+        gc_cycle_move(target, pl_data, true);
+        if (gc_state.modal.motion == Motion::PeckDrillCycle) {
+            float level = r_level;
+            while (level > bottom) {
+                if (level < r_level) {
+                    target[axis_linear] = MIN(level + PeckClearance, r_level);
+                    gc_cycle_move(target, pl_data, true);
+                }
+                level               = MAX(level - gc_state.cycle.q, bottom);
+                target[axis_linear] = level;
+                gc_cycle_move(target, pl_data, false);
+                target[axis_linear] = r_level;
+                gc_cycle_move(target, pl_data, true);
+            }
+        } else {
+            target[axis_linear] = bottom;
+            gc_cycle_move(target, pl_data, false);
+            if (gc_state.modal.motion == Motion::DrillDwellCycle) {
+                mc_dwell(int32_t(gc_state.cycle.p * 1000.0f));
+            }
+        }
+        target[axis_linear] = retract;
+        gc_cycle_move(target, pl_data, true);
+    }
+}
+
+// Cleared by gc_bench() to time the full parser on the same lines
+static bool gc_fast_path_enabled = true;
+
+// Executes the common streaming block, G0/G1 with axis words and optional F and S in G21 G90
+// G94 with a G0/G1 motion mode in effect, without going through gc_execute_block(). Returns
+// false, having changed nothing, for any block it does not cover, and also for blocks that
+// need the full error-checking or a spindle sync, which gc_execute_block() then rejects or
+// handles. The state updates below are the subset of gc_execute_block() such a block reaches.
+static bool gc_execute_fast(const gc_word_t* words, uint8_t n_words) {
+    if (gc_state.modal.units != Units::Mm || gc_state.modal.distance != Distance::Absolute ||
+        gc_state.modal.feed_rate != FeedRate::UnitsPerMin) {
+        return false;
+    }
+
+    auto     n_axis      = number_axis->get();
+    Motion   motion      = gc_state.modal.motion;
+    bool     has_motion  = false;
+    uint8_t  axis_words  = 0;
+    uint32_t value_words = 0;  // F and S, to catch repeats
+    float    f           = gc_state.feed_rate;
+    float    s           = gc_state.spindle_speed;
+    float    axis_value[MAX_N_AXIS];
+
+    for (uint8_t i = 0; i < n_words; i++) {
+        float value = words[i].value;
+        int   axis;
+        switch (words[i].letter) {
+            case 'G':
+                if (has_motion || (value != 0.0f && value != 1.0f)) {
+                    return false;
+                }
+                has_motion = true;
+                motion     = value == 0.0f ? Motion::Seek : Motion::Linear;
+                continue;
+            case 'F':
+                if (bit_istrue(value_words, bit(GCodeWord::F)) || value < 0.0f) {
+                    return false;
+                }
+                bit_true(value_words, bit(GCodeWord::F));
+                f = value;
+                continue;
+            case 'S':
+                if (bit_istrue(value_words, bit(GCodeWord::S)) || value < 0.0f) {
+                    return false;
+                }
+                bit_true(value_words, bit(GCodeWord::S));
+                s = value;
+                continue;
+            case 'X':
+                axis = X_AXIS;
+                break;
+            case 'Y':
+                axis = Y_AXIS;
+                break;
+            case 'Z':
+                axis = Z_AXIS;
+                break;
+            case 'A':
+                axis = A_AXIS;
+                break;
+            case 'B':
+                axis = B_AXIS;
+                break;
+            case 'C':
+                axis = C_AXIS;
+                break;
+            default:
+                return false;
+        }
+        if (axis >= n_axis || bit_istrue(axis_words, bit(axis))) {
+            return false;
+        }
+        bit_true(axis_words, bit(axis));
+        axis_value[axis] = value;
+    }
+
+    // Without axis words the block may only change modes, which the full parser sorts out
+    if (!axis_words || !(motion == Motion::Seek || motion == Motion::Linear)) {
+        return false;
+    }
+    if (motion == Motion::Linear && f == 0.0f) {
+        return false;  // [Feed rate undefined]
+    }
+    bool laser     = spindle->inLaserMode();
+    bool laser_off = laser && motion != Motion::Linear;  // Laser power is only on during G1/2/3
+    if (s != gc_state.spindle_speed && gc_state.modal.spindle != SpindleState::Disable && !laser) {
+        return false;  // A spindle speed change outside laser mode waits for the planner to empty
+    }
+
+    // Same arithmetic as gc_execute_block(), axes past n_axis are zero there too
+    float target[MAX_N_AXIS] = {};
+    for (int idx = 0; idx < n_axis; idx++) {
+        if (bit_isfalse(axis_words, bit(idx))) {
+            target[idx] = gc_state.position[idx];
+        } else {
+            target[idx] = axis_value[idx] + gc_state.wco[idx];
+        }
+    }
+
+    plan_line_data_t pl_data;
+    memset(&pl_data, 0, sizeof(plan_line_data_t));
+    gc_state.line_number   = 0;
+    gc_state.feed_rate     = f;
+    gc_state.spindle_speed = s;
+    gc_state.modal.motion  = motion;
+    pl_data.feed_rate      = f;
+    if (!laser_off) {
+        pl_data.spindle_speed = s;
+    }
+    pl_data.spindle = gc_state.modal.spindle;
+    pl_data.coolant = gc_state.modal.coolant;
+    if (motion == Motion::Seek) {
+        pl_data.motion.rapidMotion = 1;
+    }
+    mc_job_line(target, &pl_data, gc_state.position);
+    memcpy(gc_state.position, target, sizeof(target));
+    return true;
+}
+
 // Executes one line of NUL-terminated G-Code.
 // The line may contain whitespace and comments, which are first removed,
 // and lower case characters, which are converted to upper case.
@@ -122,12 +383,45 @@ void collapseGCode(char* line) {
 // exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine
 // coordinates, respectively.
 Error gc_execute_line(char* line, uint8_t client) {
+    TRACE_SCOPE(TraceEvent::GCodeLine);
+    if (Setting::batchIsOpen()) {
+        Setting::batchCommit();  // So the line runs on the new settings
+    }
     // Step 0 - remove whitespace and comments and convert to upper case
     collapseGCode(line);
 #ifdef REPORT_ECHO_LINE_RECEIVED
     report_echo_line_received(line, client);
 #endif
 
+    // NOTE: `$J=` already parsed when passed to this function.
+    bool is_jog = line[0] == '$';
+    if (!is_jog && oword_claims(line)) {
+        return oword_execute_line(line, client);  // O-words, assignments and the lines of a body, see OWord.h
+    }
+    uint8_t n_words;
+    Error   status = gc_parse_words(is_jog ? line + 3 : line, gc_words, GC_MAX_WORDS, &n_words);
+    if (status != Error::Ok) {
+        return status;
+    }
+    return gc_execute_block(gc_words, n_words, is_jog, client);
+}
+
+// Executes a block that was split into words ahead of time, e.g. from a compiled SD job.
+Error gc_execute_words(const gc_word_t* words, uint8_t n_words, uint8_t client) {
+    if (Setting::batchIsOpen()) {
+        Setting::batchCommit();  // As gc_execute_line() does
+    }
+    if (oword_recording()) {
+        return oword_record_words(words, n_words);
+    }
+    return gc_execute_block(words, n_words, false, client);
+}
+
+static Error gc_execute_block(const gc_word_t* words, uint8_t n_words, bool is_jog, uint8_t client) {
+    if (!is_jog && gc_fast_path_enabled && gc_execute_fast(words, n_words)) {
+        return Error::Ok;
+    }
+
     /* -------------------------------------------------------------------------------------
        STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
        updates these modes and commands as the block line is parser and will only be used and
@@ -151,7 +445,7 @@ Error gc_execute_line(char* line, uint8_t client) {
     uint8_t  pValue;                  // Integer value of P word
 
     // Determine if the line is a jogging motion or a normal g-code block.
-    if (line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
+    if (is_jog) {
         // Set G1 and G94 enforced modes to ensure accurate error checks.
         gc_parser_flags |= GCParserJogMotion;
         gc_block.modal.motion    = Motion::Linear;
@@ -162,32 +456,19 @@ Error gc_execute_line(char* line, uint8_t client) {
     }
 
     /* -------------------------------------------------------------------------------------
-       STEP 2: Import all g-code words in the block line. A g-code word is a letter followed by
+       STEP 2: Import all g-code words in the block. A g-code word is a letter followed by
        a number, which can either be a 'G'/'M' command or sets/assigns a command value. Also,
        perform initial error-checks for command word modal group violations, for any repeated
        words, and for negative values set for the value words F, N, P, T, and S. */
     ModalGroup mg_word_bit;  // Bit-value for assigning tracking variables
     uint32_t   bitmask = 0;
-    uint8_t    char_counter;
     char       letter;
     float      value;
     uint8_t    int_value = 0;
     uint16_t   mantissa  = 0;
-    if (gc_parser_flags & GCParserJogMotion) {
-        char_counter = 3;  // Start parsing after `$J=`
-    } else {
-        char_counter = 0;
-    }
-    while (line[char_counter] != 0) {  // Loop until no more g-code words in line.
-        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
-        letter = line[char_counter];
-        if ((letter < 'A') || (letter > 'Z')) {
-            FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
-        }
-        char_counter++;
-        if (!read_float(line, &char_counter, &value)) {
-            FAIL(Error::BadNumberFormat);  // [Expected word value]
-        }
+    for (uint8_t word_index = 0; word_index < n_words; word_index++) {
+        letter = words[word_index].letter;
+        value  = words[word_index].value;
         // Convert values to smaller uint8 significand and mantissa values for parsing this word.
         // NOTE: Mantissa is multiplied by 100 to catch non-integer command values. This is more
         // accurate than the NIST gcode requirement of x10 when used for commands, but not quite
@@ -254,6 +535,24 @@ Error gc_execute_line(char* line, uint8_t client) {
                         gc_block.non_modal_command = NonModal::AbsoluteOverride;
                         mg_word_bit                = ModalGroup::MG0;
                         break;
+                    case 50:
+                        gc_block.non_modal_command = NonModal::ResetScale;
+                        mg_word_bit                = ModalGroup::MG0;
+                        break;
+                    case 69:
+                        gc_block.non_modal_command = NonModal::ResetRotation;
+                        mg_word_bit                = ModalGroup::MG0;
+                        break;
+                    case 51:
+                    case 68:
+                        // The axis words are the center
+                        gc_block.non_modal_command = int_value == 51 ? NonModal::SetScale : NonModal::SetRotation;
+                        if (axis_command != AxisCommand::None) {
+                            FAIL(Error::GcodeAxisCommandConflict);  // [Axis word/command conflict]
+                        }
+                        axis_command = AxisCommand::NonModal;
+                        mg_word_bit  = ModalGroup::MG0;
+                        break;
 
                     // Modal Group G1 - motion commands
                     case 0:  // G0 - linear rapid traverse
@@ -313,6 +612,21 @@ Error gc_execute_line(char* line, uint8_t client) {
                         gc_block.modal.motion = Motion::None;
                         mg_word_bit           = ModalGroup::MG1;
                         break;
+                    case 81:  // G81 - drilling cycle
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::DrillCycle;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
+                    case 82:  // G82 - drilling cycle with dwell
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::DrillDwellCycle;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
+                    case 83:  // G83 - peck drilling cycle
+                        axis_command          = AxisCommand::MotionMode;
+                        gc_block.modal.motion = Motion::PeckDrillCycle;
+                        mg_word_bit           = ModalGroup::MG1;
+                        break;
                     case 17:
                         gc_block.modal.plane_select = Plane::XY;
                         mg_word_bit                 = ModalGroup::MG2;
@@ -432,6 +746,14 @@ Error gc_execute_line(char* line, uint8_t client) {
                         // gc_block.modal.control = ControlMode::ExactPath; // G61
                         mg_word_bit = ModalGroup::MG13;
                         break;
+                    case 98:
+                        gc_block.modal.cycle_return = CycleReturn::OldZ;
+                        mg_word_bit                 = ModalGroup::MG10;
+                        break;
+                    case 99:
+                        gc_block.modal.cycle_return = CycleReturn::RLevel;
+                        mg_word_bit                 = ModalGroup::MG10;
+                        break;
                     default:
                         FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G command]
                 }
@@ -648,7 +970,9 @@ Error gc_execute_line(char* line, uint8_t client) {
                         if (value > MaxToolNumber) {
                             FAIL(Error::GcodeMaxValueExceeded);
                         }
-                        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Tool No: %d", int_value);
+                        if (!gc_sandbox) {
+                            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Tool No: %d", int_value);
+                        }
                         gc_state.tool = int_value;
                         break;
                     case 'X':
@@ -860,6 +1184,8 @@ Error gc_execute_line(char* line, uint8_t client) {
             }
         }
     }
+    // The depth of a canned cycle, before it becomes a target below
+    float cycle_depth = gc_block.values.xyz[axis_linear];
 
     // [13. Cutter radius compensation ]: G41/42 NOT SUPPORTED. Error, if enabled while G53 is active.
     // [G40 Errors]: G2/3 arc is programmed after a G40. The linear move after disabling is less than tool diameter.
@@ -884,6 +1210,9 @@ Error gc_execute_line(char* line, uint8_t client) {
     // in memory and written to non-volatile storage only when there is not a cycle active.
     float block_coord_system[MAX_N_AXIS];
     memcpy(block_coord_system, gc_state.coord_system, sizeof(gc_state.coord_system));
+    // The work offset the block's axis words are in, gc_state.wco unless the block selects another system
+    float        block_wco_data[MAX_N_AXIS];
+    const float* block_wco = gc_state.wco;
     if (bit_istrue(command_words, bit(ModalGroup::MG12))) {  // Check if called in block
         // This error probably cannot happen because preceding code sets
         // gc_block.modal.coord_select only to specific supported values
@@ -892,16 +1221,26 @@ Error gc_execute_line(char* line, uint8_t client) {
         }
         if (gc_state.modal.coord_select != gc_block.modal.coord_select) {
             coords[gc_block.modal.coord_select]->get(block_coord_system);
+            for (idx = 0; idx < n_axis; idx++) {
+                block_wco_data[idx] = gc_state.wco[idx] - gc_state.coord_system[idx] + block_coord_system[idx];
+            }
+            block_wco = block_wco_data;
         }
     }
     // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
-    // [18. Set retract mode ]: NOT SUPPORTED.
+    // [18. Set retract mode ]: N/A
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
     // NOTE: We need to separate the non-modal commands that are axis word-using (G10/G28/G30/G92), as these
     // commands all treat axis words differently. G10 as absolute offsets or computes current position as
     // the axis value, G92 similarly to G10 L20, and G28/30 as an intermediate target position that observes
     // all the current coordinate system and G92 offsets.
+    // Offsets, G53 and G28/30 go by where the machine is; jogs and probes are not transformed either.
+    float machine_position[MAX_N_AXIS];
+    gc_get_machine_position(machine_position);
+    bool untransformed = (gc_parser_flags & GCParserJogMotion) || gc_block.non_modal_command == NonModal::AbsoluteOverride ||
+                         (gc_block.modal.motion >= Motion::ProbeToward && gc_block.modal.motion <= Motion::ProbeAwayNoError);
+    float* block_position = untransformed ? machine_position : gc_state.position;
     switch (gc_block.non_modal_command) {
         case NonModal::SetCoordinateData:
             // [G10 Errors]: L missing and is not 2 or 20. P word missing. (Negative P value done.)
@@ -944,7 +1283,7 @@ Error gc_execute_line(char* line, uint8_t client) {
                     if (gc_block.values.l == 20) {
                         // L20: Update coordinate system axis at current position (with modifiers) with programmed value
                         // WPos = MPos - WCS - G92 - TLO  ->  WCS = MPos - G92 - TLO - WPos
-                        coord_data[idx] = gc_state.position[idx] - gc_state.coord_offset[idx] - gc_block.values.xyz[idx];
+                        coord_data[idx] = machine_position[idx] - gc_state.coord_offset[idx] - gc_block.values.xyz[idx];
                         if (idx == TOOL_LENGTH_OFFSET_AXIS) {
                             coord_data[idx] -= gc_state.tool_length_offset;
                         }
@@ -965,7 +1304,7 @@ Error gc_execute_line(char* line, uint8_t client) {
             for (idx = 0; idx < n_axis; idx++) {  // Axes indices are consistent, so loop may be used.
                 if (bit_istrue(axis_words, bit(idx))) {
                     // WPos = MPos - WCS - G92 - TLO  ->  G92 = MPos - WCS - TLO - WPos
-                    gc_block.values.xyz[idx] = gc_state.position[idx] - block_coord_system[idx] - gc_block.values.xyz[idx];
+                    gc_block.values.xyz[idx] = machine_position[idx] - block_coord_system[idx] - gc_block.values.xyz[idx];
                     if (idx == TOOL_LENGTH_OFFSET_AXIS) {
                         gc_block.values.xyz[idx] -= gc_state.tool_length_offset;
                     }
@@ -974,6 +1313,46 @@ Error gc_execute_line(char* line, uint8_t client) {
                 }
             }
             break;
+        case NonModal::SetScale:
+        case NonModal::SetRotation:
+            // [G51/G68 Errors]: Axis words other than X Y. G51 P or I/J missing, or a zero scale. G68 R missing.
+            if (axis_words & ~(bit(X_AXIS) | bit(Y_AXIS))) {
+                FAIL(Error::GcodeUnsupportedCommand);  // [Only XY is transformed]
+            }
+            // The center, in work coordinates. The current position for axes without a word.
+            for (idx = X_AXIS; idx <= Y_AXIS; idx++) {
+                float here = gc_state.position[idx] - block_wco[idx];
+                if (bit_isfalse(axis_words, bit(idx))) {
+                    gc_block.values.xyz[idx] = here;
+                } else if (gc_block.modal.distance == Distance::Incremental) {
+                    gc_block.values.xyz[idx] += here;
+                }
+            }
+            if (gc_block.non_modal_command == NonModal::SetScale) {
+                if (bit_istrue(value_words, bit(GCodeWord::P))) {
+                    gc_block.values.ijk[X_AXIS] = gc_block.values.p;
+                    gc_block.values.ijk[Y_AXIS] = gc_block.values.p;
+                } else if (bit_istrue(value_words, (bit(GCodeWord::I) | bit(GCodeWord::J)))) {
+                    if (bit_isfalse(value_words, bit(GCodeWord::I))) {
+                        gc_block.values.ijk[X_AXIS] = 1.0;
+                    }
+                    if (bit_isfalse(value_words, bit(GCodeWord::J))) {
+                        gc_block.values.ijk[Y_AXIS] = 1.0;
+                    }
+                } else {
+                    FAIL(Error::GcodeValueWordMissing);  // [P or I/J word missing]
+                }
+                if (gc_block.values.ijk[X_AXIS] == 0.0 || gc_block.values.ijk[Y_AXIS] == 0.0) {
+                    FAIL(Error::NumberRange);  // [Zero scale]
+                }
+                bit_false(value_words, (bit(GCodeWord::P) | bit(GCodeWord::I) | bit(GCodeWord::J)));
+            } else {
+                if (bit_isfalse(value_words, bit(GCodeWord::R))) {
+                    FAIL(Error::GcodeValueWordMissing);  // [R word missing]
+                }
+                bit_false(value_words, bit(GCodeWord::R));
+            }
+            break;
         default:
             // At this point, the rest of the explicit axis commands treat the axis values as the traditional
             // target position with the coordinate system offsets, G92 offsets, absolute override, and distance
@@ -983,19 +1362,16 @@ Error gc_execute_line(char* line, uint8_t client) {
                 if (axis_words) {
                     for (idx = 0; idx < n_axis; idx++) {  // Axes indices are consistent, so loop may be used to save flash space.
                         if (bit_isfalse(axis_words, bit(idx))) {
-                            gc_block.values.xyz[idx] = gc_state.position[idx];  // No axis word in block. Keep same axis position.
+                            gc_block.values.xyz[idx] = block_position[idx];  // No axis word in block. Keep same axis position.
                         } else {
                             // Update specified value according to distance mode or ignore if absolute override is active.
                             // NOTE: G53 is never active with G28/30 since they are in the same modal group.
                             if (gc_block.non_modal_command != NonModal::AbsoluteOverride) {
                                 // Apply coordinate offsets based on distance mode.
                                 if (gc_block.modal.distance == Distance::Absolute) {
-                                    gc_block.values.xyz[idx] += block_coord_system[idx] + gc_state.coord_offset[idx];
-                                    if (idx == TOOL_LENGTH_OFFSET_AXIS) {
-                                        gc_block.values.xyz[idx] += gc_state.tool_length_offset;
-                                    }
+                                    gc_block.values.xyz[idx] += block_wco[idx];
                                 } else {  // Incremental mode
-                                    gc_block.values.xyz[idx] += gc_state.position[idx];
+                                    gc_block.values.xyz[idx] += block_position[idx];
                                 }
                             }
                         }
@@ -1017,7 +1393,7 @@ Error gc_execute_line(char* line, uint8_t client) {
                         // Move only the axes specified in secondary move.
                         for (idx = 0; idx < n_axis; idx++) {
                             if (!(axis_words & bit(idx))) {
-                                coord_data[idx] = gc_state.position[idx];
+                                coord_data[idx] = machine_position[idx];
                             }
                         }
                     } else {
@@ -1044,6 +1420,10 @@ Error gc_execute_line(char* line, uint8_t client) {
             }
     }
     // [20. Motion modes ]:
+    gc_cycle_t cycle         = {};
+    float      cycle_r_level = 0.0;
+    float      cycle_bottom  = 0.0;
+    uint8_t    cycle_repeats = 1;
     if (gc_block.modal.motion == Motion::None) {
         // [G80 Errors]: Axis word are programmed while G80 is active.
         // NOTE: Even non-modal commands or TLO that use axis words will throw this strict error.
@@ -1237,10 +1617,79 @@ Error gc_execute_line(char* line, uint8_t client) {
                     if (!axis_words) {
                         FAIL(Error::GcodeNoAxisWords);  // [No axis words]
                     }
-                    if (isequal_position_vector(gc_state.position, gc_block.values.xyz)) {
+                    if (isequal_position_vector(machine_position, gc_block.values.xyz)) {
                         FAIL(Error::GcodeInvalidTarget);  // [Invalid target]
                     }
                     break;
+                case Motion::DrillCycle:
+                case Motion::DrillDwellCycle:
+                case Motion::PeckDrillCycle:
+                    // [G81-G83 Errors]: Inverse time mode. No axis words. R or the depth never programmed. P missing with
+                    //   G82, Q missing with G83. Q or L not positive. Bottom of the hole above the R level.
+                    // NOTE: R, the depth, P and Q carry over from the previous block while a cycle stays in effect.
+                    if (gc_block.modal.feed_rate == FeedRate::InverseTime) {
+                        FAIL(Error::GcodeUnsupportedCommand);  // [G93 canned cycle]
+                    }
+                    if (!axis_words) {
+                        FAIL(Error::GcodeNoAxisWords);  // [No axis words]
+                    }
+                    if (gc_is_cycle(gc_state.modal.motion)) {
+                        cycle = gc_state.cycle;
+                    }
+                    if (bit_istrue(value_words, bit(GCodeWord::R))) {
+                        cycle.r = gc_block.values.r;
+                        if (gc_block.modal.units == Units::Inches) {
+                            cycle.r *= MM_PER_INCH;
+                        }
+                        cycle.given |= bit(GCodeWord::R);
+                    }
+                    if (bit_istrue(axis_words, bit(axis_linear))) {
+                        cycle.depth = cycle_depth;
+                        cycle.given |= bit(GCodeWord::Z);  // For the axis across the plane
+                    }
+                    if (bit_istrue(value_words, bit(GCodeWord::P)) && gc_block.modal.motion == Motion::DrillDwellCycle) {
+                        cycle.p = gc_block.values.p;
+                        cycle.given |= bit(GCodeWord::P);
+                        bit_false(value_words, bit(GCodeWord::P));
+                    }
+                    if (bit_istrue(value_words, bit(GCodeWord::Q)) && gc_block.modal.motion == Motion::PeckDrillCycle) {
+                        if (gc_block.values.q <= 0.0) {
+                            FAIL(Error::NegativeValue);  // [Q not positive]
+                        }
+                        cycle.q = gc_block.values.q;
+                        if (gc_block.modal.units == Units::Inches) {
+                            cycle.q *= MM_PER_INCH;
+                        }
+                        cycle.given |= bit(GCodeWord::Q);
+                        bit_false(value_words, bit(GCodeWord::Q));
+                    }
+                    if (bit_isfalse(cycle.given, bit(GCodeWord::R)) || bit_isfalse(cycle.given, bit(GCodeWord::Z)) ||
+                        (gc_block.modal.motion == Motion::DrillDwellCycle && bit_isfalse(cycle.given, bit(GCodeWord::P))) ||
+                        (gc_block.modal.motion == Motion::PeckDrillCycle && bit_isfalse(cycle.given, bit(GCodeWord::Q)))) {
+                        FAIL(Error::GcodeValueWordMissing);  // [R, depth, P or Q word missing]
+                    }
+                    if (bit_istrue(value_words, bit(GCodeWord::L))) {
+                        if (gc_block.values.l == 0) {
+                            FAIL(Error::NegativeValue);  // [L not positive]
+                        }
+                        cycle_repeats = gc_block.values.l;
+                    }
+                    bit_false(value_words, (bit(GCodeWord::R) | bit(GCodeWord::L)));
+                    // In G90 R and the depth are work coordinates. In G91 R is from the current level, and the
+                    // depth from R.
+                    if (gc_block.modal.distance == Distance::Absolute) {
+                        cycle_r_level = cycle.r + block_wco[axis_linear];
+                        cycle_bottom  = cycle.depth + block_wco[axis_linear];
+                    } else {
+                        cycle_r_level = gc_state.position[axis_linear] + cycle.r;
+                        cycle_bottom  = cycle_r_level + cycle.depth;
+                    }
+                    if (cycle_bottom > cycle_r_level) {
+                        FAIL(Error::GcodeInvalidTarget);  // [Bottom above R]
+                    }
+                    // The axis word across the plane is the depth, so the hole is at the current level
+                    gc_block.values.xyz[axis_linear] = gc_state.position[axis_linear];
+                    break;
             }
         }
     }
@@ -1291,7 +1740,7 @@ Error gc_execute_line(char* line, uint8_t client) {
         bool  cancelledInflight = false;
         Error status            = jog_execute(pl_data, &gc_block, &cancelledInflight);
         if (status == Error::Ok && !cancelledInflight) {
-            memcpy(gc_state.position, gc_block.values.xyz, sizeof(gc_block.values.xyz));
+            gc_set_machine_position(gc_block.values.xyz);
         }
         // JogCancelled is not reported as a GCode error
         return status == Error::JogCancelled ? Error::Ok : status;
@@ -1346,6 +1795,10 @@ Error gc_execute_line(char* line, uint8_t client) {
             if (bit_isfalse(gc_parser_flags, GCParserLaserIsMotion)) {
                 if (bit_istrue(gc_parser_flags, GCParserLaserDisable)) {
                     spindle->sync(gc_state.modal.spindle, 0);
+                } else if (spindle_speed_queued->get() && !spindle->inLaserMode() && gc_state.modal.spindle == gc_block.modal.spindle &&
+                           sys.state != State::CheckMode && !gc_sandbox) {
+                    // Only the speed changes, so it is made as the next line starts, like the line's own speed
+                    plan_queue_output(PlanOutput::SpindleSpeed, 0, (uint32_t)gc_block.values.s);
                 } else {
                     spindle->sync(gc_state.modal.spindle, (uint32_t)gc_block.values.s);
                 }
@@ -1360,7 +1813,7 @@ Error gc_execute_line(char* line, uint8_t client) {
     // [5. Select tool ]: NOT SUPPORTED. Only tracks tool value.
     //	gc_state.tool = gc_block.values.t;
     // [6. Change tool ]: NOT SUPPORTED
-    if (gc_block.modal.tool_change == ToolChange::Enable) {
+    if (gc_block.modal.tool_change == ToolChange::Enable && !gc_sandbox) {
         user_tool_change(gc_state.tool);
     }
     // [7. Spindle control ]:
@@ -1399,11 +1852,12 @@ Error gc_execute_line(char* line, uint8_t client) {
     if ((gc_block.modal.io_control == IoControl::DigitalOnSync) || (gc_block.modal.io_control == IoControl::DigitalOffSync) ||
         (gc_block.modal.io_control == IoControl::DigitalOnImmediate) || (gc_block.modal.io_control == IoControl::DigitalOffImmediate)) {
         if (gc_block.values.p < MaxUserDigitalPin) {
-            if ((gc_block.modal.io_control == IoControl::DigitalOnSync) || (gc_block.modal.io_control == IoControl::DigitalOffSync)) {
-                protocol_buffer_synchronize();
-            }
             bool turnOn = gc_block.modal.io_control == IoControl::DigitalOnSync || gc_block.modal.io_control == IoControl::DigitalOnImmediate;
-            if (!sys_set_digital((int)gc_block.values.p, turnOn)) {
+            if (gc_sandbox) {
+                // A file check leaves the outputs alone
+            } else if ((gc_block.modal.io_control == IoControl::DigitalOnSync) || (gc_block.modal.io_control == IoControl::DigitalOffSync)) {
+                plan_queue_output(PlanOutput::Digital, (int)gc_block.values.p, turnOn);  // Applied when the motion before it is done
+            } else if (!sys_set_digital((int)gc_block.values.p, turnOn)) {
                 FAIL(Error::PParamMaxExceeded);
             }
         } else {
@@ -1414,9 +1868,13 @@ Error gc_execute_line(char* line, uint8_t client) {
         if (gc_block.values.e < MaxUserDigitalPin) {
             gc_block.values.q = constrain(gc_block.values.q, 0.0, 100.0);  // force into valid range
             if (gc_block.modal.io_control == IoControl::SetAnalogSync) {
-                protocol_buffer_synchronize();
-            }
-            if (!sys_set_analog((int)gc_block.values.e, gc_block.values.q)) {
+                if (!sys_analog_ready(gc_block.values.e)) {
+                    FAIL(Error::PParamMaxExceeded);
+                }
+                if (!gc_sandbox) {
+                    plan_queue_output(PlanOutput::Analog, gc_block.values.e, sys_analog_numerator(gc_block.values.e, gc_block.values.q));
+                }
+            } else if (!gc_sandbox && !sys_set_analog((int)gc_block.values.e, gc_block.values.q)) {
                 FAIL(Error::PParamMaxExceeded);
             }
         } else {
@@ -1453,6 +1911,7 @@ Error gc_execute_line(char* line, uint8_t client) {
         // else G43.1
         if (gc_state.tool_length_offset != gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS]) {
             gc_state.tool_length_offset = gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
+            gc_update_wco();
             system_flag_wco_change();
         }
     }
@@ -1460,20 +1919,25 @@ Error gc_execute_line(char* line, uint8_t client) {
     if (gc_state.modal.coord_select != gc_block.modal.coord_select) {
         gc_state.modal.coord_select = gc_block.modal.coord_select;
         memcpy(gc_state.coord_system, block_coord_system, sizeof(gc_state.coord_system));
+        gc_update_wco();
         system_flag_wco_change();
     }
     // [16. Set path control mode ]: G61.1/G64 NOT SUPPORTED
     // gc_state.modal.control = gc_block.modal.control; // NOTE: Always default.
     // [17. Set distance mode ]:
     gc_state.modal.distance = gc_block.modal.distance;
-    // [18. Set retract mode ]: NOT SUPPORTED
+    // [18. Set retract mode ]:
+    gc_state.modal.cycle_return = gc_block.modal.cycle_return;
     // [19. Go to predefined position, Set G10, or Set axis offsets ]:
     switch (gc_block.non_modal_command) {
         case NonModal::SetCoordinateData:
-            coords[coord_select]->set(coord_data);
+            if (!gc_sandbox) {
+                coords[coord_select]->set(coord_data);
+            }
             // Update system coordinate system if currently active.
             if (gc_state.modal.coord_select == coord_select) {
                 memcpy(gc_state.coord_system, coord_data, sizeof(gc_state.coord_system));
+                gc_update_wco();
                 system_flag_wco_change();
             }
             break;
@@ -1483,25 +1947,55 @@ Error gc_execute_line(char* line, uint8_t client) {
             // and absolute and incremental modes.
             pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
             if (axis_command != AxisCommand::None) {
-                cartesian_to_motors(gc_block.values.xyz, pl_data, gc_state.position);
+                mc_job_line(gc_block.values.xyz, pl_data, gc_state.position);
+                gc_get_machine_position(machine_position);
             }
-            cartesian_to_motors(coord_data, pl_data, gc_state.position);
-            memcpy(gc_state.position, coord_data, sizeof(gc_state.position));
+            cartesian_to_motors(coord_data, pl_data, machine_position);
+            gc_set_machine_position(coord_data);
             break;
         case NonModal::SetHome0:
-            coords[CoordIndex::G28]->set(gc_state.position);
+            if (!gc_sandbox) {
+                coords[CoordIndex::G28]->set(machine_position);
+            }
             break;
         case NonModal::SetHome1:
-            coords[CoordIndex::G30]->set(gc_state.position);
+            if (!gc_sandbox) {
+                coords[CoordIndex::G30]->set(machine_position);
+            }
             break;
         case NonModal::SetCoordinateOffset:
             memcpy(gc_state.coord_offset, gc_block.values.xyz, sizeof(gc_block.values.xyz));
+            gc_update_wco();
             system_flag_wco_change();
             break;
         case NonModal::ResetCoordinateOffset:
             clear_vector(gc_state.coord_offset);  // Disable G92 offsets by zeroing offset vector.
+            gc_update_wco();
             system_flag_wco_change();
             break;
+        case NonModal::SetScale:
+            gc_state.transform.scaled          = true;
+            gc_state.transform.scale[0]        = gc_block.values.ijk[X_AXIS];
+            gc_state.transform.scale[1]        = gc_block.values.ijk[Y_AXIS];
+            gc_state.transform.scale_center[0] = gc_block.values.xyz[X_AXIS];
+            gc_state.transform.scale_center[1] = gc_block.values.xyz[Y_AXIS];
+            gc_update_transform();
+            break;
+        case NonModal::ResetScale:
+            gc_state.transform.scaled = false;
+            gc_update_transform();
+            break;
+        case NonModal::SetRotation:
+            gc_state.transform.rotated            = true;
+            gc_state.transform.degrees            = gc_block.values.r;
+            gc_state.transform.rotation_center[0] = gc_block.values.xyz[X_AXIS];
+            gc_state.transform.rotation_center[1] = gc_block.values.xyz[Y_AXIS];
+            gc_update_transform();
+            break;
+        case NonModal::ResetRotation:
+            gc_state.transform.rotated = false;
+            gc_update_transform();
+            break;
         default:
             break;
     }
@@ -1512,11 +2006,17 @@ Error gc_execute_line(char* line, uint8_t client) {
     if (gc_state.modal.motion != Motion::None) {
         if (axis_command == AxisCommand::MotionMode) {
             GCUpdatePos gc_update_pos = GCUpdatePos::Target;
-            if (gc_state.modal.motion == Motion::Linear) {
-                cartesian_to_motors(gc_block.values.xyz, pl_data, gc_state.position);
-            } else if (gc_state.modal.motion == Motion::Seek) {
-                pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
-                cartesian_to_motors(gc_block.values.xyz, pl_data, gc_state.position);
+            if (gc_state.modal.motion == Motion::Linear || gc_state.modal.motion == Motion::Seek) {
+                pl_data->motion.rapidMotion = gc_state.modal.motion == Motion::Seek;
+                if (untransformed) {
+                    cartesian_to_motors(gc_block.values.xyz, pl_data, machine_position);  // G53 is in machine coordinates
+                } else {
+                    mc_job_line(gc_block.values.xyz, pl_data, gc_state.position);
+                }
+            } else if (gc_is_cycle(gc_state.modal.motion)) {
+                gc_state.cycle = cycle;
+                gc_execute_cycle(pl_data, axis_linear, cycle_r_level, cycle_bottom, cycle_repeats);
+                gc_update_pos = GCUpdatePos::None;  // Left where the cycle ends
             } else if ((gc_state.modal.motion == Motion::CwArc) || (gc_state.modal.motion == Motion::CcwArc)) {
                 mc_arc(gc_block.values.xyz,
                        pl_data,
@@ -1538,7 +2038,9 @@ Error gc_execute_line(char* line, uint8_t client) {
             // As far as the parser is concerned, the position is now == target. In reality the
             // motion control system might still be processing the action and the real tool position
             // in any intermediate location.
-            if (gc_update_pos == GCUpdatePos::Target) {
+            if (gc_update_pos == GCUpdatePos::Target && untransformed) {
+                gc_set_machine_position(gc_block.values.xyz);
+            } else if (gc_update_pos == GCUpdatePos::Target) {
                 memcpy(gc_state.position, gc_block.values.xyz, sizeof(gc_block.values.xyz));  // gc_state.position[] = gc_block.values.xyz[]
             } else if (gc_update_pos == GCUpdatePos::System) {
                 gc_sync_position();  // gc_state.position[] = sys_position
@@ -1579,6 +2081,9 @@ Error gc_execute_line(char* line, uint8_t client) {
             gc_state.modal.coord_select = CoordIndex::G54;
             gc_state.modal.spindle      = SpindleState::Disable;
             gc_state.modal.coolant      = {};
+            gc_state.transform.scaled   = false;  // G50
+            gc_state.transform.rotated  = false;  // G69
+            gc_update_transform();
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
 #    ifdef DEACTIVATE_PARKING_UPON_INIT
             gc_state.modal.override = Override::Disabled;
@@ -1588,19 +2093,24 @@ Error gc_execute_line(char* line, uint8_t client) {
 #endif
             // gc_state.modal.override = OVERRIDE_DISABLE; // Not supported.
 #ifdef RESTORE_OVERRIDES_AFTER_PROGRAM_END
-            sys.f_override        = FeedOverride::Default;
-            sys.r_override        = RapidOverride::Default;
-            sys.spindle_speed_ovr = SpindleSpeedOverride::Default;
+            if (!gc_sandbox) {
+                sys.f_override        = FeedOverride::Default;
+                sys.r_override        = RapidOverride::Default;
+                sys.spindle_speed_ovr = SpindleSpeedOverride::Default;
+            }
 #endif
             // Execute coordinate change and spindle/coolant stop.
             if (sys.state != State::CheckMode) {
                 coords[gc_state.modal.coord_select]->get(gc_state.coord_system);
+                gc_update_wco();
                 system_flag_wco_change();  // Set to refresh immediately just in case something altered.
                 spindle->set_state(SpindleState::Disable, 0);
                 coolant_off();
             }
-            report_feedback_message(Message::ProgramEnd);
-            user_m30();
+            if (!gc_sandbox) {
+                report_feedback_message(Message::ProgramEnd);
+                user_m30();
+            }
             break;
     }
     gc_state.modal.program_flow = ProgramFlow::Running;  // Reset program flow.
@@ -1609,27 +2119,57 @@ Error gc_execute_line(char* line, uint8_t client) {
     return Error::Ok;
 }
 
+// Runs n_line G1 lines through gc_execute_line() in check mode, so nothing is planned, and
+// returns the cycles they took. The lines alternate between a full G1 X Y S F line and an
+// X Y line, both at the current position so soft limits cannot trip. With fast_path false
+// the same lines go through the full parser. The parser and machine state are restored.
+uint64_t gc_bench(uint16_t n_line, bool fast_path) {
+    char  lines[2][LINE_BUFFER_SIZE];
+    float wx = gc_state.position[X_AXIS] - gc_state.wco[X_AXIS];
+    float wy = gc_state.position[Y_AXIS] - gc_state.wco[Y_AXIS];
+    snprintf(lines[0], sizeof(lines[0]), "G1 X%.4f Y%.4f S%.0f F3000", wx, wy, gc_state.spindle_speed);
+    snprintf(lines[1], sizeof(lines[1]), "X%.4f Y%.4f", wx, wy);
+
+    parser_state_t save_gc_state = gc_state;
+    State          save_state    = sys.state;
+    sys.state                    = State::CheckMode;
+    gc_fast_path_enabled         = fast_path;
+
+    uint64_t total_cycles = 0;
+    char     line[LINE_BUFFER_SIZE];
+    for (uint16_t i = 0; i < n_line; i++) {
+        strcpy(line, lines[i & 1]);  // gc_execute_line() edits the line in place
+        uint32_t start_cycles = xthal_get_ccount();
+        gc_execute_line(line, CLIENT_SERIAL);
+        total_cycles += xthal_get_ccount() - start_cycles;
+    }
+
+    gc_fast_path_enabled = true;
+    sys.state            = save_state;
+    gc_state             = save_gc_state;
+    return total_cycles;
+}
+
 /*
   Not supported:
 
-  - Canned cycles
+  - Canned cycles other than G81, G82 and G83
   - Tool radius compensation
   - A,B,C-axes
-  - Evaluation of expressions
-  - Variables
+  - Named parameters and O-word if/else, do, break and return (O-word subroutines, repeat,
+    while, numbered parameters and expressions are in OWord.h)
   - Override control (TBD)
   - Tool changes
   - Switches
 
    (*) Indicates optional parameter, enabled through config.h and re-compile
    group 0 = {G92.2, G92.3} (Non modal: Cancel and re-enable G92 offsets)
-   group 1 = {G81 - G89} (Motion modes: Canned cycles)
+   group 1 = {G73, G76, G84 - G89} (Motion modes: Canned cycles, G81 - G83 are supported)
    group 4 = {M1} (Optional stop, ignored)
    group 6 = {M6} (Tool change)
    group 7 = {G41, G42} cutter radius compensation (G40 is supported)
    group 8 = {G43} tool length offset (G43.1/G49 are supported)
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49} enable/disable feed and speed override switches
-   group 10 = {G98, G99} return mode canned cycles
    group 13 = {G61.1, G64} path control mode (G61 is supported)
 */
@@ -32,8 +32,8 @@
 // NOTE: Modal group values must be sequential and starting from zero.
 
 enum class ModalGroup : uint8_t {
-    MG0  = 0,   // [G4,G10,G28,G28.1,G30,G30.1,G53,G92,G92.1] Non-modal
-    MG1  = 1,   // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G80] Motion
+    MG0  = 0,   // [G4,G10,G28,G28.1,G30,G30.1,G50,G51,G53,G68,G69,G92,G92.1] Non-modal
+    MG1  = 1,   // [G0,G1,G2,G3,G38.2,G38.3,G38.4,G38.5,G80,G81,G82,G83] Motion
     MG2  = 2,   // [G17,G18,G19] Plane selection
     MG3  = 3,   // [G90,G91] Distance mode
     MG4  = 4,   // [G91.1] Arc IJK distance mode
@@ -41,6 +41,7 @@ enum class ModalGroup : uint8_t {
     MG6  = 6,   // [G20,G21] Units
     MG7  = 7,   // [G40] Cutter radius compensation mode. G41/42 NOT SUPPORTED.
     MG8  = 8,   // [G43.1,G49] Tool length offset
+    MG10 = 16,  // [G98,G99] Return mode canned cycles
     MG12 = 9,   // [G54,G55,G56,G57,G58,G59] Coordinate system selection
     MG13 = 10,  // [G61] Control mode
     MM4  = 11,  // [M0,M1,M2,M30] Stopping
@@ -68,7 +69,11 @@ enum class NonModal : uint8_t {
     SetHome0              = 38,   // G28.1 (Do not alter value)
     GoHome1               = 30,   // G30 (Do not alter value)
     SetHome1              = 40,   // G30.1 (Do not alter value)
+    ResetScale            = 50,   // G50 (Do not alter value)
+    SetScale              = 51,   // G51 (Do not alter value)
     AbsoluteOverride      = 53,   // G53 (Do not alter value)
+    SetRotation           = 68,   // G68 (Do not alter value)
+    ResetRotation         = 69,   // G69 (Do not alter value)
     SetCoordinateOffset   = 92,   // G92 (Do not alter value)
     ResetCoordinateOffset = 102,  //G92.1 (Do not alter value)
 };
@@ -84,6 +89,9 @@ enum class Motion : uint8_t {
     ProbeAway          = 142,  // G38.4 (Do not alter value)
     ProbeAwayNoError   = 143,  // G38.5 (Do not alter value)
     None               = 80,   // G80 (Do not alter value)
+    DrillCycle         = 81,   // G81 (Do not alter value)
+    DrillDwellCycle    = 82,   // G82 (Do not alter value)
+    PeckDrillCycle     = 83,   // G83 (Do not alter value)
 };
 
 // Modal Group G2: Plane select
@@ -132,6 +140,12 @@ enum class CutterCompensation : uint8_t {
     Enable  = 1,
 };
 
+// Modal Group G10: Return mode canned cycles
+enum class CycleReturn : uint8_t {
+    OldZ   = 0,  // G98 (Default: Must be zero)
+    RLevel = 1,  // G99
+};
+
 // Modal Group G13: Control mode
 enum class ControlMode : uint8_t {
     ExactPath = 0,  // G61 (Default: Must be zero)
@@ -269,6 +283,7 @@ typedef struct {
     // CutterCompensation cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
     ToolLengthOffset tool_length;   // {G43.1,G49}
     CoordIndex       coord_select;  // {G54,G55,G56,G57,G58,G59}
+    CycleReturn      cycle_return;  // {G98,G99}
     // uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
     ProgramFlow  program_flow;  // {M0,M1,M2,M30}
     CoolantState coolant;       // {M7,M8,M9}
@@ -292,6 +307,17 @@ typedef struct {
     float   xyz[MAX_N_AXIS];  // X,Y,Z Translational axes
 } gc_values_t;
 
+// R, depth, P and Q of the canned cycle in effect. They carry over from one G81-G83 block to the
+// next, as in LinuxCNC, in mm and as programmed: relative to the work coordinates in G90, and
+// in G91 R from the level the cycle starts at and the depth from R.
+typedef struct {
+    float    r;
+    float    depth;  // The word of the axis across the plane, Z in G17
+    float    p;      // G82 dwell (s)
+    float    q;      // G83 peck (mm)
+    uint32_t given;  // GCodeWord bits of the values above that have been programmed
+} gc_cycle_t;
+
 typedef struct {
     gc_modal_t modal;
 
@@ -306,10 +332,21 @@ typedef struct {
     // position in mm. Loaded from non-volatile storage when called.
     float coord_offset[MAX_N_AXIS];  // Retains the G92 coordinate offset (work coordinates) relative to
     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
-    float tool_length_offset;  // Tracks tool length offset value when enabled.
+    float      tool_length_offset;  // Tracks tool length offset value when enabled.
+    gc_cycle_t cycle;               // Of the G81-G83 mode in effect
+
+    float wco[MAX_N_AXIS];  // coord_system + coord_offset + tool_length_offset, kept by gc_update_wco()
+
+    gc_transform_t  transform;      // G51 and G68, see Transform.h
+    transform_map_t transform_map;  // Of program moves, kept by gc_update_transform()
 } parser_state_t;
 extern parser_state_t gc_state;
 
+// Set while the background file check runs lines, see Validate.h. The parser then changes
+// nothing outside gc_state: no stored offsets, overrides, tool changes, comment messages or
+// program end reports.
+extern bool gc_sandbox;
+
 typedef struct {
     NonModal     non_modal_command;
     gc_modal_t   modal;
@@ -324,11 +361,43 @@ enum class AxisCommand : uint8_t {
     ToolLengthOffset = 3,
 };
 
+// One g-code word, a letter and its value
+typedef struct {
+    char  letter;
+    float value;
+} gc_word_t;
+
+// Most words accepted in one block
+const int GC_MAX_WORDS = 48;
+
 // Initialize the parser
 void gc_init();
 
 // Execute one block of rs275/ngc/g-code
 Error gc_execute_line(char* line, uint8_t client);
 
+// Remove whitespace and comments in place and convert to upper case
+void collapseGCode(char* line);
+
+// Split a collapsed g-code line into words, and execute a block already split that way
+Error gc_parse_words(const char* line, gc_word_t* words, uint8_t max_words, uint8_t* n_words);
+Error gc_execute_words(const gc_word_t* words, uint8_t n_words, uint8_t client);
+
 // Set g-code parser position. Input in steps.
 void gc_sync_position();
+
+// Recomputes gc_state.wco after a change of coord_system, coord_offset or tool_length_offset,
+// and with it the transform map
+void gc_update_wco();
+
+// Recomputes gc_state.transform_map after a change of gc_state.transform or of $Job/Transform.
+// gc_state.position follows, so the machine position it stands for stays the same.
+void gc_update_transform();
+
+// gc_state.position is where the program is, before the job transform. Moves that are not
+// transformed, like jogs and G53, start from and end at a position in machine coordinates.
+void gc_get_machine_position(float* position);
+void gc_set_machine_position(const float* position);
+
+// Times n_line short G1 lines through the parser without moving, with or without the G0/G1 fast path.
+uint64_t gc_bench(uint16_t n_line, bool fast_path);
@@ -29,6 +29,8 @@
 #include "mks/MKS_I2C_Slave.h" // Add our I2C slave header
 
 void grbl_init() {
+    boot_phase_begin(BootPhase::Grbl);
+    heap_track_task();  // The loop task, which runs the protocol loop after this
 
     disableCore0WDT();
     disableCore1WDT();
@@ -38,24 +40,47 @@ void grbl_init() {
     LCD_BLK_OFF;
     
 #ifdef USE_I2S_OUT
+    boot_phase_begin(BootPhase::I2SOut);
     i2s_out_init();  // The I2S out must be initialized before it can access the expanded GPIO port
+    boot_phase_end(BootPhase::I2SOut);
 #endif
     WiFi.persistent(false);
     WiFi.disconnect(true);
     WiFi.enableSTA(false);
     WiFi.enableAP(false);
     WiFi.mode(WIFI_OFF);
+    boot_phase_begin(BootPhase::Client);
     client_init();  // Setup serial baud rate and interrupts
+    boot_phase_end(BootPhase::Client);
+    boot_phase_begin(BootPhase::Display);
     display_init();
+    boot_phase_end(BootPhase::Display);
 
 // show the map name at startup
 #ifdef MACHINE_NAME
     // report_machine_type(CLIENT_SERIAL);
 #endif
+    boot_phase_begin(BootPhase::Settings);
     settings_init();  // Load Grbl settings from non-volatile storage
+    boot_phase_end(BootPhase::Settings);
+    client_apply_settings();  // Move the serial port to its configured baud rate
+#ifdef USE_I2S_OUT
+    i2s_out_apply_settings();  // Resize the I2S DMA ring, now that its settings are loaded
+#endif
+    boot_phase_begin(BootPhase::Planner);
+    plan_init();      // Allocate the planner block buffer
+    boot_phase_end(BootPhase::Planner);
+    boot_phase_begin(BootPhase::Stepper);
     stepper_init();   // Configure stepper pins and interrupt timers
     system_ini();     // Configure pinout pins and pin-change interrupt (Renamed due to conflict with esp32 files)
+    boot_phase_end(BootPhase::Stepper);
+    boot_phase_begin(BootPhase::Motors);
     init_motors();
+    boot_phase_end(BootPhase::Motors);
+    worker_init();  // Background file work, see Worker.h
+#ifdef ENABLE_SD_CARD
+    joblog_init();
+#endif
     memset(sys_position, 0, sizeof(sys_position));  // Clear machine position.
     machine_init();                                 // weak definition in Grbl.cpp does nothing
     
@@ -86,6 +111,7 @@ void grbl_init() {
     WebUI::bt_config.begin();
 #endif
     WebUI::inputBuffer.begin();
+    boot_phase_end(BootPhase::Grbl);
 }
 
 void phy_init_reinit(void) {
@@ -131,6 +157,28 @@ void _mc_task_init(void) {
 }
 
 
+// The slow parts of startup that motion does not depend on. They used to hold up the protocol
+// loop, by up to 20 s while WiFi associated.
+static void bootTask(void* pvParameters) {
+    heap_track_task();
+    /* SD cfg updata */
+    boot_phase_begin(BootPhase::SdCard);
+    if(mks_grbl.is_test_mode != true) {
+        mks_updata_init();
+    }else {
+        mks_updata.updata_flag = UD_NONE;
+    }
+    boot_phase_end(BootPhase::SdCard);
+
+    if(mks_updata.updata_flag == UD_NO_FILE) {
+        boot_phase_begin(BootPhase::WiFi);
+        WebUI::wifi_config.mks_setup();
+        boot_phase_end(BootPhase::WiFi);
+    }
+    heap_untrack_task();
+    vTaskDelete(NULL);
+}
+
 static void reset_variables() {
     // Reset system variables.
     static bool lcd_init_status = false;
@@ -172,6 +220,7 @@ static void reset_variables() {
     }
 
     plan_reset();  // Clear block buffer and planner variables
+    mc_coalesce_reset();
     st_reset();    // Clear stepper subsystem variables
     // Sync cleared gcode and planner positions to current system position.
     plan_sync_position();
@@ -186,17 +235,14 @@ static void reset_variables() {
     if(!lcd_init_status) {
         lcd_init_status = true;
 
-        /* SD cfg updata */
-        if(mks_grbl.is_test_mode != true) {
-            mks_updata_init();
-        }else {
-            mks_updata.updata_flag = UD_NONE;
-        }
-
-        if(mks_updata.updata_flag == UD_NO_FILE) {
-            WebUI::wifi_config.mks_setup();
-        }
-        
+        xTaskCreatePinnedToCore(bootTask,  // task
+                                "bootTask",  // name for task
+                                8192,        // size of task stack
+                                NULL,        // parameters
+                                1,           // priority
+                                NULL,
+                                BOOT_TASK_CORE);
+
 #if defined(USE_BL_TOUCH)
         BLTOUCH_push_up();
         delay_ms(100);
@@ -46,7 +46,9 @@ const char* const GRBL_VERSION_BUILD = "2022042101";
 #include "Probe.h"
 #include "System.h"
 
+#include "Transform.h"
 #include "GCode.h"
+#include "OWord.h"
 #include "Planner.h"
 #include "CoolantControl.h"
 #include "Limits.h"
@@ -58,8 +60,21 @@ const char* const GRBL_VERSION_BUILD = "2022042101";
 #include "Pins.h"
 #include "Spindles/Spindle.h"
 #include "Motors/Motors.h"
+#include "InputShaper.h"
 #include "Stepper.h"
+#include "StepVerify.h"
+#include "Boot.h"
+#include "HeapStats.h"
+#include "TaskStats.h"
+#include "Trace.h"
+#include "Telemetry.h"
+#include "Simulate.h"
+#include "Validate.h"
+#include "Worker.h"
 #include "Jog.h"
+#include "Raster.h"
+#include "RasterImage.h"
+#include "HeightMap.h"
 #include "WebUI/InputBuffer.h"
 #include "Settings.h"
 #include "SettingsDefinitions.h"
@@ -71,6 +86,7 @@ const char* const GRBL_VERSION_BUILD = "2022042101";
 
 // Do not guard this because it is needed for local files too
 #include "SDCard.h"
+#include "JobLog.h"
 
 #ifdef ENABLE_BLUETOOTH
 #    include "WebUI/BTConfig.h"
@@ -0,0 +1,104 @@
+/*
+  HeapStats.cpp - Heap, stack and allocation counters, for $Heap
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+#include <esp_heap_caps.h>
+
+static const char* heap_site_names[] = {
+    "Sendf",
+    "Notify",
+    "WebCommand",
+};
+
+// Section bounds from the ESP-IDF linker script
+extern uint8_t _data_start, _data_end, _bss_start, _bss_end;
+
+static TaskHandle_t      tracked_tasks[HEAP_TRACKED_TASKS_MAX];
+static portMUX_TYPE      tracked_tasks_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t site_counts[int(HeapSite::Count)];
+
+void heap_track_task() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&tracked_tasks_mux);
+    for (int i = 0; i < HEAP_TRACKED_TASKS_MAX; i++) {
+        if (tracked_tasks[i] == task) {
+            break;
+        }
+        if (tracked_tasks[i] == NULL) {
+            tracked_tasks[i] = task;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&tracked_tasks_mux);
+}
+
+void heap_untrack_task() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&tracked_tasks_mux);
+    for (int i = 0; i < HEAP_TRACKED_TASKS_MAX; i++) {
+        if (tracked_tasks[i] == task) {
+            // Keep the list packed, so tracking stops at the first free slot
+            for (; i < HEAP_TRACKED_TASKS_MAX - 1; i++) {
+                tracked_tasks[i] = tracked_tasks[i + 1];
+            }
+            tracked_tasks[HEAP_TRACKED_TASKS_MAX - 1] = NULL;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&tracked_tasks_mux);
+}
+
+void heap_count(HeapSite site) {
+    __atomic_fetch_add(&site_counts[int(site)], 1, __ATOMIC_RELAXED);
+}
+
+void heap_report(uint8_t client) {
+    grbl_sendf(client,
+               "Heap free %u, min free %u, largest block %u\r\n",
+               heap_caps_get_free_size(MALLOC_CAP_8BIT),
+               heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+               heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    grbl_sendf(client,
+               "Internal free %u, largest block %u\r\n",
+               heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+               heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+
+    TaskHandle_t tasks[HEAP_TRACKED_TASKS_MAX];
+    portENTER_CRITICAL(&tracked_tasks_mux);
+    memcpy(tasks, tracked_tasks, sizeof(tasks));
+    portEXIT_CRITICAL(&tracked_tasks_mux);
+    for (int i = 0; i < HEAP_TRACKED_TASKS_MAX && tasks[i]; i++) {
+        // The ESP-IDF port counts the stack in bytes
+        grbl_sendf(client, "Task %-16s stack free %u\r\n", pcTaskGetTaskName(tasks[i]), uxTaskGetStackHighWaterMark(tasks[i]));
+    }
+
+    for (int i = 0; i < int(HeapSite::Count); i++) {
+        grbl_sendf(client, "Allocations %-10s %u\r\n", heap_site_names[i], site_counts[i]);
+    }
+}
+
+void mem_report(uint8_t client) {
+    uint32_t data = &_data_end - &_data_start;
+    uint32_t bss  = &_bss_end - &_bss_start;
+    grbl_sendf(client, "Static data %u, bss %u, total %u\r\n", data, bss, data + bss);
+    grbl_sendf(client,
+               "Internal heap free %u, min free %u, largest block %u\r\n",
+               heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+               heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+               heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+  HeapStats.h - Heap, stack and allocation counters, for $Heap
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Free heap alone does not show fragmentation: a job can fail with plenty of heap free when no
+// single block is large enough. $Heap reports the largest free block and the lowest free heap
+// since reset, the stack high water of the long-running tasks, and counts of the heap
+// allocations made on paths that run for every line or status report.
+
+// Code paths that fall back to the heap. Each is counted where it allocates.
+enum class HeapSite : uint8_t {
+    Sendf = 0,   // grbl_sendf() text longer than its stack buffer
+    Notify,      // grbl_notifyf() text longer than its stack buffer
+    WebCommand,  // Strings built for each /command request
+    Count,
+};
+
+const int HEAP_TRACKED_TASKS_MAX = 16;
+
+// Each long-running task registers itself when it starts, so its stack can be reported. A
+// task that deletes itself must untrack first.
+void heap_track_task();
+void heap_untrack_task();
+
+void heap_count(HeapSite site);
+
+void heap_report(uint8_t client);
+
+// $Mem: the static .data and .bss in DRAM, from the linker's section symbols, and the internal
+// heap left over. The split by subsystem is in mem_report.txt, written by ini/mem_report.py
+// from the linker map at each build.
+void mem_report(uint8_t client);
@@ -0,0 +1,251 @@
+/*
+  HeightMap.cpp - Surface height map probed on a grid
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+heightmap_t heightmap;
+
+// Reads "<float>" followed by sep from *s. Returns false on a malformed number.
+static bool heightmap_read_float(const char** s, float* value, char sep) {
+    char* end;
+    *value = strtof(*s, &end);
+    if (end == *s || *end != sep) {
+        return false;
+    }
+    *s = end + (sep ? 1 : 0);
+    return true;
+}
+
+// The cell a piece of a move is in, with its corners
+typedef struct {
+    int   ix, iy;
+    float z00, z10, z01, z11;
+} heightmap_cell_t;
+
+// Grid coordinates of a machine position, in cells from point 0,0
+static inline float heightmap_gx(float x) {
+    return (x - heightmap.x0) / heightmap.dx;
+}
+
+static inline float heightmap_gy(float y) {
+    return (y - heightmap.y0) / heightmap.dy;
+}
+
+static void heightmap_cell(heightmap_cell_t* cell, float gx, float gy) {
+    int ix = constrain(int(floorf(gx)), 0, heightmap.nx - 2);
+    int iy = constrain(int(floorf(gy)), 0, heightmap.ny - 2);
+    if (ix == cell->ix && iy == cell->iy) {
+        return;
+    }
+    const float* z = &heightmap.z[ix + iy * heightmap.nx];
+    cell->ix       = ix;
+    cell->iy       = iy;
+    cell->z00      = z[0] - heightmap.z[0];
+    cell->z10      = z[1] - heightmap.z[0];
+    cell->z01      = z[heightmap.nx] - heightmap.z[0];
+    cell->z11      = z[heightmap.nx + 1] - heightmap.z[0];
+}
+
+// Position in the cell, 0..1, clamped to the grid
+static inline float heightmap_u(const heightmap_cell_t* cell, float gx) {
+    return constrain(gx, 0.0f, heightmap.nx - 1.0f) - cell->ix;
+}
+
+static inline float heightmap_v(const heightmap_cell_t* cell, float gy) {
+    return constrain(gy, 0.0f, heightmap.ny - 1.0f) - cell->iy;
+}
+
+static inline float heightmap_twist(const heightmap_cell_t* cell) {
+    return cell->z00 - cell->z10 - cell->z01 + cell->z11;
+}
+
+static float heightmap_cell_offset(const heightmap_cell_t* cell, float u, float v) {
+    return cell->z00 + (cell->z10 - cell->z00) * u + (cell->z01 - cell->z00) * v + heightmap_twist(cell) * u * v;
+}
+
+// First t past t at which g0 + (g1 - g0) * t crosses one of the grid lines 0..n-1, or 1 if none
+static float heightmap_next_cross(float g0, float g1, float t, int n) {
+    float dg = g1 - g0;
+    if (dg == 0.0f) {
+        return 1.0f;
+    }
+    float g  = g0 + dg * t;
+    float k  = dg > 0.0f ? MAX(floorf(g) + 1.0f, 0.0f) : MIN(ceilf(g) - 1.0f, n - 1.0f);
+    float tk = (k - g0) / dg;
+    if (tk <= t + 1e-6f) {
+        k += dg > 0.0f ? 1.0f : -1.0f;  // g was rounded to just short of the line it is on
+        tk = (k - g0) / dg;
+    }
+    if (k < 0.0f || k > n - 1.0f) {
+        return 1.0f;
+    }
+    return MIN(tk, 1.0f);
+}
+
+bool heightmap_active(const plan_line_data_t* pl_data) {
+    return heightmap.valid && probe_grid_compensate->get() && !pl_data->motion.systemMotion;
+}
+
+float heightmap_offset(const float* position) {
+    if (!heightmap.valid || !probe_grid_compensate->get()) {
+        return 0.0f;
+    }
+    heightmap_cell_t cell;
+    float            gx = heightmap_gx(position[X_AXIS]);
+    float            gy = heightmap_gy(position[Y_AXIS]);
+    cell.ix             = -1;
+    heightmap_cell(&cell, gx, gy);
+    return heightmap_cell_offset(&cell, heightmap_u(&cell, gx), heightmap_v(&cell, gy));
+}
+
+// The offset is bilinear within a cell, so along a straight piece it is quadratic in the
+// distance travelled. The corners are fetched once per cell, and where the curve bows too far
+// from the piece the points between are stepped with forward differences.
+bool heightmap_line(const float* start, float* target, plan_line_data_t* pl_data, bool (*line)(float*, plan_line_data_t*)) {
+    auto  n_axis = motion_config.n_axis;
+    float from[MAX_N_AXIS], piece[MAX_N_AXIS];
+    memcpy(from, start, sizeof(from));
+    float gx0 = heightmap_gx(from[X_AXIS]), gy0 = heightmap_gy(from[Y_AXIS]);
+    float gx1 = heightmap_gx(target[X_AXIS]), gy1 = heightmap_gy(target[Y_AXIS]);
+
+    heightmap_cell_t cell;
+    cell.ix = -1;
+    heightmap_cell(&cell, gx0, gy0);
+    from[Z_AXIS] -= heightmap_cell_offset(&cell, heightmap_u(&cell, gx0), heightmap_v(&cell, gy0));
+    if (pl_data->motion.inverseTime) {
+        // The time is for the whole move, as mc_arc() does for its segments
+        float mm_sq = 0.0f;
+        for (uint8_t idx = 0; idx < n_axis; idx++) {
+            mm_sq += (target[idx] - from[idx]) * (target[idx] - from[idx]);
+        }
+        pl_data->feed_rate *= sqrtf(mm_sq);
+        pl_data->motion.inverseTime = 0;
+    }
+
+    memcpy(piece, from, sizeof(piece));
+    bool  submitted = false;
+    float t         = 0.0f;
+    while (t < 1.0f) {
+        float t1 = MIN(heightmap_next_cross(gx0, gx1, t, heightmap.nx), heightmap_next_cross(gy0, gy1, t, heightmap.ny));
+        float tm = 0.5f * (t + t1);
+        heightmap_cell(&cell, gx0 + (gx1 - gx0) * tm, gy0 + (gy1 - gy0) * tm);
+        float u0 = heightmap_u(&cell, gx0 + (gx1 - gx0) * t), v0 = heightmap_v(&cell, gy0 + (gy1 - gy0) * t);
+        float u1 = heightmap_u(&cell, gx0 + (gx1 - gx0) * t1), v1 = heightmap_v(&cell, gy0 + (gy1 - gy0) * t1);
+        float off0 = heightmap_cell_offset(&cell, u0, v0);
+        float off1 = heightmap_cell_offset(&cell, u1, v1);
+        float q    = heightmap_twist(&cell) * (u1 - u0) * (v1 - v0);  // s^2 term over the piece
+        int   n    = 1;
+        if (fabsf(q) > 4.0f * HEIGHTMAP_TOLERANCE) {
+            n = MIN(int(ceilf(sqrtf(fabsf(q) / (4.0f * HEIGHTMAP_TOLERANCE)))), HEIGHTMAP_MAX_SPLIT);
+        }
+        float h   = 1.0f / n;
+        float off = off0;
+        float d1  = (off1 - off0 - q) * h + q * h * h;
+        float d2  = 2.0f * q * h * h;
+        for (int i = 1; i <= n; i++) {
+            off += d1;
+            d1 += d2;
+            if (i == n && t1 >= 1.0f) {
+                memcpy(piece, target, sizeof(piece));
+            } else {
+                float s = (i == n) ? t1 : t + (t1 - t) * i * h;
+                for (uint8_t idx = 0; idx < n_axis; idx++) {
+                    piece[idx] = from[idx] + (target[idx] - from[idx]) * s;
+                }
+            }
+            piece[Z_AXIS] += (i == n) ? off1 : off;
+            submitted = line(piece, pl_data);
+            if (!submitted || sys.abort) {
+                return submitted;  // A cancelled jog drops the rest
+            }
+        }
+        t = t1;
+    }
+    return submitted;
+}
+
+static void heightmap_report(uint8_t client) {
+    if (!heightmap.valid) {
+        grbl_sendf(client, "[MSG:No height map]\r\n");
+        return;
+    }
+    grbl_sendf(client,
+               "[MAP:%d,%d,%.3f,%.3f,%.3f,%.3f]\r\n",
+               heightmap.nx,
+               heightmap.ny,
+               heightmap.x0,
+               heightmap.y0,
+               heightmap.dx,
+               heightmap.dy);
+    // One row per line, as Z relative to point 0,0
+    for (int iy = 0; iy < heightmap.ny; iy++) {
+        char line[HEIGHTMAP_MAX_POINTS * 10 + 8];
+        int  len = sprintf(line, "[MAP%d:", iy);
+        for (int ix = 0; ix < heightmap.nx; ix++) {
+            len += sprintf(line + len, ix ? ",%.3f" : "%.3f", heightmap.z[ix + iy * heightmap.nx] - heightmap.z[0]);
+        }
+        grbl_sendf(client, "%s]\r\n", line);
+    }
+}
+
+Error heightmap_probe(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value == NULL) {
+        heightmap_report(out->client());
+        return Error::Ok;
+    }
+    if (sys.state != State::Idle) {
+        return sys.state == State::Alarm ? Error::SystemGcLock : Error::IdleError;
+    }
+    float       width, height, nx, ny;
+    const char* s = value;
+    if (!heightmap_read_float(&s, &width, ',') || !heightmap_read_float(&s, &height, ',') || !heightmap_read_float(&s, &nx, ',') ||
+        !heightmap_read_float(&s, &ny, '\0')) {
+        return Error::BadNumberFormat;
+    }
+    if (nx < 2 || ny < 2 || nx > HEIGHTMAP_MAX_POINTS || ny > HEIGHTMAP_MAX_POINTS || nx != int(nx) || ny != int(ny)) {
+        return Error::NumberRange;
+    }
+    if (width <= 0.0f || height <= 0.0f) {
+        return Error::NegativeValue;
+    }
+    if (PROBE_PIN == UNDEFINED_PIN) {
+        return Error::SettingDisabled;
+    }
+
+    float position[MAX_N_AXIS];
+    gc_get_machine_position(position);  // The grid is in machine coordinates, as heightmap_offset() reads it
+    heightmap.valid = false;
+    heightmap.nx    = nx;
+    heightmap.ny    = ny;
+    heightmap.x0    = position[X_AXIS];
+    heightmap.y0    = position[Y_AXIS];
+    heightmap.dx    = width / (heightmap.nx - 1);
+    heightmap.dy    = height / (heightmap.ny - 1);
+    uint32_t start  = millis();
+    if (mc_probe_grid(&heightmap)) {
+        heightmap.valid = true;
+        grbl_msg_sendf(out->client(), MsgLevel::Info, "Probed %d points in %.1f s", heightmap.nx * heightmap.ny, (millis() - start) / 1000.0f);
+        heightmap_report(out->client());
+    }
+    return Error::Ok;
+}
+
+Error heightmap_clear(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    heightmap.valid = false;
+    return Error::Ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/*
+  HeightMap.h - Surface height map probed on a grid
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// The whole grid is probed by one command instead of a G38.2 per point from the sender:
+//
+//   $Probe/Grid=<width>,<height>,<nx>,<ny>
+//
+// probes nx by ny points over width by height mm in +X and +Y from the current XY. The current
+// Z is the safe height, and no point is probed deeper than $Probe/Grid/Depth below it. Each
+// point is a seek at $Probe/Grid/SeekRate, then a back-off of $Probe/Grid/Backoff and a latch
+// at $Probe/Grid/LatchRate. From one point to the next the probe lifts $Probe/Grid/Clearance
+// above the last contact, moves over and seeks again as one planned motion, without a stop.
+// A point higher than that is found from the safe height instead. The map is kept in RAM and
+// reported by $Probe/Grid without a value; $Probe/Grid/Clear drops it.
+//
+// With $Probe/Grid/Compensate set, mc_line() follows the map: each move is split where it
+// crosses a grid line, and the map's height relative to point 0,0, bilinear within the cell,
+// is added to Z. Outside the grid the edge cells carry on flat. The g-code position and $#
+// stay uncompensated, and MPos is the machine's. Only for machines without kinematics.
+const int HEIGHTMAP_MAX_POINTS = 32;  // Per axis
+
+// Along a line the bilinear surface bends away from the straight piece by up to this many mm
+// before the piece is split further, to at most HEIGHTMAP_MAX_SPLIT parts per cell
+const float HEIGHTMAP_TOLERANCE = 0.005f;
+const int   HEIGHTMAP_MAX_SPLIT = 8;
+
+typedef struct {
+    float   x0, y0;  // Machine position of point 0,0
+    float   dx, dy;  // Spacing, mm
+    uint8_t nx, ny;
+    bool    valid;
+    float   z[HEIGHTMAP_MAX_POINTS * HEIGHTMAP_MAX_POINTS];  // Machine Z of each contact, at ix + iy * nx
+} heightmap_t;
+
+extern heightmap_t heightmap;
+
+// The probing cycle, in MotionControl.cpp. Fills in the Z values of map's grid.
+bool mc_probe_grid(heightmap_t* map);
+
+// Compensation. heightmap_line() plans start..target through line() piece by piece; start is
+// where the planner is, offset included.
+bool  heightmap_active(const plan_line_data_t* pl_data);
+bool  heightmap_line(const float* start, float* target, plan_line_data_t* pl_data, bool (*line)(float*, plan_line_data_t*));
+float heightmap_offset(const float* position);  // Added to Z at position's XY, 0 while compensation is off
+
+Error heightmap_probe(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out);
+Error heightmap_clear(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out);
@@ -56,6 +56,7 @@
 #include <rom/lldesc.h>
 #include <soc/i2s_struct.h>
 #include <freertos/queue.h>
+#include <esp_ipc.h>
 
 #include <stdatomic.h>
 
@@ -73,17 +74,27 @@
 //   = 2000 / 4 x 4
 //   = 2000us = 2ms
 // If I2S_OUT_DMABUF_COUNT is 5, it will take about 10 ms for all the DMA buffer transfers to finish.
+// A shorter sample length plays the same buffer out proportionally faster.
 //
 // Increasing I2S_OUT_DMABUF_COUNT has the effect of preventing buffer underflow,
 // but on the other hand, it leads to a delay with pulse and/or non-pulse-generated I/Os.
 // The number of I2S_OUT_DMABUF_COUNT should be chosen carefully.
+// The count and length are only the boot values; $I2SO/Profile resizes the ring at run time.
 //
 // Reference information:
 //   FreeRTOS task time slice = portTICK_PERIOD_MS = 1 ms (ESP32 FreeRTOS port)
 //
 const int I2S_SAMPLE_SIZE   = 4;                                    /* 4 bytes, 32 bits per sample */
-const int DMA_SAMPLE_COUNT  = I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE; /* number of samples per buffer */
-const int SAMPLE_SAFE_COUNT = (20 / I2S_OUT_USEC_PER_PULSE);        /* prevent buffer overrun (GRBL's $0 should be less than or equal 20) */
+
+// Current sample length, see i2s_out_set_usec_per_pulse()
+static uint32_t i2s_out_usec_per_pulse = I2S_OUT_USEC_PER_PULSE;
+static uint32_t sample_safe_count      = (20 / I2S_OUT_USEC_PER_PULSE); /* prevent buffer overrun (GRBL's $0 should be less than or equal 20) */
+
+// Current DMA ring, see i2s_out_set_dma_profile()
+static uint32_t          dma_buf_count    = I2S_OUT_DMABUF_COUNT;
+static uint32_t          dma_buf_len      = I2S_OUT_DMABUF_LEN;
+static uint32_t          dma_sample_count = I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE; /* number of samples per buffer */
+static volatile uint32_t i2s_out_underruns;
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
 typedef struct {
@@ -91,7 +102,7 @@ typedef struct {
     uint32_t*    current;
     uint32_t     rw_pos;
     lldesc_t**   desc;
-    xQueueHandle queue;
+    xQueueHandle queue;  // Sized for I2S_OUT_DMABUF_COUNT_MAX, so it outlives a resize
 } i2s_out_dma_t;
 
 static i2s_out_dma_t o_dma;
@@ -128,6 +139,7 @@ static int i2s_out_initialized = 0;
 static volatile uint32_t             i2s_out_pulse_period;
 static uint32_t                      i2s_out_remain_time_until_next_pulse;  // Time remaining until the next pulse (μsec)
 static volatile i2s_out_pulse_func_t i2s_out_pulse_func;
+static volatile i2s_out_block_func_t i2s_out_block_func;
 #endif
 
 static uint8_t i2s_out_ws_pin   = 255;
@@ -195,32 +207,86 @@ static void IRAM_ATTR i2s_out_reset_fifo() {
 #ifdef USE_I2S_OUT_STREAM_IMPL
 static int IRAM_ATTR i2s_clear_dma_buffer(lldesc_t* dma_desc, uint32_t port_data) {
     uint32_t* buf = (uint32_t*)dma_desc->buf;
-    for (int i = 0; i < DMA_SAMPLE_COUNT; i++) {
+    for (int i = 0; i < dma_sample_count; i++) {
         buf[i] = port_data;
     }
     // Restore the buffer length.
     // The length may have been changed short when the data was filled in to prevent buffer overrun.
-    dma_desc->length = I2S_OUT_DMABUF_LEN;
+    dma_desc->length = dma_buf_len;
     return 0;
 }
 
 static int IRAM_ATTR i2s_clear_o_dma_buffers(uint32_t port_data) {
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
+    for (int buf_idx = 0; buf_idx < dma_buf_count; buf_idx++) {
         // Initialize DMA descriptor
         o_dma.desc[buf_idx]->owner        = 1;
         o_dma.desc[buf_idx]->eof          = 1;  // set to 1 will trigger the interrupt
         o_dma.desc[buf_idx]->sosf         = 0;
-        o_dma.desc[buf_idx]->length       = I2S_OUT_DMABUF_LEN;
-        o_dma.desc[buf_idx]->size         = I2S_OUT_DMABUF_LEN;
+        o_dma.desc[buf_idx]->length       = dma_buf_len;
+        o_dma.desc[buf_idx]->size         = dma_buf_len;
         o_dma.desc[buf_idx]->buf          = (uint8_t*)o_dma.buffers[buf_idx];
         o_dma.desc[buf_idx]->offset       = 0;
-        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (I2S_OUT_DMABUF_COUNT - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
+        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (dma_buf_count - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
         i2s_clear_dma_buffer(o_dma.desc[buf_idx], port_data);
     }
     return 0;
 }
 #endif
 
+static uint32_t i2s_out_get_dmabuf_ms() {
+    // One buffer is never less than a tick of wait, even when it plays out in under 1 ms
+    uint32_t usec = dma_sample_count * i2s_out_usec_per_pulse;
+    return usec < 1000 ? 1 : (usec + 999) / 1000;
+}
+
+uint32_t i2s_out_get_delay_ms() {
+    return (dma_sample_count * i2s_out_usec_per_pulse * (dma_buf_count + 1) + 999) / 1000;
+}
+
+void i2s_out_get_dma_info(uint32_t* count, uint32_t* len, uint32_t* underruns) {
+    *count     = dma_buf_count;
+    *len       = dma_buf_len;
+    *underruns = i2s_out_underruns;
+}
+
+#ifdef USE_I2S_OUT_STREAM_IMPL
+static void i2s_out_free_dma(uint32_t count, uint32_t** buffers, lldesc_t** desc) {
+    for (int buf_idx = 0; buf_idx < count; buf_idx++) {
+        if (buffers) {
+            free(buffers[buf_idx]);
+        }
+        if (desc) {
+            free(desc[buf_idx]);
+        }
+    }
+    free(buffers);
+    free(desc);
+}
+
+// Allocates count DMA buffers of len bytes and their descriptors. On failure nothing is
+// left allocated.
+static int i2s_out_alloc_dma(uint32_t count, uint32_t len, uint32_t*** buffers, lldesc_t*** desc) {
+    // Allocate the array of pointers to the buffers and the array of DMA descriptors
+    *buffers = (uint32_t**)calloc(count, sizeof(uint32_t*));
+    *desc    = (lldesc_t**)calloc(count, sizeof(lldesc_t*));
+    if (*buffers == nullptr || *desc == nullptr) {
+        i2s_out_free_dma(0, *buffers, *desc);
+        return -1;
+    }
+
+    // Allocate each buffer and descriptor so that they can be used by the DMA controller
+    for (int buf_idx = 0; buf_idx < count; buf_idx++) {
+        (*buffers)[buf_idx] = (uint32_t*)heap_caps_calloc(1, len, MALLOC_CAP_DMA);
+        (*desc)[buf_idx]    = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
+        if ((*buffers)[buf_idx] == nullptr || (*desc)[buf_idx] == nullptr) {
+            i2s_out_free_dma(count, *buffers, *desc);
+            return -1;
+        }
+    }
+    return 0;
+}
+#endif
+
 static int IRAM_ATTR i2s_out_gpio_attach(uint8_t ws, uint8_t bck, uint8_t data) {
     // Route the i2s pins to the appropriate GPIO
     gpio_matrix_out_check(data, I2S0O_DATA_OUT23_IDX, 0, 0);
@@ -250,6 +316,26 @@ static int IRAM_ATTR i2s_out_gpio_shiftout(uint32_t port_data) {
     return 0;
 }
 
+// Set the clock for a sample (one stereo frame) of usec microseconds
+//   fi2s = 160 MHz / (N + b/a)
+//   fbck = fi2s / M, M = 2
+//   usec = 2 x I2S_OUT_NUM_BITS / fbck
+// so N + b/a = 160 x usec / (4 x I2S_OUT_NUM_BITS), kept here in quarters:
+//   32-bit: 4 usec -> N = 5, 2 usec -> N = 2 + 2/4
+//   16-bit: 4 usec -> N = 10, 2 usec -> N = 5, 1 usec -> N = 2 + 2/4
+static void i2s_out_set_clock(uint32_t usec) {
+    uint32_t div_quarters = 160 * usec / I2S_OUT_NUM_BITS;
+
+    I2S0.clkm_conf.clka_en      = 0;                 // Use 160 MHz PLL_D2_CLK as reference
+    I2S0.clkm_conf.clkm_div_num = div_quarters / 4;  // minimum value of 2, reset value of 4, max 256 (I²S clock divider’s integral value)
+    I2S0.clkm_conf.clkm_div_b   = div_quarters % 4;  // 0 at reset
+    I2S0.clkm_conf.clkm_div_a   = (div_quarters % 4) ? 4 : 0;  // 0 at reset, not used while b is 0
+
+    // Bit clock configuration bit in transmitter mode.
+    I2S0.sample_rate_conf.tx_bck_div_num = 2;  // minimum value of 2 defaults to 6
+    I2S0.sample_rate_conf.rx_bck_div_num = 2;
+}
+
 static int IRAM_ATTR i2s_out_stop() {
     I2S_OUT_ENTER_CRITICAL();
 #ifdef USE_I2S_OUT_STREAM_IMPL
@@ -369,9 +455,29 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
         // and the pulse generation is postponed until the next buffer is filled.
         //
         o_dma.rw_pos = 0;
-        while (o_dma.rw_pos < (DMA_SAMPLE_COUNT - SAMPLE_SAFE_COUNT)) {
+        if (i2s_out_block_func != NULL) {
+            // The block callback keeps its own step timing and stops short of a pulse that would not fit.
+            I2S_OUT_PULSER_EXIT_CRITICAL();  // Temporarily unlocked status lock as it may be locked in block callback.
+            o_dma.rw_pos = (*i2s_out_block_func)(buf, dma_sample_count);
+            I2S_OUT_PULSER_ENTER_CRITICAL();  // Lock again.
+            if (i2s_out_pulser_status == WAITING) {
+                // i2s_out_set_passthrough() has called from the block function.
+                // Hold the port state for the rest of the buffer and make it the tail of the chain.
+                uint32_t port_data = atomic_load(&i2s_out_port_data);
+                while (o_dma.rw_pos < dma_sample_count) {
+                    buf[o_dma.rw_pos++] = port_data;
+                }
+                dma_desc->qe.stqe_next = NULL;
+            } else if (i2s_out_pulser_status == PASSTHROUGH) {
+                // i2s_out_reset() has called during the execution of the block function.
+                o_dma.rw_pos = dma_sample_count;
+            }
+            dma_desc->length = o_dma.rw_pos * I2S_SAMPLE_SIZE;
+            return 0;
+        }
+        while (o_dma.rw_pos < (dma_sample_count - sample_safe_count)) {
             // no data to read (buffer empty)
-            if (i2s_out_remain_time_until_next_pulse < I2S_OUT_USEC_PER_PULSE) {
+            if (i2s_out_remain_time_until_next_pulse < i2s_out_usec_per_pulse) {
                 // pulser status may change in pulse phase func, so I need to check it every time.
                 if (i2s_out_pulser_status == STEPPING) {
                     // fillout future DMA buffer (tail of the DMA buffer chains)
@@ -381,7 +487,7 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
                         (*i2s_out_pulse_func)();          // should be pushed into buffer max DMA_SAMPLE_SAFE_COUNT
                         I2S_OUT_PULSER_ENTER_CRITICAL();  // Lock again.
                         // Calculate pulse period.
-                        i2s_out_remain_time_until_next_pulse += i2s_out_pulse_period - I2S_OUT_USEC_PER_PULSE * (o_dma.rw_pos - old_rw_pos);
+                        i2s_out_remain_time_until_next_pulse += i2s_out_pulse_period - i2s_out_usec_per_pulse * (o_dma.rw_pos - old_rw_pos);
                         if (i2s_out_pulser_status == WAITING) {
                             // i2s_out_set_passthrough() has called from the pulse function.
                             // It needs to go into pass-through mode.
@@ -393,7 +499,7 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
                             // To prevent the pulse function from being called back,
                             // we assume that the buffer is already full.
                             i2s_out_remain_time_until_next_pulse = 0;                 // There is no need to fill the current buffer.
-                            o_dma.rw_pos                         = DMA_SAMPLE_COUNT;  // The buffer is full.
+                            o_dma.rw_pos                         = dma_sample_count;  // The buffer is full.
                             break;
                         }
                         continue;
@@ -402,8 +508,8 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
             }
             // no pulse data in push buffer (pulse off or idle or callback is not defined)
             buf[o_dma.rw_pos++] = atomic_load(&i2s_out_port_data);
-            if (i2s_out_remain_time_until_next_pulse >= I2S_OUT_USEC_PER_PULSE) {
-                i2s_out_remain_time_until_next_pulse -= I2S_OUT_USEC_PER_PULSE;
+            if (i2s_out_remain_time_until_next_pulse >= i2s_out_usec_per_pulse) {
+                i2s_out_remain_time_until_next_pulse -= i2s_out_usec_per_pulse;
             }
         }
         // set filled length to the DMA descriptor
@@ -447,7 +553,7 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
 
         // If the queue is full it's because we have an underflow,
         // more than buf_count isr without new data, remove the front buffer
-        if (xQueueIsQueueFullFromISR(o_dma.queue)) {
+        if (uxQueueMessagesWaitingFromISR(o_dma.queue) >= dma_buf_count) {
             lldesc_t* front_desc;
             // Remove a descriptor from the DMA complete event queue
             xQueueReceiveFromISR(o_dma.queue, &front_desc, &high_priority_task_awoken);
@@ -455,12 +561,13 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
             uint32_t port_data = 0;
             if (i2s_out_pulser_status == STEPPING) {
                 port_data = atomic_load(&i2s_out_port_data);
+                i2s_out_underruns++;  // Steps in that buffer are lost, so this is worth knowing about
             }
             I2S_OUT_PULSER_EXIT_CRITICAL_ISR();
-            for (int i = 0; i < DMA_SAMPLE_COUNT; i++) {
+            for (int i = 0; i < dma_sample_count; i++) {
                 front_desc->buf[i] = port_data;
             }
-            front_desc->length = I2S_OUT_DMABUF_LEN;
+            front_desc->length = dma_buf_len;
         }
 
         // Send a DMA complete event to the I2S bitstreamer task with finished buffer
@@ -475,11 +582,17 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
     I2S0.int_clr.val = I2S0.int_st.val;  //clear pending interrupt
 }
 
+// Called on STEPPER_ISR_CORE, like the allocation of the step timer interrupts
+static void i2s_out_isr_alloc(void* arg) {
+    esp_intr_alloc(ETS_I2S0_INTR_SOURCE, STEPPER_ISR_FLAGS, i2s_out_intr_handler, nullptr, &i2s_out_isr_handle);
+}
+
 //
 // I2S bitstream generator task
 //
-static void IRAM_ATTR i2sOutTask(void* parameter) {
+static void i2sOutTask(void* parameter) {
     lldesc_t* dma_desc;
+    heap_track_task();
     while (1) {
         // Wait a DMA complete event from I2S isr
         // (Block until a DMA transfer has complete)
@@ -537,31 +650,34 @@ static void IRAM_ATTR i2sOutTask(void* parameter) {
 //
 // External funtions
 //
-void IRAM_ATTR i2s_out_delay() {
+void i2s_out_delay() {
 #ifdef USE_I2S_OUT_STREAM_IMPL
     I2S_OUT_PULSER_ENTER_CRITICAL();
     if (i2s_out_pulser_status == PASSTHROUGH) {
         // Depending on the timing, it may not be reflected immediately,
         // so wait twice as long just in case.
-        ets_delay_us(I2S_OUT_USEC_PER_PULSE * 2);
+        ets_delay_us(i2s_out_usec_per_pulse * 2);
     } else {
         // Just wait until the data now registered in the DMA descripter
         // is reflected in the I2S TX module via FIFO.
-        delay(I2S_OUT_DELAY_MS);
+        delay(i2s_out_get_delay_ms());
     }
     I2S_OUT_PULSER_EXIT_CRITICAL();
 #else
-    ets_delay_us(I2S_OUT_USEC_PER_PULSE * 2);
+    ets_delay_us(i2s_out_usec_per_pulse * 2);
 #endif
 }
 
 void IRAM_ATTR i2s_out_write(uint8_t pin, uint8_t val) {
     uint32_t bit = bit(pin);
-    if (val) {
-        atomic_fetch_or(&i2s_out_port_data, bit);
-    } else {
-        atomic_fetch_and(&i2s_out_port_data, ~bit);
-    }
+    i2s_out_write_mask(val ? bit : 0, val ? 0 : bit);
+}
+
+// One compare-and-swap for the whole word, so the DMA fill and the static output never see
+// some of the bits of an event changed and others not
+void IRAM_ATTR i2s_out_write_mask(uint32_t set, uint32_t clear) {
+    uint_least32_t port_data = atomic_load(&i2s_out_port_data);
+    while (!atomic_compare_exchange_weak(&i2s_out_port_data, &port_data, (port_data & ~clear) | set)) {}
 #ifdef USE_I2S_OUT_STREAM_IMPL
     // It needs a lock for access, but I've given up because I need speed.
     // This is not a problem as long as there is no overlap between the status change and digitalWrite().
@@ -579,10 +695,10 @@ uint8_t IRAM_ATTR i2s_out_read(uint8_t pin) {
 }
 
 uint32_t IRAM_ATTR i2s_out_push_sample(uint32_t usec) {
-    uint32_t num = usec / I2S_OUT_USEC_PER_PULSE;
+    uint32_t num = usec / i2s_out_usec_per_pulse;
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
-    if (num > SAMPLE_SAFE_COUNT) {
+    if (num > sample_safe_count) {
         return 0;
     }
     // push at least one sample, even if num is zero)
@@ -639,7 +755,7 @@ int IRAM_ATTR i2s_out_set_stepping() {
         // Wait for complete DMAs
         for (;;) {
             I2S_OUT_PULSER_EXIT_CRITICAL();
-            delay(I2S_OUT_DELAY_DMABUF_MS);
+            delay(i2s_out_get_dmabuf_ms());
             I2S_OUT_PULSER_ENTER_CRITICAL();
             if (i2s_out_pulser_status == WAITING) {
                 continue;
@@ -685,7 +801,109 @@ int IRAM_ATTR i2s_out_set_pulse_callback(i2s_out_pulse_func_t func) {
     return 0;
 }
 
-int IRAM_ATTR i2s_out_reset() {
+int IRAM_ATTR i2s_out_set_block_callback(i2s_out_block_func_t func) {
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    i2s_out_block_func = func;
+#endif
+    return 0;
+}
+
+uint32_t IRAM_ATTR i2s_out_get_port_data() {
+    return atomic_load(&i2s_out_port_data);
+}
+
+int i2s_out_set_usec_per_pulse(uint32_t usec) {
+    if (usec < I2S_OUT_USEC_PER_PULSE_MIN || usec > I2S_OUT_USEC_PER_PULSE || (usec & (usec - 1)) != 0) {
+        return -1;
+    }
+    if (usec == i2s_out_usec_per_pulse) {
+        return 0;
+    }
+    if (i2s_out_initialized) {
+        if (i2s_out_get_pulser_status() != PASSTHROUGH) {
+            return -1;
+        }
+        i2s_out_stop();
+    }
+    I2S_OUT_PULSER_ENTER_CRITICAL();
+    i2s_out_usec_per_pulse = usec;
+    sample_safe_count      = 20 / usec;
+    if (i2s_out_initialized) {
+        i2s_out_set_clock(usec);
+        i2s_out_start();
+    }
+    I2S_OUT_PULSER_EXIT_CRITICAL();
+    return 0;
+}
+
+uint32_t IRAM_ATTR i2s_out_get_usec_per_pulse() {
+    return i2s_out_usec_per_pulse;
+}
+
+int i2s_out_set_dma_profile(I2SOutProfile profile, uint32_t count, uint32_t len) {
+    switch (profile) {
+        case I2SOutProfile::Default:
+            count = I2S_OUT_DMABUF_COUNT;
+            len   = I2S_OUT_DMABUF_LEN;
+            break;
+        case I2SOutProfile::LowLatency:
+            count = 2;
+            len   = 400;  // 0.4 ms per buffer
+            break;
+        case I2SOutProfile::Throughput:
+            count = 6;
+            len   = 2000;  // 2 ms per buffer
+            break;
+        case I2SOutProfile::Custom: break;
+    }
+    count = constrain(count, I2S_OUT_DMABUF_COUNT_MIN, I2S_OUT_DMABUF_COUNT_MAX);
+    len   = constrain(len, I2S_OUT_DMABUF_LEN_MIN, I2S_OUT_DMABUF_LEN_MAX) & ~(I2S_SAMPLE_SIZE - 1);
+    if (count == dma_buf_count && len == dma_buf_len) {
+        return 0;
+    }
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    if (!i2s_out_initialized) {
+        // Not allocated yet, so i2s_out_init() will use the new size
+        dma_buf_count    = count;
+        dma_buf_len      = len;
+        dma_sample_count = len / I2S_SAMPLE_SIZE;
+        return 0;
+    }
+    uint32_t** new_buffers;
+    lldesc_t** new_desc;
+    if (i2s_out_get_pulser_status() != PASSTHROUGH || i2s_out_alloc_dma(count, len, &new_buffers, &new_desc) != 0) {
+        return -1;
+    }
+    // Stop the DMA, then give i2sOutTask() time to finish with any buffer it was handed
+    i2s_out_stop();
+    delay(i2s_out_get_dmabuf_ms());
+    xQueueReset(o_dma.queue);
+
+    I2S_OUT_PULSER_ENTER_CRITICAL();
+    uint32_t** old_buffers = o_dma.buffers;
+    lldesc_t** old_desc    = o_dma.desc;
+    uint32_t   old_count   = dma_buf_count;
+    o_dma.buffers          = new_buffers;
+    o_dma.desc             = new_desc;
+    dma_buf_count          = count;
+    dma_buf_len            = len;
+    dma_sample_count       = len / I2S_SAMPLE_SIZE;
+    o_dma.rw_pos           = 0;
+    o_dma.current          = NULL;
+    i2s_clear_o_dma_buffers(0);
+    i2s_out_start();
+    I2S_OUT_PULSER_EXIT_CRITICAL();
+
+    i2s_out_free_dma(old_count, old_buffers, old_desc);
+#else
+    dma_buf_count    = count;
+    dma_buf_len      = len;
+    dma_sample_count = len / I2S_SAMPLE_SIZE;
+#endif
+    return 0;
+}
+
+int i2s_out_reset() {
     I2S_OUT_PULSER_ENTER_CRITICAL();
     i2s_out_stop();
 #ifdef USE_I2S_OUT_STREAM_IMPL
@@ -707,7 +925,7 @@ int IRAM_ATTR i2s_out_reset() {
 //
 // Initialize funtion (external function)
 //
-int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
+int i2s_out_init(i2s_out_init_t& init_param) {
     if (i2s_out_initialized) {
         // already initialized
         return -1;
@@ -748,39 +966,15 @@ int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
    */
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
-    // Allocate the array of pointers to the buffers
-    o_dma.buffers = (uint32_t**)malloc(sizeof(uint32_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.buffers == nullptr) {
-        return -1;
-    }
-
-    // Allocate each buffer that can be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.buffers[buf_idx] = (uint32_t*)heap_caps_calloc(1, I2S_OUT_DMABUF_LEN, MALLOC_CAP_DMA);
-        if (o_dma.buffers[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
-    // Allocate the array of DMA descriptors
-    o_dma.desc = (lldesc_t**)malloc(sizeof(lldesc_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.desc == nullptr) {
+    if (i2s_out_alloc_dma(dma_buf_count, dma_buf_len, &o_dma.buffers, &o_dma.desc) != 0) {
         return -1;
     }
 
-    // Allocate each DMA descriptor that will be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.desc[buf_idx] = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
-        if (o_dma.desc[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
     // Initialize
     i2s_clear_o_dma_buffers(init_param.init_val);
     o_dma.rw_pos  = 0;
     o_dma.current = NULL;
-    o_dma.queue   = xQueueCreate(I2S_OUT_DMABUF_COUNT, sizeof(uint32_t*));
+    o_dma.queue   = xQueueCreate(I2S_OUT_DMABUF_COUNT_MAX, sizeof(uint32_t*));
 
     // Set the first DMA descriptor
     I2S0.out_link.addr = (uint32_t)o_dma.desc[0];
@@ -887,25 +1081,7 @@ int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
     //
     // i2s_set_clk
     //
-
-    // set clock (fi2s) 160MHz / 5
-    I2S0.clkm_conf.clka_en = 0;  // Use 160 MHz PLL_D2_CLK as reference
-                                 // N + b/a = 0
-#if I2S_OUT_NUM_BITS == 16
-    // N = 10
-    I2S0.clkm_conf.clkm_div_num = 10;  // minimum value of 2, reset value of 4, max 256 (I²S clock divider’s integral value)
-#else
-    // N = 5
-    I2S0.clkm_conf.clkm_div_num = 5;  // minimum value of 2, reset value of 4, max 256 (I²S clock divider’s integral value)
-#endif
-    // b/a = 0
-    I2S0.clkm_conf.clkm_div_b = 0;  // 0 at reset
-    I2S0.clkm_conf.clkm_div_a = 0;  // 0 at reset, what about divide by 0? (not an issue)
-
-    // Bit clock configuration bit in transmitter mode.
-    // fbck = fi2s / tx_bck_div_num = (160 MHz / 5) / 2 = 16 MHz
-    I2S0.sample_rate_conf.tx_bck_div_num = 2;  // minimum value of 2 defaults to 6
-    I2S0.sample_rate_conf.rx_bck_div_num = 2;
+    i2s_out_set_clock(i2s_out_usec_per_pulse);
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
     // Enable TX interrupts (DMA Interrupts)
@@ -929,7 +1105,7 @@ int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
     );
 
     // Allocate and Enable the I2S interrupt
-    esp_intr_alloc(ETS_I2S0_INTR_SOURCE, 0, i2s_out_intr_handler, nullptr, &i2s_out_isr_handle);
+    esp_ipc_call_blocking(STEPPER_ISR_CORE, i2s_out_isr_alloc, NULL);
     esp_intr_enable(i2s_out_isr_handle);
 #endif
 
@@ -962,7 +1138,7 @@ int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
 
   return -1 ... already initialized
 */
-int IRAM_ATTR i2s_out_init() {
+int i2s_out_init() {
     i2s_out_init_t default_param = {
         .ws_pin       = I2S_OUT_WS,
         .bck_pin      = I2S_OUT_BCK,
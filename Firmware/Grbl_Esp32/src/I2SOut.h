@@ -56,19 +56,39 @@
 
 /* 16-bit mode: 1000000 usec / ((160000000 Hz) / 10 / 2) x 16 bit/pulse x 2(stereo) = 4 usec/pulse */
 /* 32-bit mode: 1000000 usec / ((160000000 Hz) /  5 / 2) x 32 bit/pulse x 2(stereo) = 4 usec/pulse */
-// const int I2S_OUT_USEC_PER_PULSE = 4;
+// This is the boot value and the longest sample; i2s_out_set_usec_per_pulse() shortens it
+// to 2 or 1 usec by raising the bit clock.
 const int I2S_OUT_USEC_PER_PULSE = 4;
+#if I2S_OUT_NUM_BITS == 16
+const int I2S_OUT_USEC_PER_PULSE_MIN = 1;
+#else
+const int I2S_OUT_USEC_PER_PULSE_MIN = 2; /* 1 usec would need a 64 MHz bit clock, beyond 160 MHz / 2 / 2 */
+#endif
 
+// The DMA buffer ring starts out as I2S_OUT_DMABUF_COUNT buffers of I2S_OUT_DMABUF_LEN bytes
+// and can be resized with i2s_out_set_dma_profile() while no steps are being streamed.
 const int I2S_OUT_DMABUF_COUNT = 2;
-// const int I2S_OUT_DMABUF_COUNT = 5;    /* number of DMA buffers to store data */
-// const int I2S_OUT_DMABUF_LEN = 2000; /* maximum size in bytes (4092 is DMA's limit) */
-const int I2S_OUT_DMABUF_LEN = 1000;
+const int I2S_OUT_DMABUF_LEN   = 1000;
 
-const int I2S_OUT_DELAY_DMABUF_MS = (I2S_OUT_DMABUF_LEN / sizeof(uint32_t) * I2S_OUT_USEC_PER_PULSE / 1000);
-const int I2S_OUT_DELAY_MS        = (I2S_OUT_DELAY_DMABUF_MS * (I2S_OUT_DMABUF_COUNT + 1));
+const int I2S_OUT_DMABUF_COUNT_MIN = 2;
+const int I2S_OUT_DMABUF_COUNT_MAX = 8;    /* number of DMA buffers to store data */
+const int I2S_OUT_DMABUF_LEN_MIN   = 200;
+const int I2S_OUT_DMABUF_LEN_MAX   = 4000; /* maximum size in bytes (4092 is DMA's limit) */
+
+// Fewer, shorter buffers bring feed hold and I/O changes closer to real time; more, longer
+// ones give the bitstream task more slack before the DMA runs dry.
+enum class I2SOutProfile : int8_t {
+    Default    = 0,  // I2S_OUT_DMABUF_COUNT x I2S_OUT_DMABUF_LEN
+    LowLatency = 1,  // for jogging and I/O response
+    Throughput = 2,  // for long raster jobs at high step rates
+    Custom     = 3,  // count and length given explicitly
+};
 
 typedef void (*i2s_out_pulse_func_t)(void);
 
+// Writes up to n_samples port words to buf and returns how many it wrote
+typedef uint32_t (*i2s_out_block_func_t)(uint32_t* buf, uint32_t n_samples);
+
 typedef struct {
     /*
         I2S bitstream (32-bits): Transfers from MSB(bit31) to LSB(bit0) in sequence
@@ -124,13 +144,19 @@ uint8_t i2s_out_read(uint8_t pin);
 */
 void i2s_out_write(uint8_t pin, uint8_t val);
 
+/*
+   Set and clear several bits at once, in one atomic update of the port word.
+   set, clear: bit masks of expanded pin No.
+*/
+void i2s_out_write_mask(uint32_t set, uint32_t clear);
+
 /*
     Set current pin state to the I2S bitstream buffer
-    (This call will generate a future I2S_OUT_USEC_PER_PULSE μs x N bitstream)
+    (This call will generate a future i2s_out_get_usec_per_pulse() μs x N bitstream)
     usec: The length of time that the pulse should be repeated.
          That time will be converted to an integer number of pulses of
-         length I2S_OUT_USEC_PER_PULSE.
-         The number of samples is limited to (20 / I2S_OUT_USEC_PER_PULSE).
+         length i2s_out_get_usec_per_pulse().
+         The number of samples is limited to (20 / i2s_out_get_usec_per_pulse()).
     return: number of pushed samples
             0 .. no space for push
  */
@@ -168,6 +194,19 @@ int i2s_out_set_pulse_period(uint32_t usec);
  */
 int i2s_out_set_pulse_callback(i2s_out_pulse_func_t func);
 
+/*
+   Register a callback function that fills a whole DMA buffer at once.
+   While one is registered it is used instead of the pulse callback,
+   and the period set by i2s_out_set_pulse_period() is not used.
+   NULL returns to the pulse callback.
+ */
+int i2s_out_set_block_callback(i2s_out_block_func_t func);
+
+/*
+   Get the current port value, as set by i2s_out_write()
+ */
+uint32_t i2s_out_get_port_data();
+
 /*
    Get current pulser mode
  */
@@ -178,6 +217,43 @@ enum i2s_out_pulser_status_t {
 };
 i2s_out_pulser_status_t IRAM_ATTR i2s_out_get_pulser_status();
 
+/*
+   Set the length of one sample, and so the step timing resolution, to
+   usec (4, 2 or down to I2S_OUT_USEC_PER_PULSE_MIN) by reprogramming the
+   I2S clock divider. Only possible in passthrough mode.
+   return -1 ... stepping, or the length is not supported
+ */
+int i2s_out_set_usec_per_pulse(uint32_t usec);
+
+/*
+   Get the current length of one sample in microseconds
+ */
+uint32_t i2s_out_get_usec_per_pulse();
+
+/*
+   Resize the DMA buffer ring. profile selects a preset, or with I2SOutProfile::Custom
+   count buffers of len bytes. Only possible in passthrough mode.
+   return -1 ... stepping, or out of memory (the old ring is kept)
+ */
+int i2s_out_set_dma_profile(I2SOutProfile profile, uint32_t count, uint32_t len);
+
+/*
+   i2s_out_set_dma_profile() with the $I2SO/Profile, $I2SO/DMABufCount and $I2SO/DMABufLen
+   settings. Defined with the settings.
+ */
+void i2s_out_apply_settings();
+
+/*
+   Time in ms for data queued now to reach the shift registers while stepping
+ */
+uint32_t i2s_out_get_delay_ms();
+
+/*
+   Report the current DMA ring, and the number of buffers the DMA ran out of data
+   while stepping since boot
+ */
+void i2s_out_get_dma_info(uint32_t* count, uint32_t* len, uint32_t* underruns);
+
 /*
    Reset i2s I/O expander
    - Stop ISR/DMA
@@ -0,0 +1,211 @@
+/*
+  InputShaper.cpp - Input shaping of the path speed, to cancel frame resonances
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// Impulses of one shaper, in seconds. The formulas are the usual ones for a damped resonance.
+static uint8_t shaper_axis_impulses(ShaperType type, float frequency, float damping, float* amplitude, float* delay) {
+    float df = sqrtf(1.0f - damping * damping);
+    float td = 1.0f / (frequency * df);  // Damped period
+    float k;
+    switch (type) {
+        case ShaperType::ZV:
+            k            = expf(-damping * M_PI / df);
+            amplitude[0] = 1.0f;
+            amplitude[1] = k;
+            delay[0]     = 0.0f;
+            delay[1]     = 0.5f * td;
+            return 2;
+        case ShaperType::ZVD:
+            k            = expf(-damping * M_PI / df);
+            amplitude[0] = 1.0f;
+            amplitude[1] = 2.0f * k;
+            amplitude[2] = k * k;
+            delay[0]     = 0.0f;
+            delay[1]     = 0.5f * td;
+            delay[2]     = td;
+            return 3;
+        case ShaperType::MZV:
+            k            = expf(-0.75f * damping * M_PI / df);
+            amplitude[0] = 1.0f - M_SQRT1_2;
+            amplitude[1] = (M_SQRT2 - 1.0f) * k;
+            amplitude[2] = amplitude[0] * k * k;
+            delay[0]     = 0.0f;
+            delay[1]     = 0.375f * td;
+            delay[2]     = 0.75f * td;
+            return 3;
+        default:  // None, a single unit impulse
+            amplitude[0] = 1.0f;
+            delay[0]     = 0.0f;
+            return 1;
+    }
+}
+
+void shaper_impulses_compute(shaper_impulses_t* impulses) {
+    float   x_amplitude[SHAPER_AXIS_IMPULSES_MAX], x_delay[SHAPER_AXIS_IMPULSES_MAX];
+    float   y_amplitude[SHAPER_AXIS_IMPULSES_MAX], y_delay[SHAPER_AXIS_IMPULSES_MAX];
+    auto    x_type = static_cast<ShaperType>(shaper_x_type->get());
+    auto    y_type = static_cast<ShaperType>(shaper_y_type->get());
+    uint8_t n_x    = shaper_axis_impulses(x_type, shaper_x_frequency->get(), shaper_x_damping->get(), x_amplitude, x_delay);
+    uint8_t n_y    = shaper_axis_impulses(y_type, shaper_y_frequency->get(), shaper_y_damping->get(), y_amplitude, y_delay);
+
+    impulses->n_impulse = 0;
+    if (x_type == ShaperType::None && y_type == ShaperType::None) {
+        return;
+    }
+    // Convolve the two trains, normalizing so the amplitudes sum to one
+    float sum = 0.0f;
+    for (uint8_t i = 0; i < n_x; i++) {
+        for (uint8_t j = 0; j < n_y; j++) {
+            uint8_t n              = impulses->n_impulse++;
+            impulses->amplitude[n] = x_amplitude[i] * y_amplitude[j];
+            impulses->delay[n]     = (x_delay[i] + y_delay[j]) / 60.0f;
+            sum += impulses->amplitude[n];
+        }
+    }
+    for (uint8_t n = 0; n < impulses->n_impulse; n++) {
+        impulses->amplitude[n] /= sum;
+    }
+}
+
+// The unshaped timeline is kept as the end point of each generated segment, time (min) against
+// distance along the path (mm), and read back by linear interpolation. Both are kept relative to
+// a recent point, so single precision keeps its resolution through a long job.
+const int   SHAPER_HISTORY_SIZE = 256;   // Indexed by uint8_t, so the ring wraps by itself
+const float SHAPER_REBASE_TIME  = 0.05;  // (min)
+const float SHAPER_REBASE_MM    = 100.0;
+
+static float   history_time[SHAPER_HISTORY_SIZE];
+static float   history_mm[SHAPER_HISTORY_SIZE];
+static uint8_t history_first;  // Oldest point
+static int     history_count;
+
+static float generated_time;  // End of the unshaped timeline
+static float generated_mm;
+static float published_time;  // End of the last segment handed to the stepper, on the shaped timeline
+static float published_mm;
+
+static void shaper_history_push(float time, float mm) {
+    uint8_t index;
+    if (history_count == SHAPER_HISTORY_SIZE) {
+        index = history_first++;  // Drop the oldest
+    } else {
+        index = history_first + history_count++;
+    }
+    history_time[index] = time;
+    history_mm[index]   = mm;
+}
+
+void shaper_reset() {
+    history_first  = 0;
+    history_count  = 0;
+    generated_time = generated_mm = 0.0f;
+    published_time = published_mm = 0.0f;
+    shaper_history_push(0.0f, 0.0f);
+}
+
+void shaper_add(float dt, float mm) {
+    generated_time += dt;
+    generated_mm += mm;
+    shaper_history_push(generated_time, generated_mm);
+}
+
+// Unshaped distance at a time. Before the oldest point and after the newest, the motion is
+// taken to be standing still.
+static float shaper_unshaped_mm(float time) {
+    uint8_t last = history_first + history_count - 1;
+    if (time <= history_time[history_first]) {
+        return history_mm[history_first];
+    }
+    if (time >= history_time[last]) {
+        return history_mm[last];
+    }
+    int lo = 0, hi = history_count - 1;  // history_time[lo] < time <= history_time[hi]
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (history_time[uint8_t(history_first + mid)] < time) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    uint8_t i0 = history_first + lo;
+    uint8_t i1 = history_first + hi;
+    float   u  = (time - history_time[i0]) / (history_time[i1] - history_time[i0]);
+    return history_mm[i0] + u * (history_mm[i1] - history_mm[i0]);
+}
+
+static float shaper_shaped_mm(const shaper_impulses_t* impulses, float time) {
+    float mm = 0.0f;
+    for (uint8_t n = 0; n < impulses->n_impulse; n++) {
+        mm += impulses->amplitude[n] * shaper_unshaped_mm(time - impulses->delay[n]);
+    }
+    return mm;
+}
+
+static void shaper_rebase() {
+    float time = published_time;
+    float mm   = published_mm;
+    for (int i = 0; i < history_count; i++) {
+        uint8_t index = history_first + i;
+        history_time[index] -= time;
+        history_mm[index] -= mm;
+    }
+    generated_time -= time;
+    generated_mm -= mm;
+    published_time = 0.0f;
+    published_mm   = 0.0f;
+}
+
+bool shaper_next(const shaper_impulses_t* impulses, float mm, bool stopped, bool force, float* dt) {
+    float target = published_mm + mm;
+    float end;
+    if (shaper_shaped_mm(impulses, generated_time) >= target) {
+        end = generated_time;
+    } else if (stopped) {
+        end = generated_time + impulses->delay[impulses->n_impulse - 1];
+    } else if (force) {
+        end = generated_time;
+        target = shaper_shaped_mm(impulses, end);  // Falls short; the next segments catch up
+    } else {
+        return false;
+    }
+    // The shaped distance only grows with time, so bisect for the time it reaches target
+    float start = published_time;
+    for (int i = 0; i < 20 && end - start > 1e-7f; i++) {
+        float mid = 0.5f * (start + end);
+        if (shaper_shaped_mm(impulses, mid) < target) {
+            start = mid;
+        } else {
+            end = mid;
+        }
+    }
+    *dt            = end > published_time ? end - published_time : 0.0f;
+    published_time = MAX(end, published_time);
+    published_mm += mm;
+    if (stopped && published_mm == generated_mm && published_time > generated_time) {
+        // All motion is out. Continue the timeline standing still up to now, so motion added
+        // later starts after the shaped motion ends instead of being mixed into it.
+        generated_time = published_time;
+        shaper_history_push(generated_time, generated_mm);
+    }
+    if (published_time > SHAPER_REBASE_TIME || published_mm > SHAPER_REBASE_MM) {
+        shaper_rebase();
+    }
+    return true;
+}
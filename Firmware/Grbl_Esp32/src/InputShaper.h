@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+  InputShaper.h - Input shaping of the path speed, to cancel frame resonances
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// An input shaper replaces each change of speed by a few smaller, delayed copies of it, timed so
+// the ringing each one starts at the resonant frequency cancels the others. Grbl steps every axis
+// of a block from one Bresenham line, so the shaping is applied to the position along the path,
+// not per axis:
+//
+//   s_shaped(t) = sum of amplitude[i] * s(t - delay[i])
+//
+// The X and Y shapers, from $Shaper/X/* and $Shaper/Y/*, are convolved into one impulse train,
+// which cancels both resonances in every direction of travel. The segment generator still
+// produces the unshaped profile. The stepper then retimes each segment so it is traversed when
+// s_shaped reaches it, which delays the motion by the length of the impulse train.
+
+enum class ShaperType : int8_t {
+    None = 0,
+    ZV,   // Two impulses over half a period. Shortest, but sensitive to frequency errors.
+    ZVD,  // Three impulses over a full period. Robust against frequency errors.
+    MZV,  // Three impulses over 3/4 of a period, between the two.
+};
+
+const int SHAPER_AXIS_IMPULSES_MAX = 3;
+const int SHAPER_IMPULSES_MAX      = SHAPER_AXIS_IMPULSES_MAX * SHAPER_AXIS_IMPULSES_MAX;
+
+typedef struct {
+    uint8_t n_impulse;  // 0 when input shaping is off
+    float   amplitude[SHAPER_IMPULSES_MAX];
+    float   delay[SHAPER_IMPULSES_MAX];  // (min), ascending from 0
+} shaper_impulses_t;
+
+// Builds the combined X and Y impulse train from the $Shaper settings
+void shaper_impulses_compute(shaper_impulses_t* impulses);
+
+// Clears the unshaped timeline, at stepper reset
+void shaper_reset();
+
+// Appends a segment generated by st_prep_buffer(), of duration dt (min) and length mm
+void shaper_add(float dt, float mm);
+
+// Works out when the oldest segment that is generated but not yet handed to the stepper, of
+// length mm, should end on the shaped timeline, and returns its shaped duration in *dt. Returns
+// false, changing nothing, while that depends on motion not generated yet. With stopped, no more
+// motion is coming, so the motion is taken to stay where it is. With force, the segment ends no
+// later than the generated timeline, which gives up some shaping to keep the stepper fed.
+bool shaper_next(const shaper_impulses_t* impulses, float mm, bool stopped, bool force, float* dt);
@@ -0,0 +1,226 @@
+/*
+  JobLog.cpp - Run history of SD jobs, kept in a file on the card
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#ifdef ENABLE_SD_CARD
+#    include <time.h>
+
+const time_t   JOBLOG_CLOCK_SET  = 1577836800;  // 2020-01-01; earlier times are the uptime
+const uint32_t JOBLOG_REQUEUE_MS = 5000;        // A flush dropped by worker_cancel() is queued again
+const uint32_t JOBLOG_MAX_SIZE   = 1048576;     // Then the file becomes JOBLOG_OLD_PATH
+#    define JOBLOG_OLD_PATH "/joblog.old.csv"
+#    define JOBLOG_HEADER "time,event,file,result,seconds,mm,feed,programmed feed\n"
+
+typedef struct {
+    char     data[JOBLOG_BUFFER_SIZE];
+    uint32_t len;
+} joblog_buffer_t;
+
+static joblog_buffer_t   buffers[2];
+static joblog_buffer_t*  filling = &buffers[0];
+static SemaphoreHandle_t joblog_mutex;  // Over filling, dropped and the job
+static uint32_t          dropped;
+static volatile bool     flush_queued;
+static uint32_t          flush_queued_ms;
+
+static volatile bool job_open;
+static char          job_path[SD_QUEUE_PATH_MAX];
+static uint32_t      job_start_ms;
+static uint16_t      job_alarms;
+
+// Worker task only
+static File     log_file;
+static uint32_t log_mount_gen;
+static uint32_t log_size;
+
+void joblog_init() {
+    if (joblog_mutex == NULL) {
+        joblog_mutex = xSemaphoreCreateMutex();
+    }
+}
+
+static int joblog_time(char* s, size_t n) {
+    time_t now = time(NULL);
+    if (now >= JOBLOG_CLOCK_SET) {
+        struct tm tm;
+        localtime_r(&now, &tm);
+        return strftime(s, n, "%Y-%m-%d %H:%M:%S", &tm);
+    }
+    return snprintf(s, n, "T+%u", unsigned(millis() / 1000));
+}
+
+// Adds a line, the time and then fmt, which ends it with \n. Caller holds joblog_mutex.
+static void joblog_add(const char* fmt, ...) {
+    char line[SD_QUEUE_PATH_MAX + 96];
+    int  len = joblog_time(line, sizeof(line));
+
+    va_list args;
+    va_start(args, fmt);
+    len += vsnprintf(line + len, sizeof(line) - len, fmt, args);
+    va_end(args);
+    if (len >= (int)sizeof(line)) {
+        len           = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+    if (filling->len + len > JOBLOG_BUFFER_SIZE) {
+        dropped++;
+        return;
+    }
+    memcpy(filling->data + filling->len, line, len);
+    filling->len += len;
+}
+
+static void joblog_end_locked(const char* result) {
+    stepper_job_stats_t stats;
+    st_job_stats_get(&stats);
+    joblog_add(",end,%s,%s,%u,%.1f,%.0f,%.0f\n",
+               job_path,
+               result,
+               unsigned((millis() - job_start_ms) / 1000),
+               stats.distance,
+               stats.motion_time > 0.0f ? stats.distance / stats.motion_time : 0.0f,
+               stats.programmed_time > 0.0f ? stats.distance / stats.programmed_time : 0.0f);
+    job_open = false;
+}
+
+void joblog_job_start(const char* path) {
+    if (joblog_mutex == NULL || !sd_job_log->get()) {
+        return;
+    }
+    xSemaphoreTake(joblog_mutex, portMAX_DELAY);
+    if (job_open) {
+        joblog_end_locked("stopped");
+    }
+    snprintf(job_path, sizeof(job_path), "%s", path);
+    job_open     = true;
+    job_start_ms = millis();
+    job_alarms   = 0;
+    joblog_add(",start,%s\n", job_path);
+    xSemaphoreGive(joblog_mutex);
+}
+
+void joblog_job_end(const char* result) {
+    if (!job_open) {
+        return;
+    }
+    xSemaphoreTake(joblog_mutex, portMAX_DELAY);
+    if (job_open) {
+        joblog_end_locked(result);
+    }
+    xSemaphoreGive(joblog_mutex);
+}
+
+void joblog_alarm(ExecAlarm alarm) {
+    if (joblog_mutex == NULL || !sd_job_log->get()) {
+        return;
+    }
+    xSemaphoreTake(joblog_mutex, portMAX_DELAY);
+    if (job_open) {
+        job_alarms++;
+    }
+    joblog_add(",alarm,%s,%d\n", job_open ? job_path : "", static_cast<int>(alarm));
+    xSemaphoreGive(joblog_mutex);
+}
+
+// Each write stays within one sector of the file
+static bool joblog_write(const char* data, uint32_t len) {
+    while (len) {
+        uint32_t n = MIN(len, SD_SECTOR_SIZE - log_size % SD_SECTOR_SIZE);
+        if (log_file.write((const uint8_t*)data, n) != n) {
+            return false;
+        }
+        data += n;
+        len -= n;
+        log_size += n;
+    }
+    return true;
+}
+
+static bool joblog_open() {
+    if (log_file && log_mount_gen == sd_mount_generation() && log_size < JOBLOG_MAX_SIZE) {
+        return true;
+    }
+    log_file.close();  // Full, or from an earlier mount
+    if (log_size >= JOBLOG_MAX_SIZE && log_mount_gen == sd_mount_generation()) {
+        SD.remove(JOBLOG_OLD_PATH);
+        SD.rename(JOBLOG_PATH, JOBLOG_OLD_PATH);
+    }
+    log_file = SD.open(JOBLOG_PATH, FILE_APPEND);
+    if (!log_file) {
+        return false;
+    }
+    log_mount_gen = sd_mount_generation();
+    log_size      = log_file.size();
+    if (log_size == 0) {
+        sd_index_invalidate();
+        if (!joblog_write(JOBLOG_HEADER, strlen(JOBLOG_HEADER))) {
+            log_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+static void joblog_flush(void* arg) {
+    if (get_sd_state(false) != SDState::Idle) {
+        flush_queued = false;  // A job got the card first; the main loop asks again after it
+        return;
+    }
+    xSemaphoreTake(joblog_mutex, portMAX_DELAY);
+    if (dropped) {
+        uint32_t n = dropped;
+        dropped    = 0;
+        joblog_add(",dropped,,%u\n", n);
+    }
+    joblog_buffer_t* out = filling;
+    filling              = out == &buffers[0] ? &buffers[1] : &buffers[0];
+    xSemaphoreGive(joblog_mutex);
+    flush_queued = false;
+
+    if (out->len && joblog_open()) {
+        if (joblog_write(out->data, out->len)) {
+            log_file.flush();  // Also updates the directory entry, so a power cut keeps the lines
+        } else {
+            log_file.close();  // Opened again next time
+        }
+    }
+    out->len = 0;
+}
+
+void joblog_poll() {
+    if (joblog_mutex == NULL) {
+        return;
+    }
+    SDState state = get_sd_state(false);
+    if (job_open && state != SDState::BusyPrinting) {
+        joblog_job_end(job_alarms ? "alarm" : "stopped");  // Closed by a reset, an alarm or a stop
+    }
+    if ((filling->len == 0 && dropped == 0) || state != SDState::Idle) {
+        return;
+    }
+    if (flush_queued && millis() - flush_queued_ms < JOBLOG_REQUEUE_MS) {
+        return;
+    }
+    flush_queued    = true;
+    flush_queued_ms = millis();
+    if (!worker_submit("Job log", joblog_flush)) {
+        flush_queued = false;
+    }
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+  JobLog.h - Run history of SD jobs, kept in a file on the card
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Exec.h"
+
+// With $SD/JobLog on, each SD job adds CSV lines to JOBLOG_PATH:
+//
+//   <time>,start,<file>
+//   <time>,alarm,<file>,<alarm code>
+//   <time>,end,<file>,<done|stopped|alarm>,<seconds>,<mm>,<feed>,<programmed feed>
+//
+// The feeds are the averages of st_job_stats_get() in mm/min. The time is the date once the
+// clock is set, the uptime as T+<seconds> before that. Alarms outside a job are logged with an
+// empty file.
+//
+// Lines go into a RAM buffer and never touch the card while a job runs. The main loop hands
+// the buffer to the worker task once the card is idle, which appends it through one handle
+// that stays open between flushes, split at sector boundaries of the file so each write is
+// one sector or the part of one that is left. The handle is opened again after the card is
+// remounted. Lines that do not fit while a job runs are counted and logged as dropped.
+#define JOBLOG_PATH "/joblog.csv"
+#ifndef JOBLOG_BUFFER_SIZE
+#    define JOBLOG_BUFFER_SIZE 1024  // Two of these, one filling while the other is written
+#endif
+
+void joblog_init();
+
+void joblog_job_start(const char* path);
+void joblog_job_end(const char* result);  // No effect without a job started
+void joblog_alarm(ExecAlarm alarm);
+
+// From the main loop. Ends a job that closed without joblog_job_end(), and flushes once the
+// card is idle.
+void joblog_poll();
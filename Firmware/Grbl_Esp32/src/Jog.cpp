@@ -23,6 +23,63 @@
 
 #include "Grbl.h"
 
+extern bool step_counting_enabled;
+
+static bool             jog_counting = false;  // A jog is running and its steps are counted
+static int32_t          jog_start_position[MAX_N_AXIS];
+static volatile int64_t jog_report_us = 0;  // When the counts of the last jog are due, 0 for none
+
+void jog_steps_start() {
+    jog_counting = step_counting_enabled;
+    memcpy(jog_start_position, sys_position, sizeof(jog_start_position));
+}
+
+void jog_steps_end() {
+    if (!jog_counting) {
+        return;
+    }
+    jog_counting = false;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        sys.jog_step_counts[axis] += sys_position[axis] - jog_start_position[axis];
+    }
+    jog_report_us = esp_timer_get_time() + JOG_STEPS_REPORT_DELAY_US;
+}
+
+void jog_steps_report_check() {
+    int64_t due = jog_report_us;
+    if (due == 0 || esp_timer_get_time() < due || sys.state == State::Jog) {
+        return;
+    }
+    jog_report_us = 0;
+    report_jog_steps();
+}
+
+void jog_steps_reset() {
+    memset(sys.jog_step_counts, 0, sizeof(sys.jog_step_counts));
+    if (sys.state == State::Jog) {
+        jog_steps_start();
+    } else {
+        jog_counting = false;
+    }
+}
+
+void jog_steps_get(int32_t* counts) {
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        counts[axis] = sys.jog_step_counts[axis] + (jog_counting ? sys_position[axis] - jog_start_position[axis] : 0);
+    }
+}
+
+static void jog_start() {
+    if (sys.state == State::Idle) {
+        if (plan_get_current_block() != NULL) {  // Check if there is a block to execute.
+            sys.state = State::Jog;
+            jog_steps_start();
+            st_prep_buffer();
+            st_wake_up();  // NOTE: Manual start. No state machine required.
+        }
+    }
+}
+
 // Sets up valid jog motion received from g-code parser, checks for soft-limits, and executes the jog.
 // cancelledInflight will be set to true if was not added to parser due to a cancelJog.
 Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* cancelledInflight) {
@@ -40,16 +97,104 @@ Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* can
         }
     }
     // Valid jog command. Plan, set state, and execute.
-    if (!cartesian_to_motors(gc_block->values.xyz, pl_data, gc_state.position)) {
+    float position[MAX_N_AXIS];
+    gc_get_machine_position(position);  // Jogs are not transformed
+    if (!cartesian_to_motors(gc_block->values.xyz, pl_data, position)) {
         return Error::JogCancelled;
     }
 
-    if (sys.state == State::Idle) {
-        if (plan_get_current_block() != NULL) {  // Check if there is a block to execute.
-            sys.state = State::Jog;
-            st_prep_buffer();
-            st_wake_up();  // NOTE: Manual start. No state machine required.
-        }
+    jog_start();
+    return Error::Ok;
+}
+
+static bool    stream_running = false;
+static float   stream_velocity[MAX_N_AXIS];  // (mm/min)
+static int64_t stream_refresh_us;            // When jog_stream_set() last came
+
+Error jog_stream_set(const float* velocity) {
+    bool moving = false;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        moving = moving || velocity[axis] != 0.0f;
+    }
+    if (!moving) {
+        jog_stream_stop();
+        return Error::Ok;
     }
+    if (sys.state != State::Idle && sys.state != State::Jog) {
+        return Error::IdleError;
+    }
+    memcpy(stream_velocity, velocity, sizeof(stream_velocity));
+    stream_refresh_us = esp_timer_get_time();
+    stream_running    = true;
     return Error::Ok;
 }
+
+void jog_stream_stop() {
+    if (!stream_running) {
+        return;
+    }
+    stream_running = false;
+    if (sys.state == State::Jog) {
+        sys_rt_exec_state.bit.motionCancel = true;  // Same as a jog cancel
+    }
+}
+
+// The next block of the stream: its length, covering at least the stopping distance with the
+// other queued blocks, the feed rate along it and its direction
+static float jog_stream_block(float* unit_vec, float* feed_rate) {
+    float speed_sqr = 0.0f;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        speed_sqr += stream_velocity[axis] * stream_velocity[axis];
+    }
+    float speed = sqrtf(speed_sqr);  // (mm/min)
+    float accel  = SOME_LARGE_VALUE;  // Along the path (mm/min^2)
+    auto  n_axis = number_axis->get();
+    for (int axis = 0; axis < n_axis; axis++) {
+        unit_vec[axis] = stream_velocity[axis] / speed;
+        if (unit_vec[axis] != 0.0f) {
+            accel = MIN(accel, axis_settings[axis]->acceleration->get() * SEC_PER_MIN_SQ / fabsf(unit_vec[axis]));
+        }
+    }
+    *feed_rate    = speed;
+    float stop_mm = speed_sqr / (2.0f * accel);
+    return MAX(speed * JOG_STREAM_BLOCK_TIME / 60.0f, stop_mm / (JOG_STREAM_BLOCKS - 1));
+}
+
+void jog_stream_update() {
+    if (!stream_running) {
+        return;
+    }
+    if ((sys.state != State::Idle && sys.state != State::Jog) || sys.suspend.bit.jogCancel ||
+        esp_timer_get_time() - stream_refresh_us > JOG_STREAM_TIMEOUT_MS * 1000LL) {
+        jog_stream_stop();  // Cancelled, faulted or the client went quiet
+        return;
+    }
+    auto n_axis = number_axis->get();
+    while (plan_get_block_buffer_count() < JOG_STREAM_BLOCKS && plan_get_block_buffer_available()) {
+        float unit_vec[MAX_N_AXIS];
+        float target[MAX_N_AXIS];
+        float feed_rate;
+        float mm = jog_stream_block(unit_vec, &feed_rate);
+        float position[MAX_N_AXIS];
+        gc_get_machine_position(position);
+        memcpy(target, position, sizeof(target));
+        for (int axis = 0; axis < n_axis; axis++) {
+            target[axis] += unit_vec[axis] * mm;
+        }
+        if (soft_limits->get() && limitsCheckTravel(target)) {
+            return;  // Runs out at the last block inside the travel
+        }
+        plan_line_data_t pl_data      = {};
+        pl_data.feed_rate             = feed_rate;
+        pl_data.motion.noFeedOverride = 1;
+        pl_data.is_jog                = true;
+        pl_data.spindle_speed         = gc_state.spindle_speed;
+        pl_data.spindle               = gc_state.modal.spindle;
+        pl_data.coolant               = gc_state.modal.coolant;
+        if (!cartesian_to_motors(target, &pl_data, position)) {
+            return;
+        }
+        gc_set_machine_position(target);
+        jog_start();
+    }
+}
@@ -30,3 +30,30 @@ const int JOG_LINE_NUMBER = 0;
 // Sets up valid jog motion received from g-code parser, checks for soft-limits, and executes the jog.
 // cancelledInflight will be set to true if was not added to parser due to a cancelJog.
 Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* cancelledInflight);
+
+// Jog step counting, while step_counting_enabled. The counts are the sys_position change over
+// each jog, added up, so the step ISR does no counting. jog_steps_start() is called as a jog
+// starts and jog_steps_end() as the steppers go idle.
+void jog_steps_start();
+void jog_steps_end();
+// Zeroes the counts, and restarts the count of a running jog from the current position
+void jog_steps_reset();
+// The counts, including the part of a running jog done so far
+void jog_steps_get(int32_t* counts);
+// Called from the main loop; reports the counts JOG_STEPS_REPORT_DELAY_US after a counted
+// jog ends, unless another jog is running by then
+void jog_steps_report_check();
+const int64_t JOG_STEPS_REPORT_DELAY_US = 500000;
+
+// Continuous jogging, for a touchscreen or pendant held down. jog_stream_set() sets a velocity
+// (mm/min per axis) and jog_stream_update(), called from the main loop, plans short jog blocks
+// just in time to keep up to JOG_STREAM_BLOCKS queued, enough to stop within. The stream stops,
+// with a jog cancel, on an all zero velocity or when no jog_stream_set() came for
+// JOG_STREAM_TIMEOUT_MS, so motion ends when the client lets go or goes away.
+const int   JOG_STREAM_BLOCKS     = 3;
+const float JOG_STREAM_BLOCK_TIME = 0.05;  // Motion time of a block at full speed (s)
+const int   JOG_STREAM_TIMEOUT_MS = 500;
+
+Error jog_stream_set(const float* velocity);
+void  jog_stream_stop();
+void  jog_stream_update();
@@ -27,9 +27,17 @@
 
 #include "Grbl.h"
 
+#ifdef ENABLE_SOFTWARE_DEBOUNCE
+#    include <esp_timer.h>
+#endif
+
 uint8_t n_homing_locate_cycle = NHomingLocateCycle;
 
-xQueueHandle limit_sw_queue;  // used by limit switch debouncing
+static volatile bool limit_tripped = false;  // The ISR stopped the steppers, the reset is still to do
+static AxisMask      homed_trusted = 0;      // Axes whose position is still good from their last homing
+#ifdef ENABLE_SOFTWARE_DEBOUNCE
+static esp_timer_handle_t limit_debounce_timer = NULL;
+#endif
 
 // Homing axis search distance multiplier. Computed by this value times the cycle travel.
 #ifndef HOMING_AXIS_SEARCH_SCALAR
@@ -39,34 +47,105 @@ xQueueHandle limit_sw_queue;  // used by limit switch debouncing
 #    define HOMING_AXIS_LOCATE_SCALAR 5.0  // Must be > 1 to ensure limit switch is cleared.
 #endif
 
+// Stops the steppers at the next step event and raises the hard limit alarm. Everything else
+// mc_reset() does, messages included, waits for limits_finish_trip() in the protocol loop.
+static void IRAM_ATTR limits_trip() {
+    st_halt();
+    limit_tripped     = true;
+    sys_rt_exec_alarm = ExecAlarm::HardLimit;  // Indicate hard limit critical event
+    protocol_wake();
+}
+
+void limits_finish_trip() {
+    if (!limit_tripped) {
+        return;
+    }
+    limit_tripped = false;
+    grbl_msg_sendf(CLIENT_ALL, MsgLevel::Debug, "Hard limits");
+    mc_reset();  // Initiate system kill.
+}
+
+// Ignore limit switches if already in an alarm state or in-process of executing an alarm.
+// When in the alarm state, Grbl should have been reset or will force a reset, so any pending
+// moves in the planner and serial buffers are all cleared and newly sent blocks will be
+// locked out until a homing cycle or a kill lock command. Allows the user to disable the hard
+// limit setting if their limits are constantly triggering after a reset and move their axes.
+static inline bool IRAM_ATTR limits_armed() {
+    return sys.state != State::Alarm && sys.state != State::Homing && sys_rt_exec_alarm == ExecAlarm::None;
+}
+
+#ifdef ENABLE_SOFTWARE_DEBOUNCE
+// Runs LIMIT_DEBOUNCE_US after the first edge, in the esp_timer task
+static void limits_debounce_done(void* arg) {
+    if (limits_armed() && limits_get_state()) {
+        limits_trip();
+    }
+}
+#endif
+
 void IRAM_ATTR isr_limit_switches() {
-    // Ignore limit switches if already in an alarm state or in-process of executing an alarm.
-    // When in the alarm state, Grbl should have been reset or will force a reset, so any pending
-    // moves in the planner and serial buffers are all cleared and newly sent blocks will be
-    // locked out until a homing cycle or a kill lock command. Allows the user to disable the hard
-    // limit setting if their limits are constantly triggering after a reset and move their axes.
-    if (sys.state != State::Alarm && sys.state != State::Homing) {
-        if (sys_rt_exec_alarm == ExecAlarm::None) {
+    if (limits_armed()) {
 #ifdef ENABLE_SOFTWARE_DEBOUNCE
-            // we will start a task that will recheck the switches after a small delay
-            int evt;
-            xQueueSendFromISR(limit_sw_queue, &evt, NULL);
+        // Recheck the switches once they settle. Edges while the timer runs change nothing.
+        esp_timer_start_once(limit_debounce_timer, LIMIT_DEBOUNCE_US);
+#elif defined(HARD_LIMIT_FORCE_STATE_CHECK)
+        // Check limit pin state.
+        if (limits_get_state()) {
+            limits_trip();
+        }
 #else
-#    ifdef HARD_LIMIT_FORCE_STATE_CHECK
-            // Check limit pin state.
-            if (limits_get_state()) {
-                grbl_msg_sendf(CLIENT_ALL, MsgLevel::Debug, "Hard limits");
-                mc_reset();                                // Initiate system kill.
-                sys_rt_exec_alarm = ExecAlarm::HardLimit;  // Indicate hard limit critical event
-            }
-#    else   
-            grbl_msg_sendf(CLIENT_ALL, MsgLevel::Debug, "Hard limits");
-            mc_reset();                                // Initiate system kill.
-            sys_rt_exec_alarm = ExecAlarm::HardLimit;  // Indicate hard limit critical event
-#    endif
+        limits_trip();
 #endif
+    }
+}
+
+void limits_distrust(AxisMask axes) {
+    homed_trusted &= ~axes;
+}
+
+// $Homing/Quick: rapids the cycle axes to where the last homing left them, pulloff short of
+// the switches, from the position they still have. False if the move did not get there, which
+// leaves the full seek to find the switches.
+static bool limits_quick_approach(uint8_t cycle_mask, plan_line_data_t* pl_data) {
+    float target[MAX_N_AXIS];
+    memcpy(target, system_get_mpos(), sizeof(target));
+    uint8_t n_active_axis = 0;
+    auto    n_axis        = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (bit_istrue(cycle_mask, bit(idx))) {
+            float mpos  = axis_settings[idx]->home_mpos->get();
+            target[idx] = bit_istrue(homing_dir_mask->get(), bit(idx)) ? mpos + homing_pulloff->get() : mpos - homing_pulloff->get();
+            n_active_axis++;
         }
     }
+    if (limits_get_state() & cycle_mask) {
+        return false;
+    }
+    sys.homing_axis_lock = cycle_mask;
+    pl_data->feed_rate   = homing_seek_rate->get() * sqrt(n_active_axis);
+    if (plan_buffer_line(target, pl_data) == PLAN_EMPTY_BLOCK) {
+        return true;  // Already there
+    }
+    sys.step_control                  = {};
+    sys.step_control.executeSysMotion = true;
+    st_prep_buffer();
+    st_wake_up();
+    bool arrived = true;
+    while (!cycle_stop) {
+        st_prep_buffer();
+        if (limits_get_state() & cycle_mask) {
+            arrived = false;  // A switch is not where it was
+            break;
+        }
+        if (sys_rt_exec_state.bit.safetyDoor || sys_rt_exec_state.bit.reset) {
+            arrived = false;  // The locate loop raises the alarm
+            break;
+        }
+    }
+    cycle_stop = false;
+    st_reset();
+    delay_ms(homing_debounce->get());
+    return arrived;
 }
 
 // Homes the specified cycle axes, sets the machine position, and performs a pull-off motion after
@@ -119,6 +198,17 @@ void limits_go_home(uint8_t cycle_mask) {
     bool     approach    = true;
     float    homing_rate = homing_seek_rate->get();
     uint8_t  n_active_axis;
+    // With the position still trusted, start at the first locate pass
+    if (homing_quick->get() && n_homing_locate_cycle > 0 && ganged_mode == SquaringMode::Dual &&
+        !(cycle_mask & homing_squared_axes->get()) && (cycle_mask & ~homed_trusted) == 0) {
+        if (limits_quick_approach(cycle_mask, pl_data)) {
+            grbl_msg_sendf(CLIENT_ALL, MsgLevel::Debug, "Quick homing");
+            max_travel  = homing_pulloff->get() * HOMING_AXIS_LOCATE_SCALAR;
+            homing_rate = homing_feed_rate->get();
+            n_cycle -= 2;
+        }
+    }
+    limits_distrust(cycle_mask);
     AxisMask limit_state, axislock;
     do {
         float* target = system_get_mpos();
@@ -154,6 +244,7 @@ void limits_go_home(uint8_t cycle_mask) {
         sys.homing_axis_lock = axislock;
         // Perform homing cycle. Planner buffer should be empty, as required to initiate the homing cycle.
         pl_data->feed_rate = homing_rate;   // Set current homing rate.
+        motors_stall_arm(approach);         // Sensorless axes look for a stall on approach only
         plan_buffer_line(target, pl_data);  // Bypass mc_line(). Directly plan homing motion.
         sys.step_control                  = {};
         sys.step_control.executeSysMotion = true;  // Set to execute homing motion and clear existing flags.
@@ -186,15 +277,33 @@ void limits_go_home(uint8_t cycle_mask) {
                     sys_rt_exec_alarm = ExecAlarm::HomingFailDoor;
                 }
                 // Homing failure condition: Limit switch still engaged after pull-off motion
+                AxisMask failed = 0;
                 if (!approach && (limits_get_state() & cycle_mask)) {
                     sys_rt_exec_alarm = ExecAlarm::HomingFailPulloff;
+                    failed            = limits_get_state() & cycle_mask;
                 }
                 // Homing failure condition: Limit switch not found during approach.
                 if (approach && cycle_stop) {
                     sys_rt_exec_alarm = ExecAlarm::HomingFailApproach;
+                    for (uint8_t idx = 0; idx < n_axis; idx++) {
+                        if (axislock & step_pin[idx]) {
+                            failed |= bit(idx);
+                        }
+                    }
+                }
+                if (failed) {
+                    // Several axes home together, so say which ones failed
+                    char axes[MAX_N_AXIS + 1] = { 0 };
+                    for (uint8_t idx = 0, n = 0; idx < n_axis; idx++) {
+                        if (bitnum_istrue(failed, idx)) {
+                            axes[n++] = "XYZABC"[idx];
+                        }
+                    }
+                    grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Homing fail on %s", axes);
                 }
 
                 if (sys_rt_exec_alarm != ExecAlarm::None) {
+                    motors_stall_arm(false);
                     motors_set_homing_mode(cycle_mask, false);  // tell motors homing is done...failed
                     grbl_msg_sendf(CLIENT_ALL, MsgLevel::Debug, "Homing fail");
                     mc_reset();  // Stop motors, if they are running.
@@ -210,7 +319,7 @@ void limits_go_home(uint8_t cycle_mask) {
 #ifdef USE_I2S_STEPS
         if (current_stepper == ST_I2S_STREAM) {
             if (!approach) {
-                delay_ms(I2S_OUT_DELAY_MS);
+                delay_ms(i2s_out_get_delay_ms());
             }
         }
 #endif
@@ -250,7 +359,9 @@ void limits_go_home(uint8_t cycle_mask) {
             }
         }
     }
+    homed_trusted |= cycle_mask;
     sys.step_control = {};                      // Return step control to normal operation.
+    motors_stall_arm(false);
     motors_set_homing_mode(cycle_mask, false);  // tell motors homing is done
 }
 
@@ -260,6 +371,16 @@ uint8_t limit_pins[MAX_N_AXIS][2] = { { X_LIMIT_PIN, X2_LIMIT_PIN }, { Y_LIMIT_P
 uint8_t limit_mask = 0;
 
 void limits_init() {
+    static bool show_init_msg = true;  // used to show message only once.
+
+#ifdef ENABLE_SOFTWARE_DEBOUNCE
+    if (limit_debounce_timer == NULL) {
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback                = limits_debounce_done;
+        timer_args.name                    = "limitDebounce";
+        esp_timer_create(&timer_args, &limit_debounce_timer);
+    }
+#endif
     limit_mask = 0;
     int mode   = INPUT_PULLUP;
 #ifdef DISABLE_LIMIT_PIN_PULL_UP
@@ -278,24 +399,14 @@ void limits_init() {
                     detachInterrupt(pin);
                 }
 
-                if (limit_sw_queue == NULL) {
+                if (show_init_msg) {
                     grbl_msg_sendf(
                         CLIENT_SERIAL, MsgLevel::Info, "%s limit switch on pin %s", reportAxisNameMsg(axis, gang_index), pinName(pin).c_str());
                 }
             }
         }
     }
-
-    // setup task used for debouncing
-    if (limit_sw_queue == NULL) {
-        limit_sw_queue = xQueueCreate(10, sizeof(int));
-        xTaskCreate(limitCheckTask,
-                    "limitCheckTask",
-                    2048,
-                    NULL,
-                    5,  // priority
-                    NULL);
-    }
+    show_init_msg = false;
 }
 
 // Disables hard limits.
@@ -332,6 +443,7 @@ AxisMask limits_get_state() {
 #ifdef INVERT_LIMIT_PIN_MASK  // not normally used..unless you have both normal and inverted switches
     pinMask ^= INVERT_LIMIT_PIN_MASK;
 #endif
+    pinMask |= motors_stall_mask;  // Sensorless homing stalls, only ever set while homing
     return pinMask;
 }
 
@@ -361,26 +473,6 @@ void limits_soft_check(float* target) {
     }
 }
 
-// this is the task
-void limitCheckTask(void* pvParameters) {
-    while (true) {
-        int evt;
-        xQueueReceive(limit_sw_queue, &evt, portMAX_DELAY);  // block until receive queue
-        vTaskDelay(DEBOUNCE_PERIOD / portTICK_PERIOD_MS);    // delay a while
-        AxisMask switch_state;
-        switch_state = limits_get_state();
-        if (switch_state) {
-            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Debug, "Limit Switch State %08d", switch_state);
-            mc_reset();                                // Initiate system kill.
-            sys_rt_exec_alarm = ExecAlarm::HardLimit;  // Indicate hard limit critical event
-        }
-        static UBaseType_t uxHighWaterMark = 0;
-#ifdef DEBUG_TASK_STACK
-        reportTaskStackSize(uxHighWaterMark);
-#endif
-    }
-}
-
 float limitsMaxPosition(uint8_t axis) {
     float mpos = axis_settings[axis]->home_mpos->get();
 
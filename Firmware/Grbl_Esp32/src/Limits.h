@@ -29,6 +29,9 @@
 
 extern uint8_t n_homing_locate_cycle;
 
+// System motion line numbers must be zero.
+const int HOMING_CYCLE_LINE_NUMBER = 0;
+
 // Initialize the limits module
 void limits_init();
 
@@ -41,13 +44,17 @@ AxisMask limits_get_state();
 // Perform one portion of the homing cycle based on the input settings.
 void limits_go_home(uint8_t cycle_mask);
 
+// Drops the axes from those $Homing/Quick may home without the seek, once their position may be lost
+void limits_distrust(AxisMask axes);
+
 // Check for soft limit violations
 void limits_soft_check(float* target);
 
 void isr_limit_switches();
 
-// A task that runs after a limit switch interrupt.
-void limitCheckTask(void* pvParameters);
+// Resets after a hard limit trip. The limit ISR only stops the steppers and raises the alarm,
+// and protocol_exec_rt_system() calls this for the rest, which is not safe in an ISR.
+void limits_finish_trip();
 
 float limitsMaxPosition(uint8_t axis);
 float limitsMinPosition(uint8_t axis);
@@ -34,35 +34,76 @@
 
 SquaringMode ganged_mode = SquaringMode::Dual;
 
-// Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
-// unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
-// (1 minute)/feed_rate time.
-// NOTE: This is the primary gateway to the grbl planner. All line motions, including arc line
-// segments, must pass through this routine before being passed to the planner. The seperation of
-// mc_line and plan_buffer_line is done primarily to place non-planner-type functions from being
-// in the planner and to let backlash compensation or canned cycle integration simple and direct.
-// returns true if line was submitted to planner, or false if intentionally dropped.
-bool mc_line(float* target, plan_line_data_t* pl_data) {
-    bool submitted_result = false;
-    // store the plan data so it can be cancelled by the protocol system if needed
-    sys_pl_data_inflight = pl_data;
-    // If enabled, check for soft limit violations. Placed here all line motions are picked up
-    // from everywhere in Grbl.
-    if (soft_limits->get()) {
-        // NOTE: Block jog state. Jogging is a special case and soft limits are handled independently.
-        // if (sys.state != State::Jog) {
-        //     limits_soft_check(target);
-        // }  // mks_fix
+// Collinear runs, as exported for scan lines split into pixel sized moves at one power, are
+// merged before they reach the planner. The newest line is held back, and each following line
+// that continues it with the same feed, spindle and coolant only moves its target. The dropped
+// corners, summed over the run, stay within $Planner/CoalesceTolerance of the merged line. The
+// merged line reports the line number of the last line in it.
+//
+// In laser mode with $Laser/TravelFeed set, feed moves at S0 are travel. Such runs are merged
+// whatever their direction, since nothing is cut on the way, and run at the travel feed when it
+// is the faster one. The planner slows down into the next cut as it does for any junction.
+static bool             coalesce_pending = false;
+static float            coalesce_start[MAX_N_AXIS];
+static float            coalesce_target[MAX_N_AXIS];
+static float            coalesce_deviation;
+static plan_line_data_t coalesce_pl_data;
+
+static bool mc_coalesce_eligible(const plan_line_data_t* pl_data) {
+    return !(pl_data->is_jog || pl_data->motion.systemMotion || pl_data->motion.inverseTime || pl_data->motion.raster);
+}
 
-        if((sys.state != State::Jog) && (mks_ui_page.mks_ui_page != MKS_UI_Pring)) {
-            limits_soft_check(target);
-        }
+static bool mc_coalesce_same(const plan_line_data_t* a, const plan_line_data_t* b) {
+    return a->feed_rate == b->feed_rate && a->spindle_speed == b->spindle_speed && a->spindle == b->spindle &&
+           a->coolant.Mist == b->coolant.Mist && a->coolant.Flood == b->coolant.Flood &&
+           a->motion.rapidMotion == b->motion.rapidMotion && a->motion.noFeedOverride == b->motion.noFeedOverride;
+}
+
+// Distance in mm of corner from the line start..end, or a negative value when corner does not
+// project onto the line between start and end.
+static float mc_coalesce_deviation(const float* start, const float* corner, const float* end) {
+    float a_sq = 0.0f, b_sq = 0.0f, a_dot_b = 0.0f;
+    auto  n_axis = motion_config.n_axis;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        float a = corner[idx] - start[idx];
+        float b = end[idx] - start[idx];
+        a_sq += a * a;
+        b_sq += b * b;
+        a_dot_b += a * b;
     }
-    // If in check gcode mode, prevent motion by blocking planner. Soft limits still work.
-    if (sys.state == State::CheckMode) {
-        sys_pl_data_inflight = NULL;
-        return submitted_result;
+    if (a_dot_b <= 0.0f || a_dot_b >= b_sq) {
+        return -1.0f;
     }
+    float deviation_sq = a_sq - a_dot_b * a_dot_b / b_sq;
+    return deviation_sq > 0.0f ? sqrtf(deviation_sq) : 0.0f;
+}
+
+// Waits for room in the planner. Returns false on a system abort.
+static bool mc_planner_wait() {
+    // A dry run steps the planned motion from here instead of waiting on the stepper
+    if (sim_running() && plan_check_full_buffer()) {
+        sim_drain(false);
+    }
+    // If the buffer is full: good! That means we are well ahead of the robot.
+    // Remain in this loop until there is room in the buffer.
+    do {
+        protocol_execute_realtime();  // Check for any run-time commands
+        if (sys.abort) {
+            return false;  // Bail, if system abort.
+        }
+        if (plan_check_full_buffer()) {
+            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+            protocol_wait();              // Until the stepper frees a block
+        } else {
+            return true;
+        }
+    } while (1);
+}
+
+// Waits for room in the planner and plans the line
+static bool mc_plan_line(float* target, plan_line_data_t* pl_data) {
+    bool submitted_result = false;
+    sys_pl_data_inflight  = pl_data;
     // NOTE: Backlash compensation may be installed here. It will need direction info to track when
     // to insert a backlash line motion(s) before the intended line motion and will require its own
     // plan_check_full_buffer() and check for system abort loop. Also for position reporting
@@ -76,20 +117,10 @@ bool mc_line(float* target, plan_line_data_t* pl_data) {
     // indicates to Grbl what is a backlash compensation motion, so that Grbl executes the move but
     // doesn't update the machine position values. Since the position values used by the g-code
     // parser and planner are separate from the system machine positions, this is doable.
-    // If the buffer is full: good! That means we are well ahead of the robot.
-    // Remain in this loop until there is room in the buffer.
-    do {
-        protocol_execute_realtime();  // Check for any run-time commands
-        if (sys.abort) {
-            sys_pl_data_inflight = NULL;
-            return submitted_result;  // Bail, if system abort.
-        }
-        if (plan_check_full_buffer()) {
-            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
-        } else {
-            break;
-        }
-    } while (1);
+    if (!mc_planner_wait()) {
+        sys_pl_data_inflight = NULL;
+        return submitted_result;
+    }
     // Plan and queue motion into planner buffer
     // uint8_t plan_status; // Not used in normal operation.
     if (sys_pl_data_inflight == pl_data) {
@@ -100,10 +131,147 @@ bool mc_line(float* target, plan_line_data_t* pl_data) {
     return submitted_result;
 }
 
+// Hands the held line to the planner
+void mc_coalesce_flush() {
+    if (coalesce_pending) {
+        coalesce_pending = false;
+        mc_plan_line(coalesce_target, &coalesce_pl_data);
+    }
+}
+
+void mc_coalesce_poll() {
+    if (coalesce_pending && plan_get_block_buffer_count() < MC_COALESCE_FLUSH_BLOCKS) {
+        mc_coalesce_flush();
+    }
+}
+
+bool mc_line_pending() {
+    return coalesce_pending;
+}
+
+void mc_coalesce_reset() {
+    coalesce_pending = false;
+}
+
+static bool mc_laser_travel(const plan_line_data_t* pl_data) {
+    return laser_travel_feed->get() > 0.0f && spindle->inLaserMode() && pl_data->spindle_speed == 0 &&
+           !pl_data->motion.rapidMotion && mc_coalesce_eligible(pl_data);
+}
+
+// Merges the line into the held one, or holds it in place of the held one. Returns false when
+// the line has to be planned as it is.
+static bool mc_coalesce_line(float* target, plan_line_data_t* pl_data) {
+    float tolerance = planner_coalesce_tolerance->get();
+    bool  travel    = mc_laser_travel(pl_data);
+    if (!travel && (tolerance <= 0.0f || !mc_coalesce_eligible(pl_data))) {
+        mc_coalesce_flush();
+        return false;
+    }
+    plan_line_data_t line = *pl_data;
+    if (travel) {
+        line.feed_rate = MAX(line.feed_rate, laser_travel_feed->get());
+    }
+    if (coalesce_pending && mc_coalesce_same(&coalesce_pl_data, &line)) {
+        float deviation = travel ? 0.0f : mc_coalesce_deviation(coalesce_start, coalesce_target, target);
+        if (deviation >= 0.0f && coalesce_deviation + deviation <= tolerance) {
+            memcpy(coalesce_target, target, sizeof(coalesce_target));
+#ifdef USE_LINE_NUMBERS
+            coalesce_pl_data.line_number = pl_data->line_number;
+#endif
+            coalesce_deviation += deviation;
+            return true;
+        }
+    }
+    // The new run starts where the held line ends, or at the planner position
+    if (coalesce_pending) {
+        memcpy(coalesce_start, coalesce_target, sizeof(coalesce_start));
+        mc_coalesce_flush();
+        if (sys.abort) {
+            return true;  // Dropped, as mc_plan_line() would
+        }
+    } else {
+        plan_get_planner_mpos(coalesce_start);
+    }
+    memcpy(coalesce_target, target, sizeof(coalesce_target));
+    coalesce_pl_data   = line;
+    coalesce_deviation = 0.0f;
+    coalesce_pending   = true;
+    return true;
+}
+
+// One line, or one piece of it on the height map grid, through soft limits and coalescing
+static bool mc_line_piece(float* target, plan_line_data_t* pl_data) {
+    bool submitted_result = false;
+    // store the plan data so it can be cancelled by the protocol system if needed
+    sys_pl_data_inflight = pl_data;
+    // If enabled, check for soft limit violations. Placed here all line motions are picked up
+    // from everywhere in Grbl.
+    if (soft_limits->get()) {
+        // NOTE: Block jog state. Jogging is a special case and soft limits are handled independently.
+        // if (sys.state != State::Jog) {
+        //     limits_soft_check(target);
+        // }  // mks_fix
+
+        if((sys.state != State::Jog) && (mks_ui_page.mks_ui_page != MKS_UI_Pring)) {
+            limits_soft_check(target);
+        }
+    }
+    // If in check gcode mode, prevent motion by blocking planner. Soft limits still work.
+    if (sys.state == State::CheckMode && !sim_running()) {
+        sys_pl_data_inflight = NULL;
+        return submitted_result;
+    }
+    if (mc_coalesce_line(target, pl_data)) {
+        sys_pl_data_inflight = NULL;
+        return true;
+    }
+    return mc_plan_line(target, pl_data);
+}
+
+// Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
+// unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
+// (1 minute)/feed_rate time.
+// NOTE: This is the primary gateway to the grbl planner. All line motions, including arc line
+// segments, must pass through this routine before being passed to the planner. The seperation of
+// mc_line and plan_buffer_line is done primarily to place non-planner-type functions from being
+// in the planner and to let backlash compensation or canned cycle integration simple and direct.
+// returns true if line was submitted to planner, or false if intentionally dropped.
+bool mc_line(float* target, plan_line_data_t* pl_data) {
+    if (validate_running()) {
+        validate_target(target, pl_data);  // A background check, see Validate.h
+        return false;
+    }
+    if (heightmap_active(pl_data)) {
+        // Split on the height map grid, from the end of the held line if there is one
+        float start[MAX_N_AXIS];
+        if (coalesce_pending) {
+            memcpy(start, coalesce_target, sizeof(start));
+        } else {
+            plan_get_planner_mpos(start);
+        }
+        return heightmap_line(start, target, pl_data, mc_line_piece);
+    }
+    return mc_line_piece(target, pl_data);
+}
+
 bool __attribute__((weak)) cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
     return mc_line(target, pl_data);
 }
 
+bool mc_job_line(float* target, plan_line_data_t* pl_data, float* position) {
+    const transform_map_t* map = &gc_state.transform_map;
+    if (!map->active) {
+        return cartesian_to_motors(target, pl_data, position);
+    }
+    float map_target[MAX_N_AXIS];
+    float map_position[MAX_N_AXIS];
+    memcpy(map_target, target, sizeof(map_target));
+    memcpy(map_position, position, sizeof(map_position));
+    transform_apply(map, map_target);
+    transform_apply(map, map_position);
+    return cartesian_to_motors(map_target, pl_data, map_position);
+}
+
 bool __attribute__((weak)) kinematics_pre_homing(uint8_t cycle_mask) {
     return false;  // finish normal homing cycle
 }
@@ -115,13 +283,33 @@ void __attribute__((weak)) motors_to_cartesian(float* cartesian, float* motors,
 }
 
 void __attribute__((weak)) forward_kinematics(float* position) {}
+// Chord tolerance that keeps arc segments long enough for a full planner buffer to hold the
+// stopping distance at the arc feed rate. With the $12 tolerance, runs of small arcs can fill
+// the planner with blocks so short that the lookahead limits the feed rate. The result is never
+// finer than $12, nor coarser than $GCode/ArcToleranceMax.
+static float arc_planner_tolerance(float feed_rate, float radius, uint8_t axis_0, uint8_t axis_1) {
+    float   rate   = MIN(feed_rate, MIN(axis_settings[axis_0]->max_rate->get(), axis_settings[axis_1]->max_rate->get()));
+    float   accel  = MIN(axis_settings[axis_0]->acceleration->get(), axis_settings[axis_1]->acceleration->get()) * SEC_PER_MIN_SQ;
+    uint8_t blocks = plan_get_block_buffer_count() + plan_get_block_buffer_available();
+    if (accel <= 0.0f || blocks == 0) {
+        return arc_tolerance->get();
+    }
+    // Segment length at which the whole buffer covers v^2/(2a)
+    float chord = rate * rate / (2.0f * accel * blocks);
+    // A chord of length c on a circle of radius r deviates from it by about c^2/(8r)
+    float tolerance = chord * chord / (8.0f * radius);
+    return constrain(tolerance, arc_tolerance->get(), arc_tolerance_max->get());
+}
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
 // for vector transformation direction.
 // The arc is approximated by generating a huge number of tiny, linear segments. The chordal tolerance
 // of each segment is configured in the arc_tolerance setting, which is defined to be the maximum normal
-// distance from segment to the circle when the end points both lie on the circle.
+// distance from segment to the circle when the end points both lie on the circle. When
+// $GCode/ArcToleranceMax is above $12, the tolerance is relaxed up to it as needed to keep the
+// planner buffer from being filled with segments too short to reach the feed rate.
 void mc_arc(float*            target,
             plan_line_data_t* pl_data,
             float*            position,
@@ -146,7 +334,7 @@ void mc_arc(float*            target,
         previous_position[n] = position[n];
     }
     // CCW angle between position and target from circle center. Only one atan2() trig computation required.
-    float angular_travel = atan2(r_axis0 * rt_axis1 - r_axis1 * rt_axis0, r_axis0 * rt_axis0 + r_axis1 * rt_axis1);
+    float angular_travel = atan2f(r_axis0 * rt_axis1 - r_axis1 * rt_axis0, r_axis0 * rt_axis0 + r_axis1 * rt_axis1);
     if (is_clockwise_arc) {  // Correct atan2 output per direction
         if (angular_travel >= -ARC_ANGULAR_TRAVEL_EPSILON) {
             angular_travel -= 2 * M_PI;
@@ -160,7 +348,15 @@ void mc_arc(float*            target,
     // (2x) arc_tolerance. For 99% of users, this is just fine. If a different arc segment fit
     // is desired, i.e. least-squares, midpoint on arc, just change the mm_per_arc_segment calculation.
     // For the intended uses of Grbl, this value shouldn't exceed 2000 for the strictest of cases.
-    uint16_t segments = floor(fabs(0.5 * angular_travel * radius) / sqrt(arc_tolerance->get() * (2 * radius - arc_tolerance->get())));
+    float tolerance = arc_tolerance->get();
+    if (arc_tolerance_max->get() > tolerance && !pl_data->motion.inverseTime) {
+        tolerance = arc_planner_tolerance(pl_data->feed_rate, radius, axis_0, axis_1);
+    }
+    if (gc_state.transform_map.active) {
+        tolerance /= gc_state.transform_map.max_scale;  // The chords are stretched with the arc
+    }
+    tolerance         = MIN(tolerance, radius);
+    uint16_t segments = floorf(fabsf(0.5f * angular_travel * radius) / sqrtf(tolerance * (2.0f * radius - tolerance)));
     if (segments) {
         // Multiply inverse feed_rate to compensate for the fact that this movement is approximated
         // by a number of discrete segments. The inverse feed_rate should be correct for the sum of
@@ -182,24 +378,13 @@ void mc_arc(float*            target,
            cases. So, exact arc path correction is implemented. This approach avoids the problem of too many very
            expensive trig operations [sin(),cos(),tan()] which can take 100-200 usec each to compute.
 
-           Small angle approximation may be used to reduce computation overhead further. A third-order approximation
-           (second order sin() has too much error) holds for most, if not, all CNC applications. Note that this
-           approximation will begin to accumulate a numerical drift error when theta_per_segment is greater than
-           ~0.25 rad(14 deg) AND the approximation is successively used without correction several dozen times. This
-           scenario is extremely unlikely, since segment lengths and theta_per_segment are automatically generated
-           and scaled by the arc tolerance setting. Only a very large arc tolerance setting, unrealistic for CNC
-           applications, would cause this numerical drift error. However, it is best to set N_ARC_CORRECTION from a
-           low of ~4 to a high of ~20 or so to avoid trig operations while keeping arc generation accurate.
-
-           This approximation also allows mc_arc to immediately insert a line segment into the planner
-           without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
-           a correction, the planner should have caught up to the lag caused by the initial mc_arc overhead.
-           This is important when there are successive arc motions.
+           The rotation for one segment is computed once per arc with single precision sinf() and cosf(), which
+           take a few usec on the ESP32 FPU, so unlike a small angle approximation it does not drift when an
+           arc tolerance coarsened by $GCode/ArcToleranceMax makes theta_per_segment large. The remaining drift
+           is only rounding, which the correction every N_ARC_CORRECTION segments removes.
         */
-        // Computes: cos_T = 1 - theta_per_segment^2/2, sin_T = theta_per_segment - theta_per_segment^3/6) in ~52usec
-        float cos_T = 2.0 - theta_per_segment * theta_per_segment;
-        float sin_T = theta_per_segment * 0.16666667 * (cos_T + 4.0);
-        cos_T *= 0.5;
+        float cos_T = cosf(theta_per_segment);
+        float sin_T = sinf(theta_per_segment);
         float    sin_Ti;
         float    cos_Ti;
         float    r_axisi;
@@ -208,16 +393,16 @@ void mc_arc(float*            target,
         float    original_feedrate = pl_data->feed_rate;  // Kinematics may alter the feedrate, so save an original copy
         for (i = 1; i < segments; i++) {                  // Increment (segments-1).
             if (count < N_ARC_CORRECTION) {
-                // Apply vector rotation matrix. ~40 usec
+                // Apply vector rotation matrix.
                 r_axisi = r_axis0 * sin_T + r_axis1 * cos_T;
                 r_axis0 = r_axis0 * cos_T - r_axis1 * sin_T;
                 r_axis1 = r_axisi;
                 count++;
             } else {
-                // Arc correction to radius vector. Computed only every N_ARC_CORRECTION increments. ~375 usec
+                // Arc correction to radius vector. Computed only every N_ARC_CORRECTION increments.
                 // Compute exact location by applying transformation matrix from initial radius vector(=-offset).
-                cos_Ti  = cos(i * theta_per_segment);
-                sin_Ti  = sin(i * theta_per_segment);
+                cos_Ti  = cosf(i * theta_per_segment);
+                sin_Ti  = sinf(i * theta_per_segment);
                 r_axis0 = -offset[axis_0] * cos_Ti + offset[axis_1] * sin_Ti;
                 r_axis1 = -offset[axis_0] * sin_Ti - offset[axis_1] * cos_Ti;
                 count   = 0;
@@ -227,7 +412,7 @@ void mc_arc(float*            target,
             position[axis_1] = center_axis1 + r_axis1;
             position[axis_linear] += linear_per_segment;
             pl_data->feed_rate = original_feedrate;  // This restores the feedrate kinematics may have altered
-            cartesian_to_motors(position, pl_data, previous_position);
+            mc_job_line(position, pl_data, previous_position);
             previous_position[axis_0]      = position[axis_0];
             previous_position[axis_1]      = position[axis_1];
             previous_position[axis_linear] = position[axis_linear];
@@ -238,16 +423,32 @@ void mc_arc(float*            target,
         }
     }
     // Ensure last segment arrives at target location.
-    cartesian_to_motors(target, pl_data, previous_position);
+    mc_job_line(target, pl_data, previous_position);
 }
 
-// Execute dwell in seconds.
+// Execute dwell in milliseconds. The dwell is planned as a block that the stepper times, see
+// plan_buffer_dwell(), so the lines after it are read and planned while it runs.
 bool mc_dwell(int32_t milliseconds) {
+    if (validate_running()) {
+        validate_dwell(milliseconds);
+        return false;
+    }
     if (milliseconds <= 0 || sys.state == State::CheckMode) {
         return false;
     }
-    protocol_buffer_synchronize();
-    return delay_msec(milliseconds, DwellMode::Dwell);
+    mc_coalesce_flush();  // The held line comes before the dwell
+    if (!mc_planner_wait()) {
+        return false;
+    }
+    plan_line_data_t pl_data = {};
+    pl_data.spindle          = gc_state.modal.spindle;
+    pl_data.spindle_speed    = gc_state.spindle_speed;
+    pl_data.coolant          = gc_state.modal.coolant;
+#ifdef USE_LINE_NUMBERS
+    pl_data.line_number = gc_state.line_number;
+#endif
+    plan_buffer_dwell(milliseconds, &pl_data);
+    return true;
 }
 
 // return true if the mask has exactly one bit set,
@@ -348,8 +549,26 @@ void mc_homing_cycle(uint8_t cycle_mask) {
     else
 #endif
     {
+        // With $Homing/Parallel, the cycles without squared axes run first, as one cycle. Each axis
+        // is still locked out on its own switch, so they only differ in sharing the motion.
+        AxisMask parallel_mask = 0;
+        if (homing_parallel->get()) {
+            for (int cycle = 0; cycle < MAX_N_AXIS; cycle++) {
+                auto homing_mask = homing_cycle[cycle]->get();
+                if (!(homing_mask & homing_squared_axes->get() && mask_is_single_axis(homing_mask))) {
+                    parallel_mask |= homing_mask;
+                }
+            }
+            if (parallel_mask) {
+                no_cycles_defined = false;
+                limits_go_home(parallel_mask);
+            }
+        }
         for (int cycle = 0; cycle < MAX_N_AXIS; cycle++) {
             auto homing_mask = homing_cycle[cycle]->get();
+            if (homing_mask && (homing_mask & ~parallel_mask) == 0) {
+                continue;  // Homed above
+            }
             if (homing_mask) {  // if there are some axes in this cycle
                 no_cycles_defined = false;
                 if (!axis_is_squared(homing_mask)) {
@@ -391,6 +610,97 @@ void mc_homing_cycle(uint8_t cycle_mask) {
     limits_init();
 }
 
+// A position in steps as the g-code frame lines are planned in
+static void mc_probe_mpos(float* position, int32_t* steps) {
+    system_convert_array_steps_to_mpos(position, steps);
+    position[Z_AXIS] -= heightmap_offset(position);
+}
+
+// A probe cycle's own moves, planned from position, which follows them
+static void mc_probe_line(float* position, const float* target, plan_line_data_t* pl_data) {
+    float line[MAX_N_AXIS];
+    memcpy(line, target, sizeof(line));
+    cartesian_to_motors(line, pl_data, position);
+    memcpy(position, line, sizeof(line));
+}
+
+// The probing move, planned behind any lines already queued, so a retract or a move over runs
+// as one motion with it. The probe is armed once it reads open, since those lines may start
+// from a contact. Returns true on contact, with the contact in contact. Either way the rest of
+// the motion is dropped and position is where the machine stopped.
+static bool mc_probe_seek(float* position, const float* target, plan_line_data_t* pl_data, float* contact) {
+    mc_probe_line(position, target, pl_data);
+    mc_coalesce_flush();
+    bool armed                       = false;
+    sys_rt_exec_state.bit.cycleStart = true;
+    do {
+        if (!armed && !probe_get_state()) {
+            armed           = true;
+            sys_probe_state = Probe::Active;
+            probe_state_monitor();  // A contact between the read and arming is not an edge
+        }
+        protocol_execute_realtime();
+        if (sys.abort) {
+            return false;
+        }
+    } while (sys.state != State::Idle);
+    bool hit        = armed && sys_probe_state == Probe::Off;
+    sys_probe_state = Probe::Off;
+    protocol_execute_realtime();
+    st_reset();
+    plan_reset();
+    plan_sync_position();
+    mc_probe_mpos(position, sys_position);
+    if (hit) {
+        mc_probe_mpos(contact, sys_probe_position);
+    }
+    return hit;
+}
+
+// $Probe/TwoStage: after the first contact of start..target, retracts $Probe/Retract back along
+// the move and probes again at $Probe/LatchRate, as one planned motion. The second probe goes no
+// further past the first contact than the retract, nor past target. True on contact, with it in
+// sys_probe_position.
+static bool mc_probe_latch(const float* start, const float* target, plan_line_data_t* pl_data) {
+    protocol_execute_realtime();
+    st_reset();  // The rest of the first probe move
+    plan_reset();
+    plan_sync_position();
+
+    auto  n_axis = motion_config.n_axis;
+    float position[MAX_N_AXIS], contact[MAX_N_AXIS], retract[MAX_N_AXIS], latch[MAX_N_AXIS];
+    mc_probe_mpos(position, sys_position);
+    mc_probe_mpos(contact, sys_probe_position);
+    float length = 0.0f, reached = 0.0f;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        length += (target[idx] - start[idx]) * (target[idx] - start[idx]);
+        reached += (contact[idx] - start[idx]) * (target[idx] - start[idx]);
+    }
+    length = sqrtf(length);
+    if (length == 0.0f) {
+        return false;
+    }
+    reached /= length;
+    float back  = probe_retract->get();
+    float ahead = constrain(length - reached, 0.0f, back);
+    memcpy(retract, position, sizeof(retract));
+    memcpy(latch, position, sizeof(latch));
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        float unit   = (target[idx] - start[idx]) / length;
+        retract[idx] = contact[idx] - unit * back;
+        latch[idx]   = contact[idx] + unit * ahead;
+    }
+
+    plan_line_data_t rapid   = *pl_data;
+    rapid.motion.rapidMotion = 1;
+    rapid.motion.inverseTime = 0;
+    plan_line_data_t slow    = *pl_data;
+    slow.motion.inverseTime  = 0;
+    slow.feed_rate           = probe_latch_rate->get();
+    mc_probe_line(position, retract, &rapid);
+    return mc_probe_seek(position, latch, &slow, contact);
+}
+
 // Perform tool length probe cycle. Requires probe switch.
 // NOTE: Upon probe failure, the program will be stopped and placed into ALARM state.
 GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t parser_flags) {
@@ -430,9 +740,12 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t par
     }
     // Setup and queue probing motion. Auto cycle-start should not start the cycle.
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Found");
-    cartesian_to_motors(target, pl_data, gc_state.position);
+    float start[MAX_N_AXIS];
+    gc_get_machine_position(start);  // The probe target is not transformed
+    cartesian_to_motors(target, pl_data, start);
     // Activate the probing state monitor in the stepper module.
     sys_probe_state = Probe::Active;
+    probe_state_monitor();  // The pin interrupt only sees edges, so check a contact made since the test above
     // Perform probing cycle. Wait here until probe is triggered or motion completes.
     sys_rt_exec_state.bit.cycleStart = true;
     do {
@@ -443,6 +756,16 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t par
         }
     } while (sys.state != State::Idle);
 
+    // The first contact only found the surface; the second is the result
+    if (sys_probe_state == Probe::Off && !is_probe_away && probe_two_stage->get()) {
+        bool latched = mc_probe_latch(start, target, pl_data);
+        if (sys.abort) {
+            RESTORE_STEPPER(save_stepper);
+            return GCUpdatePos::None;
+        }
+        sys_probe_state = latched ? Probe::Off : Probe::Active;  // Ends the cycle as the first contact would have
+    }
+
     // Switch the stepper mode to the previous mode
     RESTORE_STEPPER(save_stepper);
     
@@ -481,6 +804,102 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t par
     }
 }
 
+// Grid probing, see HeightMap.h
+static void mc_probe_grid_line(float* position, float x, float y, float z, plan_line_data_t* pl_data) {
+    float target[MAX_N_AXIS];
+    memcpy(target, position, sizeof(target));
+    target[X_AXIS] = x;
+    target[Y_AXIS] = y;
+    target[Z_AXIS] = z;
+    mc_probe_line(position, target, pl_data);
+}
+
+static bool mc_probe_grid_seek(float* position, float x, float y, float z, plan_line_data_t* pl_data, float* contact) {
+    float target[MAX_N_AXIS];
+    memcpy(target, position, sizeof(target));
+    target[X_AXIS] = x;
+    target[Y_AXIS] = y;
+    target[Z_AXIS] = z;
+    return mc_probe_seek(position, target, pl_data, contact);
+}
+
+// Probes map's grid in rows, every other one in reverse, and returns over point 0,0 at the
+// starting Z. False with the probe alarm set if a point is not found.
+bool mc_probe_grid(heightmap_t* map) {
+    protocol_buffer_synchronize();
+    if (sys.abort) {
+        return false;
+    }
+    if (probe_get_state()) {
+        sys_rt_exec_alarm = ExecAlarm::ProbeFailInitial;
+        protocol_execute_realtime();
+        return false;
+    }
+#ifdef USE_I2S_STEPS
+    stepper_id_t save_stepper = current_stepper; /* remember the stepper */
+#endif
+    BACKUP_STEPPER(save_stepper);
+    set_probe_direction(false);
+
+    plan_line_data_t rapid, seek, latch;
+    memset(&rapid, 0, sizeof(rapid));
+    rapid.motion.rapidMotion = 1;
+    rapid.feed_rate          = probe_grid_seek_rate->get();
+    seek                     = rapid;
+    seek.motion.rapidMotion  = 0;
+    latch                    = seek;
+    latch.feed_rate          = probe_grid_latch_rate->get();
+
+    float position[MAX_N_AXIS], contact[MAX_N_AXIS];
+    gc_get_machine_position(position);
+    float z_top    = position[Z_AXIS];
+    float z_bottom = z_top - probe_grid_depth->get();
+    float backoff  = probe_grid_backoff->get();
+    float tol      = 0.05f;  // mm, a contact further than this from the point was made on the way
+    bool  found    = true;
+    for (int iy = 0; found && iy < map->ny; iy++) {
+        for (int k = 0; found && k < map->nx; k++) {
+            int   ix = (iy & 1) ? map->nx - 1 - k : k;
+            float x  = map->x0 + ix * map->dx;
+            float y  = map->y0 + iy * map->dy;
+            if (iy || k) {
+                mc_probe_grid_line(position, position[X_AXIS], position[Y_AXIS], MIN(position[Z_AXIS] + probe_grid_clearance->get(), z_top), &rapid);
+                mc_probe_grid_line(position, x, y, position[Z_AXIS], &rapid);
+            }
+            found = mc_probe_grid_seek(position, x, y, z_bottom, &seek, contact);
+            if (found && (fabsf(contact[X_AXIS] - x) > tol || fabsf(contact[Y_AXIS] - y) > tol)) {
+                // Higher than the clearance; come in from the safe height
+                mc_probe_grid_line(position, position[X_AXIS], position[Y_AXIS], z_top, &rapid);
+                mc_probe_grid_line(position, x, y, z_top, &rapid);
+                found = mc_probe_grid_seek(position, x, y, z_bottom, &seek, contact) && fabsf(contact[X_AXIS] - x) <= tol &&
+                        fabsf(contact[Y_AXIS] - y) <= tol;
+            }
+            if (found) {
+                mc_probe_grid_line(position, x, y, MIN(contact[Z_AXIS] + backoff, z_top), &rapid);
+                found = mc_probe_grid_seek(position, x, y, MAX(contact[Z_AXIS] - backoff, z_bottom), &latch, contact);
+            }
+            if (found) {
+                map->z[ix + iy * map->nx] = contact[Z_AXIS];
+            }
+            if (sys.abort) {
+                RESTORE_STEPPER(save_stepper);
+                return false;
+            }
+        }
+    }
+    if (found) {
+        mc_probe_grid_line(position, position[X_AXIS], position[Y_AXIS], z_top, &rapid);
+        mc_probe_grid_line(position, map->x0, map->y0, z_top, &rapid);
+        protocol_buffer_synchronize();
+    } else {
+        sys_rt_exec_alarm = ExecAlarm::ProbeFailContact;
+        protocol_execute_realtime();
+    }
+    RESTORE_STEPPER(save_stepper);
+    gc_sync_position();
+    return found && !sys.abort;
+}
+
 // Plans and executes the single special motion case for parking. Independent of main planner buffer.
 // NOTE: Uses the always free planner ring buffer head to store motion parameters for execution.
 void mc_parking_motion(float* parking_target, plan_line_data_t* pl_data) {
@@ -528,6 +947,7 @@ void mc_reset() {
     // Only this function can set the system reset. Helps prevent multiple kill calls.
     if (!sys_rt_exec_state.bit.reset) {
         sys_rt_exec_state.bit.reset = true;
+        protocol_wake();
         // Kill spindle and coolant.
         spindle->stop();
         coolant_stop();
@@ -557,6 +977,7 @@ void mc_reset() {
                 sys_rt_exec_alarm = ExecAlarm::AbortCycle;
             }
             st_go_idle();  // Force kill steppers. Position has likely been lost.
+            limits_distrust(bit(MAX_N_AXIS) - 1);
         }
         ganged_mode = SquaringMode::Dual;  // in case an error occurred during squaring
 
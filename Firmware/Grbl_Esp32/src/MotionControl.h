@@ -38,6 +38,21 @@ const int PARKING_MOTION_LINE_NUMBER = 0;
 bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position);
 bool mc_line(float* target, plan_line_data_t* pl_data);  // returns true if line was submitted to planner
 
+// A program move of the parser, through the job transform if one is set, see Transform.h, and
+// then cartesian_to_motors()
+bool mc_job_line(float* target, plan_line_data_t* pl_data, float* position);
+
+// With $Planner/CoalesceTolerance set, mc_line() holds back the newest line to merge the lines
+// continuing it in a straight line, and with $Laser/TravelFeed set the runs of S0 laser moves. The held line is planned by mc_coalesce_flush(), which
+// anything waiting on the planner calls first, and by mc_coalesce_poll() from the main loop once
+// fewer than MC_COALESCE_FLUSH_BLOCKS blocks are queued.
+const int MC_COALESCE_FLUSH_BLOCKS = 4;
+
+void mc_coalesce_flush();
+void mc_coalesce_poll();
+void mc_coalesce_reset();  // Drops the held line, with the planner at a reset
+bool mc_line_pending();    // A line is held back from the planner
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, is_clockwise_arc boolean. Used
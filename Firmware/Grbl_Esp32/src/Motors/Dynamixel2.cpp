@@ -29,6 +29,8 @@
 namespace Motors {
     bool    Motors::Dynamixel2::uart_ready         = false;
     uint8_t Motors::Dynamixel2::ids[MAX_N_AXIS][2] = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+    Dynamixel2*          Dynamixel2::servos[MAX_N_AXIS][2] = {};
+    Dynamixel2::stats_t  Dynamixel2::stats                 = {};
 
     Dynamixel2::Dynamixel2(uint8_t axis_index, uint8_t id, uint8_t tx_pin, uint8_t rx_pin, uint8_t rts_pin) :
         Servo(axis_index), _id(id), _tx_pin(tx_pin), _rx_pin(rx_pin), _rts_pin(rts_pin) {
@@ -42,6 +44,7 @@ namespace Motors {
 
     void Dynamixel2::init() {
         init_uart(_id, _axis_index, _dual_axis_index);  // static and only allows one init
+        servos[_axis_index][_dual_axis_index] = this;
 
         read_settings();
 
@@ -129,6 +132,7 @@ namespace Motors {
         _disabled = disable;
 
         dxl_write(DXL_ADDR_TORQUE_EN, param_count, !_disabled);
+        request_update();
     }
 
     void Dynamixel2::set_operating_mode(uint8_t mode) {
@@ -142,7 +146,7 @@ namespace Motors {
         }
 
         if (_disabled) {
-            dxl_read_position();
+            dxl_sync_read_positions();
         } else {
             dxl_bulk_goal_position();  // call the static method that updates all at once
         }
@@ -222,15 +226,7 @@ namespace Motors {
             uint32_t dxl_position = _dxl_rx_message[9] | (_dxl_rx_message[10] << 8) | (_dxl_rx_message[11] << 16) |
                                     (_dxl_rx_message[12] << 24);
 
-            read_settings();
-
-            int32_t pos_min_steps = lround(limitsMinPosition(_axis_index) * axis_settings[_axis_index]->steps_per_mm->get());
-            int32_t pos_max_steps = lround(limitsMaxPosition(_axis_index) * axis_settings[_axis_index]->steps_per_mm->get());
-
-            int32_t temp = map(dxl_position, DXL_COUNT_MIN, DXL_COUNT_MAX, pos_min_steps, pos_max_steps);
-
-            sys_position[_axis_index] = temp;
-
+            set_position_from_count(dxl_position);
             plan_sync_position();
 
             return dxl_position;
@@ -239,6 +235,15 @@ namespace Motors {
         }
     }
 
+    void Dynamixel2::set_position_from_count(uint32_t dxl_position) {
+        read_settings();
+
+        int32_t pos_min_steps = lround(limitsMinPosition(_axis_index) * axis_settings[_axis_index]->steps_per_mm->get());
+        int32_t pos_max_steps = lround(limitsMaxPosition(_axis_index) * axis_settings[_axis_index]->steps_per_mm->get());
+
+        sys_position[_axis_index] = map(dxl_position, DXL_COUNT_MIN, DXL_COUNT_MAX, pos_min_steps, pos_max_steps);
+    }
+
     void Dynamixel2::dxl_read(uint16_t address, uint16_t data_len) {
         uint8_t msg_len = 3 + 4;
 
@@ -372,6 +377,73 @@ namespace Motors {
             }
         }
         dxl_finish_message(DXL_BROADCAST_ID, tx_message, (count * 5) + 7);
+        stats.sync_writes++;
+    }
+
+    /*
+        Static
+
+        Reads the present position of every disabled servo with one sync read. The servos
+        answer one after another, in the order of the IDs in the request, each with its own
+        status packet, so the whole read costs one turnaround of the bus instead of one per servo.
+    */
+    void Dynamixel2::dxl_sync_read_positions() {
+        char     tx_message[DXL_MSG_START + 4 + MAX_N_AXIS * 2 + 2];
+        uint8_t  rx_message[DXL_POSITION_RSP_LEN * MAX_N_AXIS * 2];
+        uint16_t msg_index = DXL_MSG_INSTR;
+        uint8_t  count     = 0;
+
+        tx_message[msg_index]   = DXL_SYNC_READ;
+        tx_message[++msg_index] = DXL_PRESENT_POSITION & 0xFF;           // low order address
+        tx_message[++msg_index] = (DXL_PRESENT_POSITION & 0xFF00) >> 8;  // high order address
+        tx_message[++msg_index] = 4;                                     // low order data length
+        tx_message[++msg_index] = 0;                                     // high order data length
+
+        auto n_axis = number_axis->get();
+        for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+            for (uint8_t gang_index = 0; gang_index < 2; gang_index++) {
+                Dynamixel2* p = servos[axis][gang_index];
+                if (p != NULL && p->_disabled && !p->_has_errors) {
+                    tx_message[++msg_index] = p->_id;
+                    count++;
+                }
+            }
+        }
+        if (count == 0) {
+            return;
+        }
+
+        int64_t start = esp_timer_get_time();
+        dxl_finish_message(DXL_BROADCAST_ID, tx_message, count + 7);
+        int len = uart_read_bytes(UART_NUM_2, rx_message, count * DXL_POSITION_RSP_LEN, DXL_RESPONSE_WAIT_TICKS);
+
+        stats.sync_reads++;
+        stats.last_read_us = esp_timer_get_time() - start;
+        stats.max_read_us  = MAX(stats.max_read_us, stats.last_read_us);
+        if (len < count * DXL_POSITION_RSP_LEN) {
+            stats.read_timeouts++;
+        }
+
+        bool moved = false;
+        for (int pos = 0; pos + DXL_POSITION_RSP_LEN <= len; pos += DXL_POSITION_RSP_LEN) {
+            const uint8_t* rsp = &rx_message[pos];
+            if (rsp[DXL_MSG_HDR1] != 0xFF || rsp[DXL_MSG_HDR2] != 0xFF || rsp[DXL_MSG_HDR3] != 0xFD) {
+                break;  // Out of step with the packets
+            }
+            uint32_t dxl_position = rsp[9] | (rsp[10] << 8) | (rsp[11] << 16) | (rsp[12] << 24);
+            for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+                for (uint8_t gang_index = 0; gang_index < 2; gang_index++) {
+                    Dynamixel2* p = servos[axis][gang_index];
+                    if (p != NULL && p->_id == rsp[DXL_MSG_ID]) {
+                        p->set_position_from_count(dxl_position);
+                        moved = true;
+                    }
+                }
+            }
+        }
+        if (moved) {
+            plan_sync_position();
+        }
     }
 
     /*
@@ -411,8 +483,8 @@ namespace Motors {
 
     // from http://emanual.robotis.com/docs/en/dxl/crc/
     uint16_t Dynamixel2::dxl_update_crc(uint16_t crc_accum, char* data_blk_ptr, uint8_t data_blk_size) {
-        uint16_t i, j;
-        uint16_t crc_table[256] = {
+        uint16_t              i, j;
+        static const uint16_t crc_table[256] = {
             0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011, 0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
             0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072, 0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
             0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2, 0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
@@ -439,3 +511,18 @@ namespace Motors {
         return crc_accum;
     }
 }
+
+void dynamixel_report_stats(uint8_t client) {
+    auto& stats = Motors::Dynamixel2::stats;
+    grbl_sendf(client,
+               "Dynamixel sync writes %u, sync reads %u, read timeouts %u, read latency last %u us, max %u us\r\n",
+               stats.sync_writes,
+               stats.sync_reads,
+               stats.read_timeouts,
+               stats.last_read_us,
+               stats.max_read_us);
+}
+
+void dynamixel_reset_stats() {
+    memset(&Motors::Dynamixel2::stats, 0, sizeof(Motors::Dynamixel2::stats));
+}
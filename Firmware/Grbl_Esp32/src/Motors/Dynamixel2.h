@@ -44,8 +44,11 @@ const int DXL_INSTR_PING = 0x01;
 const int PING_RSP_LEN   = 14;
 const int DXL_READ       = 0x02;
 const int DXL_WRITE      = 0x03;
+const int DXL_SYNC_READ  = 0x82;
 const int DXL_SYNC_WRITE = 0x83;
 
+const int DXL_POSITION_RSP_LEN = 15;  // Status packet with a 4 byte position
+
 // protocol 2 register locations
 const int DXL_OPERATING_MODE   = 11;
 const int DXL_ADDR_TORQUE_EN   = 64;
@@ -87,12 +90,29 @@ namespace Motors {
         static bool    uart_ready;
         static uint8_t ids[MAX_N_AXIS][2];
 
+        // Bus traffic of the batched updates, for $Dynamixel/Stats
+        typedef struct {
+            uint32_t sync_writes;
+            uint32_t sync_reads;
+            uint32_t read_timeouts;  // Sync reads where some servo did not answer
+            uint32_t last_read_us;   // From the request to the last answer
+            uint32_t max_read_us;
+        } stats_t;
+        static stats_t stats;
+
 
     protected:
         void config_message() override;
 
         void set_location();
 
+        // Enabled servos move together from one sync write. Disabled ones report back where they
+        // were moved by hand, so they are read every period, all of them with one sync read.
+        const void* update_group() override { return _disabled ? (const void*)servos : ids; }
+        bool        needs_poll() override { return _disabled; }
+
+        static Dynamixel2* servos[MAX_N_AXIS][2];  // By axis, for the sync read answers
+
         uint8_t _id;
         char    _dxl_tx_message[50];  // outgoing to dynamixel
         uint8_t _dxl_rx_message[50];  // received from dynamixel
@@ -110,6 +130,8 @@ namespace Motors {
         static void     dxl_finish_message(uint8_t id, char* msg, uint16_t msg_len);
         static uint16_t dxl_update_crc(uint16_t crc_accum, char* data_blk_ptr, uint8_t data_blk_size);
         static void     dxl_bulk_goal_position();  // set all motorsd init_uart(uint8_t id, uint8_t axis_index, uint8_t dual_axis_index);
+        static void     dxl_sync_read_positions();  // read all disabled motors
+        void            set_position_from_count(uint32_t dxl_position);
 
         float _homing_position;
 
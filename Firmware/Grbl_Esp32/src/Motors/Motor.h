@@ -67,6 +67,12 @@ namespace Motors {
         // make a motor transition between idle and non-idle states.
         virtual void set_disable(bool disable) {}
 
+        // disable_pin() reports the enable pin of a motor whose
+        // set_disable() does nothing but write it, so that
+        // motors_set_disable() can write them all at once.  It
+        // returns false if set_disable() does anything else.
+        virtual bool disable_pin(uint8_t& pin) { return false; }
+
         // set_direction() sets the motor movement direction.  It is
         // invoked for every motion segment.
         virtual void set_direction(bool) {}
@@ -83,6 +89,44 @@ namespace Motors {
         // states of the step pins are unknown.
         virtual void unstep() {}
 
+        // i2s_step_mask() reports the I2S port bits that step() and
+        // unstep() toggle, so that the I2S stream can write whole
+        // segments of steps without calling them.  It returns false
+        // if the motor steps by any other means.  Motors whose step()
+        // does nothing return true with an empty mask.
+        virtual bool i2s_step_mask(uint32_t& mask) {
+            mask = 0;
+            return true;
+        }
+
+        // rmt_step_channel() reports the RMT channel that step()
+        // starts, so that RMT burst stepping can load a whole run of
+        // pulses into the channel memory.  It returns false if the
+        // motor steps by any other means.  Motors whose step() does
+        // nothing return true with RMT_CHANNEL_MAX.
+        virtual bool rmt_step_channel(rmt_channel_t& channel) {
+            channel = RMT_CHANNEL_MAX;
+            return true;
+        }
+
+        // step_gpio() reports the GPIO step and direction pins of a
+        // motor and whether they are inverted, so that the pulses
+        // can be counted in hardware.  It returns false if either
+        // is not a GPIO, or the motor does not step.
+        virtual bool step_gpio(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) { return false; }
+
+        // step_pins() reports the step and direction pins, GPIO or
+        // I2S, of a motor whose step(), unstep() and set_direction()
+        // do nothing but write them, so that motors_step() and the
+        // others can write every motor's pins at once as masks.  It
+        // returns false if those methods do anything else.  Motors
+        // whose methods do nothing return true with UNDEFINED_PIN.
+        virtual bool step_pins(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) {
+            step_pin = dir_pin = UNDEFINED_PIN;
+            invert_step = invert_dir = false;
+            return true;
+        }
+
         // test(), called from init(), checks to see if a motor is
         // responsive, returning true on failure.  Typical
         // implementations also display messages to show the result.
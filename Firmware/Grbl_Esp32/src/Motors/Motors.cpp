@@ -44,7 +44,83 @@
 #include "TrinamicUartDriver.h"
 
 Motors::Motor* myMotor[MAX_AXES][MAX_GANGED];  // number of axes (normal and ganged)
-void           init_motors() {
+
+// Step and direction output as register writes. The pins of the motors that report them with
+// step_pins() are folded into masks when the motors are set up and when the ganged mode
+// changes, so a step is a few register writes however many motors there are. The motors that
+// do not report pins are still called, as gangs marked in motor_called.
+static motors_pin_mask_t motor_step_mask[MAX_AXES][MAX_GANGED];  // Active step level of each motor
+static motors_pin_mask_t axis_step_mask[MAX_AXES];               // Of the motors the ganged mode steps
+static motors_pin_mask_t unstep_mask;                            // Idle step level of all motors
+static motors_pin_mask_t axis_dir_mask[MAX_AXES][2];             // Direction pins for each direction
+static motors_pin_mask_t axis_disable_mask[MAX_AXES][2];         // Enable pins, enabled and disabled
+static uint8_t           motor_called[MAX_AXES];
+static uint8_t           axis_called[MAX_AXES];  // Of the gangs the ganged mode steps
+static uint8_t           pin_mask_axes;          // Bits of the configured axes
+static SquaringMode      pin_mask_mode;
+static uint8_t           disable_called[MAX_AXES];  // Gangs whose set_disable() must be called
+
+static inline void IRAM_ATTR pin_mask_or(motors_pin_mask_t& mask, const motors_pin_mask_t& other) {
+    mask.gpio_set[0] |= other.gpio_set[0];
+    mask.gpio_set[1] |= other.gpio_set[1];
+    mask.gpio_clear[0] |= other.gpio_clear[0];
+    mask.gpio_clear[1] |= other.gpio_clear[1];
+    mask.i2s_set |= other.i2s_set;
+    mask.i2s_clear |= other.i2s_clear;
+}
+
+static void IRAM_ATTR motors_update_axis_masks() {
+    pin_mask_mode = ganged_mode;
+    bool    use_a = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A);
+    bool    use_b = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B);
+    uint8_t gangs = (use_a ? bit(0) : 0) | (use_b ? bit(1) : 0);
+    for (int axis = 0; axis < MAX_AXES; axis++) {
+        axis_step_mask[axis] = {};
+        if (use_a) {
+            pin_mask_or(axis_step_mask[axis], motor_step_mask[axis][0]);
+        }
+        if (use_b) {
+            pin_mask_or(axis_step_mask[axis], motor_step_mask[axis][1]);
+        }
+        axis_called[axis] = motor_called[axis] & gangs;
+    }
+}
+
+// After the motors have read their settings, which can change the pins and their invert
+static void motors_update_pin_masks() {
+    auto n_axis = number_axis->get();
+    memset(motor_step_mask, 0, sizeof(motor_step_mask));
+    memset(axis_dir_mask, 0, sizeof(axis_dir_mask));
+    memset(axis_disable_mask, 0, sizeof(axis_disable_mask));
+    memset(motor_called, 0, sizeof(motor_called));
+    memset(disable_called, 0, sizeof(disable_called));
+    unstep_mask   = {};
+    pin_mask_axes = 0;
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        pin_mask_axes |= bit(axis);
+        for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+            uint8_t step_pin, dir_pin, disable_pin;
+            bool    invert_step, invert_dir;
+            if (myMotor[axis][gang]->disable_pin(disable_pin)) {
+                pin_mask_add(axis_disable_mask[axis][0], disable_pin, false);
+                pin_mask_add(axis_disable_mask[axis][1], disable_pin, true);
+            } else {
+                disable_called[axis] |= bit(gang);
+            }
+            if (!myMotor[axis][gang]->step_pins(step_pin, dir_pin, invert_step, invert_dir)) {
+                motor_called[axis] |= bit(gang);
+                continue;
+            }
+            pin_mask_add(motor_step_mask[axis][gang], step_pin, !invert_step);
+            pin_mask_add(unstep_mask, step_pin, invert_step);
+            pin_mask_add(axis_dir_mask[axis][0], dir_pin, invert_dir);
+            pin_mask_add(axis_dir_mask[axis][1], dir_pin, !invert_dir);
+        }
+    }
+    motors_update_axis_masks();
+}
+
+void init_motors() {
     // grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Init Motors");
 
     auto n_axis = number_axis->get();
@@ -409,6 +485,10 @@ void           init_motors() {
             myMotor[axis][gang_index]->init();
         }
     }
+    motors_update_pin_masks();
+#ifdef USE_STEP_PCNT
+    step_verify_init();
+#endif
 }
 
 void motors_set_disable(bool disable, uint8_t mask) {
@@ -422,22 +502,32 @@ void motors_set_disable(bool disable, uint8_t mask) {
     prev_disable = disable;
     prev_mask    = mask;
 
+    if (disable) {
+        limits_distrust(mask);  // A motor without current can be moved by hand
+    }
+
     if (step_enable_invert->get()) {
         disable = !disable;  // Apply pin invert.
     }
 
-    // now loop through all the motors to see if they can individually disable
-    auto n_axis = number_axis->get();
-    for (uint8_t gang_index = 0; gang_index < MAX_GANGED; gang_index++) {
-        for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
-            if (bitnum_istrue(mask, axis)) {
-                myMotor[axis][gang_index]->set_disable(disable);
+    // The motors that only write a pin are written together with the global pin, the others
+    // are asked to disable themselves
+    motors_pin_mask_t pins   = {};
+    auto              n_axis = number_axis->get();
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        if (bitnum_istrue(mask, axis)) {
+            pin_mask_or(pins, axis_disable_mask[axis][disable]);
+            for (uint8_t gang_index = 0; gang_index < MAX_GANGED; gang_index++) {
+                if (bitnum_istrue(disable_called[axis], gang_index)) {
+                    myMotor[axis][gang_index]->set_disable(disable);
+                }
             }
         }
     }
 
     // global disable.
-    digitalWrite(STEPPERS_DISABLE_PIN, disable);
+    pin_mask_add(pins, STEPPERS_DISABLE_PIN, disable);
+    pin_mask_write(pins);
 
     // Add an optional delay for stepper drivers. that need time
     // Some need time after the enable before they can step.
@@ -459,6 +549,10 @@ void motors_read_settings() {
             myMotor[axis][gang_index]->read_settings();
         }
     }
+    motors_update_pin_masks();
+#ifdef USE_STEP_PCNT
+    step_verify_init();  // The pins were set up again
+#endif
 }
 
 // use this to tell all the motors what the current homing mode is
@@ -477,48 +571,134 @@ uint8_t motors_set_homing_mode(uint8_t homing_mask, bool isHoming) {
     return can_home;
 }
 
-bool motors_direction(uint8_t dir_mask) {
-    auto n_axis = number_axis->get();    //mks-wang
-    //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "motors_set_direction_pins:0x%02X", onMask);
+volatile AxisMask motors_stall_mask       = 0;
+volatile uint32_t motors_stall_generation = 0;
+volatile bool     motors_stall_armed      = false;
+
+void motors_stall_arm(bool armed) {
+    motors_stall_armed = armed;
+    motors_stall_generation++;  // Drivers reset their detection when this changes
+    motors_stall_mask = 0;
+}
 
+static motors_poll_t    motors_polls[MOTORS_POLL_MAX];
+static TickType_t       motors_poll_due[MOTORS_POLL_MAX];
+static volatile uint8_t motors_n_polls = 0;
+
+// Runs each poll when it is due, and sleeps until the next one is
+static void motorsPollTask(void* pvParameters) {
+    while (true) {  // don't ever return from this or the task dies
+        TickType_t next = portMAX_DELAY;
+        for (uint8_t i = 0; i < motors_n_polls; i++) {
+            if (int32_t(xTaskGetTickCount() - motors_poll_due[i]) >= 0) {
+                motors_poll_due[i] = xTaskGetTickCount() + pdMS_TO_TICKS(motors_polls[i]());
+            }
+            next = MIN(next, TickType_t(MAX(int32_t(motors_poll_due[i] - xTaskGetTickCount()), 1)));
+        }
+        vTaskDelay(next);
+
+        static UBaseType_t uxHighWaterMark = 0;
+#ifdef DEBUG_TASK_STACK
+        reportTaskStackSize(uxHighWaterMark);
+#endif
+    }
+}
+
+void motors_add_poll(motors_poll_t poll) {
+    if (motors_n_polls == MOTORS_POLL_MAX) {
+        return;
+    }
+    motors_polls[motors_n_polls]    = poll;
+    motors_poll_due[motors_n_polls] = xTaskGetTickCount();
+    if (motors_n_polls++ == 0) {
+        xTaskCreatePinnedToCore(motorsPollTask,    // task
+                                "motorsPollTask",  // name for task
+                                4096,              // size of task stack
+                                NULL,              // parameters
+                                1,                 // priority
+                                NULL,
+                                SUPPORT_TASK_CORE  // must run the task on same core
+        );
+    }
+}
+
+bool IRAM_ATTR motors_direction(uint8_t dir_mask) {
     // Set the direction pins, but optimize for the common
     // situation where the direction bits haven't changed.
     static uint8_t previous_dir = 255;  // should never be this value
     if (dir_mask != previous_dir) {
         previous_dir = dir_mask;
 
-        for (int axis = X_AXIS; axis < n_axis; axis++) {
+        motors_pin_mask_t out = {};
+        for (uint8_t axes = pin_mask_axes; axes; axes &= axes - 1) {
+            int  axis    = __builtin_ctz(axes);
             bool thisDir = bitnum_istrue(dir_mask, axis);
-            myMotor[axis][0]->set_direction(thisDir);
-            myMotor[axis][1]->set_direction(thisDir);
+            pin_mask_or(out, axis_dir_mask[axis][thisDir]);
+            for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+                if (motor_called[axis] & bit(gang)) {
+                    myMotor[axis][gang]->set_direction(thisDir);
+                }
+            }
         }
+        pin_mask_write(out);
         return true;
     } else {
         return false;
     }
 }
 
-void motors_step(uint8_t step_mask) {
-    auto n_axis = number_axis->get();
-    //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "motors_set_direction_pins:0x%02X", onMask);
-
+void IRAM_ATTR motors_step(uint8_t step_mask) {
+    if (ganged_mode != pin_mask_mode) {
+        motors_update_axis_masks();
+    }
     // Turn on step pulses for motors that are supposed to step now
-    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
-        if (bitnum_istrue(step_mask, axis)) {
-            if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A)) {
-                myMotor[axis][0]->step();
-            }
-            if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B)) {
-                myMotor[axis][1]->step();
+    motors_pin_mask_t out = {};
+    for (uint8_t axes = step_mask & pin_mask_axes; axes; axes &= axes - 1) {
+        int axis = __builtin_ctz(axes);
+        pin_mask_or(out, axis_step_mask[axis]);
+        for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+            if (axis_called[axis] & bit(gang)) {
+                myMotor[axis][gang]->step();
             }
         }
     }
+    pin_mask_write(out);
 }
 // Turn all stepper pins off
-void motors_unstep() {
+void IRAM_ATTR motors_unstep() {
+    pin_mask_write(unstep_mask);
+    for (uint8_t axes = pin_mask_axes; axes; axes &= axes - 1) {
+        int axis = __builtin_ctz(axes);
+        for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+            if (motor_called[axis] & bit(gang)) {
+                myMotor[axis][gang]->unstep();
+            }
+        }
+    }
+}
+
+bool motors_i2s_step_masks(uint32_t masks[MAX_N_AXIS][MAX_GANGED]) {
+    auto n_axis = number_axis->get();
+    bool ok     = true;
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+            ok &= myMotor[axis][gang]->i2s_step_mask(masks[axis][gang]);
+        }
+    }
+    return ok;
+}
+
+bool motors_rmt_step_channels(rmt_channel_t channels[MAX_N_AXIS][MAX_GANGED]) {
     auto n_axis = number_axis->get();
+    bool ok     = true;
     for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
-        myMotor[axis][0]->unstep();
-        myMotor[axis][1]->unstep();
+        for (uint8_t gang = 0; gang < MAX_GANGED; gang++) {
+            ok &= myMotor[axis][gang]->rmt_step_channel(channels[axis][gang]);
+        }
     }
+    return ok;
+}
+
+bool motors_step_gpio(uint8_t axis, uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) {
+    return myMotor[axis][0]->step_gpio(step_pin, dir_pin, invert_step, invert_dir);
 }
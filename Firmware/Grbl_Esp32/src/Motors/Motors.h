@@ -30,18 +30,88 @@
 */
 
 #include "../Grbl.h"
+#include "../I2SOut.h"
+
+#include <soc/gpio_struct.h>
+
+// Pins to drive together with a few register writes, a bit for each pin in the levels it is set
+// to. Built once with pin_mask_add(), so the ISR only writes the masks.
+typedef struct {
+    uint32_t gpio_set[2];  // GPIO 0-31 and 32-39
+    uint32_t gpio_clear[2];
+    uint32_t i2s_set;
+    uint32_t i2s_clear;
+} motors_pin_mask_t;
+
+inline void pin_mask_add(motors_pin_mask_t& mask, uint8_t pin, bool level) {
+    if (pin == UNDEFINED_PIN) {
+        return;
+    }
+    if (pin >= I2S_OUT_PIN_BASE) {
+        (level ? mask.i2s_set : mask.i2s_clear) |= bit(pin - I2S_OUT_PIN_BASE);
+    } else {
+        (level ? mask.gpio_set : mask.gpio_clear)[pin / 32] |= bit(pin % 32);
+    }
+}
+
+inline void IRAM_ATTR pin_mask_write(const motors_pin_mask_t& mask) {
+    if (mask.gpio_set[0]) {
+        GPIO.out_w1ts = mask.gpio_set[0];
+    }
+    if (mask.gpio_clear[0]) {
+        GPIO.out_w1tc = mask.gpio_clear[0];
+    }
+    if (mask.gpio_set[1]) {
+        GPIO.out1_w1ts.val = mask.gpio_set[1];
+    }
+    if (mask.gpio_clear[1]) {
+        GPIO.out1_w1tc.val = mask.gpio_clear[1];
+    }
+#ifdef USE_I2S_OUT
+    if (mask.i2s_set | mask.i2s_clear) {
+        i2s_out_write_mask(mask.i2s_set, mask.i2s_clear);
+    }
+#endif
+}
 
 // These are used for setup and to talk to the motors as a group.
 void    init_motors();
 uint8_t get_next_trinamic_driver_index();
-void    readSgTask(void* pvParameters);
 void    motors_read_settings();
 
+// Driver status polling. All driver types share one task, which calls each poll when it is due;
+// a poll returns the ms until it wants to run again.
+const int MOTORS_POLL_MAX = 4;
+typedef uint32_t (*motors_poll_t)();
+void motors_add_poll(motors_poll_t poll);
+
 // The return value is a bitmask of axes that can home
 uint8_t motors_set_homing_mode(uint8_t homing_mask, bool isHoming);
+
+// Sensorless homing. Motors that detect a stall from their load signal set the axis bit in
+// motors_stall_mask, which limits_get_state() reports like a triggered switch.
+// motors_stall_arm() clears it at the start of each homing move, and detection restarts on
+// the next motion only when armed, so pull-off moves never report a stall.
+extern volatile AxisMask motors_stall_mask;
+extern volatile uint32_t motors_stall_generation;
+extern volatile bool     motors_stall_armed;
+void                     motors_stall_arm(bool armed);
 void    motors_set_disable(bool disable, uint8_t mask = B11111111);  // default is all axes
 bool    motors_direction(uint8_t dir_mask);
 void    motors_step(uint8_t step_mask);
 void    motors_unstep();
 
+// Fills masks with the I2S step bits of each motor. Returns false if any motor steps outside I2S.
+bool motors_i2s_step_masks(uint32_t masks[MAX_N_AXIS][MAX_GANGED]);
+
+// Fills channels with the RMT step channel of each motor. Returns false if any motor steps outside RMT.
+bool motors_rmt_step_channels(rmt_channel_t channels[MAX_N_AXIS][MAX_GANGED]);
+
+// The GPIO step and direction pins of the first motor on axis. Returns false if it has none.
+bool motors_step_gpio(uint8_t axis, uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir);
+
 void servoUpdateTask(void* pvParameters);
+
+// Bus statistics of the Dynamixel servos, for $Dynamixel/Stats
+void dynamixel_report_stats(uint8_t client);
+void dynamixel_reset_stats();
@@ -81,6 +81,8 @@ namespace Motors {
         _disabled = disable;
         if (_disabled) {
             _write_pwm(0);
+        } else {
+            request_update();  // Restore the pulse, even if the axis does not move
         }
     }
 
@@ -44,6 +44,9 @@ namespace Motors {
 
         void set_location();
 
+        // The PWM repeats once per frame, so updates faster than that do not move it sooner
+        uint32_t update_period_ms() override { return 1000 / SERVO_PULSE_FREQ; }
+
         uint8_t  _pwm_pin;
         uint8_t  _channel_num;
         uint32_t _current_pwm_duty;
@@ -53,19 +53,47 @@ namespace Motors {
         }
     }
 
+    bool Servo::update_due(TickType_t now) {
+        if (now - _updated_tick < update_period_ms() / portTICK_PERIOD_MS) {
+            return false;
+        }
+        return _update_requested || needs_poll() || sys_position[_axis_index] != _updated_position;
+    }
+
+    // Before update(), so a move during the update is seen on the next pass
+    void Servo::mark_updated(TickType_t now) {
+        _updated_position = sys_position[_axis_index];
+        _updated_tick     = now;
+        _update_requested = false;
+    }
+
+    // One task for all servos. Each one is updated when its axis has moved, or when it asks,
+    // at most once per update_period_ms(), so a servo standing still costs no bus traffic.
     void Servo::updateTask(void* pvParameters) {
-        TickType_t       xLastWakeTime;
-        const TickType_t xUpdate = SERVO_TIMER_INTERVAL;  // in ticks (typically ms)
-        auto             n_axis  = number_axis->get();
+        TickType_t xLastWakeTime;
 
         xLastWakeTime = xTaskGetTickCount();  // Initialise the xLastWakeTime variable with the current time.
         vTaskDelay(2000);                     // initial delay
         while (true) {                        // don't ever return from this or the task dies
+            TickType_t now = xTaskGetTickCount();
             for (Servo* p = List; p; p = p->link) {
+                if (!p->update_due(now)) {
+                    continue;
+                }
+                const void* group = p->update_group();
+                if (group == NULL) {
+                    p->mark_updated(now);
+                } else {
+                    for (Servo* q = p; q; q = q->link) {
+                        if (q->update_group() == group) {
+                            q->mark_updated(now);
+                        }
+                    }
+                }
                 p->update();
             }
 
-            vTaskDelayUntil(&xLastWakeTime, xUpdate);
+            vTaskDelayUntil(&xLastWakeTime, SERVO_SCHEDULE_TICK_MS / portTICK_PERIOD_MS);
 
             static UBaseType_t uxHighWaterMark = 0;
 #ifdef DEBUG_TASK_STACK
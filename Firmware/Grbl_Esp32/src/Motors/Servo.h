@@ -25,6 +25,10 @@
 
 #include "Motor.h"
 
+// The update task wakes this often and updates each servo whose axis moved, no more often than
+// the servo's update_period_ms()
+const int SERVO_SCHEDULE_TICK_MS = 5;
+
 namespace Motors {
     class Servo : public Motor {
     public:
@@ -45,10 +49,30 @@ namespace Motors {
         // it starts the task.
         void startUpdateTask();
 
+        // The shortest time between updates that this actuator needs
+        virtual uint32_t update_period_ms() { return SERVO_TIMER_INTERVAL; }
+
+        // Servos that one update() call moves together, like Dynamixels written with one sync
+        // write, return the same group. The task only calls the first of them that is due.
+        virtual const void* update_group() { return NULL; }
+
+        // Whether to update every period even while the axis does not move
+        virtual bool needs_poll() { return false; }
+
+        // Updates the servo on the next pass even if its axis has not moved
+        void request_update() { _update_requested = true; }
+
     private:
         // Linked list of servo instances, used by the servo task
         static Servo* List;
         Servo*        link;
         static void   updateTask(void*);
+
+        bool update_due(TickType_t now);
+        void mark_updated(TickType_t now);
+
+        int32_t       _updated_position = 0;  // sys_position of the axis at the last update
+        TickType_t    _updated_tick     = 0;
+        volatile bool _update_requested = true;
     };
 }
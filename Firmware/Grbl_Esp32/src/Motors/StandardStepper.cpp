@@ -24,6 +24,13 @@
 #include "StandardStepper.h"
 
 namespace Motors {
+#ifdef USE_RMT_BURST
+    // A burst fills the channel's whole memory block, so it must not spill into the next channel's
+    const uint8_t RMT_STEP_MEM_BLOCKS = 1;
+#else
+    const uint8_t RMT_STEP_MEM_BLOCKS = 2;
+#endif
+
     rmt_item32_t StandardStepper::rmtItem[2];
     rmt_config_t StandardStepper::rmtConfig;
 
@@ -61,7 +68,7 @@ namespace Motors {
 #ifdef USE_RMT_STEPS
         rmtConfig.rmt_mode                       = RMT_MODE_TX;
         rmtConfig.clk_div                        = 20;
-        rmtConfig.mem_block_num                  = 2;
+        rmtConfig.mem_block_num                  = RMT_STEP_MEM_BLOCKS;
         rmtConfig.tx_config.loop_en              = false;
         rmtConfig.tx_config.carrier_en           = false;
         rmtConfig.tx_config.carrier_freq_hz      = 0;
@@ -106,7 +113,7 @@ namespace Motors {
                        reportAxisLimitsMsg(_axis_index));
     }
 
-    void StandardStepper::step() {
+    void IRAM_ATTR StandardStepper::step() {
 #ifdef USE_RMT_STEPS
         RMT.conf_ch[_rmt_chan_num].conf1.mem_rd_rst = 1;
         RMT.conf_ch[_rmt_chan_num].conf1.tx_start   = 1;
@@ -115,15 +122,72 @@ namespace Motors {
 #endif  // USE_RMT_STEPS
     }
 
-    void StandardStepper::unstep() {
+    void IRAM_ATTR StandardStepper::unstep() {
 #ifndef USE_RMT_STEPS
         digitalWrite(_step_pin, _invert_step_pin);
 #endif  // USE_RMT_STEPS
     }
 
-    void StandardStepper::set_direction(bool dir) { digitalWrite(_dir_pin, dir ^ _invert_dir_pin); }
+    bool StandardStepper::i2s_step_mask(uint32_t& mask) {
+        mask = 0;
+#ifdef USE_RMT_STEPS
+        return _step_pin == UNDEFINED_PIN;
+#else
+        if (_step_pin == UNDEFINED_PIN) {
+            return true;
+        }
+        if (_step_pin < I2S_OUT_PIN_BASE) {
+            return false;
+        }
+        mask = bit(_step_pin - I2S_OUT_PIN_BASE);
+        return true;
+#endif
+    }
+
+    bool StandardStepper::rmt_step_channel(rmt_channel_t& channel) {
+        channel = RMT_CHANNEL_MAX;
+#ifdef USE_RMT_STEPS
+        if (_step_pin == UNDEFINED_PIN) {
+            return true;
+        }
+        channel = _rmt_chan_num;
+        return _rmt_chan_num != RMT_CHANNEL_MAX;
+#else
+        return _step_pin == UNDEFINED_PIN;
+#endif
+    }
+
+    bool StandardStepper::step_gpio(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) {
+        if (_step_pin == UNDEFINED_PIN || _step_pin >= I2S_OUT_PIN_BASE || _dir_pin == UNDEFINED_PIN || _dir_pin >= I2S_OUT_PIN_BASE) {
+            return false;
+        }
+        step_pin    = _step_pin;
+        dir_pin     = _dir_pin;
+        invert_step = _invert_step_pin;
+        invert_dir  = _invert_dir_pin;
+        return true;
+    }
+
+    bool StandardStepper::step_pins(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) {
+#ifdef USE_RMT_STEPS
+        return false;  // step() starts the RMT channel
+#else
+        step_pin    = _step_pin;
+        dir_pin     = _dir_pin;
+        invert_step = _invert_step_pin;
+        invert_dir  = _invert_dir_pin;
+        return true;
+#endif
+    }
+
+    void IRAM_ATTR StandardStepper::set_direction(bool dir) { digitalWrite(_dir_pin, dir ^ _invert_dir_pin); }
 
     void StandardStepper::set_disable(bool disable) {
         digitalWrite(_disable_pin, disable);
     }
+
+    bool StandardStepper::disable_pin(uint8_t& pin) {
+        pin = _disable_pin;
+        return true;
+    }
 }
@@ -12,9 +12,14 @@ namespace Motors {
         // No special action, but return true to say homing is possible
         bool set_homing_mode(bool isHoming) override { return true; }
         void set_disable(bool) override;
+        bool disable_pin(uint8_t& pin) override;
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool i2s_step_mask(uint32_t& mask) override;
+        bool rmt_step_channel(rmt_channel_t& channel) override;
+        bool step_gpio(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) override;
+        bool step_pins(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) override;
         void read_settings() override;
 
         void init_step_dir_pins();
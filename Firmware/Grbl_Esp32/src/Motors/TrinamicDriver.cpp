@@ -21,14 +21,20 @@
 
 #include <TMCStepper.h>
 
-#ifdef USE_I2S_OUT
+// Chip selects made by the TMCStepper library. A library transfer between two status polls
+// takes the place of the read request the first one left in the drivers.
+static volatile uint32_t tmc_library_selects = 0;
 
-// Override default function and insert a short delay
+// Override default function, to count the transfers and insert a short delay with I2S
 void TMC2130Stepper::switchCSpin(bool state) {
     digitalWrite(_pinCS, state);
+#ifdef USE_I2S_OUT
     i2s_out_delay();
-}
 #endif
+    if (!state) {
+        tmc_library_selects++;
+    }
+}
 
 namespace Motors {
     uint8_t TrinamicDriver::get_next_index() {
@@ -105,18 +111,10 @@ namespace Motors {
         read_settings();  // pull info from settings
         set_mode(false);
 
-        // After initializing all of the TMC drivers, create a task to
-        // display StallGuard data.  List == this for the final instance.
+        // After initializing all of the TMC drivers, start polling them.
+        // List == this for the final instance.
         if (List == this) {
-            xTaskCreatePinnedToCore(readSgTask,    // task
-                                    "readSgTask",  // name for task
-                                    4096,          // size of task stack
-                                    NULL,          // parameters
-                                    1,             // priority
-                                    NULL,
-                                    SUPPORT_TASK_CORE  // must run the task on same core
-                                                       // core
-            );
+            motors_add_poll(poll);
         }
     }
 
@@ -254,8 +252,10 @@ namespace Motors {
                 //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Stallguard");
                 tmcstepper->en_pwm_mode(false);
                 tmcstepper->pwm_autoscale(false);
-                tmcstepper->TCOOLTHRS(calc_tstep(homing_feed_rate->get(), 150.0));
-                tmcstepper->THIGH(calc_tstep(homing_feed_rate->get(), 60.0));
+                // StallGuard works between TCOOLTHRS and THIGH, so the window covers both the
+                // seek and the locate rates, and the seek no longer has to run at the feed rate
+                tmcstepper->TCOOLTHRS(calc_tstep(MIN(homing_feed_rate->get(), homing_seek_rate->get()), 150.0));
+                tmcstepper->THIGH(calc_tstep(MAX(homing_feed_rate->get(), homing_seek_rate->get()), 60.0));
                 tmcstepper->sfilt(1);
                 tmcstepper->diag1_stall(true);  // stallguard i/o is on diag1
                 tmcstepper->sgt(constrain(axis_settings[_axis_index]->stallguard->get(), -64, 63));
@@ -272,25 +272,25 @@ namespace Motors {
         if (_has_errors) {
             return;
         }
-        uint32_t tstep = tmcstepper->TSTEP();
+        // From the last poll, read_all_status(), so the report adds no library transfers
+        TMC2130_n ::DRV_STATUS_t status { 0 };  // a useful struct to access the bits.
+        status.sr = _drv_status;
 
-        if (tstep == 0xFFFFF || tstep < 1) {  // if axis is not moving return
+        if (status.stst) {  // if axis is not moving return
             return;
         }
         float feedrate = st_get_realtime_rate();  //* settings.microsteps[axis_index] / 60.0 ; // convert mm/min to Hz
 
         grbl_msg_sendf(CLIENT_SERIAL,
                        MsgLevel::Info,
-                       "%s Stallguard %d   SG_Val: %04d   Rate: %05.0f mm/min SG_Setting:%d",
+                       "%s Stallguard %d   SG_Val: %04d   SG_Min: %04d   Rate: %05.0f mm/min SG_Setting:%d",
                        reportAxisNameMsg(_axis_index, _dual_axis_index),
-                       tmcstepper->stallguard(),
-                       tmcstepper->sg_result(),
+                       status.stallGuard,
+                       status.sg_result,
+                       _sg_min,
                        feedrate,
                        constrain(axis_settings[_axis_index]->stallguard->get(), -64, 63));
 
-        TMC2130_n ::DRV_STATUS_t status { 0 };  // a useful struct to access the bits.
-        status.sr = tmcstepper->DRV_STATUS();
-
         // these only report if there is a fault condition
         report_open_load(status);
         report_short_to_ground(status);
@@ -347,32 +347,167 @@ namespace Motors {
         // This would be for individual motors, not the single pin for all motors.
     }
 
-    // Prints StallGuard data that is useful for tuning.
-    void TrinamicDriver::readSgTask(void* pvParameters) {
-        TickType_t       xLastWakeTime;
-        const TickType_t xreadSg = 200;  // in ticks (typically ms)
-        auto             n_axis  = number_axis->get();
-
-        xLastWakeTime = xTaskGetTickCount();  // Initialise the xLastWakeTime variable with the current time.
-        while (true) {                        // don't ever return from this or the task dies
-            if (stallguard_debug_mask->get() != 0) {
-                if (sys.state == State::Cycle || sys.state == State::Homing || sys.state == State::Jog) {
-                    for (TrinamicDriver* p = List; p; p = p->link) {
-                        if (bitnum_istrue(stallguard_debug_mask->get(), p->_axis_index)) {
-                            //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "SG:%d", stallguard_debug_mask->get());
-                            p->debug_message();
-                        }
-                    }
-                }  // sys.state
-            }      // if mask
-
-            vTaskDelayUntil(&xLastWakeTime, xreadSg);
-
-            static UBaseType_t uxHighWaterMark = 0;
-#ifdef DEBUG_TASK_STACK
-            reportTaskStackSize(uxHighWaterMark);
+    /*
+    Reads DRV_STATUS from every driver, with one SPI transaction per chip select line, so a daisy
+    chain of four drivers costs one 20 byte transfer instead of four pairs of library transfers.
+    In a chain, the first datagram sent ends up in the driver furthest from the MCU, which is the
+    one with the highest chain index, and the first datagram received comes from that driver too.
+    TMC2130 reads are pipelined: each datagram returns the register asked for by the previous
+    one. Every poll asks for DRV_STATUS again, so it returns what the last poll asked for.
+    Returns false if a library transfer came in between on any line; that poll only asks again.
+*/
+    bool TrinamicDriver::read_all_status() {
+        const uint8_t DRV_STATUS_ADDRESS = 0x6F;
+        bool          valid              = true;
+
+        for (TrinamicDriver* first = List; first; first = first->link) {
+            // Each chip select line once, from the first driver on it in the list
+            bool done = false;
+            for (TrinamicDriver* p = List; p != first; p = p->link) {
+                done = done || p->_cs_pin == first->_cs_pin;
+            }
+            if (done) {
+                continue;
+            }
+            uint8_t n_link = 1;
+            for (TrinamicDriver* p = first; p; p = p->link) {
+                if (p->_cs_pin == first->_cs_pin) {
+                    n_link = MAX(n_link, uint8_t(MAX(p->_spi_index, 1)));
+                }
+            }
+            n_link = MIN(n_link, uint8_t(TRINAMIC_CHAIN_MAX));
+
+            uint8_t buf[5 * TRINAMIC_CHAIN_MAX] = { 0 };
+            for (uint8_t i = 0; i < n_link; i++) {
+                buf[5 * i] = DRV_STATUS_ADDRESS;
+            }
+
+            SPI.beginTransaction(
+                SPISettings(first->_cs_pin >= I2S_OUT_PIN_BASE ? TRINAMIC_SPI_FREQ : TRINAMIC_CHAIN_SPI_FREQ, MSBFIRST, SPI_MODE3));
+            uint32_t library_selects = tmc_library_selects;  // No library transfer can start while the bus is held
+            digitalWrite(first->_cs_pin, LOW);
+#ifdef USE_I2S_OUT
+            i2s_out_delay();
 #endif
+            SPI.transfer(buf, 5 * n_link);
+            digitalWrite(first->_cs_pin, HIGH);
+#ifdef USE_I2S_OUT
+            i2s_out_delay();
+#endif
+            SPI.endTransaction();
+
+            for (TrinamicDriver* p = List; p; p = p->link) {
+                if (p->_cs_pin != first->_cs_pin) {
+                    continue;
+                }
+                uint8_t j = n_link - MIN(uint8_t(MAX(p->_spi_index, 1)), n_link);  // Datagram from this driver
+                if (p->_status_requests == library_selects && !p->_has_errors) {
+                    p->_drv_status = (uint32_t(buf[5 * j + 1]) << 24) | (uint32_t(buf[5 * j + 2]) << 16) | (uint32_t(buf[5 * j + 3]) << 8) |
+                                     buf[5 * j + 4];
+                    p->_sg_min       = MIN(p->_sg_min, uint16_t(p->_drv_status & 0x3FF));
+                    p->_status_fresh = true;
+                } else {
+                    p->_status_fresh = false;
+                    valid            = false;
+                }
+                p->_status_requests = library_selects;
+            }
+        }
+        return valid;
+    }
+
+    /*
+    Sensorless homing from SG_RESULT, run on each poll while homing with $Homing/Sensorless/Threshold
+    set. The load value is only meaningful at a steady speed, so each motion is ignored for the time
+    it takes to reach the homing rate, and the next TRINAMIC_STALL_CALIBRATE samples of the filtered
+    value are averaged into a baseline. That adapts the threshold to the axis, the rate and the
+    current of each approach, instead of relying on one SGT value for all of them. A stall is
+    TRINAMIC_STALL_SAMPLES consecutive samples under the threshold, or the driver's own stall flag.
+*/
+    void TrinamicDriver::stall_check() {
+        if (_mode != TrinamicMode::StallGuard || _has_errors) {
+            return;
+        }
+        if (_stall_generation != motors_stall_generation) {
+            _stall_generation = motors_stall_generation;
+            _stall_moving     = false;
+            _sg_baseline_sum  = 0;
+            _sg_baseline_n    = 0;
+            _stall_count      = 0;
+        }
+        if (!motors_stall_armed || !_status_fresh) {
+            return;
+        }
+        TMC2130_n ::DRV_STATUS_t status { 0 };
+        status.sr = _drv_status;
+        if (status.stst) {
+            _stall_moving = false;
+            return;
+        }
+        uint32_t sg  = uint32_t(status.sg_result) << 4;
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        if (!_stall_moving) {
+            _stall_moving   = true;
+            _stall_start_ms = now;
+            _sg_filtered    = sg;
+        }
+        _sg_filtered += (sg >> TRINAMIC_STALL_FILTER_SHIFT) - (_sg_filtered >> TRINAMIC_STALL_FILTER_SHIFT);
+
+        // Time to accelerate to the faster homing rate, from the axis acceleration (mm/sec^2)
+        float    rate     = MAX(homing_seek_rate->get(), homing_feed_rate->get()) / 60.0;
+        uint32_t blank_ms = MAX(uint32_t(TRINAMIC_STALL_BLANK_MS),
+                                uint32_t(1000.0 * rate / axis_settings[_axis_index]->acceleration->get()) + TRINAMIC_STALL_BLANK_MS);
+        if (now - _stall_start_ms < blank_ms) {
+            return;
+        }
+        if (_sg_baseline_n < TRINAMIC_STALL_CALIBRATE) {
+            _sg_baseline_sum += _sg_filtered >> 4;
+            _sg_baseline_n++;
+            return;
+        }
+        uint32_t threshold = _sg_baseline_sum / _sg_baseline_n * homing_sensorless_threshold->get() / 100;
+        if ((_sg_filtered >> 4) < threshold || status.stallGuard) {
+            _stall_count++;
+        } else {
+            _stall_count = 0;
+        }
+        if (_stall_count >= TRINAMIC_STALL_SAMPLES && _stall_generation == motors_stall_generation) {
+            motors_stall_mask |= bit(_axis_index);
+        }
+    }
+
+    // Prints StallGuard data that is useful for tuning. While homing, the status is polled every
+    // TRINAMIC_STATUS_HOMING_POLL_MS and the report shows the lowest SG_RESULT in between. The
+    // same polls run the sensorless homing, see stall_check().
+    uint32_t TrinamicDriver::poll() {
+        static TickType_t xLastReport = 0;
+
+        bool reporting =
+            stallguard_debug_mask->get() != 0 && (sys.state == State::Cycle || sys.state == State::Homing || sys.state == State::Jog);
+        bool sensorless = sys.state == State::Homing && homing_sensorless_threshold->get() != 0;
+        bool homing     = sensorless || (reporting && sys.state == State::Homing);
+
+        if (homing) {
+            read_all_status();
+        }
+        if (sensorless) {
+            for (TrinamicDriver* p = List; p; p = p->link) {
+                p->stall_check();
+            }
+        }
+        if (reporting && xTaskGetTickCount() - xLastReport >= TRINAMIC_STATUS_REPORT_MS) {
+            xLastReport = xTaskGetTickCount();
+            if (!homing && !read_all_status()) {
+                read_all_status();  // The request was lost, ask again
+            }
+            for (TrinamicDriver* p = List; p; p = p->link) {
+                if (bitnum_istrue(stallguard_debug_mask->get(), p->_axis_index)) {
+                    p->debug_message();
+                }
+                p->_sg_min = 0x3FF;
+            }
         }
+        return homing ? TRINAMIC_STATUS_HOMING_POLL_MS : TRINAMIC_STATUS_REPORT_MS;
     }
 
     // =========== Reporting functions ========================
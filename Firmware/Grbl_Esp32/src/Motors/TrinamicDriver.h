@@ -34,7 +34,18 @@ const float TMC5160_RSENSE_DEFAULT = 0.075f;
 const int NORMAL_TCOOLTHRS = 0xFFFFF;  // 20 bit is max
 const int NORMAL_THIGH     = 0;
 
-const int TRINAMIC_SPI_FREQ = 100000;
+const int TRINAMIC_SPI_FREQ       = 100000;
+const int TRINAMIC_CHAIN_SPI_FREQ = 2000000;  // The TMCStepper default, for CS pins that are not on I2S
+
+const int TRINAMIC_CHAIN_MAX              = 2 * MAX_N_AXIS;  // Drivers on one chip select line
+const int TRINAMIC_STATUS_REPORT_MS       = 200;             // $Report/StallGuard period
+const int TRINAMIC_STATUS_HOMING_POLL_MS  = 1;               // DRV_STATUS poll period while homing with a report on
+
+// Sensorless homing, see TrinamicDriver::stall_check()
+const int TRINAMIC_STALL_BLANK_MS     = 50;  // Minimum time ignored after motion starts
+const int TRINAMIC_STALL_CALIBRATE    = 32;  // Samples averaged into the baseline SG_RESULT
+const int TRINAMIC_STALL_SAMPLES      = 3;   // Consecutive samples under the threshold that make a stall
+const int TRINAMIC_STALL_FILTER_SHIFT = 2;   // SG_RESULT moving average weight, 1/4 per sample
 
 const double TRINAMIC_FCLK = 12700000.0;  // Internal clock Approx (Hz) used to calculate TSTEP from homing rate
 
@@ -94,6 +105,7 @@ namespace Motors {
         void read_settings() override;
         bool set_homing_mode(bool ishoming) override;
         void set_disable(bool disable) override;
+        bool disable_pin(uint8_t& pin) override { return false; }  // set_disable() also tracks the state
 
         void debug_message();
 
@@ -122,11 +134,30 @@ namespace Motors {
 
         uint8_t get_next_index();
 
+        // DRV_STATUS from the last poll of all drivers, see read_all_status()
+        uint32_t _drv_status      = 0;
+        uint16_t _sg_min          = 0x3FF;  // Lowest SG_RESULT since the last report
+        uint32_t _status_requests = 0;      // Library transfers when this driver's chain was last polled
+        bool     _status_fresh    = false;  // _drv_status came from the last poll
+
+        // Sensorless homing state, reset when motors_stall_generation changes
+        uint32_t _stall_generation = 0;
+        bool     _stall_moving     = false;
+        uint32_t _stall_start_ms   = 0;  // When the current motion started
+        uint32_t _sg_filtered      = 0;  // Moving average of SG_RESULT, scaled by 16
+        uint32_t _sg_baseline_sum  = 0;
+        uint8_t  _sg_baseline_n    = 0;
+        uint8_t  _stall_count      = 0;
+
+        void stall_check();
+
+        static bool read_all_status();
+
         // Linked list of Trinamic driver instances, used by the
-        // StallGuard reporting task.
+        // StallGuard reporting poll.
         static TrinamicDriver* List;
         TrinamicDriver*        link;
-        static void            readSgTask(void*);
+        static uint32_t        poll();  // See motors_add_poll()
 
     protected:
         void config_message() override;
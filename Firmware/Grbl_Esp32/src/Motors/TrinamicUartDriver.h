@@ -64,6 +64,10 @@ const double TRINAMIC_UART_FCLK = 12700000.0;  // Internal clock Approx (Hz) use
 #    define TMC_UART_TX UNDEFINED_PIN
 #endif
 
+const int TRINAMIC_UART_QUEUE_MAX        = 32;   // Register writes sent together, 8 bytes each
+const int TRINAMIC_UART_REPLY_TIMEOUT    = 3;    // ms for each byte of a read reply
+const int TRINAMIC_UART_STATUS_REPORT_MS = 200;  // $Report/StallGuard period
+
 extern Uart tmc_serial;
 
 namespace Motors {
@@ -89,20 +93,19 @@ namespace Motors {
                            uint8_t  address);
 
         void config_message();
-        void hw_serial_init();
         void init();
         void set_mode();
         void read_settings();
         void debug_message();
         bool set_homing_mode(bool is_homing) override;
         void set_disable(bool disable) override;
+        bool disable_pin(uint8_t& pin) override { return false; }  // set_disable() also tracks the state
 
         uint8_t addr;
 
     private:
         uint32_t calc_tstep(float speed, float percent);  //TODO: see if this is useful/used.
 
-        TMC2209Stepper*  tmcstepper;  // all other driver types are subclasses of this one
         TrinamicUartMode _homing_mode;
         uint16_t         _driver_part_number;  // example: use 2209 for TMC2209
         float            _r_sense;
@@ -122,11 +125,37 @@ namespace Motors {
 
         uint8_t get_next_index();
 
+        // The registers that can not all be read back, as last written, with the power on values
+        // TMCStepper starts from
+        uint32_t _gconf      = 0x000001C1;  // i_scale_analog, pdn_disable, mstep_reg_select, multistep_filt
+        uint32_t _chopconf   = 0x10000053;
+        uint32_t _pwmconf    = 0xC10D0024;
+        uint32_t _ihold_irun = 0x00010000;  // iholddelay 1
+
+        uint8_t  _ifcnt        = 0;  // The driver's count of good writes, as it should be
+        uint32_t _drv_status   = 0;  // From the last status sweep
+        uint16_t _sg_result    = 0;
+        bool     _toff_pending = false;  // set_disable() ran in an ISR
+
+        // The bus. Writes are queued and sent back to back by flush_writes(); the drivers do not
+        // answer them. Reads are a request and a reply, each sent as soon as the last reply is in.
+        void        write_register(uint8_t reg, uint32_t value);
+        bool        read_register(uint8_t reg, uint32_t& value);
+        void        write_toff();
+        void        write_config();
+        static bool flush_writes();
+        static void read_all_status(AxisMask axes);
+
+        static uint8_t           _tx[8 * TRINAMIC_UART_QUEUE_MAX];
+        static size_t            _tx_len;
+        static bool              _batching;  // Init queues the writes of all drivers together
+        static SemaphoreHandle_t _bus;
+
         // Linked list of Trinamic driver instances, used by the
-        // StallGuard reporting task. TODO: verify if this is really used/useful.
+        // StallGuard reporting poll.
         static TrinamicUartDriver* List;
         TrinamicUartDriver*        link;
-        static void                readSgTask(void*);
+        static uint32_t            poll();  // See motors_add_poll()
 
     protected:
         // void config_message() override;
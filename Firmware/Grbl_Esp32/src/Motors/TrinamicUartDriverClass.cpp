@@ -30,8 +30,43 @@ Uart tmc_serial(TMC_UART);
 
 namespace Motors {
 
+    // TMC2209 UART datagrams, see the datasheet section 4
+    static const uint8_t  TMC_UART_SYNC      = 0x05;
+    static const uint8_t  TMC_UART_MASTER    = 0xFF;  // The address replies come from
+    static const uint8_t  TMC_UART_WRITE     = 0x80;
+    static const uint8_t  TMC_REG_GCONF      = 0x00;
+    static const uint8_t  TMC_REG_IFCNT      = 0x02;
+    static const uint8_t  TMC_REG_IHOLD_IRUN = 0x10;
+    static const uint8_t  TMC_REG_TCOOLTHRS  = 0x14;
+    static const uint8_t  TMC_REG_SGTHRS     = 0x40;
+    static const uint8_t  TMC_REG_SG_RESULT  = 0x41;
+    static const uint8_t  TMC_REG_CHOPCONF   = 0x6C;
+    static const uint8_t  TMC_REG_DRV_STATUS = 0x6F;
+    static const uint8_t  TMC_REG_PWMCONF    = 0x70;
+    static const uint32_t TMC_EN_SPREADCYCLE = bit(2);   // GCONF
+    static const uint32_t TMC_VSENSE         = bit(17);  // CHOPCONF
+    static const uint32_t TMC_PWM_AUTOSCALE  = bit(18);  // PWMCONF
+    static const uint32_t TMC_STST           = bit(31);  // DRV_STATUS
+
+    static uint8_t tmc_uart_crc(const uint8_t* datagram, uint8_t len) {
+        uint8_t crc = 0;
+        for (uint8_t i = 0; i < len; i++) {
+            uint8_t byte = datagram[i];
+            for (uint8_t j = 0; j < 8; j++) {
+                crc = ((crc >> 7) ^ (byte & 0x01)) ? (crc << 1) ^ 0x07 : crc << 1;
+                byte >>= 1;
+            }
+        }
+        return crc;
+    }
+
     bool TrinamicUartDriver::_uart_started = false;
 
+    uint8_t           TrinamicUartDriver::_tx[8 * TRINAMIC_UART_QUEUE_MAX];
+    size_t            TrinamicUartDriver::_tx_len   = 0;
+    bool              TrinamicUartDriver::_batching = true;
+    SemaphoreHandle_t TrinamicUartDriver::_bus      = NULL;
+
     TrinamicUartDriver* TrinamicUartDriver::List = NULL;  // a static ist of all drivers for stallguard reporting
 
     /* HW Serial Constructor. */
@@ -46,56 +81,132 @@ namespace Motors {
         if (!_uart_started) {
             tmc_serial.setPins(TMC_UART_TX, TMC_UART_RX);
             tmc_serial.begin(115200, Uart::Data::Bits8, Uart::Stop::Bits1, Uart::Parity::None);
+            _bus          = xSemaphoreCreateRecursiveMutex();
             _uart_started = true;
         }
-        hw_serial_init();
+        if (_driver_part_number != 2209) {
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Unsupported Trinamic motor p/n:%d", _driver_part_number);
+            _has_errors = true;
+        }
 
         link = List;
         List = this;
     }
 
-    void TrinamicUartDriver::hw_serial_init() {
-        if (_driver_part_number == 2209)
-            tmcstepper = new TMC2209Stepper(&tmc_serial, _r_sense, addr);
-        else {
-            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Unsupported Trinamic motor p/n:%d", _driver_part_number);
-            return;
+    // Queued, and sent by flush_writes(). The driver counts the writes it takes in IFCNT.
+    void TrinamicUartDriver::write_register(uint8_t reg, uint32_t value) {
+        if (_tx_len == sizeof(_tx)) {
+            flush_writes();
         }
+        uint8_t* datagram = _tx + _tx_len;
+        datagram[0]       = TMC_UART_SYNC;
+        datagram[1]       = addr;
+        datagram[2]       = reg | TMC_UART_WRITE;
+        datagram[3]       = value >> 24;
+        datagram[4]       = value >> 16;
+        datagram[5]       = value >> 8;
+        datagram[6]       = value;
+        datagram[7]       = tmc_uart_crc(datagram, 7);
+        _tx_len += 8;
+        _ifcnt++;
     }
 
-    void TrinamicUartDriver ::init() {
-        if (_has_errors) {
-            return;
+    // Sends all queued writes in one go. Writes get no reply, so they need no gap between them.
+    bool TrinamicUartDriver::flush_writes() {
+        if (_tx_len == 0) {
+            return true;
         }
+        tmc_serial.write(_tx, _tx_len);
+        _tx_len = 0;
+        return !tmc_serial.flushTxTimed(pdMS_TO_TICKS(50));
+    }
 
-        init_step_dir_pins();  // from StandardStepper
-        config_message();
-
-        tmcstepper->begin();
+    // The request goes out as soon as the bus is free. With TX and RX on one wire the request
+    // comes back first, so the reply is found by its master address. Writes still queued are
+    // not sent first, so init() can test each driver while the others' writes wait.
+    bool TrinamicUartDriver::read_register(uint8_t reg, uint32_t& value) {
+        uint8_t request[4] = { TMC_UART_SYNC, addr, reg, 0 };
+        request[3]         = tmc_uart_crc(request, 3);
+        while (tmc_serial.read() >= 0) {}  // Echoes of the writes
+        tmc_serial.write(request, sizeof(request));
+
+        uint8_t reply[8];
+        uint8_t n = 0;
+        while (n < sizeof(reply)) {
+            int c = tmc_serial.read(pdMS_TO_TICKS(TRINAMIC_UART_REPLY_TIMEOUT));
+            if (c < 0) {
+                return false;
+            }
+            reply[n++] = c;
+            if (n == 1 && c != TMC_UART_SYNC) {
+                n = 0;
+            } else if (n == 2 && c != TMC_UART_MASTER) {
+                n = c == TMC_UART_SYNC ? 1 : 0;
+            }
+        }
+        if (reply[2] != reg || reply[7] != tmc_uart_crc(reply, 7)) {
+            return false;
+        }
+        value = (uint32_t(reply[3]) << 24) | (uint32_t(reply[4]) << 16) | (uint32_t(reply[5]) << 8) | reply[6];
+        return true;
+    }
 
-        _has_errors = !test();  // Try communicating with motor. Prints an error if there is a problem.
+    // Everything init() writes, from the shadows, to send again after writes were lost
+    void TrinamicUartDriver::write_config() {
+        write_register(TMC_REG_GCONF, _gconf);
+        write_register(TMC_REG_CHOPCONF, _chopconf);
+        write_register(TMC_REG_IHOLD_IRUN, _ihold_irun);
+        write_register(TMC_REG_PWMCONF, _pwmconf);
+        if (_mode == TrinamicUartMode::StallGuard) {
+            write_register(TMC_REG_TCOOLTHRS, calc_tstep(homing_feed_rate->get(), 150.0));
+            write_register(TMC_REG_SGTHRS, constrain(axis_settings[_axis_index]->stallguard->get(), 0, 255));
+        }
+    }
 
-        /* If communication with the driver is working, read the 
-        main settings, apply new driver settings and then read 
-        them back. */
-        if (!_has_errors) {  //TODO: verify if this is the right way to set the Irun/IHold and microsteps.
-            read_settings();
-            set_mode(false);
+    /*
+    The drivers are set up together. Each init() tests its driver and queues its registers,
+    and the last one sends the writes of all of them at once, then checks each driver's
+    write count and sends a driver's registers again if it missed any.
+    */
+    void TrinamicUartDriver ::init() {
+        xSemaphoreTakeRecursive(_bus, portMAX_DELAY);
+        _batching = true;
+        if (!_has_errors) {
+            init_step_dir_pins();  // from StandardStepper
+            config_message();
+
+            _has_errors = !test();  // Try communicating with motor. Prints an error if there is a problem.
+
+            /* If communication with the driver is working, read the 
+            main settings, apply new driver settings and then read 
+            them back. */
+            if (!_has_errors) {  //TODO: verify if this is the right way to set the Irun/IHold and microsteps.
+                write_register(TMC_REG_GCONF, _gconf);
+                read_settings();
+                set_mode(false);
+            }
         }
 
-        // After initializing all of the TMC drivers, create a task to
-        // display StallGuard data.  List == this for the final instance.
+        // After initializing all of the TMC drivers, send their registers and start
+        // polling them. List == this for the final instance.
         if (List == this) {
-            xTaskCreatePinnedToCore(readSgTask,    // task
-                                    "readSgTask",  // name for task
-                                    4096,          // size of task stack
-                                    NULL,          // parameters
-                                    1,             // priority
-                                    NULL,
-                                    SUPPORT_TASK_CORE  // must run the task on same core
-                                                       // core
-            );
+            _batching = false;
+            flush_writes();
+            for (TrinamicUartDriver* p = List; p; p = p->link) {
+                uint32_t ifcnt = 0;
+                if (!p->_has_errors && (!p->read_register(TMC_REG_IFCNT, ifcnt) || uint8_t(ifcnt) != p->_ifcnt)) {
+                    grbl_msg_sendf(CLIENT_SERIAL,
+                                   MsgLevel::Info,
+                                   "%s driver missed register writes, sending again",
+                                   reportAxisNameMsg(p->_axis_index, p->_dual_axis_index));
+                    p->_ifcnt = ifcnt;
+                    p->write_config();
+                    flush_writes();
+                }
+            }
+            motors_add_poll(poll);
         }
+        xSemaphoreGiveRecursive(_bus);
     }
 
     /*
@@ -118,58 +229,55 @@ namespace Motors {
                        reportAxisLimitsMsg(_axis_index));
     }
 
+    // Reads DRV_STATUS as TMCStepper's test_connection() does, and IFCNT to count writes from
     bool TrinamicUartDriver::test() {
         if (_has_errors) {
             return false;
         }
-        switch (tmcstepper->test_connection()) {
-            case 1:
-                grbl_msg_sendf(CLIENT_SERIAL,
-                               MsgLevel::Info,
-                               "%s driver test failed. Check connection",
-                               reportAxisNameMsg(_axis_index, _dual_axis_index));
-                return false;
-            case 2:
-                grbl_msg_sendf(CLIENT_SERIAL,
-                               MsgLevel::Info,
-                               "%s driver test failed. Check motor power",
-                               reportAxisNameMsg(_axis_index, _dual_axis_index));
-                return false;
-            default:
-                // driver responded, so check for other errors from the DRV_STATUS register
-
-                TMC2208_n ::DRV_STATUS_t status { 0 };  // a useful struct to access the bits.
-                status.sr = tmcstepper->DRV_STATUS();
+        uint32_t drv_status = 0, ifcnt = 0;
+        if (!read_register(TMC_REG_DRV_STATUS, drv_status) || !read_register(TMC_REG_IFCNT, ifcnt) || drv_status == 0xFFFFFFFF) {
+            grbl_msg_sendf(
+                CLIENT_SERIAL, MsgLevel::Info, "%s driver test failed. Check connection", reportAxisNameMsg(_axis_index, _dual_axis_index));
+            return false;
+        }
+        if (drv_status == 0) {
+            grbl_msg_sendf(
+                CLIENT_SERIAL, MsgLevel::Info, "%s driver test failed. Check motor power", reportAxisNameMsg(_axis_index, _dual_axis_index));
+            return false;
+        }
+        _ifcnt = ifcnt;
 
-                bool err = false;
+        // driver responded, so check for other errors from the DRV_STATUS register
+        TMC2208_n ::DRV_STATUS_t status { 0 };  // a useful struct to access the bits.
+        status.sr = drv_status;
 
-                // look for errors
-                if (report_short_to_ground(status)) {
-                    err = true;
-                }
+        bool err = false;
 
-                if (report_over_temp(status)) {
-                    err = true;
-                }
+        // look for errors
+        if (report_short_to_ground(status)) {
+            err = true;
+        }
 
-                if (report_short_to_ps(status)) {
-                    err = true;
-                }
+        if (report_over_temp(status)) {
+            err = true;
+        }
 
-                if (err) {
-                    return false;
-                }
+        if (report_short_to_ps(status)) {
+            err = true;
+        }
 
-                grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "%s driver test passed", reportAxisNameMsg(_axis_index, _dual_axis_index));
-                return true;
+        if (err) {
+            return false;
         }
+
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "%s driver test passed", reportAxisNameMsg(_axis_index, _dual_axis_index));
+        return true;
     }
 
     /*
     Read setting and send them to the driver. Called at init() and whenever related settings change
-    both are stored as float Amps, but TMCStepper library expects...
-    uint16_t run (mA)
-    float hold (as a percentage of run)
+    both are stored as float Amps. The register values are worked out as TMCStepper's
+    microsteps() and rms_current() do.
     */
     void TrinamicUartDriver::read_settings() {
         if (_has_errors) {
@@ -186,13 +294,35 @@ namespace Motors {
             if (hold_i_percent > 1.0)
                 hold_i_percent = 1.0;
         }
-        tmcstepper->microsteps(axis_settings[_axis_index]->microsteps->get());
-        tmcstepper->rms_current(run_i_ma, hold_i_percent);
 
-        // grbl_msg_sendf(CLIENT_SERIAL,
-        //                 MsgLevel::Info,
-        //                 "Setting current of driver %s, target: %u, read irun: %d, hold percent: %f, usteps: %d",
-        //                  reportAxisNameMsg(_axis_index, _dual_axis_index), run_i_ma, tmcstepper->rms_current(), hold_i_percent, axis_settings[_axis_index]->microsteps->get());
+        // MRES, 0 for 256 microsteps to 8 for full steps. Other values leave it as it is.
+        uint16_t microsteps = axis_settings[_axis_index]->microsteps->get();
+        for (uint8_t mres = 0; mres <= 8; mres++) {
+            if ((256 >> mres) == microsteps) {
+                _chopconf = (_chopconf & ~(uint32_t(0xF) << 24)) | (uint32_t(mres) << 24);
+                break;
+            }
+        }
+
+        // Current scale, in the high sensitivity range when it would be low in the normal one
+        float scale  = 32.0 * 1.41421 * run_i_ma / 1000.0 * (_r_sense + 0.02);
+        float cs     = scale / 0.325 - 1;
+        bool  vsense = cs < 16;
+        if (vsense) {
+            cs = scale / 0.180 - 1;
+        }
+        uint8_t irun  = constrain(cs, 0.0f, 31.0f);
+        uint8_t ihold = irun * hold_i_percent;
+        _chopconf     = vsense ? _chopconf | TMC_VSENSE : _chopconf & ~TMC_VSENSE;
+        _ihold_irun   = (_ihold_irun & ~uint32_t(0x1F1F)) | (uint32_t(irun) << 8) | ihold;
+
+        xSemaphoreTakeRecursive(_bus, portMAX_DELAY);
+        write_register(TMC_REG_CHOPCONF, _chopconf);
+        write_register(TMC_REG_IHOLD_IRUN, _ihold_irun);
+        if (!_batching) {
+            flush_writes();
+        }
+        xSemaphoreGiveRecursive(_bus);
     }
 
     bool TrinamicUartDriver::set_homing_mode(bool isHoming) {
@@ -218,40 +348,45 @@ namespace Motors {
 
         _mode = newMode;
 
+        xSemaphoreTakeRecursive(_bus, portMAX_DELAY);
         switch (_mode) {
             case TrinamicUartMode ::StealthChop:
                 grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "StealthChop");
-                tmcstepper->en_spreadCycle(false);
-                tmcstepper->pwm_autoscale(true);
+                _gconf &= ~TMC_EN_SPREADCYCLE;
+                _pwmconf |= TMC_PWM_AUTOSCALE;
                 break;
             case TrinamicUartMode ::CoolStep:
                 grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Coolstep");
-                // tmcstepper->en_pwm_mode(false); //TODO: check if this is present in TMC2208/09
-                tmcstepper->en_spreadCycle(true);
-                tmcstepper->pwm_autoscale(false);
+                _gconf |= TMC_EN_SPREADCYCLE;
+                _pwmconf &= ~TMC_PWM_AUTOSCALE;
                 break;
             case TrinamicUartMode ::StallGuard:  //TODO: check all configurations for stallguard
                 grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Stallguard");
-                tmcstepper->en_spreadCycle(false);
-                tmcstepper->pwm_autoscale(false);
-                tmcstepper->TCOOLTHRS(calc_tstep(homing_feed_rate->get(), 150.0));
-                tmcstepper->SGTHRS(constrain(axis_settings[_axis_index]->stallguard->get(), 0, 255));
+                _gconf &= ~TMC_EN_SPREADCYCLE;
+                _pwmconf &= ~TMC_PWM_AUTOSCALE;
+                write_register(TMC_REG_TCOOLTHRS, calc_tstep(homing_feed_rate->get(), 150.0));
+                write_register(TMC_REG_SGTHRS, constrain(axis_settings[_axis_index]->stallguard->get(), 0, 255));
                 break;
             default:
                 grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Unknown Trinamic mode:d", _mode);
         }
+        write_register(TMC_REG_GCONF, _gconf);
+        write_register(TMC_REG_PWMCONF, _pwmconf);
+        if (!_batching) {
+            flush_writes();
+        }
+        xSemaphoreGiveRecursive(_bus);
     }
 
     /*
     This is the stallguard tuning info. It is call debug, so it could be generic across all classes.
+    It reports the values read by the last read_all_status().
     */
     void TrinamicUartDriver::debug_message() {
         if (_has_errors) {
             return;
         }
-        uint32_t tstep = tmcstepper->TSTEP();
-
-        if (tstep == 0xFFFFF || tstep < 1) {  // if axis is not moving return
+        if (_drv_status & TMC_STST) {  // if axis is not moving return
             return;
         }
         float feedrate = st_get_realtime_rate();  //* settings.microsteps[axis_index] / 60.0 ; // convert mm/min to Hz
@@ -260,12 +395,12 @@ namespace Motors {
                        MsgLevel::Info,
                        "%s SG_Val: %04d   Rate: %05.0f mm/min SG_Setting:%d",
                        reportAxisNameMsg(_axis_index, _dual_axis_index),
-                       tmcstepper->SG_RESULT(),  //    tmcstepper->sg_result(),
+                       _sg_result,
                        feedrate,
                        axis_settings[_axis_index]->stallguard->get());
 
         TMC2208_n ::DRV_STATUS_t status { 0 };  // a useful struct to access the bits.
-        status.sr = tmcstepper->DRV_STATUS();
+        status.sr = _drv_status;
 
         // these only report if there is a fault condition
         report_open_load(status);
@@ -286,6 +421,15 @@ namespace Motors {
         return static_cast<uint32_t>(tstep);
     }
 
+    void TrinamicUartDriver::write_toff() {
+        uint8_t toff = TRINAMIC_UART_TOFF_DISABLE;
+        if (!_disabled) {
+            toff = _mode == TrinamicUartMode::StealthChop ? TRINAMIC_UART_TOFF_STEALTHCHOP : TRINAMIC_UART_TOFF_COOLSTEP;
+        }
+        _chopconf = (_chopconf & ~uint32_t(0xF)) | toff;
+        write_register(TMC_REG_CHOPCONF, _chopconf);
+    }
+
     // this can use the enable feature over SPI. The dedicated pin must be in the enable mode,
     // but that can be hardwired that way.
     void TrinamicUartDriver::set_disable(bool disable) {
@@ -302,20 +446,35 @@ namespace Motors {
         digitalWrite(_disable_pin, _disabled);
 
 #ifdef USE_TRINAMIC_ENABLE
-        if (_disabled) {
-            tmcstepper->toff(TRINAMIC_UART_TOFF_DISABLE);
-        } else {
-            if (_mode == TrinamicUartMode::StealthChop) {
-                tmcstepper->toff(TRINAMIC_UART_TOFF_STEALTHCHOP);
-            } else {
-                tmcstepper->toff(TRINAMIC_UART_TOFF_COOLSTEP);
-            }
+        if (xPortInIsrContext()) {
+            _toff_pending = true;  // The bus is not for an ISR; the next poll sends it
+            return;
         }
+        xSemaphoreTakeRecursive(_bus, portMAX_DELAY);
+        write_toff();
+        if (!_batching) {
+            flush_writes();
+        }
+        xSemaphoreGiveRecursive(_bus);
 #endif
         // the pin based enable could be added here.
         // This would be for individual motors, not the single pin for all motors.
     }
 
+    // One sweep over the drivers of axes, each read sent as soon as the last reply is in
+    void TrinamicUartDriver::read_all_status(AxisMask axes) {
+        for (TrinamicUartDriver* p = List; p; p = p->link) {
+            if (p->_has_errors || !bitnum_istrue(axes, p->_axis_index)) {
+                continue;
+            }
+            uint32_t sg_result = 0;
+            if (!p->read_register(TMC_REG_DRV_STATUS, p->_drv_status) || !p->read_register(TMC_REG_SG_RESULT, sg_result)) {
+                p->_drv_status = TMC_STST;  // Nothing to report
+            }
+            p->_sg_result = sg_result & 0x3FF;
+        }
+    }
+
     // =========== Reporting functions ========================
 
     bool TrinamicUartDriver::report_open_load(TMC2208_n ::DRV_STATUS_t status) {
@@ -371,31 +530,28 @@ namespace Motors {
         return false;  // no error
     }
 
-    // Prints StallGuard data that is useful for tuning.
-    void TrinamicUartDriver::readSgTask(void* pvParameters) {
-        TickType_t       xLastWakeTime;
-        const TickType_t xreadSg = 200;  // in ticks (typically ms)
-        auto             n_axis  = number_axis->get();
-
-        xLastWakeTime = xTaskGetTickCount();  // Initialise the xLastWakeTime variable with the current time.
-        while (true) {                        // don't ever return from this or the task dies
-            if (stallguard_debug_mask->get() != 0) {
-                if (sys.state == State::Cycle || sys.state == State::Homing || sys.state == State::Jog) {
-                    for (TrinamicUartDriver* p = List; p; p = p->link) {
-                        if (bitnum_istrue(stallguard_debug_mask->get(), p->_axis_index)) {
-                            //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "SG:%d", stallguard_debug_mask->get());
-                            p->debug_message();
-                        }
-                    }
-                }  // sys.state
-            }      // if mask
-
-            vTaskDelayUntil(&xLastWakeTime, xreadSg);
-
-            static UBaseType_t uxHighWaterMark = 0;
-#ifdef DEBUG_TASK_STACK
-            reportTaskStackSize(uxHighWaterMark);
-#endif
+    // Prints StallGuard data that is useful for tuning, and sends the enables set_disable()
+    // left to it. Only the drivers that report are read.
+    uint32_t TrinamicUartDriver::poll() {
+        xSemaphoreTakeRecursive(_bus, portMAX_DELAY);
+        for (TrinamicUartDriver* p = List; p; p = p->link) {
+            if (p->_toff_pending) {
+                p->_toff_pending = false;
+                p->write_toff();
+            }
+        }
+        flush_writes();
+
+        AxisMask mask = stallguard_debug_mask->get();
+        if (mask != 0 && (sys.state == State::Cycle || sys.state == State::Homing || sys.state == State::Jog)) {
+            read_all_status(mask);
+            for (TrinamicUartDriver* p = List; p; p = p->link) {
+                if (bitnum_istrue(mask, p->_axis_index)) {
+                    p->debug_message();
+                }
+            }
         }
+        xSemaphoreGiveRecursive(_bus);
+        return TRINAMIC_UART_STATUS_REPORT_MS;
     }
 }
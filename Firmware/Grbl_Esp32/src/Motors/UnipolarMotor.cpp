@@ -14,6 +14,35 @@ namespace Motors {
         pinMode(_pin_phase2, OUTPUT);
         pinMode(_pin_phase3, OUTPUT);
         _current_phase = 0;
+        /*
+			8 Step : A – AB – B – BC – C – CD – D – DA
+			4 Step : AB – BC – CD – DA
+
+			Step		IN4	IN3	IN2	IN1
+			A 		0 	0 	0 	1
+			AB		0	0	1	1
+			B		0	0	1	0
+			BC		0	1	1	0
+			C		0	1	0	0
+			CD		1	1	0	0
+			D		1	0	0	0
+			DA		1	0	0	1
+		*/
+        const uint8_t half_steps[MAX_PHASES] = { B0001, B0011, B0010, B0110, B0100, B1100, B1000, B1001 };
+        const uint8_t full_steps[4]          = { B0011, B0110, B1100, B1001 };
+        const uint8_t pins[4]                = { _pin_phase0, _pin_phase1, _pin_phase2, _pin_phase3 };
+        _phase_max                           = _half_step ? 7 : 3;
+        _off_mask                            = {};
+        for (int phase = 0; phase <= _phase_max; phase++) {
+            uint8_t levels     = _half_step ? half_steps[phase] : full_steps[phase];
+            _phase_mask[phase] = {};
+            for (int i = 0; i < 4; i++) {
+                pin_mask_add(_phase_mask[phase], pins[i], bitnum_istrue(levels, i));
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            pin_mask_add(_off_mask, pins[i], false);
+        }
         config_message();
     }
 
@@ -31,98 +60,22 @@ namespace Motors {
 
     void UnipolarMotor::set_disable(bool disable) {
         if (disable) {
-            digitalWrite(_pin_phase0, 0);
-            digitalWrite(_pin_phase1, 0);
-            digitalWrite(_pin_phase2, 0);
-            digitalWrite(_pin_phase3, 0);
+            pin_mask_write(_off_mask);
         }
         _enabled = !disable;
     }
 
-    void UnipolarMotor::set_direction(bool dir) { _dir = dir; }
-
-    void UnipolarMotor::step() {
-        uint8_t _phase[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };  // temporary phase values...all start as off
-        uint8_t phase_max;
+    void IRAM_ATTR UnipolarMotor::set_direction(bool dir) { _dir = dir; }
 
+    void IRAM_ATTR UnipolarMotor::step() {
         if (!_enabled)
             return;  // don't do anything, phase is not changed or lost
 
-        phase_max = _half_step ? 7 : 3;
-
         if (_dir) {  // count up
-            _current_phase = _current_phase == phase_max ? 0 : _current_phase + 1;
+            _current_phase = _current_phase == _phase_max ? 0 : _current_phase + 1;
         } else {  // count down
-            _current_phase = _current_phase == 0 ? phase_max : _current_phase - 1;
-        }
-        /*
-			8 Step : A – AB – B – BC – C – CD – D – DA
-			4 Step : AB – BC – CD – DA
-
-			Step		IN4	IN3	IN2	IN1
-			A 		0 	0 	0 	1
-			AB		0	0	1	1
-			B		0	0	1	0
-			BC		0	1	1	0
-			C		0	1	0	0
-			CD		1	1	0	0
-			D		1	0	0	0
-			DA		1	0	0	1
-		*/
-        if (_half_step) {
-            switch (_current_phase) {
-                case 0:
-                    _phase[0] = 1;
-                    break;
-                case 1:
-                    _phase[0] = 1;
-                    _phase[1] = 1;
-                    break;
-                case 2:
-                    _phase[1] = 1;
-                    break;
-                case 3:
-                    _phase[1] = 1;
-                    _phase[2] = 1;
-                    break;
-                case 4:
-                    _phase[2] = 1;
-                    break;
-                case 5:
-                    _phase[2] = 1;
-                    _phase[3] = 1;
-                    break;
-                case 6:
-                    _phase[3] = 1;
-                    break;
-                case 7:
-                    _phase[3] = 1;
-                    _phase[0] = 1;
-                    break;
-            }
-        } else {
-            switch (_current_phase) {
-                case 0:
-                    _phase[0] = 1;
-                    _phase[1] = 1;
-                    break;
-                case 1:
-                    _phase[1] = 1;
-                    _phase[2] = 1;
-                    break;
-                case 2:
-                    _phase[2] = 1;
-                    _phase[3] = 1;
-                    break;
-                case 3:
-                    _phase[3] = 1;
-                    _phase[0] = 1;
-                    break;
-            }
+            _current_phase = _current_phase == 0 ? _phase_max : _current_phase - 1;
         }
-        digitalWrite(_pin_phase0, _phase[0]);
-        digitalWrite(_pin_phase1, _phase[1]);
-        digitalWrite(_pin_phase2, _phase[2]);
-        digitalWrite(_pin_phase3, _phase[3]);
+        pin_mask_write(_phase_mask[_current_phase]);
     }
 }
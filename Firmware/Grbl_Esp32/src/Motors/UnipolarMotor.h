@@ -13,17 +13,28 @@ namespace Motors {
         void set_disable(bool disable) override;
         void set_direction(bool) override;
         void step() override;
+        bool i2s_step_mask(uint32_t& mask) override { return false; }
+        bool step_pins(uint8_t& step_pin, uint8_t& dir_pin, bool& invert_step, bool& invert_dir) override { return false; }
+        bool rmt_step_channel(rmt_channel_t& channel) override { return false; }
 
     private:
+        static const int MAX_PHASES = 8;  // Half stepping
+
         uint8_t _pin_phase0;
         uint8_t _pin_phase1;
         uint8_t _pin_phase2;
         uint8_t _pin_phase3;
         uint8_t _current_phase;
+        uint8_t _phase_max;  // Last phase, 7 half stepping or 3 full stepping
         bool    _half_step;
         bool    _enabled;
         bool    _dir;
 
+        // The pin levels of each phase, and all off, built by init() so a step is one table
+        // lookup and one masked GPIO or I2S write
+        motors_pin_mask_t _phase_mask[MAX_PHASES];
+        motors_pin_mask_t _off_mask;
+
   protected:
         void config_message() override;
     };
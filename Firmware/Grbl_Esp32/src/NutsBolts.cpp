@@ -24,6 +24,8 @@
 
 #include "Grbl.h"
 #include <cstring>
+#include <cstdlib>
+#include <xtensa/core-macros.h>
 
 const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
 
@@ -34,6 +36,12 @@ const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
 // Scientific notation is officially not supported by g-code, and the 'E' character may
 // be a g-code word on some CNC systems. So, 'E' notation will not be recognized.
 // NOTE: Thanks to Radu-Eosif Mihailescu for identifying the issues with using strtod().
+// The digits are accumulated in a 32-bit integer and scaled by a power of ten from a table in
+// one single precision operation, since double precision arithmetic is done in software on the
+// ESP32. Powers of ten up to 1e10 are exact in a float, so dividing by one rounds correctly.
+static const float read_float_pow10[]  = { 1.0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+const int          READ_FLOAT_POW10_MAX = sizeof(read_float_pow10) / sizeof(read_float_pow10[0]) - 1;
+
 uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
     const char*   ptr = line + *char_counter;
     unsigned char c;
@@ -48,6 +56,75 @@ uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
         c = *ptr++;
     }
 
+    // Extract number into fast integer. Track decimal in terms of exponent value.
+    uint32_t intval    = 0;
+    int      exp       = 0;
+    uint8_t  ndigit    = 0;
+    bool     isdecimal = false;
+    while (1) {
+        c -= '0';
+        if (c <= 9) {
+            ndigit++;
+            if (ndigit <= MAX_INT_DIGITS) {
+                if (isdecimal) {
+                    exp--;
+                }
+                intval = intval * 10 + c;
+            } else {
+                if (!(isdecimal)) {
+                    exp++;  // Drop overflow digits
+                }
+            }
+        } else if (c == (('.' - '0') & 0xff) && !(isdecimal)) {
+            isdecimal = true;
+        } else {
+            break;
+        }
+        c = *ptr++;
+    }
+    // Return if no digits have been read.
+    if (!ndigit) {
+        return false;
+    }
+
+    // Convert integer into floating point and apply the decimal. At most MAX_INT_DIGITS
+    // fractional digits are kept, so negative exponents are always in the table.
+    float fval = (float)intval;
+    if (exp < 0) {
+        fval /= read_float_pow10[-exp];
+    } else if (exp > 0) {
+        while (exp > READ_FLOAT_POW10_MAX) {
+            fval *= read_float_pow10[READ_FLOAT_POW10_MAX];
+            exp -= READ_FLOAT_POW10_MAX;
+        }
+        fval *= read_float_pow10[exp];
+    }
+    // Assign floating point value with correct sign.
+    if (isnegative) {
+        *float_ptr = -fval;
+    } else {
+        *float_ptr = fval;
+    }
+    *char_counter = ptr - line - 1;  // Set char_counter to next statement
+    return true;
+}
+
+// The previous read_float(), which scales by repeated double precision multiplies. Kept as the
+// reference that read_float_check() compares the table driven version against.
+static uint8_t read_float_reference(const char* line, uint8_t* char_counter, float* float_ptr) {
+    const char*   ptr = line + *char_counter;
+    unsigned char c;
+    // Grab first character and increment pointer. No spaces assumed in line.
+    c = *ptr++;
+    // Capture initial positive/minus character
+    bool isnegative = false;
+    if (c == '-') {
+        isnegative = true;
+        c          = *ptr++;
+    } else if (c == '+') {
+        c = *ptr++;
+    }
+
     // Extract number into fast integer. Track decimal in terms of exponent value.
     uint32_t intval    = 0;
     int8_t   exp       = 0;
@@ -144,7 +221,7 @@ float hypot_f(float x, float y) {
 float convert_delta_vector_to_unit_vector(float* vector) {
     uint8_t idx;
     float   magnitude = 0.0;
-    auto    n_axis    = number_axis->get();
+    auto    n_axis    = motion_config.n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         if (vector[idx] != 0.0) {
             magnitude += vector[idx] * vector[idx];
@@ -158,32 +235,28 @@ float convert_delta_vector_to_unit_vector(float* vector) {
     return magnitude;
 }
 
-float limit_acceleration_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->acceleration->get() / unit_vec[idx]));
+// The smallest of maximum[idx] / |unit_vec[idx]| over the axes that move, found as the
+// reciprocal of the largest |unit_vec[idx]| * inv_maximum[idx], so there is one division in
+// all instead of one per axis. The inverse maximums are kept in motion_config.
+static float limit_by_axis_maximum(const float* unit_vec, const float* inv_maximum) {
+    float inv_limit = 0.0f;
+    auto  n_axis    = motion_config.n_axis;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        float value = fabsf(unit_vec[idx]) * inv_maximum[idx];
+        if (value > inv_limit) {
+            inv_limit = value;
         }
     }
-    // The acceleration setting is stored and displayed in units of mm/sec^2,
-    // but used in units of mm/min^2.  It suffices to perform the conversion once on
-    // exit, since the limit computation above is independent of units - it simply
-    // finds the smallest value.
-    return limit_value * SEC_PER_MIN_SQ;
+    return inv_limit > 0.0f ? 1.0f / inv_limit : SOME_LARGE_VALUE;
+}
+
+// In mm/min^2, while the acceleration settings are in mm/sec^2
+float limit_acceleration_by_axis_maximum(float* unit_vec) {
+    return limit_by_axis_maximum(unit_vec, motion_config.inv_acceleration);
 }
 
 float limit_rate_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->max_rate->get() / unit_vec[idx]));
-        }
-    }
-    return limit_value;
+    return limit_by_axis_maximum(unit_vec, motion_config.inv_max_rate);
 }
 
 float map_float(float x, float in_min, float in_max, float out_min, float out_max) {  // DrawBot_Badge
@@ -242,3 +315,62 @@ char* trim(char* str) {
 int numberOfSetBits(uint32_t i) {
     return __builtin_popcount(i);
 }
+
+// Distance in float steps between two values of the same sign
+static uint32_t read_float_ulps(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    return ia > ib ? ia - ib : ib - ia;
+}
+
+// Parses every decimal string made of the integers 0..max_mantissa with the decimal point in
+// each possible place, signs alternating, with both read_float() and read_float_reference().
+// Reports how many results differ and by how much, how many of each are not the correctly
+// rounded value from strtof(), and the cycles each version took.
+void read_float_check(uint32_t max_mantissa, read_float_check_t* result) {
+    memset(result, 0, sizeof(*result));
+    for (uint32_t mantissa = 0; mantissa <= max_mantissa; mantissa++) {
+        char digits[12];
+        int  n_digits = snprintf(digits, sizeof(digits), "%u", mantissa);
+        for (int n_decimals = 0; n_decimals <= n_digits; n_decimals++) {
+            // Digits before the decimal point ("0" when there are none), then the point and the rest
+            char        text[16];
+            const char* sign   = (mantissa & 1) ? "-" : "";
+            int         n_int  = n_digits - n_decimals;
+            if (n_decimals == 0) {
+                snprintf(text, sizeof(text), "%s%s", sign, digits);
+            } else if (n_int == 0) {
+                snprintf(text, sizeof(text), "%s0.%s", sign, digits);
+            } else {
+                snprintf(text, sizeof(text), "%s%.*s.%s", sign, n_int, digits, digits + n_int);
+            }
+
+            uint8_t  new_counter = 0, ref_counter = 0;
+            float    new_value = 0.0f, ref_value = 0.0f;
+            uint32_t start_cycles = xthal_get_ccount();
+            read_float(text, &new_counter, &new_value);
+            uint32_t mid_cycles = xthal_get_ccount();
+            read_float_reference(text, &ref_counter, &ref_value);
+            uint32_t end_cycles = xthal_get_ccount();
+
+            result->new_cycles += mid_cycles - start_cycles;
+            result->ref_cycles += end_cycles - mid_cycles;
+            result->count++;
+            float exact = strtof(text, NULL);
+            if (new_value != exact) {
+                result->new_inexact++;
+            }
+            if (ref_value != exact) {
+                result->ref_inexact++;
+            }
+            if (new_counter != ref_counter || new_value != ref_value) {
+                result->mismatches++;
+                uint32_t ulps = new_counter != ref_counter ? UINT32_MAX : read_float_ulps(new_value, ref_value);
+                if (ulps > result->max_ulps) {
+                    result->max_ulps = ulps;
+                }
+            }
+        }
+    }
+}
@@ -88,6 +88,19 @@ const double INCH_PER_MM = (0.0393701);
 // a pointer to the result variable. Returns true when it succeeds
 uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr);
 
+// Result of comparing read_float() against the original double precision implementation
+typedef struct {
+    uint32_t count;
+    uint32_t mismatches;
+    uint32_t max_ulps;     // UINT32_MAX when the two disagree on where the number ends
+    uint32_t new_inexact;  // results that are not the correctly rounded value
+    uint32_t ref_inexact;
+    uint64_t new_cycles;
+    uint64_t ref_cycles;
+} read_float_check_t;
+
+void read_float_check(uint32_t max_mantissa, read_float_check_t* result);
+
 // Non-blocking delay function used for general operation and suspend features.
 bool delay_msec(int32_t milliseconds, DwellMode mode);
 
@@ -0,0 +1,645 @@
+/*
+  OWord.cpp - Subroutines, loops and numbered parameters in g-code
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+enum class OKey : uint8_t {
+    None = 0,  // No body being recorded
+    Unknown,
+    Sub,
+    EndSub,
+    Call,
+    Repeat,
+    EndRepeat,
+    While,
+    EndWhile,
+};
+
+static const struct {
+    const char* name;
+    OKey        key;
+} oword_keys[] = {
+    { "SUB", OKey::Sub },       { "ENDSUB", OKey::EndSub },       { "CALL", OKey::Call },
+    { "REPEAT", OKey::Repeat }, { "ENDREPEAT", OKey::EndRepeat }, { "WHILE", OKey::While },
+    { "ENDWHILE", OKey::EndWhile },
+};
+
+// A body is a run of entries, each a multiple of 4 bytes long so the words of the next stay aligned
+typedef struct {
+    uint8_t  text;  // The entry holds the collapsed line and its NUL, rather than n_words words
+    uint8_t  n_words;
+    uint16_t size;  // Of the entry, this header included
+} oword_entry_t;
+
+typedef struct {
+    uint8_t* data;
+    uint32_t len;
+    uint32_t cap;
+} oword_body_t;
+
+typedef struct {
+    uint32_t     number;
+    oword_body_t body;
+} oword_sub_t;
+
+static float        oword_params[OWORD_N_PARAMS];
+static oword_sub_t  oword_subs[OWORD_MAX_SUBS];
+static uint8_t      oword_n_subs;
+static OKey         rec_key = OKey::None;        // O-line that opened the body being recorded
+static uint32_t     rec_number;
+static char         rec_expr[LINE_BUFFER_SIZE];  // Its count or condition
+static oword_body_t rec_body;
+static bool         rec_failed;                  // Out of heap; the end line reports it
+static gc_word_t    oword_words[GC_MAX_WORDS];   // Text lines of a body are split into these to run
+
+static bool oword_expr(const char*& s, float* value);
+static Error oword_run(const oword_body_t* body, uint32_t begin, uint32_t end, uint8_t client, uint8_t depth);
+
+static bool oword_match(const char*& s, const char* word) {
+    size_t len = strlen(word);
+    if (strncmp(s, word, len)) {
+        return false;
+    }
+    s += len;
+    return true;
+}
+
+static bool oword_primary(const char*& s, float* value);
+
+// The parameter number after a #
+static bool oword_param_index(const char*& s, int* index) {
+    float number;
+    if (!oword_primary(s, &number)) {
+        return false;
+    }
+    *index = lroundf(number);
+    return *index >= 0 && *index < OWORD_N_PARAMS;
+}
+
+// A number, #n, [expression], function or a signed one of those: what a word value can be
+static bool oword_primary(const char*& s, float* value) {
+    if (*s == '[') {
+        s++;
+        if (!oword_expr(s, value) || *s != ']') {
+            return false;
+        }
+        s++;
+        return true;
+    }
+    if (*s == '#') {
+        s++;
+        int index;
+        if (!oword_param_index(s, &index)) {
+            return false;
+        }
+        *value = oword_params[index];
+        return true;
+    }
+    if (*s == '-' || *s == '+') {
+        bool negative = *s++ == '-';
+        if (!oword_primary(s, value)) {
+            return false;
+        }
+        if (negative) {
+            *value = -*value;
+        }
+        return true;
+    }
+    static const char* const functions[] = { "ABS", "SQRT", "SIN", "COS", "TAN", "ROUND", "FIX", "FUP" };
+    for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); f++) {
+        if (!oword_match(s, functions[f])) {
+            continue;
+        }
+        float arg;
+        if (*s != '[' || !oword_primary(s, &arg)) {
+            return false;
+        }
+        const float rad = M_PI / 180.0f;
+        switch (f) {
+            case 0:
+                *value = fabsf(arg);
+                break;
+            case 1:
+                if (arg < 0.0f) {
+                    return false;
+                }
+                *value = sqrtf(arg);
+                break;
+            case 2:
+                *value = sinf(arg * rad);
+                break;
+            case 3:
+                *value = cosf(arg * rad);
+                break;
+            case 4:
+                *value = tanf(arg * rad);
+                break;
+            case 5:
+                *value = roundf(arg);
+                break;
+            case 6:
+                *value = floorf(arg);
+                break;
+            default:
+                *value = ceilf(arg);
+                break;
+        }
+        return true;
+    }
+    uint8_t char_counter = 0;
+    if (!read_float(s, &char_counter, value)) {
+        return false;
+    }
+    s += char_counter;
+    return true;
+}
+
+static bool oword_product(const char*& s, float* value) {
+    if (!oword_primary(s, value)) {
+        return false;
+    }
+    for (;;) {
+        char  op;
+        float rhs;
+        if (*s == '*' || *s == '/') {
+            op = *s++;
+        } else if (oword_match(s, "MOD")) {
+            op = '%';
+        } else {
+            return true;
+        }
+        if (!oword_primary(s, &rhs) || (op != '*' && rhs == 0.0f)) {
+            return false;
+        }
+        if (op == '*') {
+            *value *= rhs;
+        } else if (op == '/') {
+            *value /= rhs;
+        } else {
+            *value = fmodf(*value, rhs);
+            if (*value < 0.0f) {
+                *value += fabsf(rhs);  // As in LinuxCNC, never negative
+            }
+        }
+    }
+}
+
+static bool oword_sum(const char*& s, float* value) {
+    if (!oword_product(s, value)) {
+        return false;
+    }
+    while (*s == '+' || *s == '-') {
+        char  op = *s++;
+        float rhs;
+        if (!oword_product(s, &rhs)) {
+            return false;
+        }
+        *value = op == '+' ? *value + rhs : *value - rhs;
+    }
+    return true;
+}
+
+static bool oword_comparison(const char*& s, float* value) {
+    if (!oword_sum(s, value)) {
+        return false;
+    }
+    static const char* const ops[] = { "EQ", "NE", "GT", "GE", "LT", "LE" };
+    for (size_t op = 0; op < sizeof(ops) / sizeof(ops[0]); op++) {
+        if (!oword_match(s, ops[op])) {
+            continue;
+        }
+        float rhs;
+        if (!oword_sum(s, &rhs)) {
+            return false;
+        }
+        bool result[] = { *value == rhs, *value != rhs, *value > rhs, *value >= rhs, *value < rhs, *value <= rhs };
+        *value        = result[op];
+        return true;
+    }
+    return true;
+}
+
+static bool oword_expr(const char*& s, float* value) {
+    if (!oword_comparison(s, value)) {
+        return false;
+    }
+    for (;;) {
+        int op;
+        if (oword_match(s, "AND")) {
+            op = 0;
+        } else if (oword_match(s, "OR")) {
+            op = 1;
+        } else if (oword_match(s, "XOR")) {
+            op = 2;
+        } else {
+            return true;
+        }
+        float rhs;
+        if (!oword_comparison(s, &rhs)) {
+            return false;
+        }
+        bool a = *value != 0.0f;
+        bool b = rhs != 0.0f;
+        *value = op == 0 ? (a && b) : op == 1 ? (a || b) : (a != b);
+    }
+}
+
+bool oword_read_value(const char* line, uint8_t* char_counter, float* value) {
+    const char* s = line + *char_counter;
+    if (!oword_primary(s, value)) {
+        return false;
+    }
+    *char_counter = s - line;
+    return true;
+}
+
+// The count of a repeat or condition of a while, the whole rest of its O-line
+static bool oword_condition(const char* s, float* value) {
+    return oword_primary(s, value) && *s == '\0';
+}
+
+// #n=value assignments, taking effect together once all the values are worked out
+static Error oword_assign(const char* line) {
+    const int   max_assign = 8;
+    int         index[max_assign];
+    float       value[max_assign];
+    int         n = 0;
+    const char* s = line;
+    while (*s) {
+        if (*s != '#' || n == max_assign) {
+            return Error::ExpressionSyntax;
+        }
+        s++;
+        if (!oword_param_index(s, &index[n]) || index[n] == 0 || *s != '=') {
+            return Error::ExpressionSyntax;
+        }
+        s++;
+        if (!oword_expr(s, &value[n])) {
+            return Error::ExpressionSyntax;
+        }
+        n++;
+    }
+    for (int i = 0; i < n; i++) {
+        oword_params[index[i]] = value[i];
+    }
+    return Error::Ok;
+}
+
+// O<number><keyword>, with rest left at what follows the keyword
+static OKey oword_parse(const char* line, uint32_t* number, const char** rest) {
+    const char* s = line + 1;
+    if (line[0] != 'O' || !isdigit(*s)) {
+        return OKey::Unknown;
+    }
+    uint32_t n = 0;
+    while (isdigit(*s)) {
+        n = n * 10 + (*s++ - '0');
+    }
+    *number = n;
+    for (auto& k : oword_keys) {
+        if (oword_match(s, k.name)) {
+            *rest = s;
+            return k.key;
+        }
+    }
+    return OKey::Unknown;
+}
+
+static OKey oword_end_of(OKey key) {
+    switch (key) {
+        case OKey::Sub:
+            return OKey::EndSub;
+        case OKey::Repeat:
+            return OKey::EndRepeat;
+        case OKey::While:
+            return OKey::EndWhile;
+        default:
+            return OKey::None;
+    }
+}
+
+static void oword_body_free(oword_body_t* body) {
+    free(body->data);
+    *body = {};
+}
+
+static bool oword_append(oword_body_t* body, bool text, uint8_t n_words, const void* payload, size_t payload_len) {
+    uint32_t size = (sizeof(oword_entry_t) + payload_len + 3) & ~3;
+    if (body->len + size > body->cap) {
+        uint32_t cap = body->cap ? body->cap * 2 : 1024;
+        while (cap < body->len + size) {
+            cap *= 2;
+        }
+        if (heap_caps_get_free_size(MALLOC_CAP_8BIT) < cap - body->cap + OWORD_HEAP_RESERVE) {
+            return false;
+        }
+        uint8_t* data = (uint8_t*)realloc(body->data, cap);
+        if (!data) {
+            return false;
+        }
+        body->data = data;
+        body->cap  = cap;
+    }
+    oword_entry_t* entry = (oword_entry_t*)(body->data + body->len);
+    entry->text          = text;
+    entry->n_words       = n_words;
+    entry->size          = size;
+    memcpy(entry + 1, payload, payload_len);
+    body->len += size;
+    return true;
+}
+
+static inline const oword_entry_t* oword_entry(const oword_body_t* body, uint32_t pos) {
+    return (const oword_entry_t*)(body->data + pos);
+}
+
+static oword_sub_t* oword_find_sub(uint32_t number) {
+    for (int i = 0; i < oword_n_subs; i++) {
+        if (oword_subs[i].number == number) {
+            return &oword_subs[i];
+        }
+    }
+    return NULL;
+}
+
+// Offset of the line that closes the O-line at pos, or end if there is none before it
+static uint32_t oword_find_end(const oword_body_t* body, uint32_t pos, uint32_t end, uint32_t number, OKey key) {
+    for (pos += oword_entry(body, pos)->size; pos < end; pos += oword_entry(body, pos)->size) {
+        const oword_entry_t* entry = oword_entry(body, pos);
+        uint32_t             n;
+        const char*          rest;
+        if (entry->text && oword_parse((const char*)(entry + 1), &n, &rest) == key && n == number) {
+            return pos;
+        }
+    }
+    return end;
+}
+
+// Runs the lines from begin to end of body, a repeat count or for as long as expr holds
+static Error oword_loop(OKey key, const char* expr, const oword_body_t* body, uint32_t begin, uint32_t end, uint8_t client, uint8_t depth) {
+    if (depth >= OWORD_MAX_DEPTH) {
+        return Error::OwordNesting;
+    }
+    float count = 0.0f;
+    if (key == OKey::Repeat && !oword_condition(expr, &count)) {
+        return Error::ExpressionSyntax;
+    }
+    for (uint32_t pass = 0;; pass++) {
+        if (key == OKey::Repeat) {
+            if (pass >= count) {
+                break;
+            }
+        } else {
+            float holds;
+            if (!oword_condition(expr, &holds)) {
+                return Error::ExpressionSyntax;
+            }
+            if (holds == 0.0f) {
+                break;
+            }
+        }
+        protocol_execute_realtime();  // A loop that plans nothing must still see a reset
+        if (sys.abort) {
+            break;
+        }
+        Error status = oword_run(body, begin, end, client, depth + 1);
+        if (status != Error::Ok) {
+            return status;
+        }
+    }
+    return Error::Ok;
+}
+
+static Error oword_call(uint32_t number, const char* rest, uint8_t client, uint8_t depth) {
+    if (depth >= OWORD_MAX_DEPTH) {
+        return Error::OwordNesting;
+    }
+    oword_sub_t* sub = oword_find_sub(number);
+    if (!sub) {
+        return Error::OwordUnknownSub;
+    }
+    float       args[OWORD_CALL_ARGS] = {};
+    int         n_args                = 0;
+    const char* s                     = rest;
+    while (*s == '[') {
+        if (n_args == OWORD_CALL_ARGS || !oword_primary(s, &args[n_args++])) {
+            return Error::ExpressionSyntax;
+        }
+    }
+    static const char axis_letters[] = "XYZABC";
+    float             shift[MAX_N_AXIS] = {};
+    auto              n_axis            = number_axis->get();
+    while (*s) {
+        const char* letter = strchr(axis_letters, *s);
+        if (!letter || letter - axis_letters >= n_axis) {
+            return Error::GcodeUnusedWords;
+        }
+        int axis = letter - axis_letters;
+        s++;
+        if (!oword_primary(s, &shift[axis])) {
+            return Error::BadNumberFormat;
+        }
+        if (gc_state.modal.units == Units::Inches) {
+            shift[axis] *= MM_PER_INCH;
+        }
+    }
+
+    float saved[OWORD_CALL_ARGS];
+    memcpy(saved, &oword_params[1], sizeof(saved));
+    memcpy(&oword_params[1], args, sizeof(args));
+    for (int axis = 0; axis < n_axis; axis++) {
+        gc_state.coord_offset[axis] += shift[axis];
+    }
+    gc_update_wco();
+    Error status = oword_run(&sub->body, 0, sub->body.len, client, depth + 1);
+    for (int axis = 0; axis < n_axis; axis++) {
+        gc_state.coord_offset[axis] -= shift[axis];
+    }
+    gc_update_wco();
+    memcpy(&oword_params[1], saved, sizeof(saved));
+    return status;
+}
+
+static Error oword_run(const oword_body_t* body, uint32_t begin, uint32_t end, uint8_t client, uint8_t depth) {
+    for (uint32_t pos = begin; pos < end && !sys.abort; pos += oword_entry(body, pos)->size) {
+        const oword_entry_t* entry = oword_entry(body, pos);
+        Error                status;
+        if (!entry->text) {
+            status = gc_execute_words((const gc_word_t*)(entry + 1), entry->n_words, client);
+        } else {
+            const char* line = (const char*)(entry + 1);
+            if (line[0] == 'O') {
+                uint32_t    number;
+                const char* rest;
+                OKey        key = oword_parse(line, &number, &rest);
+                switch (key) {
+                    case OKey::Repeat:
+                    case OKey::While: {
+                        uint32_t close = oword_find_end(body, pos, end, number, oword_end_of(key));
+                        if (close == end) {
+                            return Error::OwordNesting;
+                        }
+                        status = oword_loop(key, rest, body, pos + entry->size, close, client, depth);
+                        pos    = close;
+                        break;
+                    }
+                    case OKey::Call:
+                        status = oword_call(number, rest, client, depth);
+                        break;
+                    case OKey::Unknown:
+                        status = Error::GcodeUnsupportedCommand;
+                        break;
+                    default:
+                        status = Error::OwordNesting;  // Subroutines are only defined outside of bodies
+                        break;
+                }
+            } else if (line[0] == '#') {
+                status = oword_assign(line);
+            } else {
+                uint8_t n_words;
+                status = gc_parse_words(line, oword_words, GC_MAX_WORDS, &n_words);
+                if (status == Error::Ok) {
+                    status = gc_execute_words(oword_words, n_words, client);
+                }
+            }
+        }
+        if (status != Error::Ok) {
+            return status;
+        }
+    }
+    return Error::Ok;
+}
+
+bool oword_recording() {
+    return rec_key != OKey::None && !gc_sandbox;
+}
+
+Error oword_record_words(const gc_word_t* words, uint8_t n_words) {
+    if (!oword_append(&rec_body, false, n_words, words, n_words * sizeof(gc_word_t))) {
+        rec_failed = true;
+    }
+    return Error::Ok;
+}
+
+// Other lines are split now, so a run only executes their words
+static Error oword_record_line(const char* line) {
+    if (!line[0]) {
+        return Error::Ok;
+    }
+    if (line[0] == 'O' || strpbrk(line, "#[")) {
+        if (!oword_append(&rec_body, true, 0, line, strlen(line) + 1)) {
+            rec_failed = true;
+        }
+        return Error::Ok;
+    }
+    uint8_t n_words;
+    Error   status = gc_parse_words(line, oword_words, GC_MAX_WORDS, &n_words);
+    if (status != Error::Ok) {
+        return status;  // Left out of the body
+    }
+    return oword_record_words(oword_words, n_words);
+}
+
+// The end line of the body being recorded is in: keeps a subroutine, runs a loop
+static Error oword_finish(uint8_t client) {
+    oword_body_t body = rec_body;
+    OKey         key  = rec_key;
+    rec_body          = {};
+    rec_key           = OKey::None;
+    if (rec_failed) {
+        oword_body_free(&body);
+        return Error::OwordMemory;
+    }
+    if (key != OKey::Sub) {
+        Error status = oword_loop(key, rec_expr, &body, 0, body.len, client, 0);
+        oword_body_free(&body);
+        return status;
+    }
+    oword_sub_t* sub = oword_find_sub(rec_number);
+    if (!sub) {
+        if (oword_n_subs == OWORD_MAX_SUBS) {
+            oword_body_free(&body);
+            return Error::OwordMemory;
+        }
+        sub         = &oword_subs[oword_n_subs++];
+        sub->number = rec_number;
+    } else {
+        oword_body_free(&sub->body);
+    }
+    if (body.len && body.len < body.cap) {
+        uint8_t* data = (uint8_t*)realloc(body.data, body.len);
+        if (data) {
+            body.data = data;
+            body.cap  = body.len;
+        }
+    }
+    sub->body = body;
+    return Error::Ok;
+}
+
+bool oword_claims(const char* line) {
+    return line[0] == 'O' || line[0] == '#' || oword_recording();
+}
+
+Error oword_execute_line(char* line, uint8_t client) {
+    if (gc_sandbox) {
+        return Error::Ok;  // The background check steps over control lines and assignments
+    }
+    uint32_t    number;
+    const char* rest;
+    if (rec_key != OKey::None) {
+        if (oword_parse(line, &number, &rest) == oword_end_of(rec_key) && number == rec_number) {
+            return oword_finish(client);
+        }
+        return oword_record_line(line);
+    }
+    if (line[0] == '#') {
+        return oword_assign(line);
+    }
+    OKey key = oword_parse(line, &number, &rest);
+    switch (key) {
+        case OKey::Sub:
+            if (*rest) {
+                return Error::GcodeUnusedWords;
+            }
+            // fall through
+        case OKey::Repeat:
+        case OKey::While:
+            rec_key    = key;
+            rec_number = number;
+            rec_failed = false;
+            strcpy(rec_expr, rest);
+            return Error::Ok;
+        case OKey::Call:
+            return oword_call(number, rest, client, 0);
+        case OKey::Unknown:
+            return Error::GcodeUnsupportedCommand;
+        default:
+            return Error::OwordNesting;  // An end without its start
+    }
+}
+
+void oword_reset() {
+    for (int i = 0; i < oword_n_subs; i++) {
+        oword_body_free(&oword_subs[i].body);
+    }
+    oword_n_subs = 0;
+    oword_body_free(&rec_body);
+    rec_key = OKey::None;
+    memset(oword_params, 0, sizeof(oword_params));
+}
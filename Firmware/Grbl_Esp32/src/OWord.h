@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+  OWord.h - Subroutines, loops and numbered parameters in g-code
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// The LinuxCNC O-word subset, so a job can run the same part from one copy of its moves:
+//
+//   O100 sub             ...   O100 endsub       defines subroutine 100
+//   O100 call [a] [b]... X.. Y..                 runs it, the arguments in #1..#30
+//   O101 repeat [count]  ...   O101 endrepeat
+//   O102 while [cond]    ...   O102 endwhile
+//
+// The lines of a body are kept in RAM as they arrive instead of being executed, those made of
+// plain words already split into words, so a call or a pass of a loop runs them without the
+// parser seeing the text again. Lines with parameters or expressions are kept as text and
+// split at each run. A subroutine stays defined until a reset; a loop runs once its end line
+// is in. The axis words of a call shift the subroutine by that much in work coordinates, as
+// if by G92, for the length of the call.
+//
+// Parameters #1..#99 are numbers; #1..#30 are local to a call. A word value may be #n or a
+// [expression] of numbers, parameters, + - * / MOD, EQ NE GT GE LT LE, AND OR XOR and ABS,
+// SQRT, SIN, COS, TAN, ROUND, FIX, FUP (degrees for the trigonometry). A line of #n=value
+// assignments sets them once all values on it are worked out. Subroutines and loops nest up to
+// OWORD_MAX_DEPTH deep.
+const int OWORD_MAX_SUBS     = 16;
+const int OWORD_MAX_DEPTH    = 8;
+const int OWORD_N_PARAMS     = 100;  // #0 reads as 0
+const int OWORD_CALL_ARGS    = 30;
+const int OWORD_HEAP_RESERVE = 32768;  // Left free while bodies grow
+
+// Whether gc_execute_line() hands line, collapsed, to oword_execute_line()
+bool  oword_claims(const char* line);
+Error oword_execute_line(char* line, uint8_t client);
+
+// Lines go into a body until its end line. Not while gc_sandbox is set.
+bool  oword_recording();
+Error oword_record_words(const gc_word_t* words, uint8_t n_words);
+
+// A word value that starts with # or [, or a - before one
+inline bool oword_is_expression(const char* s) {
+    return s[0] == '#' || s[0] == '[' || (s[0] == '-' && (s[1] == '#' || s[1] == '['));
+}
+bool oword_read_value(const char* line, uint8_t* char_counter, float* value);
+
+// Drops all subroutines, an unfinished body and the parameters
+void oword_reset();
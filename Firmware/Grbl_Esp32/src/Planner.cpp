@@ -25,12 +25,25 @@
 
 #include "Grbl.h"
 #include <stdlib.h>  // PSoc Required for labs
+#include <atomic>
 
-static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
-static uint8_t      block_buffer_tail;                // Index of the block to process now
-static uint8_t      block_buffer_head;                // Index of the next block to be pushed
-static uint8_t      next_buffer_head;                 // Index of the next buffer head
-static uint8_t      block_buffer_planned;             // Index of the optimally planned block
+static plan_block_t* block_buffer;          // A ring buffer for motion instructions, allocated by plan_init()
+static uint8_t       block_buffer_size;     // Number of blocks in block_buffer, from $Planner/Blocks
+#ifdef USE_LINE_NUMBERS
+static int32_t* block_line_number;  // Indexed like plan_profile
+#endif
+static uint8_t       block_buffer_tail;     // Index of the block to process now
+static uint8_t       block_buffer_head;     // Index of the next block to be pushed
+static uint8_t       next_buffer_head;      // Index of the next buffer head
+static uint8_t       block_buffer_planned;  // Index of the optimally planned block
+static bool          block_buffer_replan;   // Next recalculation must cover the whole buffer
+
+static plan_output_t    output_queue[PLAN_OUTPUT_QUEUE_SIZE];  // Indexed by the free running counts below
+static uint8_t          output_head;                           // Next entry to fill, main program
+static uint8_t          output_attached;                       // The entries before this belong to planned blocks
+static volatile uint8_t output_tail;                           // Next entry to apply, stepper
+
+plan_profile_t plan_profile;  // One allocation of block_buffer_size floats per field, by plan_init()
 
 // Define planner variables
 typedef struct {
@@ -39,13 +52,19 @@ typedef struct {
     // i.e. arcs, canned cycles, and backlash compensation.
     float previous_unit_vec[MAX_N_AXIS];  // Unit vector of previous path line segment
     float previous_nominal_speed;         // Nominal speed of previous path line segment
+    // State from before the last block was added, so a following line can be merged into it
+    bool    blend_valid;                   // The last block may absorb the next line
+    int32_t blend_start[MAX_N_AXIS];       // Start of the last block in absolute steps
+    float   blend_unit_vec[MAX_N_AXIS];    // previous_unit_vec before the last block
+    float   blend_nominal_speed;           // previous_nominal_speed before the last block
+    float   blend_deviation;               // Worst case distance of absorbed corners from the last block (mm)
 } planner_t;
 static planner_t pl;
 
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
 uint8_t plan_next_block_index(uint8_t block_index) {
     block_index++;
-    if (block_index == BLOCK_BUFFER_SIZE) {
+    if (block_index == block_buffer_size) {
         block_index = 0;
     }
     return block_index;
@@ -54,7 +73,7 @@ uint8_t plan_next_block_index(uint8_t block_index) {
 // Returns the index of the previous block in the ring buffer
 static uint8_t plan_prev_block_index(uint8_t block_index) {
     if (block_index == 0) {
-        block_index = BLOCK_BUFFER_SIZE;
+        block_index = block_buffer_size;
     }
     block_index--;
     return block_index;
@@ -126,6 +145,10 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
 
 */
 static void planner_recalculate() {
+    float* const entry_speed_sqr_of     = plan_profile.entry_speed_sqr;
+    float* const max_entry_speed_sqr_of = plan_profile.max_entry_speed_sqr;
+    float* const acceleration_of        = plan_profile.acceleration;
+    float* const millimeters_of         = plan_profile.millimeters;
     // Initialize block index to the last block in the planner buffer.
     uint8_t block_index = plan_prev_block_index(block_buffer_head);
     // Bail. Can't do anything with one only one plan-able block.
@@ -135,12 +158,17 @@ static void planner_recalculate() {
     // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
     // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
     // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
-    float         entry_speed_sqr;
-    plan_block_t* next;
-    plan_block_t* current = &block_buffer[block_index];
+    float   entry_speed_sqr;
+    uint8_t next;
+    uint8_t current = block_index;
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
-    block_index              = plan_prev_block_index(block_index);
+    entry_speed_sqr_of[current] = MIN(max_entry_speed_sqr_of[current], 2 * acceleration_of[current] * millimeters_of[current]);
+    // Where the forward pass begins. Moved up to the first block the reverse pass left unchanged.
+    // After a feed hold or override every entry speed may have moved, so no early exit then.
+    uint8_t forward_index = block_buffer_planned;
+    bool    replan        = block_buffer_replan;
+    block_buffer_replan   = false;
+    block_index           = plan_prev_block_index(block_index);
     if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
         // Check if the first block is the tail. If so, notify stepper to update its current parameters.
         if (block_index == block_buffer_tail) {
@@ -148,54 +176,89 @@ static void planner_recalculate() {
         }
     } else {  // Three or more plan-able blocks
         while (block_index != block_buffer_planned) {
-            next        = current;
-            current     = &block_buffer[block_index];
-            block_index = plan_prev_block_index(block_index);
+            next    = current;
+            current = block_index;
+            // Compute maximum entry speed decelerating over the current block from its exit speed.
+            entry_speed_sqr = entry_speed_sqr_of[next] + 2 * acceleration_of[current] * millimeters_of[current];
+            if (entry_speed_sqr > max_entry_speed_sqr_of[current]) {
+                entry_speed_sqr = max_entry_speed_sqr_of[current];
+            }
+            // Appending a block only ever raises entry speeds here. If this one did not move,
+            // usually because it is already at its maximum, nothing before it can change either.
+            if (!replan && entry_speed_sqr == entry_speed_sqr_of[current]) {
+                forward_index = block_index;
+                if (entry_speed_sqr_of[current] == max_entry_speed_sqr_of[current]) {
+                    block_buffer_planned = block_index;
+                }
+                break;
+            }
+            entry_speed_sqr_of[current] = entry_speed_sqr;
+            block_index                 = plan_prev_block_index(block_index);
             // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
             if (block_index == block_buffer_tail) {
                 st_update_plan_block_parameters();
             }
-            // Compute maximum entry speed decelerating over the current block from its exit speed.
-            if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-                entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
-                if (entry_speed_sqr < current->max_entry_speed_sqr) {
-                    current->entry_speed_sqr = entry_speed_sqr;
-                } else {
-                    current->entry_speed_sqr = current->max_entry_speed_sqr;
-                }
-            }
         }
     }
-    // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
+    // Forward Pass: Forward plan the acceleration curve from the planned pointer onward, or from
+    // the first unchanged block when the reverse pass stopped early.
     // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
-    next        = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
-    block_index = plan_next_block_index(block_buffer_planned);
+    next        = forward_index;
+    block_index = plan_next_block_index(forward_index);
     while (block_index != block_buffer_head) {
         current = next;
-        next    = &block_buffer[block_index];
+        next    = block_index;
         // Any acceleration detected in the forward pass automatically moves the optimal planned
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
-        if (current->entry_speed_sqr < next->entry_speed_sqr) {
-            entry_speed_sqr = current->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+        if (entry_speed_sqr_of[current] < entry_speed_sqr_of[next]) {
+            entry_speed_sqr = entry_speed_sqr_of[current] + 2 * acceleration_of[current] * millimeters_of[current];
             // If true, current block is full-acceleration and we can move the planned pointer forward.
-            if (entry_speed_sqr < next->entry_speed_sqr) {
-                next->entry_speed_sqr = entry_speed_sqr;  // Always <= max_entry_speed_sqr. Backward pass sets this.
-                block_buffer_planned  = block_index;      // Set optimal plan pointer.
+            if (entry_speed_sqr < entry_speed_sqr_of[next]) {
+                entry_speed_sqr_of[next] = entry_speed_sqr;  // Always <= max_entry_speed_sqr. Backward pass sets this.
+                block_buffer_planned     = block_index;      // Set optimal plan pointer.
             }
         }
         // Any block set at its maximum entry speed also creates an optimal plan up to this
         // point in the buffer. When the plan is bracketed by either the beginning of the
         // buffer and a maximum entry speed or two maximum entry speeds, every block in between
         // cannot logically be further improved. Hence, we don't have to recompute them anymore.
-        if (next->entry_speed_sqr == next->max_entry_speed_sqr) {
+        if (entry_speed_sqr_of[next] == max_entry_speed_sqr_of[next]) {
             block_buffer_planned = block_index;
         }
         block_index = plan_next_block_index(block_index);
     }
 }
 
+// Allocates the block ring at boot. The size comes from $Planner/Blocks, so a change takes
+// effect after a restart. Falls back to the compiled-in size if the heap cannot hold it.
+void plan_init() {
+    block_buffer_size = planner_blocks->get();
+    block_buffer      = (plan_block_t*)malloc(sizeof(plan_block_t) * block_buffer_size);
+    float* profile    = (float*)malloc(sizeof(float) * 4 * block_buffer_size);
+    if (block_buffer == NULL || profile == NULL) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Planner/Blocks %d does not fit, using %d", block_buffer_size, BLOCK_BUFFER_SIZE);
+        free(block_buffer);
+        free(profile);
+        block_buffer_size = BLOCK_BUFFER_SIZE;
+        block_buffer      = (plan_block_t*)malloc(sizeof(plan_block_t) * block_buffer_size);
+        profile           = (float*)malloc(sizeof(float) * 4 * block_buffer_size);
+    }
+    plan_profile.entry_speed_sqr     = profile;
+    plan_profile.max_entry_speed_sqr = profile + block_buffer_size;
+    plan_profile.acceleration        = profile + 2 * block_buffer_size;
+    plan_profile.millimeters         = profile + 3 * block_buffer_size;
+    for (uint8_t i = 0; i < block_buffer_size; i++) {
+        block_buffer[i].index = i;
+    }
+#ifdef USE_LINE_NUMBERS
+    block_line_number = (int32_t*)calloc(block_buffer_size, sizeof(int32_t));
+#endif
+    plan_reset();
+}
+
 void plan_reset() {
+    StPrepLock lock;
     memset(&pl, 0, sizeof(planner_t));  // Clear planner struct
     plan_reset_buffer();
 }
@@ -205,16 +268,121 @@ void plan_reset_buffer() {
     block_buffer_head    = 0;  // Empty = tail
     next_buffer_head     = 1;  // plan_next_block_index(block_buffer_head)
     block_buffer_planned = 0;  // = block_buffer_tail;
+    block_buffer_replan  = false;
+    // The output changes go with the blocks
+    output_head     = 0;
+    output_attached = 0;
+    output_tail     = 0;
+}
+
+static void IRAM_ATTR plan_output_apply(const plan_output_t* output) {
+    switch (output->kind) {
+        case PlanOutput::Digital:
+            sys_set_digital(output->number, output->value);
+            break;
+        case PlanOutput::Analog:
+            sys_set_analog_isr(output->number, output->value);
+            break;
+        case PlanOutput::Coolant: {
+            CoolantState state = {};
+            state.Mist         = output->value & 1;
+            state.Flood        = (output->value >> 1) & 1;
+            coolant_set_state(state);
+            break;
+        }
+        case PlanOutput::SpindleSpeed:
+            spindle->set_rpm_isr(output->value);
+            break;
+    }
+}
+
+void IRAM_ATTR plan_outputs_run(uint8_t count) {
+    uint8_t tail = output_tail;
+    while (count--) {
+        plan_output_apply(&output_queue[tail++ % PLAN_OUTPUT_QUEUE_SIZE]);
+    }
+    output_tail = tail;
+}
+
+// Nothing queued or moving, that a change would have to wait for. Every attached change has
+// been applied then, so the stepper no longer reads the queue.
+static bool plan_outputs_due() {
+    return block_buffer_head == block_buffer_tail && output_tail == output_attached &&
+           (sys.state == State::Idle || sys.state == State::Alarm || sys.state == State::CheckMode);
+}
+
+void plan_outputs_poll() {
+    if (output_head == output_attached || !plan_outputs_due()) {
+        return;
+    }
+    while (output_attached != output_head) {
+        plan_output_apply(&output_queue[output_attached++ % PLAN_OUTPUT_QUEUE_SIZE]);
+    }
+    output_tail = output_attached;
+}
+
+void plan_queue_output(PlanOutput kind, uint8_t number, uint32_t value) {
+    plan_output_t output = { kind, number, value };
+    mc_coalesce_flush();  // The held line comes before the change
+    if (sim_running() || uint8_t(output_head - output_tail) == PLAN_OUTPUT_QUEUE_SIZE) {
+        protocol_buffer_synchronize();  // A dry run steps the motion from here, and so did a full queue
+        if (sys.abort) {
+            return;
+        }
+    }
+    plan_outputs_poll();
+    if (plan_outputs_due()) {
+        plan_output_apply(&output);
+        return;
+    }
+    output_queue[output_head % PLAN_OUTPUT_QUEUE_SIZE] = output;
+    output_head++;
+}
+
+static plan_path_point_t     path_log[PLAN_PATH_LOG_SIZE];
+static std::atomic<uint32_t> path_log_head;
+
+uint32_t plan_path_head() {
+    return path_log_head;
+}
+
+bool plan_path_read(uint32_t* index, plan_path_point_t* point) {
+    bool gap = false;
+    while (*index != path_log_head) {
+        if (path_log_head - *index > PLAN_PATH_LOG_SIZE) {
+            *index = path_log_head - PLAN_PATH_LOG_SIZE;
+            gap    = true;
+        }
+        *point = path_log[*index % PLAN_PATH_LOG_SIZE];
+        // The slot may have been written again while it was copied
+        if (path_log_head - *index > PLAN_PATH_LOG_SIZE) {
+            continue;
+        }
+        (*index)++;
+        if (gap) {
+            point->cut = false;
+        }
+        return true;
+    }
+    return false;
 }
 
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
+        plan_block_t*      block = &block_buffer[block_buffer_tail];
+        plan_path_point_t* point = &path_log[path_log_head % PLAN_PATH_LOG_SIZE];
+        point->xy_steps[0]       = block->xy_steps[0];
+        point->xy_steps[1]       = block->xy_steps[1];
+        point->cut               = !block->motion.rapidMotion && block->spindle != SpindleState::Disable;
+        path_log_head++;
+
         uint8_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned) {
             block_buffer_planned = block_index;
         }
         block_buffer_tail = block_index;
+        protocol_wake();  // For a wait on a full planner or the end of the motion
     }
 }
 
@@ -236,7 +404,21 @@ float plan_get_exec_block_exit_speed_sqr() {
     if (block_index == block_buffer_head) {
         return 0.0f;
     }
-    return block_buffer[block_index].entry_speed_sqr;
+    return plan_profile.entry_speed_sqr[block_index];
+}
+
+#ifdef USE_LINE_NUMBERS
+int32_t plan_get_line_number(const plan_block_t* block) {
+    return block_line_number != NULL ? block_line_number[block->index] : 0;
+}
+#endif
+
+plan_block_t* plan_get_next_block() {
+    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    if (block_buffer_head == block_buffer_tail || block_index == block_buffer_head) {
+        return NULL;
+    }
+    return &block_buffer[block_index];
 }
 
 // Returns the availability status of the block ring buffer. True, if full.
@@ -268,26 +450,28 @@ float plan_compute_profile_nominal_speed(plan_block_t* block) {
 // previous and current nominal speeds and max junction speed.
 static void plan_compute_profile_parameters(plan_block_t* block, float nominal_speed, float prev_nominal_speed) {
     // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
+    float& max_entry_speed_sqr = plan_profile.max_entry_speed_sqr[block->index];
     if (nominal_speed > prev_nominal_speed) {
-        block->max_entry_speed_sqr = prev_nominal_speed * prev_nominal_speed;
+        max_entry_speed_sqr = prev_nominal_speed * prev_nominal_speed;
     } else {
-        block->max_entry_speed_sqr = nominal_speed * nominal_speed;
+        max_entry_speed_sqr = nominal_speed * nominal_speed;
     }
 
-    if (block->max_entry_speed_sqr > block->max_junction_speed_sqr) {
-        block->max_entry_speed_sqr = block->max_junction_speed_sqr;
+    if (max_entry_speed_sqr > block->max_junction_speed_sqr) {
+        max_entry_speed_sqr = block->max_junction_speed_sqr;
     }
 }
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
+    StPrepLock lock;
     uint8_t       block_index = block_buffer_tail;
     plan_block_t* block;
     float         nominal_speed;
     float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
     while (block_index != block_buffer_head) {
         block         = &block_buffer[block_index];
-        nominal_speed = plan_compute_profile_nominal_speed(block);
+        nominal_speed = block->motion.dwell ? 0.0f : plan_compute_profile_nominal_speed(block);  // Stops either side
         plan_compute_profile_parameters(block, nominal_speed, prev_nominal_speed);
         prev_nominal_speed = nominal_speed;
         block_index        = plan_next_block_index(block_index);
@@ -295,17 +479,101 @@ void plan_update_velocity_profile_parameters() {
     pl.previous_nominal_speed = prev_nominal_speed;  // Update prev nominal speed for next incoming block.
 }
 
+bool plan_override_changes_profile(bool feed_changed, bool rapid_changed) {
+    StPrepLock lock;
+    for (uint8_t block_index = block_buffer_tail; block_index != block_buffer_head; block_index = plan_next_block_index(block_index)) {
+        const plan_block_t* block = &block_buffer[block_index];
+        if (block->motion.rapidMotion ? rapid_changed : (feed_changed && !block->motion.noFeedOverride)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Distance in mm of corner from the line start..end, all in absolute steps, or a negative value
+// when corner does not project onto the line between start and end.
+static float plan_blend_deviation(const int32_t* start, const int32_t* corner, const int32_t* end) {
+    float a_sq = 0.0f, b_sq = 0.0f, a_dot_b = 0.0f;
+    auto  n_axis = motion_config.n_axis;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        float a = (corner[idx] - start[idx]) * motion_config.inv_steps_per_mm[idx];
+        float b = (end[idx] - start[idx]) * motion_config.inv_steps_per_mm[idx];
+        a_sq += a * a;
+        b_sq += b * b;
+        a_dot_b += a * b;
+    }
+    if (a_dot_b <= 0.0f || a_dot_b >= b_sq) {
+        return -1.0f;
+    }
+    float deviation_sq = a_sq - a_dot_b * a_dot_b / b_sq;
+    return deviation_sq > 0.0f ? sqrtf(deviation_sq) : 0.0f;
+}
+
+// Path blending for polylines made of many short segments, as exported for curves by most CAM
+// and laser software. When the new line continues the last queued block closely enough, the
+// block is taken back off the buffer and replanned as one line from its start to the new target,
+// instead of adding a block and a junction slowdown for every vertex. The dropped corners, summed
+// over all lines merged into a block, stay within $Planner/BlendTolerance of the merged line.
+// The tail block is never merged, since the stepper may already be executing it.
+static bool plan_blend_last_block(float* target, plan_line_data_t* pl_data) {
+    float tolerance = planner_blend_tolerance->get();
+    if (tolerance <= 0.0f || !pl.blend_valid || pl_data->motion.rapidMotion || pl_data->motion.systemMotion ||
+        pl_data->motion.inverseTime || pl_data->motion.raster || block_buffer_head == block_buffer_tail) {
+        return false;
+    }
+    uint8_t       block_index = plan_prev_block_index(block_buffer_head);
+    plan_block_t* block       = &block_buffer[block_index];
+    if (block_index == block_buffer_tail || block->motion.noFeedOverride != pl_data->motion.noFeedOverride ||
+        block->spindle != pl_data->spindle || block->coolant.Mist != pl_data->coolant.Mist ||
+        block->coolant.Flood != pl_data->coolant.Flood || block->spindle_speed != pl_data->spindle_speed ||
+        block->programmed_rate != pl_data->feed_rate || output_head != output_attached) {
+        return false;
+    }
+    int32_t target_steps[MAX_N_AXIS];
+    auto    n_axis = motion_config.n_axis;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        target_steps[idx] = lround(target[idx] * motion_config.steps_per_mm[idx]);
+    }
+    float deviation = plan_blend_deviation(pl.blend_start, pl.position, target_steps);
+    if (deviation < 0.0f || pl.blend_deviation + deviation > tolerance) {
+        return false;
+    }
+
+    // Take the last block back and restore the planner state from before it was added. Its
+    // output changes are attached again to the merged block.
+    output_attached -= block->outputs;
+    block_buffer_head = block_index;
+    next_buffer_head  = plan_next_block_index(block_buffer_head);
+    memcpy(pl.position, pl.blend_start, sizeof(pl.position));
+    memcpy(pl.previous_unit_vec, pl.blend_unit_vec, sizeof(pl.previous_unit_vec));
+    pl.previous_nominal_speed = pl.blend_nominal_speed;
+    pl.blend_deviation += deviation;
+    // The merged block may get a lower entry speed than the one it replaces, which the
+    // incremental recalculation cannot see. Replan from the tail, as after an override.
+    block_buffer_planned = block_buffer_tail;
+    block_buffer_replan  = true;
+    return true;
+}
+
 uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    TRACE_SCOPE(TraceEvent::PlanBufferLine);
+    StPrepLock lock;  // The prep task reads the blocks being changed here
+    bool       blended = plan_blend_last_block(target, pl_data);
     // Prepare and initialize new block. Copy relevant pl_data for block execution.
     plan_block_t* block = &block_buffer[block_buffer_head];
     memset(block, 0, sizeof(plan_block_t));  // Zero all block values.
+    block->index                                   = block_buffer_head;
+    plan_profile.entry_speed_sqr[block->index]     = 0.0f;
+    plan_profile.max_entry_speed_sqr[block->index] = 0.0f;
     block->motion        = pl_data->motion;
     block->coolant       = pl_data->coolant;
     block->spindle       = pl_data->spindle;
     block->spindle_speed = pl_data->spindle_speed;
 
 #ifdef USE_LINE_NUMBERS
-    block->line_number = pl_data->line_number;
+    if (block_line_number != NULL) {
+        block_line_number[block->index] = pl_data->line_number;
+    }
 #endif
     // Compute and store initial move distance data.
     int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
@@ -317,15 +585,15 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     } else {
         memcpy(position_steps, pl.position, sizeof(pl.position));
     }
-    auto n_axis = number_axis->get();
+    auto n_axis = motion_config.n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
         // Also, compute individual axes distance for move and prep unit vector calculations.
         // NOTE: Computes true distance from converted step values.
-        target_steps[idx]       = lround(target[idx] * axis_settings[idx]->steps_per_mm->get());
+        target_steps[idx]       = lround(target[idx] * motion_config.steps_per_mm[idx]);
         block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
         block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
-        delta_mm                = (target_steps[idx] - position_steps[idx]) / axis_settings[idx]->steps_per_mm->get();
+        delta_mm                = (target_steps[idx] - position_steps[idx]) * motion_config.inv_steps_per_mm[idx];
         unit_vec[idx]           = delta_mm;  // Store unit vector numerator
         // Set direction bits. Bit enabled always means direction is negative.
         if (delta_mm < 0.0) {
@@ -336,29 +604,32 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     if (block->step_event_count == 0) {
         return PLAN_EMPTY_BLOCK;
     }
+    block->xy_steps[0] = target_steps[X_AXIS];
+    block->xy_steps[1] = target_steps[Y_AXIS];
 
     // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
     // down such that no individual axes maximum values are exceeded with respect to the line direction.
     // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
     // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    float millimeters                       = convert_delta_vector_to_unit_vector(unit_vec);
+    plan_profile.millimeters[block->index]  = millimeters;
+    plan_profile.acceleration[block->index] = limit_acceleration_by_axis_maximum(unit_vec);
+    block->rapid_rate                       = limit_rate_by_axis_maximum(unit_vec);
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
     } else {
         block->programmed_rate = pl_data->feed_rate;
         if (block->motion.inverseTime) {
-            block->programmed_rate *= block->millimeters;
+            block->programmed_rate *= millimeters;
         }
     }
     // TODO: Need to check this method handling zero junction speeds when starting from rest.
     if ((block_buffer_head == block_buffer_tail) || (block->motion.systemMotion)) {
         // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
         // If system motion, the system motion block always is assumed to start from rest and end at a complete stop.
-        block->entry_speed_sqr        = 0.0;
-        block->max_junction_speed_sqr = 0.0;  // Starting from rest. Enforce start from zero velocity.
+        plan_profile.entry_speed_sqr[block->index] = 0.0;
+        block->max_junction_speed_sqr              = 0.0;  // Starting from rest. Enforce start from zero velocity.
     } else {
         // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
         // Let a circle be tangent to both previous and current path line segments, where the junction
@@ -409,10 +680,21 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     if (!(block->motion.systemMotion)) {
         float nominal_speed = plan_compute_profile_nominal_speed(block);
         plan_compute_profile_parameters(block, nominal_speed, pl.previous_nominal_speed);
+        // Remember the state before this block, for merging the next line into it.
+        pl.blend_valid = !(block->motion.rapidMotion || block->motion.inverseTime || block->motion.raster);
+        memcpy(pl.blend_start, position_steps, sizeof(position_steps));
+        memcpy(pl.blend_unit_vec, pl.previous_unit_vec, sizeof(pl.previous_unit_vec));
+        pl.blend_nominal_speed = pl.previous_nominal_speed;
+        if (!blended) {
+            pl.blend_deviation = 0.0f;
+        }
         pl.previous_nominal_speed = nominal_speed;
         // Update previous path unit_vector and planner position.
         memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec));  // pl.previous_unit_vec[] = unit_vec[]
         memcpy(pl.position, target_steps, sizeof(target_steps));   // pl.position[] = target_steps[]
+        // The output changes queued since the last block wait for the motion before this one
+        block->outputs  = output_head - output_attached;
+        output_attached = output_head;
         // New block is all set. Update buffer head and next buffer head indices.
         block_buffer_head = next_buffer_head;
         next_buffer_head  = plan_next_block_index(block_buffer_head);
@@ -422,6 +704,38 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     return PLAN_OK;
 }
 
+void plan_buffer_dwell(uint32_t milliseconds, plan_line_data_t* pl_data) {
+    StPrepLock    lock;
+    plan_block_t* block = &block_buffer[block_buffer_head];
+    memset(block, 0, sizeof(plan_block_t));
+    block->index                                   = block_buffer_head;
+    plan_profile.entry_speed_sqr[block->index]     = 0.0f;
+    plan_profile.max_entry_speed_sqr[block->index] = 0.0f;  // The motion before stops here
+    plan_profile.acceleration[block->index]        = 0.0f;
+    plan_profile.millimeters[block->index]         = 0.0f;
+    block->motion                                  = {};
+    block->motion.dwell                            = 1;
+    block->coolant                                 = pl_data->coolant;
+    block->spindle                                 = pl_data->spindle;
+    block->spindle_speed                           = pl_data->spindle_speed;
+    block->dwell_ms                                = milliseconds;
+    block->xy_steps[0]                             = pl.position[X_AXIS];
+    block->xy_steps[1]                             = pl.position[Y_AXIS];
+#ifdef USE_LINE_NUMBERS
+    if (block_line_number != NULL) {
+        block_line_number[block->index] = pl_data->line_number;
+    }
+#endif
+    // The next line starts from rest and is not merged into the one before
+    pl.previous_nominal_speed = 0.0f;
+    pl.blend_valid            = false;
+    block->outputs            = output_head - output_attached;
+    output_attached           = output_head;
+    block_buffer_head         = next_buffer_head;
+    next_buffer_head          = plan_next_block_index(block_buffer_head);
+    planner_recalculate();
+}
+
 // Reset the planner position vectors. Called by the system abort/initialization routine.
 void plan_sync_position() {
     // TODO: For motor configurations not in the same coordinate frame as the machine position,
@@ -431,12 +745,13 @@ void plan_sync_position() {
     for (idx = 0; idx < n_axis; idx++) {
         pl.position[idx] = sys_position[idx];
     }
+    pl.blend_valid = false;
 }
 
 // Returns the number of available blocks are in the planner buffer.
 uint8_t plan_get_block_buffer_available() {
     if (block_buffer_head >= block_buffer_tail) {
-        return (BLOCK_BUFFER_SIZE - 1) - (block_buffer_head - block_buffer_tail);
+        return (block_buffer_size - 1) - (block_buffer_head - block_buffer_tail);
     } else {
         return block_buffer_tail - block_buffer_head - 1;
     }
@@ -448,15 +763,17 @@ uint8_t plan_get_block_buffer_count() {
     if (block_buffer_head >= block_buffer_tail) {
         return block_buffer_head - block_buffer_tail;
     } else {
-        return BLOCK_BUFFER_SIZE - (block_buffer_tail - block_buffer_head);
+        return block_buffer_size - (block_buffer_tail - block_buffer_head);
     }
 }
 
 // Re-initialize buffer plan with a partially completed block, assumed to exist at the buffer tail.
 // Called after a steppers have come to a complete stop for a feed hold and the cycle is stopped.
 void plan_cycle_reinitialize() {
+    StPrepLock lock;
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
     st_update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
+    block_buffer_replan  = true;
     planner_recalculate();
 }
@@ -24,13 +24,10 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-// The number of linear motions that can be in the plan at any give time
+// The default number of linear motions that can be in the plan at any give time.
+// The actual size is the $Planner/Blocks setting, read once at boot.
 #ifndef BLOCK_BUFFER_SIZE
-#    ifdef USE_LINE_NUMBERS
-#        define BLOCK_BUFFER_SIZE 15
-#    else
-#        define BLOCK_BUFFER_SIZE 16
-#    endif
+#    define BLOCK_BUFFER_SIZE 16
 #endif
 
 // Returned status message from planner.
@@ -43,6 +40,8 @@ struct PlMotion {
     uint8_t systemMotion : 1;    // Single motion. Circumvents planner state. Used by home/park.
     uint8_t noFeedOverride : 1;  // Motion does not honor feed override.
     uint8_t inverseTime : 1;     // Interprets feed rate value as inverse time when set.
+    uint8_t raster : 1;          // Laser power comes from the next raster row, pixel by pixel.
+    uint8_t dwell : 1;           // No motion, the stepper times dwell_ms. See plan_buffer_dwell().
 };
 
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
@@ -58,18 +57,12 @@ typedef struct {
     PlMotion     motion;   // Block bitflag motion conditions. Copied from pl_line_data.
     SpindleState spindle;  // Spindle enable state
     CoolantState coolant;  // Coolant state
-#ifdef USE_LINE_NUMBERS
-    int32_t line_number;  // Block line number for real-time reporting. Copied from pl_line_data.
-#endif
 
-    // Fields used by the motion planner to manage acceleration. Some of these values may be updated
-    // by the stepper module during execution of special motion cases for replanning purposes.
-    float entry_speed_sqr;      // The current planned entry speed at block junction in (mm/min)^2
-    float max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
-    //   neighboring nominal speeds with overrides in (mm/min)^2
-    float acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
-    float millimeters;   // The remaining distance for this block to be executed in (mm).
-    // NOTE: This value may be altered by stepper algorithm during execution.
+    // The entry speeds, acceleration and distance the motion planner manages are in plan_profile,
+    // at this index. Some of them may be updated by the stepper module during execution of
+    // special motion cases for replanning purposes.
+    uint8_t index;  // Slot of this block in the ring and in plan_profile
+    uint8_t outputs;  // Output queue entries to apply as the block starts, see plan_queue_output()
 
     // Stored rate limiting data used by planner when changes occur.
     float max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (mm/min)^2
@@ -79,8 +72,25 @@ typedef struct {
     // Stored spindle speed data used by spindle overrides and resuming methods.
     float spindle_speed;  // Block spindle speed. Copied from pl_line_data.
     //#endif
+
+    int32_t xy_steps[2];  // X and Y motor position at the end of the block, for the path log
+
+    uint32_t dwell_ms;  // Dwell time left. Counted down by the stepper as it prepares the dwell.
 } plan_block_t;
 
+// The fields the forward and reverse passes of the plan recalculation walk, each in an array of
+// its own indexed like the block ring, so the passes read one array of floats at a time instead
+// of striding over whole blocks. Reached from a block through plan_block_t::index.
+typedef struct {
+    float* entry_speed_sqr;      // The current planned entry speed at block junction in (mm/min)^2
+    float* max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
+    //   neighboring nominal speeds with overrides in (mm/min)^2
+    float* acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
+    float* millimeters;   // The remaining distance for this block to be executed in (mm).
+    // NOTE: This value may be altered by stepper algorithm during execution.
+} plan_profile_t;
+extern plan_profile_t plan_profile;
+
 // Planner data prototype. Must be used when passing new motions to the planner.
 typedef struct {
     float        feed_rate;      // Desired feed rate for line motion. Value is ignored, if rapid motion.
@@ -95,6 +105,7 @@ typedef struct {
 } plan_line_data_t;
 
 // Initialize and reset the motion plan subsystem
+void plan_init();          // Allocate the block buffer. Called once at boot after settings are loaded.
 void plan_reset();         // Reset all
 void plan_reset_buffer();  // Reset buffer only.
 
@@ -103,28 +114,85 @@ void plan_reset_buffer();  // Reset buffer only.
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
 uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data);
 
+// Adds a G4 dwell as a block without steps, timed by the stepper, so the blocks after it can be
+// planned while it runs. The motion before it stops at its start and the motion after it starts
+// from rest. The spindle and coolant state are taken from pl_data.
+void plan_buffer_dwell(uint32_t milliseconds, plan_line_data_t* pl_data);
+
 // Called when the current block is no longer needed. Discards the block and makes the memory
 // availible for new blocks.
 void plan_discard_current_block();
 
+// M62/M63, M67, M7/M8/M9 and, with $Spindle/Speed/Queued, S words change outputs in step with
+// the motion instead of draining the planner first. A change waits in a small queue and is attached to the next line planned; the
+// stepper applies it as that line's first segment loads, when the motion before it is done. A
+// change that no line follows is applied by plan_outputs_poll() once the motion has stopped.
+enum class PlanOutput : uint8_t {
+    Digital = 0,   // number is the M62/M63 P word, value 0 or 1
+    Analog,        // number is the M67 E word, value the PWM numerator
+    Coolant,       // value is the Mist and Flood bits of CoolantState
+    SpindleSpeed,  // value is the S word, for a spindle already on
+};
+
+typedef struct {
+    PlanOutput kind;
+    uint8_t    number;
+    uint32_t   value;
+} plan_output_t;
+
+const int PLAN_OUTPUT_QUEUE_SIZE = 32;  // A power of 2. With the queue full, a change waits for the motion to stop.
+
+void plan_queue_output(PlanOutput kind, uint8_t number, uint32_t value);  // Main program
+void plan_outputs_poll();                                                 // Main loop
+void plan_outputs_run(uint8_t count);                                     // Stepper, at a block's first segment
+
+// Path log: the X and Y end point of every block handed to the stepper, in motor steps, kept
+// in a small ring for the live toolpath view. Written only by plan_discard_current_block(), so
+// logging costs a few stores per block. A reader keeps its own index into the log.
+typedef struct {
+    int32_t xy_steps[2];
+    bool    cut;  // A feed move with the spindle or laser on
+} plan_path_point_t;
+
+const int PLAN_PATH_LOG_SIZE = 128;
+
+uint32_t plan_path_head();  // Index the next logged point will get
+// Copies the point at *index and advances it. Returns false when there is no newer point. A
+// reader that fell a whole ring behind skips ahead; the first point after the gap is not a cut.
+bool plan_path_read(uint32_t* index, plan_path_point_t* point);
+
 // Gets the planner block for the special system motion cases. (Parking/Homing)
 plan_block_t* plan_get_system_motion_block();
 
 // Gets the current block. Returns NULL if buffer empty
 plan_block_t* plan_get_current_block();
 
+#ifdef USE_LINE_NUMBERS
+// The line number of a block, kept beside the ring like plan_profile so blocks stay the size
+// they are without line numbers. 0 when the line had none.
+int32_t plan_get_line_number(const plan_block_t* block);
+#endif
+
 // Called periodically by step segment buffer. Mostly used internally by planner.
 uint8_t plan_next_block_index(uint8_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
 
+// Returns the block after the executing one, or NULL if there is none yet.
+plan_block_t* plan_get_next_block();
+
 // Called by main program during planner calculations and step segment buffer during initialization.
 float plan_compute_profile_nominal_speed(plan_block_t* block);
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
 
+// True when a change of the feed or rapid override changes the nominal speed of any buffered
+// block, so the plan has to be recalculated. Jogs ignore the feed override, and feed moves the
+// rapid override.
+bool plan_override_changes_profile(bool feed_changed, bool rapid_changed);
+
 // Reset the planner position vector (in steps)
 void plan_sync_position();
 
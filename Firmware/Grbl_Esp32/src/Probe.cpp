@@ -26,6 +26,12 @@
 
 // Inverts the probe pin state depending on user settings and probing cycle mode.
 static bool is_probe_away;
+static bool is_probe_invert;  // $6, copied when the direction is set so the ISR reads no setting
+
+// The probe edge, either way. Latches the position at the edge instead of at the next step.
+static void IRAM_ATTR isr_probe() {
+    probe_state_monitor();
+}
 
 PROBE_CTRL_T probe_ctrl;
 
@@ -39,6 +45,7 @@ void probe_init() {
 #else
         pinMode(PROBE_PIN, INPUT_PULLUP);  // Enable internal pull-up resistors. Normal high operation.
 #endif
+        attachInterrupt(digitalPinToInterrupt(PROBE_PIN), isr_probe, CHANGE);
 
         if (show_init_msg) {
             grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Probe on pin %s", pinName(PROBE_PIN).c_str());
@@ -48,7 +55,8 @@ void probe_init() {
 }
 
 void set_probe_direction(bool is_away) {
-    is_probe_away = is_away;
+    is_probe_away   = is_away;
+    is_probe_invert = probe_invert->get();
 }
 
 // Returns the probe pin state. Triggered = true. Called by gcode parser and probe state monitor.
@@ -57,13 +65,13 @@ bool probe_get_state() {
 }
 
 // Monitors probe pin state and records the system position when detected. Called by the
-// stepper ISR per ISR tick.
-// NOTE: This function must be extremely efficient as to not bog down the stepper ISR.
-void probe_state_monitor() {
-    if (probe_get_state() ^ is_probe_away) {
+// probe pin ISR on each edge, and once by mc_probe_cycle() to catch an edge before it armed.
+void IRAM_ATTR probe_state_monitor() {
+    if (PROBE_PIN != UNDEFINED_PIN && sys_probe_state == Probe::Active && (digitalRead(PROBE_PIN) ^ is_probe_invert ^ is_probe_away)) {
         sys_probe_state = Probe::Off;
         memcpy(sys_probe_position, sys_position, sizeof(sys_position));
         sys_rt_exec_state.bit.motionCancel = true;
+        protocol_wake();
     }
 }
 
@@ -77,7 +85,7 @@ static void event_probe_yes(lv_obj_t* obj, lv_event_t event) {
 
             if(mks_ui_page.mks_ui_page != MKS_UI_Ready) {
                 mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
-                lv_obj_clean(mks_global.mks_src);
+                mks_lv_clean_src();
                 mks_draw_ready();
             }else {
                 common_popup_com_del();
@@ -60,7 +60,7 @@ void set_probe_direction(bool is_away);
 bool probe_get_state();
 
 // Monitors probe pin state and records the system position when detected. Called by the
-// stepper ISR per ISR tick.
+// probe pin ISR on each edge while probing.
 void probe_state_monitor();
 
 void mks_probe_init(void);
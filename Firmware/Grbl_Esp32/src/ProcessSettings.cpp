@@ -1,7 +1,10 @@
 #include "Grbl.h"
 #include <map>
+#include <vector>
+#include <algorithm>
 #include "Regex.h"
 #include "mks/MKS_I2C_Slave.h"
+#include "mks/MKS_draw_lvgl.h"
 
 // WG Readable and writable as guest
 // WU Readable and writable as user and admin
@@ -46,6 +49,7 @@ void settings_restore(uint8_t restore_flag) {
 #endif
     if (restore_flag & SettingsRestore::Defaults) {
         bool restore_startup = restore_flag & SettingsRestore::StartupLines;
+        Setting::batchBegin();
         for (Setting* s = Setting::List; s; s = s->next()) {
             if (!s->getDescription()) {
                 const char* name = s->getName();
@@ -56,6 +60,8 @@ void settings_restore(uint8_t restore_flag) {
                 }
             }
         }
+        Setting::batchCommit();
+        motion_config_update();
         grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Settings reset done");
     }
     if (restore_flag & SettingsRestore::Parameters) {
@@ -68,13 +74,12 @@ void settings_restore(uint8_t restore_flag) {
 
 // Get settings values from non volatile storage into memory
 void load_settings() {
-    for (Setting* s = Setting::List; s; s = s->next()) {
-        s->load();
-    }
+    Setting::loadAll();
 }
 
 extern void make_settings();
 extern void make_grbl_commands();
+static void word_index_build();
 
 namespace WebUI {
     extern void make_web_settings();
@@ -84,7 +89,9 @@ void settings_init() {
     make_settings();
     WebUI::make_web_settings();
     make_grbl_commands();
+    word_index_build();
     load_settings();
+    motion_config_update();
 }
 
 // TODO Settings - jog may need to be special-cased in the parser, since
@@ -117,28 +124,53 @@ Error report_gcode(const char* value, WebUI::AuthenticationLevel auth_level, Web
     return Error::Ok;
 }
 
-void show_grbl_settings(WebUI::ESPResponseStream* out, type_t type, bool wantAxis) {
+void show_grbl_settings(String& dump, type_t type, bool wantAxis) {
     for (Setting* s = Setting::List; s; s = s->next()) {
         if (s->getType() == type && s->getGrblName()) {
             bool isAxis = s->getAxis() != NO_AXIS;
             // The following test could be expressed more succinctly with XOR,
             // but is arguably clearer when written out
             if ((wantAxis && isAxis) || (!wantAxis && !isAxis)) {
-                show_setting(s->getGrblName(), s->getCompatibleValue(), NULL, out);
+                dump += '$';
+                dump += s->getGrblName();
+                dump += '=';
+                dump += s->getCompatibleValue();
+                dump += "\r\n";
             }
         }
     }
 }
+
+// Every sender asks for $$ as it connects, so the text of $$ and $+ is kept and only built
+// again once a setting may have changed. It goes out in one write, in whole output blocks.
+static String            settings_dump[2];  // $$, $+
+static uint32_t          settings_dump_generation[2];
+static SemaphoreHandle_t settings_dump_lock;  // The WebUI runs commands in a task of its own
+
+static void show_settings_dump(WebUI::ESPResponseStream* out, bool extended) {
+    xSemaphoreTake(settings_dump_lock, portMAX_DELAY);
+    String& dump = settings_dump[extended];
+    if (settings_dump_generation[extended] != Setting::generation()) {
+        dump = "";
+        show_grbl_settings(dump, GRBL, false);  // GRBL non-axis settings
+        if (extended) {
+            show_grbl_settings(dump, EXTENDED, false);  // Extended non-axis settings
+        }
+        show_grbl_settings(dump, GRBL, true);  // GRBL axis settings
+        if (extended) {
+            show_grbl_settings(dump, EXTENDED, true);  // Extended axis settings
+        }
+        settings_dump_generation[extended] = Setting::generation();
+    }
+    grbl_send(out->client(), dump.c_str());
+    xSemaphoreGive(settings_dump_lock);
+}
 Error report_normal_settings(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
-    show_grbl_settings(out, GRBL, false);  // GRBL non-axis settings
-    show_grbl_settings(out, GRBL, true);   // GRBL axis settings
+    show_settings_dump(out, false);
     return Error::Ok;
 }
 Error report_extended_settings(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
-    show_grbl_settings(out, GRBL, false);      // GRBL non-axis settings
-    show_grbl_settings(out, EXTENDED, false);  // Extended non-axis settings
-    show_grbl_settings(out, GRBL, true);       // GRBL axis settings
-    show_grbl_settings(out, EXTENDED, true);   // Extended axis settings
+    show_settings_dump(out, true);
     return Error::Ok;
 }
 Error list_grbl_names(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
@@ -334,6 +366,31 @@ Error doJog(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESP
     return gc_execute_line(jogLine, out->client());
 }
 
+// Continuous jog, see jog_stream_set(). The value is a velocity in mm/min per axis, like
+// X1000Y-500, and must be repeated within JOG_STREAM_TIMEOUT_MS to keep moving. No value, or
+// all zeros, stops at once.
+Error jog_velocity(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    float velocity[MAX_N_AXIS] = {};
+    auto  n_axis               = number_axis->get();
+    while (value && *value) {
+        if (*value == ' ') {
+            value++;
+            continue;
+        }
+        const char* letter = strchr("XYZABC", toupper(*value));
+        if (!letter || letter - "XYZABC" >= n_axis) {
+            return Error::InvalidStatement;
+        }
+        char* endptr;
+        velocity[letter - "XYZABC"] = strtof(value + 1, &endptr);
+        if (endptr == value + 1) {
+            return Error::BadNumberFormat;
+        }
+        value = endptr;
+    }
+    return jog_stream_set(velocity);
+}
+
 // Global variable to track if step counting is enabled
 bool step_counting_enabled = false;
 
@@ -343,11 +400,10 @@ Error toggle_step_counting(const char* value, WebUI::AuthenticationLevel auth_le
     
     if (step_counting_enabled) {
         // Reset step counters when enabling
-        for (uint8_t idx = 0; idx < MAX_N_AXIS; idx++) {
-            sys.jog_step_counts[idx] = 0;
-        }
+        jog_steps_reset();
         grbl_sendf(out->client(), "[MSG:Step counting enabled]\r\n");
     } else {
+        jog_steps_end();  // Keep the steps of a running jog up to now
         grbl_sendf(out->client(), "[MSG:Step counting disabled]\r\n");
     }
     
@@ -360,9 +416,7 @@ Error jogToLimitSwitch(const char* value, uint8_t axis, WebUI::AuthenticationLev
     
     step_counting_enabled = true;
     
-    for (uint8_t idx = 0; idx < MAX_N_AXIS; idx++) {
-        sys.jog_step_counts[idx] = 0;
-    }
+    jog_steps_reset();
     
     float direction = -1.0;  // Default direction is negative
     float feedrate = 1000;  // Default 1000mm/min
@@ -425,19 +479,15 @@ Error jogZToLimit(const char* value, WebUI::AuthenticationLevel auth_level, WebU
     return jogToLimitSwitch(value, Z_AXIS, auth_level, out);
 }
 
-// Function to send a color JSON command to Arduino
+// Function to send a color command to Arduino
 Error send_color_command(const char* value, const char* colorName, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
     if (!value) {
         grbl_sendf(out->client(), "[MSG: Please specify a %s color value]\r\n", colorName);
         return Error::InvalidValue;
     }
     
-    // Prepare the JSON payload
-    char jsonBuffer[32];
-    snprintf(jsonBuffer, sizeof(jsonBuffer), "{\"color\":\"%s\"}", value);
-    
-    // Send JSON to Arduino
-    bool success = send_json_to_arduino(jsonBuffer);
+    // Send the color to Arduino
+    bool success = send_color_to_arduino(value);
     
     if (success) {
         grbl_sendf(out->client(), "[MSG: Color set to %s]\r\n", value);
@@ -555,16 +605,451 @@ Error motor_disable(const char* value, WebUI::AuthenticationLevel auth_level, We
     return Error::Ok;
 }
 
+static void report_stepper_stats(const char* label, const stepper_isr_stats_t* stats, WebUI::ESPResponseStream* out) {
+    if (stats->count == 0) {
+        grbl_sendf(out->client(), "%s: no samples\r\n", label);
+        return;
+    }
+    uint32_t avg = stats->total_cycles / stats->count;
+    // A step every max_cycles is the fastest rate that never overruns the ISR
+    uint32_t max_rate = (ESP.getCpuFreqMHz() * 1000000UL) / stats->max_cycles;
+    grbl_sendf(out->client(),
+               "%s: min %u avg %u max %u cycles, max rate %u steps/s\r\n",
+               label,
+               stats->min_cycles,
+               avg,
+               stats->max_cycles,
+               max_rate);
+}
+
+// Times the step path for every stepper type with the motors detached, then reports the live
+// ISR statistics collected since the last run, and the part of them spent setting the spindle
+// at segment loads.  The optional value is the step count per run.
+Error bench_stepper(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t n_step = 1000;
+    if (value) {
+        char* endptr;
+        n_step = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || n_step == 0 || n_step > UINT16_MAX) {
+            return Error::InvalidValue;
+        }
+    }
+    if (plan_get_current_block() != NULL) {
+        return Error::IdleError;
+    }
+
+    stepper_isr_stats_t stats;
+    const stepper_id_t  steppers[] = { ST_TIMED, ST_RMT, ST_I2S_STATIC, ST_I2S_STREAM };
+    for (auto stepper : steppers) {
+        for (uint8_t amass_level = 0; amass_level <= maxAmassLevel; amass_level++) {
+            char label[48];
+            snprintf(label, sizeof(label), "%s, AMASS %d", stepper_names[stepper], amass_level);
+            st_bench(stepper, n_step, amass_level, &stats);
+            report_stepper_stats(label, &stats, out);
+        }
+    }
+
+    st_isr_stats_get(&stats);
+    report_stepper_stats("Live ISR", &stats, out);
+    grbl_sendf(out->client(), "Live ISR missed: %u\r\n", stats.missed);
+    st_spindle_isr_stats_get(&stats);
+    report_stepper_stats("Live spindle load", &stats, out);
+    st_isr_stats_reset();
+    return Error::Ok;
+}
+
+// Times G1 lines through the g-code parser with and without the fast path, then runs the
+// built-in workloads of Simulate.h in check mode and as dry runs.  The optional value is the
+// number of lines per run.
+Error bench_gcode(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t n_line = 1000;
+    if (value) {
+        char* endptr;
+        n_line = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || n_line == 0 || n_line > UINT16_MAX) {
+            return Error::InvalidValue;
+        }
+    }
+    if (plan_get_current_block() != NULL) {
+        return Error::IdleError;
+    }
+
+    const bool fast_paths[] = { true, false };
+    for (auto fast_path : fast_paths) {
+        uint64_t cycles = gc_bench(n_line, fast_path);
+        uint32_t rate   = cycles ? (uint64_t)ESP.getCpuFreqMHz() * 1000000 * n_line / cycles : 0;
+        grbl_sendf(out->client(),
+                   "G-code %s: avg %u cycles/line, %u lines/s\r\n",
+                   fast_path ? "fast path" : "full parser",
+                   (uint32_t)(cycles / n_line),
+                   rate);
+    }
+
+    uint64_t hz = (uint64_t)ESP.getCpuFreqMHz() * 1000000;
+    for (int i = 0; i < int(SimWorkload::Count); i++) {
+        auto         workload = static_cast<SimWorkload>(i);
+        sim_result_t check, dry;
+        Error        err = sim_bench(workload, n_line, false, &check);
+        if (err == Error::Ok) {
+            err = sim_bench(workload, n_line, true, &dry);
+        }
+        if (err != Error::Ok) {
+            return err;
+        }
+        uint64_t dry_cycles = dry.parse_cycles + dry.prep_cycles + dry.step_cycles;
+        grbl_sendf(out->client(),
+                   "%s: check %u lines/s, dry run %u lines/s, %u blocks/s, prep %u cycles/segment\r\n",
+                   sim_workload_name(workload),
+                   check.parse_cycles ? (uint32_t)(hz * check.lines / check.parse_cycles) : 0,
+                   dry_cycles ? (uint32_t)(hz * dry.lines / dry_cycles) : 0,
+                   dry_cycles ? (uint32_t)(hz * dry.blocks / dry_cycles) : 0,
+                   dry.segments ? (uint32_t)(dry.prep_cycles / dry.segments) : 0);
+    }
+    return Error::Ok;
+}
+
+// Checks read_float() against the original implementation over every decimal placement of the
+// integers up to the optional value, and reports how fast each one parses.
+Error bench_read_float(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t max_mantissa = 99999;
+    if (value) {
+        char* endptr;
+        max_mantissa = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || max_mantissa > 99999999) {
+            return Error::InvalidValue;
+        }
+    }
+
+    read_float_check_t result;
+    read_float_check(max_mantissa, &result);
+    grbl_sendf(out->client(), "read_float: %u numbers, %u differ, max %u ulp\r\n", result.count, result.mismatches, result.max_ulps);
+    grbl_sendf(out->client(), "read_float: %u inexact, reference %u inexact\r\n", result.new_inexact, result.ref_inexact);
+    grbl_sendf(out->client(),
+               "read_float: avg %u cycles, reference avg %u cycles\r\n",
+               (uint32_t)(result.new_cycles / result.count),
+               (uint32_t)(result.ref_cycles / result.count));
+    return Error::Ok;
+}
+
+// Starts or stops status reports pushed to this client every $Report/Interval msec, so a sender
+// need not poll with '?'.  With $Report/Delta, the reports carry only the fields that changed.
+Error report_subscribe(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (report_interval->get() == 0) {
+        grbl_sendf(out->client(), "$Report/Interval is 0, no reports are pushed\r\n");
+    }
+    report_status_subscribe(out->client(), true);
+    return Error::Ok;
+}
+Error report_unsubscribe(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    report_status_subscribe(out->client(), false);
+    return Error::Ok;
+}
+
+// Times the status report, built but not sent, with and without the position cache.  The
+// optional value is the number of reports per run.
+Error bench_status(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t n_report = 1000;
+    if (value) {
+        char* endptr;
+        n_report = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || n_report == 0 || n_report > UINT16_MAX) {
+            return Error::InvalidValue;
+        }
+    }
+
+    const bool cached[] = { true, false };
+    for (auto use_cache : cached) {
+        uint64_t cycles = report_status_bench(n_report, use_cache);
+        uint32_t usec   = cycles / n_report / ESP.getCpuFreqMHz();
+        grbl_sendf(out->client(),
+                   "Status %s: avg %u cycles/report, %u us\r\n",
+                   use_cache ? "cached" : "uncached",
+                   (uint32_t)(cycles / n_report),
+                   usec);
+    }
+    return Error::Ok;
+}
+
+// Times the segment generator over synthetic planner blocks.  The optional value is the number
+// of blocks.  The rate is how many segments per second the prep code could sustain at worst.
+Error bench_prep(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t n_block = 100;
+    if (value) {
+        char* endptr;
+        n_block = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || n_block == 0 || n_block > UINT16_MAX) {
+            return Error::InvalidValue;
+        }
+    }
+    if (plan_get_current_block() != NULL) {
+        return Error::IdleError;
+    }
+
+    stepper_isr_stats_t stats;
+    st_bench_prep(n_block, &stats);
+    if (stats.count == 0) {
+        grbl_sendf(out->client(), "Segment prep: no samples\r\n");
+        return Error::Ok;
+    }
+    uint32_t avg      = stats.total_cycles / stats.count;
+    uint32_t max_rate = (ESP.getCpuFreqMHz() * 1000000UL) / stats.max_cycles;
+    grbl_sendf(out->client(),
+               "Segment prep: %u segments, min %u avg %u max %u cycles/segment, max rate %u segments/s\r\n",
+               stats.count,
+               stats.min_cycles,
+               avg,
+               stats.max_cycles,
+               max_rate);
+    return Error::Ok;
+}
+
+static void report_disp_pass(const char* label, const MKS_DISP_BENCH_PASS_T* pass, WebUI::ESPResponseStream* out) {
+    uint32_t render_us = pass->frame_us - pass->flush_us;
+    grbl_sendf(out->client(),
+               "Display %s: %u frames/s, %u bytes/frame, render %u us, flush %u us\r\n",
+               label,
+               pass->frame_us ? (uint32_t)((uint64_t)pass->frames * 1000000 / pass->frame_us) : 0,
+               pass->bytes / pass->frames,
+               render_us / pass->frames,
+               pass->flush_us / pass->frames);
+}
+
+// Redraws the whole screen and a strip of it the optional value times each in the display task,
+// times one screen pushed over the bus alone, then reports the live display load since the last
+// run: the share of the UI core spent in lv_task_handler(), and in the flushes.
+Error bench_display(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t n_frame = 20;
+    if (value) {
+        char* endptr;
+        n_frame = strtoul(value, &endptr, 10);
+        if (*endptr != '\0' || n_frame == 0 || n_frame > 1000) {
+            return Error::InvalidValue;
+        }
+    }
+
+    int64_t          now  = esp_timer_get_time();
+    MKS_DISP_STATS_T live = mks_disp_stats;
+    MKS_DISP_BENCH_T result;
+    if (!mks_disp_bench(n_frame, &result)) {
+        return Error::AnotherInterfaceBusy;
+    }
+    report_disp_pass("full screen", &result.full, out);
+    report_disp_pass("strip", &result.strip, out);
+    uint32_t kbps = result.spi_us ? (uint64_t)result.spi_bytes * 1000000 / 1024 / result.spi_us : 0;
+    grbl_sendf(out->client(),
+               "Display SPI: %u kB/s, %u%% of the %u MHz clock\r\n",
+               kbps,
+               (uint32_t)((uint64_t)kbps * 1024 * 8 * 100 / result.spi_hz),
+               result.spi_hz / 1000000);
+
+    uint64_t elapsed = now - live.since_us;
+    if (elapsed > 0) {
+        grbl_sendf(out->client(),
+                   "Display live: %u flushes, %u kB, lv_task_handler %u%% of the core, flush %u%%\r\n",
+                   live.flushes,
+                   (uint32_t)(live.bytes / 1024),
+                   (uint32_t)(live.handler_us * 100 / elapsed),
+                   (uint32_t)(live.flush_us * 100 / elapsed));
+    }
+    memset(&mks_disp_stats, 0, sizeof(mks_disp_stats));
+    mks_disp_stats.since_us = esp_timer_get_time();
+    return Error::Ok;
+}
+
+// LVGL heap use, as sampled by the display task at each page change and once a second, and the
+// glyph cache
+Error show_ui_mem(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    grbl_sendf(out->client(),
+               "LVGL heap %u bytes, used %u, biggest free %u, frag %u%%\r\n",
+               mks_lv_mem.total_size,
+               mks_lv_mem.used_size,
+               mks_lv_mem.free_biggest_size,
+               mks_lv_mem.frag_pct);
+    grbl_sendf(out->client(), "High water: used %u, biggest free %u\r\n", mks_lv_mem.used_max, mks_lv_mem.free_biggest_min);
+    grbl_sendf(out->client(),
+               "Glyph cache %u of %u, %u hits, %u misses\r\n",
+               mks_font_cache_stats.used,
+               MKS_FONT_CACHE_NUM,
+               mks_font_cache_stats.hits,
+               mks_font_cache_stats.misses);
+    return Error::Ok;
+}
+
+// Heap, largest free block, task stacks and hot path allocations, then the LVGL heap
+Error show_heap(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    heap_report(out->client());
+    return show_ui_mem(value, auth_level, out);
+}
+
+// CPU use of each task since the last $Tasks, see TaskStats.h
+Error show_tasks(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value) {
+        if (strcasecmp(value, "Off") != 0) {
+            return Error::InvalidValue;
+        }
+        task_stats_stop();
+        return Error::Ok;
+    }
+    if (!task_stats_running()) {
+        task_stats_start();
+        grbl_sendf(out->client(), "Tasks: sampling, send $Tasks again for the window\r\n");
+        return Error::Ok;
+    }
+    task_stats_report(out->client());
+    return Error::Ok;
+}
+
+// The background item running and the queue behind it, see Worker.h; $Worker=Cancel stops them
+Error show_worker(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value) {
+        if (strcasecmp(value, "Cancel") != 0) {
+            return Error::InvalidValue;
+        }
+        worker_cancel();
+        return Error::Ok;
+    }
+    const char* name = worker_current();
+    if (!name) {
+        grbl_sendf(out->client(), "Worker: idle, %u queued\r\n", worker_queued());
+    } else if (worker_percent() < 0) {
+        grbl_sendf(out->client(), "Worker: %s, %u queued\r\n", name, worker_queued());
+    } else {
+        grbl_sendf(out->client(), "Worker: %s %d%%, %u queued\r\n", name, worker_percent(), worker_queued());
+    }
+    return Error::Ok;
+}
+
+// Static DRAM and the internal heap, see ini/mem_report.py for the split by subsystem
+Error show_mem(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    mem_report(out->client());
+    return Error::Ok;
+}
+
+// Planner and segment buffer starvation. Any value clears the counters after the report.
+Error show_motion_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    stepper_perf_stats_t stats;
+    st_perf_stats_get(&stats);
+    grbl_sendf(out->client(), "Planner empty %u times, segment buffer empty %u times\r\n", stats.planner_empty, stats.segment_empty);
+    if (stats.min_blocks == UINT8_MAX) {
+        grbl_sendf(out->client(), "Min planner blocks: planner not filled yet\r\n");
+    } else {
+        grbl_sendf(out->client(), "Min planner blocks %u of %u\r\n", stats.min_blocks, plan_get_block_buffer_count() + plan_get_block_buffer_available());
+    }
+    grbl_sendf(out->client(),
+               "Motion %.1f s, below nominal feed %.1f s (%.1f%%)\r\n",
+               stats.motion_time * 60.0f,
+               stats.slow_time * 60.0f,
+               stats.motion_time > 0.0f ? 100.0f * stats.slow_time / stats.motion_time : 0.0f);
+    grbl_sendf(out->client(),
+               "Segment profiles reused for %u of %u blocks\r\n",
+               stats.profile_hits,
+               stats.profile_hits + stats.profile_misses);
+    if (value) {
+        st_perf_stats_reset();
+    }
+    return Error::Ok;
+}
+
+// Spin-up times of spindles with speed feedback. Any value clears them after the report.
+Error show_spindle_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    spindle_sync_stats_t stats = spindle_sync_stats;
+    grbl_sendf(out->client(),
+               "Spindle at speed %u times, last %u ms, avg %u ms, max %u ms, timeouts %u\r\n",
+               stats.count,
+               stats.last_ms,
+               stats.count ? uint32_t(stats.total_ms / stats.count) : 0,
+               stats.max_ms,
+               stats.timeouts);
+    if (value) {
+        memset(&spindle_sync_stats, 0, sizeof(spindle_sync_stats));
+    }
+    return Error::Ok;
+}
+
+Error settings_batch_begin(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    Setting::batchBegin();
+    return Error::Ok;
+}
+
+Error settings_batch_commit(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    return Setting::batchCommit();
+}
+
+Error show_boot_timing(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    boot_report(out->client());
+    return Error::Ok;
+}
+
+Error show_dynamixel_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    dynamixel_report_stats(out->client());
+    if (value) {
+        dynamixel_reset_stats();
+    }
+    return Error::Ok;
+}
+
+#ifdef USE_TRACE
+Error trace_dump_command(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    trace_dump(out->client());
+    return Error::Ok;
+}
+
+Error trace_clear_command(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    trace_clear();
+    return Error::Ok;
+}
+#endif
+
+#ifdef USE_STEP_PCNT
+Error show_step_verify(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    step_verify_stats_t stats;
+    step_verify_stats_get(&stats);
+    grbl_sendf(out->client(), "Step count checks %u, errors %u\r\n", stats.checks, stats.errors);
+    auto n_axis = number_axis->get();
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        if (stats.lost[axis] != 0) {
+            grbl_sendf(out->client(), "%s lost %d steps\r\n", reportAxisNameMsg(axis), stats.lost[axis]);
+        }
+    }
+    if (value) {
+        step_verify_stats_reset();
+    }
+    return Error::Ok;
+}
+#endif
+
+#ifdef USE_I2S_OUT
+Error show_i2s_status(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint32_t count, len, underruns;
+    i2s_out_get_dma_info(&count, &len, &underruns);
+    grbl_sendf(out->client(),
+               "DMA %u x %u bytes, %u us/sample, latency %u ms, underruns %u\r\n",
+               count,
+               len,
+               i2s_out_get_usec_per_pulse(),
+               i2s_out_get_delay_ms(),
+               underruns);
+    return Error::Ok;
+}
+#endif
+
 // Commands use the same syntax as Settings, but instead of setting or
 // displaying a persistent value, a command causes some action to occur.
 // That action could be anything, from displaying a run-time parameter
 // to performing some system state change.  Each command is responsible
 // for decoding its own value string, if it needs one.
 void make_grbl_commands() {
+    settings_dump_lock = xSemaphoreCreateMutex();
     new GrblCommand("", "Help", show_grbl_help, anyState);
     new GrblCommand("T", "State", showState, anyState);
     new GrblCommand("J", "Jog", doJog, idleOrJog);
+    new GrblCommand(NULL, "Raster/Row", raster_row, idleCycleOrHold);
+    new GrblCommand(NULL, "Raster/Image", raster_image, idleCycleOrHold);
+    new GrblCommand(NULL, "Probe/Grid", heightmap_probe, notCycleOrHold);
+    new GrblCommand(NULL, "Probe/Grid/Clear", heightmap_clear, notCycleOrHold);
+    new GrblCommand(NULL, "Job/Transform", transform_job_command, idleOrAlarm);
     // Add these new commands
+    new GrblCommand("JV", "Jog/Velocity", jog_velocity, idleOrJog);
     new GrblCommand("JX", "Jog X to Limit", jogXToLimit, idleOrJog);
     new GrblCommand("JY", "Jog Y to Limit", jogYToLimit, idleOrJog);
     new GrblCommand("JZ", "Jog Z to Limit", jogZToLimit, idleOrJog);
@@ -586,9 +1071,37 @@ void make_grbl_commands() {
     new GrblCommand("X", "Alarm/Disable", disable_alarm_lock, anyState);
     new GrblCommand("NVX", "Settings/Erase", Setting::eraseNVS, idleOrAlarm, WA);
     new GrblCommand("V", "Settings/Stats", Setting::report_nvs_stats, idleOrAlarm);
+    new GrblCommand(NULL, "Settings/Begin", settings_batch_begin, idleOrAlarm);
+    new GrblCommand(NULL, "Settings/Commit", settings_batch_commit, anyState);
     new GrblCommand("#", "GCode/Offsets", report_ngc, idleOrAlarm);
     new GrblCommand("H", "Home", home_all, idleOrAlarm);
     new GrblCommand("MD", "Motor/Disable", motor_disable, idleOrAlarm);
+    new GrblCommand(NULL, "Report/Subscribe", report_subscribe, anyState);
+    new GrblCommand(NULL, "Report/Unsubscribe", report_unsubscribe, anyState);
+    new GrblCommand(NULL, "Bench/Stepper", bench_stepper, idleOrAlarm);
+    new GrblCommand(NULL, "Bench/Prep", bench_prep, idleOrAlarm);
+    new GrblCommand(NULL, "Bench/GCode", bench_gcode, idleOrAlarm);
+    new GrblCommand(NULL, "Bench/ReadFloat", bench_read_float, idleOrAlarm);
+    new GrblCommand(NULL, "Bench/Status", bench_status, anyState);
+    new GrblCommand(NULL, "Bench/Display", bench_display, idleOrAlarm);
+    new GrblCommand(NULL, "UI/Mem", show_ui_mem, anyState);
+    new GrblCommand(NULL, "Heap", show_heap, anyState);
+    new GrblCommand(NULL, "Mem", show_mem, anyState);
+    new GrblCommand(NULL, "Tasks", show_tasks, anyState);
+    new GrblCommand(NULL, "Worker", show_worker, anyState);
+    new GrblCommand(NULL, "Spindle/Stats", show_spindle_stats, anyState);
+    new GrblCommand(NULL, "Stats", show_motion_stats, anyState);
+    new GrblCommand(NULL, "Dynamixel/Stats", show_dynamixel_stats, anyState);
+#ifdef USE_STEP_PCNT
+    new GrblCommand(NULL, "Stepper/Verify", show_step_verify, anyState);
+#endif
+#ifdef USE_TRACE
+    new GrblCommand(NULL, "Trace/Dump", trace_dump_command, anyState);
+    new GrblCommand(NULL, "Trace/Clear", trace_clear_command, anyState);
+#endif
+#ifdef USE_I2S_OUT
+    new GrblCommand(NULL, "I2SO/Status", show_i2s_status, anyState);
+#endif
 
 #ifdef HOMING_SINGLE_AXIS_COMMANDS
     new GrblCommand("HX", "Home/X", home_x, idleOrAlarm);
@@ -600,6 +1113,7 @@ void make_grbl_commands() {
 #endif
     new GrblCommand("SLP", "System/Sleep", sleep_grbl, idleOrAlarm);
     new GrblCommand("I", "Build/Info", get_report_build_info, idleOrAlarm);
+    new GrblCommand("SS", "Startup/Show", show_boot_timing, anyState);
     new GrblCommand("N", "GCode/StartupLines", report_startup_lines, idleOrAlarm);
     new GrblCommand("RST", "Settings/Restore", restore_settings, idleOrAlarm, WA);
 };
@@ -636,6 +1150,111 @@ char* normalize_key(char* start) {
     return start;
 }
 
+// Sorted index over the names of all settings and commands. Senders query and set settings
+// one at a time when they connect, and each lookup used to walk the lists comparing names.
+// Equal names sort by kind, which is the order the lists used to be searched in.
+enum class WordKind : uint8_t {
+    SettingName = 0,
+    SettingGrblName,
+    Command,  // By name or by Grbl name
+};
+
+typedef struct {
+    const char* key;
+    Word*       word;
+    WordKind    kind;
+} word_index_t;
+
+static std::vector<word_index_t> word_index;
+static Setting*                  word_index_settings = NULL;  // List heads when the index was built
+static Command*                  word_index_commands = NULL;
+
+// The ESPnnn names by number, so the [ESPnnn] commands of the WebUI and the touchscreen are
+// found by comparing integers. Each entry is the first word_index entry with its name.
+typedef struct {
+    uint16_t number;
+    uint16_t entry;  // Into word_index
+} esp_index_t;
+
+static std::vector<esp_index_t> esp_index;
+
+// ESPnnn, any case, without leading zeros, which would not match the name as text
+static bool esp_number(const char* key, uint16_t* number) {
+    if (strncasecmp(key, "ESP", 3) != 0 || !isdigit(key[3]) || (key[3] == '0' && key[4] != '\0')) {
+        return false;
+    }
+    uint32_t n = 0;
+    for (const char* s = key + 3; *s; s++) {
+        if (!isdigit(*s) || n > 6553) {
+            return false;
+        }
+        n = n * 10 + (*s - '0');
+    }
+    if (n > UINT16_MAX) {
+        return false;
+    }
+    *number = n;
+    return true;
+}
+
+static bool esp_index_less(const esp_index_t& a, const esp_index_t& b) {
+    return a.number < b.number;
+}
+
+static bool word_index_less(const word_index_t& a, const word_index_t& b) {
+    int order = strcasecmp(a.key, b.key);
+    return order < 0 || (order == 0 && a.kind < b.kind);
+}
+
+static void word_index_build() {
+    word_index.clear();
+    for (Setting* s = Setting::List; s; s = s->next()) {
+        word_index.push_back({ s->getName(), s, WordKind::SettingName });
+    }
+    for (Setting* s = Setting::List; s; s = s->next()) {
+        if (s->getGrblName()) {
+            word_index.push_back({ s->getGrblName(), s, WordKind::SettingGrblName });
+        }
+    }
+    for (Command* cp = Command::List; cp; cp = cp->next()) {
+        word_index.push_back({ cp->getName(), cp, WordKind::Command });
+        if (cp->getGrblName()) {
+            word_index.push_back({ cp->getGrblName(), cp, WordKind::Command });
+        }
+    }
+    // Stable, so of two words with the same name the one found first in its list still wins
+    std::stable_sort(word_index.begin(), word_index.end(), word_index_less);
+    esp_index.clear();
+    for (size_t i = 0; i < word_index.size(); i++) {
+        uint16_t number;
+        if (esp_number(word_index[i].key, &number) && (i == 0 || strcasecmp(word_index[i - 1].key, word_index[i].key) != 0)) {
+            esp_index.push_back({ number, uint16_t(i) });
+        }
+    }
+    std::sort(esp_index.begin(), esp_index.end(), esp_index_less);
+    word_index_settings = Setting::List;
+    word_index_commands = Command::List;
+}
+
+static const word_index_t* word_index_find(const char* key) {
+    // New words go on the front of their list, so a changed head means the index is out of date
+    if (Setting::List != word_index_settings || Command::List != word_index_commands) {
+        word_index_build();
+    }
+    uint16_t number;
+    if (esp_number(key, &number)) {
+        esp_index_t probe = { number, 0 };
+        auto        it    = std::lower_bound(esp_index.begin(), esp_index.end(), probe, esp_index_less);
+        return it == esp_index.end() || it->number != number ? NULL : &word_index[it->entry];
+    }
+    word_index_t probe = { key, NULL, WordKind::SettingName };
+    auto         it    = std::lower_bound(word_index.begin(), word_index.end(), probe, word_index_less);
+    if (it == word_index.end() || strcasecmp(it->key, key) != 0) {
+        return NULL;
+    }
+    return &*it;
+}
+
 // This is the handler for all forms of settings commands,
 // $..= and [..], with and without a value.
 Error do_command_or_setting(const char* key, char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
@@ -645,47 +1264,29 @@ Error do_command_or_setting(const char* key, char* value, WebUI::AuthenticationL
     // $key= with nothing following the = .  It is important to distinguish
     // those cases so that you can say "$N0=" to clear a startup line.
 
-    // First search the settings list by text name.  If found, set a new
-    // value if one is given, otherwise display the current value
-    for (Setting* s = Setting::List; s; s = s->next()) {
-        if (strcasecmp(s->getName(), key) == 0) {
-            if (auth_failed(s, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            if (value) {
-                return s->setStringValue(value);
-            } else {
-                show_setting(s->getName(), s->getStringValue(), NULL, out);
-                return Error::Ok;
-            }
+    // Settings by text name come first, then settings by compatible name, then commands.
+    // For a setting, set a new value if one is given, otherwise display the current
+    // value, in compatible mode for the compatible name.  Commands handle values
+    // internally; you cannot determine whether to set or display solely based on the
+    // presence of a value.
+    const word_index_t* found = word_index_find(key);
+    if (found) {
+        if (auth_failed(found->word, value, auth_level)) {
+            return Error::AuthenticationFailed;
         }
-    }
-
-    // Then search the setting list by compatible name.  If found, set a new
-    // value if one is given, otherwise display the current value in compatible mode
-    for (Setting* s = Setting::List; s; s = s->next()) {
-        if (s->getGrblName() && strcasecmp(s->getGrblName(), key) == 0) {
-            if (auth_failed(s, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            if (value) {
-                return s->setStringValue(value);
-            } else {
-                show_setting(s->getGrblName(), s->getCompatibleValue(), NULL, out);
-                return Error::Ok;
-            }
+        if (found->kind == WordKind::Command) {
+            return static_cast<Command*>(found->word)->action(value, auth_level, out);
         }
-    }
-    // If we did not find a setting, look for a command.  Commands
-    // handle values internally; you cannot determine whether to set
-    // or display solely based on the presence of a value.
-    for (Command* cp = Command::List; cp; cp = cp->next()) {
-        if ((strcasecmp(cp->getName(), key) == 0) || (cp->getGrblName() && strcasecmp(cp->getGrblName(), key) == 0)) {
-            if (auth_failed(cp, value, auth_level)) {
-                return Error::AuthenticationFailed;
-            }
-            return cp->action(value, auth_level, out);
+        Setting* s = static_cast<Setting*>(found->word);
+        if (value) {
+            return s->setStringValue(value);
         }
+        if (found->kind == WordKind::SettingName) {
+            show_setting(s->getName(), s->getStringValue(), NULL, out);
+        } else {
+            show_setting(s->getGrblName(), s->getCompatibleValue(), NULL, out);
+        }
+        return Error::Ok;
     }
 
     // If we did not find an exact match and there is no value,
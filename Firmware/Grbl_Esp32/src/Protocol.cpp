@@ -27,11 +27,13 @@
 #include "lvgl.h"
 #include "mks/MKS_draw_print.h"
 #include "mks/MKS_draw_wifi.h"
+#include "mks/MKS_draw_powerless.h"
 
 static void protocol_exec_rt_suspend();
 
+static TaskHandle_t protocol_task = NULL;  // The one running protocol_main_loop()
+
 static char    line[LINE_BUFFER_SIZE];     // Line to be executed. Zero-terminated.
-static char    comment[LINE_BUFFER_SIZE];  // Line to be executed. Zero-terminated.
 static uint8_t line_flags           = 0;
 static uint8_t char_counter         = 0;
 static uint8_t comment_char_counter = 0;
@@ -54,27 +56,79 @@ static void empty_lines() {
     }
 }
 
-Error add_char_to_line(char c, uint8_t client) {
-    client_line_t* cl = &client_lines[client];
-    // Simple editing for interactive input
-    if (c == '\b') {
-        // Backspace erases
-        if (cl->len) {
-            --cl->len;
-            cl->buffer[cl->len] = '\0';
+static inline bool is_line_control(char c) {
+    return c == '\n' || c == '\r' || c == '\b';
+}
+
+// Nonzero when any byte of v is zero
+static inline uint32_t has_zero_byte(uint32_t v) {
+    return (v - 0x01010101u) & ~v & 0x80808080u;
+}
+
+// Index of the first line end or backspace in data, or length if there is none. Plain text is
+// stepped over a word at a time once data is aligned.
+static size_t find_line_control(const char* data, size_t length) {
+    size_t i = 0;
+    for (; i < length && (uintptr_t(data + i) & 3); i++) {
+        if (is_line_control(data[i])) {
+            return i;
         }
-        return Error::Ok;
     }
-    if (cl->len == (LINE_BUFFER_SIZE - 1)) {
-        return Error::Overflow;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t w = *(const uint32_t*)(data + i);
+        if (has_zero_byte(w ^ 0x0a0a0a0au) | has_zero_byte(w ^ 0x0d0d0d0du) | has_zero_byte(w ^ 0x08080808u)) {
+            break;
+        }
     }
-    if (c == '\r' || c == '\n') {
+    for (; i < length; i++) {
+        if (is_line_control(data[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+// Adds input to the client's line, stopping after the first line end or overflow. *used is the
+// count of bytes taken, which includes the byte that ended the line or did not fit.
+static Error add_span_to_line(const char* data, size_t length, uint8_t client, size_t* used) {
+    client_line_t* cl = &client_lines[client];
+    size_t         i  = 0;
+    while (i < length) {
+        size_t run  = find_line_control(data + i, length - i);
+        size_t room = LINE_BUFFER_SIZE - 1 - cl->len;
+        if (run > room) {
+            memcpy(cl->buffer + cl->len, data + i, room);
+            cl->len += room;
+            cl->buffer[cl->len] = '\0';
+            *used               = i + room + 1;
+            return Error::Overflow;
+        }
+        memcpy(cl->buffer + cl->len, data + i, run);
+        cl->len += run;
+        cl->buffer[cl->len] = '\0';
+        i += run;
+        if (i == length) {
+            break;
+        }
+        char c = data[i++];
+        // Simple editing for interactive input
+        if (c == '\b') {
+            // Backspace erases
+            if (cl->len) {
+                --cl->len;
+                cl->buffer[cl->len] = '\0';
+            }
+            continue;
+        }
+        *used = i;
+        if (cl->len == (LINE_BUFFER_SIZE - 1)) {
+            return Error::Overflow;
+        }
         cl->len = 0;
         cl->line_number++;
         return Error::Eol;
     }
-    cl->buffer[cl->len++] = c;
-    cl->buffer[cl->len]   = '\0';
+    *used = i;
     return Error::Ok;
 }
 
@@ -95,6 +149,30 @@ Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_l
     return gc_execute_line(line, client);
 }
 
+// Runs the lines of the firmware's own lane, see internal_command_send(). The main loop takes
+// them all, ahead of the clients, and the waits on motion those that need neither the parser
+// nor the planner. A line is run within the other as it waits, so each has its own buffer.
+static void protocol_execute_internal(bool immediate_only) {
+    static char lines[2][LINE_BUFFER_SIZE];
+    static bool immediate_running = false;
+    if (immediate_only) {
+        if (immediate_running) {
+            return;
+        }
+        immediate_running = true;
+    }
+    char* line = lines[immediate_only];
+    while (!sys.abort && internal_command_take(line, immediate_only)) {
+#ifdef REPORT_ECHO_RAW_LINE_RECEIVED
+        report_echo_line_received(line, CLIENT_INPUT);
+#endif
+        report_status_message(execute_line(line, CLIENT_INPUT, WebUI::AuthenticationLevel::LEVEL_GUEST), CLIENT_INPUT);
+    }
+    if (immediate_only) {
+        immediate_running = false;
+    }
+}
+
 bool can_park() {
     return
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
@@ -111,6 +189,7 @@ void protocol_main_loop() {
     static bool first_restart = true;
     uint16_t re_cmd[] = {0x18}; // 复位命令
 
+    protocol_task = xTaskGetCurrentTaskHandle();
     client_reset_read_buffer(CLIENT_ALL);
     empty_lines();
     //uint8_t client = CLIENT_SERIAL; // default client
@@ -150,23 +229,40 @@ void protocol_main_loop() {
       first_restart = false; 
     }
     
-    int c;
     bool is_need_next = false;
     for (;;) {
-#if 1
+        bool busy = false;  // Something left for the next pass, that no one will wake us for
 #ifdef ENABLE_SD_CARD
         if (SD_ready_next) {
-            char fileLine[255];
-                if (readFileLine(fileLine, 255)) {
+            sd_block_t fileBlock;
+                if (readFileBlock(&fileBlock)) {
                     SD_ready_next = false;
-                    report_status_message(execute_line(fileLine, SD_client, SD_auth_level), SD_client);
+                    report_status_message(sd_execute_block(&fileBlock, SD_client, SD_auth_level), SD_client);
+                    mks_powerless_line_done();
                 } 
                 else {
                     if(mks_grbl.carve_times != 0) mks_grbl.carve_times--;
 
                     if(mks_grbl.carve_times > 0) {
-                        setFilePos(0);
+                        sd_rewind();
                         grbl_sendf(CLIENT_SERIAL , "times:%d\n", mks_grbl.carve_times);
+                    }else if (sd_queue_start_next()) {
+                        // Next queued file, on the same mount; SD_ready_next stays set for its first line
+                        char temp[256];
+                        joblog_job_end("done");
+                        report_job_stats(CLIENT_ALL);  // Of the job that ended
+                        st_job_stats_reset();
+                        mks_powerless_job_end();
+                        sd_get_current_filename(temp);
+                        joblog_job_start(temp);
+                        grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "SD queue: running %s, %d more", temp, sd_queue_count());
+                        if (sd_queue_pause->get()) {
+                            protocol_buffer_synchronize();  // Let the last job finish, as M0 does
+                            if (!sys.abort) {
+                                sys_rt_exec_state.bit.feedHold = true;  // Cycle start runs the next one
+                                protocol_execute_realtime();
+                            }
+                        }
                     }else {
                         char temp[50];
                         sd_get_current_filename(temp);
@@ -177,61 +273,36 @@ void protocol_main_loop() {
                         }
                         grbl_notifyf("SD print done", "%s print is successful", temp);
                         grbl_send(CLIENT_ALL, "SD Print Finish!\n");
+                        report_job_stats(CLIENT_ALL);
+                        joblog_job_end("done");
                         // MKS_GRBL_CMD_SEND("G0 X0 Y0 Z0 F300\n");
 
                         sys_rt_f_override                    = FeedOverride::Default;
                         sys_rt_r_override                    = RapidOverride::Default;
                         sys_rt_s_override                    = SpindleSpeedOverride::Default;
 
+                        mks_powerless_job_end();  // Nothing left to resume
                         closeFile();  // close file and clear SD ready/running flags
                     }
                 }
         }
-#endif
-#else
-#ifdef ENABLE_SD_CARD
-        if (SD_ready_next) {
-            char fileLine[255];
-            if (readFileLine(fileLine, 255)) {
-                if (is_rb_empty(&rb_sd) == true) {
-                    rb_write(&rb_sd, fileLine);
-                }
-                SD_ready_next = false;
-                rb_read(&rb_sd, fileLine);
-                report_status_message(execute_line(fileLine, SD_client, SD_auth_level), SD_client);
-            } 
-            else {
-                char temp[50];
-                sd_get_current_filename(temp);
-                if (mks_grbl.is_mks_ts35_flag == true) { 
-                    mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
-                    mks_ui_page.wait_count = DEFAULT_UI_COUNT;
-                    mks_draw_finsh_pupop(); // show print finsh 
-                }
-                grbl_notifyf("SD print done", "%s print is successful", temp);
-                closeFile();  // close file and clear SD ready/running flags
-            }
-        }
-        else {
-                if((sys.state == State::Cycle)) {  
-                    if(is_rb_full(&rb_sd) == false) {
-                        char fileLine[255];
-                        if (readFileLine(fileLine, 255)) {
-                            rb_write(&rb_sd, fileLine);
-                        }
-                    }
-                }
-        }
-#endif
 #endif
         // Receive one line of incoming serial data, as the data becomes available.
         // Filtering, if necessary, is done later in gc_execute_line(), so the
         // filtering is the same with serial and file input.
+        protocol_execute_internal(false);
+        if (sys.abort) {
+            return;
+        }
         uint8_t client = CLIENT_SERIAL;
         char*   line;
         for (client = 0; client < CLIENT_COUNT; client++) {
-            while ((c = client_read(client)) != -1) {
-                Error res = add_char_to_line(c, client);
+            const uint8_t* data;
+            size_t         length;
+            while ((length = client_read_span(client, &data)) != 0) {
+                size_t used;
+                Error  res = add_span_to_line((const char*)data, length, client, &used);
+                client_consume(client, used);
                 switch (res) {
                     case Error::Ok:
                         break;
@@ -247,6 +318,10 @@ void protocol_main_loop() {
                         // auth_level can be upgraded by supplying a password on the command line
                         report_status_message(execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST), client);
                         empty_line(client);
+                        protocol_execute_internal(false);  // Between the lines of a stream, not after it
+                        if (sys.abort) {
+                            return;
+                        }
                         break;
                     case Error::Overflow:
                         report_status_message(Error::Overflow, client);
@@ -257,14 +332,26 @@ void protocol_main_loop() {
                 }
             }  // while serial read
         }      // for clients
+        report_ok_flush(CLIENT_ALL);  // The input has run out, so no more acks to batch for now
         // If there are no more characters in the serial read buffer to be processed and executed,
         // this indicates that g-code streaming has either filled the planner buffer or has
         // completed. In either case, auto-cycle start, if enabled, any queued moves.
+        mc_coalesce_poll();
+        plan_outputs_poll();
+        busy = validate_poll() || busy;
+        Setting::deferredCommit();
+        jog_stream_update();
+        jog_steps_report_check();
+#ifdef ENABLE_SD_CARD
+        mks_powerless_update();
+        joblog_poll();
+#endif
         protocol_auto_cycle_start();
         protocol_execute_realtime();  // Runtime command check point.
         if (sys.abort) {
             return;  // Bail to main() program loop to reset system.
         }
+        system_cpu_poll();
         // check to see if we should disable the stepper drivers ... esp32 work around for disable in main loop.
         if (stepper_idle && stepper_idle_lock_time->get() != 0xff) {
             
@@ -281,21 +368,64 @@ void protocol_main_loop() {
             mks_wifi_connect(wifi_send_username, wifi_send_password);   // 扫描wifi是否需要被发送指令连接
             #endif
         }
+#ifdef ENABLE_SD_CARD
+        busy = busy || SD_ready_next;
+#endif
+        if (!busy && !client_input_pending() && !internal_command_pending()) {
+            protocol_wait();
+        }
     }
     return; /* Never reached */
 }
 
+void IRAM_ATTR protocol_wake() {
+    TaskHandle_t task = protocol_task;
+    if (task == NULL) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &higher_priority_task_woken);
+        if (higher_priority_task_woken) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xTaskNotifyGive(task);
+    }
+}
+
+// Sleeps until protocol_wake(), for PROTOCOL_IDLE_POLL_MS at most, unless a realtime flag is
+// already up. A flag raised without a wake-up waits for the timeout.
+void protocol_wait() {
+    protocol_execute_internal(true);
+    if (sys_rt_exec_state.value != 0 || cycle_stop || sys_rt_exec_alarm != ExecAlarm::None ||
+        sys_rt_exec_accessory_override.value != 0) {
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PROTOCOL_IDLE_POLL_MS));
+}
+
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize() {
+    mc_coalesce_flush();
+    if (sim_running()) {
+        sim_drain(true);
+        return;
+    }
     // If system is queued, ensure cycle resumes if the auto start flag is present.
     protocol_auto_cycle_start();
-    do {
+    for (;;) {
         protocol_execute_realtime();  // Check and execute run-time commands
         if (sys.abort) {
             return;  // Check for system abort
         }
-    } while (plan_get_current_block() || (sys.state == State::Cycle));
+        if (!plan_get_current_block() && sys.state != State::Cycle) {
+            break;
+        }
+        protocol_wait();  // Woken as blocks are finished and at the cycle stop
+    }
+    plan_outputs_poll();  // Changes queued after the last line
 }
 
 // Auto-cycle start triggers when there is a motion ready to execute and if the main program is not
@@ -332,13 +462,18 @@ void protocol_execute_realtime() {
 // machine and controls the various real-time features Grbl has to offer.
 // NOTE: Do not alter this unless you know exactly what you are doing!
 void protocol_exec_rt_system() {
+    report_ok_poll();
     ExecAlarm alarm = sys_rt_exec_alarm;  // Temp variable to avoid calling volatile multiple times.
     if (alarm != ExecAlarm::None) {       // Enter only if an alarm is pending
+        limits_finish_trip();             // The reset a hard limit ISR left to do
         // System alarm. Everything has shutdown by something that has gone severely wrong. Report
         // the source of the error to the user. If critical, Grbl disables by entering an infinite
         // loop until system reset/abort.
         sys.state = State::Alarm;  // Set system alarm state
         report_alarm_message(alarm);
+#ifdef ENABLE_SD_CARD
+        joblog_alarm(alarm);
+#endif
         // Halt everything upon a critical event flag. Currently hard and soft limits flag this.
         if ((alarm == ExecAlarm::HardLimit) || (alarm == ExecAlarm::SoftLimit)) {
             // report_feedback_message(Message::CriticalEvent);
@@ -391,6 +526,7 @@ void protocol_exec_rt_system() {
                 // If in CYCLE or JOG states, immediately initiate a motion HOLD.
                 if (sys.state == State::Cycle || sys.state == State::Jog) {
                     if (!(sys.suspend.bit.motionCancel || sys.suspend.bit.jogCancel)) {  // Block, if already holding.
+                        st_hold_truncate();                 // Start slowing down after the executing segment
                         st_update_plan_block_parameters();  // Notify stepper module to recompute for hold deceleration.
                         sys.step_control             = {};
                         sys.step_control.executeHold = true;  // Initiate suspend state with active flag.
@@ -550,11 +686,17 @@ void protocol_exec_rt_system() {
     }
     // Execute overrides.
     if ((sys_rt_f_override != sys.f_override) || (sys_rt_r_override != sys.r_override)) {
+        bool feed_changed      = sys_rt_f_override != sys.f_override;
+        bool rapid_changed     = sys_rt_r_override != sys.r_override;
         sys.f_override         = sys_rt_f_override;
         sys.r_override         = sys_rt_r_override;
         sys.report_ovr_counter = 0;  // Set to report change immediately
-        plan_update_velocity_profile_parameters();
-        plan_cycle_reinitialize();
+        // Blocks the change does not apply to, like jogs for the feed override, keep their plan.
+        // Otherwise the prep re-profiles from the segment it is at, keeping the segments queued.
+        if (plan_override_changes_profile(feed_changed, rapid_changed)) {
+            plan_update_velocity_profile_parameters();
+            plan_cycle_reinitialize();
+        }
     }
 
     // NOTE: Unlike motion overrides, spindle overrides do not require a planner reinitialization.
@@ -562,8 +704,10 @@ void protocol_exec_rt_system() {
         sys.step_control.updateSpindleRpm = true;
         sys.spindle_speed_ovr             = sys_rt_s_override;
         sys.report_ovr_counter            = 0;  // Set to report change immediately
-        // If spinlde is on, tell it the rpm has been overridden
-        if (gc_state.modal.spindle != SpindleState::Disable) {
+        // If spinlde is on, tell it the rpm has been overridden. A laser in motion has its power
+        // set by the stepper at every segment, with the override and, in M4, the speed scaling,
+        // so setting the unscaled power here would only flash it until the next segment.
+        if (gc_state.modal.spindle != SpindleState::Disable && !(spindle->inLaserMode() && sys.state == State::Cycle)) {
             spindle->set_rpm(gc_state.spindle_speed);
         }
     }
@@ -741,6 +885,7 @@ static void protocol_exec_rt_suspend() {
                         st_go_idle();  // Disable steppers
                         while (!(sys.abort)) {
                             protocol_exec_rt_system();  // Do nothing until reset.
+                            protocol_wait();
                         }
                         return;  // Abort received. Return to re-initialize.
                     }
@@ -848,5 +993,8 @@ static void protocol_exec_rt_suspend() {
             }
         }
         protocol_exec_rt_system();
+        if (sys.suspend.value) {
+            protocol_wait();  // For the hold to finish or a command to resume
+        }
     }
 }
@@ -34,6 +34,9 @@
 #    define LINE_BUFFER_SIZE 256
 #endif
 
+// System motion line numbers must be zero.
+const int PARKING_MOTION_LINE_NUMBER = 0;
+
 // Starts Grbl main loop. It handles all incoming characters from the serial port and executes
 // them as they complete. It is also responsible for finishing the initialization procedures.
 void protocol_main_loop();
@@ -48,5 +51,14 @@ void protocol_auto_cycle_start();
 // Block until all buffered steps are executed
 void protocol_buffer_synchronize();
 
+// The protocol loop sleeps on a task notification when it has nothing to do, and so do its
+// waits for the planner. protocol_wake() gives it one, from a task or an ISR, whenever there
+// is new input, a realtime flag, a freed planner block or a cycle stop. Anything that is only
+// polled still gets its turn within PROTOCOL_IDLE_POLL_MS.
+const int PROTOCOL_IDLE_POLL_MS = 10;
+
+void protocol_wake();
+void protocol_wait();
+
 // Executes the auto cycle feature, if enabled.
 void protocol_auto_cycle_start();
@@ -0,0 +1,138 @@
+/*
+  Raster.cpp - Laser raster rows clocked out by the stepper
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#include <atomic>
+#include <mbedtls/base64.h>
+
+// Single producer, single consumer ring like the segment buffer. The command handler fills and
+// publishes the head, the stepper ISR consumes from the tail.
+static raster_row_t         raster_rows[RASTER_ROW_COUNT];
+static std::atomic<uint8_t> raster_head(0);
+static std::atomic<uint8_t> raster_tail(0);
+
+static inline uint8_t raster_next(uint8_t index) {
+    return index + 1 == RASTER_ROW_COUNT ? 0 : index + 1;
+}
+
+static bool raster_rows_full() {
+    return raster_next(raster_head.load(std::memory_order_relaxed)) == raster_tail.load(std::memory_order_acquire);
+}
+
+// Reads "<float>," from *s. Returns false on a malformed number.
+static bool raster_read_float(const char** s, float* value) {
+    char* end;
+    *value = strtof(*s, &end);
+    if (end == *s || *end != ',') {
+        return false;
+    }
+    *s = end + 1;
+    return true;
+}
+
+raster_row_t* raster_row_claim() {
+    mc_coalesce_flush();  // The row starts from the planner position
+    // Wait for a free row and planner block, running the machine meanwhile as mc_line() does
+    while (plan_check_full_buffer() || raster_rows_full()) {
+        protocol_auto_cycle_start();
+        protocol_execute_realtime();
+        if (sys.abort) {
+            return NULL;
+        }
+    }
+    return &raster_rows[raster_head.load(std::memory_order_relaxed)];
+}
+
+Error raster_row_queue(float dx, float dy, float feed, SpindleState spindle_state, uint32_t spindle_speed) {
+    float target[MAX_N_AXIS];
+    gc_get_machine_position(target);  // Rows run along the machine axes
+    target[X_AXIS] += dx;
+    target[Y_AXIS] += dy;
+
+    if (soft_limits->get()) {
+        limits_soft_check(target);
+    }
+    if (sys.state != State::CheckMode) {
+        plan_line_data_t pl_data = {};
+        pl_data.feed_rate        = feed;
+        pl_data.spindle          = spindle_state;
+        pl_data.spindle_speed    = spindle_speed;
+        pl_data.coolant          = gc_state.modal.coolant;
+        pl_data.motion.raster    = 1;
+
+        // Publish the row with its block, before the prep task can hand the block to the ISR
+        StPrepLock lock;
+        if (plan_buffer_line(target, &pl_data) == PLAN_EMPTY_BLOCK) {
+            return Error::InvalidValue;
+        }
+        raster_head.store(raster_next(raster_head.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+    gc_set_machine_position(target);
+    return Error::Ok;
+}
+
+Error raster_row(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value == NULL) {
+        return Error::InvalidValue;
+    }
+    if (!spindle->inLaserMode()) {
+        return Error::SettingDisabledLaser;
+    }
+
+    float       dx, dy, feed;
+    const char* s = value;
+    if (!raster_read_float(&s, &dx) || !raster_read_float(&s, &dy) || !raster_read_float(&s, &feed)) {
+        return Error::BadNumberFormat;
+    }
+    if (feed <= 0.0f) {
+        return Error::GcodeUndefinedFeedRate;
+    }
+
+    raster_row_t* row = raster_row_claim();
+    if (row == NULL) {
+        return Error::Ok;
+    }
+    size_t n_pixel;
+    if (mbedtls_base64_decode(row->pixel, sizeof(row->pixel), &n_pixel, (const unsigned char*)s, strlen(s)) != 0) {
+        return Error::InvalidValue;
+    }
+    if (n_pixel == 0) {
+        return Error::InvalidValue;
+    }
+    row->n_pixel = n_pixel;
+    row->max_rpm = gc_state.modal.spindle == SpindleState::Disable ? 0 : gc_state.spindle_speed;
+    return raster_row_queue(dx, dy, feed, gc_state.modal.spindle, gc_state.spindle_speed);
+}
+
+const raster_row_t* IRAM_ATTR raster_row_begin() {
+    uint8_t tail = raster_tail.load(std::memory_order_relaxed);
+    if (raster_head.load(std::memory_order_acquire) == tail) {
+        return NULL;
+    }
+    return &raster_rows[tail];
+}
+
+void IRAM_ATTR raster_row_end() {
+    raster_tail.store(raster_next(raster_tail.load(std::memory_order_relaxed)), std::memory_order_release);
+}
+
+void raster_reset() {
+    raster_tail.store(0, std::memory_order_relaxed);
+    raster_head.store(0, std::memory_order_release);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+  Raster.h - Laser raster rows clocked out by the stepper
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// A raster row is one straight scan line planned as a single block, with its pixels clocked out
+// to the laser by the stepper ISR as the line passes over them. It replaces the G1 X.. S.. line
+// per pixel that photo engraving otherwise needs.
+//
+//   $Raster/Row=<dx>,<dy>,<feed>,<pixels>
+//
+// dx and dy are the relative move in mm, feed is in mm/min and pixels is base64, one byte per
+// pixel, spread evenly over the line. A 255 pixel fires at the modal S value and 0 is off. The
+// laser follows the modal M3/M4/M5 state. Longer rows are sent as several consecutive lines.
+
+// Longest row one line can carry. The base64 payload has to fit in LINE_BUFFER_SIZE.
+const int RASTER_ROW_MAX_PIXELS = 160;
+
+// Rows queued ahead of the stepper, one per raster block in the planner or segment buffer
+const int RASTER_ROW_COUNT = 8;
+
+typedef struct {
+    uint16_t n_pixel;
+    uint16_t max_rpm;  // Power of a 255 pixel
+    uint8_t  pixel[RASTER_ROW_MAX_PIXELS];
+} raster_row_t;
+
+Error raster_row(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out);
+
+// The two halves of a row for other producers. raster_row_claim() waits for a free row and
+// planner block, running the machine meanwhile as mc_line() does, and returns the row to fill,
+// or NULL on an abort. raster_row_queue() plans it as the move dx, dy from the parser position.
+raster_row_t* raster_row_claim();
+Error         raster_row_queue(float dx, float dy, float feed, SpindleState spindle_state, uint32_t spindle_speed);
+
+// Stepper side. The ISR takes the oldest row when it loads a raster block and frees it when
+// the block is finished. Rows are queued in the same order as their blocks.
+const raster_row_t* raster_row_begin();
+void                raster_row_end();
+
+// Drops every queued row. Called by st_reset() with the planner and segment buffer.
+void raster_reset();
@@ -0,0 +1,660 @@
+/*
+  RasterImage.cpp - Laser engraving of images on the SD card
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#include <algorithm>
+#include <rom/miniz.h>
+
+static inline uint16_t le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+static inline uint32_t le32(const uint8_t* p) {
+    return le16(p) | ((uint32_t)le16(p + 2) << 16);
+}
+static inline uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+static inline uint8_t luma(uint8_t r, uint8_t g, uint8_t b) {
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+static inline uint8_t over_white(uint8_t gray, uint8_t alpha) {
+    return (gray * alpha + 255 * (255 - alpha)) / 255;
+}
+
+// Reads an image a row at a time, top row first, as 8 bit gray with 0 for black
+class ImageReader {
+public:
+    virtual ~ImageReader() {}
+    virtual const char* name()                  = 0;
+    virtual bool        begin()                 = 0;  // Reads the header, false for a file it cannot read
+    virtual bool        read_row(uint8_t* gray) = 0;
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+protected:
+    ImageReader(File& file) : _file(file) {}
+    File& _file;
+};
+
+// Uncompressed BMP, which is stored bottom row first unless its height is negative
+class BmpReader : public ImageReader {
+public:
+    BmpReader(File& file) : ImageReader(file) {}
+    ~BmpReader() { free(_raw); }
+
+    const char* name() override { return "BMP"; }
+
+    bool begin() override {
+        uint8_t h[54];
+        if (_file.read(h, sizeof(h)) != sizeof(h) || h[0] != 'B' || h[1] != 'M') {
+            return false;
+        }
+        _data                = le32(h + 10);
+        uint32_t dib         = le32(h + 14);
+        int32_t  w           = le32(h + 18);
+        int32_t  ht          = le32(h + 22);
+        _bpp                 = le16(h + 28);
+        uint32_t compression = le32(h + 30);
+        uint32_t colors      = le32(h + 46);
+        if (dib < 40 || w <= 0 || ht == 0) {
+            return false;
+        }
+        // Bit fields are only taken for 32 bits, as the usual BGRA
+        if (!(compression == 0 || (compression == 3 && _bpp == 32))) {
+            return false;
+        }
+        if (_bpp != 1 && _bpp != 4 && _bpp != 8 && _bpp != 24 && _bpp != 32) {
+            return false;
+        }
+        _bottom_up = ht > 0;
+        width      = w;
+        height     = _bottom_up ? ht : -ht;
+        _stride    = (width * _bpp + 31) / 32 * 4;
+        if (_bpp <= 8) {
+            uint32_t n = colors ? MIN(colors, 256u) : 1u << _bpp;
+            _file.seek(14 + dib);
+            for (uint32_t i = 0; i < n; i++) {
+                uint8_t bgr0[4];
+                if (_file.read(bgr0, sizeof(bgr0)) != sizeof(bgr0)) {
+                    return false;
+                }
+                _palette[i] = luma(bgr0[2], bgr0[1], bgr0[0]);
+            }
+        }
+        _raw = (uint8_t*)malloc(_stride);
+        return _raw != NULL;
+    }
+
+    bool read_row(uint8_t* gray) override {
+        uint32_t y = _bottom_up ? height - 1 - _row : _row;
+        _row++;
+        if (!_file.seek(_data + y * _stride) || _file.read(_raw, _stride) != _stride) {
+            return false;
+        }
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* p;
+            switch (_bpp) {
+                case 1:
+                    gray[x] = _palette[(_raw[x >> 3] >> (7 - (x & 7))) & 1];
+                    break;
+                case 4:
+                    gray[x] = _palette[(_raw[x >> 1] >> ((x & 1) ? 0 : 4)) & 0xf];
+                    break;
+                case 8:
+                    gray[x] = _palette[_raw[x]];
+                    break;
+                case 24:
+                    p       = _raw + 3 * x;
+                    gray[x] = luma(p[2], p[1], p[0]);
+                    break;
+                default:
+                    p       = _raw + 4 * x;
+                    gray[x] = luma(p[2], p[1], p[0]);  // Alpha is unreliable in BMP files
+                    break;
+            }
+        }
+        return true;
+    }
+
+private:
+    uint32_t _data;
+    uint32_t _stride;
+    uint16_t _bpp;
+    bool     _bottom_up;
+    uint32_t _row = 0;
+    uint8_t* _raw = NULL;
+    uint8_t  _palette[256] = {};
+};
+
+// PNG, inflated as it is read with the ROM's miniz into a 32 KB window, one row at a time
+class PngReader : public ImageReader {
+public:
+    PngReader(File& file) : ImageReader(file) {}
+    ~PngReader() {
+        free(_inflator);
+        free(_dict);
+        free(_cur);
+        free(_prev);
+    }
+
+    const char* name() override { return "PNG"; }
+
+    bool begin() override {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        uint8_t              h[8 + 8 + 13];
+        if (_file.read(h, sizeof(h)) != sizeof(h) || memcmp(h, signature, 8) != 0 || memcmp(h + 12, "IHDR", 4) != 0) {
+            return false;
+        }
+        width  = be32(h + 16);
+        height = be32(h + 20);
+        _depth = h[24];
+        _color = h[25];
+        if (h[26] != 0 || h[27] != 0 || h[28] != 0) {
+            return false;  // Deflate, adaptive filters, not interlaced
+        }
+        uint8_t channels;
+        switch (_color) {
+            case 0:
+            case 3:
+                channels = 1;
+                break;
+            case 2:
+                channels = 3;
+                break;
+            case 4:
+                channels = 2;
+                break;
+            case 6:
+                channels = 4;
+                break;
+            default:
+                return false;
+        }
+        bool packed = (_depth == 1 || _depth == 2 || _depth == 4) && channels == 1;
+        if (!(packed || _depth == 8 || (_depth == 16 && _color != 3)) || width == 0 || height == 0) {
+            return false;
+        }
+        _pixel_bytes = MAX(1, channels * _depth / 8);
+        _stride      = (width * channels * _depth + 7) / 8;
+        if (_color == 0 && packed) {
+            for (int i = 0; i < (1 << _depth); i++) {
+                _palette[i] = i * 255 / ((1 << _depth) - 1);
+            }
+        }
+
+        // Up to the image data, taking the palette and its transparency on the way
+        _file.seek(sizeof(h) + 4);
+        while (true) {
+            uint8_t chunk[8];
+            if (_file.read(chunk, sizeof(chunk)) != sizeof(chunk)) {
+                return false;
+            }
+            uint32_t len  = be32(chunk);
+            uint32_t next = _file.position() + len + 4;
+            if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+                _idat_left = len;
+                break;
+            }
+            if (memcmp(chunk + 4, "IEND", 4) == 0) {
+                return false;
+            }
+            if (memcmp(chunk + 4, "PLTE", 4) == 0) {
+                for (uint32_t i = 0; i < MIN(len / 3, 256u); i++) {
+                    uint8_t rgb[3];
+                    if (_file.read(rgb, sizeof(rgb)) != sizeof(rgb)) {
+                        return false;
+                    }
+                    _palette[i] = luma(rgb[0], rgb[1], rgb[2]);
+                }
+            } else if (memcmp(chunk + 4, "tRNS", 4) == 0 && _color == 3) {
+                for (uint32_t i = 0; i < MIN(len, 256u); i++) {
+                    int alpha = _file.read();
+                    if (alpha < 0) {
+                        return false;
+                    }
+                    _palette[i] = over_white(_palette[i], alpha);
+                }
+            }
+            _file.seek(next);
+        }
+
+        _inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        _dict     = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+        _cur      = (uint8_t*)malloc(_stride + 1);
+        _prev     = (uint8_t*)calloc(_stride + 1, 1);
+        if (!_inflator || !_dict || !_cur || !_prev) {
+            return false;
+        }
+        tinfl_init(_inflator);
+        return true;
+    }
+
+    bool read_row(uint8_t* gray) override {
+        size_t need = _stride + 1;  // The filter byte, then the row
+        size_t have = 0;
+        while (have < need) {
+            if (_out_pos < _out_end) {
+                size_t n = MIN(need - have, _out_end - _out_pos);
+                memcpy(_cur + have, _dict + _out_pos, n);
+                have += n;
+                _out_pos += n;
+                continue;
+            }
+            if (_done) {
+                return false;
+            }
+            if (_in_pos == _in_len && !_input_end && !fill_input()) {
+                _input_end = true;
+            }
+            size_t       in     = _in_len - _in_pos;
+            size_t       ofs    = _out_end & (TINFL_LZ_DICT_SIZE - 1);
+            size_t       out    = TINFL_LZ_DICT_SIZE - ofs;
+            mz_uint32    flags  = TINFL_FLAG_PARSE_ZLIB_HEADER | (_input_end ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+            tinfl_status status = tinfl_decompress(_inflator, _in + _in_pos, &in, _dict, _dict + ofs, &out, flags);
+            _in_pos += in;
+            _out_pos = ofs;
+            _out_end = ofs + out;
+            if (status == TINFL_STATUS_DONE) {
+                _done = true;
+            } else if (status < TINFL_STATUS_DONE) {
+                return false;
+            }
+        }
+        if (!unfilter()) {
+            return false;
+        }
+        convert(gray);
+        std::swap(_cur, _prev);
+        return true;
+    }
+
+private:
+    // The next bytes of the image data, which may be split over several IDAT chunks
+    bool fill_input() {
+        while (_idat_left == 0) {
+            uint8_t crc_chunk[12];  // CRC of the last chunk, then the next one
+            if (_file.read(crc_chunk, sizeof(crc_chunk)) != sizeof(crc_chunk) || memcmp(crc_chunk + 8, "IDAT", 4) != 0) {
+                return false;
+            }
+            _idat_left = be32(crc_chunk + 4);
+        }
+        size_t n = _file.read(_in, MIN(_idat_left, (uint32_t)sizeof(_in)));
+        if (n == 0) {
+            return false;
+        }
+        _idat_left -= n;
+        _in_pos = 0;
+        _in_len = n;
+        return true;
+    }
+
+    static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+        int p  = a + b - c;
+        int pa = abs(p - a);
+        int pb = abs(p - b);
+        int pc = abs(p - c);
+        return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+    }
+
+    bool unfilter() {
+        uint8_t        filter = _cur[0];
+        uint8_t*       row    = _cur + 1;
+        const uint8_t* up     = _prev + 1;
+        if (filter > 4) {
+            return false;
+        }
+        for (size_t i = 0; i < _stride; i++) {
+            uint8_t a = i >= _pixel_bytes ? row[i - _pixel_bytes] : 0;
+            uint8_t b = up[i];
+            uint8_t c = i >= _pixel_bytes ? up[i - _pixel_bytes] : 0;
+            switch (filter) {
+                case 1:
+                    row[i] += a;
+                    break;
+                case 2:
+                    row[i] += b;
+                    break;
+                case 3:
+                    row[i] += (a + b) >> 1;
+                    break;
+                case 4:
+                    row[i] += paeth(a, b, c);
+                    break;
+            }
+        }
+        return true;
+    }
+
+    void convert(uint8_t* gray) {
+        const uint8_t* p    = _cur + 1;
+        uint8_t        step = _depth == 16 ? 2 : 1;  // The high byte of a 16 bit sample
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* q;
+            switch (_color) {
+                case 0:
+                case 3:
+                    if (_depth < 8) {
+                        uint8_t per = 8 / _depth;
+                        uint8_t idx = (p[x / per] >> (8 - _depth * (x % per + 1))) & ((1 << _depth) - 1);
+                        gray[x]     = _palette[idx];
+                    } else {
+                        gray[x] = _color == 3 ? _palette[p[x]] : p[x * step];
+                    }
+                    break;
+                case 2:
+                    q       = p + x * 3 * step;
+                    gray[x] = luma(q[0], q[step], q[2 * step]);
+                    break;
+                case 4:
+                    q       = p + x * 2 * step;
+                    gray[x] = over_white(q[0], q[step]);
+                    break;
+                default:
+                    q       = p + x * 4 * step;
+                    gray[x] = over_white(luma(q[0], q[step], q[2 * step]), q[3 * step]);
+                    break;
+            }
+        }
+    }
+
+    uint8_t             _depth;
+    uint8_t             _color;
+    uint8_t             _pixel_bytes;
+    uint32_t            _stride;
+    uint8_t             _palette[256] = {};
+    uint32_t            _idat_left    = 0;
+    uint8_t             _in[1024];
+    size_t              _in_pos    = 0;
+    size_t              _in_len    = 0;
+    bool                _input_end = false;
+    bool                _done      = false;
+    size_t              _out_pos   = 0;  // Inflated bytes not taken yet, in _dict
+    size_t              _out_end   = 0;
+    tinfl_decompressor* _inflator  = NULL;
+    uint8_t*            _dict      = NULL;
+    uint8_t*            _cur       = NULL;
+    uint8_t*            _prev      = NULL;
+};
+
+typedef struct {
+    float        width;  // mm
+    float        dpi;
+    float        feed;
+    float        min_power;
+    float        max_power;
+    char         mode;
+    float        pitch;     // Between dots and rows, mm
+    uint32_t     lead;      // Blank dots on each end of a row, for the overscan
+    float        x0;        // Lower left corner
+    float        y0;
+    SpindleState laser;
+    uint32_t     max_rpm;   // Power of a 255 pixel
+} raster_image_job_t;
+
+static const uint8_t bayer4[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+
+// Turns the darkness of the dots of row y into raster pixel levels, in place. Floyd-Steinberg
+// runs back and forth, the errors kept in two rows of n dots with a margin on both sides.
+static void raster_image_quantize(const raster_image_job_t& job, uint8_t* dots, int16_t* err, uint32_t n, uint32_t y) {
+    switch (job.mode) {
+        case 'G':
+            for (uint32_t x = 0; x < n; x++) {
+                if (dots[x]) {
+                    float power = job.min_power + dots[x] * (job.max_power - job.min_power) / 255.0f;
+                    dots[x]     = MAX(1, lroundf(power * 255.0f / job.max_power));
+                }
+            }
+            break;
+        case 'T':
+            for (uint32_t x = 0; x < n; x++) {
+                dots[x] = dots[x] >= 128 ? 255 : 0;
+            }
+            break;
+        case 'O':
+            for (uint32_t x = 0; x < n; x++) {
+                dots[x] = ((dots[x] * 17) >> 8) > bayer4[y & 3][x & 3] ? 255 : 0;
+            }
+            break;
+        default: {
+            int16_t* cur  = err + (y & 1) * (n + 2) + 1;
+            int16_t* next = err + (~y & 1) * (n + 2) + 1;
+            int      step = (y & 1) ? -1 : 1;
+            memset(next - 1, 0, (n + 2) * sizeof(int16_t));
+            for (uint32_t i = 0; i < n; i++) {
+                int32_t x     = step > 0 ? i : n - 1 - i;
+                int32_t value = dots[x] + cur[x];
+                uint8_t level = value >= 128 ? 255 : 0;
+                int32_t e     = value - level;
+                dots[x]       = level;
+                cur[x + step] += e * 7 / 16;
+                next[x - step] += e * 3 / 16;
+                next[x] += e * 5 / 16;
+                next[x + step] += e / 16;
+            }
+        } break;
+    }
+}
+
+// Laser off, as a G0 is in laser mode. gc_state.position follows as for a g-code move.
+static void raster_image_rapid(float x, float y) {
+    float target[MAX_N_AXIS];
+    gc_get_machine_position(target);
+    target[X_AXIS]             = x;
+    target[Y_AXIS]             = y;
+    plan_line_data_t pl_data   = {};
+    pl_data.motion.rapidMotion = 1;
+    pl_data.spindle            = gc_state.modal.spindle;
+    pl_data.coolant            = gc_state.modal.coolant;
+    mc_line(target, &pl_data);
+    gc_set_machine_position(target);
+}
+
+// Dots first..last of a row at y, with job.lead blank dots on each end. The blank dots make the
+// overscan: the row blocks run at the feed, so the planner reaches it on them and the laser
+// fires only at that speed. A row wider than a raster row goes as several in a line.
+static void raster_image_row(const raster_image_job_t& job, const uint8_t* dots, int32_t first, int32_t last, float y, bool forward) {
+    int32_t total = last - first + 1 + 2 * job.lead;
+    int32_t start = forward ? first - job.lead : last + 1 + job.lead;
+    raster_image_rapid(job.x0 + start * job.pitch, y);
+    for (int32_t done = 0; done < total && !sys.abort;) {
+        int32_t       n   = MIN(total - done, RASTER_ROW_MAX_PIXELS);
+        raster_row_t* row = raster_row_claim();
+        if (row == NULL) {
+            return;
+        }
+        for (int32_t i = 0; i < n; i++) {
+            int32_t dot   = forward ? start + done + i : start - 1 - done - i;
+            row->pixel[i] = (dot >= first && dot <= last) ? dots[dot] : 0;
+        }
+        row->n_pixel = n;
+        row->max_rpm = job.max_rpm;
+        raster_row_queue((forward ? n : -n) * job.pitch, 0.0f, job.feed, job.laser, job.max_rpm);
+        done += n;
+    }
+}
+
+// Each dot is the average of the pixels it covers, or a copy of the one it falls on when the
+// image is scaled up. Source rows are read once, in order.
+static Error raster_image_run(ImageReader& image, raster_image_job_t& job, WebUI::ESPResponseStream* out) {
+    uint32_t dots_x = lroundf(job.width * job.dpi / MM_PER_INCH);
+    if (dots_x == 0 || dots_x > RASTER_IMAGE_MAX_DOTS) {
+        grbl_msg_sendf(out->client(), MsgLevel::Info, "Raster image %u dots wide, 1 to %d", dots_x, RASTER_IMAGE_MAX_DOTS);
+        return Error::InvalidValue;
+    }
+    float position[MAX_N_AXIS];
+    gc_get_machine_position(position);  // Rows run along the machine axes, as for $Raster
+    uint32_t dots_y = MAX(1, lroundf((float)dots_x * image.height / image.width));
+    float    speed  = job.feed / 60.0f;  // mm/s
+    job.pitch       = job.width / dots_x;
+    job.lead        = ceilf(speed * speed / (2.0f * axis_settings[X_AXIS]->acceleration->get()) / job.pitch);
+    job.x0          = position[X_AXIS];
+    job.y0          = position[Y_AXIS];
+    job.laser       = gc_state.modal.spindle;
+    job.max_rpm     = job.laser == SpindleState::Disable ? 0 : job.max_power;
+    grbl_msg_sendf(out->client(),
+                   MsgLevel::Info,
+                   "Raster %s %ux%u to %ux%u dots, %.1fx%.1f mm",
+                   image.name(),
+                   image.width,
+                   image.height,
+                   dots_x,
+                   dots_y,
+                   job.width,
+                   dots_y * job.pitch);
+
+    uint8_t*  gray   = (uint8_t*)malloc(image.width);
+    uint32_t* column = (uint32_t*)malloc((dots_x + 1) * sizeof(uint32_t));  // First pixel of each dot
+    uint32_t* sums   = (uint32_t*)malloc(dots_x * sizeof(uint32_t));
+    uint8_t*  dots   = (uint8_t*)malloc(dots_x);
+    int16_t*  err    = (int16_t*)calloc(2 * (dots_x + 2), sizeof(int16_t));
+    Error     status = Error::Ok;
+    if (!gray || !column || !sums || !dots || !err) {
+        grbl_msg_sendf(out->client(), MsgLevel::Info, "Raster image: not enough memory");
+        status = Error::InvalidValue;
+    } else {
+        for (uint32_t x = 0; x <= dots_x; x++) {
+            column[x] = (uint64_t)x * image.width / dots_x;
+        }
+    }
+
+    int32_t loaded  = -1;  // Source row in gray
+    bool    forward = true;
+    for (uint32_t y = 0; y < dots_y && status == Error::Ok && !sys.abort; y++) {
+        uint32_t sy0 = (uint64_t)y * image.height / dots_y;
+        uint32_t sy1 = MAX(sy0 + 1, (uint64_t)(y + 1) * image.height / dots_y);
+        memset(sums, 0, dots_x * sizeof(uint32_t));
+        for (uint32_t sy = sy0; sy < sy1 && status == Error::Ok; sy++) {
+            while (loaded < (int32_t)sy && status == Error::Ok) {
+                status = image.read_row(gray) ? Error::Ok : Error::FsFailedRead;
+                loaded++;
+            }
+            for (uint32_t x = 0; x < dots_x; x++) {
+                uint32_t sx1 = MAX(column[x] + 1, column[x + 1]);
+                for (uint32_t sx = column[x]; sx < sx1; sx++) {
+                    sums[x] += gray[sx];
+                }
+            }
+        }
+        if (status != Error::Ok) {
+            break;
+        }
+
+        int32_t first = -1, last = -1;
+        for (uint32_t x = 0; x < dots_x; x++) {
+            uint32_t span = MAX(1u, column[x + 1] - column[x]) * (sy1 - sy0);
+            dots[x]       = 255 - sums[x] / span;  // Darkness
+        }
+        raster_image_quantize(job, dots, err, dots_x, y);
+        for (uint32_t x = 0; x < dots_x; x++) {
+            if (dots[x]) {
+                first = first < 0 ? x : first;
+                last  = x;
+            }
+        }
+        if (first < 0) {
+            continue;  // All white
+        }
+        raster_image_row(job, dots, first, last, job.y0 + (dots_y - y - 0.5f) * job.pitch, forward);
+        forward = !forward;
+    }
+    if (status == Error::FsFailedRead) {
+        grbl_msg_sendf(out->client(), MsgLevel::Info, "Raster image: bad image data");
+    }
+    if (!sys.abort) {
+        raster_image_rapid(job.x0, job.y0);
+    }
+
+    free(gray);
+    free(column);
+    free(sums);
+    free(dots);
+    free(err);
+    return status;
+}
+
+Error raster_image(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value == NULL) {
+        return Error::InvalidValue;
+    }
+    if (!spindle->inLaserMode()) {
+        return Error::SettingDisabledLaser;
+    }
+
+    const char* comma = strchr(value, ',');
+    if (comma == NULL || comma == value) {
+        return Error::InvalidValue;
+    }
+    String path = String(value).substring(0, comma - value);
+    if (path[0] != '/') {
+        path = "/" + path;
+    }
+    raster_image_job_t job    = {};
+    float*             nums[] = { &job.width, &job.dpi, &job.feed, &job.min_power, &job.max_power };
+    const char*        s      = comma + 1;
+    for (auto num : nums) {
+        char* end;
+        *num = strtof(s, &end);
+        if (end == s || (*end != ',' && *end != '\0')) {
+            return Error::BadNumberFormat;
+        }
+        s = *end ? end + 1 : end;
+    }
+    job.mode = *s ? toupper(*s) : 'F';
+    if (!strchr("GTOF", job.mode) || (*s && s[1] != '\0')) {
+        return Error::InvalidValue;
+    }
+    if (job.feed <= 0.0f) {
+        return Error::GcodeUndefinedFeedRate;
+    }
+    if (job.width <= 0.0f || job.dpi <= 0.0f || job.min_power < 0.0f || job.max_power <= 0.0f || job.min_power > job.max_power) {
+        return Error::InvalidValue;
+    }
+
+    SDState state = get_sd_state(true);
+    if (state != SDState::Idle) {
+        return state == SDState::NotPresent ? Error::FsFailedMount : Error::FsFailedBusy;
+    }
+    File file = SD.open(path.c_str());
+    if (!file) {
+        return Error::FsFailedOpenFile;
+    }
+    set_sd_state(SDState::BusyParsing);  // Not BusyPrinting, which belongs to the job reader
+
+    ImageReader* image = NULL;
+    switch (file.peek()) {
+        case 'B':
+            image = new BmpReader(file);
+            break;
+        case 0x89:
+            image = new PngReader(file);
+            break;
+    }
+    Error status;
+    if (image == NULL || !image->begin()) {
+        grbl_msg_sendf(out->client(), MsgLevel::Info, "Raster image: %s is not a BMP or PNG that can be read", path.c_str());
+        status = Error::FsFailedRead;
+    } else {
+        status = raster_image_run(*image, job, out);
+    }
+    delete image;
+    file.close();
+    set_sd_state(SDState::Idle);
+    return status;
+}
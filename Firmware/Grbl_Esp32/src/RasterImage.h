@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+  RasterImage.h - Laser engraving of images on the SD card
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// Engraves a BMP or PNG image from the SD card as raster rows, without any g-code in between.
+//
+//   $Raster/Image=<file>,<width>,<dpi>,<feed>,<min power>,<max power>[,<mode>]
+//
+// The image is scaled to width mm at dpi dots per inch, its height following from its aspect
+// ratio, and placed with its lower left corner at the current position. Rows run from the top
+// down, back and forth, with an overscan at the feed on both ends so the laser only fires at a
+// constant speed. White dots are not engraved; a row or the part of one that is all white is
+// skipped. Power is in S units and follows the modal M3/M4 state, as for $Raster/Row.
+//
+// The mode tells how a gray level becomes power:
+//   G  grayscale, from min power for the lightest dot to max power for black
+//   T  threshold, max power for the darker half and off for the rest
+//   O  ordered dither with a 4x4 Bayer matrix, dots at max power
+//   F  Floyd-Steinberg error diffusion, dots at max power (the default)
+//
+// BMP: uncompressed, 1, 4, 8, 24 or 32 bits per pixel. PNG: not interlaced, any color type and
+// bit depth. Transparent pixels count as white.
+
+// Widest engraving, in dots
+const int RASTER_IMAGE_MAX_DOTS = 2048;
+
+Error raster_image(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out);
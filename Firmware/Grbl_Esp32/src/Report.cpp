@@ -48,50 +48,138 @@
 
 #include "Grbl.h"
 #include <map>
+#include <atomic>
 #include "mks/MKS_draw_print.h"
 
 // Import the step counting variable
 extern bool step_counting_enabled;
 
 // Variables to track jog state and reporting
-bool jog_step_report_pending = false;
-uint64_t jog_complete_time = 0;
 
 #ifdef REPORT_HEAP
 EspClass esp;
 #endif
 const int DEFAULTBUFFERSIZE = 64;
 
-void grbl_send(uint8_t client, const char* text) {
+// $Report/OkBatch holds the acks of a Bluetooth, WebUI or telnet client back, for at most that
+// many ms, and sends them in one write, so a stream over WiFi is not one small packet per line.
+// They go out when the main loop has run out of input, and ahead of any other output to the
+// client, so the order a sender sees is unchanged.
+const int OK_BATCH_MAX = 16;  // Acks in one write
+
+typedef struct {
+    uint8_t count;
+    int64_t since_us;  // When the first one was held
+} ok_batch_t;
+
+static ok_batch_t       ok_batch[CLIENT_COUNT];
+static volatile uint8_t ok_batch_clients;  // Clients with acks held, one bit each
+static portMUX_TYPE     ok_batch_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void report_ok_send(uint8_t client) {
+    portENTER_CRITICAL(&ok_batch_mux);
+    uint8_t count          = ok_batch[client].count;
+    ok_batch[client].count = 0;
+    ok_batch_clients &= ~bit(client);
+    portEXIT_CRITICAL(&ok_batch_mux);
+    if (count == 0) {
+        return;
+    }
+    char text[OK_BATCH_MAX * 4 + 1];
+    if (report_ok_credit->get()) {
+        snprintf(text, sizeof(text), "ok:%d,%d\r\n", count, client_get_rx_buffer_available(client));
+    } else {
+        for (int i = 0; i < count; i++) {
+            memcpy(text + i * 4, "ok\r\n", 4);
+        }
+        text[count * 4] = '\0';
+    }
     client_write(client, text);
 }
 
-// This is a formating version of the grbl_send(CLIENT_ALL,...) function that work like printf
-void grbl_sendf(uint8_t client, const char* format, ...) {
-    if (client == CLIENT_INPUT) {
+static void report_ok(uint8_t client) {
+    if (report_ok_batch->get() == 0 || !(client == CLIENT_BT || client == CLIENT_WEBUI || client == CLIENT_TELNET)) {
+        grbl_send(client, "ok\r\n");
         return;
     }
-    char    loc_buf[64];
-    char*   temp = loc_buf;
-    va_list arg;
+    portENTER_CRITICAL(&ok_batch_mux);
+    if (ok_batch[client].count++ == 0) {
+        ok_batch[client].since_us = esp_timer_get_time();
+        ok_batch_clients |= bit(client);
+    }
+    bool full = ok_batch[client].count == OK_BATCH_MAX;
+    portEXIT_CRITICAL(&ok_batch_mux);
+    if (full) {
+        report_ok_send(client);
+    }
+}
+
+void report_ok_flush(uint8_t client) {
+    for (uint8_t c = 0; ok_batch_clients && c < CLIENT_COUNT; c++) {
+        if ((client == CLIENT_ALL || client == c) && bit_istrue(ok_batch_clients, bit(c))) {
+            report_ok_send(c);
+        }
+    }
+}
+
+void report_ok_poll() {
+    if (!ok_batch_clients) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    for (uint8_t c = 0; c < CLIENT_COUNT; c++) {
+        if (bit_istrue(ok_batch_clients, bit(c)) && now - ok_batch[c].since_us >= report_ok_batch->get() * 1000) {
+            report_ok_send(c);
+        }
+    }
+}
+
+void grbl_send(uint8_t client, const char* text) {
+    if (ok_batch_clients) {
+        report_ok_flush(client);
+    }
+    client_write(client, text);
+}
+
+// Formatted output is built on the stack; only text longer than this goes to the heap
+const int REPORT_FORMAT_BUFFER_SIZE = 256;
+
+static void grbl_vsendf(uint8_t client, const char* prefix, const char* suffix, const char* format, va_list arg) {
+    char    loc_buf[REPORT_FORMAT_BUFFER_SIZE];
+    char*   temp       = loc_buf;
+    size_t  prefix_len = strlen(prefix);
+    size_t  suffix_len = strlen(suffix);
     va_list copy;
-    va_start(arg, format);
     va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
+    size_t len = vsnprintf(loc_buf + prefix_len, sizeof(loc_buf) - prefix_len, format, copy);
     va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
+    size_t total = prefix_len + len + suffix_len;
+    if (total >= sizeof(loc_buf)) {
+        heap_count(HeapSite::Sendf);
+        temp = new char[total + 1];
         if (temp == NULL) {
             return;
         }
+        vsnprintf(temp + prefix_len, len + 1, format, arg);
     }
-    len = vsnprintf(temp, len + 1, format, arg);
+    memcpy(temp, prefix, prefix_len);
+    memcpy(temp + prefix_len + len, suffix, suffix_len + 1);
     grbl_send(client, temp);
-    va_end(arg);
     if (temp != loc_buf) {
         delete[] temp;
     }
 }
+
+// This is a formating version of the grbl_send(CLIENT_ALL,...) function that work like printf
+void grbl_sendf(uint8_t client, const char* format, ...) {
+    if (client == CLIENT_INPUT) {
+        return;
+    }
+    va_list arg;
+    va_start(arg, format);
+    grbl_vsendf(client, "", "", format, arg);
+    va_end(arg);
+}
 // Use to send [MSG:xxxx] Type messages. The level allows messages to be easily suppressed
 void grbl_msg_sendf(uint8_t client, MsgLevel level, const char* format, ...) {
     if (client == CLIENT_INPUT) {
@@ -104,32 +192,16 @@ void grbl_msg_sendf(uint8_t client, MsgLevel level, const char* format, ...) {
         }
     }
 
-    char    loc_buf[100];
-    char*   temp = loc_buf;
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL) {
-            return;
-        }
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_sendf(client, "[MSG:%s]\r\n", temp);
+    grbl_vsendf(client, "[MSG:", "]\r\n", format, arg);
     va_end(arg);
-    if (temp != loc_buf) {
-        delete[] temp;
-    }
 }
 
-//function to notify
+//function to notify, queued so the caller does not wait for the server
 void grbl_notify(const char* title, const char* msg) {
 #ifdef ENABLE_NOTIFICATIONS
-    WebUI::notificationsservice.sendMSG(title, msg);
+    WebUI::notificationsservice.queueMSG(title, msg);
 #endif
 }
 
@@ -143,6 +215,7 @@ void grbl_notifyf(const char* title, const char* format, ...) {
     size_t len = vsnprintf(NULL, 0, format, arg);
     va_end(copy);
     if (len >= sizeof(loc_buf)) {
+        heap_count(HeapSite::Notify);
         temp = new char[len + 1];
         if (temp == NULL) {
             return;
@@ -159,47 +232,82 @@ void grbl_notifyf(const char* title, const char* format, ...) {
 static const int coordStringLen = 20;
 static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
 
-// formats axis values into a string and returns that string in rpt
-// NOTE: rpt should have at least size: axesStringLen
-static void report_util_axis_values(float* axis_value, char* rpt) {
-    uint8_t     idx;
-    char        axisVal[coordStringLen];
-    float       unit_conv = 1.0;      // unit conversion multiplier..default is mm
-    const char* format    = "%4.3f";  // Default - report mm to 3 decimal places
-    rpt[0]                = '\0';
-    if (report_inches->get()) {
-        unit_conv = 1.0 / MM_PER_INCH;
-        format    = "%4.4f";  // Report inches to 4 decimal places
-    }
-    auto n_axis = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        snprintf(axisVal, coordStringLen - 1, format, axis_value[idx] * unit_conv);
-        strcat(rpt, axisVal);
-        if (idx < (number_axis->get() - 1)) {
-            strcat(rpt, ",");
+void ReportBuffer::add(const char* text) {
+    while (*text && _pos < _end) {
+        *_pos++ = *text++;
+    }
+    *_pos = '\0';
+}
+
+void ReportBuffer::add_uint(uint32_t value) {
+    char  digits[10];
+    char* digit = digits;
+    do {
+        *digit++ = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (digit > digits) {
+        add(*--digit);
+    }
+}
+
+void ReportBuffer::add_int(int32_t value) {
+    if (value < 0) {
+        add('-');
+        add_uint(-uint32_t(value));
+    } else {
+        add_uint(value);
+    }
+}
+
+// The integer and fractional parts are printed separately, which keeps all the digits of a
+// float without going through double. The fraction is rounded exactly, ties to even, in 40-bit
+// fixed point, so the digits match printf.
+void ReportBuffer::add_fixed(float value, uint8_t decimals) {
+    static const uint32_t scale[] = { 1, 10, 100, 1000, 10000 };
+    float                 magnitude = fabsf(value);
+    if (decimals >= sizeof(scale) / sizeof(scale[0]) || !(magnitude < 4e9f)) {  // Also catches NaN
+        char text[48];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        add(text);
+        return;
+    }
+    float    whole     = floorf(magnitude);
+    uint32_t integer   = uint32_t(whole);
+    uint64_t scaled    = uint64_t((magnitude - whole) * 1099511627776.0f) * scale[decimals];  // 2^40
+    uint32_t fraction  = scaled >> 40;
+    uint64_t remainder = scaled & ((1ULL << 40) - 1);
+    uint32_t last      = decimals ? fraction : integer;  // The digit a tie rounds to even
+    if (remainder > (1ULL << 39) || (remainder == (1ULL << 39) && (last & 1))) {
+        fraction++;
+    }
+    if (fraction >= scale[decimals]) {  // Rounded up into the next integer
+        fraction -= scale[decimals];
+        integer++;
+    }
+    if (value < 0) {
+        add('-');  // As printf, even when the digits round to zero
+    }
+    add_uint(integer);
+    if (decimals) {
+        add('.');
+        for (int8_t d = decimals - 1; d >= 0; d--) {
+            add(char('0' + fraction / scale[d] % 10));
         }
     }
 }
 
-// This version returns the axis values as a String
-static String report_util_axis_values(const float* axis_value) {
-    String  rpt = "";
-    uint8_t idx;
-    char    axisVal[coordStringLen];
-    float   unit_conv = 1.0;  // unit conversion multiplier..default is mm
-    int     decimals  = 3;    // Default - report mm to 3 decimal places
-    if (report_inches->get()) {
-        unit_conv = 1.0 / MM_PER_INCH;
-        decimals  = 4;  // Report inches to 4 decimal places
-    }
-    auto n_axis = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        rpt += String(axis_value[idx] * unit_conv, decimals);
-        if (idx < (number_axis->get() - 1)) {
-            rpt += ",";
+// Millimeters to 3 decimal places, or inches to 4
+void ReportBuffer::add_axes(const float* values) {
+    bool  inches    = report_inches->get();
+    float unit_conv = inches ? 1.0 / MM_PER_INCH : 1.0;
+    auto  n_axis    = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (idx > 0) {
+            add(',');
         }
+        add_fixed(values[idx] * unit_conv, inches ? 4 : 3);
     }
-    return rpt;
 }
 
 // Handles the primary confirmation protocol response for streaming interfaces and human-feedback.
@@ -215,10 +323,10 @@ void report_status_message(Error status_code, uint8_t client) {
             if (get_sd_state(false) == SDState::BusyPrinting) {
                 SD_ready_next = true;  // flag so system_execute_line() will send the next line
             } else {
-                grbl_send(client, "ok\r\n");
+                report_ok(client);
             }
 #else
-            grbl_send(client, "ok\r\n");
+            report_ok(client);
 #endif
             break;
         default:
@@ -309,51 +417,54 @@ void report_grbl_help(uint8_t client) {
 // These values are retained until Grbl is power-cycled, whereby they will be re-zeroed.
 void report_probe_parameters(uint8_t client) {
     // Report in terms of machine position.
-    char probe_rpt[(axesStringLen + 13 + 6 + 1)];  // the probe report we are building here
-    char temp[axesStringLen];
-    strcpy(probe_rpt, "[PRB:");  // initialize the string with the first characters
+    char         probe_rpt[(axesStringLen + 13 + 6 + 1)];  // the probe report we are building here
+    ReportBuffer rpt(probe_rpt, sizeof(probe_rpt));
+    rpt.add("[PRB:");
     // get the machine position and put them into a string and append to the probe report
     float print_position[MAX_N_AXIS];
     system_convert_array_steps_to_mpos(print_position, sys_probe_position);
-    report_util_axis_values(print_position, temp);
-    strcat(probe_rpt, temp);
+    rpt.add_axes(print_position);
     // add the success indicator and add closing characters
-    sprintf(temp, ":%d]\r\n", sys.probe_succeeded);
-    strcat(probe_rpt, temp);
+    rpt.add(':');
+    rpt.add_uint(sys.probe_succeeded);
+    rpt.add("]\r\n");
     grbl_send(client, probe_rpt);  // send the report
 }
 
 // Prints Grbl NGC parameters (coordinate offsets, probing)
 void report_ngc_parameters(uint8_t client) {
-    String ngc_rpt = "";
+    char         ngc_rpt[axesStringLen + 16];
+    ReportBuffer rpt(ngc_rpt, sizeof(ngc_rpt));
 
     // Print persistent offsets G54 - G59, G28, and G30
     for (auto coord_select = CoordIndex::Begin; coord_select < CoordIndex::End; ++coord_select) {
-        ngc_rpt += "[";
-        ngc_rpt += coords[coord_select]->getName();
-        ngc_rpt += ":";
-        ngc_rpt += report_util_axis_values(coords[coord_select]->get());
-        ngc_rpt += "]\r\n";
-    }
-    ngc_rpt += "[G92:";  // Print non-persistent G92,G92.1
-    ngc_rpt += report_util_axis_values(gc_state.coord_offset);
-    ngc_rpt += "]\r\n";
-    ngc_rpt += "[TLO:";  // Print tool length offset
+        rpt = ReportBuffer(ngc_rpt, sizeof(ngc_rpt));
+        rpt.add('[');
+        rpt.add(coords[coord_select]->getName());
+        rpt.add(':');
+        rpt.add_axes(coords[coord_select]->get());
+        rpt.add("]\r\n");
+        grbl_send(client, ngc_rpt);
+    }
+    rpt = ReportBuffer(ngc_rpt, sizeof(ngc_rpt));
+    rpt.add("[G92:");  // Print non-persistent G92,G92.1
+    rpt.add_axes(gc_state.coord_offset);
+    rpt.add("]\r\n");
+    rpt.add("[TLO:");  // Print tool length offset
     float tlo = gc_state.tool_length_offset;
     if (report_inches->get()) {
         tlo *= INCH_PER_MM;
     }
-    ngc_rpt += String(tlo, 3);
-    ;
-    ngc_rpt += "]\r\n";
-    grbl_send(client, ngc_rpt.c_str());
+    rpt.add_fixed(tlo, 3);
+    rpt.add("]\r\n");
+    grbl_send(client, ngc_rpt);
     report_probe_parameters(client);
 }
 
 // Print current gcode parser mode state
 void report_gcode_modes(uint8_t client) {
     char        temp[20];
-    char        modes_rpt[75];
+    char        modes_rpt[90];
     const char* mode = "";
     strcpy(modes_rpt, "[GC:");
 
@@ -385,6 +496,15 @@ void report_gcode_modes(uint8_t client) {
         case Motion::ProbeAwayNoError:
             mode = "G38.4";
             break;
+        case Motion::DrillCycle:
+            mode = "G81";
+            break;
+        case Motion::DrillDwellCycle:
+            mode = "G82";
+            break;
+        case Motion::PeckDrillCycle:
+            mode = "G83";
+            break;
     }
     strcat(modes_rpt, mode);
 
@@ -442,6 +562,16 @@ void report_gcode_modes(uint8_t client) {
     }
     strcat(modes_rpt, mode);
 
+    switch (gc_state.modal.cycle_return) {
+        case CycleReturn::OldZ:
+            mode = " G98";
+            break;
+        case CycleReturn::RLevel:
+            mode = " G99";
+            break;
+    }
+    strcat(modes_rpt, mode);
+
     //report_util_gcode_modes_M();
     switch (gc_state.modal.program_flow) {
         case ProgramFlow::Running:
@@ -567,6 +697,7 @@ void report_build_info(const char* line, uint8_t client) {
     // These will likely have a comma delimiter to separate them.
     grbl_send(client, "]\r\n");
     report_machine_type(client);
+    st_report_limits(client);
 #if defined(ENABLE_WIFI)
     grbl_send(client, (char*)WebUI::wifi_config.info());
 #endif
@@ -591,40 +722,55 @@ void report_echo_line_received(char* line, uint8_t client) {
 // specific needs, but the desired real-time data report must be as short as possible. This is
 // requires as it minimizes the computational overhead and allows grbl to keep running smoothly,
 // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status(uint8_t client) {
-    char status[244];
-    char temp[MAX_N_AXIS * 20];
-
-    // Check if we need to report jog step counts after a delay
-    if (jog_step_report_pending && (esp_timer_get_time() > jog_complete_time)) {
-        report_realtime_steps();
-        jog_step_report_pending = false;
+const int STATUS_REPORT_SIZE      = 244;
+const int STATUS_DELTA_FULL_EVERY = 20;  // A full report among this many pushed delta reports
+
+// Formatted axis values from the last status report, so an axis field that has not changed
+// since is copied instead of printed again. The caches are shared by every client; a report
+// that finds them in use by another task prints without them.
+typedef struct {
+    float values[MAX_N_AXIS];
+    bool  inches;
+    bool  valid;
+    char  text[axesStringLen];
+} axes_cache_t;
+
+static axes_cache_t     status_position_cache;
+static axes_cache_t     status_wco_cache;
+static std::atomic_flag status_cache_busy = ATOMIC_FLAG_INIT;
+
+static void report_add_axes_cached(ReportBuffer& rpt, const float* values, axes_cache_t* cache) {
+    if (cache == NULL) {
+        rpt.add_axes(values);
+        return;
     }
-
-    // Detect state transition from Jog to Idle or Alarm (jog complete or limit hit)
-    static State last_state = State::Idle;
-    if (last_state == State::Jog && 
-        (sys.state == State::Idle || sys.state == State::Alarm) && 
-        step_counting_enabled) {
-        // Schedule a step count report with 0.5 second delay
-        jog_step_report_pending = true;
-        jog_complete_time = esp_timer_get_time() + 500000; // 0.5 second in microseconds
+    size_t size   = number_axis->get() * sizeof(float);
+    bool   inches = report_inches->get();
+    if (!cache->valid || cache->inches != inches || memcmp(cache->values, values, size) != 0) {
+        ReportBuffer text(cache->text, sizeof(cache->text));
+        text.add_axes(values);
+        memcpy(cache->values, values, size);
+        cache->inches = inches;
+        cache->valid  = true;
     }
-    last_state = sys.state;
+    rpt.add(cache->text);
+}
 
-    strcpy(status, "<");
-    strcat(status, report_state_text());
+static void report_status_format(uint8_t client, ReportBuffer& status, bool use_cache) {
+    bool cached = use_cache && !status_cache_busy.test_and_set(std::memory_order_acquire);
+
+    status.add('<');
+    status.add(report_state_text());
 
     // Report position
     float* print_position = system_get_mpos();
     if (bit_istrue(status_mask->get(), RtStatus::Position)) {
-        strcat(status, "|MPos:");
+        status.add("|MPos:");
     } else {
-        strcat(status, "|WPos:");
+        status.add("|WPos:");
         mpos_to_wpos(print_position);
     }
-    report_util_axis_values(print_position, temp);
-    strcat(status, temp);
+    report_add_axes_cached(status, print_position, cached ? &status_position_cache : NULL);
     // Returns planner and serial read buffer states.
 #ifdef REPORT_FIELD_BUFFER_STATE
     if (bit_istrue(status_mask->get(), RtStatus::Buffer)) {
@@ -636,15 +782,25 @@ void report_realtime_status(uint8_t client) {
 #    endif  //ENABLE_WIFI && ENABLE_TELNET
 #    if defined(ENABLE_BLUETOOTH)
         if (client == CLIENT_BT) {
-            //TODO FIXME
-            bufsize = 512 - WebUI::SerialBT.available();
+            bufsize = client_get_rx_buffer_available(CLIENT_BT);
         }
 #    endif  //ENABLE_BLUETOOTH
         if (client == CLIENT_SERIAL) {
             bufsize = client_get_rx_buffer_available(CLIENT_SERIAL);
         }
-        sprintf(temp, "|Bf:%d,%d", plan_get_block_buffer_available(), bufsize);
-        strcat(status, temp);
+        status.add("|Bf:");
+        status.add_uint(plan_get_block_buffer_available());
+        status.add(',');
+        status.add_int(bufsize);
+#    ifdef REPORT_FIELD_SEGMENT_BUFFER
+        uint8_t  segments;
+        uint32_t buffered_us;
+        st_get_buffer_state(&segments, &buffered_us);
+        status.add("|Sb:");
+        status.add_uint(segments);
+        status.add(',');
+        status.add_uint(buffered_us / 1000);
+#    endif
     }
 #endif
 #ifdef USE_LINE_NUMBERS
@@ -652,77 +808,66 @@ void report_realtime_status(uint8_t client) {
     // Report current line number
     plan_block_t* cur_block = plan_get_current_block();
     if (cur_block != NULL) {
-        uint32_t ln = cur_block->line_number;
+        uint32_t ln = plan_get_line_number(cur_block);
         if (ln > 0) {
-            sprintf(temp, "|Ln:%d", ln);
-            strcat(status, temp);
+            status.add("|Ln:");
+            status.add_uint(ln);
         }
     }
 #    endif
 #endif
     // Report realtime feed speed
 #ifdef REPORT_FIELD_CURRENT_FEED_SPEED
+    status.add("|FS:");
     if (report_inches->get()) {
-        sprintf(temp, "|FS:%.1f,%d", st_get_realtime_rate() / MM_PER_INCH, sys.spindle_speed);
+        status.add_fixed(st_get_realtime_rate() / MM_PER_INCH, 1);
     } else {
-        sprintf(temp, "|FS:%.0f,%d", st_get_realtime_rate(), sys.spindle_speed);
+        status.add_fixed(st_get_realtime_rate(), 0);
     }
-    strcat(status, temp);
+    status.add(',');
+    status.add_uint(sys.spindle_speed);
 #endif
 #ifdef REPORT_FIELD_PIN_STATE
     AxisMask    lim_pin_state  = limits_get_state();
     ControlPins ctrl_pin_state = system_control_get_state();
     bool        prb_pin_state  = probe_get_state();
     if (lim_pin_state || ctrl_pin_state.value || prb_pin_state) {
-        strcat(status, "|Pn:");
+        status.add("|Pn:");
         if (prb_pin_state) {
-            strcat(status, "P");
+            status.add('P');
         }
         if (lim_pin_state) {
             auto n_axis = number_axis->get();
-            if (n_axis >= 1 && bit_istrue(lim_pin_state, bit(X_AXIS))) {
-                strcat(status, "X");
-            }
-            if (n_axis >= 2 && bit_istrue(lim_pin_state, bit(Y_AXIS))) {
-                strcat(status, "Y");
-            }
-            if (n_axis >= 3 && bit_istrue(lim_pin_state, bit(Z_AXIS))) {
-                strcat(status, "Z");
-            }
-            if (n_axis >= 4 && bit_istrue(lim_pin_state, bit(A_AXIS))) {
-                strcat(status, "A");
-            }
-            if (n_axis >= 5 && bit_istrue(lim_pin_state, bit(B_AXIS))) {
-                strcat(status, "B");
-            }
-            if (n_axis >= 6 && bit_istrue(lim_pin_state, bit(C_AXIS))) {
-                strcat(status, "C");
+            for (uint8_t axis = 0; axis < n_axis; axis++) {
+                if (bit_istrue(lim_pin_state, bit(axis))) {
+                    status.add(report_get_axis_letter(axis));
+                }
             }
         }
         if (ctrl_pin_state.value) {
             if (ctrl_pin_state.bit.safetyDoor) {
-                strcat(status, "D");
+                status.add('D');
             }
             if (ctrl_pin_state.bit.reset) {
-                strcat(status, "R");
+                status.add('R');
             }
             if (ctrl_pin_state.bit.feedHold) {
-                strcat(status, "H");
+                status.add('H');
             }
             if (ctrl_pin_state.bit.cycleStart) {
-                strcat(status, "S");
+                status.add('S');
             }
             if (ctrl_pin_state.bit.macro0) {
-                strcat(status, "0");
+                status.add('0');
             }
             if (ctrl_pin_state.bit.macro1) {
-                strcat(status, "1");
+                status.add('1');
             }
             if (ctrl_pin_state.bit.macro2) {
-                strcat(status, "2");
+                status.add('2');
             }
             if (ctrl_pin_state.bit.macro3) {
-                strcat(status, "3");
+                status.add('3');
             }
         }
     }
@@ -745,9 +890,8 @@ void report_realtime_status(uint8_t client) {
         if (sys.report_ovr_counter == 0) {
             sys.report_ovr_counter = 1;  // Set override on next report.
         }
-        strcat(status, "|WCO:");
-        report_util_axis_values(get_wco(), temp);
-        strcat(status, temp);
+        status.add("|WCO:");
+        report_add_axes_cached(status, get_wco(), cached ? &status_wco_cache : NULL);
     }
 #endif
 #ifdef REPORT_FIELD_OVERRIDES
@@ -766,30 +910,34 @@ void report_realtime_status(uint8_t client) {
                 break;
         }
 
-        sprintf(temp, "|Ov:%d,%d,%d", sys.f_override, sys.r_override, sys.spindle_speed_ovr);
-        strcat(status, temp);
+        status.add("|Ov:");
+        status.add_uint(sys.f_override);
+        status.add(',');
+        status.add_uint(sys.r_override);
+        status.add(',');
+        status.add_uint(sys.spindle_speed_ovr);
         SpindleState sp_state      = spindle->get_state();
         CoolantState coolant_state = coolant_get_state();
         if (sp_state != SpindleState::Disable || coolant_state.Mist || coolant_state.Flood) {
-            strcat(status, "|A:");
+            status.add("|A:");
             switch (sp_state) {
                 case SpindleState::Disable:
                     break;
                 case SpindleState::Cw:
-                    strcat(status, "S");
+                    status.add('S');
                     break;
                 case SpindleState::Ccw:
-                    strcat(status, "C");
+                    status.add('C');
                     break;
             }
 
             auto coolant = coolant_state;
             if (coolant.Flood) {
-                strcat(status, "F");
+                status.add('F');
             }
 #    ifdef COOLANT_MIST_PIN  // TODO Deal with M8 - Flood
             if (coolant.Mist) {
-                strcat(status, "M");
+                status.add('M');
             }
 #    endif
         }
@@ -797,43 +945,211 @@ void report_realtime_status(uint8_t client) {
 #endif
 #ifdef ENABLE_SD_CARD
     if (get_sd_state(false) == SDState::BusyPrinting) {
-        sprintf(temp, "|SD:%4.2f,", sd_report_perc_complete());
-        strcat(status, temp);
-        sd_get_current_filename(temp);
-        strcat(status, temp);
+        char filename[MAX_N_AXIS * 20];
+        status.add("|SD:");
+        status.add_fixed(sd_report_perc_complete(), 2);
+        status.add(',');
+        sd_get_current_filename(filename);
+        status.add(filename);
+        int32_t remaining = sd_report_remaining_seconds();
+        if (remaining >= 0) {
+            status.add("|ETA:");  // Seconds left by the estimate of the file check
+            status.add_int(remaining);
+        }
     }
 #endif
+#ifdef REPORT_FIELD_PERF
+    // Starvation counters, see $Stats. Min blocks is -1 until the planner has filled.
+    stepper_perf_stats_t perf;
+    st_perf_stats_get(&perf);
+    status.add("|Perf:");
+    status.add_uint(perf.planner_empty);
+    status.add(',');
+    status.add_uint(perf.segment_empty);
+    status.add(',');
+    status.add_int(perf.min_blocks == UINT8_MAX ? -1 : perf.min_blocks);
+    status.add(',');
+    status.add_uint(perf.motion_time > 0.0f ? uint32_t(100.0f * perf.slow_time / perf.motion_time + 0.5f) : 0);
+#endif
 #ifdef REPORT_HEAP
-    sprintf(temp, "|Heap:%d", esp.getHeapSize());
-    strcat(status, temp);
+    status.add("|Heap:");
+    status.add_uint(esp.getHeapSize());
 #endif
     // mks fix
     /**/
     // sprintf(temp, "|PS:%d|PF:%d",  get_print_power() ,get_print_speed());
     // strcat(status, temp);
 
-    strcat(status, ">\r\n");
+    status.add(">\r\n");
+    if (cached) {
+        status_cache_busy.clear(std::memory_order_release);
+    }
+}
+
+void report_realtime_status(uint8_t client) {
+    char status[STATUS_REPORT_SIZE];
+
+    ReportBuffer rpt(status, sizeof(status));
+    report_status_format(client, rpt, true);
     grbl_send(client, status);
 }
 
+// Pushed status reports. Each subscribed client keeps the last report it was sent, which
+// delta reports are built against.
+typedef struct {
+    char    last[STATUS_REPORT_SIZE];
+    uint8_t since_full;  // Delta reports since the last full one
+} status_subscriber_t;
+
+static std::atomic<uint8_t> status_subscribers(0);  // One bit per client
+static status_subscriber_t  status_subscriber[CLIENT_COUNT];
+static uint32_t             status_stream_time;
+
+void report_status_subscribe(uint8_t client, bool subscribe) {
+    if (client >= CLIENT_COUNT) {
+        return;
+    }
+    if (subscribe) {
+        status_subscriber[client].last[0] = '\0';  // Next report is a full one
+        status_subscribers |= bit(client);
+    } else {
+        status_subscribers &= ~bit(client);
+    }
+}
+
+// Finds a field by its name, the text up to ':', in the body of a report between '<' and '>'.
+// Returns its length, including the name, and its start in *field.
+static size_t report_status_field(const char* report, const char* name, size_t name_len, const char** field) {
+    for (const char* p = strchr(report, '|'); p; p = strchr(p, '|')) {
+        p++;
+        if (strncmp(p, name, name_len) == 0 && strcspn(p, ":|>") == name_len) {
+            *field = p;
+            return strcspn(p, "|>");
+        }
+    }
+    return 0;
+}
+
+// Writes into delta the fields of report that differ from last. The state always leads, and a
+// field that is gone is sent empty, e.g. "|Pn:", as its absence means it is unchanged. Returns
+// false when nothing changed.
+static bool report_status_delta(const char* report, const char* last, ReportBuffer& delta) {
+    size_t state_len = strcspn(report, "|>");
+    bool   changed   = state_len != strcspn(last, "|>") || strncmp(report, last, state_len) != 0;
+    delta.add('<');
+    for (size_t i = 1; i < state_len; i++) {
+        delta.add(report[i]);
+    }
+    for (const char* p = strchr(report, '|'); p; p = strchr(p, '|')) {
+        p++;
+        size_t      len      = strcspn(p, "|>");
+        size_t      name_len = strcspn(p, ":|>");
+        const char* old;
+        if (report_status_field(last, p, name_len, &old) != len || strncmp(old, p, len) != 0) {
+            delta.add('|');
+            for (size_t i = 0; i < len; i++) {
+                delta.add(p[i]);
+            }
+            changed = true;
+        }
+    }
+    for (const char* p = strchr(last, '|'); p; p = strchr(p, '|')) {
+        p++;
+        size_t      name_len = strcspn(p, ":|>");
+        const char* field;
+        if (report_status_field(report, p, name_len, &field) == 0) {
+            delta.add('|');
+            for (size_t i = 0; i <= name_len && p[i] != '|' && p[i] != '>'; i++) {
+                delta.add(p[i]);  // The name and its ':'
+            }
+            changed = true;
+        }
+    }
+    delta.add(">\r\n");
+    return changed;
+}
+
+void report_status_stream() {
+    uint32_t interval    = report_interval->get();
+    uint8_t  subscribers = status_subscribers;
+    if (interval == 0 || subscribers == 0 || (millis() - status_stream_time) < interval) {
+        return;
+    }
+    status_stream_time = millis();
+
+    // The report counters for WCO and overrides advance once per interval, not per client
+    Counter wco_counter = sys.report_wco_counter;
+    Counter ovr_counter = sys.report_ovr_counter;
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        if (bit_isfalse(subscribers, bit(client))) {
+            continue;
+        }
+        sys.report_wco_counter = wco_counter;
+        sys.report_ovr_counter = ovr_counter;
+
+        status_subscriber_t* subscriber = &status_subscriber[client];
+        char                 status[STATUS_REPORT_SIZE];
+        ReportBuffer         rpt(status, sizeof(status));
+        report_status_format(client, rpt, true);
+        if (!report_delta->get() || subscriber->last[0] == '\0' || ++subscriber->since_full >= STATUS_DELTA_FULL_EVERY) {
+            subscriber->since_full = 0;
+            grbl_send(client, status);
+        } else {
+            char         delta[STATUS_REPORT_SIZE * 2];
+            ReportBuffer drpt(delta, sizeof(delta));
+            if (report_status_delta(status, subscriber->last, drpt)) {
+                grbl_send(client, delta);
+            }
+        }
+        memcpy(subscriber->last, status, sizeof(status));
+    }
+}
+
+uint64_t report_status_bench(uint16_t n_report, bool cached) {
+    char    status[STATUS_REPORT_SIZE];
+    Counter save_wco_counter = sys.report_wco_counter;
+    Counter save_ovr_counter = sys.report_ovr_counter;
+
+    uint64_t total_cycles = 0;
+    for (uint16_t i = 0; i < n_report; i++) {
+        if (!cached) {
+            status_position_cache.valid = false;
+            status_wco_cache.valid      = false;
+        }
+        uint32_t     start_cycles = xthal_get_ccount();
+        ReportBuffer rpt(status, sizeof(status));
+        report_status_format(CLIENT_SERIAL, rpt, true);
+        total_cycles += xthal_get_ccount() - start_cycles;
+    }
+
+    sys.report_wco_counter = save_wco_counter;
+    sys.report_ovr_counter = save_ovr_counter;
+    return total_cycles;
+}
+
 // Import the step counting variable
 extern bool step_counting_enabled;
 
+void report_jog_steps() {
+    int32_t counts[MAX_N_AXIS];
+    char    msg[20 + 14 * MAX_N_AXIS];
+    auto    n_axis = number_axis->get();
+    int     len    = snprintf(msg, sizeof(msg), "[JOG STEPS:");
+    jog_steps_get(counts);
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        len += snprintf(msg + len, sizeof(msg) - len, "%s%c:%d", idx ? "," : "", report_get_axis_letter(idx), counts[idx]);
+    }
+    snprintf(msg + len, sizeof(msg) - len, "]\r\n");
+    grbl_send(CLIENT_ALL, msg);
+}
+
 void report_realtime_steps() {
     uint8_t idx;
     auto    n_axis = number_axis->get();
     
     if (step_counting_enabled && sys.state == State::Jog) {
         // When step counting is enabled during jogging, report jog step counts
-        grbl_sendf(CLIENT_ALL, "[JOG STEPS:");
-        for (idx = 0; idx < n_axis; idx++) {
-            char axis_letter = report_get_axis_letter(idx);
-            grbl_sendf(CLIENT_ALL, "%c:%ld", axis_letter, sys.jog_step_counts[idx]);
-            if (idx < n_axis - 1) {
-                grbl_sendf(CLIENT_ALL, ",");
-            }
-        }
-        grbl_sendf(CLIENT_ALL, "]\r\n");
+        report_jog_steps();
     } else {
         // Original behavior for debug purposes
         for (idx = 0; idx < n_axis; idx++) {
@@ -846,7 +1162,7 @@ void report_gcode_comment(char* comment) {
     char          msg[80];
     const uint8_t offset = 4;  // ignore "MSG_" part of comment
     uint8_t       index  = offset;
-    if (strstr(comment, "MSG")) {
+    if (strstr(comment, "MSG") && !gc_sandbox) {
         while (index < strlen(comment)) {
             msg[index - offset] = comment[index];
             index++;
@@ -860,6 +1176,27 @@ void report_machine_type(uint8_t client) {
     grbl_msg_sendf(client, MsgLevel::Info, "Using machine:%s", MACHINE_NAME);
 }
 
+void report_job_stats(uint8_t client) {
+    stepper_job_stats_t stats;
+    st_job_stats_get(&stats);
+    if (stats.motion_time <= 0.0f) {
+        return;
+    }
+    grbl_msg_sendf(client,
+                   MsgLevel::Info,
+                   "Job: %.1f mm in %.1f s, feed %.0f of %.0f mm/min programmed",
+                   stats.distance,
+                   stats.motion_time * 60.0f,
+                   stats.distance / stats.motion_time,
+                   stats.programmed_time > 0.0f ? stats.distance / stats.programmed_time : 0.0f);
+    grbl_msg_sendf(client,
+                   MsgLevel::Info,
+                   "Job: accel %.1f s, decel %.1f s, cruise %.1f s",
+                   stats.accel_time * 60.0f,
+                   stats.decel_time * 60.0f,
+                   stats.cruise_time * 60.0f);
+}
+
 /*
     Print a message in hex format
     Ex: report_hex_msg(msg, "Rx:", 6);
@@ -991,15 +1328,7 @@ void mpos_to_wpos(float* position) {
     }
 }
 
+// Work coordinate offsets and tool length offset, as kept by gc_update_wco()
 float* get_wco() {
-    static float wco[MAX_N_AXIS];
-    auto         n_axis = number_axis->get();
-    for (int idx = 0; idx < n_axis; idx++) {
-        // Apply work coordinate offsets and tool length offset to current position.
-        wco[idx] = gc_state.coord_system[idx] + gc_state.coord_offset[idx];
-        if (idx == TOOL_LENGTH_OFFSET_AXIS) {
-            wco[idx] += gc_state.tool_length_offset;
-        }
-    }
-    return wco;
+    return gc_state.wco;
 }
@@ -28,6 +28,33 @@ enum RtStatus {
 
 const char* errorString(Error errorNumber);
 
+// Builds report text in a fixed buffer. Each append goes at the cursor instead of rescanning
+// the text, and what does not fit is dropped, always leaving the text terminated.
+class ReportBuffer {
+public:
+    ReportBuffer(char* buffer, size_t size) : _start(buffer), _pos(buffer), _end(buffer + size - 1) { *_pos = '\0'; }
+
+    void add(char c) {
+        if (_pos < _end) {
+            *_pos++ = c;
+            *_pos   = '\0';
+        }
+    }
+    void add(const char* text);
+    void add_uint(uint32_t value);
+    void add_int(int32_t value);
+    void add_fixed(float value, uint8_t decimals);  // Like printf %.<decimals>f, up to 4 decimals
+    void add_axes(const float* values);             // Comma separated, in the report units
+
+    const char* text() const { return _start; }
+    size_t      length() const { return _pos - _start; }
+
+private:
+    char* _start;
+    char* _pos;
+    char* _end;
+};
+
 // Define Grbl feedback message codes. Valid values (0-255).
 enum class Message : uint8_t {
     CriticalEvent   = 1,
@@ -75,7 +102,13 @@ void grbl_notifyf(const char* title, const char* format, ...);
 
 // Prints system status messages.
 void report_status_message(Error status_code, uint8_t client);
+// Sends the acks held by $Report/OkBatch for a client, or for all with CLIENT_ALL
+void report_ok_flush(uint8_t client);
+// Sends the acks held longer than $Report/OkBatch
+void report_ok_poll();
 void report_realtime_steps();
+// Prints the jog step counts, see jog_steps_get()
+void report_jog_steps();
 
 // Prints system alarm messages.
 void report_alarm_message(ExecAlarm alarm_code);
@@ -98,6 +131,16 @@ void report_echo_line_received(char* line, uint8_t client);
 // Prints realtime status report
 void report_realtime_status(uint8_t client);
 
+// Pushes status reports to a client every $Report/Interval, or stops doing so
+void report_status_subscribe(uint8_t client, bool subscribe);
+
+// Sends the pushed status reports that are due. Called by the client check task.
+void report_status_stream();
+
+// Times n_report status reports built without sending them, with the position cache used as
+// usual or emptied before each one. Returns the total in CPU cycles.
+uint64_t report_status_bench(uint16_t n_report, bool cached);
+
 // Prints recorded probe position
 void report_probe_parameters(uint8_t client);
 
@@ -122,6 +165,9 @@ void report_realtime_debug();
 
 void report_machine_type(uint8_t client);
 
+// Reports the feed accuracy of the SD job that just finished, see st_job_stats_get()
+void report_job_stats(uint8_t client);
+
 // Reports the current machine mode (normal, pendrive, i2c_slave)
 void report_machine_mode();
 
@@ -20,6 +20,9 @@
 
 #include "Config.h"
 #include "mks/MKS_LVGL.h"
+#include "mks/MKS_draw_powerless.h"
+#include <atomic>
+#include <rom/miniz.h>
 #ifdef ENABLE_SD_CARD
 #    include "SDCard.h"
 
@@ -28,8 +31,7 @@ bool                       SD_ready_next = false;  // Grbl has processed a line
 uint8_t                    SD_client     = CLIENT_SERIAL;
 // uint8_t                    SD_client     = CLIENT_SD;
 WebUI::AuthenticationLevel SD_auth_level = WebUI::AuthenticationLevel::LEVEL_GUEST;
-uint32_t                   sd_current_line_number;     // stores the most recent line number read from the SD
-static char                comment[LINE_BUFFER_SIZE];  // Line to be executed. Zero-terminated.
+uint32_t                   sd_current_line_number;  // stores the most recent line number read from the SD
 
 #define USE_HSPI_FOR_SD 1
 #ifdef USE_HSPI_FOR_SD
@@ -49,13 +51,14 @@ SPIClass SPI_H(HSPI);
   return true;
 }*/
 
-bool filename_check(char *str, uint16_t num) {
+bool filename_check(const char *str, uint16_t num) {
 
-    char *p, *j, *k;
+    const char *p, *j, *k;
     
     if(num > 128) return false;
     // if(((str[num-1]=='c')||(str[num-1]='C')) && ((str[num-2] == 'n')||(str[num-2] == 'N'))) return true;  // .nc
 
+    // name.nc.gz passes on its inner extension; the job reader inflates it
     p = strstr(str, ".nc");
     if(p == NULL) p = strstr(str, ".NC");
     else return true;
@@ -72,7 +75,6 @@ bool filename_check(char *str, uint16_t num) {
     else return false;
 }
 
-char filename_check_str[255];
 void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client) {
     //char temp_filename[128]; // to help filter by extension	TODO: 128 needs a definition based on something
     File root = fs.open(dirname);
@@ -91,9 +93,7 @@ void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client) {
                 listDir(fs, file.name(), levels - 1, client);
             }
         } else {
-            memset(filename_check_str, 0, sizeof(filename_check_str));
-            strcpy(filename_check_str, file.name());
-            if(filename_check(filename_check_str, strlen(filename_check_str)) == true) {
+            if(filename_check(file.name(), strlen(file.name())) == true) {
                 grbl_sendf(CLIENT_ALL, "[FILE:%s|SIZE:%d]\r\n", file.name(), file.size());
                 // grbl_send(CLIENT_ALL, "check\n");
             }
@@ -102,59 +102,868 @@ void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client) {
     }
 }
 
-char mks_filename_check_str[255];
-void mks_listDir(fs::FS& fs, const char* dirname, uint8_t levels) { 
+/*
+  Job file index for the carving page. The first sd_index_build() after the card is inserted
+  or changed scans the directory once, keeps the job files with their sizes in one heap block
+  of names, and sorts them by name, so paging through the list reads only memory.
+  sd_index_invalidate() may be called from any task; it bumps the generation and the next
+  build runs again. The index itself is only touched by the task that builds and reads it.
+*/
+const int SD_INDEX_MAX_FILES = 512;
 
-    File root = fs.open(dirname);    //建立文件根目录并打开文件系统
+typedef struct {
+    uint32_t size;
+    uint32_t name;  // Offset into sd_index_names
+} sd_index_entry_t;
 
-    // root 为空时判断为文件系统打开失败
-    if(!root) {
-        //...提示文件系统打开失败
-        return;
+static sd_index_entry_t*     sd_index_entries;
+static uint16_t              sd_index_n;
+static uint16_t              sd_index_cap;
+static char*                 sd_index_names;
+static uint32_t              sd_index_names_len;
+static uint32_t              sd_index_names_cap;
+static std::atomic<uint32_t> sd_index_gen(1);
+static uint32_t              sd_index_built;          // Generation the index was built for, 0 for none
+static uint64_t              sd_index_card_size;
+
+void sd_index_invalidate() {
+    sd_index_gen++;
+}
+
+uint32_t sd_index_generation() {
+    return sd_index_gen;
+}
+
+bool sd_index_valid() {
+    return sd_index_built == sd_index_gen;
+}
+
+uint16_t sd_index_count() {
+    return sd_index_valid() ? sd_index_n : 0;
+}
+
+const char* sd_index_get(uint16_t i, uint32_t* size) {
+    if (i >= sd_index_count()) {
+        return NULL;
     }
+    *size = sd_index_entries[i].size;
+    return sd_index_names + sd_index_entries[i].name;
+}
 
-    if (!root.isDirectory()) {
-        // ...找不到文件夹（根文件夹）
-        return;
+// The compiled job, the job summary, the preview and the check result are written next to the
+// job, as path.bin, path.idx, path.pvw and path.chk, and an upload as path.upl and path.prt
+static bool sd_index_is_sidecar(const char* name, size_t len) {
+    return len > 4 && (strcasecmp(name + len - 4, ".bin") == 0 || strcasecmp(name + len - 4, ".idx") == 0 ||
+                       strcasecmp(name + len - 4, ".pvw") == 0 || strcasecmp(name + len - 4, ".chk") == 0 ||
+                       strcasecmp(name + len - 4, ".upl") == 0 || strcasecmp(name + len - 4, ".prt") == 0);
+}
+
+static bool sd_index_add(const char* name, uint32_t size) {
+    size_t len = strlen(name) + 1;
+    if (sd_index_n == sd_index_cap) {
+        uint16_t cap     = sd_index_cap ? sd_index_cap * 2 : 32;
+        void*    entries = realloc(sd_index_entries, cap * sizeof(sd_index_entry_t));
+        if (entries == NULL) {
+            return false;
+        }
+        sd_index_entries = (sd_index_entry_t*)entries;
+        sd_index_cap     = cap;
     }
-    File file = root.openNextFile(); 
-    
-    while(file) {
+    if (sd_index_names_len + len > sd_index_names_cap) {
+        uint32_t cap   = MAX(sd_index_names_cap * 2, 1024U);
+        void*    names = realloc(sd_index_names, cap);
+        if (names == NULL) {
+            return false;
+        }
+        sd_index_names     = (char*)names;
+        sd_index_names_cap = cap;
+    }
+    memcpy(sd_index_names + sd_index_names_len, name, len);
+    sd_index_entries[sd_index_n].name = sd_index_names_len;
+    sd_index_entries[sd_index_n].size = size;
+    sd_index_names_len += len;
+    sd_index_n++;
+    return true;
+}
 
+static bool sd_index_scan(fs::FS& fs, const char* dirname, uint8_t levels) {
+    File root = fs.open(dirname);
+    if (!root || !root.isDirectory()) {
+        return true;
+    }
+    File file = root.openNextFile();
+    while (file) {
         if (file.isDirectory()) {
-            if (levels) {
-                mks_listDir(fs, file.name(), levels - 1);
+            if (levels && !sd_index_scan(fs, file.name(), levels - 1)) {
+                return false;
             }
         } else {
+            const char* name = file.name();
+            size_t      len  = strlen(name);
+            if (filename_check(name, len) && !sd_index_is_sidecar(name, len)) {
+                if (sd_index_n == SD_INDEX_MAX_FILES || !sd_index_add(name, file.size())) {
+                    return false;
+                }
+            }
+        }
+        file = root.openNextFile();
+    }
+    return true;
+}
+
+static int sd_index_compare(const void* a, const void* b) {
+    return strcasecmp(sd_index_names + ((const sd_index_entry_t*)a)->name, sd_index_names + ((const sd_index_entry_t*)b)->name);
+}
+
+bool sd_index_build(fs::FS& fs, const char* dirname, uint8_t levels) {
+    if (sd_index_valid()) {
+        return true;
+    }
+    File root = fs.open(dirname);
+    if (!root) {
+        return false;
+    }
+    root.close();
+    uint32_t generation = sd_index_gen;
+    uint32_t start      = millis();
+    sd_index_n          = 0;
+    sd_index_names_len  = 0;
+    if (!sd_index_scan(fs, dirname, levels)) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "SD file list truncated at %d files", sd_index_n);
+    }
+    qsort(sd_index_entries, sd_index_n, sizeof(sd_index_entry_t), sd_index_compare);
+    sd_index_built = generation;
+    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Debug, "SD file list: %d files in %d ms", sd_index_n, millis() - start);
+    return sd_index_valid();
+}
+
+// Fills the current page of mks_file_list from the index
+void mks_listDir(fs::FS& fs, const char* dirname, uint8_t levels) { 
+
+    if (!sd_index_build(fs, dirname, levels)) {
+        return;
+    }
+
+    uint16_t i = (mks_file_list.file_page - 1) * MKS_FILE_NUM;
+    uint32_t size;
+    const char* name;
+
+    while ((mks_file_list.file_begin_num < MKS_FILE_NUM) && ((name = sd_index_get(i, &size)) != NULL)) {
+        char* str = mks_file_list.filename_str[mks_file_list.file_begin_num];
+        strncpy(str, name, MKS_FILE_NAME_LENGTH - 1);
+        str[MKS_FILE_NAME_LENGTH - 1] = '\0';
+        mks_file_list.file_size[mks_file_list.file_begin_num] = size;
+        draw_filexx(mks_file_list.file_begin_num, str);
+        mks_file_list.file_begin_num++;
+        i++;
+    }
+    mks_file_list.file_count = i;
+}
+
+/*
+  Read-ahead line queue. A reader task on the other core reads the job file in
+  SD_READ_CHUNK_SIZE blocks and splits it into a ring of $SD/ReadAhead line slots, so the
+  main loop never waits on the card while the queue has lines in it. The ring has a single
+  producer (the task, which owns sd_line_head) and a single consumer (the main loop, which
+  owns sd_line_tail). myFile and the chunk are only touched with sd_file_mutex held, so
+  open, seek and close never race a read in progress.
+*/
+/*
+  A compiled job (path.bin next to path) starts with sd_compiled_header_t, followed by one
+  record per source line. A record is a count byte: 0..SD_COMPILED_MAX_WORDS means that many
+  words follow, each a letter byte and a little endian int32 value scaled by
+  SD_COMPILED_SCALE; SD_COMPILED_TEXT means a length byte and the raw text line follow, for
+  lines that must still go through execute_line().
+*/
+const uint32_t SD_COMPILED_MAGIC     = 0x314e4247;  // "GBN1"
+const uint8_t  SD_COMPILED_MAX_WORDS = 32;
+const uint8_t  SD_COMPILED_TEXT      = 0xff;
+const float    SD_COMPILED_SCALE     = 10000.0f;
+const int      SD_COMPILED_RECORD    = 2 + SD_MAX_LINE_LENGTH;  // Largest record, in bytes
+
+typedef struct {
+    uint32_t magic;
+    uint32_t source_size;
+    uint32_t source_mtime;
+    uint32_t source_hash;  // FNV-1a over the source bytes
+} sd_compiled_header_t;
+
+typedef struct {
+    union {
+        char      line[SD_MAX_LINE_LENGTH + 1];
+        gc_word_t words[SD_COMPILED_MAX_WORDS];
+    };
+    uint32_t end_pos;  // File offset just past this line
+    int8_t   status;   // SD_LINE_OK, SD_LINE_TOO_LONG or SD_LINE_EOF
+    uint8_t  n_words;  // Words in a compiled record, or SD_COMPILED_TEXT for a text line
+} sd_line_t;
+
+const int8_t SD_LINE_OK         = 0;
+const int8_t SD_LINE_TOO_LONG   = 1;  // Also used for a damaged compiled record
+const int8_t SD_LINE_EOF        = 2;
+const int8_t SD_LINE_READ_ERROR = 3;  // The card kept failing after the retries
+
+static sd_line_t*        sd_lines;             // Ring of sd_line_count slots
+static uint16_t          sd_line_count;
+static volatile uint16_t sd_line_head;         // Next slot the reader task fills
+static volatile uint16_t sd_line_tail;         // Next slot the main loop takes
+static bool              sd_line_held;         // The slot at sd_line_tail was handed out last call
+static uint16_t          sd_fill_len;          // Bytes already copied into the slot at sd_line_head
+static char*             sd_chunk;             // Reader task's block buffer
+static int32_t           sd_chunk_len;
+static int32_t           sd_chunk_pos;
+static uint32_t          sd_file_pos;          // File offset of sd_chunk[sd_chunk_pos]
+static bool              sd_eof_queued;
+static bool              sd_chunk_eof;         // Compiled jobs: nothing left to read past the chunk
+static bool              sd_compiled;          // myFile is a compiled job, see sd_use_compiled()
+static bool              sd_job_gzip;          // myFile is gzip, read through sd_job_gz
+static struct sd_gz_t*   sd_job_gz;            // NULL when it could not be set up, which fails the first read
+static uint32_t          sd_job_size;          // Of the job's offsets, the inflated size for gzip
+static volatile bool     sd_preparse;          // The reader task splits lines into words, see sd_preparse_enable()
+static uint32_t          sd_bytes_consumed;    // File offset just past the last line handed out
+static SemaphoreHandle_t sd_file_mutex;
+static TaskHandle_t      sd_reader_task_handle;
+static TaskHandle_t      sd_waiting_task;
+
+/*
+  Job queue. When a job ends on its last line the next queued file takes its place, without
+  the card being unmounted. Once the reader task has queued the end of the running job it
+  opens the next file, or its compiled copy if that is current, and reads its first block
+  into the then idle chunk, so the switch itself does no card access.
+*/
+static char     sd_queue_paths[SD_QUEUE_MAX][SD_QUEUE_PATH_MAX];
+static uint8_t  sd_queue_len;
+static File     sd_next_file;       // Opened for sd_queue_paths[0]
+static bool     sd_next_compiled;
+static bool     sd_next_fetched;    // sd_chunk holds the first sd_next_chunk_len bytes of sd_next_file
+static int32_t  sd_next_chunk_len;
+
+static void sd_queue_prefetch();
+
+/*
+  Multi-pass jobs. When a job is opened for more than one pass, the first pass keeps a copy of
+  each line it hands out in RAM, in the compiled record format after the line's end offset in
+  the file, pre-parsed into words where that format can hold them. Later passes replay from
+  there without the card or the text parser. The copy is dropped, and every pass reads the
+  card again, if it would leave less than SD_REPLAY_HEAP_RESERVE of heap free.
+*/
+enum class SdReplay : uint8_t {
+    Off,
+    Recording,  // First pass
+    Ready,      // The copy holds the whole job
+    Replaying,
+};
+static SdReplay  sd_replay_state;
+static uint8_t*  sd_replay_buf;
+static uint32_t  sd_replay_len;
+static uint32_t  sd_replay_cap;
+static uint32_t  sd_replay_pos;   // Next record to replay
+static sd_line_t sd_replay_slot;  // Handed out while replaying
+
+static int sd_compile_record(char* line, int len, uint8_t* record, bool* as_words);
+static int sd_encode_words(const gc_word_t* words, uint8_t n_words, uint8_t* record);
+static bool sd_split_words(const char* line, char* collapsed, gc_word_t* words, uint8_t* n_words);
+static int sd_decode_record(const uint8_t* record, int avail, sd_line_t* slot);
+
+static void sd_replay_drop() {
+    free(sd_replay_buf);
+    sd_replay_buf   = NULL;
+    sd_replay_len   = 0;
+    sd_replay_cap   = 0;
+    sd_replay_state = SdReplay::Off;
+}
+
+static bool sd_replay_append(const uint8_t* data, uint32_t len) {
+    if (sd_replay_len + len > sd_replay_cap) {
+        uint32_t cap = sd_replay_cap ? sd_replay_cap * 2 : sd_job_size + sd_job_size / 4 + 1024;
+        while (cap < sd_replay_len + len) {
+            cap *= 2;
+        }
+        if (heap_caps_get_free_size(MALLOC_CAP_8BIT) < cap - sd_replay_cap + SD_REPLAY_HEAP_RESERVE) {
+            return false;
+        }
+        uint8_t* buf = (uint8_t*)realloc(sd_replay_buf, cap);
+        if (!buf) {
+            return false;
+        }
+        sd_replay_buf = buf;
+        sd_replay_cap = cap;
+    }
+    memcpy(sd_replay_buf + sd_replay_len, data, len);
+    sd_replay_len += len;
+    return true;
+}
+
+static void sd_replay_record(const sd_line_t* slot) {
+    static uint8_t record[sizeof(uint32_t) + SD_COMPILED_RECORD];
+    int            size;
+    memcpy(record, &slot->end_pos, sizeof(uint32_t));
+    if (slot->n_words != SD_COMPILED_TEXT) {
+        // Split by the reader task or decoded from a compiled job. The text is gone, so a
+        // value the format cannot keep drops the copy.
+        size = sd_encode_words(slot->words, slot->n_words, record + sizeof(uint32_t));
+        if (size == 0) {
+            sd_replay_drop();
+            return;
+        }
+        size += sizeof(uint32_t);
+    } else {
+        char* line = const_cast<char*>(slot->line);
+        size       = sizeof(uint32_t) + sd_compile_record(line, strlen(line), record + sizeof(uint32_t), NULL);
+    }
+    if (!sd_replay_append(record, size)) {
+        sd_replay_drop();
+    }
+}
+
+static sd_line_t* sd_replay_next() {
+    if (sd_replay_pos >= sd_replay_len) {
+        return NULL;
+    }
+    const uint8_t* p     = sd_replay_buf + sd_replay_pos;
+    int            avail = sd_replay_len - sd_replay_pos - sizeof(uint32_t);
+    uint32_t       end_pos;
+    memcpy(&end_pos, p, sizeof(uint32_t));
+    sd_replay_pos += sizeof(uint32_t) + sd_decode_record(p + sizeof(uint32_t), avail, &sd_replay_slot);
+    sd_replay_slot.status  = SD_LINE_OK;
+    sd_replay_slot.end_pos = end_pos;
+    sd_bytes_consumed      = end_pos;
+    return &sd_replay_slot;
+}
+
+// Whether a slot holds words for gc_execute_words() rather than a text line
+static inline bool sd_slot_is_words(const sd_line_t* slot) {
+    return slot->n_words != SD_COMPILED_TEXT;
+}
+
+static inline uint16_t sd_next_line_index(uint16_t index) {
+    return ++index == sd_line_count ? 0 : index;
+}
+
+static uint32_t              sd_spi_khz;          // Clock in use, at or below $SD/SPIFreq
+static int32_t               sd_spi_khz_setting;  // $SD/SPIFreq that sd_spi_khz was derived from
+static std::atomic<uint32_t> sd_mount_gen;
+
+uint32_t sd_mount_generation() {
+    return sd_mount_gen;
+}
+
+uint32_t sd_get_spi_freq() {
+    if (sd_spi_khz_setting != sd_spi_freq->get()) {
+        sd_spi_khz_setting = sd_spi_freq->get();
+        sd_spi_khz         = sd_spi_khz_setting;
+    }
+    return sd_spi_khz;
+}
+
+// Mounts at the current clock, or failing that at half of it. The lower clock is only kept
+// if the card answers there, so an empty slot does not drag the clock down.
+static bool sd_mount() {
+    uint32_t khz = sd_get_spi_freq();
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (SD.begin((GRBL_SPI_SS == -1) ? SS : GRBL_SPI_SS, SD_SPI, khz * 1000, "/sd", 2)) {
+            if (SD.cardSize() > 0) {
+                sd_mount_gen++;
+                if (khz != sd_spi_khz) {
+                    sd_spi_khz = khz;
+                    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "SD clock lowered to %dkHz", khz);
+                }
+                return true;
+            }
+        }
+        SD.end();
+        if (khz <= SD_SPI_FREQ_MIN) {
+            break;
+        }
+        khz = MAX(khz / 2, SD_SPI_FREQ_MIN);
+    }
+    return false;
+}
+
+// Reads up to len bytes, cut short where needed so the read ends on a sector boundary.
+// Returns 0 at end of file and -1 if the card failed before it.
+static int32_t sd_read_aligned(File& file, uint8_t* buf, size_t len) {
+    uint32_t pos = file.position();
+    uint32_t end = (pos + len) & ~(SD_SECTOR_SIZE - 1);
+    if (end > pos) {
+        len = end - pos;
+    }
+    int32_t n = file.read(buf, len);
+    if (n <= 0) {
+        return pos < file.size() ? -1 : 0;  // File::read() does not tell errors from the end
+    }
+    return n;
+}
+
+// sd_read_aligned() on myFile, remounting slower and reopening at the same offset when the
+// card fails. Caller holds sd_file_mutex.
+static int32_t sd_reader_read(uint8_t* buf, size_t len) {
+    int32_t n = sd_read_aligned(myFile, buf, len);
+    for (int retry = 0; n < 0 && retry < SD_READ_RETRIES; retry++) {
+        String   path = myFile.name();
+        uint32_t pos  = myFile.position();
+        myFile.close();
+        SD.end();
+        if (sd_get_spi_freq() > SD_SPI_FREQ_MIN) {
+            sd_spi_khz = MAX(sd_spi_khz / 2, SD_SPI_FREQ_MIN);
+        }
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "SD read failed, retrying at %dkHz", sd_spi_khz);
+        if (sd_mount()) {
+            myFile = SD.open(path.c_str());
+            if (myFile && myFile.seek(pos)) {
+                n = sd_read_aligned(myFile, buf, len);
+            }
+        }
+    }
+    return n;
+}
+
+/*
+  Gzip jobs: a job file may be gzip compressed, name.nc.gz, and is inflated as it is read, so
+  it runs like the plain file would. Every offset of the job (line end_pos, progress, resume,
+  setFilePos()) is in inflated bytes, and sd_job_size is the inflated size, from the trailer.
+  Inflating needs a 32 KB window, so a seek means inflating again from the start up to the
+  offset. The window and the decompressor take about 47 KB of heap while such a file is open.
+*/
+typedef int32_t (*sd_raw_read_t)(File& file, uint8_t* buf, size_t len);
+
+struct sd_gz_t {
+    tinfl_decompressor inflator;
+    uint8_t            window[TINFL_LZ_DICT_SIZE];  // Wraps; also the history of the stream
+    uint8_t            in[4096];
+    File*              file;
+    sd_raw_read_t      read;
+    size_t             in_pos;
+    size_t             in_len;
+    bool               in_end;
+    bool               done;
+    size_t             out_pos;  // Next byte of window to hand out
+    size_t             out_end;  // End of what is inflated in window
+};
+
+bool sd_file_is_gz(File& file) {
+    uint8_t magic[2];
+    bool    gz = file.seek(0) && file.read(magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    file.seek(0);
+    return gz;
+}
+
+// ISIZE of the trailer, the inflated size modulo 2^32
+static uint32_t sd_gz_size(File& file) {
+    uint8_t isize[4];
+    if (file.size() < 18 || !file.seek(file.size() - 4) || file.read(isize, 4) != 4) {
+        isize[0] = isize[1] = isize[2] = isize[3] = 0;
+    }
+    file.seek(0);
+    return isize[0] | isize[1] << 8 | isize[2] << 16 | (uint32_t)isize[3] << 24;
+}
+
+static int sd_gz_byte(sd_gz_t* gz) {
+    if (gz->in_pos == gz->in_len) {
+        int32_t n = gz->read(*gz->file, gz->in, sizeof(gz->in));
+        if (n <= 0) {
+            return -1;
+        }
+        gz->in_pos = 0;
+        gz->in_len = n;
+    }
+    return gz->in[gz->in_pos++];
+}
+
+// Back to the start of the stream: skips the header (RFC 1952) and starts the raw deflate data
+static bool sd_gz_begin(sd_gz_t* gz) {
+    gz->in_pos  = 0;
+    gz->in_len  = 0;
+    gz->in_end  = false;
+    gz->done    = false;
+    gz->out_pos = 0;
+    gz->out_end = 0;
+    if (!gz->file->seek(0)) {
+        return false;
+    }
+    uint8_t header[10];
+    for (int i = 0; i < 10; i++) {
+        int c = sd_gz_byte(gz);
+        if (c < 0) {
+            return false;
+        }
+        header[i] = c;
+    }
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8) {
+        return false;  // 8 is deflate, the only method there is
+    }
+    uint8_t flags = header[3];
+    if (flags & 0x04) {  // FEXTRA
+        int lo = sd_gz_byte(gz);
+        int hi = sd_gz_byte(gz);
+        if (lo < 0 || hi < 0) {
+            return false;
+        }
+        for (int n = lo | hi << 8; n > 0; n--) {
+            if (sd_gz_byte(gz) < 0) {
+                return false;
+            }
+        }
+    }
+    for (uint8_t field : { 0x08, 0x10 }) {  // FNAME, FCOMMENT; zero terminated
+        if (flags & field) {
+            int c;
+            do {
+                c = sd_gz_byte(gz);
+            } while (c > 0);
+            if (c < 0) {
+                return false;
+            }
+        }
+    }
+    if ((flags & 0x02) && (sd_gz_byte(gz) < 0 || sd_gz_byte(gz) < 0)) {  // FHCRC
+        return false;
+    }
+    tinfl_init(&gz->inflator);
+    return true;
+}
+
+// Up to len inflated bytes; 0 at the end of the stream and -1 on a read error or bad data
+static int32_t sd_gz_read(sd_gz_t* gz, uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        if (gz->out_pos < gz->out_end) {
+            size_t take = MIN(len - n, gz->out_end - gz->out_pos);
+            memcpy(buf + n, gz->window + gz->out_pos, take);
+            gz->out_pos += take;
+            n += take;
+            continue;
+        }
+        if (gz->done) {
+            break;
+        }
+        if (gz->out_end == TINFL_LZ_DICT_SIZE) {
+            gz->out_pos = 0;
+            gz->out_end = 0;
+        }
+        if (gz->in_pos == gz->in_len && !gz->in_end) {
+            int32_t got = gz->read(*gz->file, gz->in, sizeof(gz->in));
+            if (got < 0) {
+                return -1;
+            }
+            gz->in_pos = 0;
+            gz->in_len = got;
+            gz->in_end = got == 0;
+        }
+        size_t       in_n   = gz->in_len - gz->in_pos;
+        size_t       out_n  = TINFL_LZ_DICT_SIZE - gz->out_end;
+        mz_uint32    flags  = gz->in_end ? 0 : TINFL_FLAG_HAS_MORE_INPUT;
+        tinfl_status status = tinfl_decompress(
+            &gz->inflator, gz->in + gz->in_pos, &in_n, gz->window, gz->window + gz->out_end, &out_n, flags);
+        gz->in_pos += in_n;
+        gz->out_end += out_n;
+        if (status == TINFL_STATUS_DONE) {
+            gz->done = true;
+        } else if (status < TINFL_STATUS_DONE || (status == TINFL_STATUS_NEEDS_MORE_INPUT && gz->in_end)) {
+            return -1;  // Corrupt or cut short
+        }
+    }
+    return n;
+}
+
+// Inflates and drops n bytes, to get to an offset
+static bool sd_gz_skip(sd_gz_t* gz, uint8_t* scratch, size_t scratch_len, uint32_t n) {
+    while (n) {
+        int32_t got = sd_gz_read(gz, scratch, MIN(n, scratch_len));
+        if (got <= 0) {
+            return false;
+        }
+        n -= got;
+    }
+    return true;
+}
+
+static void sd_gz_free(sd_gz_t* gz) {
+    free(gz);
+}
+
+static sd_gz_t* sd_gz_open(File& file, sd_raw_read_t read) {
+    sd_gz_t* gz = (sd_gz_t*)malloc(sizeof(sd_gz_t));
+    if (!gz) {
+        return NULL;
+    }
+    gz->file = &file;
+    gz->read = read;
+    if (!sd_gz_begin(gz)) {
+        sd_gz_free(gz);
+        return NULL;
+    }
+    return gz;
+}
+
+static int32_t sd_gz_job_read(File& file, uint8_t* buf, size_t len) {
+    return sd_reader_read(buf, len);  // file is myFile
+}
 
-            memcpy(mks_filename_check_str, file.name(), 255);
-            strcpy(mks_filename_check_str, file.name());
-
-            if(filename_check(mks_filename_check_str, strlen(mks_filename_check_str)) == true) {
-                if((mks_file_list.file_count >= ((mks_file_list.file_page * MKS_FILE_NUM)-(MKS_FILE_NUM))) 
-                    && (mks_file_list.file_count < (mks_file_list.file_page * MKS_FILE_NUM))) {
-                    memset(mks_file_list.filename_str[mks_file_list.file_begin_num], 0, sizeof(mks_file_list.filename_str[mks_file_list.file_begin_num]));
-                    strcpy(mks_file_list.filename_str[mks_file_list.file_begin_num], mks_filename_check_str);
-                    mks_file_list.file_size[mks_file_list.file_begin_num] = file.size();
-                    draw_filexx(mks_file_list.file_begin_num, mks_file_list.filename_str[mks_file_list.file_begin_num]);
-                    mks_file_list.file_begin_num++;
+static int32_t sd_gz_plain_read(File& file, uint8_t* buf, size_t len) {
+    return file.read(buf, len);
+}
+
+// Sets up reading myFile after it was opened or swapped. Caller holds sd_file_mutex.
+static void sd_job_attach() {
+    sd_gz_free(sd_job_gz);
+    sd_job_gz   = NULL;
+    sd_job_gzip = myFile && !sd_compiled && sd_file_is_gz(myFile);
+    sd_job_size = myFile ? myFile.size() : 0;
+    if (sd_job_gzip) {
+        sd_job_size = sd_gz_size(myFile);
+        sd_job_gz   = sd_gz_open(myFile, sd_gz_job_read);
+    }
+}
+
+// A text line has been read into slot. For a job run through readFileBlock(), plain g-code is
+// split into words here, on the reader's core, so the main loop only executes them.
+static void sd_reader_line_done(sd_line_t* slot) {
+    static char collapsed[SD_MAX_LINE_LENGTH + 1];  // The reader task's own; the compiler has another
+    uint8_t     n_words;
+    slot->line[sd_fill_len] = '\0';
+    slot->end_pos           = sd_file_pos;
+    slot->status            = SD_LINE_OK;
+    slot->n_words           = SD_COMPILED_TEXT;
+    sd_fill_len             = 0;
+    // The words go over the line, which is safe as they are parsed from the copy
+    if (sd_preparse && sd_split_words(slot->line, collapsed, slot->words, &n_words)) {
+        slot->n_words = n_words;
+    }
+    sd_line_head = sd_next_line_index(sd_line_head);
+}
+
+// Reads and splits lines until the queue is full or the end of file is queued.
+// Caller holds sd_file_mutex.
+static void sd_reader_fill() {
+    while (!sd_eof_queued && sd_next_line_index(sd_line_head) != sd_line_tail) {
+        if (sd_chunk_pos == sd_chunk_len) {
+            if (sd_job_gzip) {
+                sd_chunk_len = sd_job_gz ? sd_gz_read(sd_job_gz, (uint8_t*)sd_chunk, SD_READ_CHUNK_SIZE) : -1;
+            } else {
+                sd_chunk_len = sd_reader_read((uint8_t*)sd_chunk, SD_READ_CHUNK_SIZE);
+            }
+            sd_chunk_pos = 0;
+            if (sd_chunk_len < 0) {
+                sd_chunk_len = 0;
+                sd_line_t* slot = &sd_lines[sd_line_head];
+                slot->status    = SD_LINE_READ_ERROR;
+                slot->end_pos   = sd_file_pos;
+                sd_eof_queued   = true;
+                sd_line_head    = sd_next_line_index(sd_line_head);
+                return;
+            }
+            if (sd_chunk_len == 0) {
+                sd_line_t* slot = &sd_lines[sd_line_head];
+                if (sd_fill_len) {
+                    sd_reader_line_done(slot);  // Last line has no newline
+                    continue;
                 }
-                mks_file_list.file_count++;
-                if(mks_file_list.file_count >= (mks_file_list.file_page * MKS_FILE_NUM)) return;
+                slot->status  = SD_LINE_EOF;
+                slot->end_pos = sd_file_pos;
+                sd_eof_queued = true;
+                sd_line_head  = sd_next_line_index(sd_line_head);
+                return;
+            }
+        }
+        sd_line_t* slot  = &sd_lines[sd_line_head];
+        char*      start = sd_chunk + sd_chunk_pos;
+        int        avail = sd_chunk_len - sd_chunk_pos;
+        char*      nl    = (char*)memchr(start, '\n', avail);
+        int        len   = nl ? nl - start : avail;
+        if (sd_fill_len + len >= SD_MAX_LINE_LENGTH) {
+            // Longer lines end the job, as they always have
+            slot->status  = SD_LINE_TOO_LONG;
+            slot->end_pos = sd_file_pos;
+            sd_eof_queued = true;
+            sd_line_head  = sd_next_line_index(sd_line_head);
+            return;
+        }
+        memcpy(slot->line + sd_fill_len, start, len);
+        sd_fill_len += len;
+        sd_chunk_pos += nl ? len + 1 : len;
+        sd_file_pos += nl ? len + 1 : len;
+        if (nl) {
+            sd_reader_line_done(slot);
+            if (sd_waiting_task) {
+                xTaskNotifyGive(sd_waiting_task);
+            }
+        }
+    }
+}
+
+// Decodes the compiled record at record into slot and returns its size, which is more than
+// avail when the record is damaged or cut short
+static int sd_decode_record(const uint8_t* record, int avail, sd_line_t* slot) {
+    int size;
+    if (record[0] == SD_COMPILED_TEXT) {
+        size = avail >= 2 ? 2 + record[1] : avail + 1;
+        if (size <= avail) {
+            memcpy(slot->line, record + 2, record[1]);
+            slot->line[record[1]] = '\0';
+            slot->n_words         = SD_COMPILED_TEXT;
+        }
+    } else {
+        slot->n_words = record[0];
+        size          = 1 + 5 * slot->n_words;
+        if (slot->n_words <= SD_COMPILED_MAX_WORDS && size <= avail) {
+            for (int i = 0; i < slot->n_words; i++) {
+                const uint8_t* word    = record + 1 + 5 * i;
+                int32_t        fixed   = word[1] | (word[2] << 8) | (word[3] << 16) | ((uint32_t)word[4] << 24);
+                slot->words[i].letter = word[0];
+                slot->words[i].value  = fixed / SD_COMPILED_SCALE;
             }
+        } else {
+            size = avail + 1;
         }
-        file =  root.openNextFile();
     }
+    return size;
+}
+
+// Counterpart of sd_reader_fill() for compiled jobs. Records never span a chunk, since the
+// unread tail is moved to the front before reading more.
+static void sd_reader_fill_compiled() {
+    while (!sd_eof_queued && sd_next_line_index(sd_line_head) != sd_line_tail) {
+        int avail = sd_chunk_len - sd_chunk_pos;
+        if (avail < SD_COMPILED_RECORD && !sd_chunk_eof) {
+            memmove(sd_chunk, sd_chunk + sd_chunk_pos, avail);
+            int32_t len = sd_reader_read((uint8_t*)sd_chunk + avail, SD_READ_CHUNK_SIZE - avail);
+            if (len < 0) {
+                sd_line_t* slot = &sd_lines[sd_line_head];
+                slot->status    = SD_LINE_READ_ERROR;
+                slot->end_pos   = sd_file_pos;
+                sd_eof_queued   = true;
+                sd_line_head    = sd_next_line_index(sd_line_head);
+                return;
+            }
+            if (len == 0) {
+                sd_chunk_eof = true;
+            }
+            sd_chunk_len = avail + len;
+            sd_chunk_pos = 0;
+            avail        = sd_chunk_len;
+        }
+        sd_line_t*     slot   = &sd_lines[sd_line_head];
+        const uint8_t* record = (const uint8_t*)sd_chunk + sd_chunk_pos;
+        int            size;
+        slot->status = SD_LINE_OK;
+        if (avail == 0) {
+            slot->status = SD_LINE_EOF;
+        } else {
+            size = sd_decode_record(record, avail, slot);
+        }
+        if (slot->status == SD_LINE_OK && size > avail) {
+            slot->status = SD_LINE_TOO_LONG;  // Truncated file
+        }
+        if (slot->status != SD_LINE_OK) {
+            slot->end_pos = sd_file_pos;
+            sd_eof_queued = true;
+            sd_line_head  = sd_next_line_index(sd_line_head);
+            return;
+        }
+        sd_chunk_pos += size;
+        sd_file_pos += size;
+        slot->end_pos = sd_file_pos;
+        sd_line_head  = sd_next_line_index(sd_line_head);
+        if (sd_waiting_task) {
+            xTaskNotifyGive(sd_waiting_task);
+        }
+    }
+}
+
+static void sdReaderTask(void* pvParameters) {
+    heap_track_task();
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // Woken when a slot is freed or the file changes
+        xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+        if (myFile) {
+            if (sd_compiled) {
+                sd_reader_fill_compiled();
+            } else {
+                sd_reader_fill();
+            }
+            sd_queue_prefetch();
+        }
+        xSemaphoreGive(sd_file_mutex);
+        if (sd_waiting_task) {
+            xTaskNotifyGive(sd_waiting_task);
+        }
+    }
+}
+
+static bool sd_reader_init() {
+    if (sd_reader_task_handle) {
+        return true;
+    }
+    sd_line_count = sd_read_ahead->get() + 1;  // One slot always stays empty
+    sd_lines      = (sd_line_t*)malloc(sizeof(sd_line_t) * sd_line_count);
+    sd_chunk      = (char*)heap_caps_malloc(SD_READ_CHUNK_SIZE, MALLOC_CAP_DMA);  // Word aligned, in internal RAM
+    sd_file_mutex = xSemaphoreCreateMutex();
+    if (!sd_lines || !sd_chunk || !sd_file_mutex) {
+        return false;
+    }
+    xTaskCreatePinnedToCore(sdReaderTask,  // task
+                            "sdReaderTask",
+                            4096,  // stack size
+                            NULL,
+                            1,  // priority
+                            &sd_reader_task_handle,
+                            SD_READER_TASK_CORE);
+    return sd_reader_task_handle != NULL;
+}
+
+bool sd_reader_wants_card() {
+    if (!sd_reader_task_handle || sd_eof_queued || sd_replay_state == SdReplay::Replaying || !myFile) {
+        return false;
+    }
+    uint16_t queued = (sd_line_head + sd_line_count - sd_line_tail) % sd_line_count;
+    return queued < sd_line_count / 2;
+}
+
+// Drops any queued lines. Caller holds sd_file_mutex.
+static void sd_reader_reset(uint32_t pos) {
+    sd_line_head      = 0;
+    sd_line_tail      = 0;
+    sd_line_held      = false;
+    sd_fill_len       = 0;
+    sd_chunk_len      = 0;
+    sd_chunk_pos      = 0;
+    sd_file_pos       = pos;
+    sd_eof_queued     = false;
+    sd_chunk_eof      = false;
+    sd_bytes_consumed = pos;
+    sd_next_fetched   = false;  // The chunk is the job's again
+    sd_next_chunk_len = 0;
 }
 
 boolean openFile(fs::FS& fs, const char* path) {
-    myFile = fs.open(path);
+    if (!sd_reader_init()) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    myFile      = fs.open(path);
+    sd_compiled = false;
+    sd_preparse = false;
+    sd_reader_reset(0);
+    sd_job_attach();
+    if (sd_job_gzip && !sd_job_gz) {
+        myFile.close();  // Not a gzip stream, or no heap for the window
+    }
+    xSemaphoreGive(sd_file_mutex);
+    sd_replay_drop();
     if (!myFile) {
         return false;
     }
+    if (mks_grbl.carve_times > 1) {
+        sd_replay_state = SdReplay::Recording;  // mks fix: later passes replay from RAM
+    }
+    validate_eta_load(fs, path);
+    st_job_stats_reset();
     set_sd_state(SDState::BusyPrinting);
+    joblog_job_start(path);
     SD_ready_next          = false;  // this will get set to true when Grbl issues "ok" message
     sd_current_line_number = 0;
+    xTaskNotifyGive(sd_reader_task_handle);  // Start reading ahead
     return true;
 }
 
@@ -165,8 +974,27 @@ boolean closeFile() {
     set_sd_state(SDState::Idle);
     SD_ready_next          = false;
     sd_current_line_number = 0;
+    // mc_reset() can get here from the limit switch ISR, where the mutex cannot be taken
+    bool locked = !xPortInIsrContext() && xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    if (locked) {
+        mks_powerless_close();  // Its file goes with the job's
+        sd_replay_drop();
+        sd_gz_free(sd_job_gz);
+        sd_job_gz = NULL;
+    } else {
+        sd_replay_state = SdReplay::Off;  // Not freed in an ISR; the next open does that
+    }
+    sd_next_file.close();  // A stopped job does not start the queue
+    sd_queue_len    = 0;
+    sd_next_fetched = false;
     myFile.close();
-    SD.end();
+    sd_compiled = false;
+    sd_job_gzip = false;
+    validate_eta_unload();
+    sd_reader_reset(0);
+    if (locked) {
+        xSemaphoreGive(sd_file_mutex);
+    }
     return true;
 }
 
@@ -176,15 +1004,60 @@ boolean setFilePos(uint32_t pos) {
     }
 
     sd_current_line_number = 0;
-    myFile.seek(pos);
+    sd_replay_drop();  // The RAM copy only replays whole passes
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    if (sd_compiled) {
+        // Records do not line up with source offsets; only a restart from 0 is meaningful
+        pos += sizeof(sd_compiled_header_t);
+    }
+    bool ok;
+    if (sd_job_gzip) {
+        ok = sd_job_gz && sd_gz_begin(sd_job_gz) && sd_gz_skip(sd_job_gz, (uint8_t*)sd_chunk, SD_READ_CHUNK_SIZE, pos);
+    } else {
+        ok = myFile.seek(pos);
+    }
+    sd_reader_reset(pos);
+    xSemaphoreGive(sd_file_mutex);
+    xTaskNotifyGive(sd_reader_task_handle);
+    return ok;
+}
+
+void sd_preparse_enable() {
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    sd_preparse = true;
+    xSemaphoreGive(sd_file_mutex);
 }
 
+boolean sd_rewind() {
+    if (sd_replay_state == SdReplay::Ready || sd_replay_state == SdReplay::Replaying) {
+        sd_replay_state        = SdReplay::Replaying;
+        sd_replay_pos          = 0;
+        sd_bytes_consumed      = 0;
+        sd_current_line_number = 0;
+        return true;
+    }
+    return setFilePos(0);
+}
 
 boolean mks_openFile(fs::FS& fs, const char* path) {
-    myFile = fs.open(path);
+    if (!sd_reader_init()) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    myFile      = fs.open(path);
+    sd_compiled = false;
+    sd_preparse = false;
+    sd_reader_reset(0);
+    sd_job_attach();
+    if (sd_job_gzip && !sd_job_gz) {
+        myFile.close();
+    }
+    xSemaphoreGive(sd_file_mutex);
     if (!myFile) {
         return false;
     }
+    st_job_stats_reset();
+    xTaskNotifyGive(sd_reader_task_handle);
     return true;
 }
 
@@ -193,27 +1066,99 @@ boolean mks_openFile(fs::FS& fs, const char* path) {
   strip whitespace
   strip comments per http://linuxcnc.org/docs/ja/html/gcode/overview.html#gcode:comments
   make uppercase
-  return true if a line is
+  return a pointer to the zero-terminated line, or NULL at end of file or if the line is
+  longer than SD_MAX_LINE_LENGTH. The line is taken from the read-ahead queue and stays
+  valid until the next call.
 */
-boolean readFileLine(char* line, int maxlen) {
+// Takes the next slot from the read-ahead queue, waiting for the reader task if it is empty.
+static sd_line_t* sd_next_slot() {
+    TRACE_SCOPE(TraceEvent::SdLine);
     if (!myFile) {
         report_status_message(Error::FsFailedRead, SD_client);
-        return false;
+        return NULL;
     }
     sd_current_line_number += 1;
-    int len = 0;
-    while (myFile.available()) {
-        if (len >= maxlen) {
-            return false;
+    if (sd_replay_state == SdReplay::Replaying) {
+        return sd_replay_next();
+    }
+    if (sd_line_held) {
+        // Done with the slot handed out last time; let the reader task reuse it
+        sd_line_held = false;
+        sd_line_tail = sd_next_line_index(sd_line_tail);
+        xTaskNotifyGive(sd_reader_task_handle);
+    }
+    while (sd_line_tail == sd_line_head) {
+        // Queue ran dry, so wait for the card
+        sd_waiting_task = xTaskGetCurrentTaskHandle();
+        xTaskNotifyGive(sd_reader_task_handle);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+    sd_waiting_task = NULL;
+    sd_line_t* slot = &sd_lines[sd_line_tail];
+    if (slot->status != SD_LINE_OK) {
+        if (slot->status == SD_LINE_READ_ERROR) {
+            report_status_message(Error::FsFailedRead, SD_client);
         }
-        char c = myFile.read();
-        if (c == '\n') {
-            break;
+        if (sd_replay_state == SdReplay::Recording) {
+            if (slot->status == SD_LINE_EOF) {
+                sd_replay_state = SdReplay::Ready;
+            } else {
+                sd_replay_drop();
+            }
         }
-        line[len++] = c;
+        return NULL;  // Stays at the end marker until the file is reset
+    }
+    sd_bytes_consumed = slot->end_pos;
+    sd_line_held      = true;
+    if (sd_replay_state == SdReplay::Recording) {
+        sd_replay_record(slot);
+    }
+    return slot;
+}
+
+char* readFileLinePtr() {
+    sd_line_t* slot = sd_next_slot();
+    if (!slot || sd_slot_is_words(slot)) {
+        return NULL;  // Compiled records are only understood by readFileBlock()
+    }
+    return slot->line;
+}
+
+boolean readFileBlock(sd_block_t* block) {
+    sd_line_t* slot = sd_next_slot();
+    if (!slot) {
+        return false;
+    }
+    if (sd_slot_is_words(slot)) {
+        block->line    = NULL;
+        block->words   = slot->words;
+        block->n_words = slot->n_words;
+    } else {
+        block->line    = slot->line;
+        block->words   = NULL;
+        block->n_words = 0;
+    }
+    return true;
+}
+
+Error sd_execute_block(sd_block_t* block, uint8_t client, WebUI::AuthenticationLevel auth_level) {
+    if (block->line) {
+        return execute_line(block->line, client, auth_level);
     }
-    line[len] = '\0';
-    return len || myFile.available();
+    // Same lock-out execute_line() applies to g-code
+    if (sys.state == State::Alarm || sys.state == State::Jog) {
+        return Error::SystemGcLock;
+    }
+    return gc_execute_words(block->words, block->n_words, client);
+}
+
+boolean readFileLine(char* line, int maxlen) {
+    char* p = readFileLinePtr();
+    if (!p || strlen(p) >= (size_t)maxlen) {
+        return false;
+    }
+    strcpy(line, p);
+    return true;
 }
 
 boolean readFileBuff(uint8_t *buf, uint32_t size) {
@@ -222,18 +1167,57 @@ boolean readFileBuff(uint8_t *buf, uint32_t size) {
         report_status_message(Error::FsFailedRead, SD_client);
         return false;
     }
-    myFile.read((uint8_t *)buf, size-1);
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    if (sd_job_gzip) {
+        uint32_t pos = sd_bytes_consumed;
+        int32_t  n   = 0;
+        if (sd_job_gz && sd_gz_begin(sd_job_gz) && sd_gz_skip(sd_job_gz, (uint8_t*)sd_chunk, SD_READ_CHUNK_SIZE, pos)) {
+            n = MAX(sd_gz_read(sd_job_gz, buf, size - 1), 0);
+        }
+        sd_reader_reset(pos + n);  // The reader inflates on from here
+    } else {
+        myFile.seek(sd_bytes_consumed);
+        myFile.read((uint8_t *)buf, size-1);
+        sd_reader_reset(myFile.position());
+    }
+    xSemaphoreGive(sd_file_mutex);
+    xTaskNotifyGive(sd_reader_task_handle);
     return true;
 }
 
 
 
 // return a percentage complete 50.5 = 50.5%
+// Of the estimated job time when the file was checked, see Validate.h, otherwise of the bytes.
+// A compiled job's offsets are not the source's, so it is always by bytes.
 float sd_report_perc_complete() {
     if (!myFile) {
         return 0.0;
     }
-    return (float)myFile.position() / (float)myFile.size() * 100.0f;
+    float total = validate_eta_total();
+    if (total > 0 && !sd_compiled) {
+        return validate_eta_elapsed(sd_bytes_consumed) / total * 100.0f;
+    }
+    return (float)sd_bytes_consumed / (float)sd_job_size * 100.0f;
+}
+
+int32_t sd_report_remaining_seconds() {
+    if (!myFile || sd_compiled) {
+        return -1;
+    }
+    float total = validate_eta_total();
+    if (total < 0) {
+        return -1;
+    }
+    return MAX(total - validate_eta_elapsed(sd_bytes_consumed), 0.0f);
+}
+
+bool sd_get_resume_pos(uint32_t* pos) {
+    if (!myFile || sd_compiled) {
+        return false;
+    }
+    *pos = sd_bytes_consumed;
+    return true;
 }
 
 // mks fix
@@ -247,10 +1231,42 @@ void sd_set_current_line_number(uint32_t num) {
 
 SDState sd_state = SDState::Idle;
 
+/*
+  The card stays mounted between jobs and listings. It is mounted again only once the card
+  detect pin has changed, or, without a detect pin, once the card no longer answers a read of
+  its first sector.
+*/
+static volatile bool sd_card_changed = true;
+
+static void IRAM_ATTR sd_detect_isr() {
+    sd_card_changed = true;
+}
+
+static bool sd_card_answers() {
+    if (SDCARD_DET_PIN != UNDEFINED_PIN) {
+        return true;  // A removal shows on the pin
+    }
+    static uint8_t sector[SD_SECTOR_SIZE];
+    return SD.readRAW(sector, 0);
+}
+
 SDState get_sd_state(bool refresh) {
     if (SDCARD_DET_PIN != UNDEFINED_PIN) {
+        static bool detect_attached = false;
+        if (!detect_attached) {
+            pinMode(SDCARD_DET_PIN, INPUT);
+            attachInterrupt(digitalPinToInterrupt(SDCARD_DET_PIN), sd_detect_isr, CHANGE);
+            detect_attached = true;
+        }
         if (digitalRead(SDCARD_DET_PIN) != SDCARD_DET_VAL) {
-            sd_state = SDState::NotPresent;
+            if (sd_state != SDState::NotPresent) {
+                sd_index_invalidate();
+            }
+            if (sd_state == SDState::Idle) {
+                SD.end();
+            }
+            sd_card_changed = true;
+            sd_state        = SDState::NotPresent;
             return sd_state;
             //no need to go further if SD detect is not correct
         }
@@ -264,15 +1280,25 @@ SDState get_sd_state(bool refresh) {
         return sd_state;  //to avoid refresh=true + busy to reset SD and waste time
     }
 
-    //SD is idle or not detected, let see if still the case
+    // Still the card that was mounted
+    bool same_clock = sd_spi_khz_setting == sd_spi_freq->get();
+    if (!sd_card_changed && same_clock && SD.cardType() != CARD_NONE && sd_card_answers()) {
+        sd_state = SDState::Idle;
+        return sd_state;
+    }
+    sd_card_changed = false;
     SD.end();
     sd_state = SDState::NotPresent;
-    //using default value for speed ? should be parameter
     //refresh content if card was removed
-    if (SD.begin((GRBL_SPI_SS == -1) ? SS : GRBL_SPI_SS, SD_SPI, GRBL_SPI_FREQ, "/sd", 2)) {
-        if (SD.cardSize() > 0) {
-            sd_state = SDState::Idle;
+    if (sd_mount()) {
+        sd_state = SDState::Idle;
+        // Without a detect pin a swapped card is only noticed by its size
+        if (SD.cardSize() != sd_index_card_size) {
+            sd_index_card_size = SD.cardSize();
+            sd_index_invalidate();
         }
+    } else {
+        sd_index_invalidate();
     }
     return sd_state;
 }
@@ -312,11 +1338,672 @@ SDState write_file(const char* path, const char* message) {
 void sd_get_current_filename(char* name) {
     if (myFile) {
         strcpy(name, myFile.name());
+        if (sd_compiled) {
+            name[strlen(name) - strlen(".bin")] = '\0';  // Report the source, not the compiled file
+        }
     } else {
         name[0] = 0;
     }
 }
 
+static uint32_t sd_hash(uint32_t hash, const uint8_t* data, size_t len) {
+    while (len--) {
+        hash = (hash ^ *data++) * 16777619u;  // FNV-1a
+    }
+    return hash;
+}
+
+// Splits a text line into words as gc_execute_line() would, using collapsed for the copy it
+// works on. False for lines that must go through execute_line(): comments may carry messages,
+// and $ or [ lines are system commands.
+static bool sd_split_words(const char* line, char* collapsed, gc_word_t* words, uint8_t* n_words) {
+    if (!line[0] || strpbrk(line, "($[;%#")) {
+        return false;  // Parameters take their values when the line runs, see OWord.h
+    }
+    strcpy(collapsed, line);
+    collapseGCode(collapsed);
+    return collapsed[0] && collapsed[0] != 'O' && gc_parse_words(collapsed, words, SD_COMPILED_MAX_WORDS, n_words) == Error::Ok;
+}
+
+// Writes words as a compiled record and returns its size, or 0 if a value has more decimals
+// or is larger than the fixed point format keeps
+static int sd_encode_words(const gc_word_t* words, uint8_t n_words, uint8_t* record) {
+    for (int i = 0; i < n_words; i++) {
+        float value = words[i].value;
+        if (fabsf(value) >= INT32_MAX / SD_COMPILED_SCALE) {
+            return 0;
+        }
+        int32_t fixed = lroundf(value * SD_COMPILED_SCALE);
+        if (fabsf(fixed / SD_COMPILED_SCALE - value) > fabsf(value) * 1e-6f) {
+            return 0;  // More decimals than the format keeps
+        }
+        uint8_t* word = record + 1 + 5 * i;
+        word[0]       = words[i].letter;
+        word[1]       = fixed;
+        word[2]       = fixed >> 8;
+        word[3]       = fixed >> 16;
+        word[4]       = fixed >> 24;
+    }
+    record[0] = n_words;
+    return 1 + 5 * n_words;
+}
+
+// Encodes one source line as a compiled record, as words if it is plain g-code that survives
+// the fixed point conversion, otherwise as text. Returns the record size, and in *as_words
+// whether it was stored as words.
+static int sd_compile_record(char* line, int len, uint8_t* record, bool* as_words_out) {
+    static char collapsed[SD_MAX_LINE_LENGTH + 1];
+    gc_word_t   words[SD_COMPILED_MAX_WORDS];
+    uint8_t     n_words = 0;
+
+    line[len]     = '\0';
+    int  size     = 0;
+    bool as_words = sd_split_words(line, collapsed, words, &n_words) && (size = sd_encode_words(words, n_words, record)) > 0;
+    if (as_words_out) {
+        *as_words_out = as_words;
+    }
+    if (as_words) {
+        return size;
+    }
+    record[0] = SD_COMPILED_TEXT;
+    record[1] = len;
+    memcpy(record + 2, line, len);
+    return 2 + len;
+}
+
+// Writes one source line to the compiled file. Returns true if it was stored as words.
+static bool sd_compile_line(File& out, char* line, int len) {
+    static uint8_t record[SD_COMPILED_RECORD];
+    bool           as_words;
+    out.write(record, sd_compile_record(line, len, record, &as_words));
+    return as_words;
+}
+
+Error sd_for_each_line(File& source, sd_line_handler_t handler, void* arg, uint32_t* n_lines, uint32_t* hash, sd_progress_t progress) {
+    static uint8_t chunk[512];
+    static char    line[SD_MAX_LINE_LENGTH + 1];
+    uint32_t       size = source.size();
+    uint32_t       pos  = 0;
+    int            len  = 0;
+    int            n;
+    *n_lines = 0;
+    sd_gz_t* gz = NULL;
+    if (sd_file_is_gz(source)) {
+        gz = sd_gz_open(source, sd_gz_plain_read);
+        if (!gz) {
+            return Error::FsFailedRead;
+        }
+    }
+    Error status = Error::Ok;
+    while (status == Error::Ok && (n = gz ? sd_gz_read(gz, chunk, sizeof(chunk)) : source.read(chunk, sizeof(chunk))) > 0) {
+        pos = gz ? source.position() : pos + n;  // Progress is through the file as stored
+        if (progress && !progress(pos, size)) {
+            status = Error::Cancelled;
+            break;
+        }
+        if (hash) {
+            *hash = sd_hash(*hash, chunk, n);
+        }
+        for (int i = 0; i < n; i++) {
+            char c = chunk[i];
+            if (c == '\n') {
+                handler(line, len, arg);
+                (*n_lines)++;
+                len = 0;
+            } else if (len < SD_MAX_LINE_LENGTH - 1) {
+                line[len++] = c;
+            } else {
+                status = Error::Overflow;  // Would also end the job when run as text
+                break;
+            }
+        }
+    }
+    sd_gz_free(gz);
+    if (status == Error::Ok && n < 0) {
+        status = Error::FsFailedRead;  // Corrupt gzip data
+    }
+    if (status == Error::Ok && len) {
+        handler(line, len, arg);
+        (*n_lines)++;
+    }
+    return status;
+}
+
+typedef struct {
+    File*    out;
+    uint32_t n_compiled;
+} sd_compile_state_t;
+
+static void sd_compile_handler(char* line, int len, void* arg) {
+    sd_compile_state_t* state = (sd_compile_state_t*)arg;
+    state->n_compiled += sd_compile_line(*state->out, line, len);
+}
+
+Error sd_compile_file(fs::FS& fs, const char* path, uint32_t* n_lines, uint32_t* n_compiled) {
+    *n_lines    = 0;
+    *n_compiled = 0;
+    File source = fs.open(path);
+    if (!source) {
+        return Error::FsFileNotFound;
+    }
+    String bin_path = String(path) + ".bin";
+    File   out      = fs.open(bin_path.c_str(), FILE_WRITE);
+    if (!out) {
+        source.close();
+        return Error::FsFailedOpenFile;
+    }
+    // The magic is only written once the whole file is done, so a partial file is never used
+    sd_compiled_header_t header = { 0, (uint32_t)source.size(), (uint32_t)source.getLastWrite(), 2166136261u };
+    out.write((uint8_t*)&header, sizeof(header));
+
+    sd_compile_state_t state  = { &out, 0 };
+    Error              status = sd_for_each_line(source, sd_compile_handler, &state, n_lines, &header.source_hash, NULL);
+    *n_compiled               = state.n_compiled;
+    source.close();
+    if (status == Error::Ok) {
+        header.magic = SD_COMPILED_MAGIC;
+        out.seek(0);
+        out.write((uint8_t*)&header, sizeof(header));
+    }
+    out.close();
+    if (status != Error::Ok) {
+        fs.remove(bin_path.c_str());
+    }
+    return status;
+}
+
+// Opens source's compiled copy into bin, just past its header, if there is one that matches
+static bool sd_open_compiled(fs::FS& fs, File& source, File& bin) {
+    String bin_path = String(source.name()) + ".bin";
+    if (!fs.exists(bin_path.c_str())) {
+        return false;
+    }
+    bin = fs.open(bin_path.c_str());
+    sd_compiled_header_t header;
+    // Size and modification time identify the source; hashing it here would mean reading it all
+    if (!bin || bin.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != SD_COMPILED_MAGIC ||
+        header.source_size != source.size() || header.source_mtime != (uint32_t)source.getLastWrite()) {
+        bin.close();
+        return false;
+    }
+    return true;
+}
+
+boolean sd_use_compiled(fs::FS& fs) {
+    if (!myFile || sd_compiled) {
+        return false;
+    }
+    File bin;
+    if (!sd_open_compiled(fs, myFile, bin)) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    myFile.close();
+    myFile      = bin;
+    sd_compiled = true;
+    sd_reader_reset(sizeof(sd_compiled_header_t));
+    sd_job_attach();
+    xSemaphoreGive(sd_file_mutex);
+    xTaskNotifyGive(sd_reader_task_handle);
+    return true;
+}
+
+bool sd_queue_add(const char* path) {
+    if (strlen(path) >= SD_QUEUE_PATH_MAX || !sd_reader_init()) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    bool ok = sd_queue_len < SD_QUEUE_MAX;
+    if (ok) {
+        strcpy(sd_queue_paths[sd_queue_len++], path);
+    }
+    xSemaphoreGive(sd_file_mutex);
+    if (ok && sd_eof_queued) {
+        xTaskNotifyGive(sd_reader_task_handle);  // Added as the job ends; prefetch it now
+    }
+    return ok;
+}
+
+void sd_queue_clear() {
+    if (!sd_file_mutex) {
+        return;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    sd_next_file.close();
+    sd_queue_len    = 0;
+    sd_next_fetched = false;
+    xSemaphoreGive(sd_file_mutex);
+}
+
+uint8_t sd_queue_count() {
+    return sd_queue_len;
+}
+
+bool sd_queue_get(uint8_t i, char* path) {
+    if (!sd_file_mutex) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    bool ok = i < sd_queue_len;
+    if (ok) {
+        strcpy(path, sd_queue_paths[i]);
+    }
+    xSemaphoreGive(sd_file_mutex);
+    return ok;
+}
+
+// Opens the head of the queue and reads its first block, once the running job has queued its
+// last line. Caller holds sd_file_mutex.
+static void sd_queue_prefetch() {
+    if (!sd_queue_len || sd_next_fetched || !sd_eof_queued) {
+        return;
+    }
+    if (sd_lines[(sd_line_head + sd_line_count - 1) % sd_line_count].status != SD_LINE_EOF) {
+        return;  // The job failed, so the queue stops with it
+    }
+    sd_next_fetched = true;
+    if (!sd_next_file) {
+        sd_next_file     = SD.open(sd_queue_paths[0]);
+        sd_next_compiled = false;
+        File bin;
+        if (sd_next_file && sd_open_compiled(SD, sd_next_file, bin)) {
+            sd_next_file.close();
+            sd_next_file     = bin;
+            sd_next_compiled = true;
+        }
+        if (!sd_next_file) {
+            return;
+        }
+    }
+    if (!sd_next_compiled && sd_file_is_gz(sd_next_file)) {
+        sd_next_chunk_len = 0;  // Its chunk is inflated, once it is the job
+        return;
+    }
+    uint32_t start    = sd_next_compiled ? sizeof(sd_compiled_header_t) : 0;
+    sd_next_chunk_len = sd_next_file.seek(start) ? sd_read_aligned(sd_next_file, (uint8_t*)sd_chunk, SD_READ_CHUNK_SIZE) : -1;
+    if (sd_next_chunk_len < 0) {
+        sd_next_chunk_len = 0;  // Read again, with the retries, once it is the job
+        sd_next_file.seek(start);
+    }
+}
+
+boolean sd_queue_start_next() {
+    if (!myFile || !sd_queue_len) {
+        return false;
+    }
+    xSemaphoreTake(sd_file_mutex, portMAX_DELAY);
+    sd_queue_prefetch();  // Normally done by now
+    if (!sd_next_file) {
+        if (sd_next_fetched) {
+            grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "SD queue: can not open %s", sd_queue_paths[0]);
+        }
+        xSemaphoreGive(sd_file_mutex);
+        return false;
+    }
+    char path[SD_QUEUE_PATH_MAX];
+    strcpy(path, sd_queue_paths[0]);
+    sd_queue_len--;
+    memmove(sd_queue_paths[0], sd_queue_paths[1], sd_queue_len * SD_QUEUE_PATH_MAX);
+    int32_t chunk_len = sd_next_chunk_len;
+    myFile.close();
+    myFile       = sd_next_file;
+    sd_next_file = File();
+    sd_compiled  = sd_next_compiled;
+    sd_reader_reset(sd_compiled ? sizeof(sd_compiled_header_t) : 0);
+    sd_chunk_len = chunk_len;  // Already read by sd_queue_prefetch()
+    sd_job_attach();
+    xSemaphoreGive(sd_file_mutex);
+    sd_replay_drop();
+    validate_eta_unload();
+    validate_eta_load(SD, path);
+    sd_current_line_number = 0;
+    xTaskNotifyGive(sd_reader_task_handle);
+    return true;
+}
+
+/*
+  Job info: path.idx next to path holds an sd_job_info_t, written the first time the info is
+  asked for and reused for as long as the source keeps its size and modification time. The
+  scan follows the modal state of the file (G0-G3, G90/G91, G20/G21, F) but does not expand
+  arcs, so arc bulges outside their end points are not in the box and the time is a lower bound.
+*/
+const uint32_t SD_JOB_INFO_MAGIC = 0x31584449;  // "IDX1"
+
+typedef struct {
+    uint16_t* pixels;
+    uint16_t  size;
+    uint16_t  color;
+    float     x_min, y_max;  // Job coordinates at the top left pixel
+    float     scale;         // Pixels per mm
+    int       offset_x, offset_y;
+} sd_preview_t;
+
+static void sd_preview_point(sd_preview_t* preview, float x, float y, int* px, int* py) {
+    *px = preview->offset_x + (int)((x - preview->x_min) * preview->scale);
+    *py = preview->offset_y + (int)((preview->y_max - y) * preview->scale);
+}
+
+static void sd_preview_line(sd_preview_t* preview, float x0, float y0, float x1, float y1) {
+    int px0, py0, px1, py1;
+    sd_preview_point(preview, x0, y0, &px0, &py0);
+    sd_preview_point(preview, x1, y1, &px1, &py1);
+    int dx = abs(px1 - px0), sx = px0 < px1 ? 1 : -1;
+    int dy = -abs(py1 - py0), sy = py0 < py1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        if (px0 >= 0 && px0 < preview->size && py0 >= 0 && py0 < preview->size) {
+            preview->pixels[py0 * preview->size + px0] = preview->color;
+        }
+        if (px0 == px1 && py0 == py1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            px0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            py0 += sy;
+        }
+    }
+}
+
+typedef struct {
+    sd_job_info_t* info;
+    uint8_t        motion;  // Last G0-G3
+    bool           absolute;
+    float          scale;  // mm per program unit
+    float          x, y;
+    float          feed;  // mm/min
+    float          rapid_rate;
+    float          minutes;
+    float          box[4];  // x_min, x_max, y_min, y_max of the cutting moves
+    bool           have_box;
+    bool           have_bounds;
+    sd_preview_t*  preview;  // Also draws the cutting moves, see sd_get_job_preview()
+} sd_job_scan_t;
+
+static void sd_job_box_add(sd_job_scan_t* scan, float x, float y) {
+    float* box = scan->box;
+    if (!scan->have_box) {
+        box[0] = box[1] = x;
+        box[2] = box[3] = y;
+        scan->have_box  = true;
+        return;
+    }
+    box[0] = MIN(box[0], x);
+    box[1] = MAX(box[1], x);
+    box[2] = MIN(box[2], y);
+    box[3] = MAX(box[3], y);
+}
+
+// LightBurn puts the job extents in a header comment, e.g. "; Bounds: X10 Y20 to X110 Y70"
+static void sd_job_parse_bounds(sd_job_scan_t* scan, const char* comment) {
+    float   value[4];
+    uint8_t n_x = 0, n_y = 0;
+    for (const char* p = comment; *p; p++) {
+        if (*p == 'X' && n_x < 2) {
+            value[n_x++] = strtof(p + 1, NULL);
+        } else if (*p == 'Y' && n_y < 2) {
+            value[2 + n_y++] = strtof(p + 1, NULL);
+        }
+    }
+    if (n_x == 2 && n_y == 2) {
+        scan->info->x_min = value[0];
+        scan->info->x_max = value[1];
+        scan->info->y_min = value[2];
+        scan->info->y_max = value[3];
+        scan->have_bounds = true;
+    }
+}
+
+static void sd_job_scan_handler(char* line, int len, void* arg) {
+    sd_job_scan_t* scan = (sd_job_scan_t*)arg;
+    sd_job_info_t* info = scan->info;
+    line[len]           = '\0';
+    if (info->lines < 10 && !scan->have_bounds) {
+        char* bounds = strstr(line, "Bounds");
+        if (bounds) {
+            sd_job_parse_bounds(scan, bounds);
+        }
+    }
+    // Comments are dropped here, not by collapseGCode(), so that messages in them are not reported
+    char* comment = strpbrk(line, "(;");
+    if (comment) {
+        *comment = '\0';
+    }
+    collapseGCode(line);
+    if (!line[0] || line[0] == '$' || line[0] == '[') {
+        return;
+    }
+    gc_word_t words[GC_MAX_WORDS];
+    uint8_t   n_words;
+    if (gc_parse_words(line, words, GC_MAX_WORDS, &n_words) != Error::Ok) {
+        return;
+    }
+    float x = scan->x, y = scan->y;
+    bool  moved = false, non_modal = false;
+    // Word order within a line does not matter to g-code, so the modes are settled first
+    for (int i = 0; i < n_words; i++) {
+        int code = (int)words[i].value;
+        switch (words[i].letter) {
+            case 'G':
+                if (code <= 3) {
+                    scan->motion = code;
+                } else if (code == 90 || code == 91) {
+                    scan->absolute = code == 90;
+                } else if (code == 20 || code == 21) {
+                    scan->scale = code == 20 ? MM_PER_INCH : 1.0;
+                } else if (code == 28 || code == 30 || code == 53 || code == 92) {
+                    non_modal = true;  // Axis words here are not a move in the program's frame
+                }
+                break;
+            case 'S': info->s_max = MAX(info->s_max, words[i].value); break;
+        }
+    }
+    for (int i = 0; i < n_words; i++) {
+        float value = words[i].value * scan->scale;
+        switch (words[i].letter) {
+            case 'X':
+                x     = scan->absolute ? value : x + value;
+                moved = true;
+                break;
+            case 'Y':
+                y     = scan->absolute ? value : y + value;
+                moved = true;
+                break;
+            case 'F': scan->feed = value; break;
+        }
+    }
+    if (!moved || non_modal) {
+        return;
+    }
+    float distance = hypot_f(x - scan->x, y - scan->y);
+    if (scan->motion == 0) {
+        scan->minutes += distance / scan->rapid_rate;
+    } else {
+        if (scan->feed > 0) {
+            scan->minutes += distance / scan->feed;
+        }
+        // The box covers where the tool works, so rapids only count as the start of a cut
+        sd_job_box_add(scan, scan->x, scan->y);
+        sd_job_box_add(scan, x, y);
+        if (scan->preview) {
+            sd_preview_line(scan->preview, scan->x, scan->y, x, y);
+        }
+    }
+    scan->x = x;
+    scan->y = y;
+}
+
+Error sd_get_job_info(fs::FS& fs, const char* path, sd_job_info_t* info, sd_progress_t progress) {
+    File source = fs.open(path);
+    if (!source) {
+        return Error::FsFileNotFound;
+    }
+    uint32_t source_size  = source.size();
+    uint32_t source_mtime = source.getLastWrite();
+    String   idx_path     = String(path) + ".idx";
+    File     idx          = fs.open(idx_path.c_str());
+    if (idx) {
+        bool valid = idx.read((uint8_t*)info, sizeof(*info)) == sizeof(*info) && info->magic == SD_JOB_INFO_MAGIC &&
+                     info->source_size == source_size && info->source_mtime == source_mtime;
+        idx.close();
+        if (valid) {
+            source.close();
+            return Error::Ok;
+        }
+    }
+
+    memset(info, 0, sizeof(*info));
+    sd_job_scan_t scan = {};
+    scan.info          = info;
+    scan.absolute      = true;
+    scan.scale         = 1.0;
+    scan.rapid_rate    = MIN(axis_settings[X_AXIS]->max_rate->get(), axis_settings[Y_AXIS]->max_rate->get());
+    Error status       = sd_for_each_line(source, sd_job_scan_handler, &scan, &info->lines, NULL, progress);
+    source.close();
+    if (status != Error::Ok) {
+        return status;
+    }
+    info->magic        = SD_JOB_INFO_MAGIC;
+    info->source_size  = source_size;
+    info->source_mtime = source_mtime;
+    info->seconds      = scan.minutes * 60.0f;
+    if (!scan.have_bounds && scan.have_box) {
+        info->x_min = scan.box[0];
+        info->x_max = scan.box[1];
+        info->y_min = scan.box[2];
+        info->y_max = scan.box[3];
+    }
+    // A card that cannot take the index still gets the info, it is just scanned again next time
+    idx = fs.open(idx_path.c_str(), FILE_WRITE);
+    if (idx) {
+        if (idx.write((uint8_t*)info, sizeof(*info)) != sizeof(*info)) {
+            idx.close();
+            fs.remove(idx_path.c_str());
+        } else {
+            idx.close();
+        }
+    }
+    return Error::Ok;
+}
+
+/*
+  Job preview: path.pvw next to path holds an sd_preview_header_t and the thumbnail, reused for
+  as long as the source keeps its size and modification time and the colors stay the same. The
+  cutting moves are drawn as straight lines between their end points, fitted into the extents
+  from sd_get_job_info(), so a file without a job summary is read twice.
+*/
+const uint32_t SD_PREVIEW_MAGIC = 0x31575650;  // "PVW1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t source_size;
+    uint32_t source_mtime;
+    uint16_t size;
+    uint16_t color;
+    uint16_t background;
+    uint16_t reserved;
+} sd_preview_header_t;
+
+Error sd_get_job_preview(fs::FS& fs, const char* path, uint16_t* pixels, uint16_t size, uint16_t color, uint16_t background, sd_progress_t progress) {
+    File source = fs.open(path);
+    if (!source) {
+        return Error::FsFileNotFound;
+    }
+    uint32_t            n_pixels = size * size;
+    sd_preview_header_t header   = { SD_PREVIEW_MAGIC, (uint32_t)source.size(), (uint32_t)source.getLastWrite(), size, color, background, 0 };
+    String              pvw_path = String(path) + ".pvw";
+    File                pvw      = fs.open(pvw_path.c_str());
+    if (pvw) {
+        sd_preview_header_t cached;
+        bool valid = pvw.read((uint8_t*)&cached, sizeof(cached)) == sizeof(cached) && memcmp(&cached, &header, sizeof(header)) == 0 &&
+                     pvw.read((uint8_t*)pixels, n_pixels * sizeof(uint16_t)) == n_pixels * sizeof(uint16_t);
+        pvw.close();
+        if (valid) {
+            source.close();
+            return Error::Ok;
+        }
+    }
+    source.close();
+
+    sd_job_info_t info;
+    Error         status = sd_get_job_info(fs, path, &info, progress);
+    if (status != Error::Ok) {
+        return status;
+    }
+    for (uint32_t i = 0; i < n_pixels; i++) {
+        pixels[i] = background;
+    }
+    float        width   = info.x_max - info.x_min;
+    float        height  = info.y_max - info.y_min;
+    float        extent  = MAX(width, height);
+    sd_preview_t preview = { pixels, size, color, info.x_min, info.y_max, 1.0f, 0, 0 };
+    if (extent > 0) {
+        preview.scale    = (size - 1) / extent;
+        preview.offset_x = (int)((size - 1) - width * preview.scale) / 2;
+        preview.offset_y = (int)((size - 1) - height * preview.scale) / 2;
+
+        source = fs.open(path);
+        if (!source) {
+            return Error::FsFileNotFound;
+        }
+        sd_job_info_t unused = {};
+        sd_job_scan_t scan   = {};
+        scan.info            = &unused;
+        scan.absolute        = true;
+        scan.scale           = 1.0;
+        scan.rapid_rate      = 1.0;
+        scan.preview         = &preview;
+        status               = sd_for_each_line(source, sd_job_scan_handler, &scan, &unused.lines, NULL, progress);
+        source.close();
+        if (status != Error::Ok) {
+            return status;
+        }
+    }
+    // As for the job info, a card that cannot take the preview gets it drawn again next time
+    pvw = fs.open(pvw_path.c_str(), FILE_WRITE);
+    if (pvw) {
+        bool written = pvw.write((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                       pvw.write((uint8_t*)pixels, n_pixels * sizeof(uint16_t)) == n_pixels * sizeof(uint16_t);
+        pvw.close();
+        if (!written) {
+            fs.remove(pvw_path.c_str());
+        }
+    }
+    return Error::Ok;
+}
+
+// Reads path end to end the way a job is read, to measure what the card really delivers
+Error sd_bench(fs::FS& fs, const char* path, uint32_t* n_bytes, uint32_t* n_ms) {
+    *n_bytes    = 0;
+    *n_ms       = 0;
+    File source = fs.open(path);
+    if (!source) {
+        return Error::FsFileNotFound;
+    }
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(SD_READ_CHUNK_SIZE, MALLOC_CAP_DMA);
+    if (!buf) {
+        source.close();
+        return Error::Overflow;
+    }
+    Error    status = Error::Ok;
+    uint32_t start  = millis();
+    int32_t  n;
+    while ((n = sd_read_aligned(source, buf, SD_READ_CHUNK_SIZE)) > 0) {
+        *n_bytes += n;
+    }
+    *n_ms = millis() - start;
+    if (n < 0) {
+        status = Error::FsFailedRead;
+    }
+    free(buf);
+    source.close();
+    return status;
+}
+
 bool sd_file_check(const char* path) {
 
     if(!myFile)  return false;
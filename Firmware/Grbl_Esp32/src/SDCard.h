@@ -23,6 +23,29 @@
 //#define SDCARD_DET_PIN -1
 const int SDCARD_DET_VAL = 0;  // for now, CD is close to ground
 
+// Job files are read in blocks of this size by a task on SD_READER_TASK_CORE, which keeps
+// up to $SD/ReadAhead lines queued for the main loop
+#ifndef SD_READ_CHUNK_SIZE
+#    define SD_READ_CHUNK_SIZE 8192
+#endif
+#ifndef SD_READER_TASK_CORE
+#    define SD_READER_TASK_CORE 0
+#endif
+const int SD_MAX_LINE_LENGTH = 255;  // Longer lines end the job, as they always have
+
+// Passes after the first of a multi-pass job replay from a copy in RAM, unless the copy would
+// leave less than this much heap free
+#ifndef SD_REPLAY_HEAP_RESERVE
+#    define SD_REPLAY_HEAP_RESERVE 40000
+#endif
+
+// Reads are kept on sector boundaries so the card driver moves whole sectors straight into the
+// chunk with multi-block reads. A failed read remounts the card at half the SPI clock, down to
+// SD_SPI_FREQ_MIN kHz, and retries up to SD_READ_RETRIES times.
+const uint32_t SD_SECTOR_SIZE  = 512;
+const uint32_t SD_SPI_FREQ_MIN = 4000;
+const int      SD_READ_RETRIES = 3;
+
 enum class SDState : uint8_t {
     Idle          = 0,
     NotPresent    = 1,
@@ -47,17 +70,105 @@ void     listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client
 boolean  openFile(fs::FS& fs, const char* path);
 boolean  closeFile();
 boolean  readFileLine(char* line, int len);
+char*    readFileLinePtr();
+
+// One step of an SD job: a text line, or a line pre-parsed into words by sd_compile_file()
+typedef struct {
+    char*            line;  // NULL for a compiled record
+    const gc_word_t* words;
+    uint8_t          n_words;
+} sd_block_t;
+
+boolean readFileBlock(sd_block_t* block);
+// Has the reader task split the job's plain g-code lines into words as it reads ahead, so
+// splitting overlaps execution and planning on the other core. Those lines come back from
+// readFileLinePtr() as NULL, so this is only for jobs run through readFileBlock().
+// Cleared by openFile().
+void    sd_preparse_enable();
+Error   sd_execute_block(sd_block_t* block, uint8_t client, WebUI::AuthenticationLevel auth_level);
+
+// Compiled jobs: path.bin holds the file as pre-parsed words, so repeat runs skip the text parser
+Error   sd_compile_file(fs::FS& fs, const char* path, uint32_t* n_lines, uint32_t* n_compiled);
+boolean sd_use_compiled(fs::FS& fs);  // Switch the open job to path.bin if it matches the source
+
+// Job summary, cached in path.idx and rebuilt when the source size or modification time changes
+typedef struct {
+    uint32_t magic;
+    uint32_t source_size;
+    uint32_t source_mtime;
+    float    x_min, x_max, y_min, y_max;  // Extents of the cutting moves, or of a LightBurn Bounds comment
+    uint32_t lines;
+    uint32_t seconds;  // At the programmed feeds, without acceleration
+    float    s_max;
+} sd_job_info_t;
+
+// Called as a scan goes through the file; returning false stops it with Error::Cancelled
+typedef bool (*sd_progress_t)(uint32_t pos, uint32_t size);
+
+Error sd_get_job_info(fs::FS& fs, const char* path, sd_job_info_t* info, sd_progress_t progress = NULL);
+
+// Hands each line of source to handler, split the same way the job reader splits it, and counts
+// them in *n_lines. Folds the bytes into *hash and reports to progress when those are not NULL.
+// The line is not terminated; handler may write line[len].
+typedef void (*sd_line_handler_t)(char* line, int len, void* arg);
+
+Error sd_for_each_line(File& source, sd_line_handler_t handler, void* arg, uint32_t* n_lines, uint32_t* hash, sd_progress_t progress);
+
+// size x size thumbnail of the cutting moves in XY, in the given RGB565 colors, cached in path.pvw
+Error sd_get_job_preview(fs::FS&       fs,
+                         const char*   path,
+                         uint16_t*     pixels,
+                         uint16_t      size,
+                         uint16_t      color,
+                         uint16_t      background,
+                         sd_progress_t progress = NULL);
+
+uint32_t sd_get_spi_freq();  // kHz the card is currently mounted at
+// Changes with every mount, so a file kept open between uses knows its handle is gone
+uint32_t sd_mount_generation();
+Error    sd_bench(fs::FS& fs, const char* path, uint32_t* n_bytes, uint32_t* n_ms);
 void     readFile(fs::FS& fs, const char* path);
 float    sd_report_perc_complete();
+int32_t  sd_report_remaining_seconds();  // Of the job by its time estimate, -1 without one
 uint32_t sd_get_current_line_number();
+// Offset in the job file just after the last line read, false without a job or for a compiled one
+bool     sd_get_resume_pos(uint32_t* pos);
 void     sd_get_current_filename(char* name);
 
 
 // mks fix
 void sd_set_current_line_number(uint32_t num);
 void mks_listDir(fs::FS& fs, const char* dirname, uint8_t levels); 
+
+// Job files on the card, sorted by name. Built by the first sd_index_build() after the card is
+// inserted or changed, then read from memory. Anything that adds or removes files on the card
+// calls sd_index_invalidate().
+bool        sd_index_build(fs::FS& fs, const char* dirname, uint8_t levels);  // False if the card can not be scanned
+bool        sd_index_valid();
+void        sd_index_invalidate();
+uint32_t    sd_index_generation();  // Changes with every sd_index_invalidate(), for listings kept elsewhere
+uint16_t    sd_index_count();
+const char* sd_index_get(uint16_t i, uint32_t* size);  // NULL past the end
 bool sd_serch_x_y(char *str);
 bool sd_file_check(const char* path);
+bool sd_file_is_gz(File& file);  // From its magic; leaves the file at 0. Jobs read these inflated
 boolean readFileBuff(uint8_t *buf, uint32_t size);
 boolean setFilePos(uint32_t pos);
+// Back to the start of the job for its next pass, from RAM when the first pass was kept
+boolean sd_rewind();
+// True while a job's read-ahead queue is less than half full, so other readers of the card wait
+bool    sd_reader_wants_card();
+
+// Files to run after the current job, in order, with the card kept mounted in between. The
+// reader task opens the next one and reads its first block while the current job finishes.
+// closeFile() empties the queue, so a stopped job does not start the next one.
+const int SD_QUEUE_MAX      = 8;
+const int SD_QUEUE_PATH_MAX = 128;
+
+bool    sd_queue_add(const char* path);  // False if the queue is full or the path too long
+void    sd_queue_clear();
+uint8_t sd_queue_count();
+bool    sd_queue_get(uint8_t i, char* path);  // path holds SD_QUEUE_PATH_MAX, false past the end
+// At the end of a job: switches to the next queued file, false if there is none or the job failed
+boolean sd_queue_start_next();
 
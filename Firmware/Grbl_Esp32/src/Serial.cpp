@@ -56,6 +56,8 @@
 */
 
 #include "Grbl.h"
+#include <atomic>
+#include <esp_heap_caps.h>
 // #include "mks/lcd_serial.h"
 
 // Define this to use the Arduino serial (UART) driver instead
@@ -64,19 +66,118 @@
 // testing is complete.
 // #define REVERT_TO_ARDUINO_SERIAL
 
-portMUX_TYPE myMutex = portMUX_INITIALIZER_UNLOCKED;
-
 static TaskHandle_t clientCheckTaskHandle = 0;
 
-WebUI::InputBuffer client_buffer[CLIENT_COUNT];  // create a buffer for each client
+// Line input of one client, from clientCheckTask to the protocol loop. There is exactly one
+// producer and one consumer, so the ring is lock free and ingress never masks interrupts.
+// The indices run free and wrap with uint16_t, which the power-of-two size divides.
+class ClientRing {
+public:
+    static const int SIZE = 512;
+
+    // Producer side. Stores as much of data as fits and returns the count stored.
+    size_t write(const uint8_t* data, size_t length) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        size_t   room = SIZE - uint16_t(head - _tail.load(std::memory_order_acquire));
+        if (length > room) {
+            length = room;
+        }
+        for (size_t i = 0; i < length; i++) {
+            _data[uint16_t(head + i) % SIZE] = data[i];
+        }
+        _head.store(head + length, std::memory_order_release);
+        return length;
+    }
+    int availableforwrite() { return SIZE - available(); }
+
+    // Consumer side
+    int read() {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail) {
+            return -1;
+        }
+        int data = _data[tail % SIZE];
+        _tail.store(tail + 1, std::memory_order_release);
+        return data;
+    }
+    // Bytes readable in one piece, up to the wrap of the storage, without consuming them
+    size_t peek(const uint8_t** data) {
+        uint16_t tail   = _tail.load(std::memory_order_relaxed);
+        size_t   length = uint16_t(_head.load(std::memory_order_acquire) - tail);
+        size_t   offset = tail % SIZE;
+        *data           = &_data[offset];
+        return length < SIZE - offset ? length : SIZE - offset;
+    }
+    void consume(size_t length) { _tail.store(_tail.load(std::memory_order_relaxed) + length, std::memory_order_release); }
+    void discard() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+    int available() { return uint16_t(_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)); }
+
+private:
+    static_assert((SIZE & (SIZE - 1)) == 0, "ClientRing::SIZE must be a power of two");
+
+    uint8_t               _data[SIZE];
+    std::atomic<uint16_t> _head;
+    std::atomic<uint16_t> _tail;
+};
+
+static ClientRing client_buffer[CLIENT_COUNT];  // create a buffer for each client
+
+// Output is copied into blocks of a fixed arena and queued per sink, and clientSendTask does
+// the writes. grbl_send() never allocates and never waits on a client, only on a free block
+// when more than the whole arena is queued. A slow sink holds back its own queue alone.
+const int OUTPUT_BLOCK_SIZE  = 124;
+const int OUTPUT_BLOCK_COUNT = 32;
+
+enum OutputSink : uint8_t {
+    SINK_SERIAL = 0,
+    SINK_BT,
+    SINK_WEBUI,
+    SINK_TELNET,
+    SINK_COUNT,
+};
+
+typedef struct {
+    std::atomic<uint8_t> refs;  // Sinks that have yet to send it
+    uint8_t              length;
+    char                 data[OUTPUT_BLOCK_SIZE];
+} output_block_t;
+
+static output_block_t    output_arena[OUTPUT_BLOCK_COUNT];
+static QueueHandle_t     output_free;               // Indices of free blocks
+static QueueHandle_t     output_queue[SINK_COUNT];  // Indices of blocks to send, per sink
+static SemaphoreHandle_t output_lock;               // Keeps the blocks of one text together
+static TaskHandle_t      clientSendTaskHandle = 0;
+
+// Lines from the firmware itself, the touchscreen above all, in a lane of their own. Each item
+// is a whole line, so several tasks can send and a streaming client can neither delay nor crowd
+// them out of a shared buffer. The protocol loop takes them ahead of the client input.
+const int INTERNAL_LINE_COUNT   = 8;
+const int INTERNAL_SEND_WAIT_MS = 50;  // For room in a full lane, before the line is dropped
+
+static QueueHandle_t internal_lines = NULL;
+
+static_assert(RX_BUFFER_SIZE <= SERIAL_RX_RING_SIZE, "RX_BUFFER_SIZE must fit in the UART RX ring");
 
 // Returns the number of bytes available in a client buffer.
-uint8_t client_get_rx_buffer_available(uint8_t client) {
+int client_get_rx_buffer_available(uint8_t client) {
+#ifdef ENABLE_BLUETOOTH
+    if (client == CLIENT_BT) {
+        int used = WebUI::SerialBT.available() + client_buffer[CLIENT_BT].available();
+        int size = BT_SPP_RX_QUEUE_SIZE + ClientRing::SIZE;
+        return used < size ? size - used : 0;
+    }
+#endif
+    if (client != CLIENT_SERIAL) {
+        return client < CLIENT_COUNT ? client_buffer[client].availableforwrite() : 0;
+    }
 #ifdef REVERT_TO_ARDUINO_SERIAL
-    return 128 - Serial.available();
+    int used = Serial.available();
 #else
-    return 128 - Uart0.available();
+    int used = Uart0.available();
 #endif
+    used += client_buffer[CLIENT_SERIAL].available();
+    return used < RX_BUFFER_SIZE ? RX_BUFFER_SIZE - used : 0;
     //    return client_buffer[client].availableforwrite();
 }
 
@@ -86,7 +187,8 @@ void heapCheckTask(void* pvParameters) {
         uint32_t newHeapSize = xPortGetFreeHeapSize();
         if (newHeapSize != heapSize) {
             heapSize = newHeapSize;
-            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "heap %d", heapSize);
+            grbl_msg_sendf(
+                CLIENT_SERIAL, MsgLevel::Info, "heap %d, largest block %d", heapSize, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
         }
         vTaskDelay(3000 / portTICK_RATE_MS);  // Yield to other tasks
 
@@ -109,12 +211,29 @@ void client_init() {
     Serial.write("\r\n");  // create some white space after ESP32 boot info
 #else
     Uart0.setPins(1, 3);  // Tx 1, Rx 3 - standard hardware pins
-    Uart0.begin(BAUD_RATE, Uart::Data::Bits8, Uart::Stop::Bits1, Uart::Parity::None);
+    Uart0.begin(BAUD_RATE, Uart::Data::Bits8, Uart::Stop::Bits1, Uart::Parity::None, SERIAL_RX_RING_SIZE);
 
     client_reset_read_buffer(CLIENT_ALL);
     // Uart0.write("\r\n");  // create some white space after ESP32 boot info
     Uart0.write("\n");  // create some white space after ESP32 boot info
 #endif
+    output_free = xQueueCreate(OUTPUT_BLOCK_COUNT, sizeof(uint8_t));
+    for (uint8_t i = 0; i < OUTPUT_BLOCK_COUNT; i++) {
+        xQueueSend(output_free, &i, 0);
+    }
+    for (int sink = 0; sink < SINK_COUNT; sink++) {
+        output_queue[sink] = xQueueCreate(OUTPUT_BLOCK_COUNT, sizeof(uint8_t));
+    }
+    output_lock    = xSemaphoreCreateMutex();
+    internal_lines = xQueueCreate(INTERNAL_LINE_COUNT, LINE_BUFFER_SIZE);
+    xTaskCreatePinnedToCore(clientSendTask,    // task
+                            "clientSendTask",  // name for task
+                            4096,              // size of task stack
+                            NULL,              // parameters
+                            2,                 // priority, below the input task
+                            &clientSendTaskHandle,
+                            CLIENT_TASK_CORE);
+
     clientCheckTaskHandle = 0;
     // create a task to check for incoming data
     // For a 4096-word stack, uxTaskGetStackHighWaterMark reports 244 words available
@@ -125,34 +244,46 @@ void client_init() {
                             NULL,               // parameters
                             3,                  // priority
                             &clientCheckTaskHandle,
-                            SUPPORT_TASK_CORE  // must run the task on same core
-                                               // core
-    );
+                            CLIENT_TASK_CORE);
 }
 
-static uint8_t getClientChar(uint8_t* data) {
-    int res;
+// The port comes up at BAUD_RATE, so boot messages match the ESP32 boot text, and only then
+// moves to the configured rate
+void client_apply_settings() {
+    uint32_t baud = serial_baud_rate->get();
+    if (baud != BAUD_RATE) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Serial switching to %d baud", baud);
+    }
 #ifdef REVERT_TO_ARDUINO_SERIAL
-    if (client_buffer[CLIENT_SERIAL].availableforwrite() && (res = Serial.read()) != -1) {
+    if (baud != BAUD_RATE) {
+        Serial.flush();
+        Serial.updateBaudRate(baud);
+    }
 #else
-    if (client_buffer[CLIENT_SERIAL].availableforwrite() && (res = Uart0.read()) != -1) {
-#endif
-        *data = res;
-        return CLIENT_SERIAL;
+    if (baud != BAUD_RATE) {
+        Uart0.flushTxTimed(100 / portTICK_RATE_MS);
+        Uart0.setBaudRate(baud);
+    }
+    if (serial_flow_control->get()) {
+        if (SERIAL_RTS_PIN == UNDEFINED_PIN || SERIAL_CTS_PIN == UNDEFINED_PIN) {
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Warning, "Serial flow control needs SERIAL_RTS_PIN and SERIAL_CTS_PIN");
+        } else {
+            Uart0.setPins(1, 3, SERIAL_RTS_PIN, SERIAL_CTS_PIN);
+            Uart0.setFlowControl(true);
+        }
     }
+#endif
+}
+
+// Bytes read from the serial port per pass, bounded by the free space in its client buffer
+const int SERIAL_READ_CHUNK = 128;
+
+// Serial input comes in bulk, see client_receive(); the other clients are read a byte at a time
+static uint8_t getClientChar(uint8_t* data) {
     if (WebUI::inputBuffer.available()) {
         *data = WebUI::inputBuffer.read();
         return CLIENT_INPUT;
     }
-    //currently is wifi or BT but better to prepare both can be live
-#ifdef ENABLE_BLUETOOTH
-    if (WebUI::SerialBT.hasClient()) {
-        if ((res = WebUI::SerialBT.read()) != -1) {
-            *data = res;
-            return CLIENT_BT;
-        }
-    }
-#endif
 #if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
     if (WebUI::Serial2Socket.available()) {
         *data = WebUI::Serial2Socket.read();
@@ -168,28 +299,26 @@ static uint8_t getClientChar(uint8_t* data) {
     return CLIENT_ALL;
 }
 
-// this task runs and checks for data on all interfaces
-// REaltime stuff is acted upon, then characters are added to the appropriate buffer
-void clientCheckTask(void* pvParameters) {
-    uint8_t            data = 0;
-    uint8_t            client;  // who sent the data
-    static UBaseType_t uxHighWaterMark = 0;
-    while (true) {  // run continuously
-        while ((client = getClientChar(&data)) != CLIENT_ALL) {
-            // Pick off realtime command characters directly from the serial stream. These characters are
-            // not passed into the main buffer, but these set system state flag bits for realtime execution.
-            if (is_realtime_command(data)) {
-                execute_realtime_command(static_cast<Cmd>(data), client);
-            } else {
+// Routes received bytes: realtime commands are acted upon at once, in stream order, and the
+// runs of line characters between them go into the client buffer.
+static void client_receive(uint8_t client, const uint8_t* data, size_t length) {
+    if (length) {
+        TRACE_EVENT(TraceEvent::ClientRx, length);
+    }
+    size_t start = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (i < length && !is_realtime_command(data[i])) {
+            continue;
+        }
+        if (i > start) {
 #if defined(ENABLE_SD_CARD)
-                if (get_sd_state(false) < SDState::Busy) {
+            if (get_sd_state(false) < SDState::Busy) {
 #endif  //ENABLE_SD_CARD
-                    vTaskEnterCritical(&myMutex);
-                    client_buffer[client].write(data);
-                    vTaskExitCritical(&myMutex);
+                client_buffer[client].write(data + start, i - start);
 #if defined(ENABLE_SD_CARD)
-                } else {
-                    if (data == '\r' || data == '\n') {
+            } else {
+                for (size_t j = start; j < i; j++) {
+                    if (data[j] == '\r' || data[j] == '\n') {
                         grbl_sendf(client, "error %d\r\n", Error::AnotherInterfaceBusy);
                         grbl_msg_sendf(client, MsgLevel::Info, "SD card job running");
                         if(sys.state == State::Idle) {
@@ -197,10 +326,69 @@ void clientCheckTask(void* pvParameters) {
                         }
                     }
                 }
+            }
 #endif  //ENABLE_SD_CARD
+        }
+        if (i < length) {
+            // Pick off realtime command characters directly from the serial stream. These characters are
+            // not passed into the main buffer, but these set system state flag bits for realtime execution.
+            execute_realtime_command(static_cast<Cmd>(data[i]), client);
+        }
+        start = i + 1;
+    }
+    if (length) {
+        protocol_wake();
+    }
+}
+
+size_t client_realtime_filter(uint8_t client, uint8_t* data, size_t length) {
+    size_t kept = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (is_realtime_command(data[i])) {
+            execute_realtime_command(static_cast<Cmd>(data[i]), client);
+        } else {
+            data[kept++] = data[i];
+        }
+    }
+    return kept;
+}
+
+// this task runs and checks for data on all interfaces
+// REaltime stuff is acted upon, then characters are added to the appropriate buffer
+void clientCheckTask(void* pvParameters) {
+    uint8_t            data = 0;
+    uint8_t            client;  // who sent the data
+    uint8_t            serial_data[SERIAL_READ_CHUNK];
+    size_t             serial_length;
+    static UBaseType_t uxHighWaterMark = 0;
+    heap_track_task();
+    while (true) {  // run continuously
+        // Drain the serial port in chunks; its driver ring only holds a fraction of a second at speed
+        do {
+            serial_length = MIN(client_buffer[CLIENT_SERIAL].availableforwrite(), SERIAL_READ_CHUNK);
+#ifdef REVERT_TO_ARDUINO_SERIAL
+            serial_length = Serial.readBytes(serial_data, MIN(serial_length, size_t(Serial.available())));
+#else
+            serial_length = Uart0.readBytes(serial_data, serial_length, 0);
+#endif
+            client_receive(CLIENT_SERIAL, serial_data, serial_length);
+        } while (serial_length == SERIAL_READ_CHUNK);
+#ifdef ENABLE_BLUETOOTH
+        // Bluetooth the same way, as far as the SPP queue has data and the client buffer room
+        while (WebUI::SerialBT.hasClient()) {
+            serial_length = MIN(WebUI::SerialBT.available(), client_buffer[CLIENT_BT].availableforwrite());
+            serial_length = MIN(serial_length, size_t(SERIAL_READ_CHUNK));
+            if (serial_length == 0 || (serial_length = WebUI::SerialBT.readBytes(serial_data, serial_length)) == 0) {
+                break;
             }
+            client_receive(CLIENT_BT, serial_data, serial_length);
+        }
+#endif
+        while ((client = getClientChar(&data)) != CLIENT_ALL) {
+            client_receive(client, &data, 1);
         }  // if something available
         WebUI::COMMANDS::handle();
+        report_status_stream();
 #ifdef ENABLE_WIFI
         WebUI::wifi_config.handle();
 #endif
@@ -210,7 +398,17 @@ void clientCheckTask(void* pvParameters) {
 #if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
         WebUI::Serial2Socket.handle_flush();
 #endif
+#ifdef REVERT_TO_ARDUINO_SERIAL
         vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
+#else
+        // Yield to other tasks, waking early when serial data arrives. With the client buffer
+        // full, nothing could be read anyway, so just wait for the protocol loop to drain it.
+        if (client_buffer[CLIENT_SERIAL].availableforwrite()) {
+            Uart0.waitForData(1 / portTICK_RATE_MS);
+        } else {
+            vTaskDelay(1 / portTICK_RATE_MS);
+        }
+#endif
 
         static UBaseType_t uxHighWaterMark = 0;
 #ifdef DEBUG_TASK_STACK
@@ -222,17 +420,31 @@ void clientCheckTask(void* pvParameters) {
 void client_reset_read_buffer(uint8_t client) {
     for (uint8_t client_num = 0; client_num < CLIENT_COUNT; client_num++) {
         if (client == client_num || client == CLIENT_ALL) {
-            client_buffer[client_num].begin();
+            client_buffer[client_num].discard();
         }
     }
 }
 
 // Fetches the first byte in the client read buffer. Called by protocol loop.
 int client_read(uint8_t client) {
-    vTaskEnterCritical(&myMutex);
-    int data = client_buffer[client].read();
-    vTaskExitCritical(&myMutex);
-    return data;
+    return client_buffer[client].read();
+}
+
+bool client_input_pending() {
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        if (client_buffer[client].available()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t client_read_span(uint8_t client, const uint8_t** data) {
+    return client_buffer[client].peek(data);
+}
+
+void client_consume(uint8_t client, size_t length) {
+    client_buffer[client].consume(length);
 }
 
 // checks to see if a character is a realtime character
@@ -349,55 +561,236 @@ void execute_realtime_command(Cmd command, uint8_t client) {
             sys_rt_exec_accessory_override.bit.coolantMistOvrToggle = 1;
             break;
     }
+    protocol_wake();
 }
 
-void client_write(uint8_t client, const char* text) {
-    if (client == CLIENT_INPUT) {
-        return;
-    }
+void set_feed_override(Percent percent) {
+    sys_rt_f_override = MIN(MAX(percent, Percent(FeedOverride::Min)), Percent(FeedOverride::Max));
+    protocol_wake();
+}
+
+void set_rapid_override(Percent percent) {
+    sys_rt_r_override = MIN(MAX(percent, Percent(RapidOverride::ExtraLow)), Percent(RapidOverride::Default));
+    protocol_wake();
+}
+
+void set_spindle_override(Percent percent) {
+    sys_rt_s_override = MIN(MAX(percent, Percent(SpindleSpeedOverride::Min)), Percent(SpindleSpeedOverride::Max));
+    protocol_wake();
+}
+
+// Sinks that output for a client goes to, one bit per OutputSink
+static uint8_t client_sinks(uint8_t client) {
+    uint8_t sinks = 0;
 #ifdef ENABLE_BLUETOOTH
     if (WebUI::SerialBT.hasClient() && (client == CLIENT_BT || client == CLIENT_ALL)) {
-        WebUI::SerialBT.print(text);
-        //delay(10); // possible fix for dropped characters
+        sinks |= bit(SINK_BT);
     }
 #endif
 #if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
     if (client == CLIENT_WEBUI || client == CLIENT_ALL) {
-        WebUI::Serial2Socket.write((const uint8_t*)text, strlen(text));
+        sinks |= bit(SINK_WEBUI);
     }
 #endif
 #if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
     if (client == CLIENT_TELNET || client == CLIENT_ALL) {
-        WebUI::telnet_server.write((const uint8_t*)text, strlen(text));
+        sinks |= bit(SINK_TELNET);
     }
 #endif
     if (client == CLIENT_SERIAL || client == CLIENT_ALL || client == CLIENT_LCD) {
+        sinks |= bit(SINK_SERIAL);
+    }
+    return sinks;
+}
+
+static void sink_write(uint8_t sink, const char* data, size_t length) {
+    switch (sink) {
+#ifdef ENABLE_BLUETOOTH
+        case SINK_BT:
+            WebUI::SerialBT.write((const uint8_t*)data, length);
+            break;
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+        case SINK_WEBUI:
+            WebUI::Serial2Socket.write((const uint8_t*)data, length);
+            break;
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
+        case SINK_TELNET:
+            WebUI::telnet_server.write((const uint8_t*)data, length);
+            break;
+#endif
+        case SINK_SERIAL:
 #ifdef REVERT_TO_ARDUINO_SERIAL
-        Serial.write(text);
+            Serial.write((const uint8_t*)data, length);
 #else
-        Uart0.write(text);
+            Uart0.write(data, length);
 #endif
+            break;
+    }
+}
+
+// Sends the queued output, a block per sink in turn so each sink keeps its own pace
+void clientSendTask(void* pvParameters) {
+    heap_track_task();
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool sent;
+        do {
+            sent = false;
+            for (uint8_t sink = 0; sink < SINK_COUNT; sink++) {
+                uint8_t index;
+                if (xQueueReceive(output_queue[sink], &index, 0) != pdTRUE) {
+                    continue;
+                }
+                output_block_t* block = &output_arena[index];
+                sink_write(sink, block->data, block->length);
+                if (--block->refs == 0) {
+                    xQueueSend(output_free, &index, 0);
+                }
+                sent = true;
+            }
+        } while (sent);
     }
 }
 
+void client_write(uint8_t client, const char* text) {
+    if (client == CLIENT_INPUT) {
+        return;
+    }
+    uint8_t sinks  = client_sinks(client);
+    size_t  length = strlen(text);
+    if (sinks == 0 || length == 0) {
+        return;
+    }
+    if (clientSendTaskHandle == 0 || xTaskGetCurrentTaskHandle() == clientSendTaskHandle) {
+        // Not started yet, or output from within a write, which must not wait on itself
+        for (uint8_t sink = 0; sink < SINK_COUNT; sink++) {
+            if (bit_istrue(sinks, bit(sink))) {
+                sink_write(sink, text, length);
+            }
+        }
+        return;
+    }
+    uint8_t refs = 0;
+    for (uint8_t sink = 0; sink < SINK_COUNT; sink++) {
+        refs += bit_istrue(sinks, bit(sink));
+    }
+    xSemaphoreTake(output_lock, portMAX_DELAY);
+    while (length > 0) {
+        uint8_t index;
+        xQueueReceive(output_free, &index, portMAX_DELAY);
+        output_block_t* block = &output_arena[index];
+        block->length         = MIN(length, size_t(OUTPUT_BLOCK_SIZE));
+        memcpy(block->data, text, block->length);
+        block->refs = refs;
+        text += block->length;
+        length -= block->length;
+        // The queues hold every block of the arena, so these never wait
+        for (uint8_t sink = 0; sink < SINK_COUNT; sink++) {
+            if (bit_istrue(sinks, bit(sink))) {
+                xQueueSend(output_queue[sink], &index, portMAX_DELAY);
+            }
+        }
+        xTaskNotifyGive(clientSendTaskHandle);
+    }
+    xSemaphoreGive(output_lock);
+}
+
+bool client_flush_output(TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+    while (clientSendTaskHandle != 0 && uxQueueMessagesWaiting(output_free) < OUTPUT_BLOCK_COUNT) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
 
-void serila_write_into_buffer(uint8_t *data) {
 
-    WebUI::inputBuffer.push((const char *)data);
+static bool internal_line_send(const char* line) {
+    if (xQueueSend(internal_lines, line, pdMS_TO_TICKS(INTERNAL_SEND_WAIT_MS)) != pdTRUE) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Warning, "Internal command dropped: %s", line);
+        return false;
+    }
+    return true;
+}
+
+bool internal_command_send(const char* text) {
+    if (internal_lines == NULL) {
+        return false;
+    }
+    char   line[LINE_BUFFER_SIZE];
+    size_t len = 0;
+    bool   ok  = true;
+    for (; *text; text++) {
+        uint8_t c = *text;
+        if (is_realtime_command(c)) {
+            execute_realtime_command(static_cast<Cmd>(c), CLIENT_INPUT);
+        } else if (c == '\r' || c == '\n') {
+            if (len) {
+                line[len] = '\0';
+                ok        = internal_line_send(line) && ok;
+                len       = 0;
+            }
+        } else if (len < LINE_BUFFER_SIZE - 1) {
+            line[len++] = c;
+        }
+    }
+    if (len) {  // A last line without its end, which the callers leave out at times
+        line[len] = '\0';
+        ok        = internal_line_send(line) && ok;
+    }
+    protocol_wake();
+    return ok;
+}
+
+// Commands that only touch settings and reports, not the parser or the planner. Jogs, homing
+// and SD jobs are left in order with the rest.
+static bool internal_command_immediate(const char* line) {
+    if (line[0] != '$') {
+        return false;
+    }
+    char c = toupper(line[1]);
+    return c != 'J' && c != 'H' && strncasecmp(line + 1, "SD", 2) != 0;
+}
+
+bool internal_command_take(char* line, bool immediate_only) {
+    if (internal_lines == NULL) {
+        return false;
+    }
+    // The protocol loop is the only reader, so the line peeked at is the one received
+    if (immediate_only && (xQueuePeek(internal_lines, line, 0) != pdTRUE || !internal_command_immediate(line))) {
+        return false;
+    }
+    return xQueueReceive(internal_lines, line, 0) == pdTRUE;
+}
+
+bool internal_command_pending() {
+    return internal_lines != NULL && uxQueueMessagesWaiting(internal_lines) != 0;
+}
+
+void serila_write_into_buffer(uint8_t *data) {
+    internal_command_send((const char *)data);
 }
 
+// These come from the display task. clientCheckTask is the only writer of the serial ring, so
+// they go to the LCD client, whose responses are also sent to the serial port.
 void serial_web_input_into_buffer(uint8_t *data) { 
 
     uint16_t k=0;
     do{
-        client_buffer[CLIENT_SERIAL].write(data[k]);
         k++;
     }while((data[k] != '\0') && k != 255);
+    client_buffer[CLIENT_LCD].write(data, k);
+    protocol_wake();
     // client_write(CLIENT_SERIAL, (char *)data);
 }
 
 void serial_web_input_into_hex(uint8_t c) { 
-    client_buffer[CLIENT_SERIAL].write(c);
+    client_buffer[CLIENT_LCD].write(&c, 1);
+    protocol_wake();
 
     // client_write(CLIENT_SERIAL, (char *)&c);
 }
@@ -22,8 +22,19 @@
 
 #include "stdint.h"
 
+// Size of the UART driver RX ring for the serial client, about 45 ms of input at 921600 baud
+#ifndef SERIAL_RX_RING_SIZE
+#    define SERIAL_RX_RING_SIZE 4096
+#endif
+// Serial RX capacity reported in Bf: for senders that use character counting. Input is held in
+// the UART ring and then the client buffer, so this must not exceed the ring.
 #ifndef RX_BUFFER_SIZE
-#    define RX_BUFFER_SIZE 256
+#    define RX_BUFFER_SIZE 1024
+#endif
+// Receive queue of the BluetoothSerial library, RX_QUEUE_SIZE in the prebuilt framework. It is
+// counted with the client buffer in the Bf: a Bluetooth client gets.
+#ifndef BT_SPP_RX_QUEUE_SIZE
+#    define BT_SPP_RX_QUEUE_SIZE 512
 #endif
 #ifndef TX_BUFFER_SIZE
 #    ifdef USE_LINE_NUMBERS
@@ -36,23 +47,57 @@
 // a task to read for incoming data from serial port
 void clientCheckTask(void* pvParameters);
 
+// a task to send queued output to the clients
+void clientSendTask(void* pvParameters);
+
+// Queues text for a client and returns without waiting for it to be sent
 void client_write(uint8_t client, const char* text);
 
+// Waits, for at most timeout, until all queued output has been sent. Returns false on timeout.
+bool client_flush_output(TickType_t timeout);
+
 // Fetches the first byte in the serial read buffer. Called by main program.
 int client_read(uint8_t client);
 
+// Points data at the bytes that can be read from the client in one piece and returns their
+// count, 0 when nothing is waiting. They stay in the buffer until client_consume().
+size_t client_read_span(uint8_t client, const uint8_t** data);
+void   client_consume(uint8_t client, size_t length);
+
+// True if any client has line input waiting
+bool client_input_pending();
+
 // See if the character is an action command like feedhold or jogging. If so, do the action and return true
 uint8_t check_action_command(uint8_t data);
 
 void client_init();
+// Applies $Serial/Baud and $Serial/FlowControl, once the settings are loaded
+void client_apply_settings();
 void client_reset_read_buffer(uint8_t client);
 
 // Returns the number of bytes available in the RX serial buffer.
-uint8_t client_get_rx_buffer_available(uint8_t client);
+int client_get_rx_buffer_available(uint8_t client);
 
 void execute_realtime_command(Cmd command, uint8_t client);
+// Runs the realtime commands in data as it arrives and removes them from it, so input that is
+// buffered before clientCheckTask reads it does not hold them back. Returns the length left.
+size_t client_realtime_filter(uint8_t client, uint8_t* data, size_t length);
 bool is_realtime_command(uint8_t data);
 
+// Set an override to a percentage, clamped like the realtime commands, for the firmware's own UI
+void set_feed_override(Percent percent);
+void set_rapid_override(Percent percent);
+void set_spindle_override(Percent percent);
+
+// The lane of the firmware's own commands, separate from the client input. Realtime commands
+// in text are acted upon at once and its lines queued, each run as from CLIENT_INPUT. Returns
+// false if a line was dropped, the lane staying full for INTERNAL_SEND_WAIT_MS.
+bool internal_command_send(const char* text);
+// Takes the next line into line, LINE_BUFFER_SIZE long. With immediate_only, only a settings or
+// report command, which may run while the protocol loop waits on motion.
+bool internal_command_take(char* line, bool immediate_only);
+bool internal_command_pending();
+
 // mks
 void serila_write_into_buffer(uint8_t *data);
 void serial_web_input_into_buffer(uint8_t *data);
\ No newline at end of file
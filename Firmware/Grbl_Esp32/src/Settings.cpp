@@ -1,6 +1,8 @@
 #include "Grbl.h"
 #include "WebUI/JSONEncoder.h"
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <nvs.h>
 
 bool anyState() {
@@ -15,6 +17,9 @@ bool idleOrAlarm() {
 bool notCycleOrHold() {
     return sys.state == State::Cycle && sys.state == State::Hold;
 }
+bool idleCycleOrHold() {
+    return sys.state != State::Idle && sys.state != State::Cycle && sys.state != State::Hold;
+}
 
 Word::Word(type_t type, permissions_t permissions, const char* description, const char* grblName, const char* fullName) :
     _description(description), _grblName(grblName), _fullName(fullName), _type(type), _permissions(permissions) {}
@@ -55,13 +60,395 @@ Setting::Setting(
     }
 }
 
+// The image is a header followed by one record per setting, in list order. A record is a tag
+// and, unless the setting was not found in the store, its value.
+const char*    SETTINGS_IMAGE_KEY     = "SettingsImage";
+const uint32_t SETTINGS_IMAGE_MAGIC   = 0x49425247;  // "GRBI"
+const uint16_t SETTINGS_IMAGE_VERSION = 1;           // Bump when the record format changes
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;   // Settings in the list
+    uint32_t layout;  // Hash of the key names in list order, so a new or moved setting is noticed
+} settings_image_header_t;
+
+enum class ImageTag : uint8_t {
+    Absent = 0,
+    Int32,
+    Int8,
+    String,  // uint16_t length including the terminating NUL, then the characters
+};
+
+enum class ImageMode : uint8_t {
+    Off,     // load() reads the store
+    Read,    // load() reads the image
+    Record,  // load() reads the store and appends what it found to the image
+};
+
+static ImageMode            image_mode = ImageMode::Off;
+static std::vector<uint8_t> image;
+static size_t               image_pos;
+static bool                 image_ok;      // No record so far was out of step with its setting
+static bool                 image_stored;  // A valid image is in the store
+
+static void image_put(ImageTag tag, const void* data, size_t len) {
+    image.push_back(uint8_t(tag));
+    if (tag != ImageTag::Absent) {
+        image.insert(image.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+    }
+}
+
+// Returns true with the value when the record has one, false for an absent setting or a bad record
+static bool image_get(ImageTag tag, void* data, size_t len) {
+    if (!image_ok || image_pos >= image.size()) {
+        image_ok = false;
+        return false;
+    }
+    auto found = ImageTag(image[image_pos++]);
+    if (found == ImageTag::Absent) {
+        return false;
+    }
+    if (found != tag || image_pos + len > image.size()) {
+        image_ok = false;
+        return false;
+    }
+    memcpy(data, &image[image_pos], len);
+    image_pos += len;
+    return true;
+}
+
+bool Setting::loadI32(int32_t* value) {
+    if (image_mode == ImageMode::Read) {
+        return image_get(ImageTag::Int32, value, sizeof(*value));
+    }
+    bool found = nvs_get_i32(_handle, _keyName, value) == ESP_OK;
+    if (image_mode == ImageMode::Record) {
+        image_put(found ? ImageTag::Int32 : ImageTag::Absent, value, sizeof(*value));
+    }
+    return found;
+}
+
+bool Setting::loadI8(int8_t* value) {
+    if (image_mode == ImageMode::Read) {
+        return image_get(ImageTag::Int8, value, sizeof(*value));
+    }
+    bool found = nvs_get_i8(_handle, _keyName, value) == ESP_OK;
+    if (image_mode == ImageMode::Record) {
+        image_put(found ? ImageTag::Int8 : ImageTag::Absent, value, sizeof(*value));
+    }
+    return found;
+}
+
+bool Setting::loadStr(String* value) {
+    if (image_mode == ImageMode::Read) {
+        uint16_t len;
+        if (!image_get(ImageTag::String, &len, sizeof(len))) {
+            return false;
+        }
+        if (len == 0 || image_pos + len > image.size() || image[image_pos + len - 1] != '\0') {
+            image_ok = false;
+            return false;
+        }
+        *value = (const char*)&image[image_pos];
+        image_pos += len;
+        return true;
+    }
+    size_t len   = 0;
+    bool   found = nvs_get_str(_handle, _keyName, NULL, &len) == ESP_OK;
+    char   buf[found ? len : 1];
+    found = found && nvs_get_str(_handle, _keyName, buf, &len) == ESP_OK;
+    if (image_mode == ImageMode::Record) {
+        if (found) {
+            uint16_t image_len = len;
+            image_put(ImageTag::String, &image_len, sizeof(image_len));
+            image.insert(image.end(), (const uint8_t*)buf, (const uint8_t*)buf + len);
+        } else {
+            image_put(ImageTag::Absent, NULL, 0);
+        }
+    }
+    if (found) {
+        *value = buf;
+    }
+    return found;
+}
+
+void Setting::imageInvalidate() {
+    if (image_stored) {
+        nvs_erase_key(_handle, SETTINGS_IMAGE_KEY);
+        image_stored = false;
+    }
+}
+
+// Writes held back by an open batch, at most one per key, and the checkers to run at the commit
+typedef struct {
+    const char* key;
+    ImageTag    tag;  // Absent erases the key
+    int32_t     ival;
+    String      sval;
+} pending_write_t;
+
+static volatile bool                batch_open = false;
+static SemaphoreHandle_t            batch_lock = NULL;
+static std::vector<pending_write_t> batch_writes;
+static std::vector<bool (*)(char*)> batch_checkers;
+
+// Queues a write if a batch is open, under the lock. Returns false to write through.
+static bool batch_stage(const char* key, ImageTag tag, int32_t ival, const char* sval) {
+    if (!batch_open) {
+        return false;
+    }
+    xSemaphoreTake(batch_lock, portMAX_DELAY);
+    bool staged = batch_open;
+    if (staged) {
+        auto it = std::find_if(
+            batch_writes.begin(), batch_writes.end(), [key](const pending_write_t& w) { return strcmp(w.key, key) == 0; });
+        if (it == batch_writes.end()) {
+            batch_writes.push_back({ key, tag, ival, String() });
+            it = batch_writes.end() - 1;
+        }
+        it->tag  = tag;
+        it->ival = ival;
+        it->sval = sval ? sval : "";
+    }
+    xSemaphoreGive(batch_lock);
+    return staged;
+}
+
+// Writes held back while the machine moves, at most one per key
+static std::vector<pending_write_t> deferred_writes;
+static uint32_t                     deferred_count = 0;
+
+static uint32_t settings_generation = 1;
+
+static void generation_bump() {
+    if (++settings_generation == 0) {
+        settings_generation = 1;
+    }
+}
+
+uint32_t Setting::generation() {
+    return settings_generation;
+}
+
+bool Setting::flashWritesUnsafe() {
+    switch (sys.state) {
+        case State::Cycle:
+        case State::Jog:
+        case State::Homing:
+            return true;
+        case State::Hold:
+        case State::SafetyDoor:
+            return !sys.suspend.bit.holdComplete;  // Still slowing down
+        default:
+            return false;
+    }
+}
+
+// Queues a write if the machine is moving, under the batch lock. Returns false to write through.
+static bool defer_stage(const char* key, ImageTag tag, int32_t ival, const char* sval) {
+    if (!Setting::flashWritesUnsafe()) {
+        return false;
+    }
+    xSemaphoreTake(batch_lock, portMAX_DELAY);
+    auto it = std::find_if(
+        deferred_writes.begin(), deferred_writes.end(), [key](const pending_write_t& w) { return strcmp(w.key, key) == 0; });
+    if (it == deferred_writes.end()) {
+        deferred_writes.push_back({ key, tag, ival, String() });
+        it = deferred_writes.end() - 1;
+    }
+    it->tag  = tag;
+    it->ival = ival;
+    it->sval = sval ? sval : "";
+    deferred_count++;
+    xSemaphoreGive(batch_lock);
+    return true;
+}
+
+static esp_err_t write_pending(const pending_write_t& w) {
+    switch (w.tag) {
+        case ImageTag::Absent:
+            nvs_erase_key(Setting::_handle, w.key);  // Not found is fine
+            return ESP_OK;
+        case ImageTag::Int32:
+            return nvs_set_i32(Setting::_handle, w.key, w.ival);
+        case ImageTag::Int8:
+            return nvs_set_i8(Setting::_handle, w.key, int8_t(w.ival));
+        case ImageTag::String:
+            return nvs_set_str(Setting::_handle, w.key, w.sval.c_str());
+    }
+    return ESP_OK;
+}
+
+esp_err_t Setting::storeI32(int32_t value) {
+    generation_bump();
+    if (batch_stage(_keyName, ImageTag::Int32, value, NULL) || defer_stage(_keyName, ImageTag::Int32, value, NULL)) {
+        return ESP_OK;
+    }
+    imageInvalidate();
+    return nvs_set_i32(_handle, _keyName, value);
+}
+
+esp_err_t Setting::storeI8(int8_t value) {
+    generation_bump();
+    if (batch_stage(_keyName, ImageTag::Int8, value, NULL) || defer_stage(_keyName, ImageTag::Int8, value, NULL)) {
+        return ESP_OK;
+    }
+    imageInvalidate();
+    return nvs_set_i8(_handle, _keyName, value);
+}
+
+esp_err_t Setting::storeStr(const char* value) {
+    generation_bump();
+    if (batch_stage(_keyName, ImageTag::String, 0, value) || defer_stage(_keyName, ImageTag::String, 0, value)) {
+        return ESP_OK;
+    }
+    imageInvalidate();
+    return nvs_set_str(_handle, _keyName, value);
+}
+
+void Setting::storeErase() {
+    generation_bump();
+    if (batch_stage(_keyName, ImageTag::Absent, 0, NULL) || defer_stage(_keyName, ImageTag::Absent, 0, NULL)) {
+        return;
+    }
+    imageInvalidate();
+    nvs_erase_key(_handle, _keyName);
+}
+
+void Setting::batchBegin() {
+    batch_open = true;
+}
+
+bool Setting::batchIsOpen() {
+    return batch_open;
+}
+
+Error Setting::batchCommit() {
+    if (!batch_open) {
+        return Error::Ok;
+    }
+    std::vector<pending_write_t> writes;
+    std::vector<bool (*)(char*)> checkers;
+    xSemaphoreTake(batch_lock, portMAX_DELAY);
+    batch_open = false;
+    writes.swap(batch_writes);
+    checkers.swap(batch_checkers);
+    xSemaphoreGive(batch_lock);
+
+    Error err = Error::Ok;
+    for (auto& w : writes) {
+        if (defer_stage(w.key, w.tag, w.ival, w.sval.c_str())) {
+            continue;
+        }
+        imageInvalidate();
+        if (write_pending(w) != ESP_OK) {
+            err = Error::NvsSetFailed;
+        }
+    }
+    nvs_commit(_handle);
+    for (auto checker : checkers) {
+        checker(NULL);
+    }
+    return err;
+}
+
+void Setting::deferredCommit() {
+    if (flashWritesUnsafe()) {
+        return;
+    }
+    for (int i = 0; i < CoordIndex::End; i++) {
+        coords[i]->commit();
+    }
+    if (deferred_writes.empty()) {
+        return;
+    }
+    std::vector<pending_write_t> writes;
+    xSemaphoreTake(batch_lock, portMAX_DELAY);
+    writes.swap(deferred_writes);
+    xSemaphoreGive(batch_lock);
+
+    imageInvalidate();
+    for (auto& w : writes) {
+        if (write_pending(w) != ESP_OK) {
+            grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Deferred write of %s failed", w.key);
+        }
+    }
+    nvs_commit(_handle);
+}
+
+uint32_t Setting::deferredCount() {
+    return deferred_count;
+}
+
+void Setting::loadAll() {
+    generation_bump();
+    settings_image_header_t header = { SETTINGS_IMAGE_MAGIC, SETTINGS_IMAGE_VERSION, 0, 2166136261u };
+    for (Setting* s = List; s; s = s->next()) {
+        // FNV-1a, with the NUL of each name included so the names cannot run together
+        for (const char* p = s->_keyName;; p++) {
+            header.layout = (header.layout ^ uint8_t(*p)) * 16777619u;
+            if (!*p) {
+                break;
+            }
+        }
+        header.count++;
+    }
+
+    size_t len = 0;
+    if (nvs_get_blob(_handle, SETTINGS_IMAGE_KEY, NULL, &len) == ESP_OK && len >= sizeof(header)) {
+        image.resize(len);
+        if (nvs_get_blob(_handle, SETTINGS_IMAGE_KEY, image.data(), &len) == ESP_OK &&
+            memcmp(image.data(), &header, sizeof(header)) == 0) {
+            image_stored = true;
+            image_pos    = sizeof(header);
+            image_ok     = true;
+            image_mode   = ImageMode::Read;
+            for (Setting* s = List; s; s = s->next()) {
+                s->load();
+            }
+            image_mode = ImageMode::Off;
+            if (image_ok && image_pos == image.size()) {
+                std::vector<uint8_t>().swap(image);
+                return;
+            }
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Settings image is damaged, loading each setting");
+        }
+    }
+
+    // No usable image, perhaps from older firmware or after a settings change. Load every key,
+    // which overwrites anything a damaged image left behind, and record a new image on the way.
+    image.assign((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+    image_mode = ImageMode::Record;
+    for (Setting* s = List; s; s = s->next()) {
+        s->load();
+    }
+    image_mode   = ImageMode::Off;
+    image_stored = true;  // So a failed write below erases whatever is there
+    if (nvs_set_blob(_handle, SETTINGS_IMAGE_KEY, image.data(), image.size()) != ESP_OK) {
+        imageInvalidate();
+    }
+    std::vector<uint8_t>().swap(image);
+}
+
 Error Setting::check(char* s) {
-    if (sys.state != State::Idle && sys.state != State::Alarm) {
+    // The WebUI settings do not touch motion and their writes wait for it to stop
+    if (_type != WEBSET && sys.state != State::Idle && sys.state != State::Alarm) {
         return Error::IdleError;
     }
+    generation_bump();  // A setter is about to change the value, perhaps only in memory
     if (!_checker) {
         return Error::Ok;
     }
+    if (!s && batch_open) {
+        // The post-change work, once per checker at the commit
+        xSemaphoreTake(batch_lock, portMAX_DELAY);
+        if (std::find(batch_checkers.begin(), batch_checkers.end(), _checker) == batch_checkers.end()) {
+            batch_checkers.push_back(_checker);
+        }
+        xSemaphoreGive(batch_lock);
+        return Error::Ok;
+    }
     return _checker(s) ? Error::Ok : Error::InvalidValue;
 }
 
@@ -73,6 +460,9 @@ void Setting::init() {
             grbl_sendf(CLIENT_SERIAL, "nvs_open failed with error %d\r\n", err);
         }
     }
+    if (!batch_lock) {
+        batch_lock = xSemaphoreCreateMutex();
+    }
 }
 
 IntSetting::IntSetting(const char*   description,
@@ -91,8 +481,7 @@ IntSetting::IntSetting(const char*   description,
 }
 
 void IntSetting::load() {
-    esp_err_t err = nvs_get_i32(_handle, _keyName, &_storedValue);
-    if (err) {
+    if (!loadI32(&_storedValue)) {
         _storedValue  = std::numeric_limits<int32_t>::min();
         _currentValue = _defaultValue;
     } else {
@@ -102,11 +491,11 @@ void IntSetting::load() {
 
 void IntSetting::setDefault() {
     if (_currentIsNvm) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     } else {
         _currentValue = _defaultValue;
         if (_storedValue != _currentValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         }
     }
 }
@@ -133,9 +522,9 @@ Error IntSetting::setStringValue(char* s) {
 
     if (_storedValue != convertedValue) {
         if (convertedValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
-            if (nvs_set_i32(_handle, _keyName, convertedValue)) {
+            if (storeI32(convertedValue)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = convertedValue;
@@ -187,8 +576,7 @@ AxisMaskSetting::AxisMaskSetting(const char*   description,
     _defaultValue(defVal), _currentValue(defVal) {}
 
 void AxisMaskSetting::load() {
-    esp_err_t err = nvs_get_i32(_handle, _keyName, &_storedValue);
-    if (err) {
+    if (!loadI32(&_storedValue)) {
         _storedValue  = -1;
         _currentValue = _defaultValue;
     } else {
@@ -199,7 +587,7 @@ void AxisMaskSetting::load() {
 void AxisMaskSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -231,9 +619,9 @@ Error AxisMaskSetting::setStringValue(char* s) {
     _currentValue = convertedValue;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
-            if (nvs_set_i32(_handle, _keyName, _currentValue)) {
+            if (storeI32(_currentValue)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -294,7 +682,7 @@ void FloatSetting::load() {
         int32_t ival;
         float   fval;
     } v;
-    if (nvs_get_i32(_handle, _keyName, &v.ival)) {
+    if (!loadI32(&v.ival)) {
         _currentValue = _defaultValue;
     } else {
         _currentValue = v.fval;
@@ -304,7 +692,7 @@ void FloatSetting::load() {
 void FloatSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -327,14 +715,14 @@ Error FloatSetting::setStringValue(char* s) {
     _currentValue = convertedValue;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
             union {
                 int32_t ival;
                 float   fval;
             } v;
             v.fval = _currentValue;
-            if (nvs_set_i32(_handle, _keyName, v.ival)) {
+            if (storeI32(v.ival)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -385,28 +773,18 @@ StringSetting::StringSetting(const char*   description,
 };
 
 void StringSetting::load() {
-    size_t    len = 0;
-    esp_err_t err = nvs_get_str(_handle, _keyName, NULL, &len);
-    if (err) {
+    if (!loadStr(&_storedValue)) {
         _storedValue  = _defaultValue;
         _currentValue = _defaultValue;
         return;
     }
-    char buf[len];
-    err = nvs_get_str(_handle, _keyName, buf, &len);
-    if (err) {
-        _storedValue  = _defaultValue;
-        _currentValue = _defaultValue;
-        return;
-    }
-    _storedValue  = String(buf);
     _currentValue = _storedValue;
 }
 
 void StringSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -421,10 +799,10 @@ Error StringSetting::setStringValue(char* s) {
     _currentValue = s;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
             _storedValue = _defaultValue;
         } else {
-            if (nvs_set_str(_handle, _keyName, _currentValue.c_str())) {
+            if (storeStr(_currentValue.c_str())) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -445,10 +823,10 @@ Error StringSetting::mks_setStringValue(char* s) {
     _currentValue = s;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
             _storedValue = _defaultValue;
         } else {
-            if (nvs_set_str(_handle, _keyName, _currentValue.c_str())) {
+            if (storeStr(_currentValue.c_str())) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -497,8 +875,7 @@ EnumSetting::EnumSetting(const char*   description,
     _defaultValue(defVal), _options(opts) {}
 
 void EnumSetting::load() {
-    esp_err_t err = nvs_get_i8(_handle, _keyName, &_storedValue);
-    if (err) {
+    if (!loadI8(&_storedValue)) {
         _storedValue  = -1;
         _currentValue = _defaultValue;
     } else {
@@ -509,7 +886,7 @@ void EnumSetting::load() {
 void EnumSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -549,9 +926,9 @@ Error EnumSetting::setStringValue(char* s) {
     _currentValue = it->second;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
-            if (nvs_set_i8(_handle, _keyName, _currentValue)) {
+            if (storeI8(_currentValue)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -602,8 +979,7 @@ FlagSetting::FlagSetting(const char*   description,
     _defaultValue(defVal) {}
 
 void FlagSetting::load() {
-    esp_err_t err = nvs_get_i8(_handle, _keyName, &_storedValue);
-    if (err) {
+    if (!loadI8(&_storedValue)) {
         _storedValue  = -1;  // Neither well-formed false (0) nor true (1)
         _currentValue = _defaultValue;
     } else {
@@ -613,7 +989,7 @@ void FlagSetting::load() {
 void FlagSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -629,9 +1005,9 @@ Error FlagSetting::setStringValue(char* s) {
     // _currentValue is 0 or 1
     if (_storedValue != (int8_t)_currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
-            if (nvs_set_i8(_handle, _keyName, _currentValue)) {
+            if (storeI8(_currentValue)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -681,8 +1057,7 @@ IPaddrSetting::IPaddrSetting(const char*   description,
 }
 
 void IPaddrSetting::load() {
-    esp_err_t err = nvs_get_i32(_handle, _keyName, (int32_t*)&_storedValue);
-    if (err) {
+    if (!loadI32((int32_t*)&_storedValue)) {
         _storedValue  = 0x000000ff;  // Unreasonable value for any IP thing
         _currentValue = _defaultValue;
     } else {
@@ -693,7 +1068,7 @@ void IPaddrSetting::load() {
 void IPaddrSetting::setDefault() {
     _currentValue = _defaultValue;
     if (_storedValue != _currentValue) {
-        nvs_erase_key(_handle, _keyName);
+        storeErase();
     }
 }
 
@@ -710,9 +1085,9 @@ Error IPaddrSetting::setStringValue(char* s) {
     _currentValue = ipaddr;
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
-            nvs_erase_key(_handle, _keyName);
+            storeErase();
         } else {
-            if (nvs_set_i32(_handle, _keyName, (int32_t)_currentValue)) {
+            if (storeI32((int32_t)_currentValue)) {
                 return Error::NvsSetFailed;
             }
             _storedValue = _currentValue;
@@ -775,5 +1150,18 @@ void Coordinates::set(float value[MAX_N_AXIS]) {
 #ifdef FORCE_BUFFER_SYNC_DURING_NVS_WRITE
     protocol_buffer_synchronize();
 #endif
+    if (Setting::flashWritesUnsafe()) {
+        _deferred = true;
+        deferred_count++;
+        return;
+    }
+    _deferred = false;
     nvs_set_blob(Setting::_handle, _name, _currentValue, sizeof(_currentValue));
 }
+
+void Coordinates::commit() {
+    if (_deferred) {
+        _deferred = false;
+        nvs_set_blob(Setting::_handle, _name, _currentValue, sizeof(_currentValue));
+    }
+}
@@ -101,10 +101,52 @@ protected:
     bool (*_checker)(char*);
     const char* _keyName;
 
+    // Reads of the backing store for load(). While loadAll() runs they are served from,
+    // or recorded into, the settings image.
+    bool loadI32(int32_t* value);
+    bool loadI8(int8_t* value);
+    bool loadStr(String* value);
+
+    // Every write to the backing store goes through here first, since it makes the image stale
+    static void imageInvalidate();
+
+    // Writes of the backing store, held back while a batch is open. They return an
+    // esp_err_t like the nvs_set_*() calls they stand for.
+    esp_err_t storeI32(int32_t value);
+    esp_err_t storeI8(int8_t value);
+    esp_err_t storeStr(const char* value);
+    void      storeErase();
+
 public:
     static nvs_handle _handle;
     static void       init();
     static Setting*   List;
+
+    // Loads every setting. The values of all settings are also kept packed in one NVS blob,
+    // the settings image, so startup normally reads the store once instead of once per
+    // setting. The per-setting keys stay the master copy: a write to any setting erases the
+    // image, and the next loadAll() falls back to reading each key and stores a fresh image.
+    static void loadAll();
+
+    // Between batchBegin() and batchCommit(), setting changes take effect at once but their NVS
+    // writes are held back, one per key, and the work a setting's checker does after a change,
+    // such as rebuilding the motion config, is done once per checker. batchCommit() writes the
+    // lot, commits NVS once and then runs the checkers. Any G-code line commits an open batch
+    // first, so motion never runs on derived data that is out of date.
+    static void  batchBegin();
+    static Error batchCommit();
+    static bool  batchIsOpen();
+
+    // A flash write stops the flash cache on both cores, and with it any interrupt code not in
+    // IRAM, so writes made while the machine moves (a cycle, jog, homing or a hold still slowing
+    // down) are held back, one per key, and the new values only take effect in memory.
+    // deferredCommit() writes them once motion stops. It is called from the main loop.
+    static bool     flashWritesUnsafe();
+    static void     deferredCommit();
+    static uint32_t deferredCount();  // Writes held back since boot
+
+    // Changes whenever a setting may have changed value, for text made from the values. Never 0.
+    static uint32_t generation();
     Setting*          next() { return link; }
 
     Error check(char* s);
@@ -114,7 +156,12 @@ public:
         if (esp_err_t err = nvs_get_stats(NULL, &stats)) {
             return Error::NvsGetStatsFailed;
         }
-        grbl_sendf(out->client(), "[MSG: NVS Used: %d Free: %d Total: %d]\r\n", stats.used_entries, stats.free_entries, stats.total_entries);
+        grbl_sendf(out->client(),
+                   "[MSG: NVS Used: %d Free: %d Total: %d Deferred: %u]\r\n",
+                   stats.used_entries,
+                   stats.free_entries,
+                   stats.total_entries,
+                   deferredCount());
 #if 0  // The SDK we use does not have this yet
         nvs_iterator_t it = nvs_entry_find(NULL, NULL, NVS_TYPE_ANY);
         while (it != NULL) {
@@ -128,6 +175,7 @@ public:
     }
 
     static Error eraseNVS(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+        imageInvalidate();
         nvs_erase_all(_handle);
         return Error::Ok;
     }
@@ -231,6 +279,7 @@ class Coordinates {
 private:
     float       _currentValue[MAX_N_AXIS];
     const char* _name;
+    bool        _deferred = false;  // Set while the machine moved, written by commit()
 
 public:
     Coordinates(const char* name) : _name(name) {}
@@ -248,6 +297,7 @@ public:
     // Return a pointer to the array
     const float* get() { return _currentValue; }
     void         set(float* value);
+    void         commit();  // Writes a value set while the machine moved
 };
 
 extern Coordinates* coords[CoordIndex::End];
@@ -450,6 +500,7 @@ extern bool idleOrJog();
 extern bool idleOrAlarm();
 extern bool anyState();
 extern bool notCycleOrHold();
+extern bool idleCycleOrHold();
 
 class WebCommand : public Command {
 private:
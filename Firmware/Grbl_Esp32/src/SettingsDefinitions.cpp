@@ -10,39 +10,93 @@ StringSetting* build_info;
 
 IntSetting* pulse_microseconds;
 IntSetting* stepper_idle_lock_time;
+IntSetting* cpu_idle_mhz;
 IntSetting* direction_delay_microseconds;
 IntSetting* enable_delay_microseconds;
 
+IntSetting* planner_blocks;
+FloatSetting* planner_blend_tolerance;
+FloatSetting* planner_coalesce_tolerance;
+IntSetting* stepper_segments;
+IntSetting* stepper_buffer_time;
+IntSetting* acceleration_ticks;
+FlagSetting* stepper_s_curve;
+FlagSetting* stepper_pulse_timer;
+
+EnumSetting*  shaper_x_type;
+FloatSetting* shaper_x_frequency;
+FloatSetting* shaper_x_damping;
+EnumSetting*  shaper_y_type;
+FloatSetting* shaper_y_frequency;
+FloatSetting* shaper_y_damping;
+IntSetting*  serial_baud_rate;
+FlagSetting* serial_flow_control;
+IntSetting* sd_read_ahead;
+IntSetting* sd_spi_freq;
+FlagSetting* sd_queue_pause;
+FlagSetting* sd_job_log;
+
+EnumSetting* i2s_out_profile;
+IntSetting*  i2s_out_dmabuf_count;
+IntSetting*  i2s_out_dmabuf_len;
+IntSetting*  i2s_out_resolution;
+
 AxisMaskSetting* step_invert_mask;
 AxisMaskSetting* dir_invert_mask;
 // TODO Settings - need to call st_generate_step_invert_masks;
 AxisMaskSetting* homing_dir_mask;
 AxisMaskSetting* homing_squared_axes;
 AxisMaskSetting* stallguard_debug_mask;
+IntSetting*      homing_sensorless_threshold;
 
 
 IntSetting* language_select;
 FlagSetting* beep_status; // mks-fix
+FlagSetting* ui_headless_job;
 
 
 
 FlagSetting* step_enable_invert;
 FlagSetting* limit_invert;
 FlagSetting* probe_invert;
+FlagSetting*  probe_two_stage;
+FloatSetting* probe_retract;
+FloatSetting* probe_latch_rate;
+FloatSetting* probe_grid_seek_rate;
+FloatSetting* probe_grid_latch_rate;
+FloatSetting* probe_grid_backoff;
+FloatSetting* probe_grid_clearance;
+FloatSetting* probe_grid_depth;
+FlagSetting*  probe_grid_compensate;
 FlagSetting* report_inches;
 FlagSetting* soft_limits;
 // TODO Settings - need to check for HOMING_ENABLE
 FlagSetting* hard_limits;
 // TODO Settings - need to call limits_init;
 FlagSetting* homing_enable;
+FlagSetting* homing_parallel;
+FlagSetting* homing_quick;
 // TODO Settings - also need to clear, but not set, soft_limits
 FlagSetting* laser_mode;
 // TODO Settings - also need to call my_spindle->init;
 IntSetting* laser_full_power;
+FlagSetting* laser_dynamic_power;
+FloatSetting* laser_travel_feed;
+IntSetting* laser_scan_offset;
+FloatSetting* laser_pulses_per_mm;
+IntSetting* laser_pulse_width;
+EnumSetting*  laser_curve;
+FloatSetting* laser_gamma;
+FloatSetting* laser_power_min;
 
 IntSetting*   status_mask;
+IntSetting*   report_interval;
+FlagSetting*  report_delta;
+IntSetting*   report_ok_batch;
+FlagSetting*  report_ok_credit;
 FloatSetting* junction_deviation;
 FloatSetting* arc_tolerance;
+FloatSetting* arc_tolerance_max;
 
 FloatSetting*    homing_feed_rate;
 FloatSetting*    homing_seek_rate;
@@ -54,6 +108,10 @@ FloatSetting*    rpm_max;
 FloatSetting*    rpm_min;
 FloatSetting*    spindle_delay_spinup;
 FloatSetting*    spindle_delay_spindown;
+FloatSetting*    spindle_at_speed_tolerance;
+FloatSetting*    spindle_at_speed_timeout;
+FlagSetting*     spindle_speed_queued;
+IntSetting*      spindle_speed_lead;
 FloatSetting*    coolant_start_delay;
 FlagSetting*     spindle_enbl_off_with_zero_speed;
 FlagSetting*     spindle_enable_invert;
@@ -82,6 +140,33 @@ enum_opt_t spindleTypes = {
     // clang-format on
 };
 
+#ifdef USE_I2S_OUT
+enum_opt_t i2sOutProfiles = {
+    // clang-format off
+    { "Default", int8_t(I2SOutProfile::Default) },
+    { "LowLatency", int8_t(I2SOutProfile::LowLatency) },
+    { "Throughput", int8_t(I2SOutProfile::Throughput) },
+    { "Custom", int8_t(I2SOutProfile::Custom) },
+    // clang-format on
+};
+#endif
+
+enum_opt_t shaperTypes = {
+    // clang-format off
+    { "None", int8_t(ShaperType::None) },
+    { "ZV", int8_t(ShaperType::ZV) },
+    { "ZVD", int8_t(ShaperType::ZVD) },
+    { "MZV", int8_t(ShaperType::MZV) },
+    // clang-format on
+};
+
+enum_opt_t laserCurves = {
+    // clang-format off
+    { "Linear", int8_t(LaserCurve::Linear) },
+    { "Gamma", int8_t(LaserCurve::Gamma) },
+    // clang-format on
+};
+
 enum_opt_t messageLevels = {
     // clang-format off
     { "None", int8_t(MsgLevel::None) },
@@ -204,6 +289,64 @@ static bool checkStartupLine(char* value) {
 static bool postMotorSetting(char* value) {
     if (!value) {
         motors_read_settings();
+        motion_config_update();
+        limits_distrust(bit(MAX_N_AXIS) - 1);
+    }
+    return true;
+}
+
+// A new scale moves every position the machine has, so the next $H seeks again
+static bool postStepsSetting(char* value) {
+    if (!value) {
+        motion_config_update();
+        limits_distrust(bit(MAX_N_AXIS) - 1);
+    }
+    return true;
+}
+
+// Settings that are read in the step path only need the motion config snapshot rebuilt
+static bool postMotionSetting(char* value) {
+    if (!value) {
+        motion_config_update();
+    }
+    return true;
+}
+
+#ifdef USE_I2S_OUT
+// The DMA ring can only be resized while no steps are streaming through it
+static bool postI2SSetting(char* value) {
+    if (value) {
+        return i2s_out_get_pulser_status() == PASSTHROUGH;
+    }
+    i2s_out_apply_settings();
+    return true;
+}
+
+// Only power-of-two sample lengths divide the I2S clock evenly
+static bool postI2SResolution(char* value) {
+    if (value) {
+        int32_t usec = atoi(value);
+        return (usec & (usec - 1)) == 0 && postI2SSetting(value);
+    }
+    return postI2SSetting(value);
+}
+
+void i2s_out_apply_settings() {
+    if (i2s_out_set_usec_per_pulse(i2s_out_resolution->get()) != 0) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Warning, "I2S resolution not changed");
+    }
+    if (i2s_out_set_dma_profile(
+            I2SOutProfile(i2s_out_profile->get()), i2s_out_dmabuf_count->get(), i2s_out_dmabuf_len->get()) != 0) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Warning, "I2S DMA buffers not resized");
+    }
+}
+#endif
+
+// The clocks the ESP32 can run at from the PLL
+static bool checkCpuIdleMHz(char* value) {
+    if (value) {
+        int mhz = atoi(value);
+        return mhz == 80 || mhz == 160 || mhz == 240;
     }
     return true;
 }
@@ -322,26 +465,28 @@ void make_settings() {
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def = &axis_defaults[axis];
         auto setting =
-            new FloatSetting(GRBL, WG, makeGrblName(axis, 120), makename(def->name, "Acceleration"), def->acceleration, 1.0, 100000.0);
+            new FloatSetting(GRBL, WG, makeGrblName(axis, 120), makename(def->name, "Acceleration"), def->acceleration, 1.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->acceleration = setting;
     }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def          = &axis_defaults[axis];
-        auto setting = new FloatSetting(GRBL, WG, makeGrblName(axis, 110), makename(def->name, "MaxRate"), def->max_rate, 1.0, 100000.0);
+        auto setting =
+            new FloatSetting(GRBL, WG, makeGrblName(axis, 110), makename(def->name, "MaxRate"), def->max_rate, 1.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->max_rate = setting;
     }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def = &axis_defaults[axis];
         auto setting =
-            new FloatSetting(GRBL, WG, makeGrblName(axis, 100), makename(def->name, "StepsPerMm"), def->steps_per_mm, 1.0, 100000.0);
+            new FloatSetting(GRBL, WG, makeGrblName(axis, 100), makename(def->name, "StepsPerMm"), def->steps_per_mm, 1.0, 100000.0, postStepsSetting);
         setting->setAxis(axis);
         axis_settings[axis]->steps_per_mm = setting;
     }
 
     language_select              = new IntSetting(GRBL, WG, "40", "Language", DEFAULT_LANGUAGE_STATUS, 0, 2);
     beep_status                  = new FlagSetting(GRBL, WG, "38", "beep_status", DEFAULT_BEEP_STATUS);
+    ui_headless_job              = new FlagSetting(EXTENDED, WG, NULL, "UI/HeadlessJob", DEFAULT_UI_HEADLESS_JOB);
     
     // Spindle Settings
     spindle_type =
@@ -361,6 +506,14 @@ void make_settings() {
         new FloatSetting(EXTENDED, WG, NULL, "Spindle/Delay/SpinUp", DEFAULT_SPINDLE_DELAY_SPINUP, 0, 30, checkSpindleChange);
     spindle_delay_spindown =
         new FloatSetting(EXTENDED, WG, NULL, "Spindle/Delay/SpinDown", DEFAULT_SPINDLE_DELAY_SPINUP, 0, 30, checkSpindleChange);
+    // Spindles that report their speed wait for it instead of the delays. Tolerance 0 uses the delays.
+    spindle_at_speed_tolerance =
+        new FloatSetting(EXTENDED, WG, NULL, "Spindle/AtSpeed/Tolerance", DEFAULT_SPINDLE_AT_SPEED_TOLERANCE, 0, 50);
+    spindle_at_speed_timeout = new FloatSetting(EXTENDED, WG, NULL, "Spindle/AtSpeed/Timeout", DEFAULT_SPINDLE_AT_SPEED_TIMEOUT, 1, 60);
+    // An S word with the spindle on rides with the motion instead of draining the planner, without waiting for the speed.
+    spindle_speed_queued = new FlagSetting(EXTENDED, WG, NULL, "Spindle/Speed/Queued", DEFAULT_SPINDLE_SPEED_QUEUED, postMotionSetting);
+    spindle_speed_lead =
+        new IntSetting(EXTENDED, WG, NULL, "Spindle/Speed/Lead", DEFAULT_SPINDLE_SPEED_LEAD, 0, 2000, postMotionSetting);  // milliseconds
     coolant_start_delay = new FloatSetting(EXTENDED, WG, NULL, "Coolant/Delay/TurnOn", DEFAULT_COOLANT_DELAY_TURNON, 0, 30);
 
     spindle_enbl_off_with_zero_speed =
@@ -373,8 +526,21 @@ void make_settings() {
     startup_line_1 = new StringSetting(EXTENDED, WG, "N1", "GCode/Line1", "", checkStartupLine);
 
     // GRBL Numbered Settings
-    laser_mode       = new FlagSetting(GRBL, WG, "32", "GCode/LaserMode", DEFAULT_LASER_MODE);
+    laser_mode       = new FlagSetting(GRBL, WG, "32", "GCode/LaserMode", DEFAULT_LASER_MODE, postMotionSetting);
     laser_full_power = new IntSetting(EXTENDED, WG, NULL, "Laser/FullPower", DEFAULT_LASER_FULL_POWER, 0, 10000, checkSpindleChange);
+    laser_dynamic_power =
+        new FlagSetting(EXTENDED, WG, NULL, "Laser/DynamicPower", DEFAULT_LASER_DYNAMIC_POWER, postMotionSetting);  // ramp power within segments
+    laser_travel_feed = new FloatSetting(EXTENDED, WG, NULL, "Laser/TravelFeed", DEFAULT_LASER_TRAVEL_FEED, 0, 100000);  // for S0 runs
+    laser_scan_offset =
+        new IntSetting(EXTENDED, WG, NULL, "Laser/ScanOffset", DEFAULT_LASER_SCAN_OFFSET, 0, 5000, postMotionSetting);  // microseconds
+    laser_pulses_per_mm =
+        new FloatSetting(EXTENDED, WG, NULL, "Laser/PulsesPerMM", DEFAULT_LASER_PULSES_PER_MM, 0.0, 1000.0, postMotionSetting);  // 0 for off
+    laser_pulse_width =
+        new IntSetting(EXTENDED, WG, NULL, "Laser/PulseWidth", DEFAULT_LASER_PULSE_WIDTH, 1, 10000, postMotionSetting);  // microseconds
+    laser_curve = new EnumSetting(
+        NULL, EXTENDED, WG, NULL, "Laser/Curve", static_cast<int8_t>(DEFAULT_LASER_CURVE), &laserCurves, checkSpindleChange);
+    laser_gamma     = new FloatSetting(EXTENDED, WG, NULL, "Laser/Gamma", DEFAULT_LASER_GAMMA, 0.2, 5.0, checkSpindleChange);
+    laser_power_min = new FloatSetting(EXTENDED, WG, NULL, "Laser/PowerMin", DEFAULT_LASER_POWER_MIN, 0.0, 100.0, checkSpindleChange);  // percent
 
     // TODO Settings - also need to call my_spindle->init();
     rpm_min = new FloatSetting(GRBL, WG, "31", "GCode/MinS", DEFAULT_SPINDLE_RPM_MIN, 0, 100000, checkSpindleChange);
@@ -387,6 +553,8 @@ void make_settings() {
     homing_seek_rate    = new FloatSetting(GRBL, WG, "25", "Homing/Seek", DEFAULT_HOMING_SEEK_RATE, 0, 10000);
     homing_feed_rate    = new FloatSetting(GRBL, WG, "24", "Homing/Feed", DEFAULT_HOMING_FEED_RATE, 0, 10000);
     homing_squared_axes = new AxisMaskSetting(EXTENDED, WG, NULL, "Homing/Squared", DEFAULT_HOMING_SQUARED_AXES);
+    homing_parallel     = new FlagSetting(EXTENDED, WG, NULL, "Homing/Parallel", DEFAULT_HOMING_PARALLEL);
+    homing_quick        = new FlagSetting(EXTENDED, WG, NULL, "Homing/Quick", DEFAULT_HOMING_QUICK);
 
     // TODO Settings - need to call st_generate_step_invert_masks()
     homing_dir_mask = new AxisMaskSetting(GRBL, WG, "23", "Homing/DirInvert", DEFAULT_HOMING_DIR_MASK);
@@ -401,8 +569,26 @@ void make_settings() {
     report_inches = new FlagSetting(GRBL, WG, "13", "Report/Inches", DEFAULT_REPORT_INCHES);
     // TODO Settings - also need to clear, but not set, soft_limits
     arc_tolerance      = new FloatSetting(GRBL, WG, "12", "GCode/ArcTolerance", DEFAULT_ARC_TOLERANCE, 0, 1);
+    arc_tolerance_max  = new FloatSetting(EXTENDED, WG, NULL, "GCode/ArcToleranceMax", DEFAULT_ARC_TOLERANCE_MAX, 0, 1);
     junction_deviation = new FloatSetting(GRBL, WG, "11", "GCode/JunctionDeviation", DEFAULT_JUNCTION_DEVIATION, 0, 10);
     status_mask        = new IntSetting(GRBL, WG, "10", "Report/Status", DEFAULT_STATUS_REPORT_MASK, 0, 3);
+    report_interval    = new IntSetting(EXTENDED, WG, NULL, "Report/Interval", DEFAULT_REPORT_INTERVAL, 0, 10000);  // msec
+    report_delta       = new FlagSetting(EXTENDED, WG, NULL, "Report/Delta", DEFAULT_REPORT_DELTA);
+    report_ok_batch    = new IntSetting(EXTENDED, WG, NULL, "Report/OkBatch", DEFAULT_REPORT_OK_BATCH, 0, 100);  // msec
+    report_ok_credit   = new FlagSetting(EXTENDED, WG, NULL, "Report/OkCredit", DEFAULT_REPORT_OK_CREDIT);
+
+    cpu_idle_mhz = new IntSetting(EXTENDED, WG, NULL, "CPU/IdleMHz", DEFAULT_CPU_IDLE_MHZ, 80, 240, checkCpuIdleMHz);
+
+    probe_two_stage  = new FlagSetting(EXTENDED, WG, NULL, "Probe/TwoStage", DEFAULT_PROBE_TWO_STAGE);
+    probe_retract    = new FloatSetting(EXTENDED, WG, NULL, "Probe/Retract", DEFAULT_PROBE_RETRACT, 0.05, 50);         // mm
+    probe_latch_rate = new FloatSetting(EXTENDED, WG, NULL, "Probe/LatchRate", DEFAULT_PROBE_LATCH_RATE, 1, 1000);  // mm/min
+
+    probe_grid_seek_rate  = new FloatSetting(EXTENDED, WG, NULL, "Probe/Grid/SeekRate", DEFAULT_PROBE_GRID_SEEK_RATE, 1, 5000);    // mm/min
+    probe_grid_latch_rate = new FloatSetting(EXTENDED, WG, NULL, "Probe/Grid/LatchRate", DEFAULT_PROBE_GRID_LATCH_RATE, 1, 1000);  // mm/min
+    probe_grid_backoff    = new FloatSetting(EXTENDED, WG, NULL, "Probe/Grid/Backoff", DEFAULT_PROBE_GRID_BACKOFF, 0.05, 10);       // mm
+    probe_grid_clearance  = new FloatSetting(EXTENDED, WG, NULL, "Probe/Grid/Clearance", DEFAULT_PROBE_GRID_CLEARANCE, 0.1, 50);    // mm
+    probe_grid_depth      = new FloatSetting(EXTENDED, WG, NULL, "Probe/Grid/Depth", DEFAULT_PROBE_GRID_DEPTH, 0.1, 100);           // mm
+    probe_grid_compensate = new FlagSetting(EXTENDED, WG, NULL, "Probe/Grid/Compensate", DEFAULT_PROBE_GRID_COMPENSATE);
 
     probe_invert                 = new FlagSetting(GRBL, WG, "6", "Probe/Invert", DEFAULT_INVERT_PROBE_PIN);
     limit_invert                 = new FlagSetting(GRBL, WG, "5", "Limits/Invert", DEFAULT_INVERT_LIMIT_PINS);
@@ -410,11 +596,75 @@ void make_settings() {
     dir_invert_mask              = new AxisMaskSetting(GRBL, WG, "3", "Stepper/DirInvert", DEFAULT_DIRECTION_INVERT_MASK, postMotorSetting);
     step_invert_mask             = new AxisMaskSetting(GRBL, WG, "2", "Stepper/StepInvert", DEFAULT_STEPPING_INVERT_MASK, postMotorSetting);
     stepper_idle_lock_time       = new IntSetting(GRBL, WG, "1", "Stepper/IdleTime", DEFAULT_STEPPER_IDLE_LOCK_TIME, 0, 255);
-    pulse_microseconds           = new IntSetting(GRBL, WG, "0", "Stepper/Pulse", DEFAULT_STEP_PULSE_MICROSECONDS, 3, 1000);
-    direction_delay_microseconds = new IntSetting(EXTENDED, WG, NULL, "Stepper/Direction/Delay", STEP_PULSE_DELAY, 0, 1000);
+    pulse_microseconds           = new IntSetting(GRBL, WG, "0", "Stepper/Pulse", DEFAULT_STEP_PULSE_MICROSECONDS, 3, 1000, postMotionSetting);
+    direction_delay_microseconds = new IntSetting(EXTENDED, WG, NULL, "Stepper/Direction/Delay", STEP_PULSE_DELAY, 0, 1000, postMotionSetting);
     enable_delay_microseconds = new IntSetting(EXTENDED, WG, NULL, "Stepper/Enable/Delay", DEFAULT_STEP_ENABLE_DELAY, 0, 1000);  // microseconds
 
+    planner_blend_tolerance = new FloatSetting(EXTENDED, WG, NULL, "Planner/BlendTolerance", DEFAULT_PLANNER_BLEND_TOLERANCE, 0, 1);
+    planner_coalesce_tolerance =
+        new FloatSetting(EXTENDED, WG, NULL, "Planner/CoalesceTolerance", DEFAULT_PLANNER_COALESCE_TOLERANCE, 0, 1);
+
+    // Buffer sizes are only read at boot, so changes need a restart
+    planner_blocks   = new IntSetting(EXTENDED, WG, NULL, "Planner/Blocks", BLOCK_BUFFER_SIZE, 8, 255);
+    stepper_segments = new IntSetting(EXTENDED, WG, NULL, "Stepper/Segments", SEGMENT_BUFFER_SIZE, 3, 64);
+    stepper_buffer_time = new IntSetting(
+        EXTENDED, WG, NULL, "Stepper/BufferTime", DEFAULT_STEPPER_BUFFER_TIME, 0, 500, postMotionSetting);  // ms, also sizes the ring at boot
+    acceleration_ticks = new IntSetting(
+        EXTENDED, WG, NULL, "Stepper/AccelTicks", ACCELERATION_TICKS_PER_SECOND, 10, 1000, postMotionSetting);  // segments per second
+    stepper_s_curve = new FlagSetting(EXTENDED, WG, NULL, "Stepper/SCurve", DEFAULT_STEPPER_S_CURVE, postMotionSetting);
+    stepper_pulse_timer =
+        new FlagSetting(EXTENDED, WG, NULL, "Stepper/PulseTimer", DEFAULT_STEPPER_PULSE_TIMER, postMotionSetting);
+
+    // Input shaping delays motion by up to 1/frequency per shaped axis, which the segment ring
+    // has to hold on top of $Stepper/BufferTime, or shaping is partly given up to keep stepping
+    shaper_x_type      = new EnumSetting(
+        NULL, EXTENDED, WG, NULL, "Shaper/X/Type", static_cast<int8_t>(DEFAULT_SHAPER_X_TYPE), &shaperTypes, postMotionSetting);
+    shaper_x_frequency = new FloatSetting(EXTENDED, WG, NULL, "Shaper/X/Frequency", DEFAULT_SHAPER_X_FREQUENCY, 5, 200, postMotionSetting);
+    shaper_x_damping   = new FloatSetting(EXTENDED, WG, NULL, "Shaper/X/Damping", DEFAULT_SHAPER_X_DAMPING, 0, 0.9, postMotionSetting);
+    shaper_y_type      = new EnumSetting(
+        NULL, EXTENDED, WG, NULL, "Shaper/Y/Type", static_cast<int8_t>(DEFAULT_SHAPER_Y_TYPE), &shaperTypes, postMotionSetting);
+    shaper_y_frequency = new FloatSetting(EXTENDED, WG, NULL, "Shaper/Y/Frequency", DEFAULT_SHAPER_Y_FREQUENCY, 5, 200, postMotionSetting);
+    shaper_y_damping   = new FloatSetting(EXTENDED, WG, NULL, "Shaper/Y/Damping", DEFAULT_SHAPER_Y_DAMPING, 0, 0.9, postMotionSetting);
+    // Both take effect at the next boot, so a typo cannot cut off the sender mid-session
+    serial_baud_rate    = new IntSetting(EXTENDED, WG, NULL, "Serial/Baud", DEFAULT_SERIAL_BAUD_RATE, 9600, 2000000);
+    serial_flow_control = new FlagSetting(EXTENDED, WG, NULL, "Serial/FlowControl", DEFAULT_SERIAL_FLOW_CONTROL);
+    sd_read_ahead    = new IntSetting(EXTENDED, WG, NULL, "SD/ReadAhead", DEFAULT_SD_READ_AHEAD, 1, 255);  // lines
+    sd_spi_freq      = new IntSetting(EXTENDED, WG, NULL, "SD/SPIFreq", DEFAULT_SD_SPI_FREQ, 400, 40000);  // kHz
+    sd_queue_pause   = new FlagSetting(EXTENDED, WG, NULL, "SD/Queue/Pause", DEFAULT_SD_QUEUE_PAUSE);
+    sd_job_log       = new FlagSetting(EXTENDED, WG, NULL, "SD/JobLog", DEFAULT_SD_JOB_LOG);
+
+#ifdef USE_I2S_OUT
+    i2s_out_profile = new EnumSetting(
+        NULL, EXTENDED, WG, NULL, "I2SO/Profile", DEFAULT_I2S_OUT_PROFILE, &i2sOutProfiles, postI2SSetting);
+    i2s_out_dmabuf_count = new IntSetting(EXTENDED,
+                                          WG,
+                                          NULL,
+                                          "I2SO/DMABufCount",
+                                          I2S_OUT_DMABUF_COUNT,
+                                          I2S_OUT_DMABUF_COUNT_MIN,
+                                          I2S_OUT_DMABUF_COUNT_MAX,
+                                          postI2SSetting);  // Custom profile only
+    i2s_out_dmabuf_len   = new IntSetting(EXTENDED,
+                                        WG,
+                                        NULL,
+                                        "I2SO/DMABufLen",
+                                        I2S_OUT_DMABUF_LEN,
+                                        I2S_OUT_DMABUF_LEN_MIN,
+                                        I2S_OUT_DMABUF_LEN_MAX,
+                                        postI2SSetting);  // bytes, Custom profile only
+    i2s_out_resolution   = new IntSetting(EXTENDED,
+                                        WG,
+                                        NULL,
+                                        "I2SO/Resolution",
+                                        DEFAULT_I2S_OUT_USEC_PER_PULSE,
+                                        I2S_OUT_USEC_PER_PULSE_MIN,
+                                        I2S_OUT_USEC_PER_PULSE,
+                                        postI2SResolution);  // usec per sample
+#endif
+
     stallguard_debug_mask = new AxisMaskSetting(EXTENDED, WG, NULL, "Report/StallGuard", 0, postMotorSetting);
+    homing_sensorless_threshold =
+        new IntSetting(EXTENDED, WG, NULL, "Homing/Sensorless/Threshold", DEFAULT_HOMING_SENSORLESS_THRESHOLD, 0, 100);  // % of baseline SG_RESULT
 
     homing_cycle[5] = new AxisMaskSetting(EXTENDED, WG, NULL, "Homing/Cycle5", DEFAULT_HOMING_CYCLE_5);
     homing_cycle[4] = new AxisMaskSetting(EXTENDED, WG, NULL, "Homing/Cycle4", DEFAULT_HOMING_CYCLE_4);
@@ -18,9 +18,37 @@ extern StringSetting* build_info;
 
 extern IntSetting* pulse_microseconds;
 extern IntSetting* stepper_idle_lock_time;
+extern IntSetting* cpu_idle_mhz;
 extern IntSetting* direction_delay_microseconds;
 extern IntSetting* enable_delay_microseconds;
 
+extern IntSetting* planner_blocks;
+extern FloatSetting* planner_blend_tolerance;
+extern FloatSetting* planner_coalesce_tolerance;
+extern IntSetting* stepper_segments;
+extern IntSetting* stepper_buffer_time;
+extern IntSetting* acceleration_ticks;
+extern FlagSetting* stepper_s_curve;
+extern FlagSetting* stepper_pulse_timer;
+
+extern EnumSetting*  shaper_x_type;
+extern FloatSetting* shaper_x_frequency;
+extern FloatSetting* shaper_x_damping;
+extern EnumSetting*  shaper_y_type;
+extern FloatSetting* shaper_y_frequency;
+extern FloatSetting* shaper_y_damping;
+extern IntSetting*  serial_baud_rate;
+extern FlagSetting* serial_flow_control;
+extern IntSetting* sd_read_ahead;
+extern IntSetting* sd_spi_freq;
+extern FlagSetting* sd_queue_pause;
+extern FlagSetting* sd_job_log;
+
+extern EnumSetting* i2s_out_profile;
+extern IntSetting*  i2s_out_dmabuf_count;
+extern IntSetting*  i2s_out_dmabuf_len;
+extern IntSetting*  i2s_out_resolution;
+
 extern AxisMaskSetting* step_invert_mask;
 extern AxisMaskSetting* dir_invert_mask;
 extern AxisMaskSetting* homing_dir_mask;
@@ -29,20 +57,45 @@ extern AxisMaskSetting* homing_cycle[MAX_N_AXIS];
 
 extern IntSetting* language_select;
 extern FlagSetting* beep_status;
+extern FlagSetting* ui_headless_job;
 
 extern FlagSetting* step_enable_invert;
 extern FlagSetting* limit_invert;
 extern FlagSetting* probe_invert;
+extern FlagSetting*  probe_two_stage;
+extern FloatSetting* probe_retract;
+extern FloatSetting* probe_latch_rate;
+extern FloatSetting* probe_grid_seek_rate;
+extern FloatSetting* probe_grid_latch_rate;
+extern FloatSetting* probe_grid_backoff;
+extern FloatSetting* probe_grid_clearance;
+extern FloatSetting* probe_grid_depth;
+extern FlagSetting*  probe_grid_compensate;
 extern FlagSetting* report_inches;
 extern FlagSetting* soft_limits;
 extern FlagSetting* hard_limits;
 extern FlagSetting* homing_enable;
+extern FlagSetting* homing_parallel;
+extern FlagSetting* homing_quick;
 extern FlagSetting* laser_mode;
 extern IntSetting*  laser_full_power;
+extern FlagSetting* laser_dynamic_power;
+extern FloatSetting* laser_travel_feed;
+extern IntSetting*  laser_scan_offset;
+extern FloatSetting* laser_pulses_per_mm;
+extern IntSetting*   laser_pulse_width;
+extern EnumSetting*  laser_curve;
+extern FloatSetting* laser_gamma;
+extern FloatSetting* laser_power_min;
 
 extern IntSetting*   status_mask;
+extern IntSetting*   report_interval;
+extern FlagSetting*  report_delta;
+extern IntSetting*   report_ok_batch;
+extern FlagSetting*  report_ok_credit;
 extern FloatSetting* junction_deviation;
 extern FloatSetting* arc_tolerance;
+extern FloatSetting* arc_tolerance_max;
 
 extern FloatSetting* homing_feed_rate;
 extern FloatSetting* homing_seek_rate;
@@ -53,6 +106,10 @@ extern FloatSetting* rpm_max;
 extern FloatSetting* rpm_min;
 extern FloatSetting* spindle_delay_spinup;
 extern FloatSetting* spindle_delay_spindown;
+extern FloatSetting* spindle_at_speed_tolerance;
+extern FloatSetting* spindle_at_speed_timeout;
+extern FlagSetting*  spindle_speed_queued;
+extern IntSetting*   spindle_speed_lead;
 extern FloatSetting* coolant_start_delay;
 extern FlagSetting*  spindle_enbl_off_with_zero_speed;
 extern FlagSetting*  spindle_enable_invert;
@@ -66,6 +123,7 @@ extern IntSetting*   spindle_pwm_bit_precision;
 extern EnumSetting* spindle_type;
 
 extern AxisMaskSetting* stallguard_debug_mask;
+extern IntSetting*      homing_sensorless_threshold;
 
 extern StringSetting* user_macro0;
 extern StringSetting* user_macro1;
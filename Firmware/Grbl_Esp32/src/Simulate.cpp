@@ -0,0 +1,252 @@
+/*
+  Simulate.cpp - Dry runs of a job through the parser, planner and step generator
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+const int SIM_OUT_BUFFER_SIZE = 1024;
+const int SIM_STALL_PASSES    = 8;  // Prep passes without a segment before a drain gives up
+
+static bool           running = false;
+static sim_result_t*  result;
+static File           out;  // Not open when the steps are not written
+static char           out_buffer[SIM_OUT_BUFFER_SIZE];
+static int            out_len;
+static uint64_t       time_ticks;    // Simulated time, in step timer ticks
+static uint64_t       drain_cycles;  // Spent in sim_drain(), so the parser time can leave it out
+static parser_state_t save_gc_state;
+
+bool sim_running() {
+    return running;
+}
+
+static void sim_flush() {
+    if (out_len && out) {
+        out.write((uint8_t*)out_buffer, out_len);
+        out_len = 0;
+    }
+}
+
+static void sim_write(const char* text, int len) {
+    if (out_len + len > SIM_OUT_BUFFER_SIZE) {
+        sim_flush();
+    }
+    memcpy(out_buffer + out_len, text, len);
+    out_len += len;
+}
+
+static void sim_record(const st_sim_segment_t* segment) {
+    for (int axis = 0; axis < motion_config.n_axis; axis++) {
+        result->steps += abs(segment->steps[axis]);
+    }
+    result->segments++;
+    if (!out) {
+        time_ticks += (uint64_t)segment->n_step * segment->isr_period;
+        return;
+    }
+    char     line[40 + 12 * MAX_N_AXIS];
+    uint64_t us  = time_ticks / ticksPerMicrosecond;
+    int      len = snprintf(line,
+                       sizeof(line),
+                       "%u.%06u,%u,%u,%u",
+                       (uint32_t)(us / 1000000),
+                       (uint32_t)(us % 1000000),
+                       segment->n_step,
+                       segment->isr_period,
+                       segment->amass_level);
+    for (int axis = 0; axis < motion_config.n_axis; axis++) {
+        len += snprintf(line + len, sizeof(line) - len, ",%d", segment->steps[axis]);
+    }
+    line[len++] = '\n';
+    sim_write(line, len);
+    time_ticks += (uint64_t)segment->n_step * segment->isr_period;
+}
+
+void sim_drain(bool all) {
+    uint32_t start_cycles = xthal_get_ccount();
+    uint8_t  queued       = plan_get_block_buffer_count();
+    int      stalled      = 0;
+    while (all ? plan_get_current_block() != NULL : plan_check_full_buffer()) {
+        uint32_t prep_start = xthal_get_ccount();
+        st_prep_buffer();
+        uint32_t step_start = xthal_get_ccount();
+        uint32_t n_segment  = st_sim_run(sim_record);
+        uint32_t step_end   = xthal_get_ccount();
+        result->prep_cycles += step_start - prep_start;
+        result->step_cycles += step_end - step_start;
+        // A block the prep cannot make segments from would otherwise keep this going forever
+        stalled = n_segment ? 0 : stalled + 1;
+        if (stalled == SIM_STALL_PASSES) {
+            break;
+        }
+    }
+    if (all) {
+        st_sim_run(sim_record);  // What the prep holds back for the end of the motion
+    }
+    result->blocks += queued - plan_get_block_buffer_count();  // Nothing is planned meanwhile
+    drain_cycles += xthal_get_ccount() - start_cycles;
+}
+
+// Setup shared by dry runs and check mode benchmarks. CheckMode keeps the spindle, coolant and
+// dwells out of it, as in gc_bench(). With dry_run, the motion is planned and stepped too.
+static Error sim_begin(sim_result_t* sim_result, bool dry_run) {
+    *sim_result = {};
+    if (sys.state != State::Idle || plan_get_current_block() != NULL) {
+        return Error::IdleError;
+    }
+    if (dry_run && !st_sim_begin()) {
+        return Error::AnotherInterfaceBusy;
+    }
+    result        = sim_result;
+    out_len       = 0;
+    time_ticks    = 0;
+    drain_cycles  = 0;
+    save_gc_state = gc_state;
+    sys.state     = State::CheckMode;
+    running       = dry_run;
+    return Error::Ok;
+}
+
+static void sim_end() {
+    if (running) {
+        mc_coalesce_flush();
+        sim_drain(true);
+        running = false;
+        st_sim_end();
+    }
+    sys.state       = State::Idle;
+    gc_state        = save_gc_state;
+    result->time_us = time_ticks / ticksPerMicrosecond;
+    sim_flush();
+}
+
+static void sim_line(char* line) {
+    result->lines++;
+    collapseGCode(line);
+    if (line[0] == '\0' || line[0] == '$' || line[0] == '[') {
+        return;  // Only g-code is dry run
+    }
+    uint64_t drain_before = drain_cycles;
+    uint32_t start_cycles = xthal_get_ccount();
+    if (execute_line(line, CLIENT_SERIAL, WebUI::AuthenticationLevel::LEVEL_ADMIN) != Error::Ok) {
+        result->errors++;
+    }
+    uint32_t cycles = xthal_get_ccount() - start_cycles;
+    result->parse_cycles += cycles - (drain_cycles - drain_before);
+}
+
+static void sim_line_handler(char* line, int len, void* arg) {
+    line[len] = '\0';
+    sim_line(line);
+}
+
+Error sim_file(fs::FS& fs, const char* path, sim_result_t* sim_result) {
+    File source = fs.open(path);
+    if (!source) {
+        *sim_result = {};
+        return Error::FsFileNotFound;
+    }
+    Error status = sim_begin(sim_result, true);
+    if (status != Error::Ok) {
+        source.close();
+        return status;
+    }
+    String out_path = String(path) + ".steps";
+    out             = fs.open(out_path.c_str(), FILE_WRITE);
+    if (!out) {
+        sim_end();
+        source.close();
+        return Error::FsFailedOpenFile;
+    }
+    char header[32 + 2 * MAX_N_AXIS];
+    int  len = snprintf(header, sizeof(header), "t,n_step,period,amass");
+    for (int axis = 0; axis < motion_config.n_axis; axis++) {
+        len += snprintf(header + len, sizeof(header) - len, ",%c", tolower(report_get_axis_letter(axis)));
+    }
+    header[len++] = '\n';
+    sim_write(header, len);
+
+    uint32_t n_lines;
+    status = sd_for_each_line(source, sim_line_handler, NULL, &n_lines, NULL, NULL);
+    sim_end();
+    out.close();
+    source.close();
+    return status;
+}
+
+const char* sim_workload_name(SimWorkload workload) {
+    switch (workload) {
+        case SimWorkload::Raster:
+            return "Raster";
+        case SimWorkload::Arcs:
+            return "Arcs";
+        case SimWorkload::Rapids:
+            return "Rapids";
+        case SimWorkload::LaserPower:
+            return "Laser S";
+        default:
+            return "?";
+    }
+}
+
+// Line i of a workload. The moves are incremental and go back and forth, so even a long run
+// stays within a few mm of where it started.
+static void sim_workload_line(SimWorkload workload, uint32_t i, char* line, size_t size) {
+    bool back = (i / 2) & 1;
+    switch (workload) {
+        case SimWorkload::Raster:  // 0.1 mm pixels, 200 to a row, as a laser engraving sends them
+            if (i % 201 == 200) {
+                snprintf(line, size, "G1Y0.1S0");
+            } else {
+                snprintf(line, size, "G1X%s0.1S%u", (i / 201) & 1 ? "-" : "", (i * 37) % 1000);
+            }
+            break;
+        case SimWorkload::Arcs:  // Half circles of 0.5 mm radius
+            snprintf(line, size, back ? "G3X-1Y0I-0.5J0" : "G2X1Y0I0.5J0");
+            break;
+        case SimWorkload::Rapids:
+            snprintf(line, size, "G0X%s20Y%s10", back ? "-" : "", back ? "-" : "");
+            break;
+        case SimWorkload::LaserPower:  // Power changes on their own lines between short cuts
+            if (i & 1) {
+                snprintf(line, size, "S%u", (i * 37) % 1000);
+            } else {
+                snprintf(line, size, "G1X%s1", back ? "-" : "");
+            }
+            break;
+        default:
+            line[0] = '\0';
+            break;
+    }
+}
+
+Error sim_bench(SimWorkload workload, uint16_t n_line, bool dry_run, sim_result_t* sim_result) {
+    Error status = sim_begin(sim_result, dry_run);
+    if (status != Error::Ok) {
+        return status;
+    }
+    char line[LINE_BUFFER_SIZE];
+    strcpy(line, "G21G91G94M4S0F6000");
+    sim_line(line);
+    *sim_result = {};  // The setup line is not part of the workload
+    for (uint32_t i = 0; i < n_line; i++) {
+        sim_workload_line(workload, i, line, sizeof(line));
+        sim_line(line);
+    }
+    sim_end();
+    return Error::Ok;
+}
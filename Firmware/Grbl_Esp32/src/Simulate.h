@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+  Simulate.h - Dry runs of a job through the parser, planner and step generator
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <FS.h>
+
+// A dry run feeds a file through execute_line(), the planner, st_prep_buffer() and
+// stepper_pulse_func() as fast as the CPU allows, with the motors, spindle and coolant
+// detached. Nothing waits on the step timer: whenever the planner fills, or the parser has to
+// wait for motion to finish, the segments are stepped right away from the calling task. The
+// result is the same step sequence a real run produces, in a fraction of the time, so planner
+// and parser changes can be compared on the same file.
+//
+// The steps of each segment go to path.steps as CSV, one line per segment:
+//
+//   t,n_step,period,amass,x,y,z...
+//
+// t is the simulated time in seconds at the start of the segment, period is in step timer
+// ticks per step event, and the axis columns are the steps taken in the segment.
+
+typedef struct {
+    uint32_t lines;
+    uint32_t errors;  // Lines execute_line() rejected
+    uint32_t blocks;  // Planner blocks stepped
+    uint32_t segments;
+    uint64_t steps;    // All axes
+    uint64_t time_us;  // Simulated motion time
+    uint64_t parse_cycles;
+    uint64_t prep_cycles;
+    uint64_t step_cycles;  // Includes writing the CSV
+} sim_result_t;
+
+// True while a dry run is going on; mc_line() and protocol_buffer_synchronize() call
+// sim_drain() instead of waiting for the stepper.
+bool sim_running();
+
+// Steps the planned motion until the planner has room for a block, or with all, until it is empty
+void sim_drain(bool all);
+
+// Dry runs the g-code file at path. The machine must be idle with nothing planned. The machine
+// position and the parser state are put back afterwards.
+Error sim_file(fs::FS& fs, const char* path, sim_result_t* result);
+
+// Built-in workloads for sim_bench(), generated on the fly so runs are the same on every machine
+enum class SimWorkload : uint8_t {
+    Raster,      // Short G1 moves with a power per pixel, as a laser engraving sends them
+    Arcs,        // Short G2/G3 arcs
+    Rapids,      // Long G0 moves
+    LaserPower,  // S words on their own lines between short cuts
+    Count,
+};
+
+const char* sim_workload_name(SimWorkload workload);
+
+// Runs n_line lines of a workload through execute_line() in check mode, or with dry_run, through
+// the planner and step generator as a dry run without writing the steps.
+Error sim_bench(SimWorkload workload, uint16_t n_line, bool dry_run, sim_result_t* result);
@@ -21,6 +21,8 @@
 */
 #include "Laser.h"
 
+#include <esp_heap_caps.h>
+
 // ===================================== Laser ==============================================
 
 namespace Spindles {
@@ -84,6 +86,56 @@ namespace Spindles {
         _piecewide_linear = false;
 
         _pwm_chan_num = 0;  // Channel 0 is reserved for spindle use
+
+        build_duty_curve();
+    }
+
+    // Tabulates $Laser/Curve and $Laser/PowerMin once per settings change, so each segment load
+    // looks the duty up instead of evaluating the curve. Material profiles are sets of these
+    // settings, as the sender keeps them. Without either, the straight line needs no table.
+    void Laser::build_duty_curve() {
+        auto  curve     = static_cast<LaserCurve>(laser_curve->get());
+        float power_min = laser_power_min->get() / 100.0f;
+        if (curve == LaserCurve::Linear && power_min <= 0.0f) {
+            _duty_curve = NULL;
+            return;
+        }
+        static uint32_t* table = NULL;  // Kept for good once allocated, the spindle objects are too
+        if (table == NULL) {
+            table = (uint32_t*)heap_caps_malloc((DUTY_CURVE_SIZE + 1) * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            if (table == NULL) {
+                grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Warning: No memory for the laser power curve");
+                _duty_curve = NULL;
+                return;
+            }
+        }
+        float gamma = laser_gamma->get();
+        for (int i = 0; i <= DUTY_CURVE_SIZE; i++) {
+            float power = float(i) / DUTY_CURVE_SIZE;
+            if (curve == LaserCurve::Gamma) {
+                power = powf(power, gamma);
+            }
+            power    = power_min + (1.0f - power_min) * power;
+            table[i] = uint32_t(lroundf(power * _pwm_period));
+        }
+        _curve_per_rpm = ((uint64_t)DUTY_CURVE_SIZE << 32) / 1000 + 1;
+        _duty_curve    = table;
+    }
+
+    // Starts the segment at rpm and lets the LEDC fade hardware carry the duty to end_rpm over
+    // usec, so power tracks speed through accelerations without any extra ISR work. Unlike
+    // PWM::set_rpm() there is no software sweep, which matters at once per segment.
+    void IRAM_ATTR Laser::set_rpm_ramp(uint32_t rpm, uint32_t end_rpm, uint32_t usec) {
+        if (_output_pin == UNDEFINED_PIN) {
+            return;
+        }
+
+        rpm               = limit_rpm(rpm);
+        end_rpm           = limit_rpm(end_rpm);
+        sys.spindle_speed = end_rpm;
+
+        set_enable_pin(gc_state.modal.spindle != SpindleState::Disable);
+        set_output_fade(duty_for_rpm(rpm), duty_for_rpm(end_rpm), usec);
     }
 
     void Laser::deinit() {
@@ -38,6 +38,10 @@ namespace Spindles {
         void config_message() override;
         void get_pins_and_settings() override;
         void deinit() override;
+        void set_rpm_ramp(uint32_t rpm, uint32_t end_rpm, uint32_t usec) override;
+
+    private:
+        void build_duty_curve();
 
         virtual ~Laser() {}
     };
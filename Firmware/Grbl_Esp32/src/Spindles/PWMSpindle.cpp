@@ -47,6 +47,10 @@ namespace Spindles {
         _current_pwm_duty = 0;
         use_delays        = true;
 
+        // Rounded up, so the multiply gives the same counts as calc_pwm_value()'s division
+        _duty_per_rpm = (((uint64_t)1 << _pwm_precision) << 32) / 1000 + 1;
+        _enable_level = -1;
+
         ledcSetup(_pwm_chan_num, (double)_pwm_freq, _pwm_precision);  // setup the channel
         ledcAttachPin(_output_pin, _pwm_chan_num);                    // attach the PWM to the pin
         pinMode(_enable_pin, OUTPUT);
@@ -120,12 +124,26 @@ namespace Spindles {
     }
 
     uint32_t PWM::calc_pwm_value(uint32_t input) {
+        if (_duty_curve != NULL && input != 0) {
+            return curve_duty(input);
+        }
         uint32_t output;
         output = 1 << _pwm_precision;
         output = (input * output) / 1000;
         return output;
     }
 
+    // Applies the spindle speed override and the rpm limits, as set_rpm() does
+    uint32_t IRAM_ATTR PWM::limit_rpm(uint32_t rpm) {
+        rpm = rpm * sys.spindle_speed_ovr / 100;  // Scale by spindle speed override value (uint8_t percent)
+        if ((_min_rpm >= _max_rpm) || (rpm >= _max_rpm)) {
+            rpm = _max_rpm;
+        } else if (rpm != 0 && rpm <= _min_rpm) {
+            rpm = _min_rpm;
+        }
+        return rpm;
+    }
+
     uint32_t PWM::set_rpm(uint32_t rpm) {
         // uint32_t pwm_value;
 
@@ -239,6 +257,44 @@ namespace Spindles {
         return 0;
     }
 
+    // The segment load path. set_rpm() sweeps the duty through every value in between, with
+    // delays, which cannot be done in the stepper ISR, so this goes straight to the new duty:
+    // the override and limits, one multiply and the LEDC registers, with the enable pin only
+    // written when its level changes. Falls back to set_rpm() for spindles derived from PWM
+    // that convert speed their own way, which skip PWM::init() and leave _duty_per_rpm at 0.
+    void IRAM_ATTR PWM::set_rpm_isr(uint32_t rpm) {
+        if (_duty_per_rpm == 0) {
+            set_rpm(rpm);
+            return;
+        }
+        if (_output_pin == UNDEFINED_PIN) {
+            return;
+        }
+
+        rpm               = limit_rpm(rpm);
+        sys.spindle_speed = rpm;
+
+        if (_enable_pin != UNDEFINED_PIN) {
+            bool enable = gc_state.modal.spindle != SpindleState::Disable;
+            if (_off_with_zero_speed && rpm == 0) {
+                enable = false;
+            }
+            if (spindle_enable_invert->get()) {
+                enable = !enable;
+            }
+            if (enable != _enable_level) {
+                digitalWrite(_enable_pin, enable);
+                _enable_level = enable;
+            }
+        }
+
+        uint32_t duty = duty_for_rpm(rpm);
+        if (duty != _current_pwm_duty) {
+            _current_pwm_duty = duty;
+            write_duty(duty);
+        }
+    }
+
     void PWM::set_state(SpindleState state, uint32_t rpm) {
         if (sys.abort) {
             return;  // Block during abort.
@@ -303,7 +359,11 @@ namespace Spindles {
         }
 
         _current_pwm_duty = duty;
+        write_duty(duty);
+    }
 
+    // Loads duty into the LEDC channel, cancelling any fade left by set_output_fade()
+    void IRAM_ATTR PWM::write_duty(uint32_t duty) {
         if (_invert_pwm) {
             duty = (1 << _pwm_precision) - duty;
         }
@@ -314,11 +374,62 @@ namespace Spindles {
         // and ledcWrite uses RTOS features not compatible with ISRs
         LEDC.channel_group[0].channel[0].duty.duty        = duty << 4;
         bool on                                           = !!duty;
+        LEDC.channel_group[0].channel[0].conf1.duty_num   = 1;  // Clear any fade left by set_output_fade()
+        LEDC.channel_group[0].channel[0].conf1.duty_cycle = 1;
+        LEDC.channel_group[0].channel[0].conf1.duty_scale = 0;
         LEDC.channel_group[0].channel[0].conf0.sig_out_en = on;
         LEDC.channel_group[0].channel[0].conf1.duty_start = on;
         LEDC.channel_group[0].channel[0].conf0.clk_en     = on;
     }
 
+    // Sets duty and has the LEDC hardware fade it to end_duty over usec. The fade adds or
+    // subtracts duty_scale (in 1/16 counts) every duty_cycle PWM periods, duty_num times, so
+    // the duty moves once per PWM period for segments up to 1023 periods long.
+    void IRAM_ATTR PWM::set_output_fade(uint32_t duty, uint32_t end_duty, uint32_t usec) {
+        const uint32_t fade_field_max = 1023;  // duty_num, duty_cycle and duty_scale are 10 bits
+
+        if (_output_pin == UNDEFINED_PIN) {
+            return;
+        }
+
+        uint32_t periods = (uint64_t)usec * _pwm_freq / 1000000;
+        if (duty == end_duty || periods == 0) {
+            set_output(end_duty);
+            return;
+        }
+        _current_pwm_duty = end_duty;
+
+        if (_invert_pwm) {
+            duty     = (1 << _pwm_precision) - duty;
+            end_duty = (1 << _pwm_precision) - end_duty;
+        }
+
+        bool     increase = end_duty > duty;
+        uint32_t change   = (increase ? end_duty - duty : duty - end_duty) << 4;
+        uint32_t num      = periods < fade_field_max ? periods : fade_field_max;
+        uint32_t scale    = change / num;
+        if (scale == 0) {
+            // Less change than periods, so step one count at longer intervals
+            num   = change;
+            scale = 1;
+        } else if (scale > fade_field_max) {
+            scale = fade_field_max;  // The fade falls short, the next segment starts from its own value
+        }
+        uint32_t cycle = periods / num;
+        if (cycle > fade_field_max) {
+            cycle = fade_field_max;
+        }
+
+        LEDC.channel_group[0].channel[0].duty.duty        = duty << 4;
+        LEDC.channel_group[0].channel[0].conf1.duty_inc   = increase;
+        LEDC.channel_group[0].channel[0].conf1.duty_num   = num;
+        LEDC.channel_group[0].channel[0].conf1.duty_cycle = cycle;
+        LEDC.channel_group[0].channel[0].conf1.duty_scale = scale;
+        LEDC.channel_group[0].channel[0].conf0.sig_out_en = 1;
+        LEDC.channel_group[0].channel[0].conf1.duty_start = 1;
+        LEDC.channel_group[0].channel[0].conf0.clk_en     = 1;
+    }
+
     void PWM::set_enable_pin(bool enable) {
         // static bool prev_enable = false;
 
@@ -341,6 +452,7 @@ namespace Spindles {
         }
 
         digitalWrite(_enable_pin, enable);
+        _enable_level = enable;
     }
 
     void PWM::set_dir_pin(bool Clockwise) { digitalWrite(_direction_pin, Clockwise); }
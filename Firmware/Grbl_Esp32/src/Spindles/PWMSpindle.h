@@ -36,11 +36,13 @@ namespace Spindles {
 
         void             init() override;
         virtual uint32_t set_rpm(uint32_t rpm) override;
+        void             set_rpm_isr(uint32_t rpm) override;
         void             set_state(SpindleState state, uint32_t rpm) override;
         SpindleState     get_state() override;
         void             stop() override;
         void             config_message() override;
         uint32_t        calc_pwm_value(uint32_t input);
+        uint32_t        limit_rpm(uint32_t rpm);
         virtual ~PWM() {}
 
     protected:
@@ -61,9 +63,28 @@ namespace Spindles {
         bool     _off_with_zero_speed;
         bool     _invert_pwm;
         //uint32_t _pwm_gradient; // Precalulated value to speed up rpm to PWM conversions.
+        uint64_t _duty_per_rpm = 0;   // calc_pwm_value() as a 32.32 fixed point multiplier, 0 when init() did not set it
+        // Duty for power/1000 at a step of 1/DUTY_CURVE_SIZE, NULL for the straight line. In DRAM for the ISR.
+        static const int DUTY_CURVE_SIZE = 1024;
+        uint32_t*        _duty_curve     = NULL;
+        uint64_t         _curve_per_rpm  = 0;  // Curve entries per rpm, 32.32 fixed point
+        int8_t   _enable_level = -1;  // Last level written to the enable pin, -1 before the first write
 
         virtual void set_dir_pin(bool Clockwise);
         virtual void set_output(uint32_t duty);
+        void         write_duty(uint32_t duty);
+        // calc_pwm_value() through _duty_per_rpm, or the off value for 0. Only after PWM::init().
+        uint32_t duty_for_rpm(uint32_t rpm) const {
+            if (rpm == 0) {
+                return _pwm_off_value;
+            }
+            return _duty_curve ? curve_duty(rpm) : (uint32_t)((rpm * _duty_per_rpm) >> 32);
+        }
+        uint32_t curve_duty(uint32_t rpm) const {
+            uint64_t index = (rpm * _curve_per_rpm) >> 32;
+            return _duty_curve[index < DUTY_CURVE_SIZE ? index : DUTY_CURVE_SIZE];
+        }
+        void         set_output_fade(uint32_t duty, uint32_t end_duty, uint32_t usec);
         virtual void set_enable_pin(bool enable_pin);
         virtual void deinit();
 
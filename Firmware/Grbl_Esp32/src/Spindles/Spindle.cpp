@@ -106,7 +106,24 @@ namespace Spindles {
         set_state(state, rpm);
     }
 
+    // Called from the stepper ISR at the start of a segment whose laser power follows speed,
+    // with the power at both ends and the segment time. Spindles that can only be set go
+    // straight to the end value, as set_rpm() did before.
+    void Spindle::set_rpm_ramp(uint32_t rpm, uint32_t end_rpm, uint32_t usec) { set_rpm(end_rpm); }
+
+    // Spindles without a fast path set the speed the usual way
+    void Spindle::set_rpm_isr(uint32_t rpm) { set_rpm(rpm); }
+
     void Spindle::deinit() { stop(); }
 }
 
  Spindles::Spindle* spindle;
+
+spindle_sync_stats_t spindle_sync_stats;
+
+void spindle_sync_add(uint32_t ms) {
+    spindle_sync_stats.count++;
+    spindle_sync_stats.last_ms = ms;
+    spindle_sync_stats.max_ms  = MAX(spindle_sync_stats.max_ms, ms);
+    spindle_sync_stats.total_ms += ms;
+}
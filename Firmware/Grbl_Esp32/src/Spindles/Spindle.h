@@ -41,6 +41,12 @@ enum class SpindleType : int8_t {
     YL620,
 };
 
+// Power to duty mapping of the laser, from $Laser/Curve
+enum class LaserCurve : int8_t {
+    Linear = 0,
+    Gamma,  // Power raised to $Laser/Gamma, for grayscale that darkens evenly
+};
+
 #include "../Grbl.h"
 #include <driver/dac.h>
 #include <driver/uart.h>
@@ -67,6 +73,8 @@ namespace Spindles {
         virtual void         config_message()                            = 0;
         virtual bool         inLaserMode();
         virtual void         sync(SpindleState state, uint32_t rpm);
+        virtual void         set_rpm_ramp(uint32_t rpm, uint32_t end_rpm, uint32_t usec);
+        virtual void         set_rpm_isr(uint32_t rpm);  // From the stepper ISR at segment load, must not block
         virtual void         deinit();
 
         virtual ~Spindle() {}
@@ -83,3 +91,15 @@ namespace Spindles {
 }
 
 extern Spindles::Spindle* spindle;
+
+// How long set_state() waited for a spindle with speed feedback to reach the programmed speed
+typedef struct {
+    uint32_t count;
+    uint32_t timeouts;  // Gave up waiting, with an alarm or the fixed delay
+    uint32_t last_ms;
+    uint32_t max_ms;
+    uint64_t total_ms;
+} spindle_sync_stats_t;
+extern spindle_sync_stats_t spindle_sync_stats;
+
+void spindle_sync_add(uint32_t ms);
@@ -38,15 +38,20 @@
 
 // Timing and modbus... The manual states that between communications, we should respect a
 // silent interval of 3,5 characters. If we received communications between these times, we
-// have to assume that the message is broken. We use a poll rate of 250 ms here, which should
-// be plenty: assuming 9600 8N1, that's roughly 250 chars. A message of 2x16 chars with 4x4
-// chars buffering is just 40 chars.
+// have to assume that the message is broken. At 9600 8N1 that is under 4 ms, so commands go
+// out back to back with VFD_RS485_FRAME_GAP between them.
+//
+// Commands are sent in priority order: mode changes, in the order they were queued, then the
+// latest speed, then the polls. Polls wait VFD_RS485_POLL_RATE between them while the spindle
+// runs, but only VFD_RS485_POLL_FAST while set_state() waits for it to reach speed, and
+// VFD_RS485_POLL_IDLE while it is off. A queued command wakes the task right away.
 
 const int        VFD_RS485_UART_PORT  = 2;  // hard coded for this port right now
 const int        VFD_RS485_BUF_SIZE   = 127;
 const int        VFD_RS485_QUEUE_SIZE = 10;                                         // numv\ber of commands that can be queued up.
 const int        RESPONSE_WAIT_MILLIS = 1000;                                       // how long to wait for a response in milliseconds
-const int        VFD_RS485_POLL_RATE  = 250;                                        // in milliseconds between commands
+const int        VFD_RS485_FRAME_GAP  = 5;                                          // in milliseconds between messages
+const int        VFD_SYNC_DWELL       = 100;                                        // in milliseconds between speed checks in set_state()
 const TickType_t response_ticks       = RESPONSE_WAIT_MILLIS / portTICK_PERIOD_MS;  // in milliseconds between commands
 
 // OK to change these
@@ -54,10 +59,20 @@ const TickType_t response_ticks       = RESPONSE_WAIT_MILLIS / portTICK_PERIOD_M
 #ifndef VFD_RS485_ADDR
 #    define VFD_RS485_ADDR 0x01
 #endif
+#ifndef VFD_RS485_POLL_RATE
+#    define VFD_RS485_POLL_RATE 250  // in milliseconds between polls at steady speed
+#endif
+#ifndef VFD_RS485_POLL_FAST
+#    define VFD_RS485_POLL_FAST 20  // in milliseconds between polls while spinning up or down
+#endif
+#ifndef VFD_RS485_POLL_IDLE
+#    define VFD_RS485_POLL_IDLE 1000  // in milliseconds between polls while the spindle is off
+#endif
 
 namespace Spindles {
     Uart          _uart(VFD_RS485_UART_PORT);
     QueueHandle_t VFD::vfd_cmd_queue     = nullptr;
+    QueueHandle_t VFD::vfd_speed_queue   = nullptr;
     TaskHandle_t  VFD::vfd_cmdTaskHandle = nullptr;
 
     VFD::VFD() :
@@ -109,7 +124,8 @@ namespace Spindles {
         bool          safetyPollingEnabled = instance->safety_polling();
 
         while (true) {
-            response_parser parser = nullptr;
+            response_parser parser  = nullptr;
+            bool            polling = false;
 
             next_cmd.msg[0] = VFD_RS485_ADDR;  // Always default to this
 
@@ -122,8 +138,11 @@ namespace Spindles {
                 next_cmd.critical = false;
             }
 
-            // If we don't have a parser, the queue goes first. During idle, we can grab a parser.
-            if (parser == nullptr && xQueueReceive(vfd_cmd_queue, &next_cmd, 0) != pdTRUE) {
+            // If we don't have a parser, the queues go first. During idle, we can grab a parser.
+            if (parser == nullptr && xQueueReceive(vfd_cmd_queue, &next_cmd, 0) != pdTRUE &&
+                xQueueReceive(vfd_speed_queue, &next_cmd, 0) != pdTRUE) {
+                polling = true;
+
                 // We poll in a cycle. Note that the switch will fall through unless we encounter a hit.
                 // The weakest form here is 'get_status_ok' which should be implemented if the rest fails.
                 if (instance->_syncing) {
@@ -158,7 +177,7 @@ namespace Spindles {
                 // If we have no parser, that means get_status_ok is not implemented (and we have
                 // nothing resting in our queue). Let's fall back on a simple continue.
                 if (parser == nullptr) {
-                    vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS);
+                    wait_for_command(instance->poll_interval());
                     continue;  // main while loop
                 }
             }
@@ -266,6 +285,13 @@ namespace Spindles {
                     }
 #endif
 
+                    // A failed poll is not worth holding up a new command for. It is polled
+                    // again later, and it is the command that tells if the VFD is there.
+                    if (polling && command_waiting()) {
+                        retry_count = MAX_RETRIES + 1;
+                        break;
+                    }
+
                     // Wait a bit before we retry. Set the delay to poll-rate. Not sure
                     // if we should use a different value...
                     vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS);
@@ -288,8 +314,37 @@ namespace Spindles {
                 }
             }
 
-            vTaskDelay(VFD_RS485_POLL_RATE / portTICK_PERIOD_MS);
+            vTaskDelay(VFD_RS485_FRAME_GAP / portTICK_PERIOD_MS);
+            wait_for_command(instance->poll_interval() - VFD_RS485_FRAME_GAP);
+        }
+    }
+
+    bool VFD::command_waiting() { return uxQueueMessagesWaiting(vfd_cmd_queue) != 0 || uxQueueMessagesWaiting(vfd_speed_queue) != 0; }
+
+    // Sleeps until the next poll is due, or until a command is queued
+    void VFD::wait_for_command(int32_t millis) {
+        ulTaskNotifyTake(pdTRUE, 0);  // Left over from a command that was already sent
+        if (millis > 0 && !command_waiting()) {
+            ulTaskNotifyTake(pdTRUE, millis / portTICK_PERIOD_MS);
+        }
+    }
+
+    void VFD::wake_task() {
+        if (vfd_cmdTaskHandle == nullptr) {
+            return;
+        }
+        if (xPortInIsrContext()) {
+            vTaskNotifyGiveFromISR(vfd_cmdTaskHandle, NULL);
+        } else {
+            xTaskNotifyGive(vfd_cmdTaskHandle);
+        }
+    }
+
+    int32_t VFD::poll_interval() const {
+        if (_syncing) {
+            return VFD_RS485_POLL_FAST;
         }
+        return _current_state == SpindleState::Disable ? VFD_RS485_POLL_IDLE : VFD_RS485_POLL_RATE;
     }
 
     // ================== Class methods ==================================
@@ -335,7 +390,8 @@ namespace Spindles {
 
         // Initialization is complete, so now it's okay to run the queue task:
         if (!_task_running) {  // init can happen many times, we only want to start one task
-            vfd_cmd_queue = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(ModbusCommand));
+            vfd_cmd_queue   = xQueueCreate(VFD_RS485_QUEUE_SIZE, sizeof(ModbusCommand));
+            vfd_speed_queue = xQueueCreate(1, sizeof(ModbusCommand));  // Only the latest speed is sent
             xTaskCreatePinnedToCore(vfd_cmd_task,         // task
                                     "vfd_cmdTaskHandle",  // name for task
                                     2048,                 // size of task stack
@@ -443,11 +499,12 @@ namespace Spindles {
         }
 
         if (shouldWait) {
-            if (supports_actual_rpm()) {
+            if (supports_actual_rpm() && spindle_at_speed_tolerance->get() > 0) {
                 _syncing = true;
+                wake_task();  // Start the fast polls now
 
-                // Allow 2.5% difference from what we asked for. Should be fine.
-                uint32_t drpm = (_max_rpm - _min_rpm) / 40;
+                // $Spindle/AtSpeed/Tolerance is a percentage of the speed range
+                uint32_t drpm = uint32_t((_max_rpm - _min_rpm) * spindle_at_speed_tolerance->get() / 100.0);
                 if (drpm < 100) {
                     drpm = 100;
                 }  // Just a sanity check
@@ -455,30 +512,37 @@ namespace Spindles {
                 auto minRpmAllowed = _current_rpm > drpm ? (_current_rpm - drpm) : 0;
                 auto maxRpmAllowed = _current_rpm + drpm;
 
-                int       unchanged = 0;
-                const int limit     = 20;  // 20 * 0.5s = 10 sec
-                auto      last      = _sync_rpm;
+                uint32_t start   = millis();
+                uint32_t timeout = uint32_t(spindle_at_speed_timeout->get() * 1000.0);
+                bool     waited  = false;
+                bool     reached = true;
 
-                while ((_sync_rpm < minRpmAllowed || _sync_rpm > maxRpmAllowed) && unchanged < limit) {
+                while (_sync_rpm < minRpmAllowed || _sync_rpm > maxRpmAllowed) {
 #ifdef VFD_DEBUG_MODE
                     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Syncing RPM. Requested %d, current %d", int(rpm), int(_sync_rpm));
 #endif
-                    if (!mc_dwell(500)) {
-                        // Something happened while we were dwelling, like a safety door.
-                        unchanged = limit;
-                        last      = _sync_rpm;
+                    waited = true;
+                    if (!mc_dwell(VFD_SYNC_DWELL) || millis() - start >= timeout) {
+                        // Timed out, or something happened while we were dwelling, like a safety door.
+                        reached = false;
                         break;
                     }
-
-                    if (_sync_rpm == last) {
-                        ++unchanged;
-                    } else {
-                        unchanged = 0;
-                    }
-                    last = _sync_rpm;
                 }
+                uint32_t elapsed = millis() - start;
 
-                if (unchanged == limit) {
+                if (reached) {
+                    if (waited) {
+                        spindle_sync_add(elapsed);
+                    }
+                } else if (_sync_rpm == UINT32_MAX && !sys.abort) {
+                    // The VFD never reported a speed. Fall back on the fixed delay.
+                    spindle_sync_stats.timeouts++;
+                    grbl_msg_sendf(CLIENT_ALL, MsgLevel::Warning, "VFD reported no speed, using the spin delay");
+                    if (uint32_t(delayMillis) > elapsed) {
+                        delay(delayMillis - elapsed);
+                    }
+                } else {
+                    spindle_sync_stats.timeouts++;
                     grbl_msg_sendf(CLIENT_ALL,
                                    MsgLevel::Error,
                                    "Critical Spindle RS485 did not reach speed %d. Reported speed is %d rpm.",
@@ -511,7 +575,7 @@ namespace Spindles {
         direction_command(mode, mode_cmd);
 
         if (mode == SpindleState::Disable) {
-            if (!xQueueReset(vfd_cmd_queue)) {
+            if (!xQueueReset(vfd_cmd_queue) || !xQueueReset(vfd_speed_queue)) {
                 grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "VFD spindle off, queue could not be reset");
             }
         }
@@ -522,6 +586,7 @@ namespace Spindles {
         if (xQueueSend(vfd_cmd_queue, &mode_cmd, 0) != pdTRUE) {
             grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "VFD Queue Full");
         }
+        wake_task();
 
         return true;
     }
@@ -573,9 +638,13 @@ namespace Spindles {
 
         rpm_cmd.critical = (rpm == 0);
 
-        if (xQueueSend(vfd_cmd_queue, &rpm_cmd, 0) != pdTRUE) {
-            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "VFD Queue Full");
+        // A speed that was not sent yet is replaced; sending it would only slow down this one
+        if (xPortInIsrContext()) {
+            xQueueOverwriteFromISR(vfd_speed_queue, &rpm_cmd, NULL);
+        } else {
+            xQueueOverwrite(vfd_speed_queue, &rpm_cmd);
         }
+        wake_task();
 
         return rpm;
     }
@@ -590,6 +659,27 @@ namespace Spindles {
     // state is cached rather than read right now to prevent delays
     SpindleState VFD::get_state() { return _current_state; }
 
+    // CRC-16/MODBUS (reflected polynomial 0xA001) of each byte value, so the CRC takes one
+    // lookup per byte instead of eight shifts
+    static const uint16_t crc_table[256] = {
+        0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241, 0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+        0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40, 0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+        0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40, 0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+        0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641, 0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+        0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240, 0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+        0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41, 0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+        0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41, 0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+        0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640, 0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+        0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240, 0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+        0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41, 0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+        0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41, 0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+        0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640, 0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+        0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241, 0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+        0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40, 0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+        0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40, 0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+        0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641, 0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+    };
+
     // Calculate the CRC on all of the byte except the last 2
     // It then added the CRC to those last 2 bytes
     // full_msg_len This is the length of the message including the 2 crc bytes
@@ -597,16 +687,7 @@ namespace Spindles {
     uint16_t VFD::ModRTU_CRC(uint8_t* buf, int msg_len) {
         uint16_t crc = 0xFFFF;
         for (int pos = 0; pos < msg_len; pos++) {
-            crc ^= uint16_t(buf[pos]);  // XOR byte into least sig. byte of crc.
-
-            for (int i = 8; i != 0; i--) {  // Loop over each bit
-                if ((crc & 0x0001) != 0) {  // If the LSB is set
-                    crc >>= 1;              // Shift right and XOR 0xA001
-                    crc ^= 0xA001;
-                } else {        // Else LSB is not set
-                    crc >>= 1;  // Just shift right
-                }
-            }
+            crc = (crc >> 8) ^ crc_table[(crc ^ buf[pos]) & 0xFF];
         }
 
         return crc;
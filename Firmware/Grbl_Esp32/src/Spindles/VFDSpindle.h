@@ -43,9 +43,15 @@ namespace Spindles {
         bool     _task_running = false;
         bool     vfd_ok        = true;
 
-        static QueueHandle_t vfd_cmd_queue;
+        static QueueHandle_t vfd_cmd_queue;    // Mode changes, sent in order
+        static QueueHandle_t vfd_speed_queue;  // The latest speed, sent after the mode changes
         static TaskHandle_t  vfd_cmdTaskHandle;
         static void          vfd_cmd_task(void* pvParameters);
+        static bool          command_waiting();
+        static void          wait_for_command(int32_t millis);
+        static void          wake_task();
+
+        int32_t poll_interval() const;  // in milliseconds, from the spindle state
 
         static uint16_t ModRTU_CRC(uint8_t* buf, int msg_len);
 
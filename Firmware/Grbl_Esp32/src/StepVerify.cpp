@@ -0,0 +1,159 @@
+/*
+  StepVerify.cpp - Hardware count of the step pulses sent, to catch dropped steps
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#ifdef USE_STEP_PCNT
+#    include <driver/pcnt.h>
+#    include <soc/pcnt_struct.h>
+#    include <soc/gpio_sig_map.h>
+#    include <rom/gpio.h>
+
+static AxisMask                      counted_axes;  // Axes with a PCNT unit, the unit number is the axis
+static DRAM_ATTR int16_t             last_raw[MAX_N_AXIS];
+static DRAM_ATTR int32_t             counted[MAX_N_AXIS];  // Steps counted since step_verify_sync()
+static DRAM_ATTR int32_t             base[MAX_N_AXIS];     // sys_position that counted[] is relative to
+static DRAM_ATTR step_verify_stats_t stats;
+static volatile AxisMask             failed_axes;             // Not reported yet
+static DRAM_ATTR int32_t             failed_lost[MAX_N_AXIS];  // Steps lost in the failures not reported yet
+static portMUX_TYPE                  failed_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// The counter goes back to 0 when it reaches either limit, so it runs mod 32767 going up and
+// mod 32768 going down. Read at every segment end, it never moves anywhere near that far.
+static inline int32_t IRAM_ATTR pcnt_delta(uint8_t axis) {
+    int16_t raw   = PCNT.cnt_unit[axis].cnt_val;
+    int32_t delta = int32_t(raw) - last_raw[axis];
+    last_raw[axis] = raw;
+    if (delta < -16384) {
+        delta += 32767;
+    } else if (delta > 16384) {
+        delta -= 32768;
+    }
+    return delta;
+}
+
+// Steps in sys_position that the next ISR sends
+static inline int32_t IRAM_ATTR pending_steps(uint8_t axis, uint8_t pending_bits, uint8_t direction_bits) {
+    if (!bitnum_istrue(pending_bits, axis)) {
+        return 0;
+    }
+    return bitnum_istrue(direction_bits, axis) ? -1 : 1;
+}
+
+void step_verify_init() {
+    counted_axes = 0;
+    auto n_axis  = number_axis->get();
+    for (uint8_t axis = X_AXIS; axis < n_axis && axis < PCNT_UNIT_MAX; axis++) {
+        uint8_t step_pin, dir_pin;
+        bool    invert_step, invert_dir;
+        if (!motors_step_gpio(axis, step_pin, dir_pin, invert_step, invert_dir)) {
+            continue;
+        }
+        pcnt_config_t config  = {};
+        config.pulse_gpio_num = PCNT_PIN_NOT_USED;  // Routed below, pcnt_unit_config() would make them inputs
+        config.ctrl_gpio_num  = PCNT_PIN_NOT_USED;
+        config.channel        = PCNT_CHANNEL_0;
+        config.unit           = pcnt_unit_t(axis);
+        config.pos_mode       = invert_step ? PCNT_COUNT_DIS : PCNT_COUNT_INC;  // Count the leading edge of the pulse
+        config.neg_mode       = invert_step ? PCNT_COUNT_INC : PCNT_COUNT_DIS;
+        // A set direction bit is negative travel, and the pin level is the bit ^ invert_dir
+        config.hctrl_mode    = invert_dir ? PCNT_MODE_KEEP : PCNT_MODE_REVERSE;
+        config.lctrl_mode    = invert_dir ? PCNT_MODE_REVERSE : PCNT_MODE_KEEP;
+        config.counter_h_lim = INT16_MAX;
+        config.counter_l_lim = INT16_MIN;
+        if (pcnt_unit_config(&config) != ESP_OK) {
+            continue;
+        }
+        pcnt_filter_disable(config.unit);  // Step pulses can be shorter than the filter allows
+
+        // Listen to the output pins through the GPIO matrix. Units 5 to 7 come after a gap.
+        int offset = 4 * axis + (axis > 4 ? 12 : 0);
+        PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[step_pin]);
+        PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[dir_pin]);
+        gpio_matrix_in(step_pin, PCNT_SIG_CH0_IN0_IDX + offset, false);
+        gpio_matrix_in(dir_pin, PCNT_CTRL_CH0_IN0_IDX + offset, false);
+
+        pcnt_counter_clear(config.unit);
+        pcnt_counter_resume(config.unit);
+        bitnum_true(counted_axes, axis);
+    }
+    step_verify_sync(0, 0);
+    if (counted_axes) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Step count check on axis mask 0x%02x", counted_axes);
+    }
+}
+
+void step_verify_sync(uint8_t pending_bits, uint8_t direction_bits) {
+    for (uint8_t axis = X_AXIS; axis < MAX_N_AXIS; axis++) {
+        if (bitnum_istrue(counted_axes, axis)) {
+            last_raw[axis] = PCNT.cnt_unit[axis].cnt_val;
+            counted[axis]  = 0;
+            base[axis]     = sys_position[axis] + pending_steps(axis, pending_bits, direction_bits);
+        }
+    }
+}
+
+void IRAM_ATTR step_verify_check(uint8_t pending_bits, uint8_t direction_bits) {
+    bool error = false;
+    for (uint8_t axis = X_AXIS; axis < MAX_N_AXIS; axis++) {
+        if (!bitnum_istrue(counted_axes, axis)) {
+            continue;
+        }
+        counted[axis] += pcnt_delta(axis);
+        int32_t lost = sys_position[axis] + pending_steps(axis, pending_bits, direction_bits) - base[axis] - counted[axis];
+        if (lost != 0) {
+            error = true;
+            stats.lost[axis] += lost;
+            base[axis] += lost;  // Compare from here on, so one loss is reported once
+            portENTER_CRITICAL_ISR(&failed_mux);
+            failed_lost[axis] += lost;
+            failed_axes |= bit(axis);
+            portEXIT_CRITICAL_ISR(&failed_mux);
+        }
+    }
+    stats.checks++;
+    if (error) {
+        stats.errors++;
+    }
+}
+
+void step_verify_report() {
+    AxisMask failed = failed_axes;
+    if (failed == 0) {
+        return;
+    }
+    for (uint8_t axis = X_AXIS; axis < MAX_N_AXIS; axis++) {
+        if (bitnum_istrue(failed, axis)) {
+            portENTER_CRITICAL(&failed_mux);
+            int32_t lost      = failed_lost[axis];
+            failed_lost[axis] = 0;
+            failed_axes &= ~bit(axis);
+            portEXIT_CRITICAL(&failed_mux);
+            grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "%s step count off by %d", reportAxisNameMsg(axis), lost);
+        }
+    }
+}
+
+void step_verify_stats_get(step_verify_stats_t* out) {
+    *out = stats;
+}
+
+void step_verify_stats_reset() {
+    memset(&stats, 0, sizeof(stats));
+}
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+  StepVerify.h - Hardware count of the step pulses sent, to catch dropped steps
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// With USE_STEP_PCNT, a PCNT unit per axis counts the pulses on the step pin of the axis's
+// first motor, up or down following its direction pin. At the end of each step segment, the
+// timed stepper compares the count with sys_position, which only says what Grbl meant to send.
+// Axes whose step or direction pin is not a GPIO, on I2S for example, are not counted.
+
+typedef struct {
+    uint32_t checks;              // Segment ends compared
+    uint32_t errors;              // Comparisons where some axis was off
+    int32_t  lost[MAX_N_AXIS];    // Commanded minus counted steps, summed over the errors
+} step_verify_stats_t;
+
+// Routes the step and direction pins to the PCNT units. Called after the motors set up their pins.
+void step_verify_init();
+
+// Restarts the comparison from the current position, before the stepper starts moving. Steps in
+// pending_bits are counted in sys_position but not sent yet.
+void step_verify_sync(uint8_t pending_bits, uint8_t direction_bits);
+
+// Compares the counts with sys_position. Called by the stepper ISR at the end of a segment.
+void step_verify_check(uint8_t pending_bits, uint8_t direction_bits);
+
+// Reports axes that went off since the last call. Called from a task.
+void step_verify_report();
+
+void step_verify_stats_get(step_verify_stats_t* stats);
+void step_verify_stats_reset();
@@ -26,13 +26,12 @@
 #include "Grbl.h"
 
 #include <atomic>
-
-// Import the step counting variable
-extern bool step_counting_enabled;
+#include <xtensa/core-macros.h>
+#include <esp_ipc.h>
 
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment
 // buffer. Normally, this buffer is partially in-use, but, for the worst case scenario, it will
-// never exceed the number of accessible stepper buffer segments (SEGMENT_BUFFER_SIZE-1).
+// never exceed the number of accessible stepper buffer segments (segment_buffer_size-1).
 // NOTE: This data is copied from the prepped planner blocks so that the planner blocks may be
 // discarded when entirely consumed and completed by the segment buffer. Also, AMASS alters this
 // data for its own use.
@@ -41,21 +40,96 @@ typedef struct {
     uint32_t step_event_count;
     uint8_t  direction_bits;
     uint8_t  is_pwm_rate_adjusted;  // Tracks motions that require constant laser power/rate
+    uint8_t  is_raster;             // Laser power follows a raster row, see Raster.h
+    uint32_t pulse_increment;       // Laser pulses per step_event_count unit, as a 0.32 fraction. 0 when not pulsed.
+    uint8_t  outputs;               // Queued output changes to apply as the block starts, see Planner.h
 } st_block_t;
-static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE - 1];
+static st_block_t* st_block_buffer;  // segment_buffer_size - 1 entries, allocated by stepper_init()
 
 // Primary stepper segment ring buffer. Contains small, short line segments for the stepper
 // algorithm to execute, which are "checked-out" incrementally from the first block in the
 // planner buffer. Once "checked-out", the steps in the segments buffer cannot be modified by
 // the planner, where the remaining planner block steps still can.
 typedef struct {
-    uint16_t n_step;          // Number of step events to be executed for this segment
-    uint16_t isrPeriod;       // Time to next ISR tick, in units of timer ticks
-    uint8_t  st_block_index;  // Stepper block data index. Uses this information to execute this segment.
-    uint8_t  amass_level;     // AMASS level for the ISR to execute this segment
-    uint16_t spindle_rpm;     // TODO get rid of this.
+    uint32_t n_step;             // Number of step events to be executed for this segment
+    uint32_t isrPeriod;          // Time to next ISR tick, in units of timer ticks
+    uint8_t  st_block_index;     // Stepper block data index. Uses this information to execute this segment.
+    uint8_t  amass_level;        // AMASS level for the ISR to execute this segment
+    uint16_t spindle_rpm;        // TODO get rid of this.
+    uint16_t spindle_rpm_start;  // Rate adjusted spindle_rpm at the start of the segment, for dynamic laser power
 } segment_t;
-static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
+static segment_t* segment_buffer;  // segment_buffer_size entries, allocated by stepper_init()
+
+// Unshaped timing of the segments waiting for the input shaper, indexed like segment_buffer
+typedef struct {
+    float    inv_rate;   // Step time as generated (min/step)
+    float    dt;         // Duration as generated (min)
+    float    mm;         // Length along the path (mm)
+    uint16_t rpm_limit;  // Block spindle speed, the most a rate adjusted laser is raised to
+} segment_shaping_t;
+static segment_shaping_t* segment_shaping;  // Not in the ISR's way, so in any heap
+
+// Prep state at the end of each queued segment, indexed like segment_buffer, so a feed hold can
+// drop the segments after the executing one and prep its deceleration from there
+typedef struct {
+    float mm_remaining;     // pl_block->millimeters
+    float steps_remaining;  // prep.steps_remaining
+    float dt_remainder;     // prep.dt_remainder
+    float speed;            // prep.current_speed
+} segment_resume_t;
+static segment_resume_t* segment_resume;  // NULL disables hold truncation
+
+// The segments of a block as generated, replayed for later blocks with the same profile inputs.
+// Only the timing is shared: each block still loads its own steps and direction bits into its
+// st_block_t. Rows of a raster, back and forth with the same feed, are the usual case.
+typedef struct {
+    uint32_t step_event_count;
+    float    millimeters;
+    float    entry_speed;  // prep.current_speed at the load
+    float    entry_speed_sqr;
+    float    exit_speed_sqr;
+    float    nominal_speed;
+    float    acceleration;
+    float    dt_segment;
+    bool     s_curve;
+} segment_profile_key_t;
+
+typedef struct {
+    float dt;            // Segment time before the partial step carry (min)
+    float mm_remaining;  // At the end of the segment
+    float speed;         // prep.current_speed at the end of the segment
+} segment_profile_step_t;
+
+typedef struct {
+    segment_profile_key_t key;
+    uint32_t              used;  // profile_loads when last found or recorded, 0 for free
+    uint16_t              n_segment;
+    bool                  complete;  // Recorded up to the end of the block
+    // The profile computed at the load
+    uint8_t                ramp_type;
+    bool                   decel_override;
+    float                  mm_complete;
+    float                  exit_speed;
+    float                  maximum_speed;
+    float                  accelerate_until;
+    float                  decelerate_after;
+    segment_profile_step_t segment[SEGMENT_PROFILE_SEGMENTS];
+} segment_profile_t;
+static segment_profile_t* segment_profiles;  // SEGMENT_PROFILE_CACHE entries, NULL disables reuse
+static segment_profile_t* profile_record;    // Taking the segments of the prepped block
+static segment_profile_t* profile_replay;    // Giving the segments of the prepped block
+static uint16_t           profile_next;      // Next segment of profile_replay
+static uint32_t           profile_loads;
+
+static void st_profile_cancel();
+
+// Execution time of a segment. AMASS scales n_step and isrPeriod in opposite directions.
+static inline uint32_t st_segment_usec(const segment_t* segment) {
+    return segment->n_step * segment->isrPeriod / ticksPerMicrosecond;
+}
+
+// Number of entries in segment_buffer, from $Stepper/Segments. Read once at boot.
+static uint8_t segment_buffer_size;
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
 typedef struct {
@@ -70,21 +144,44 @@ typedef struct {
     uint8_t  dir_outbits;
     uint32_t steps[MAX_N_AXIS];
 
-    uint16_t    step_count;        // Steps remaining in line segment motion
+    uint32_t    step_count;        // Steps remaining in line segment motion
     uint8_t     exec_block_index;  // Tracks the current st_block index. Change indicates new block.
     st_block_t* exec_block;        // Pointer to the block data for the segment being executed
     segment_t*  exec_segment;      // Pointer to the segment being executed
+
+    const raster_row_t* raster;        // Row of the executing raster block, NULL otherwise
+    uint32_t            raster_units;  // Progress through the block, in step_event_count units
+    uint32_t            raster_next;   // raster_units at which the next pixel starts
+    uint16_t            raster_pixel;  // Pixel being output
+    uint32_t            raster_lead;   // $Laser/ScanOffset in raster_units at the segment speed
+
+    uint32_t lead_steps;  // At this step_count the power of the next segment is set, 0 for never
+
+    uint32_t pulse_phase;  // Progress to the next laser pulse, a pulse each time it wraps
 } stepper_t;
 static stepper_t st;
 
-// Step segment ring buffer indices
-static volatile uint8_t segment_buffer_tail;
-static uint8_t          segment_buffer_head;
-static uint8_t          segment_next_head;
+// Step segment ring buffer indices. The ring is a single-producer single-consumer queue:
+// st_prep_buffer() fills segment_buffer[head] and then publishes it by advancing head with a
+// release store, and the stepper ISR consumes segment_buffer[tail] and then frees it by
+// advancing tail with a release store. Each side reads the other's index with acquire, so
+// the two may run on different cores without a lock. segment_next_head is producer-only.
+static std::atomic<uint8_t> segment_buffer_tail;
+static std::atomic<uint8_t> segment_buffer_head;
+static uint8_t              segment_next_head;
+// With input shaping, the segments from head up to segment_prep_head are generated but not yet
+// published, until the shaper has retimed them. Otherwise the two are always equal.
+static uint8_t segment_prep_head;
 
 // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
 static std::atomic<bool> busy;
 
+static volatile bool st_halted = false;  // Set by st_halt(), cleared by st_reset()
+
+// Segment prep task, woken by the stepper each time it frees a segment
+static TaskHandle_t      prep_task_handle = NULL;
+static SemaphoreHandle_t prep_mutex       = NULL;
+
 // Pointers for the step segment being prepped from the planner buffer. Accessed only by the
 // main program. Pointers may be planning segments or planner blocks ahead of what being executed.
 static plan_block_t* pl_block;       // Pointer to the planner block being prepped
@@ -117,10 +214,17 @@ typedef struct {
     // NOTE: This value must coincide with a step(no mantissa) when converted.
     float current_speed;     // Current speed at the end of the segment buffer (mm/min)
     float maximum_speed;     // Maximum speed of executing block. Not always nominal speed. (mm/min)
+    float nominal_speed;     // Nominal speed of executing block, with overrides (mm/min)
     float exit_speed;        // Exit speed of executing block (mm/min)
     float accelerate_until;  // Acceleration ramp end measured from end of block (mm)
     float decelerate_after;  // Deceleration ramp start measured from end of block (mm)
 
+    // S-curve ramp in progress, see st_s_curve_ramp()
+    float ramp_time;         // Time into the ramp (min), negative until the ramp starts
+    float ramp_duration;     // Length of the ramp (min)
+    float ramp_start_speed;  // Speed at the start of the ramp (mm/min)
+    float ramp_start_mm;     // Distance from end of block at the start of the ramp (mm)
+
     float inv_rate;  // Used by PWM laser mode to speed up segment calculations.
     //uint16_t current_spindle_pwm;  // todo remove
     float current_spindle_rpm;
@@ -137,6 +241,41 @@ const char* stepper_names[] = {
 
 stepper_id_t current_stepper = DEFAULT_STEPPER;
 
+// Kept in DRAM so the ISR can read it while the flash cache is disabled.
+DRAM_ATTR motion_config_t motion_config;
+static portMUX_TYPE       motion_config_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void st_select_step_path(uint8_t n_axis);
+
+void motion_config_update() {
+    motion_config_t cfg;
+    cfg.n_axis                       = number_axis->get();
+    cfg.pulse_microseconds           = pulse_microseconds->get();
+    cfg.direction_delay_microseconds = direction_delay_microseconds->get();
+    cfg.dt_segment                   = 1.0 / (acceleration_ticks->get() * 60.0);
+    cfg.buffer_time_us               = stepper_buffer_time->get() * 1000;
+    cfg.laser_dynamic_power          = laser_dynamic_power->get();
+    cfg.laser_lead_ticks             = laser_mode->get() ? laser_scan_offset->get() * ticksPerMicrosecond : 0;
+    cfg.laser_pulses_per_mm          = laser_mode->get() ? laser_pulses_per_mm->get() : 0.0f;
+    cfg.laser_pulse_ticks            = laser_pulse_width->get() * ticksPerMicrosecond;
+    cfg.spindle_lead                 = spindle_speed_queued->get() ? spindle_speed_lead->get() / 60000.0f : 0.0f;
+    cfg.s_curve                      = stepper_s_curve->get();
+    cfg.pulse_timer                  = stepper_pulse_timer->get();
+    shaper_impulses_compute(&cfg.shaper);
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        cfg.steps_per_mm[axis]     = axis_settings[axis]->steps_per_mm->get();
+        cfg.inv_steps_per_mm[axis] = 1.0f / cfg.steps_per_mm[axis];
+        cfg.inv_max_rate[axis]     = 1.0f / axis_settings[axis]->max_rate->get();
+        cfg.inv_acceleration[axis] = 1.0f / (axis_settings[axis]->acceleration->get() * SEC_PER_MIN_SQ);
+    }
+    // Swap the whole snapshot at once so the ISR never sees a half-updated copy.
+    portENTER_CRITICAL(&motion_config_mux);
+    motion_config = cfg;
+    portEXIT_CRITICAL(&motion_config_mux);
+    st_select_step_path(cfg.n_axis);
+    system_mpos_invalidate();  // The steps per mm may have changed
+}
+
 /* "The Stepper Driver Interrupt" - This timer interrupt is the workhorse of Grbl. Grbl employs
    the venerable Bresenham line algorithm to manage and exactly synchronize multi-axis moves.
    Unlike the popular DDA algorithm, the Bresenham algorithm is not susceptible to numerical
@@ -193,7 +332,43 @@ stepper_id_t current_stepper = DEFAULT_STEPPER;
 
 */
 
-static void stepper_pulse_func();
+static void IRAM_ATTR stepper_pulse_func();
+#ifdef USE_RMT_BURST
+template <int N>
+static bool IRAM_ATTR stepper_rmt_burst();
+#endif
+
+// Running cycle counts for the stepper ISR, reported by $Bench/Stepper. Recording costs a
+// handful of cycles per ISR, which is small next to the pulse itself.
+static DRAM_ATTR stepper_isr_stats_t isr_stats = { UINT32_MAX, 0, 0, 0, 0 };
+
+// The same for the spindle update at each segment load, which is inside the ISR time above
+static DRAM_ATTR stepper_isr_stats_t spindle_isr_stats = { UINT32_MAX, 0, 0, 0, 0 };
+
+// Set while st_bench() is driving stepper_pulse_func() so that no pins, timers or spindle change.
+static volatile bool bench_running = false;
+
+// Starvation counters, for $Stats and the |Perf: report field
+const int64_t PERF_RESTART_US    = 1000000;  // A cycle restarting within this of an underflow is the same job
+const float   PERF_SLOW_FRACTION = 0.95;     // Below this fraction of the nominal speed counts as slow
+const float   PERF_CRUISE_DELTA  = 0.001;    // Segments whose speed changes less than this fraction cruise
+
+static stepper_perf_stats_t       perf_stats = { 0, 0, UINT8_MAX, 0.0f, 0.0f, 0, 0 };
+static DRAM_ATTR volatile bool    perf_planner_dry;     // Prep ran out of blocks with the stepper still moving
+static bool                       perf_planner_filled;  // The planner has been full since the cycle started
+static DRAM_ATTR volatile int64_t perf_underflow_us;    // When the stepper last ran out mid-cycle, 0 for none
+static stepper_job_stats_t        job_stats;
+
+static inline void IRAM_ATTR isr_stats_record(stepper_isr_stats_t* stats, uint32_t cycles) {
+    if (cycles < stats->min_cycles) {
+        stats->min_cycles = cycles;
+    }
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    stats->total_cycles += cycles;
+    stats->count++;
+}
 
 // TODO: Replace direct updating of the int32 position counters in the ISR somehow. Perhaps use smaller
 // int8 variables and update position counters only when a segment completes. This can get complicated
@@ -207,12 +382,362 @@ void IRAM_ATTR onStepperDriverTimer(void* para) {
 
     bool expected = false;
     if (busy.compare_exchange_strong(expected, true)) {
+        uint32_t start_cycles = xthal_get_ccount();
         stepper_pulse_func();
+        isr_stats_record(&isr_stats, xthal_get_ccount() - start_cycles);
 
         TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
 
         busy.store(false);
+    } else {
+        isr_stats.missed++;
+    }
+}
+
+// Sets the laser to the power of the raster pixel being output
+static inline void IRAM_ATTR st_raster_output() {
+    uint32_t rpm = (uint32_t)st.raster->pixel[st.raster_pixel] * st.raster->max_rpm / 255;
+    spindle->set_rpm_ramp(rpm, rpm, 0);
+}
+
+// Laser scan offset. The laser responds to a power change some time after it is made, so burns
+// trail the position meant for them, opposite ways on the two passes of a bidirectional raster.
+// With $Laser/ScanOffset set, power changes are made that much earlier: raster pixels by the
+// distance the segment speed covers in that time, and segment power by setting the power of the
+// next segment that many step events before the end of this one. The first pixel of a row still
+// starts with its block.
+static inline void IRAM_ATTR st_lead_load(const segment_t* segment) {
+    uint32_t events = motion_config.laser_lead_ticks / segment->isrPeriod;
+    st.lead_steps   = MIN(events, segment->n_step);
+    st.raster_lead  = events << (maxAmassLevel - segment->amass_level);
+}
+
+// Sets the power of the next queued segment ahead of its load, unless it belongs to a raster row
+static void IRAM_ATTR st_lead_power() {
+    uint8_t next = segment_buffer_tail.load(std::memory_order_relaxed) + 1;
+    if (next == segment_buffer_size) {
+        next = 0;
+    }
+    if (next == segment_buffer_head.load(std::memory_order_acquire)) {
+        return;
+    }
+    const segment_t*  segment = &segment_buffer[next];
+    const st_block_t* block   = &st_block_buffer[segment->st_block_index];
+    if (block->is_raster || block->pulse_increment) {
+        return;
+    }
+    if (motion_config.laser_dynamic_power && block->is_pwm_rate_adjusted) {
+        spindle->set_rpm_isr(segment->spindle_rpm_start);
+    } else {
+        spindle->set_rpm_isr(segment->spindle_rpm);
+    }
+}
+
+// Pixels are spread evenly over the block's step events, so pixel changes stay locked to position
+static inline uint32_t st_raster_pixel_end(uint16_t pixel) {
+    return (uint64_t)(pixel + 1) * st.exec_block->step_event_count / st.raster->n_pixel;
+}
+
+// Called as each block is loaded. A new block means the previous raster row, if any, is done.
+static void IRAM_ATTR st_raster_block_start() {
+    if (st.raster != NULL) {
+        raster_row_end();
+        st.raster = NULL;
+    }
+    if (!st.exec_block->is_raster) {
+        return;
+    }
+    st.raster = raster_row_begin();  // Never NULL, rows are published with their blocks
+    if (st.raster != NULL) {
+        st.raster_units = 0;
+        st.raster_pixel = 0;
+        st.raster_next  = st_raster_pixel_end(0);
+    }
+}
+
+// Pulsed laser cutting, $Laser/PulsesPerMM. With power a duty held through each segment, the
+// energy per mm of a cut falls as the feed rises. Pulsed blocks keep the laser off instead and
+// fire a pulse of $Laser/PulseWidth at the segment's power each time the Bresenham step events
+// cover the pulse spacing, so the pulses stay where they belong on the path whatever the speed.
+// The spacing carries over from block to block. The laser timer ends each pulse.
+static DRAM_ATTR volatile bool laser_pulse_on = false;
+
+static inline void IRAM_ATTR laser_timer_arm(uint32_t ticks) {
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].config.enable   = 0;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].load_high       = 0;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].load_low        = 0;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].reload          = 1;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].alarm_high      = 0;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].alarm_low       = ticks;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
+    TIMERG1.hw_timer[LASER_TIMER_INDEX].config.enable   = 1;
+}
+
+// A pulse that is still on when the next one fires runs on until the later one ends
+static inline void IRAM_ATTR laser_pulse_fire() {
+    spindle->set_rpm_isr(st.exec_segment->spindle_rpm);
+    laser_pulse_on = true;
+    laser_timer_arm(motion_config.laser_pulse_ticks);
+}
+
+// Leaves the laser power to whoever sets it next
+static inline void IRAM_ATTR laser_pulse_cancel() {
+    if (laser_pulse_on) {
+        TIMERG1.hw_timer[LASER_TIMER_INDEX].config.alarm_en = TIMER_ALARM_DIS;
+        TIMERG1.hw_timer[LASER_TIMER_INDEX].config.enable   = 0;
+        TIMERG1.int_clr_timers.t0                           = 1;
+        laser_pulse_on                                      = false;
+    }
+}
+
+void IRAM_ATTR onLaserPulseTimer(void* para) {
+    TIMERG1.int_clr_timers.t0 = 1;
+    if (laser_pulse_on) {
+        laser_pulse_on = false;
+        spindle->set_rpm_isr(0);
+    }
+}
+
+// Loads the Bresenham increment of one axis for a new segment, and its counter for a new block
+static inline void st_axis_load(int axis, bool new_block, uint8_t amass_level) {
+    if (new_block) {
+        st.counter[axis] = (st.exec_block->step_event_count >> 1);
     }
+    st.steps[axis] = st.exec_block->steps[axis] >> amass_level;
+}
+
+// One Bresenham step event of one axis. Jog step counts are taken from sys_position when the
+// jog starts and ends, see jog_steps_start(), so they cost nothing here.
+static inline void st_axis_step(int axis, uint32_t step_event_count, uint8_t direction_bits) {
+    // Execute step displacement profile by Bresenham line algorithm
+    st.counter[axis] += st.steps[axis];
+    if (st.counter[axis] > step_event_count) {
+        st.step_outbits |= bit(axis);
+        st.counter[axis] -= step_event_count;
+        if (direction_bits & bit(axis)) {
+            sys_position[axis]--;
+        } else {
+            sys_position[axis]++;
+        }
+    }
+}
+
+// The same over the first N axes, unrolled at compile time so every axis index is a constant.
+// GCC 5 leaves loops rolled at -Os however short they are, hence the recursion.
+template <int N>
+static inline void st_axes_load(bool new_block, uint8_t amass_level) {
+    st_axes_load<N - 1>(new_block, amass_level);
+    st_axis_load(N - 1, new_block, amass_level);
+}
+template <>
+inline void st_axes_load<0>(bool new_block, uint8_t amass_level) {}
+
+template <int N>
+static inline void st_axes_step(uint32_t step_event_count, uint8_t direction_bits) {
+    st_axes_step<N - 1>(step_event_count, direction_bits);
+    st_axis_step(N - 1, step_event_count, direction_bits);
+}
+template <>
+inline void st_axes_step<0>(uint32_t step_event_count, uint8_t direction_bits) {}
+
+// Pops the next segment from the segment buffer into st. Returns false if the buffer is empty.
+template <int N>
+static inline bool IRAM_ATTR st_load_segment() {
+    // Anything in the buffer? If so, load and initialize next step segment.
+    uint8_t tail = segment_buffer_tail.load(std::memory_order_relaxed);
+    if (segment_buffer_head.load(std::memory_order_acquire) == tail) {
+        return false;
+    }
+    // Initialize new step segment and load number of steps to execute
+    st.exec_segment = &segment_buffer[tail];
+    // Initialize step segment timing per step and load number of steps to execute.
+    if (!bench_running) {
+        Stepper_Timer_WritePeriod(st.exec_segment->isrPeriod);
+    }
+    st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
+    st_lead_load(st.exec_segment);
+    TRACE_EVENT(TraceEvent::SegmentLoad, st.step_count);
+    // If the new segment starts a new planner block, initialize stepper variables and counters.
+    // NOTE: When the segment data index changes, this indicates a new planner block.
+    bool new_block = st.exec_block_index != st.exec_segment->st_block_index;
+    if (new_block) {
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block       = &st_block_buffer[st.exec_block_index];
+        st_raster_block_start();
+        if (st.exec_block->outputs) {
+            plan_outputs_run(st.exec_block->outputs);  // The block before is done
+        }
+    }
+    st.dir_outbits = st.exec_block->direction_bits;
+    // Initialize Bresenham line and distance counters for a new block, and adjust Bresenham
+    // axis increment counters according to AMASS level.
+    st_axes_load<N>(new_block, st.exec_segment->amass_level);
+    // Set real-time spindle output as segment is loaded, just prior to the first step.
+    if (!bench_running) {
+        uint32_t start_cycles = xthal_get_ccount();
+        if (!st.exec_block->pulse_increment) {
+            laser_pulse_cancel();  // This segment sets the power
+        }
+        if (st.exec_block->pulse_increment) {
+            if (!laser_pulse_on) {
+                spindle->set_rpm_isr(0);  // Off between pulses
+            }
+        } else if (st.raster != NULL) {
+            st_raster_output();  // Also restores the pixel after a hold
+        } else if (motion_config.laser_dynamic_power && st.exec_block->is_pwm_rate_adjusted) {
+            // Power follows the speed ramp to the end of the segment instead of stepping to it
+            spindle->set_rpm_ramp(st.exec_segment->spindle_rpm_start, st.exec_segment->spindle_rpm, st_segment_usec(st.exec_segment));
+        } else {
+            spindle->set_rpm_isr(st.exec_segment->spindle_rpm);
+        }
+        isr_stats_record(&spindle_isr_stats, xthal_get_ccount() - start_cycles);
+    }
+    return true;
+}
+
+// Segment buffer empty. Shutdown.
+static void IRAM_ATTR st_buffer_empty() {
+    if (sys.state == State::Cycle && !bench_running) {
+        perf_underflow_us = esp_timer_get_time();  // Counted if the job goes on, see st_perf_block_loaded()
+        perf_planner_dry  = false;                 // Which is the worse of the two
+    }
+    st_go_idle();
+    if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
+        // Ensure pwm is set properly upon completion of rate-controlled motion.
+        if (st.exec_block != NULL && (st.exec_block->is_pwm_rate_adjusted || st.exec_block->is_raster || st.exec_block->pulse_increment)) {
+            spindle->set_rpm_isr(0);
+        }
+    }
+    cycle_stop = true;
+    protocol_wake();
+}
+
+// Wakes the prep task to refill the freed segment. The consumer is the timer ISR, or the
+// I2S task in ST_I2S_STREAM mode.
+static inline void IRAM_ATTR st_prep_notify() {
+    if (prep_task_handle == NULL) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(prep_task_handle, &higher_priority_task_woken);
+        if (higher_priority_task_woken) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xTaskNotifyGive(prep_task_handle);
+    }
+}
+
+// Runs one Bresenham step event of the executing segment and leaves the axes that step on the
+// next event in st.step_outbits.
+template <int N>
+static inline void IRAM_ATTR st_step_event() {
+    // Reset step out bits.
+    st.step_outbits = 0;
+
+    st_axes_step<N>(st.exec_block->step_event_count, st.exec_block->direction_bits);
+
+    // During a homing cycle, lock out and prevent desired axes from moving.
+    if (sys.state == State::Homing) {
+        st.step_outbits &= sys.homing_axis_lock;
+    }
+
+    // Move to the next raster pixel once the line has passed the end of this one
+    if (st.raster != NULL) {
+        st.raster_units += 1 << (maxAmassLevel - st.exec_segment->amass_level);
+        uint32_t units = st.raster_units + st.raster_lead;
+        if (units >= st.raster_next && st.raster_pixel + 1 < st.raster->n_pixel) {
+            while (units >= st.raster_next && st.raster_pixel + 1 < st.raster->n_pixel) {
+                st.raster_pixel++;
+                st.raster_next = st_raster_pixel_end(st.raster_pixel);
+            }
+            if (!bench_running) {
+                st_raster_output();
+            }
+        }
+    } else if (st.exec_block->pulse_increment) {
+        uint32_t phase = st.pulse_phase + (st.exec_block->pulse_increment << (maxAmassLevel - st.exec_segment->amass_level));
+        if (phase < st.pulse_phase && !bench_running) {
+            laser_pulse_fire();
+        }
+        st.pulse_phase = phase;
+    } else if (st.step_count == st.lead_steps && !bench_running) {
+        st_lead_power();
+    }
+    st.step_count--;  // Decrement step events count
+    if (st.step_count == 0) {
+#ifdef USE_STEP_PCNT
+        // Locked homing axes count steps they do not send, and the other steppers send the
+        // pulses after this, so only the timed stepper is compared
+        if (current_stepper == ST_TIMED && !bench_running && sys.state != State::Homing) {
+            step_verify_check(st.step_outbits, st.exec_block->direction_bits);
+        }
+#endif
+        // Segment is complete. Discard current segment and advance segment indexing.
+        st.exec_segment = NULL;
+        uint8_t tail    = segment_buffer_tail.load(std::memory_order_relaxed) + 1;
+        if (tail == segment_buffer_size) {
+            tail = 0;
+        }
+        segment_buffer_tail.store(tail, std::memory_order_release);
+        if (!bench_running) {
+            st_prep_notify();
+        }
+    }
+}
+
+// With $Stepper/PulseTimer, Timed and I2S static steps do not spin in the ISR for the pulse and
+// the direction setup. The step ISR sets the pins and arms the one-shot pulse timer, whose
+// alarm takes the next action: the step after a direction change, then the unstep.
+enum PulseTimerPhase : uint8_t {
+    PULSE_IDLE = 0,
+    PULSE_STEP,    // The step waits for the direction setup
+    PULSE_UNSTEP,  // The step pulse is on
+};
+static DRAM_ATTR volatile uint8_t pulse_timer_phase = PULSE_IDLE;
+static DRAM_ATTR uint8_t          pulse_timer_step;  // Step bits for PULSE_STEP
+
+static inline void IRAM_ATTR pulse_timer_arm(uint8_t phase, uint32_t usec) {
+    pulse_timer_phase                                   = phase;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.enable   = 0;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].load_high       = 0;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].load_low        = 0;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].reload          = 1;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].alarm_high      = 0;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].alarm_low       = usec * ticksPerMicrosecond;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.enable   = 1;
+}
+
+static inline void IRAM_ATTR pulse_timer_expire() {
+    if (pulse_timer_phase == PULSE_STEP) {
+        motors_step(pulse_timer_step);
+        pulse_timer_arm(PULSE_UNSTEP, motion_config.pulse_microseconds);
+    } else if (pulse_timer_phase == PULSE_UNSTEP) {
+        pulse_timer_phase = PULSE_IDLE;
+        motors_unstep();
+    }
+}
+
+void IRAM_ATTR onStepperOffTimer(void* para) {
+    TIMERG0.int_clr_timers.t1 = 1;
+    pulse_timer_expire();
+}
+
+// The step ISR came before the pulse timer ran out, which happens when the pulse and the
+// direction setup fill the step period. The ISRs share a core and a level, so the rest of the
+// pulse is spun out here, as without the timer.
+static void IRAM_ATTR pulse_timer_finish() {
+    while (pulse_timer_phase != PULSE_IDLE) {
+        do {
+            TIMERG0.hw_timer[PULSE_TIMER_INDEX].update = 1;
+        } while (TIMERG0.hw_timer[PULSE_TIMER_INDEX].cnt_low < TIMERG0.hw_timer[PULSE_TIMER_INDEX].alarm_low);
+        pulse_timer_expire();
+    }
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.alarm_en = TIMER_ALARM_DIS;
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.enable   = 0;
+    TIMERG0.int_clr_timers.t1                           = 1;
 }
 
 /**
@@ -221,11 +746,23 @@ void IRAM_ATTR onStepperDriverTimer(void* para) {
  * interrupt and the start of the pulses. DON'T add any logic ahead of the
  * call to this method that might cause variation in the timing. The aim
  * is to keep pulse timing as regular as possible.
+ *
+ * Instantiated for each axis count N, see st_select_step_path().
  */
-static void stepper_pulse_func() {
-    auto n_axis = number_axis->get();
-    if (motors_direction(st.dir_outbits)) {
-        auto wait_direction = direction_delay_microseconds->get();
+template <int N>
+static void IRAM_ATTR stepper_pulse() {
+#ifdef USE_RMT_BURST
+    if (!bench_running && stepper_rmt_burst<N>()) {
+        return;
+    }
+#endif
+    bool pulse_timer = motion_config.pulse_timer && !bench_running && (current_stepper == ST_TIMED || current_stepper == ST_I2S_STATIC);
+    bool step_timed  = false;  // The step is left to the pulse timer, after the direction setup
+    if (pulse_timer && pulse_timer_phase != PULSE_IDLE) {
+        pulse_timer_finish();
+    }
+    if (!bench_running && motors_direction(st.dir_outbits)) {
+        auto wait_direction = motion_config.direction_delay_microseconds;
         if (wait_direction > 0) {
             // Stepper drivers need some time between changing direction and doing a pulse.
             switch (current_stepper) {
@@ -233,8 +770,13 @@ static void stepper_pulse_func() {
                     i2s_out_push_sample(wait_direction);
                     break;
                 case ST_I2S_STATIC:
-                    
                 case ST_TIMED: {
+                    if (pulse_timer) {
+                        pulse_timer_step = st.step_outbits;
+                        pulse_timer_arm(PULSE_STEP, wait_direction);
+                        step_timed = true;
+                        break;
+                    }
                     // wait for step pulse time to complete...some time expired during code above
                     //
                     // If we are using GPIO stepping as opposed to RMT, record the
@@ -260,113 +802,348 @@ static void stepper_pulse_func() {
     //
     // NOTE: We could use direction_pulse_start_time + wait_direction, but let's play it safe
     uint64_t step_pulse_start_time = esp_timer_get_time();
-    motors_step(st.step_outbits);
-
-    // If there is no step segment, attempt to pop one from the stepper buffer
-    if (st.exec_segment == NULL) {
-        // Anything in the buffer? If so, load and initialize next step segment.
-        if (segment_buffer_head != segment_buffer_tail) {
-            // Initialize new step segment and load number of steps to execute
-            st.exec_segment = &segment_buffer[segment_buffer_tail];
-            // Initialize step segment timing per step and load number of steps to execute.
-            Stepper_Timer_WritePeriod(st.exec_segment->isrPeriod);
-            st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
-            // If the new segment starts a new planner block, initialize stepper variables and counters.
-            // NOTE: When the segment data index changes, this indicates a new planner block.
-            if (st.exec_block_index != st.exec_segment->st_block_index) {
-                st.exec_block_index = st.exec_segment->st_block_index;
-                st.exec_block       = &st_block_buffer[st.exec_block_index];
-                // Initialize Bresenham line and distance counters
-                for (int axis = 0; axis < n_axis; axis++) {
-                    st.counter[axis] = (st.exec_block->step_event_count >> 1);
-                }
-            }
-            st.dir_outbits = st.exec_block->direction_bits;
-            // Adjust Bresenham axis increment counters according to AMASS level.
-            for (int axis = 0; axis < n_axis; axis++) {
-                st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
-            }
-            // Set real-time spindle output as segment is loaded, just prior to the first step.
-            spindle->set_rpm(st.exec_segment->spindle_rpm);
-        } else {
-            // Segment buffer empty. Shutdown.
-            st_go_idle();
-            if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
-                // Ensure pwm is set properly upon completion of rate-controlled motion.
-                if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
-                    spindle->set_rpm(0);
-                }
-            }
-            cycle_stop = true;
-            return;  // Nothing to do but exit.
-        }
-    }
-    // Check probing state.
-    if (sys_probe_state == Probe::Active) {
-        probe_state_monitor();
-    }
-    
-    // Reset step out bits.
-    st.step_outbits = 0;
-
-    for (int axis = 0; axis < n_axis; axis++) {
-        // Execute step displacement profile by Bresenham line algorithm
-        st.counter[axis] += st.steps[axis];
-        if (st.counter[axis] > st.exec_block->step_event_count) {
-            st.step_outbits |= bit(axis);
-            st.counter[axis] -= st.exec_block->step_event_count;
-            if (st.exec_block->direction_bits & bit(axis)) {
-                sys_position[axis]--;
-                
-                // Count steps for jogging if enabled
-                if (step_counting_enabled && sys.state == State::Jog) {
-                    sys.jog_step_counts[axis]--;
-                }
-            } else {
-                sys_position[axis]++;
-                
-                // Count steps for jogging if enabled
-                if (step_counting_enabled && sys.state == State::Jog) {
-                    sys.jog_step_counts[axis]++;
-                }
-            }
+    if (!bench_running && !step_timed) {
+        motors_step(st.step_outbits);
+        if (pulse_timer) {
+            pulse_timer_arm(PULSE_UNSTEP, motion_config.pulse_microseconds);
         }
     }
 
-    // During a homing cycle, lock out and prevent desired axes from moving.
-    if (sys.state == State::Homing) {
-        st.step_outbits &= sys.homing_axis_lock;
-    }
-    st.step_count--;  // Decrement step events count
-    if (st.step_count == 0) {
-        // Segment is complete. Discard current segment and advance segment indexing.
-        st.exec_segment = NULL;
-        if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE) {
-            segment_buffer_tail = 0;
+    // If there is no step segment, attempt to pop one from the stepper buffer
+    if (st_halted || (st.exec_segment == NULL && !st_load_segment<N>())) {
+        if (!bench_running) {
+            st_buffer_empty();
         }
+        return;  // Nothing to do but exit.
     }
+    st_step_event<N>();
 
     switch (current_stepper) {
         case ST_I2S_STREAM:
+            if (bench_running) {
+                break;
+            }
             // Generate the number of pulses needed to span pulse_microseconds
-            i2s_out_push_sample(pulse_microseconds->get());
+            i2s_out_push_sample(motion_config.pulse_microseconds);
             motors_unstep();
             break;
         case ST_I2S_STATIC:
         case ST_TIMED:
+            if (pulse_timer) {
+                break;  // The pulse timer ends the pulse
+            }
             // wait for step pulse time to complete...some time expired during code above
-            while (esp_timer_get_time() - step_pulse_start_time < pulse_microseconds->get()) {
+            while (esp_timer_get_time() - step_pulse_start_time < motion_config.pulse_microseconds) {
                 NOP();  // spin here until time to turn off step
             }
-            motors_unstep();
+            if (!bench_running) {
+                motors_unstep();
+            }
             break;
         case ST_RMT:
             break;
     }
 }
 
+#ifdef USE_I2S_STEPS
+// I2S step bits of each motor, and of each axis for the ganged mode they were combined for
+static uint32_t     i2s_motor_step_mask[MAX_N_AXIS][MAX_GANGED];
+static uint32_t     i2s_axis_step_mask[MAX_N_AXIS];
+static SquaringMode i2s_step_mask_mode;
+static uint32_t     i2s_step_period;   // Step period of the executing segment (timer ticks)
+static uint32_t     i2s_step_remain;   // Time remaining until the next step event (timer ticks)
+
+static void IRAM_ATTR i2s_update_step_masks(uint8_t n_axis) {
+    i2s_step_mask_mode = ganged_mode;
+    for (int axis = 0; axis < n_axis; axis++) {
+        uint32_t mask = 0;
+        if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A)) {
+            mask |= i2s_motor_step_mask[axis][0];
+        }
+        if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B)) {
+            mask |= i2s_motor_step_mask[axis][1];
+        }
+        i2s_axis_step_mask[axis] = mask;
+    }
+}
+
+// Block callback for ST_I2S_STREAM. Writes the port words for as many step events as fit in
+// buf, running straight through segments instead of returning to the I2S driver for every
+// step. Step pins are toggled in the words with the masks from motors_i2s_step_masks(), so
+// no motor methods are called per step; the idle port value already holds the unstepped level.
+template <int N>
+static uint32_t IRAM_ATTR stepper_i2s_fill(uint32_t* buf, uint32_t n_samples) {
+    uint32_t usec_per_n  = i2s_out_get_usec_per_pulse();
+    uint32_t ticks_per_n = usec_per_n * ticksPerMicrosecond;  // Steps keep the timer resolution between samples
+    uint32_t pulse_n     = motion_config.pulse_microseconds / usec_per_n;
+    uint32_t dir_delay   = motion_config.direction_delay_microseconds;
+    uint32_t dir_n       = dir_delay / usec_per_n;
+    uint32_t pos         = 0;
+
+    // Like i2s_out_push_sample(), every pulse or delay spans at least one sample
+    if (pulse_n == 0) {
+        pulse_n = 1;
+    }
+    if (dir_delay > 0 && dir_n == 0) {
+        dir_n = 1;
+    }
+
+    while (true) {
+        uint32_t port_data = i2s_out_get_port_data();
+
+        // Idle words up to the next step event
+        if (i2s_step_remain >= ticks_per_n) {
+            uint32_t n = i2s_step_remain / ticks_per_n;
+            if (n > n_samples - pos) {
+                n = n_samples - pos;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                buf[pos++] = port_data;
+            }
+            i2s_step_remain -= n * ticks_per_n;
+            if (pos == n_samples) {
+                break;
+            }
+        }
+
+        if (st_halted) {
+            st_buffer_empty();
+            break;
+        }
+        // Leave a step event that does not fit whole for the next buffer
+        if (pos + dir_n + pulse_n > n_samples) {
+            break;
+        }
+        uint32_t event_pos = pos;
+
+        if (motors_direction(st.dir_outbits) && dir_delay > 0) {
+            // Stepper drivers need some time between changing direction and doing a pulse.
+            port_data = i2s_out_get_port_data();
+            for (uint32_t i = 0; i < dir_n; i++) {
+                buf[pos++] = port_data;
+            }
+        }
+
+        uint32_t step_data = port_data;
+        for (int axis = 0; axis < N; axis++) {
+            if (st.step_outbits & bit(axis)) {
+                step_data ^= i2s_axis_step_mask[axis];
+            }
+        }
+        for (uint32_t i = 0; i < pulse_n; i++) {
+            buf[pos++] = step_data;
+        }
+
+        if (st.exec_segment == NULL) {
+            if (!st_load_segment<N>()) {
+                st_buffer_empty();
+                break;
+            }
+            i2s_step_period = st.exec_segment->isrPeriod;
+            if (ganged_mode != i2s_step_mask_mode) {
+                i2s_update_step_masks(N);
+            }
+        }
+        st_step_event<N>();
+
+        // The pulse and direction delay count towards the step period
+        uint32_t used = (pos - event_pos) * ticks_per_n;
+        i2s_step_remain += i2s_step_period;
+        i2s_step_remain = i2s_step_remain > used ? i2s_step_remain - used : 0;
+    }
+    return pos;
+}
+#endif
+
+#ifdef USE_RMT_BURST
+// RMT step channel of each motor, and of each axis for the ganged mode they were combined for
+static rmt_channel_t rmt_motor_channel[MAX_N_AXIS][MAX_GANGED];
+static rmt_channel_t rmt_axis_channel[MAX_N_AXIS][MAX_GANGED];
+static uint8_t       rmt_idle_level[RMT_CHANNEL_MAX];
+static SquaringMode  rmt_channel_mode;
+static bool          rmt_burst_enabled = false;
+
+const int      rmtTicksPerMicrosecond = 4;       // Step channels run at clk_div 20 from the 80MHz APB clock
+const uint32_t RMT_BURST_MAX_EVENTS   = 63;      // One item per pulse and an end marker in a 64 item block
+const uint32_t RMT_DURATION_MAX       = 0x7fff;  // Longest half of an RMT item
+
+static void IRAM_ATTR rmt_update_channels(uint8_t n_axis) {
+    rmt_channel_mode = ganged_mode;
+    for (int axis = 0; axis < n_axis; axis++) {
+        bool use_a                = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A);
+        bool use_b                = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B);
+        rmt_axis_channel[axis][0] = use_a ? rmt_motor_channel[axis][0] : RMT_CHANNEL_MAX;
+        rmt_axis_channel[axis][1] = use_b ? rmt_motor_channel[axis][1] : RMT_CHANNEL_MAX;
+        for (int gang = 0; gang < MAX_GANGED; gang++) {
+            rmt_channel_t channel = rmt_motor_channel[axis][gang];
+            if (channel != RMT_CHANNEL_MAX) {
+                rmt_idle_level[channel] = RMT.conf_ch[channel].conf1.idle_out_lv;
+            }
+        }
+    }
+}
+
+// Step path for ST_RMT when every motor steps through its own RMT channel. Runs a whole run of
+// step events of the executing segment at once, writes each channel's pulses for the run into
+// its RMT memory and starts the channels, then sets the timer to the length of the run so the
+// next interrupt comes when the hardware has played it out. A run ends at the end of the
+// segment, so the ISR fires at segment boundaries and every RMT_BURST_MAX_EVENTS steps in
+// between. Returns false to leave the step to stepper_pulse().
+template <int N>
+static bool IRAM_ATTR stepper_rmt_burst() {
+    if (!rmt_burst_enabled || current_stepper != ST_RMT) {
+        return false;
+    }
+
+    if (st.exec_segment == NULL) {
+        if (!st_load_segment<N>()) {
+            st_buffer_empty();
+            return true;
+        }
+        if (ganged_mode != rmt_channel_mode) {
+            rmt_update_channels(N);
+        }
+    }
+
+    // Stepper drivers need some time between changing direction and doing a pulse.
+    uint32_t lead = 0;
+    if (motors_direction(st.dir_outbits)) {
+        lead = motion_config.direction_delay_microseconds * rmtTicksPerMicrosecond;
+    }
+    uint32_t pulse  = motion_config.pulse_microseconds * rmtTicksPerMicrosecond;
+    uint32_t period = st.exec_segment->isrPeriod;
+
+    // The homing switches are checked per event, and the probe latches the position the ISR has
+    // reached, so those get one event per ISR and the position stays with the pulses sent. So do
+    // pulsed laser blocks, whose laser pulses would otherwise lead the steps.
+    // Otherwise the run is as long as fits in the item memory and in the longest item gap.
+    uint32_t n_event = 1;
+    if (sys_probe_state != Probe::Active && sys.state != State::Homing && !st.exec_block->pulse_increment && lead + pulse < RMT_DURATION_MAX) {
+        n_event = 1 + (RMT_DURATION_MAX - lead - pulse) * ticksPerMicrosecond / rmtTicksPerMicrosecond / period;
+        if (n_event > RMT_BURST_MAX_EVENTS) {
+            n_event = RMT_BURST_MAX_EVENTS;
+        }
+        if (n_event > st.step_count && st.step_count > 0) {
+            n_event = st.step_count;
+        }
+    }
+
+    uint8_t  n_item[RMT_CHANNEL_MAX] = {};
+    uint32_t edge[RMT_CHANNEL_MAX]   = {};  // End of the last pulse loaded on each channel (RMT ticks)
+    uint32_t i                       = 0;
+    while (i < n_event) {
+        st_step_event<N>();
+        uint32_t at = lead + i * period * rmtTicksPerMicrosecond / ticksPerMicrosecond;
+        i++;
+        for (int axis = 0; axis < N; axis++) {
+            if (!(st.step_outbits & bit(axis))) {
+                continue;
+            }
+            for (int gang = 0; gang < MAX_GANGED; gang++) {
+                rmt_channel_t channel = rmt_axis_channel[axis][gang];
+                if (channel == RMT_CHANNEL_MAX) {
+                    continue;
+                }
+                // A zero duration ends the item list, so every gap lasts at least one tick
+                uint32_t     start = at > edge[channel] ? at : edge[channel] + 1;
+                rmt_item32_t item;
+                item.level0    = rmt_idle_level[channel];
+                item.duration0 = start - edge[channel];
+                item.level1    = !rmt_idle_level[channel];
+                item.duration1 = pulse;
+                RMTMEM.chan[channel].data32[n_item[channel]++].val = item.val;
+                edge[channel]                                     = start + pulse;
+            }
+        }
+        if (st.exec_segment == NULL) {
+            break;  // Segment done. The next one is loaded by the next ISR.
+        }
+    }
+    st.step_outbits = 0;
+
+    for (int channel = 0; channel < RMT_CHANNEL_MAX; channel++) {
+        if (n_item[channel] > 0) {
+            RMTMEM.chan[channel].data32[n_item[channel]].val = 0;  // End marker
+            RMT.conf_ch[channel].conf1.mem_rd_rst            = 1;
+            RMT.conf_ch[channel].conf1.tx_start              = 1;
+        }
+    }
+
+    timer_set_alarm_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, (uint64_t)period * i);
+    return true;
+}
+#endif
+
+// The step path is instantiated for every axis count, so each copy runs its axis loops a fixed
+// number of times. st_select_step_path() picks one when the settings are loaded or changed,
+// which leaves one indirect call per ISR instead of an axis count test per axis per step.
+static_assert(MAX_N_AXIS == 6, "instantiate the step path for each axis count");
+#define ST_STEP_PATHS(f) { f<1>, f<2>, f<3>, f<4>, f<5>, f<6> }
+
+static void (*const stepper_pulse_paths[MAX_N_AXIS])() = ST_STEP_PATHS(stepper_pulse);
+static void (*stepper_pulse_path)()                    = stepper_pulse<N_AXIS>;
+#ifdef USE_I2S_STEPS
+static uint32_t (*const stepper_i2s_fill_paths[MAX_N_AXIS])(uint32_t*, uint32_t) = ST_STEP_PATHS(stepper_i2s_fill);
+static uint32_t (*stepper_i2s_fill_path)(uint32_t*, uint32_t)                    = stepper_i2s_fill<N_AXIS>;
+#endif
+
+static void st_select_step_path(uint8_t n_axis) {
+    int index          = (n_axis < 1 ? 1 : MIN(n_axis, MAX_N_AXIS)) - 1;
+    stepper_pulse_path = stepper_pulse_paths[index];
+#ifdef USE_I2S_STEPS
+    stepper_i2s_fill_path = stepper_i2s_fill_paths[index];
+#endif
+}
+
+static void IRAM_ATTR stepper_pulse_func() {
+    stepper_pulse_path();
+}
+
+static void stepperPrepTask(void* pvParameters) {
+    heap_track_task();
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, STEPPER_PREP_TASK_POLL_MS / portTICK_PERIOD_MS);
+#ifdef USE_STEP_PCNT
+        step_verify_report();
+#endif
+        // Same states in which protocol_execute_realtime() reloads the buffer
+        switch (sys.state) {
+            case State::Cycle:
+            case State::Hold:
+            case State::SafetyDoor:
+            case State::Homing:
+            case State::Sleep:
+            case State::Jog:
+                st_prep_buffer();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 void stepper_init() {
-    busy.store(false); 
+    busy.store(false);
+
+    // The ISR walks these buffers, so keep them in internal RAM. The ring holds at least
+    // $Stepper/Segments entries, more if $Stepper/BufferTime needs them at the boot tick rate,
+    // plus the one that always stays empty and one for a short end-of-block segment.
+    uint32_t time_segments = (uint32_t)stepper_buffer_time->get() * acceleration_ticks->get() / 1000 + 2;
+    segment_buffer_size    = max((uint32_t)stepper_segments->get(), min(time_segments, (uint32_t)SEGMENT_BUFFER_SIZE_MAX));
+    segment_buffer      = (segment_t*)heap_caps_malloc(sizeof(segment_t) * segment_buffer_size, MALLOC_CAP_INTERNAL);
+    st_block_buffer     = (st_block_t*)heap_caps_malloc(sizeof(st_block_t) * (segment_buffer_size - 1), MALLOC_CAP_INTERNAL);
+    if (segment_buffer == NULL || st_block_buffer == NULL) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Stepper/Segments %d does not fit, using %d", segment_buffer_size, SEGMENT_BUFFER_SIZE);
+        free(segment_buffer);
+        free(st_block_buffer);
+        segment_buffer_size = SEGMENT_BUFFER_SIZE;
+        segment_buffer      = (segment_t*)heap_caps_malloc(sizeof(segment_t) * segment_buffer_size, MALLOC_CAP_INTERNAL);
+        st_block_buffer     = (st_block_t*)heap_caps_malloc(sizeof(st_block_t) * (segment_buffer_size - 1), MALLOC_CAP_INTERNAL);
+    }
+    segment_shaping = (segment_shaping_t*)malloc(sizeof(segment_shaping_t) * segment_buffer_size);  // NULL disables shaping
+    segment_resume  = (segment_resume_t*)malloc(sizeof(segment_resume_t) * segment_buffer_size);
+    segment_profiles = (segment_profile_t*)calloc(SEGMENT_PROFILE_CACHE, sizeof(segment_profile_t));
+
     // grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Axis count %d", number_axis->get());
     // grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "%s", stepper_names[current_stepper]);
 
@@ -376,6 +1153,27 @@ void stepper_init() {
 #endif
     // Other stepper use timer interrupt
     Stepper_Timer_Init();
+
+    prep_mutex = xSemaphoreCreateRecursiveMutex();
+    xTaskCreatePinnedToCore(stepperPrepTask,  // task
+                            "stepperPrepTask",
+                            4096,  // stack size
+                            NULL,
+                            STEPPER_PREP_TASK_PRIORITY,
+                            &prep_task_handle,
+                            STEPPER_PREP_TASK_CORE);
+}
+
+void st_prep_lock() {
+    if (prep_mutex != NULL) {
+        xSemaphoreTakeRecursive(prep_mutex, portMAX_DELAY);
+    }
+}
+
+void st_prep_unlock() {
+    if (prep_mutex != NULL) {
+        xSemaphoreGiveRecursive(prep_mutex);
+    }
 }
 
 void stepper_switch(stepper_id_t new_stepper) {
@@ -400,6 +1198,9 @@ void stepper_switch(stepper_id_t new_stepper) {
 // enabled. Startup init and limits call this function but shouldn't start the cycle.
 void st_wake_up() {
     //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "st_wake_up");
+    if (!xPortInIsrContext()) {
+        system_cpu_full();  // Before the first step
+    }
     // Enable stepper drivers.
     motors_set_disable(false);
     stepper_idle = false;
@@ -417,12 +1218,16 @@ void st_wake_up() {
     st.step_pulse_time = -(((pulse_microseconds->get() - 2) * ticksPerMicrosecond) >> 3);
 #endif
 
+#ifdef USE_STEP_PCNT
+    step_verify_sync(st.step_outbits, st.dir_outbits);
+#endif
     // Enable Stepper Driver Interrupt
     Stepper_Timer_Start();
 }
 
 // Reset and clear stepper subsystem variables
 void st_reset() {
+    StPrepLock lock;
 #ifdef ESP_DEBUG
     //Serial.println("st_reset()");
 #endif
@@ -433,23 +1238,37 @@ void st_reset() {
     }
 #endif
     st_go_idle();
+    st_halted = false;
     // Initialize stepper algorithm variables.
     memset(&prep, 0, sizeof(st_prep_t));
     memset(&st, 0, sizeof(stepper_t));
+    laser_pulse_cancel();
+    st_profile_cancel();
+    raster_reset();
     st.exec_segment     = NULL;
     pl_block            = NULL;  // Planner block pointer used by segment buffer
-    segment_buffer_tail = 0;
-    segment_buffer_head = 0;  // empty = tail
-    segment_next_head   = 1;
+    segment_buffer_tail.store(0, std::memory_order_relaxed);
+    segment_buffer_head.store(0, std::memory_order_relaxed);  // empty = tail
+    segment_prep_head = 0;
+    segment_next_head = 1;
+    shaper_reset();
     st.step_outbits     = 0;
     st.dir_outbits      = 0;  // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
 }
 
+void IRAM_ATTR st_halt() {
+    st_halted = true;
+    if (current_stepper != ST_I2S_STREAM) {
+        timer_pause(STEP_TIMER_GROUP, STEP_TIMER_INDEX);  // The I2S task stops at its next event
+    }
+}
+
 // Stepper shutdown
 void st_go_idle() {
     // Disable Stepper Driver Interrupt. Allow Stepper Port Reset Interrupt to finish, if active.
     Stepper_Timer_Stop();
+    jog_steps_end();  // Every jog ends here, run out, cancelled or reset
 
     // Set stepper driver idle state, disabled or enabled, depending on settings and circumstances.
     if (((stepper_idle_lock_time->get() != 0xff) || sys_rt_exec_alarm != ExecAlarm::None || sys.state == State::Sleep) &&
@@ -472,18 +1291,148 @@ void st_go_idle() {
     st.step_outbits = 0;
 }
 
+// Highest step rate the current stepper outputs cleanly: a step event holds the pulse and an
+// equal low time, in whole I2S samples for the streamed stepper.
+static uint32_t st_max_step_rate() {
+    uint32_t pulse_us = MAX(motion_config.pulse_microseconds, 1);
+#ifdef USE_I2S_STEPS
+    if (current_stepper == ST_I2S_STREAM) {
+        uint32_t usec_per_n = i2s_out_get_usec_per_pulse();
+        pulse_us            = (pulse_us + usec_per_n - 1) / usec_per_n * usec_per_n;
+    }
+#endif
+    return 1000000 / (2 * pulse_us);
+}
+
+void st_report_limits(uint8_t client) {
+    uint32_t max_rate = st_max_step_rate();
+    grbl_msg_sendf(client,
+                   MsgLevel::Info,
+                   "Step timer %u Hz, AMASS %d levels below %u Hz, steps up to %u/s, blocks up to %u steps",
+                   fStepperTimer,
+                   maxAmassLevel,
+                   fStepperTimer / amassThreshold,
+                   max_rate,
+                   maxBlockSteps);
+    for (int axis = 0; axis < motion_config.n_axis; axis++) {
+        float    steps_per_mm = motion_config.steps_per_mm[axis];
+        uint32_t rate         = axis_settings[axis]->max_rate->get() * steps_per_mm / 60.0f;
+        if (rate > max_rate) {
+            grbl_msg_sendf(client, MsgLevel::Info, "%c MaxRate needs %u steps/s", report_get_axis_letter(axis), rate);
+        }
+        if (axis_settings[axis]->max_travel->get() * steps_per_mm > maxBlockSteps) {
+            grbl_msg_sendf(client, MsgLevel::Info, "%c MaxTravel is over the block step limit", report_get_axis_letter(axis));
+        }
+    }
+}
+
+// Drops the profile being recorded or replayed, when the prepped block changes course
+static void st_profile_cancel() {
+    if (profile_record != NULL) {
+        profile_record->used = 0;  // Taken first next time
+        profile_record       = NULL;
+    }
+    profile_replay = NULL;
+}
+
+static bool st_profile_key_equal(const segment_profile_key_t& a, const segment_profile_key_t& b) {
+    return a.step_event_count == b.step_event_count && a.millimeters == b.millimeters && a.entry_speed == b.entry_speed &&
+           a.entry_speed_sqr == b.entry_speed_sqr && a.exit_speed_sqr == b.exit_speed_sqr && a.nominal_speed == b.nominal_speed &&
+           a.acceleration == b.acceleration && a.dt_segment == b.dt_segment && a.s_curve == b.s_curve;
+}
+
+// Starts the replay of a complete profile with the same inputs and sets the prep profile from
+// it. Otherwise takes the least recently used entry to record the block into, and returns false.
+static bool st_profile_find(const segment_profile_key_t& key) {
+    if (segment_profiles == NULL) {
+        return false;
+    }
+    profile_loads++;
+    segment_profile_t* oldest = &segment_profiles[0];
+    for (int i = 0; i < SEGMENT_PROFILE_CACHE; i++) {
+        segment_profile_t* profile = &segment_profiles[i];
+        if (profile->complete && st_profile_key_equal(profile->key, key)) {
+            profile->used                       = profile_loads;
+            profile_replay                      = profile;
+            profile_next                        = 0;
+            prep.ramp_type                      = profile->ramp_type;
+            prep.recalculate_flag.decelOverride = profile->decel_override;
+            prep.mm_complete                    = profile->mm_complete;
+            prep.exit_speed                     = profile->exit_speed;
+            prep.maximum_speed                  = profile->maximum_speed;
+            prep.accelerate_until               = profile->accelerate_until;
+            prep.decelerate_after               = profile->decelerate_after;
+            perf_stats.profile_hits++;
+            return true;
+        }
+        if (profile->used < oldest->used) {
+            oldest = profile;
+        }
+    }
+    oldest->key       = key;
+    oldest->used      = profile_loads;
+    oldest->n_segment = 0;
+    oldest->complete  = false;
+    profile_record    = oldest;
+    perf_stats.profile_misses++;
+    return false;
+}
+
+// Keeps the profile just computed for the block being recorded
+static void st_profile_save() {
+    profile_record->ramp_type        = prep.ramp_type;
+    profile_record->decel_override   = prep.recalculate_flag.decelOverride;
+    profile_record->mm_complete      = prep.mm_complete;
+    profile_record->exit_speed       = prep.exit_speed;
+    profile_record->maximum_speed    = prep.maximum_speed;
+    profile_record->accelerate_until = prep.accelerate_until;
+    profile_record->decelerate_after = prep.decelerate_after;
+}
+
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters() {
     if (pl_block != NULL) {  // Ignore if at start of a new block.
-        prep.recalculate_flag.recalculate = 1;
-        pl_block->entry_speed_sqr         = prep.current_speed * prep.current_speed;  // Update entry speed.
-        pl_block                          = NULL;  // Flag st_prep_segment() to load and check active velocity profile.
+        st_profile_cancel();
+        prep.recalculate_flag.recalculate             = 1;
+        plan_profile.entry_speed_sqr[pl_block->index] = prep.current_speed * prep.current_speed;  // Update entry speed.
+        pl_block                                      = NULL;  // Flag st_prep_segment() to load and check active velocity profile.
+    }
+}
+
+void st_hold_truncate() {
+    StPrepLock lock;
+    if (segment_resume == NULL || pl_block == NULL || pl_block->motion.dwell || sys.step_control.executeHold ||
+        sys.step_control.executeSysMotion || motion_config.shaper.n_impulse > 0 || segment_buffer_head.load(std::memory_order_relaxed) != segment_prep_head) {
+        return;  // Shaped segments are already on the shaper's timeline
     }
+    // Keep the segment at the tail, executing or about to be, and the one after it, which the
+    // ISR may take before this is done
+    uint8_t tail   = segment_buffer_tail.load(std::memory_order_acquire);
+    uint8_t queued = segment_prep_head >= tail ? segment_prep_head - tail : segment_buffer_size - tail + segment_prep_head;
+    if (queued <= 2) {
+        return;
+    }
+    uint8_t new_head = (tail + 2) % segment_buffer_size;
+    uint8_t last     = (tail + 1) % segment_buffer_size;
+    if (segment_buffer[last].st_block_index != prep.st_block_index) {
+        return;  // The block before may already be gone from the planner
+    }
+    st_profile_cancel();
+    segment_buffer_head.store(new_head, std::memory_order_release);
+    segment_prep_head = new_head;
+    segment_next_head = (new_head + 1) % segment_buffer_size;
+
+    const segment_resume_t* resume = &segment_resume[last];
+    plan_profile.millimeters[pl_block->index] = resume->mm_remaining;
+    prep.steps_remaining                      = resume->steps_remaining;
+    prep.dt_remainder                         = resume->dt_remainder;
+    prep.current_speed                        = resume->speed;
 }
 
 #ifdef PARKING_ENABLE
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void st_parking_setup_buffer() {
+    StPrepLock lock;
     // Store step execution data of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         prep.last_st_block_index  = prep.st_block_index;
@@ -491,6 +1440,7 @@ void st_parking_setup_buffer() {
         prep.last_dt_remainder    = prep.dt_remainder;
         prep.last_step_per_mm     = prep.step_per_mm;
     }
+    st_profile_cancel();
     // Set flags to execute a parking motion
     prep.recalculate_flag.parking     = 1;
     prep.recalculate_flag.recalculate = 0;
@@ -499,6 +1449,7 @@ void st_parking_setup_buffer() {
 
 // Restores the step segment buffer to the normal run state after a parking motion.
 void st_parking_restore_buffer() {
+    StPrepLock lock;
     // Restore step execution data and flags of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         st_prep_block                          = &st_block_buffer[prep.last_st_block_index];
@@ -520,7 +1471,200 @@ void st_parking_restore_buffer() {
 // Increments the step segment buffer block data ring buffer.
 static uint8_t st_next_block_index(uint8_t block_index) {
     block_index++;
-    return block_index == (SEGMENT_BUFFER_SIZE - 1) ? 0 : block_index;
+    return block_index == (segment_buffer_size - 1) ? 0 : block_index;
+}
+
+// Motion time queued between the ISR and the producer. The segment being executed counts whole.
+static uint32_t st_buffered_usec() {
+    uint32_t usec = 0;
+    uint8_t  head = segment_buffer_head.load(std::memory_order_relaxed);
+    for (uint8_t i = segment_buffer_tail.load(std::memory_order_acquire); i != head;) {
+        usec += st_segment_usec(&segment_buffer[i]);
+        if (++i == segment_buffer_size) {
+            i = 0;
+        }
+    }
+    return usec;
+}
+
+void st_get_buffer_state(uint8_t* segments, uint32_t* usec) {
+    uint8_t head = segment_buffer_head.load(std::memory_order_relaxed);
+    uint8_t tail = segment_buffer_tail.load(std::memory_order_acquire);
+    *segments    = head >= tail ? head - tail : segment_buffer_size - tail + head;
+    *usec        = st_buffered_usec();
+}
+
+// With $Stepper/SCurve, acceleration and deceleration ramps keep the duration and length of the
+// trapezoid ramp, so the planner's entry and exit speeds are met exactly as before, but the speed
+// follows v0 + dv * (3u^2 - 2u^3) over the normalized ramp time u instead of a straight line. The
+// acceleration then rises smoothly from zero to 1.5 times the planner acceleration and back to
+// zero, instead of being switched on and off at each end of the ramp.
+// Advances the ramp by time_var and updates mm_remaining and the current speed. Returns false,
+// changing nothing, when the ramp ends within time_var or reaches mm_end first. The caller then
+// finishes the ramp as for a trapezoid, which is close since the S-curve speed is flat there.
+static bool st_s_curve_ramp(float time_var, float& mm_remaining, float end_speed, float mm_end, float acceleration) {
+    if (prep.ramp_time < 0.0f) {  // First segment of the ramp
+        prep.ramp_time        = 0.0f;
+        prep.ramp_duration    = fabsf(end_speed - prep.current_speed) / acceleration;
+        prep.ramp_start_speed = prep.current_speed;
+        prep.ramp_start_mm    = mm_remaining;
+    }
+    float time = prep.ramp_time + time_var;
+    if (time < prep.ramp_duration) {
+        float u  = time / prep.ramp_duration;
+        float dv = end_speed - prep.ramp_start_speed;
+        float mm = prep.ramp_start_mm - time * prep.ramp_start_speed - dv * prep.ramp_duration * u * u * u * (1.0f - 0.5f * u);
+        if (mm > mm_end) {
+            mm_remaining       = mm;
+            prep.current_speed = prep.ramp_start_speed + dv * u * u * (3.0f - 2.0f * u);
+            prep.ramp_time     = time;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sets the ISR period and AMASS level of a segment from its step time in minutes, scaling n_step
+// to match.
+static void st_segment_timing(segment_t* segment, float inv_rate) {
+    // Compute CPU cycles per step for the prepped segment.
+    // fStepperTimer is in units of timerTicks/sec, so the dimensional analysis is
+    // timerTicks/sec * 60 sec/minute * minutes = timerTicks
+    float    ticks      = ceilf((fStepperTimer * 60) * inv_rate);  // (timerTicks/step)
+    uint32_t timerTicks = ticks < float(maxIsrPeriod) ? uint32_t(ticks) : maxIsrPeriod;
+    int      level;
+
+    // Compute step timing and multi-axis smoothing level.
+    for (level = 0; level < maxAmassLevel; level++) {
+        if (timerTicks < amassThreshold) {
+            break;
+        }
+        timerTicks >>= 1;
+    }
+    segment->amass_level = level;
+    segment->n_step <<= level;
+    segment->isrPeriod = timerTicks;
+}
+
+// Publishes the segments waiting for the input shaper, in order, as far as the shaper can time
+// them. Each keeps its steps and has its step rate scaled to the shaped duration. Returns the
+// motion time published.
+static uint32_t st_shaper_publish(bool stopped) {
+    uint32_t usec = 0;
+    uint8_t  head = segment_buffer_head.load(std::memory_order_relaxed);
+    while (head != segment_prep_head) {
+        segment_shaping_t* shaping = &segment_shaping[head];
+        segment_t*         segment = &segment_buffer[head];
+        float              dt      = shaping->dt;
+        if (motion_config.shaper.n_impulse > 0) {
+            // When the whole ring is waiting and the ISR has run dry, give up some shaping
+            // rather than stall, since nothing can be generated until a segment is freed.
+            uint8_t tail  = segment_buffer_tail.load(std::memory_order_acquire);
+            bool    force = head == tail && segment_next_head == tail;
+            if (!shaper_next(&motion_config.shaper, shaping->mm, stopped, force, &dt)) {
+                break;
+            }
+        }
+        float scale = dt > 0.0f ? dt / shaping->dt : 1.0f;
+        st_segment_timing(segment, shaping->inv_rate * scale);
+        if (st_block_buffer[segment->st_block_index].is_pwm_rate_adjusted) {
+            // Laser power follows the shaped speed
+            segment->spindle_rpm       = MIN(segment->spindle_rpm / scale, (float)shaping->rpm_limit);
+            segment->spindle_rpm_start = MIN(segment->spindle_rpm_start / scale, (float)shaping->rpm_limit);
+        }
+        if (++head == segment_buffer_size) {
+            head = 0;
+        }
+        segment_buffer_head.store(head, std::memory_order_release);
+        usec += st_segment_usec(segment);
+    }
+    if (motion_config.shaper.n_impulse == 0 && head == segment_prep_head) {
+        shaper_reset();  // Shaping was turned off, start over if it comes back on
+    }
+    return usec;
+}
+
+// A dwell block is timed by segments that step nothing, one ISR tick per millisecond, so the
+// planner and the segment ring keep filling while it runs and the motion after it starts as soon
+// as it ends. The stepper block only carries the block's output changes.
+const uint32_t dwellIsrPeriod = 1000 * ticksPerMicrosecond;
+
+static void st_dwell_load() {
+    st_profile_cancel();
+    if (prep.recalculate_flag.recalculate) {  // Reloaded after a replan or a hold, already started
+#ifdef PARKING_ENABLE
+        if (prep.recalculate_flag.parking) {
+            prep.recalculate_flag.recalculate = 0;
+        } else {
+            prep.recalculate_flag = {};
+        }
+#else
+        prep.recalculate_flag = {};
+#endif
+    } else {
+        prep.st_block_index = st_next_block_index(prep.st_block_index);
+        st_prep_block       = &st_block_buffer[prep.st_block_index];
+        memset(st_prep_block, 0, sizeof(st_block_t));
+        st_prep_block->outputs              = pl_block->outputs;
+        prep.recalculate_flag.decelOverride = 0;
+    }
+    prep.current_speed = 0.0f;
+    prep.exit_speed    = 0.0f;
+    // A laser in M4 is off at a standstill, as when the stepper goes idle
+    if (pl_block->spindle == SpindleState::Disable || (spindle->inLaserMode() && pl_block->spindle == SpindleState::Ccw)) {
+        prep.current_spindle_rpm = 0.0f;
+    } else {
+        prep.current_spindle_rpm = pl_block->spindle_speed;
+    }
+    sys.step_control.updateSpindleRpm = true;  // For the block after
+}
+
+// The pulse spacing of $Laser/PulsesPerMM over a block of millimeters, as the 0.32 fraction of a
+// pulse per step_event_count unit. No more than one pulse per step event.
+static uint32_t st_pulse_increment(float millimeters, uint32_t step_event_count) {
+    const float max_increment = (float)(UINT32_MAX >> maxAmassLevel);
+    float       increment     = motion_config.laser_pulses_per_mm * millimeters / step_event_count * 4294967296.0f;
+    if (increment >= max_increment) {
+        return UINT32_MAX >> maxAmassLevel;
+    }
+    return MAX((uint32_t)increment, 1u);
+}
+
+// Adds a segment of up to the segment time to the dwell. Returns true at the end of a feed hold,
+// the rest of the dwell staying in the block for the resume.
+static bool st_dwell_segment(uint32_t* buffered_us) {
+    if (sys.step_control.executeHold) {
+        sys.step_control.endMotion = true;
+#ifdef PARKING_ENABLE
+        if (!(prep.recalculate_flag.parking)) {
+            prep.recalculate_flag.holdPartialBlock = 1;
+        }
+#endif
+        return true;
+    }
+    if (segment_buffer_head.load(std::memory_order_relaxed) != segment_prep_head) {
+        *buffered_us += st_shaper_publish(true);  // The shaped motion before ends here
+    }
+    segment_t* segment         = &segment_buffer[segment_prep_head];
+    uint32_t   segment_ms      = MAX(uint32_t(motion_config.dt_segment * 60000.0f), 1u);
+    segment->st_block_index    = prep.st_block_index;
+    segment->n_step            = MIN(pl_block->dwell_ms, segment_ms);
+    segment->isrPeriod         = dwellIsrPeriod;
+    segment->amass_level       = 0;
+    segment->spindle_rpm       = prep.current_spindle_rpm;
+    segment->spindle_rpm_start = prep.current_spindle_rpm;
+    pl_block->dwell_ms -= segment->n_step;
+    segment_prep_head = segment_next_head;
+    if (++segment_next_head == segment_buffer_size) {
+        segment_next_head = 0;
+    }
+    segment_buffer_head.store(segment_prep_head, std::memory_order_release);
+    *buffered_us += st_segment_usec(segment);
+    if (pl_block->dwell_ms == 0) {
+        pl_block = NULL;
+        plan_discard_current_block();
+    }
+    return false;
 }
 
 /* Prepares step segment buffer. Continuously called from main program.
@@ -536,13 +1680,92 @@ static uint8_t st_next_block_index(uint8_t block_index) {
    Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
-void st_prep_buffer() {
+// Generates segments until the ring or the buffer time is full. Returns true when it stopped
+// for lack of motion instead, at the end of the planned motion or of a feed hold.
+// Works out whether the block just loaded by the prep ends a starvation of the planner or the
+// segment buffer in the middle of a job, and samples the planner depth.
+static void st_perf_block_loaded() {
+    if (perf_planner_dry) {
+        perf_planner_dry = false;
+        perf_stats.planner_empty++;
+    }
+    int64_t underflow_us = perf_underflow_us;
+    if (underflow_us) {
+        perf_underflow_us = 0;
+        if (esp_timer_get_time() - underflow_us < PERF_RESTART_US) {
+            perf_stats.segment_empty++;
+        }
+        perf_planner_filled = false;  // Refills from empty in the new cycle
+    }
+    if (plan_check_full_buffer()) {
+        perf_planner_filled = true;
+    }
+    if (perf_planner_filled && sys.state == State::Cycle) {
+        perf_stats.min_blocks = MIN(perf_stats.min_blocks, plan_get_block_buffer_count());
+    }
+}
+
+// Adds a generated segment of length mm to the motion time, to the slow time when it runs below
+// the block's nominal speed, and to the job statistics
+static void st_perf_segment(float dt, float mm, float start_speed, float programmed_rate) {
+    if (sys.state != State::Cycle || sys.step_control.executeHold) {
+        return;  // Feed holds slow down on purpose
+    }
+    perf_stats.motion_time += dt;
+    if (MAX(start_speed, prep.current_speed) < PERF_SLOW_FRACTION * prep.nominal_speed) {
+        perf_stats.slow_time += dt;
+    }
+
+    job_stats.distance += mm;
+    job_stats.motion_time += dt;
+    if (programmed_rate > 0.0f) {
+        job_stats.programmed_time += mm / programmed_rate;
+    }
+    float delta = prep.current_speed - start_speed;
+    if (delta > PERF_CRUISE_DELTA * prep.current_speed) {
+        job_stats.accel_time += dt;
+    } else if (-delta > PERF_CRUISE_DELTA * start_speed) {
+        job_stats.decel_time += dt;
+    } else {
+        job_stats.cruise_time += dt;
+    }
+}
+
+// No lock, so a status report never waits for the prep. The fields are each read whole.
+void st_perf_stats_get(stepper_perf_stats_t* stats) {
+    *stats = perf_stats;
+}
+
+void st_job_stats_get(stepper_job_stats_t* stats) {
+    StPrepLock lock;
+    *stats = job_stats;
+}
+
+void st_job_stats_reset() {
+    StPrepLock lock;
+    job_stats = {};
+}
+
+void st_perf_stats_reset() {
+    StPrepLock lock;
+    perf_stats          = { 0, 0, UINT8_MAX, 0.0f, 0.0f, 0, 0 };
+    perf_planner_dry    = false;
+    perf_planner_filled = false;
+    perf_underflow_us   = 0;
+}
+
+static bool st_prep_segments() {
     // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
     if (sys.step_control.endMotion) {
-        return;
+        return true;
     }
 
-    while (segment_buffer_tail != segment_next_head) {  // Check if we need to fill the buffer.
+    // Fill until the ring is full or holds the target motion time, whichever comes first
+    uint32_t buffer_time_us = motion_config.buffer_time_us;
+    uint32_t buffered_us    = st_buffered_usec();
+
+    while (segment_buffer_tail.load(std::memory_order_acquire) != segment_next_head &&
+           (buffer_time_us == 0 || buffered_us < buffer_time_us)) {  // Check if we need to fill the buffer.
         // Determine if we need to load a new planner block or if the block needs to be recomputed.
         if (pl_block == NULL) {
             // Query planner for a queued block
@@ -553,10 +1776,26 @@ void st_prep_buffer() {
             }
 
             if (pl_block == NULL) {
-                return;  // No planner blocks. Exit.
+                if (sys.state == State::Cycle && segment_buffer_tail.load(std::memory_order_relaxed) != segment_prep_head) {
+                    perf_planner_dry = true;  // Counted if a block comes before the stepper runs out
+                }
+                return true;  // No planner blocks. Exit.
+            }
+            // The profile of the block, see plan_profile_t
+            float& entry_speed_sqr = plan_profile.entry_speed_sqr[pl_block->index];
+            float  acceleration    = plan_profile.acceleration[pl_block->index];
+            float  millimeters     = plan_profile.millimeters[pl_block->index];
+            if (!sys.step_control.executeSysMotion) {
+                st_perf_block_loaded();
+            }
+            if (pl_block->motion.dwell) {
+                st_dwell_load();
+                continue;
             }
 
             // Check if we need to only recompute the velocity profile or load a new block.
+            bool new_block = !prep.recalculate_flag.recalculate;
+            st_profile_cancel();
             if (prep.recalculate_flag.recalculate) {
 #ifdef PARKING_ENABLE
                 if (prep.recalculate_flag.parking) {
@@ -576,7 +1815,7 @@ void st_prep_buffer() {
                 st_prep_block                 = &st_block_buffer[prep.st_block_index];
                 st_prep_block->direction_bits = pl_block->direction_bits;
                 uint8_t idx;
-                auto    n_axis = number_axis->get();
+                auto    n_axis = motion_config.n_axis;
 
                 // Bit-shift multiply all Bresenham data by the max AMASS level so that
                 // we never divide beyond the original data anywhere in the algorithm.
@@ -588,24 +1827,31 @@ void st_prep_buffer() {
 
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining  = (float)pl_block->step_event_count;
-                prep.step_per_mm      = prep.steps_remaining / pl_block->millimeters;
+                prep.step_per_mm      = prep.steps_remaining / millimeters;
                 prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR / prep.step_per_mm;
-                prep.dt_remainder     = 0.0;  // Reset for new segment block
+                prep.dt_remainder     = 0.0f;  // Reset for new segment block
                 if ((sys.step_control.executeHold) || prep.recalculate_flag.decelOverride) {
                     // New block loaded mid-hold. Override planner block entry speed to enforce deceleration.
                     prep.current_speed                  = prep.exit_speed;
-                    pl_block->entry_speed_sqr           = prep.exit_speed * prep.exit_speed;
+                    entry_speed_sqr                     = prep.exit_speed * prep.exit_speed;
                     prep.recalculate_flag.decelOverride = 0;
                 } else {
-                    prep.current_speed = sqrt(pl_block->entry_speed_sqr);
+                    prep.current_speed = sqrtf(entry_speed_sqr);
                 }
 
                 st_prep_block->is_pwm_rate_adjusted = false;  // set default value
+                st_prep_block->is_raster            = pl_block->motion.raster;
+                st_prep_block->outputs              = pl_block->outputs;
+                st_prep_block->pulse_increment      = 0;
                 // prep.inv_rate is only used if is_pwm_rate_adjusted is true
                 if (spindle->inLaserMode()) {  //
-                    if (pl_block->spindle == SpindleState::Ccw) {
+                    if (motion_config.laser_pulses_per_mm > 0.0f && !pl_block->motion.rapidMotion && !pl_block->motion.raster &&
+                        pl_block->spindle != SpindleState::Disable) {
+                        // Pulsed, so M3 and M4 alike fire at the programmed power
+                        st_prep_block->pulse_increment = st_pulse_increment(millimeters, st_prep_block->step_event_count);
+                    } else if (pl_block->spindle == SpindleState::Ccw) {
                         // Pre-compute inverse programmed rate to speed up PWM updating per step segment.
-                        prep.inv_rate                       = 1.0 / pl_block->programmed_rate;
+                        prep.inv_rate                       = 1.0f / pl_block->programmed_rate;
                         st_prep_block->is_pwm_rate_adjusted = true;
                     }
                 }
@@ -616,90 +1862,114 @@ void st_prep_buffer() {
              planner has updated it. For a commanded forced-deceleration, such as from a feed
              hold, override the planner velocities and decelerate to the target exit speed.
             */
-            prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
-            float inv_2_accel = 0.5 / pl_block->acceleration;
+            prep.mm_complete  = 0.0f;  // Default velocity profile complete at 0.0mm from end of block.
+            prep.ramp_time    = -1.0f;
+            float inv_2_accel = 0.5f / acceleration;
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
                 // the planner block profile, enforcing a deceleration to zero speed.
                 prep.ramp_type = RAMP_DECEL;
                 // Compute decelerate distance relative to end of block.
-                float decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
-                if (decel_dist < 0.0) {
+                float decel_dist = millimeters - inv_2_accel * entry_speed_sqr;
+                if (decel_dist < 0.0f) {
                     // Deceleration through entire planner block. End of feed hold is not in this block.
-                    prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
+                    prep.exit_speed = sqrtf(entry_speed_sqr - 2 * acceleration * millimeters);
                 } else {
                     prep.mm_complete = decel_dist;  // End of feed hold.
-                    prep.exit_speed  = 0.0;
+                    prep.exit_speed  = 0.0f;
                 }
             } else {  // [Normal Operation]
                 // Compute or recompute velocity profile parameters of the prepped planner block.
                 prep.ramp_type        = RAMP_ACCEL;  // Initialize as acceleration ramp.
-                prep.accelerate_until = pl_block->millimeters;
+                prep.accelerate_until = millimeters;
                 float exit_speed_sqr;
                 float nominal_speed;
                 if (sys.step_control.executeSysMotion) {
-                    prep.exit_speed = exit_speed_sqr = 0.0;  // Enforce stop at end of system motion.
+                    prep.exit_speed = exit_speed_sqr = 0.0f;  // Enforce stop at end of system motion.
                 } else {
                     exit_speed_sqr  = plan_get_exec_block_exit_speed_sqr();
-                    prep.exit_speed = sqrt(exit_speed_sqr);
+                    prep.exit_speed = sqrtf(exit_speed_sqr);
                 }
 
-                nominal_speed            = plan_compute_profile_nominal_speed(pl_block);
-                float nominal_speed_sqr  = nominal_speed * nominal_speed;
-                float intersect_distance = 0.5 * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
-                if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
-                    prep.accelerate_until = pl_block->millimeters - inv_2_accel * (pl_block->entry_speed_sqr - nominal_speed_sqr);
-                    if (prep.accelerate_until <= 0.0) {  // Deceleration-only.
-                        prep.ramp_type = RAMP_DECEL;
-                        // prep.decelerate_after = pl_block->millimeters;
-                        // prep.maximum_speed = prep.current_speed;
-                        // Compute override block exit speed since it doesn't match the planner exit speed.
-                        prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
-                        prep.recalculate_flag.decelOverride = 1;  // Flag to load next block as deceleration override.
-                        // TODO: Determine correct handling of parameters in deceleration-only.
-                        // Can be tricky since entry speed will be current speed, as in feed holds.
-                        // Also, look into near-zero speed handling issues with this.
-                    } else {
-                        // Decelerate to cruise or cruise-decelerate types. Guaranteed to intersect updated plan.
-                        prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
-                        prep.maximum_speed    = nominal_speed;
-                        prep.ramp_type        = RAMP_DECEL_OVERRIDE;
-                    }
-                } else if (intersect_distance > 0.0) {
-                    if (intersect_distance < pl_block->millimeters) {  // Either trapezoid or triangle types
-                        // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.0.
-                        prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
-                        if (prep.decelerate_after < intersect_distance) {  // Trapezoid type
-                            prep.maximum_speed = nominal_speed;
-                            if (pl_block->entry_speed_sqr == nominal_speed_sqr) {
-                                // Cruise-deceleration or cruise-only type.
-                                prep.ramp_type = RAMP_CRUISE;
-                            } else {
-                                // Full-trapezoid or acceleration-cruise types
-                                prep.accelerate_until -= inv_2_accel * (nominal_speed_sqr - pl_block->entry_speed_sqr);
+                nominal_speed      = plan_compute_profile_nominal_speed(pl_block);
+                prep.nominal_speed = nominal_speed;
+
+                // A block like one before gets its profile and its segments from the cache
+                bool cached = false;
+                if (new_block && !sys.step_control.executeSysMotion) {
+                    segment_profile_key_t key = { pl_block->step_event_count, millimeters,  prep.current_speed,       entry_speed_sqr,      exit_speed_sqr,
+                                                  nominal_speed,              acceleration, motion_config.dt_segment, motion_config.s_curve };
+                    cached                    = st_profile_find(key);
+                }
+                if (!cached) {
+                    float nominal_speed_sqr  = nominal_speed * nominal_speed;
+                    float intersect_distance = 0.5f * (millimeters + inv_2_accel * (entry_speed_sqr - exit_speed_sqr));
+                    if (entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
+                        prep.accelerate_until = millimeters - inv_2_accel * (entry_speed_sqr - nominal_speed_sqr);
+                        if (prep.accelerate_until <= 0.0f) {  // Deceleration-only.
+                            prep.ramp_type = RAMP_DECEL;
+                            // prep.decelerate_after = pl_block->millimeters;
+                            // prep.maximum_speed = prep.current_speed;
+                            // Compute override block exit speed since it doesn't match the planner exit speed.
+                            prep.exit_speed = sqrtf(entry_speed_sqr - 2 * acceleration * millimeters);
+                            prep.recalculate_flag.decelOverride = 1;  // Flag to load next block as deceleration override.
+                            // TODO: Determine correct handling of parameters in deceleration-only.
+                            // Can be tricky since entry speed will be current speed, as in feed holds.
+                            // Also, look into near-zero speed handling issues with this.
+                        } else {
+                            // Decelerate to cruise or cruise-decelerate types. Guaranteed to intersect updated plan.
+                            prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
+                            prep.maximum_speed    = nominal_speed;
+                            prep.ramp_type        = RAMP_DECEL_OVERRIDE;
+                        }
+                    } else if (intersect_distance > 0.0f) {
+                        if (intersect_distance < millimeters) {  // Either trapezoid or triangle types
+                            // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.0.
+                            prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
+                            if (prep.decelerate_after < intersect_distance) {  // Trapezoid type
+                                prep.maximum_speed = nominal_speed;
+                                if (entry_speed_sqr == nominal_speed_sqr) {
+                                    // Cruise-deceleration or cruise-only type.
+                                    prep.ramp_type = RAMP_CRUISE;
+                                } else {
+                                    // Full-trapezoid or acceleration-cruise types
+                                    prep.accelerate_until -= inv_2_accel * (nominal_speed_sqr - entry_speed_sqr);
+                                }
+                            } else {  // Triangle type
+                                prep.accelerate_until = intersect_distance;
+                                prep.decelerate_after = intersect_distance;
+                                prep.maximum_speed    = sqrtf(2.0f * acceleration * intersect_distance + exit_speed_sqr);
                             }
-                        } else {  // Triangle type
-                            prep.accelerate_until = intersect_distance;
-                            prep.decelerate_after = intersect_distance;
-                            prep.maximum_speed    = sqrt(2.0 * pl_block->acceleration * intersect_distance + exit_speed_sqr);
+                        } else {  // Deceleration-only type
+                            prep.ramp_type = RAMP_DECEL;
+                            // prep.decelerate_after = pl_block->millimeters;
+                            // prep.maximum_speed = prep.current_speed;
                         }
-                    } else {  // Deceleration-only type
-                        prep.ramp_type = RAMP_DECEL;
-                        // prep.decelerate_after = pl_block->millimeters;
-                        // prep.maximum_speed = prep.current_speed;
+                    } else {  // Acceleration-only type
+                        prep.accelerate_until = 0.0f;
+                        // prep.decelerate_after = 0.0;
+                        prep.maximum_speed = prep.exit_speed;
+                    }
+                    if (profile_record != NULL) {
+                        st_profile_save();
                     }
-                } else {  // Acceleration-only type
-                    prep.accelerate_until = 0.0;
-                    // prep.decelerate_after = 0.0;
-                    prep.maximum_speed = prep.exit_speed;
                 }
             }
 
             sys.step_control.updateSpindleRpm = true;  // Force update whenever updating block.
         }
 
+        if (pl_block->motion.dwell) {
+            if (st_dwell_segment(&buffered_us)) {
+                return true;
+            }
+            continue;
+        }
+
         // Initialize new segment
-        segment_t* prep_segment = &segment_buffer[segment_buffer_head];
+        float      acceleration = plan_profile.acceleration[pl_block->index];
+        float&     millimeters  = plan_profile.millimeters[pl_block->index];
+        segment_t* prep_segment = &segment_buffer[segment_prep_head];
 
         // Set new segment to point to the current segment data block.
         prep_segment->st_block_index = prep.st_block_index;
@@ -718,98 +1988,127 @@ void st_prep_buffer() {
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
-        float dt_max   = DT_SEGMENT;                                // Maximum segment time
-        float dt       = 0.0;                                       // Initialize segment time
+        float dt_max   = motion_config.dt_segment;                  // Maximum segment time
+        float dt       = 0.0f;                                      // Initialize segment time
         float time_var = dt_max;                                    // Time worker variable
         float mm_var;                                               // mm-Distance worker variable
         float speed_var;                                            // Speed worker variable
-        float mm_remaining = pl_block->millimeters;                 // New segment distance from end of block.
+        float mm_remaining = millimeters;                           // New segment distance from end of block.
         float minimum_mm   = mm_remaining - prep.req_mm_increment;  // Guarantee at least one step.
+        float start_speed  = prep.current_speed;                    // Speed at the start of the segment
+        bool  ramp_end;                                             // Reached the end of the acceleration ramp
 
-        if (minimum_mm < 0.0) {
-            minimum_mm = 0.0;
+        if (minimum_mm < 0.0f) {
+            minimum_mm = 0.0f;
         }
 
-        do {
-            switch (prep.ramp_type) {
-                case RAMP_DECEL_OVERRIDE:
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_var    = time_var * (prep.current_speed - 0.5 * speed_var);
-                    mm_remaining -= mm_var;
-                    if ((mm_remaining < prep.accelerate_until) || (mm_var <= 0)) {
-                        // Cruise or cruise-deceleration types only for deceleration override.
-                        mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var           = 2.0 * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        prep.ramp_type     = RAMP_CRUISE;
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Mid-deceleration override ramp.
-                        prep.current_speed -= speed_var;
-                    }
-                    break;
-                case RAMP_ACCEL:
-                    // NOTE: Acceleration ramp only computes during first do-while loop.
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_remaining -= time_var * (prep.current_speed + 0.5 * speed_var);
-                    if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
-                        // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
-                        mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var     = 2.0 * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        if (mm_remaining == prep.decelerate_after) {
-                            prep.ramp_type = RAMP_DECEL;
+        // Replayed as generated for an earlier block with the same profile, or generated
+        if (profile_replay != NULL && profile_next < profile_replay->n_segment) {
+            const segment_profile_step_t* step = &profile_replay->segment[profile_next++];
+            dt                                 = step->dt;
+            mm_remaining                       = step->mm_remaining;
+            prep.current_speed                 = step->speed;
+        } else {
+            do {
+                switch (prep.ramp_type) {
+                    case RAMP_DECEL_OVERRIDE:
+                        speed_var = acceleration * time_var;
+                        mm_var    = time_var * (prep.current_speed - 0.5f * speed_var);
+                        mm_remaining -= mm_var;
+                        if ((mm_remaining < prep.accelerate_until) || (mm_var <= 0)) {
+                            // Cruise or cruise-deceleration types only for deceleration override.
+                            mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                            time_var           = 2.0f * (millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
+                            prep.ramp_type     = RAMP_CRUISE;
+                            prep.current_speed = prep.maximum_speed;
+                        } else {  // Mid-deceleration override ramp.
+                            prep.current_speed -= speed_var;
+                        }
+                        break;
+                    case RAMP_ACCEL:
+                        // NOTE: Acceleration ramp only computes during first do-while loop.
+                        if (motion_config.s_curve) {
+                            ramp_end = !st_s_curve_ramp(time_var, mm_remaining, prep.maximum_speed, prep.accelerate_until, acceleration);
                         } else {
-                            prep.ramp_type = RAMP_CRUISE;
+                            speed_var = acceleration * time_var;
+                            mm_remaining -= time_var * (prep.current_speed + 0.5f * speed_var);
+                            ramp_end = mm_remaining < prep.accelerate_until;
                         }
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Acceleration only.
-                        prep.current_speed += speed_var;
-                    }
-                    break;
-                case RAMP_CRUISE:
-                    // NOTE: mm_var used to retain the last mm_remaining for incomplete segment time_var calculations.
-                    // NOTE: If maximum_speed*time_var value is too low, round-off can cause mm_var to not change. To
-                    //   prevent this, simply enforce a minimum speed threshold in the planner.
-                    mm_var = mm_remaining - prep.maximum_speed * time_var;
-                    if (mm_var < prep.decelerate_after) {  // End of cruise.
-                        // Cruise-deceleration junction or end of block.
-                        time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
-                        mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
-                        prep.ramp_type = RAMP_DECEL;
-                    } else {  // Cruising only.
-                        mm_remaining = mm_var;
-                    }
-                    break;
-                default:  // case RAMP_DECEL:
-                    // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
-                    speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
-                    if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
-                        // Compute distance from end of segment to end of block.
-                        mm_var = mm_remaining - time_var * (prep.current_speed - 0.5 * speed_var);  // (mm)
-                        if (mm_var > prep.mm_complete) {                                            // Typical case. In deceleration ramp.
+                        if (ramp_end) {  // End of acceleration ramp.
+                            // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                            mm_remaining   = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                            time_var       = 2.0f * (millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
+                            prep.ramp_time = -1.0f;
+                            if (mm_remaining == prep.decelerate_after) {
+                                prep.ramp_type = RAMP_DECEL;
+                            } else {
+                                prep.ramp_type = RAMP_CRUISE;
+                            }
+                            prep.current_speed = prep.maximum_speed;
+                        } else {  // Acceleration only.
+                            prep.current_speed += speed_var;
+                        }
+                        break;
+                    case RAMP_CRUISE:
+                        // NOTE: mm_var used to retain the last mm_remaining for incomplete segment time_var calculations.
+                        // NOTE: If maximum_speed*time_var value is too low, round-off can cause mm_var to not change. To
+                        //   prevent this, simply enforce a minimum speed threshold in the planner.
+                        mm_var = mm_remaining - prep.maximum_speed * time_var;
+                        if (mm_var < prep.decelerate_after) {  // End of cruise.
+                            // Cruise-deceleration junction or end of block.
+                            time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
+                            mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
+                            prep.ramp_type = RAMP_DECEL;
+                        } else {  // Cruising only.
                             mm_remaining = mm_var;
-                            prep.current_speed -= speed_var;
-                            break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
                         }
-                    }
-                    // Otherwise, at end of block or end of forced-deceleration.
-                    time_var           = 2.0 * (mm_remaining - prep.mm_complete) / (prep.current_speed + prep.exit_speed);
-                    mm_remaining       = prep.mm_complete;
-                    prep.current_speed = prep.exit_speed;
-            }
+                        break;
+                    default:  // case RAMP_DECEL:
+                        if (motion_config.s_curve) {
+                            if (st_s_curve_ramp(time_var, mm_remaining, prep.exit_speed, prep.mm_complete, acceleration)) {
+                                break;  // Mid S-curve deceleration
+                            }
+                        } else {
+                            // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
+                            speed_var = acceleration * time_var;   // Used as delta speed (mm/min)
+                            if (prep.current_speed > speed_var) {  // Check if at or below zero speed.
+                                // Compute distance from end of segment to end of block.
+                                mm_var = mm_remaining - time_var * (prep.current_speed - 0.5f * speed_var);  // (mm)
+                                if (mm_var > prep.mm_complete) {  // Typical case. In deceleration ramp.
+                                    mm_remaining = mm_var;
+                                    prep.current_speed -= speed_var;
+                                    break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
+                                }
+                            }
+                        }
+                        // Otherwise, at end of block or end of forced-deceleration.
+                        time_var           = 2.0f * (mm_remaining - prep.mm_complete) / (prep.current_speed + prep.exit_speed);
+                        mm_remaining       = prep.mm_complete;
+                        prep.current_speed = prep.exit_speed;
+                }
 
-            dt += time_var;  // Add computed ramp time to total segment time.
-            if (dt < dt_max) {
-                time_var = dt_max - dt;  // **Incomplete** At ramp junction.
-            } else {
-                if (mm_remaining > minimum_mm) {  // Check for very slow segments with zero steps.
-                    // Increase segment time to ensure at least one step in segment. Override and loop
-                    // through distance calculations until minimum_mm or mm_complete.
-                    dt_max += DT_SEGMENT;
-                    time_var = dt_max - dt;
+                dt += time_var;  // Add computed ramp time to total segment time.
+                if (dt < dt_max) {
+                    time_var = dt_max - dt;  // **Incomplete** At ramp junction.
+                } else {
+                    if (mm_remaining > minimum_mm) {  // Check for very slow segments with zero steps.
+                        // Increase segment time to ensure at least one step in segment. Override and loop
+                        // through distance calculations until minimum_mm or mm_complete.
+                        dt_max += motion_config.dt_segment;
+                        time_var = dt_max - dt;
+                    } else {
+                        break;  // **Complete** Exit loop. Segment execution time maxed.
+                    }
+                }
+            } while (mm_remaining > prep.mm_complete);  // **Complete** Exit loop. Profile complete.
+            if (profile_record != NULL) {
+                if (profile_record->n_segment < SEGMENT_PROFILE_SEGMENTS) {
+                    profile_record->segment[profile_record->n_segment++] = { dt, mm_remaining, prep.current_speed };
                 } else {
-                    break;  // **Complete** Exit loop. Segment execution time maxed.
+                    st_profile_cancel();  // Too long to keep
                 }
             }
-        } while (mm_remaining > prep.mm_complete);  // **Complete** Exit loop. Profile complete.
+        }
 
         /* -----------------------------------------------------------------------------------
           Compute spindle speed PWM output for step segment
@@ -819,6 +2118,7 @@ void st_prep_buffer() {
                 float rpm = pl_block->spindle_speed;
                 // NOTE: Feed and rapid overrides are independent of PWM value and do not alter laser power/rate.
                 if (st_prep_block->is_pwm_rate_adjusted) {
+                    prep_segment->spindle_rpm_start = rpm * (start_speed * prep.inv_rate);
                     rpm *= (prep.current_speed * prep.inv_rate);
                     //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "RPM %.2f", rpm);
                     //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Rates CV %.2f IV %.2f RPM %.2f", prep.current_speed, prep.inv_rate, rpm);
@@ -829,11 +2129,26 @@ void st_prep_buffer() {
                 prep.current_spindle_rpm = rpm;
             } else {
                 sys.spindle_speed        = 0.0;
-                prep.current_spindle_rpm = 0.0;
+                prep.current_spindle_rpm = 0.0f;
             }
             sys.step_control.updateSpindleRpm = false;
         }
+        if (!st_prep_block->is_pwm_rate_adjusted || pl_block->spindle == SpindleState::Disable) {
+            prep_segment->spindle_rpm_start = prep.current_spindle_rpm;
+        }
         prep_segment->spindle_rpm = prep.current_spindle_rpm;  // Reload segment PWM value
+        // A spindle slow to answer, like a VFD on Modbus, gets the next block's speed once the time
+        // left in this one, taken at the average of its current and exit speeds, is within the lead.
+        if (motion_config.spindle_lead > 0.0f && !pl_block->motion.systemMotion && !st_prep_block->is_pwm_rate_adjusted &&
+            pl_block->spindle != SpindleState::Disable) {
+            float speed_sum = prep.current_speed + prep.exit_speed;
+            if (speed_sum > 0.0f && 2.0f * mm_remaining < motion_config.spindle_lead * speed_sum) {
+                plan_block_t* next = plan_get_next_block();
+                if (next != NULL && next->spindle == pl_block->spindle) {
+                    prep_segment->spindle_rpm = next->spindle_speed;
+                }
+            }
+        }
 
         /* -----------------------------------------------------------------------------------
            Compute segment step rate, steps to execute, and apply necessary rate corrections.
@@ -846,8 +2161,8 @@ void st_prep_buffer() {
            supported by Grbl (i.e. exceeding 10 meters axis travel at 200 step/mm).
         */
         float step_dist_remaining    = prep.step_per_mm * mm_remaining;             // Convert mm_remaining to steps
-        float n_steps_remaining      = ceil(step_dist_remaining);                   // Round-up current steps remaining
-        float last_n_steps_remaining = ceil(prep.steps_remaining);                  // Round-up last steps remaining
+        float n_steps_remaining      = ceilf(step_dist_remaining);                  // Round-up current steps remaining
+        float last_n_steps_remaining = ceilf(prep.steps_remaining);                 // Round-up last steps remaining
         prep_segment->n_step         = last_n_steps_remaining - n_steps_remaining;  // Compute number of steps to execute.
 
         // Bail if we are at the end of a feed hold and don't have a step to execute.
@@ -861,7 +2176,7 @@ void st_prep_buffer() {
                     prep.recalculate_flag.holdPartialBlock = 1;
                 }
 #endif
-                return;  // Segment not generated, but current step data still retained.
+                return true;  // Segment not generated, but current step data still retained.
             }
         }
 
@@ -874,42 +2189,51 @@ void st_prep_buffer() {
         // typically very small and do not adversely effect performance, but ensures that Grbl
         // outputs the exact acceleration and velocity profiles as computed by the planner.
 
+        float profile_dt = dt;                          // Segment time before the partial step carry
+        float segment_mm = millimeters - mm_remaining;  // Path length of the segment
+        if (!sys.step_control.executeSysMotion) {
+            st_perf_segment(profile_dt, segment_mm, start_speed, pl_block->programmed_rate);
+        }
         dt += prep.dt_remainder;  // Apply previous segment partial step execute time
         // dt is in minutes so inv_rate is in minutes
         float inv_rate = dt / (last_n_steps_remaining - step_dist_remaining);  // Compute adjusted step rate inverse
 
-        // Compute CPU cycles per step for the prepped segment.
-        // fStepperTimer is in units of timerTicks/sec, so the dimensional analysis is
-        // timerTicks/sec * 60 sec/minute * minutes = timerTicks
-        uint32_t timerTicks = ceil((fStepperTimer * 60) * inv_rate);  // (timerTicks/step)
-        int      level;
-
-        // Compute step timing and multi-axis smoothing level.
-        for (level = 0; level < maxAmassLevel; level++) {
-            if (timerTicks < amassThreshold) {
-                break;
-            }
-            timerTicks >>= 1;
-        }
-        prep_segment->amass_level = level;
-        prep_segment->n_step <<= level;
-        // isrPeriod is stored as 16 bits, so limit timerTicks to the
-        // largest value that will fit in a uint16_t.
-        prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
-
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
-        segment_buffer_head = segment_next_head;
-        if (++segment_next_head == SEGMENT_BUFFER_SIZE) {
+        // The release store makes the segment and its block data visible to the ISR before the index.
+        // With input shaping the segment first waits for the shaper to retime it.
+        bool shaped = segment_shaping != NULL && !sys.step_control.executeSysMotion &&
+                      (motion_config.shaper.n_impulse > 0 || segment_buffer_head.load(std::memory_order_relaxed) != segment_prep_head);
+        if (shaped) {
+            segment_shaping_t* shaping = &segment_shaping[segment_prep_head];
+            shaping->inv_rate          = inv_rate;
+            shaping->dt                = profile_dt;
+            shaping->mm                = segment_mm;
+            shaping->rpm_limit         = MIN(pl_block->spindle_speed, (float)UINT16_MAX);
+        } else {
+            st_segment_timing(prep_segment, inv_rate);
+        }
+        segment_prep_head = segment_next_head;
+        if (++segment_next_head == segment_buffer_size) {
             segment_next_head = 0;
         }
+        if (shaped) {
+            shaper_add(profile_dt, segment_mm);
+            buffered_us += st_shaper_publish(false);
+        } else {
+            segment_buffer_head.store(segment_prep_head, std::memory_order_release);
+            buffered_us += st_segment_usec(prep_segment);
+        }
         // Update the appropriate planner and segment data.
-        pl_block->millimeters = mm_remaining;
-        prep.steps_remaining  = n_steps_remaining;
-        prep.dt_remainder     = (n_steps_remaining - step_dist_remaining) * inv_rate;
+        millimeters          = mm_remaining;
+        prep.steps_remaining = n_steps_remaining;
+        prep.dt_remainder    = (n_steps_remaining - step_dist_remaining) * inv_rate;
+        if (segment_resume != NULL) {
+            segment_resume[prep_segment - segment_buffer] = { mm_remaining, prep.steps_remaining, prep.dt_remainder, prep.current_speed };
+        }
         // Check for exit conditions and flag to load next planner block.
         if (mm_remaining == prep.mm_complete) {
             // End of planner block or forced-termination. No more distance to be executed.
-            if (mm_remaining > 0.0) {  // At end of forced-termination.
+            if (mm_remaining > 0.0f) {  // At end of forced-termination.
                 // Reset prep parameters for resuming and then bail. Allow the stepper ISR to complete
                 // the segment queue, where realtime protocol will set new state upon receiving the
                 // cycle stop flag from the ISR. Prep_segment is blocked until then.
@@ -919,18 +2243,241 @@ void st_prep_buffer() {
                     prep.recalculate_flag.holdPartialBlock = 1;
                 }
 #endif
-                return;  // Bail!
+                return true;  // Bail!
             } else {     // End of planner block
                 // The planner block is complete. All steps are set to be executed in the segment buffer.
                 if (sys.step_control.executeSysMotion) {
                     sys.step_control.endMotion = true;
-                    return;
+                    return true;
+                }
+                if (profile_record != NULL) {
+                    profile_record->complete = true;
+                    profile_record           = NULL;
                 }
-                pl_block = NULL;  // Set pointer to indicate check and load next planner block.
+                profile_replay = NULL;
+                pl_block       = NULL;  // Set pointer to indicate check and load next planner block.
                 plan_discard_current_block();
             }
         }
     }
+    return false;
+}
+
+void st_prep_buffer() {
+    TRACE_SCOPE(TraceEvent::PrepBuffer);
+    StPrepLock lock;
+    if (st_prep_segments() && segment_buffer_head.load(std::memory_order_relaxed) != segment_prep_head) {
+        st_shaper_publish(true);  // No more motion is coming, so the end of the shaped motion can go out
+    }
+}
+
+void st_isr_stats_get(stepper_isr_stats_t* stats) {
+    portDISABLE_INTERRUPTS();
+    *stats = isr_stats;
+    portENABLE_INTERRUPTS();
+}
+
+void st_isr_stats_reset() {
+    portDISABLE_INTERRUPTS();
+    isr_stats         = { UINT32_MAX, 0, 0, 0, 0 };
+    spindle_isr_stats = { UINT32_MAX, 0, 0, 0, 0 };
+    portENABLE_INTERRUPTS();
+}
+
+void st_spindle_isr_stats_get(stepper_isr_stats_t* stats) {
+    portDISABLE_INTERRUPTS();
+    *stats = spindle_isr_stats;
+    portENABLE_INTERRUPTS();
+}
+
+// Runs stepper_pulse_func() over a synthetic all-axis segment with the motors, timer and spindle
+// detached, timing each call as the ISR would see it under the given stepper type. Only valid in
+// Idle with an empty segment buffer; the stepper and machine position are restored afterwards.
+void st_bench(stepper_id_t stepper, uint16_t n_step, uint8_t amass_level, stepper_isr_stats_t* stats) {
+    *stats = { UINT32_MAX, 0, 0, 0, 0 };
+    if (n_step == 0) {
+        return;
+    }
+
+    bool expected = false;
+    if (!busy.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    stepper_id_t save_stepper = current_stepper;
+    stepper_t    save_st      = st;
+    int32_t      save_position[MAX_N_AXIS];
+    memcpy(save_position, sys_position, sizeof(sys_position));
+
+    // One block that moves every axis at a different ratio, so every Bresenham branch is taken.
+    st_block_t* block       = &st_block_buffer[0];
+    block->step_event_count = (uint32_t)n_step << amass_level;
+    block->direction_bits   = 0;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        block->steps[axis] = ((uint32_t)n_step << amass_level) >> axis;
+    }
+    block->is_pwm_rate_adjusted = false;
+    block->is_raster            = false;
+    block->pulse_increment      = 0;
+    block->outputs              = 0;
+
+    segment_t* segment      = &segment_buffer[0];
+    segment->n_step         = n_step;
+    segment->isrPeriod      = amassThreshold;
+    segment->st_block_index = 0;
+    segment->amass_level    = amass_level;
+    segment->spindle_rpm    = 0;
+
+    segment_buffer_tail.store(0, std::memory_order_relaxed);
+    segment_buffer_head.store(1, std::memory_order_release);
+    segment_prep_head   = 1;
+    st.exec_segment     = NULL;
+    st.exec_block_index = segment_buffer_size;  // Not a valid index, so the block is reloaded
+    st.dir_outbits      = 0;
+    st.step_outbits     = 0;
+
+    current_stepper = stepper;
+    bench_running   = true;
+    for (uint16_t i = 0; i < n_step; i++) {
+        portDISABLE_INTERRUPTS();
+        uint32_t start_cycles = xthal_get_ccount();
+        stepper_pulse_func();
+        uint32_t cycles = xthal_get_ccount() - start_cycles;
+        portENABLE_INTERRUPTS();
+
+        if (cycles < stats->min_cycles) {
+            stats->min_cycles = cycles;
+        }
+        if (cycles > stats->max_cycles) {
+            stats->max_cycles = cycles;
+        }
+        stats->total_cycles += cycles;
+        stats->count++;
+    }
+    bench_running = false;
+
+    current_stepper     = save_stepper;
+    st                  = save_st;
+    segment_buffer_tail.store(0, std::memory_order_relaxed);
+    segment_buffer_head.store(0, std::memory_order_relaxed);
+    segment_prep_head = 0;
+    segment_next_head = 1;
+    memcpy(sys_position, save_position, sizeof(sys_position));
+    busy.store(false);
+}
+
+// Plans n_block alternating short and long moves and times each st_prep_buffer() pass over
+// them, per segment produced. The ring is drained after every pass so each one does real work.
+// Only valid in Idle with an empty planner; the planner and prep state are reset afterwards.
+void st_bench_prep(uint16_t n_block, stepper_isr_stats_t* stats) {
+    *stats = { UINT32_MAX, 0, 0, 0, 0 };
+    if (n_block == 0 || plan_get_current_block() != NULL) {
+        return;
+    }
+
+    StPrepLock lock;
+
+    float target[MAX_N_AXIS];
+    system_convert_array_steps_to_mpos(target, sys_position);
+
+    plan_line_data_t pl_data = {};
+    pl_data.feed_rate        = 6000.0f;
+
+    uint16_t planned = 0;
+    while (true) {
+        // Keep the planner topped up so junction speeds are computed over a full lookahead
+        while (planned < n_block && !plan_check_full_buffer()) {
+            bool is_short = (planned & 1) == 0;
+            target[X_AXIS] += is_short ? 0.5f : 20.0f;
+            target[Y_AXIS] += is_short ? 0.5f : 5.0f;
+            plan_buffer_line(target, &pl_data);
+            planned++;
+        }
+        if (plan_get_current_block() == NULL && pl_block == NULL) {
+            break;
+        }
+
+        uint8_t  head_before  = segment_buffer_head.load(std::memory_order_relaxed);
+        uint32_t start_cycles = xthal_get_ccount();
+        st_prep_buffer();
+        uint32_t cycles = xthal_get_ccount() - start_cycles;
+        uint8_t  head   = segment_buffer_head.load(std::memory_order_relaxed);
+
+        uint8_t segments = head >= head_before ? head - head_before : segment_buffer_size - head_before + head;
+        if (segments == 0) {
+            break;
+        }
+        cycles /= segments;
+        if (cycles < stats->min_cycles) {
+            stats->min_cycles = cycles;
+        }
+        if (cycles > stats->max_cycles) {
+            stats->max_cycles = cycles;
+        }
+        stats->total_cycles += (uint64_t)cycles * segments;
+        stats->count += segments;
+
+        // Discard what was prepared, as the ISR would once it had stepped it
+        segment_buffer_tail.store(head, std::memory_order_release);
+    }
+
+    st_reset();
+    plan_reset();
+    plan_sync_position();
+}
+
+static stepper_id_t sim_save_stepper;
+static int32_t      sim_save_position[MAX_N_AXIS];
+
+bool st_sim_begin() {
+    bool expected = false;
+    if (!busy.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+    sim_save_stepper = current_stepper;
+    memcpy(sim_save_position, sys_position, sizeof(sys_position));
+    current_stepper = ST_RMT;  // No step pulse to wait out, the RMT would time it
+    bench_running   = true;
+    return true;
+}
+
+uint32_t st_sim_run(void (*record)(const st_sim_segment_t* segment)) {
+    uint32_t         n_segment = 0;
+    bool             pending   = false;
+    st_sim_segment_t segment;
+    int32_t          start_position[MAX_N_AXIS];
+    while (st.exec_segment != NULL ||
+           segment_buffer_head.load(std::memory_order_acquire) != segment_buffer_tail.load(std::memory_order_relaxed)) {
+        if (st.exec_segment == NULL) {
+            // This call pops the segment at the tail
+            const segment_t* next = &segment_buffer[segment_buffer_tail.load(std::memory_order_relaxed)];
+            segment.n_step        = next->n_step;
+            segment.isr_period    = next->isrPeriod;
+            segment.amass_level   = next->amass_level;
+            memcpy(start_position, sys_position, sizeof(sys_position));
+            pending = true;
+        }
+        stepper_pulse_func();
+        if (st.exec_segment == NULL && pending) {
+            for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+                segment.steps[axis] = sys_position[axis] - start_position[axis];
+            }
+            record(&segment);
+            pending = false;
+            n_segment++;
+        }
+    }
+    return n_segment;
+}
+
+void st_sim_end() {
+    bench_running   = false;
+    current_stepper = sim_save_stepper;
+    memcpy(sys_position, sim_save_position, sizeof(sys_position));
+    busy.store(false);
+    st_reset();
+    plan_reset();
+    plan_sync_position();
 }
 
 // Called by realtime status reporting to fetch the current speed being executed. This value
@@ -951,20 +2498,27 @@ float st_get_realtime_rate() {
 }
 
 // The argument is in units of ticks of the timer that generates ISRs
-void IRAM_ATTR Stepper_Timer_WritePeriod(uint16_t timerTicks) {
+void IRAM_ATTR Stepper_Timer_WritePeriod(uint32_t timerTicks) {
     if (current_stepper == ST_I2S_STREAM) {
 #ifdef USE_I2S_STEPS
         // 1 tick = fTimers / fStepperTimer
         // Pulse ISR is called for each tick of alarm_val.
         // The argument to i2s_out_set_pulse_period is in units of microseconds
-        i2s_out_set_pulse_period(((uint32_t)timerTicks) / ticksPerMicrosecond);
+        i2s_out_set_pulse_period(timerTicks / ticksPerMicrosecond);
 #endif
     } else {
         timer_set_alarm_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, (uint64_t)timerTicks);
     }
 }
 
-void IRAM_ATTR Stepper_Timer_Init() {
+// Run on STEPPER_ISR_CORE, as an interrupt is allocated on the core that asks for it
+static void stepper_isr_register(void* arg) {
+    timer_isr_register(STEP_TIMER_GROUP, STEP_TIMER_INDEX, onStepperDriverTimer, NULL, STEPPER_ISR_FLAGS, NULL);
+    timer_isr_register(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, onStepperOffTimer, NULL, STEPPER_ISR_FLAGS, NULL);
+    timer_isr_register(LASER_TIMER_GROUP, LASER_TIMER_INDEX, onLaserPulseTimer, NULL, STEPPER_ISR_FLAGS, NULL);
+}
+
+void Stepper_Timer_Init() {
     timer_config_t config;
     config.divider     = fTimers / fStepperTimer;
     config.counter_dir = TIMER_COUNT_UP;
@@ -975,7 +2529,18 @@ void IRAM_ATTR Stepper_Timer_Init() {
     timer_init(STEP_TIMER_GROUP, STEP_TIMER_INDEX, &config);
     timer_set_counter_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, 0x00000000ULL);
     timer_enable_intr(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
-    timer_isr_register(STEP_TIMER_GROUP, STEP_TIMER_INDEX, onStepperDriverTimer, NULL, 0, NULL);
+
+    // The pulse timer, armed by the step ISR for each pulse with $Stepper/PulseTimer
+    config.auto_reload = false;
+    timer_init(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, &config);
+    timer_set_counter_value(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, 0x00000000ULL);
+    timer_enable_intr(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+
+    // The laser timer, armed by the step ISR for each pulse with $Laser/PulsesPerMM
+    timer_init(LASER_TIMER_GROUP, LASER_TIMER_INDEX, &config);
+    timer_set_counter_value(LASER_TIMER_GROUP, LASER_TIMER_INDEX, 0x00000000ULL);
+    timer_enable_intr(LASER_TIMER_GROUP, LASER_TIMER_INDEX);
+    esp_ipc_call_blocking(STEPPER_ISR_CORE, stepper_isr_register, NULL);
 }
 
 void IRAM_ATTR Stepper_Timer_Start() {
@@ -984,9 +2549,26 @@ void IRAM_ATTR Stepper_Timer_Start() {
 #endif
     if (current_stepper == ST_I2S_STREAM) {
 #ifdef USE_I2S_STEPS
+        if (i2s_out_get_pulser_status() != STEPPING) {
+            // Stream whole segments when every motor steps through the I2S port, else one step per callback
+            i2s_step_remain = 0;
+            if (motors_i2s_step_masks(i2s_motor_step_mask)) {
+                i2s_update_step_masks(motion_config.n_axis);
+                i2s_out_set_block_callback(stepper_i2s_fill_path);
+            } else {
+                i2s_out_set_block_callback(NULL);
+            }
+        }
         i2s_out_set_stepping();
 #endif
     } else {
+#ifdef USE_RMT_BURST
+        // Play runs of steps from RMT memory when every motor steps through RMT, else one step per ISR
+        rmt_burst_enabled = current_stepper == ST_RMT && motors_rmt_step_channels(rmt_motor_channel);
+        if (rmt_burst_enabled) {
+            rmt_update_channels(motion_config.n_axis);
+        }
+#endif
         timer_set_counter_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, 0x00000000ULL);
         timer_start(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
         TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
@@ -24,6 +24,7 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+// Default for $Stepper/Segments, the size of the step segment buffer allocated at boot
 #ifndef SEGMENT_BUFFER_SIZE
 #    define SEGMENT_BUFFER_SIZE 6
 #endif
@@ -31,8 +32,20 @@
 #include "Grbl.h"
 #include "Config.h"
 
+// Upper bound on the ring when it is sized from $Stepper/BufferTime
+const int SEGMENT_BUFFER_SIZE_MAX = 128;
+
+// Block profiles kept for reuse by later blocks with the same length, steps, speeds and
+// acceleration, like the rows of a raster, and the most segments one can have
+const int SEGMENT_PROFILE_CACHE    = 4;
+const int SEGMENT_PROFILE_SEGMENTS = 128;
+
+// Default for $Stepper/BufferTime, the motion time st_prep_buffer() keeps queued
+#ifndef DEFAULT_STEPPER_BUFFER_TIME
+#    define DEFAULT_STEPPER_BUFFER_TIME 50  // ms, 0 fills by segment count only
+#endif
+
 // Some useful constants.
-const double DT_SEGMENT              = (1.0 / (ACCELERATION_TICKS_PER_SECOND * 60.0));  // min/segment
 const double REQ_MM_INCREMENT_SCALAR = 1.25;
 const int    RAMP_ACCEL              = 0;
 const int    RAMP_CRUISE             = 1;
@@ -46,9 +59,15 @@ struct PrepFlag {
     uint8_t decelOverride : 1;
 };
 
-// fStepperTimer should be an integer divisor of the bus speed, i.e. of fTimers
-const uint32_t fStepperTimer = 20000000; // frequency of step pulse timer
+// fStepperTimer should be an integer divisor of the bus speed, i.e. of fTimers. The alarm is
+// 64 bits and a segment's isrPeriod 32, so a finer timer does not shorten the slowest step.
+#ifndef STEPPER_TIMER_HZ
+#    define STEPPER_TIMER_HZ 20000000
+#endif
+const uint32_t fStepperTimer = STEPPER_TIMER_HZ; // frequency of step pulse timer
 const int ticksPerMicrosecond = fStepperTimer / 1000000;
+static_assert(fTimers % fStepperTimer == 0 && fTimers / fStepperTimer >= 2, "STEPPER_TIMER_HZ must be fTimers divided by 2 or more");
+static_assert(fStepperTimer % 1000000 == 0, "STEPPER_TIMER_HZ must be a whole number of MHz");
 
 // Define Adaptive Multi-Axis Step-Smoothing(AMASS) levels and cutoff frequencies. The highest level
 // frequency bin starts at 0Hz and ends at its cutoff frequency. The next lower level frequency bin
@@ -61,11 +80,40 @@ const int ticksPerMicrosecond = fStepperTimer / 1000000;
 // NOTE: Current settings are set to overdrive the ISR to no more than 16kHz, balancing CPU overhead
 // and timer accuracy.  Do not alter these settings unless you know what you are doing.
 
-const uint32_t amassThreshold = fStepperTimer / 8000;
+// The cutoffs are derived from fStepperTimer rather than a CPU clock. The ISR runs at up to twice
+// AMASS_CUTOFF_HZ while smoothing, and a segment's n_step and isrPeriod are 32 bits, so neither
+// the step count of a long fast segment nor the period of a slow step is clipped to 16 bits.
+#ifndef AMASS_CUTOFF_HZ
+#    define AMASS_CUTOFF_HZ 8000  // Step rate below which AMASS level 1 starts
+#endif
+const uint32_t amassThreshold = fStepperTimer / AMASS_CUTOFF_HZ;
 const int maxAmassLevel = 3;  // Each level increase doubles the threshold
+const uint32_t maxIsrPeriod = UINT32_MAX / 2;  // Timer ticks, over a minute per step event, with headroom for sums
+
+// Block step counts are scaled by 1 << maxAmassLevel, and the Bresenham counters run up to twice
+// that, so a block of more steps than this would overflow them
+const uint32_t maxBlockSteps = UINT32_MAX >> (maxAmassLevel + 1);
+
+// Prints the step timing limits for $I, with an [MSG:] for each axis whose MaxRate needs more
+// steps per second than the current stepper can output
+void st_report_limits(uint8_t client);
+
+// The prep task keeps the segment buffer full while the main loop is busy parsing or reading
+// the SD card. It belongs on the core that does not run WiFi, which is core 1.
+#ifndef STEPPER_PREP_TASK_CORE
+#    define STEPPER_PREP_TASK_CORE 1
+#endif
+#ifndef STEPPER_PREP_TASK_PRIORITY
+#    define STEPPER_PREP_TASK_PRIORITY 3  // Above the main loop and the display
+#endif
+const int STEPPER_PREP_TASK_POLL_MS = 10;  // Also wakes this often, for blocks planned while the buffer was full
+
+const timer_group_t STEP_TIMER_GROUP  = TIMER_GROUP_0;
+const timer_idx_t   STEP_TIMER_INDEX  = TIMER_0;
+const timer_idx_t   PULSE_TIMER_INDEX = TIMER_1;  // One-shot, ends the step pulse with $Stepper/PulseTimer
 
-const timer_group_t STEP_TIMER_GROUP = TIMER_GROUP_0;
-const timer_idx_t   STEP_TIMER_INDEX = TIMER_0;
+const timer_group_t LASER_TIMER_GROUP = TIMER_GROUP_1;
+const timer_idx_t   LASER_TIMER_INDEX = TIMER_0;  // One-shot, ends the laser pulse with $Laser/PulsesPerMM
 
 // esp32 work around for diable in main loop
 extern uint64_t stepper_idle_counter;
@@ -93,9 +141,101 @@ enum stepper_id_t {
 extern const char*  stepper_names[];
 extern stepper_id_t current_stepper;
 
+// Flat copy of the settings read by the stepper ISR, the segment generator and the planner.
+// Reading Setting objects from those paths costs a pointer chase per value per step, so the
+// hot values are copied here whenever one of the underlying $ settings changes.
+typedef struct {
+    uint8_t           n_axis;
+    uint32_t          pulse_microseconds;
+    uint32_t          direction_delay_microseconds;
+    float             steps_per_mm[MAX_N_AXIS];
+    float             inv_steps_per_mm[MAX_N_AXIS];  // mm per step
+    float             inv_max_rate[MAX_N_AXIS];      // min/mm, from $n/MaxRate
+    float             inv_acceleration[MAX_N_AXIS];  // min^2/mm, from $n/Acceleration
+    float             dt_segment;           // min/segment, from $Stepper/AccelTicks
+    uint32_t          buffer_time_us;       // refill target, from $Stepper/BufferTime
+    bool              laser_dynamic_power;  // ramp M4 laser power through each segment, from $Laser/DynamicPower
+    uint32_t          laser_lead_ticks;     // laser power changes are made this early, from $Laser/ScanOffset in laser mode
+    float             laser_pulses_per_mm;  // cuts fire pulses this far apart instead of holding power, from $Laser/PulsesPerMM in laser mode
+    uint32_t          laser_pulse_ticks;    // length of each of those pulses, from $Laser/PulseWidth
+    float             spindle_lead;         // min, speed changes are made this early, from $Spindle/Speed/Lead
+    bool              s_curve;              // smoothstep speed ramps instead of linear, from $Stepper/SCurve
+    bool              pulse_timer;          // Timed and I2S static pulses end on the pulse timer, from $Stepper/PulseTimer
+    shaper_impulses_t shaper;               // input shaping of the path speed, from $Shaper/X/* and $Shaper/Y/*
+} motion_config_t;
+extern motion_config_t motion_config;
+
+// Rebuilds motion_config from the current settings. Called after settings load and change.
+void motion_config_update();
+
+// CPU cycle counts for stepper_pulse_func(), either from the live ISR or from st_bench().
+typedef struct {
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t count;
+    uint32_t missed;  // ISR entries skipped because the previous one was still running
+} stepper_isr_stats_t;
+
+void st_isr_stats_get(stepper_isr_stats_t* stats);
+void st_isr_stats_reset();  // Also resets the spindle statistics
+
+// Cycle counts of the spindle update at live segment loads, part of the ISR counts above
+void st_spindle_isr_stats_get(stepper_isr_stats_t* stats);
+
+// Dry runs, see Simulate.h. Between st_sim_begin() and st_sim_end() the stepper is detached as
+// for st_bench(), and st_sim_run() steps everything in the segment buffer from the caller,
+// passing each segment to record once it is done. st_sim_end() resets the stepper and planner
+// and puts the machine position back.
+typedef struct {
+    uint32_t n_step;      // Step events, scaled by AMASS
+    uint32_t isr_period;  // Timer ticks per step event
+    uint8_t  amass_level;
+    int32_t  steps[MAX_N_AXIS];  // Steps taken by each axis
+} st_sim_segment_t;
+
+bool     st_sim_begin();
+uint32_t st_sim_run(void (*record)(const st_sim_segment_t* segment));
+void     st_sim_end();
+
+// Motion starvation, for choosing how to stream a job. A planner or segment buffer running
+// empty only counts when motion carries on afterwards, not at the end of a job.
+typedef struct {
+    uint32_t planner_empty;  // The prep ran out of planner blocks while the stepper still moved
+    uint32_t segment_empty;  // The stepper ran out of segments and the cycle restarted within 1 s
+    uint8_t  min_blocks;     // Fewest planner blocks queued in a cycle once the planner had filled
+    float    slow_time;      // Motion time below 95% of the nominal speed, ramps included (min)
+    float    motion_time;    // All motion time in cycles (min)
+    uint32_t profile_hits;   // Blocks that replayed the segments of an earlier block
+    uint32_t profile_misses; // Blocks that could have, but generated theirs
+} stepper_perf_stats_t;
+
+void st_perf_stats_get(stepper_perf_stats_t* stats);
+void st_perf_stats_reset();
+
+// Feed accuracy of the current SD job, from the segments generated outside feed holds and
+// parking. Reset when a job is opened, reported when it finishes.
+typedef struct {
+    float distance;         // (mm)
+    float motion_time;      // (min)
+    float programmed_time;  // The same distance at the programmed feeds, without acceleration (min)
+    float accel_time;       // (min)
+    float decel_time;       // (min)
+    float cruise_time;      // (min)
+} stepper_job_stats_t;
+
+void st_job_stats_get(stepper_job_stats_t* stats);
+void st_job_stats_reset();
+
+// Times n_step synthetic step events through the segment buffer with the motors detached.
+void st_bench(stepper_id_t stepper, uint16_t n_step, uint8_t amass_level, stepper_isr_stats_t* stats);
+
+// Times st_prep_buffer() over n_block synthetic planner blocks, in cycles per segment produced.
+void st_bench_prep(uint16_t n_block, stepper_isr_stats_t* stats);
+
 // -- Task handles for use in the notifications
 void IRAM_ATTR onSteppertimer();
-void IRAM_ATTR onStepperOffTimer();
+void IRAM_ATTR onStepperOffTimer(void* para);
 
 void stepper_init();
 void stepper_switch(stepper_id_t new_stepper);
@@ -106,6 +246,10 @@ void st_wake_up();
 // Immediately disables steppers
 void st_go_idle();
 
+// Stops step generation at the next step event, for a hard limit. Safe from an ISR, where
+// st_go_idle() is not. The steppers stay stopped until st_reset().
+void st_halt();
+
 // Reset the stepper subsystem variables
 void st_reset();
 
@@ -115,22 +259,45 @@ void st_parking_setup_buffer();
 // Restores the step segment buffer to the normal run state after a parking motion.
 void st_parking_restore_buffer();
 
-// Reloads step segment buffer. Called continuously by realtime execution system.
+// Reloads step segment buffer. Called continuously by realtime execution system, and by the
+// prep task whenever the stepper frees a segment.
 void st_prep_buffer();
 
+// The prep task and the main program share the planner and the segment prep state. Code in the
+// main program that changes either holds this (recursive) lock so it never interleaves with a
+// prep pass on the other core. Not for use from an ISR.
+void st_prep_lock();
+void st_prep_unlock();
+
+// Holds the prep lock for the lifetime of the object
+class StPrepLock {
+public:
+    StPrepLock() { st_prep_lock(); }
+    ~StPrepLock() { st_prep_unlock(); }
+};
+
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters();
 
+// Called as a feed hold starts, before st_update_plan_block_parameters(). Drops the segments
+// queued after the next one and rewinds the prep to the end of it, so the deceleration starts
+// within two segments instead of after the whole segment buffer. Only segments of the block
+// being prepped are dropped, and none with input shaping active.
+void st_hold_truncate();
+
 // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
 float st_get_realtime_rate();
 
+// Number of segments queued for the stepper and the motion time they hold
+void st_get_buffer_state(uint8_t* segments, uint32_t* usec);
+
 // disable (or enable) steppers via STEPPERS_DISABLE_PIN
 bool get_stepper_disable();  // returns the state of the pin
 
 void set_stepper_pins_on(uint8_t onMask);
 void set_direction_pins_on(uint8_t onMask);
 
-void Stepper_Timer_WritePeriod(uint16_t timerTicks);
+void Stepper_Timer_WritePeriod(uint32_t timerTicks);
 void Stepper_Timer_Init();
 void Stepper_Timer_Start();
 void Stepper_Timer_Stop();
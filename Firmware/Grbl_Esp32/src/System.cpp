@@ -119,6 +119,7 @@ void system_ini() {  // Renamed from system_init() due to conflict with esp32 fi
 #ifdef ENABLE_CONTROL_SW_DEBOUNCE
 // this is the debounce task
 void controlCheckTask(void* pvParameters) {
+    heap_track_task();
     while (true) {
         int evt;
         xQueueReceive(control_sw_queue, &evt, portMAX_DELAY);  // block until receive queue
@@ -177,6 +178,30 @@ float system_convert_axis_steps_to_mpos(int32_t* steps, uint8_t idx) {
 // Returns machine position of axis 'idx'. Must be sent a 'step' array.
 // NOTE: If motor steps and machine position are not in the same coordinate frame, this function
 //   serves as a central place to compute the transformation.
+static uint32_t cpu_busy_ms = 0;  // millis() when the machine was last busy
+
+void system_cpu_full() {
+    cpu_busy_ms = millis();
+    if (getCpuFrequencyMhz() != CPU_FULL_MHZ) {
+        setCpuFrequencyMhz(CPU_FULL_MHZ);
+    }
+}
+
+void system_cpu_poll() {
+    bool idle = sys.state == State::Idle || sys.state == State::Alarm || sys.state == State::Sleep;
+#ifdef ENABLE_SD_CARD
+    idle = idle && get_sd_state(false) != SDState::BusyPrinting;
+#endif
+    if (!idle) {
+        system_cpu_full();
+        return;
+    }
+    uint32_t mhz = cpu_idle_mhz->get();
+    if (getCpuFrequencyMhz() != mhz && millis() - cpu_busy_ms >= CPU_IDLE_DELAY_MS) {
+        setCpuFrequencyMhz(mhz);
+    }
+}
+
 void system_convert_array_steps_to_mpos(float* position, int32_t* steps) {
     auto  n_axis = number_axis->get();
     float motors[n_axis];
@@ -186,9 +211,40 @@ void system_convert_array_steps_to_mpos(float* position, int32_t* steps) {
     motors_to_cartesian(position, motors, n_axis);
 }
 
+// The status reports, the touchscreen and the WebUI all ask for the machine position several
+// times a second, mostly while the machine stands still, and on a delta or polar machine
+// each answer is a forward kinematics solution. The last one is kept with the steps it was
+// computed from, and is recomputed only when the steps have moved, or after
+// system_mpos_invalidate() when the settings that go into it change.
+static float        mpos_cache[MAX_N_AXIS];
+static int32_t      mpos_cache_steps[MAX_N_AXIS];
+static bool         mpos_cache_valid = false;
+static portMUX_TYPE mpos_cache_mux   = portMUX_INITIALIZER_UNLOCKED;
+
+void system_mpos_invalidate() {
+    portENTER_CRITICAL(&mpos_cache_mux);
+    mpos_cache_valid = false;
+    portEXIT_CRITICAL(&mpos_cache_mux);
+}
+
 float* system_get_mpos() {
     static float position[MAX_N_AXIS];
-    system_convert_array_steps_to_mpos(position, sys_position);
+    int32_t      steps[MAX_N_AXIS];
+    memcpy(steps, sys_position, sizeof(steps));  // The stepper ISR moves sys_position
+    portENTER_CRITICAL(&mpos_cache_mux);
+    bool hit = mpos_cache_valid && memcmp(steps, mpos_cache_steps, sizeof(steps)) == 0;
+    if (hit) {
+        memcpy(position, mpos_cache, sizeof(position));
+    }
+    portEXIT_CRITICAL(&mpos_cache_mux);
+    if (!hit) {
+        system_convert_array_steps_to_mpos(position, steps);
+        portENTER_CRITICAL(&mpos_cache_mux);
+        memcpy(mpos_cache, position, sizeof(mpos_cache));
+        memcpy(mpos_cache_steps, steps, sizeof(mpos_cache_steps));
+        mpos_cache_valid = true;
+        portEXIT_CRITICAL(&mpos_cache_mux);
+    }
     return position;
 };
 
@@ -276,6 +332,7 @@ void system_exec_control_pin(ControlPins pins) {
     } else if (pins.bit.macro3) {
         user_defined_macro(3);  // function must be implemented by user
     }
+    protocol_wake();
 }
 
 void sys_digital_all_off() {
@@ -285,7 +342,7 @@ void sys_digital_all_off() {
 }
 
 // io_num is the virtual digital pin#
-bool sys_set_digital(uint8_t io_num, bool turnOn) {
+bool IRAM_ATTR sys_set_digital(uint8_t io_num, bool turnOn) {
     return myDigitalOutputs[io_num]->set_level(turnOn);
 }
 
@@ -298,9 +355,19 @@ void sys_analog_all_off() {
 
 // io_num is the virtual analog pin#
 bool sys_set_analog(uint8_t io_num, float percent) {
-    auto     analog    = myAnalogOutputs[io_num];
-    uint32_t numerator = percent / 100.0 * analog->denominator();
-    return analog->set_level(numerator);
+    return myAnalogOutputs[io_num]->set_level(sys_analog_numerator(io_num, percent));
+}
+
+bool sys_analog_ready(uint8_t io_num) {
+    return myAnalogOutputs[io_num]->ready();
+}
+
+uint32_t sys_analog_numerator(uint8_t io_num, float percent) {
+    return percent / 100.0 * myAnalogOutputs[io_num]->denominator();
+}
+
+bool IRAM_ATTR sys_set_analog_isr(uint8_t io_num, uint32_t numerator) {
+    return myAnalogOutputs[io_num]->set_level_isr(numerator);
 }
 
 /*
@@ -371,6 +438,5 @@ void __attribute__((weak)) user_defined_macro(uint8_t index) {
 
     user_macro.replace('&', '\n');
     user_macro.toCharArray(line, 255, 0);
-    strcat(line, "\r");
-    WebUI::inputBuffer.push(line);
+    internal_command_send(line);
 }
@@ -168,14 +168,29 @@ float system_convert_axis_steps_to_mpos(int32_t* steps, uint8_t idx);
 // Updates a machine 'position' array based on the 'step' array sent.
 void   system_convert_array_steps_to_mpos(float* position, int32_t* steps);
 float* system_get_mpos();
+void   system_mpos_invalidate();  // After the steps per mm or the kinematics change
+
+// CPU clock by machine state. The stepper timer, RMT, LEDC and the UARTs run from the 80 MHz
+// APB clock and I2S from the 160 MHz PLL_D2 clock, which stay the same at every CPU clock from
+// 80 MHz up, so nothing needs to be rescaled. system_cpu_full() runs the CPU at CPU_FULL_MHZ, and
+// system_cpu_poll() drops it to $CPU/IdleMHz once the machine has been idle for CPU_IDLE_DELAY_MS
+// with no SD job running.
+const int CPU_FULL_MHZ      = 240;
+const int CPU_IDLE_DELAY_MS = 5000;
+void      system_cpu_full();  // Not from an ISR
+void      system_cpu_poll();
 
 // A task that runs after a control switch interrupt for debouncing.
 void controlCheckTask(void* pvParameters);
 void system_exec_control_pin(ControlPins pins);
 
-bool sys_set_digital(uint8_t io_num, bool turnOn);
+bool sys_set_digital(uint8_t io_num, bool turnOn);  // Also from the stepper, for queued M62/M63
 void sys_digital_all_off();
 bool sys_set_analog(uint8_t io_num, float percent);
 void sys_analog_all_off();
+// M67 changes queued with the motion: checked and converted when parsed, set from the stepper
+bool     sys_analog_ready(uint8_t io_num);
+uint32_t sys_analog_numerator(uint8_t io_num, float percent);
+bool     sys_set_analog_isr(uint8_t io_num, uint32_t numerator);
 
 int8_t sys_get_next_PWM_chan_num();
@@ -0,0 +1,178 @@
+/*
+  TaskStats.cpp - CPU use of each FreeRTOS task, for $Tasks
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+#include <esp_freertos_hooks.h>
+
+struct task_sample_t {
+    TaskHandle_t handle;
+    uint32_t     ticks[portNUM_PROCESSORS];
+    char         name[configMAX_TASK_NAME_LEN];  // Copied while it runs, in case it ends in the window
+};
+
+static portMUX_TYPE  stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static task_sample_t samples[TASK_STATS_MAX];
+static int           n_samples;
+static uint32_t      other_ticks[portNUM_PROCESSORS];  // Tasks past TASK_STATS_MAX
+static uint32_t      total_ticks[portNUM_PROCESSORS];
+static int           last_sample[portNUM_PROCESSORS];  // Where the search starts, usually a hit
+static bool          running = false;
+
+static void IRAM_ATTR task_stats_tick() {
+    int          core = xPortGetCoreID();
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL_ISR(&stats_mux);
+    total_ticks[core]++;
+    int i = last_sample[core];
+    if (i >= n_samples || samples[i].handle != task) {
+        for (i = 0; i < n_samples && samples[i].handle != task; i++) {}
+        if (i == n_samples) {
+            if (n_samples == TASK_STATS_MAX) {
+                other_ticks[core]++;
+                portEXIT_CRITICAL_ISR(&stats_mux);
+                return;
+            }
+            task_sample_t* s = &samples[n_samples++];
+            *s               = {};
+            s->handle        = task;
+            const char* name = pcTaskGetTaskName(NULL);
+            for (int c = 0; c < configMAX_TASK_NAME_LEN - 1 && name[c]; c++) {
+                s->name[c] = name[c];
+            }
+        }
+        last_sample[core] = i;
+    }
+    samples[i].ticks[core]++;
+    portEXIT_CRITICAL_ISR(&stats_mux);
+}
+
+static void task_stats_clear() {
+    portENTER_CRITICAL(&stats_mux);
+    n_samples = 0;
+    memset(other_ticks, 0, sizeof(other_ticks));
+    memset(total_ticks, 0, sizeof(total_ticks));
+    memset(last_sample, 0, sizeof(last_sample));
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+bool task_stats_running() {
+    return running;
+}
+
+void task_stats_start() {
+    if (running) {
+        return;
+    }
+    task_stats_clear();
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_register_freertos_tick_hook_for_cpu(task_stats_tick, core);
+    }
+    running = true;
+}
+
+void task_stats_stop() {
+    if (!running) {
+        return;
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_deregister_freertos_tick_hook_for_cpu(task_stats_tick, core);
+    }
+    running = false;
+}
+
+// Tenths of a percent of the core's ticks
+static uint32_t per_mille(uint32_t ticks, uint32_t total) {
+    return total ? (uint32_t)((uint64_t)ticks * 1000 / total) : 0;
+}
+
+// live is NULL for a task that ended in the window, or for Other, and the note is shown instead
+static void report_line(
+    uint8_t client, const char* name, const uint32_t* ticks, const uint32_t* total, TaskHandle_t live, const char* note = "") {
+    uint32_t cpu0 = per_mille(ticks[0], total[0]);
+    uint32_t cpu1 = per_mille(ticks[1], total[1]);
+    if (!live) {
+        grbl_sendf(client, "Task %-16s cpu0 %3u.%u%% cpu1 %3u.%u%% %s\r\n", name, cpu0 / 10, cpu0 % 10, cpu1 / 10, cpu1 % 10, note);
+        return;
+    }
+    BaseType_t affinity = xTaskGetAffinity(live);
+    grbl_sendf(client,
+               "Task %-16s cpu0 %3u.%u%% cpu1 %3u.%u%% core %c prio %2u stack free %u\r\n",
+               name,
+               cpu0 / 10,
+               cpu0 % 10,
+               cpu1 / 10,
+               cpu1 % 10,
+               affinity == tskNO_AFFINITY ? '-' : '0' + affinity,
+               uxTaskPriorityGet(live),
+               uxTaskGetStackHighWaterMark(live));
+}
+
+void task_stats_report(uint8_t client) {
+    // Allocated before taking the window, so the allocation is not in the next one
+    task_sample_t* window = (task_sample_t*)malloc(sizeof(samples));
+    if (!window) {
+        grbl_sendf(client, "Tasks: out of memory\r\n");
+        return;
+    }
+    uint32_t other[portNUM_PROCESSORS];
+    uint32_t total[portNUM_PROCESSORS];
+    portENTER_CRITICAL(&stats_mux);
+    int n = n_samples;
+    memcpy(window, samples, n * sizeof(task_sample_t));
+    memcpy(other, other_ticks, sizeof(other));
+    memcpy(total, total_ticks, sizeof(total));
+    portEXIT_CRITICAL(&stats_mux);
+    task_stats_clear();
+
+    grbl_sendf(client, "Tasks over %u ms\r\n", total[0] * portTICK_PERIOD_MS);
+
+    // Only handles of tasks still alive are asked for their priority and stack. The others
+    // ended in the window and are shown by the name they had.
+    UBaseType_t   n_live = uxTaskGetNumberOfTasks() + 4;  // Room for tasks started meanwhile
+    TaskStatus_t* live   = (TaskStatus_t*)malloc(n_live * sizeof(TaskStatus_t));
+#if configUSE_TRACE_FACILITY
+    n_live = live ? uxTaskGetSystemState(live, n_live, NULL) : 0;
+#else
+    n_live = 0;  // No task list, so none is known to be alive
+#endif
+
+    for (int i = 0; i < n; i++) {
+        TaskHandle_t handle = NULL;
+        for (UBaseType_t j = 0; j < n_live; j++) {
+            if (live[j].xHandle == window[i].handle) {
+                handle = window[i].handle;
+                break;
+            }
+        }
+        report_line(client, window[i].name, window[i].ticks, total, handle, "ended");
+    }
+    // Tasks that did not run on a tick in the window
+    for (UBaseType_t j = 0; j < n_live; j++) {
+        int i;
+        for (i = 0; i < n && window[i].handle != live[j].xHandle; i++) {}
+        if (i == n) {
+            uint32_t none[portNUM_PROCESSORS] = {};
+            report_line(client, live[j].pcTaskName, none, total, live[j].xHandle);
+        }
+    }
+    if (other[0] || other[1]) {
+        report_line(client, "Other", other, total, NULL);
+    }
+    free(live);
+    free(window);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+  TaskStats.h - CPU use of each FreeRTOS task, for $Tasks
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// The prebuilt framework has the FreeRTOS run-time counters compiled out, so the use is
+// sampled instead: while sampling, a tick hook on each core counts the task it interrupted.
+// At 1 kHz that resolves a task to about 0.1% over a few seconds. Interrupt handlers are
+// charged to the task they interrupt, and a task that runs briefly on each tick, after the
+// tick handler, is undercounted.
+//
+// The first $Tasks starts sampling. Each one after reports the window since the one before,
+// then starts the next, so it can be sent at both ends of a stretch of a job without
+// stopping the protocol loop. $Tasks=Off stops sampling.
+
+const int TASK_STATS_MAX = 32;  // Distinct tasks counted in a window, the rest are Other
+
+bool task_stats_running();
+void task_stats_start();
+void task_stats_stop();
+
+// Sends the window since the start or the last report and starts the next
+void task_stats_report(uint8_t client);
@@ -0,0 +1,109 @@
+/*
+  Telemetry.cpp - Sampled motion telemetry for plotting
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#include <atomic>
+#include <esp_timer.h>
+
+static telemetry_sample_t    ring[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t> ring_head;  // Free running, written by the timer callback
+static std::atomic<uint32_t> ring_tail;  // Free running, written by the reader
+static std::atomic<uint32_t> dropped;
+static esp_timer_handle_t    sample_timer = NULL;
+static bool                  running      = false;
+static uint64_t              last_isr_cycles;
+static int64_t               last_time_us;
+
+static void telemetry_sample(void* arg) {
+    int64_t             now = esp_timer_get_time();
+    stepper_isr_stats_t isr;
+    st_isr_stats_get(&isr);
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    if (head - ring_tail.load(std::memory_order_acquire) == TELEMETRY_RING_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        telemetry_sample_t* sample = &ring[head % TELEMETRY_RING_SIZE];
+        uint8_t             segments;
+        uint32_t            buffered_us;
+        st_get_buffer_state(&segments, &buffered_us);
+        // Cycles in the ISR over the cycles the CPU ran since the last sample
+        uint64_t cpu_cycles = uint64_t(now - last_time_us) * getCpuFrequencyMhz();
+        uint64_t permille   = cpu_cycles ? (isr.total_cycles - last_isr_cycles) * 1000 / cpu_cycles : 0;
+
+        sample->time_us        = uint32_t(now);
+        sample->rate           = st_get_realtime_rate();
+        sample->spindle_speed  = sys.spindle_speed;
+        sample->state          = uint8_t(sys.state);
+        sample->planner_blocks = plan_get_block_buffer_count();
+        sample->segments       = segments;
+        sample->buffered_ms    = MIN(buffered_us / 1000, uint32_t(UINT16_MAX));
+        sample->isr_permille   = MIN(permille, uint64_t(1000));
+        ring_head.store(head + 1, std::memory_order_release);
+    }
+    last_isr_cycles = isr.total_cycles;
+    last_time_us    = now;
+}
+
+void telemetry_start() {
+    if (sample_timer == NULL) {
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback                = telemetry_sample;
+        timer_args.name                    = "telemetry";
+        if (esp_timer_create(&timer_args, &sample_timer) != ESP_OK) {
+            sample_timer = NULL;
+            return;
+        }
+    }
+    if (running) {
+        return;
+    }
+    stepper_isr_stats_t isr;
+    st_isr_stats_get(&isr);
+    last_isr_cycles = isr.total_cycles;
+    last_time_us    = esp_timer_get_time();
+    ring_tail.store(ring_head.load());
+    dropped = 0;
+    running = esp_timer_start_periodic(sample_timer, 1000000 / TELEMETRY_RATE_HZ) == ESP_OK;
+}
+
+void telemetry_stop() {
+    if (running) {
+        esp_timer_stop(sample_timer);
+        running = false;
+    }
+}
+
+bool telemetry_running() {
+    return running;
+}
+
+int telemetry_read(telemetry_sample_t* samples, int max) {
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    uint32_t head = ring_head.load(std::memory_order_acquire);
+    int      n    = 0;
+    while (tail != head && n < max) {
+        samples[n++] = ring[tail++ % TELEMETRY_RING_SIZE];
+    }
+    ring_tail.store(tail, std::memory_order_release);
+    return n;
+}
+
+uint32_t telemetry_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
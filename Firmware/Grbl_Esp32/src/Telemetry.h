@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+  Telemetry.h - Sampled motion telemetry for plotting
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// While started, an esp_timer samples the feed rate, the live spindle or laser output, the
+// planner and segment buffer fill and the stepper ISR load TELEMETRY_RATE_HZ times a second into
+// a ring. The timer callback is the only writer and one reader drains it, so the ring needs no
+// lock. A sample that finds the ring full is counted as dropped. The WebUI streams the samples
+// to a websocket client that asks for them, see StreamFrame in WebServer.h.
+const int TELEMETRY_RATE_HZ   = 200;
+const int TELEMETRY_RING_SIZE = 256;  // Samples, a power of 2
+
+// Wire layout of a sample, little endian
+struct __attribute__((packed)) telemetry_sample_t {
+    uint32_t time_us;         // esp_timer_get_time(), wraps after 71 minutes
+    float    rate;            // st_get_realtime_rate(), mm/min
+    uint32_t spindle_speed;   // Output as last set, in S units, including laser power changes from the ISR
+    uint8_t  state;           // sys.state
+    uint8_t  planner_blocks;  // Blocks queued
+    uint8_t  segments;        // Step segments queued
+    uint16_t buffered_ms;     // Motion time the segments hold
+    uint16_t isr_permille;    // Share of the CPU time spent in the stepper ISR since the last sample
+};
+
+void telemetry_start();  // Clears the ring
+void telemetry_stop();
+bool telemetry_running();
+
+// Copies out up to max samples, oldest first, and returns how many
+int      telemetry_read(telemetry_sample_t* samples, int max);
+uint32_t telemetry_dropped();  // Since telemetry_start()
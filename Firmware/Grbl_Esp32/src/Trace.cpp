@@ -0,0 +1,89 @@
+/*
+  Trace.cpp - On-device trace of the motion pipeline, for finding the cause of stutter
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#ifdef USE_TRACE
+static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0, "TRACE_BUFFER_SIZE must be a power of 2");
+
+const uint8_t TRACE_DUMP_VERSION  = 1;
+const int     TRACE_DUMP_PER_LINE = 6;  // Records per [TRACE:] line, 48 bytes as 64 base64 characters
+
+static DRAM_ATTR trace_record_t trace_buffer[TRACE_BUFFER_SIZE];
+static DRAM_ATTR uint32_t       trace_head;  // Total records claimed
+static DRAM_ATTR bool           trace_paused;
+
+void IRAM_ATTR trace_record(TraceEvent event, uint8_t phase, uint16_t arg) {
+    if (trace_paused) {
+        return;
+    }
+    uint32_t        index  = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    trace_record_t* record = &trace_buffer[index & (TRACE_BUFFER_SIZE - 1)];
+    record->ccount         = xthal_get_ccount();
+    record->event          = uint8_t(event);
+    record->flags          = phase | (xPortGetCoreID() ? TRACE_CORE1 : 0);
+    record->arg            = arg;
+}
+
+void trace_clear() {
+    trace_paused = true;
+    trace_head   = 0;
+    trace_paused = false;
+}
+
+static size_t base64_encode(const uint8_t* data, size_t len, char* out) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char*             p        = out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t n = data[i] << 16;
+        if (i + 1 < len) {
+            n |= data[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            n |= data[i + 2];
+        }
+        *p++ = digits[(n >> 18) & 0x3f];
+        *p++ = digits[(n >> 12) & 0x3f];
+        *p++ = i + 1 < len ? digits[(n >> 6) & 0x3f] : '=';
+        *p++ = i + 2 < len ? digits[n & 0x3f] : '=';
+    }
+    *p = '\0';
+    return p - out;
+}
+
+void trace_dump(uint8_t client) {
+    trace_paused   = true;
+    uint32_t head  = trace_head;
+    uint32_t count = MIN(head, uint32_t(TRACE_BUFFER_SIZE));
+    grbl_sendf(client, "[TRACE:V%d,%u,%u,%u]\r\n", TRACE_DUMP_VERSION, ESP.getCpuFreqMHz(), count, head - count);
+    char line[8 + 4 * (TRACE_DUMP_PER_LINE * sizeof(trace_record_t) + 2) / 3 + 4];
+    for (uint32_t i = head - count; i < head; i += TRACE_DUMP_PER_LINE) {
+        trace_record_t records[TRACE_DUMP_PER_LINE];
+        int            n = MIN(uint32_t(TRACE_DUMP_PER_LINE), head - i);
+        for (int j = 0; j < n; j++) {
+            records[j] = trace_buffer[(i + j) & (TRACE_BUFFER_SIZE - 1)];
+        }
+        strcpy(line, "[TRACE:");
+        size_t len = 7 + base64_encode((const uint8_t*)records, n * sizeof(trace_record_t), line + 7);
+        strcpy(line + len, "]\r\n");
+        grbl_send(client, line);
+    }
+    trace_head   = 0;
+    trace_paused = false;
+}
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+/*
+  Trace.h - On-device trace of the motion pipeline, for finding the cause of stutter
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// With USE_TRACE, the parser, planner, segment prep, stepper ISR, SD reader and client RX
+// record timestamped events into a fixed ring. Writers claim a slot with one atomic add, so
+// recording takes no lock and is safe from the stepper ISR. The ring keeps the newest
+// TRACE_BUFFER_SIZE events. $Trace/Dump sends them as base64 [TRACE:] lines, which
+// doc/script/trace2json.py turns into Chrome trace JSON (chrome://tracing or Perfetto).
+//
+// Timestamps are the CPU cycle count of the core that recorded the event. The converter
+// unwraps the 32-bit counts, which wrap every 18 s at 240 MHz, so dump within that time
+// of the stutter or keep the ring busy.
+
+enum class TraceEvent : uint8_t {
+    PlanBufferLine = 0,  // plan_buffer_line()
+    PrepBuffer,          // st_prep_buffer()
+    SegmentLoad,         // Instant, the stepper ISR loaded a segment, arg is its step count
+    SdLine,              // Next SD line, including any wait for the reader task
+    GCodeLine,           // gc_execute_line()
+    ClientRx,            // Instant, bytes received from a client, arg is the byte count
+    Count,
+};
+
+// Wire layout of a record, also read by trace2json.py
+struct __attribute__((packed)) trace_record_t {
+    uint32_t ccount;
+    uint8_t  event;
+    uint8_t  flags;  // TRACE_* phase, and TRACE_CORE1 for core 1
+    uint16_t arg;
+};
+
+const uint8_t TRACE_INSTANT = 0;
+const uint8_t TRACE_BEGIN   = 1;
+const uint8_t TRACE_END     = 2;
+const uint8_t TRACE_CORE1   = 0x80;
+
+#ifdef USE_TRACE
+#    ifndef TRACE_BUFFER_SIZE
+#        define TRACE_BUFFER_SIZE 2048  // Records, a power of 2, 8 bytes each
+#    endif
+
+void trace_record(TraceEvent event, uint8_t phase, uint16_t arg);
+
+// Records begin on construction and end when it goes out of scope, for functions with
+// several returns
+class TraceScope {
+    TraceEvent _event;
+
+public:
+    TraceScope(TraceEvent event, uint16_t arg = 0) : _event(event) { trace_record(event, TRACE_BEGIN, arg); }
+    ~TraceScope() { trace_record(_event, TRACE_END, 0); }
+};
+
+#    define TRACE_EVENT(event, arg) trace_record(event, TRACE_INSTANT, arg)
+#    define TRACE_SCOPE(event) TraceScope trace_scope(event)
+
+// Sends the ring, oldest first, and clears it
+void trace_dump(uint8_t client);
+void trace_clear();
+#else
+#    define TRACE_EVENT(event, arg)
+#    define TRACE_SCOPE(event)
+#endif
@@ -0,0 +1,153 @@
+/*
+  Transform.cpp - Scaling, rotation and placement of a job in the XY plane
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// The job placement of $Job/Transform, in work coordinates
+static float job_scale   = 1.0f;
+static float job_degrees = 0.0f;
+static float job_offset[2];
+static float job_pivot[2];
+
+typedef struct {
+    float xx, xy, yx, yy, x0, y0;
+} affine_t;
+
+// a = b after a
+static void affine_then(affine_t* a, const affine_t& b) {
+    affine_t r;
+    r.xx = b.xx * a->xx + b.xy * a->yx;
+    r.xy = b.xx * a->xy + b.xy * a->yy;
+    r.yx = b.yx * a->xx + b.yy * a->yx;
+    r.yy = b.yx * a->xy + b.yy * a->yy;
+    r.x0 = b.xx * a->x0 + b.xy * a->y0 + b.x0;
+    r.y0 = b.yx * a->x0 + b.yy * a->y0 + b.y0;
+    *a   = r;
+}
+
+static void affine_move(affine_t* a, float x, float y) {
+    affine_then(a, { 1.0f, 0.0f, 0.0f, 1.0f, x, y });
+}
+
+static void affine_scale(affine_t* a, float sx, float sy, const float* center) {
+    affine_move(a, -center[0], -center[1]);
+    affine_then(a, { sx, 0.0f, 0.0f, sy, 0.0f, 0.0f });
+    affine_move(a, center[0], center[1]);
+}
+
+static void affine_rotate(affine_t* a, float degrees, const float* center) {
+    float radians = degrees * float(M_PI / 180.0);
+    float c       = cosf(radians);
+    float s       = sinf(radians);
+    affine_move(a, -center[0], -center[1]);
+    affine_then(a, { c, -s, s, c, 0.0f, 0.0f });
+    affine_move(a, center[0], center[1]);
+}
+
+static bool job_placed() {
+    return job_scale != 1.0f || job_degrees != 0.0f || job_offset[0] != 0.0f || job_offset[1] != 0.0f;
+}
+
+void transform_compose(transform_map_t* map, const gc_transform_t* program, const float* wco) {
+    bool placed = job_placed();
+    map->active = program->scaled || program->rotated || placed;
+    if (!map->active) {
+        return;
+    }
+    affine_t a = { 1.0f, 0.0f, 0.0f, 1.0f, -wco[X_AXIS], -wco[Y_AXIS] };  // To work coordinates
+    if (program->scaled) {
+        affine_scale(&a, program->scale[0], program->scale[1], program->scale_center);
+    }
+    if (program->rotated) {
+        affine_rotate(&a, program->degrees, program->rotation_center);
+    }
+    if (placed) {
+        affine_scale(&a, job_scale, job_scale, job_pivot);
+        affine_rotate(&a, job_degrees, job_pivot);
+        affine_move(&a, job_offset[0], job_offset[1]);
+    }
+    affine_move(&a, wco[X_AXIS], wco[Y_AXIS]);  // And back
+
+    map->xx = a.xx;
+    map->xy = a.xy;
+    map->yx = a.yx;
+    map->yy = a.yy;
+    map->x0 = a.x0;
+    map->y0 = a.y0;
+    // No scale is 0, so neither is the determinant
+    float inv_det = 1.0f / (a.xx * a.yy - a.xy * a.yx);
+    map->ixx      = a.yy * inv_det;
+    map->ixy      = -a.xy * inv_det;
+    map->iyx      = -a.yx * inv_det;
+    map->iyy      = a.xx * inv_det;
+    map->ix0      = -(map->ixx * a.x0 + map->ixy * a.y0);
+    map->iy0      = -(map->iyx * a.x0 + map->iyy * a.y0);
+    // Scalings along X and Y and rotations keep the columns at right angles
+    map->max_scale = sqrtf(MAX(a.xx * a.xx + a.yx * a.yx, a.xy * a.xy + a.yy * a.yy));
+}
+
+static void transform_job_report(uint8_t client) {
+    grbl_sendf(client,
+               "[JOB:%.4f,%.3f,%.3f,%.3f,%.3f,%.3f]\r\n",
+               job_scale,
+               job_degrees,
+               job_offset[0],
+               job_offset[1],
+               job_pivot[0],
+               job_pivot[1]);
+}
+
+Error transform_job_command(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value == NULL) {
+        transform_job_report(out->client());
+        return Error::Ok;
+    }
+    // scale, degrees, x, y, pivot x, pivot y
+    float       v[6] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    int         n    = 0;
+    const char* s    = value;
+    while (true) {
+        char* end;
+        v[n++] = strtof(s, &end);
+        if (end == s || (*end != ',' && *end != '\0')) {
+            return Error::BadNumberFormat;
+        }
+        if (*end == '\0') {
+            break;
+        }
+        if (n == 6) {
+            return Error::BadNumberFormat;
+        }
+        s = end + 1;
+    }
+    if (n == 1 || n == 3 || n == 5) {
+        return Error::BadNumberFormat;  // The scale comes with an angle, the rest in pairs
+    }
+    if (v[0] == 0.0f) {
+        return Error::NumberRange;
+    }
+    job_scale     = v[0];
+    job_degrees   = v[1];
+    job_offset[0] = v[2];
+    job_offset[1] = v[3];
+    job_pivot[0]  = v[4];
+    job_pivot[1]  = v[5];
+    gc_update_transform();
+    transform_job_report(out->client());
+    return Error::Ok;
+}
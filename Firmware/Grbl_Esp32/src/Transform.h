@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+  Transform.h - Scaling, rotation and placement of a job in the XY plane
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The moves of a program pass through a 2D affine map of X and Y on their way from the parser
+// to the kinematics, so a job can run at another size, angle or place without a new file:
+//
+//   G51 [X.. Y..] P..      scales by P about X Y, or by I along X and J along Y with I.. J..
+//   G68 [X.. Y..] R..      rotates by R degrees counterclockwise about X Y
+//   G50, G69               cancel the scaling and the rotation, as M2, M30 and a reset do
+//
+// X Y are in work coordinates, the current position for those left out. Scaling comes before
+// rotation. On top of these, $Job/Transform from the touchscreen or a sender places every job
+// until it is changed:
+//
+//   $Job/Transform=<scale>,<degrees>[,<x>,<y>[,<pivot x>,<pivot y>]]
+//
+// scales and rotates about the pivot and then moves by x y, in work coordinates. Without a
+// value it reports [JOB:...]; $Job/Transform=1,0 clears it.
+//
+// Both are folded into one matrix in machine coordinates whenever one of them or the work
+// offset changes, see gc_update_transform(), so a move costs two multiply-adds for each of X
+// and Y, and only a test when nothing is set. Moves in machine coordinates (G53, G28, G30),
+// probing, jogging, raster rows and the height map grid are not transformed. Arcs are
+// transformed segment by segment, so a scaling that differs along X and Y makes ellipses of
+// them. The touchscreen sends $Job/Transform with the rotation picked in its start popup,
+// about the middle of the previewed job.
+
+// Program part, modal g-code state in work coordinates
+typedef struct {
+    bool  scaled;           // G51
+    bool  rotated;          // G68
+    float scale[2];         // Along X and Y, never 0
+    float scale_center[2];  // X Y
+    float degrees;
+    float rotation_center[2];
+} gc_transform_t;
+
+// The whole transform in machine coordinates: x' = xx x + xy y + x0, y' = yx x + yy y + y0
+typedef struct {
+    bool  active;
+    float xx, xy, yx, yy, x0, y0;
+    float ixx, ixy, iyx, iyy, ix0, iy0;  // The inverse, for positions read back from the machine
+    float max_scale;                     // Largest stretch, which arc segmentation divides its tolerance by
+} transform_map_t;
+
+// Builds map from the program part, the job placement of $Job/Transform and the work offset
+void transform_compose(transform_map_t* map, const gc_transform_t* program, const float* wco);
+
+inline void transform_apply(const transform_map_t* map, float* position) {
+    float x          = position[X_AXIS];
+    position[X_AXIS] = map->xx * x + map->xy * position[Y_AXIS] + map->x0;
+    position[Y_AXIS] = map->yx * x + map->yy * position[Y_AXIS] + map->y0;
+}
+
+inline void transform_invert(const transform_map_t* map, float* position) {
+    float x          = position[X_AXIS];
+    position[X_AXIS] = map->ixx * x + map->ixy * position[Y_AXIS] + map->ix0;
+    position[Y_AXIS] = map->iyx * x + map->iyy * position[Y_AXIS] + map->iy0;
+}
+
+Error transform_job_command(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out);
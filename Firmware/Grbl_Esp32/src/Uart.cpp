@@ -11,9 +11,17 @@
 #include "soc/dport_reg.h"
 #include "soc/rtc.h"
 
-Uart::Uart(int uart_num) : _uart_num(uart_port_t(uart_num)), _pushback(-1) {}
+// Driver events queued between wakeups of the reader. Each one covers a FIFO full or an RX
+// timeout, so a few are plenty; when the queue is full, the driver drops events, not data.
+const int UART_EVENT_QUEUE_SIZE = 16;
 
-void Uart::begin(unsigned long baudrate, Data dataBits, Stop stopBits, Parity parity) {
+// With RTS/CTS, RTS is dropped once the RX FIFO holds this many bytes, leaving room in the
+// 128-byte FIFO for what the sender has in flight when it sees it
+const int UART_FLOW_CONTROL_THRESHOLD = 122;
+
+Uart::Uart(int uart_num) : _uart_num(uart_port_t(uart_num)), _pushback(-1), _event_queue(NULL) {}
+
+void Uart::begin(unsigned long baudrate, Data dataBits, Stop stopBits, Parity parity, int rx_buffer_size) {
     //    uart_driver_delete(_uart_num);
     uart_config_t conf;
     conf.baud_rate           = baudrate;
@@ -26,7 +34,24 @@ void Uart::begin(unsigned long baudrate, Data dataBits, Stop stopBits, Parity pa
     if (uart_param_config(_uart_num, &conf) != ESP_OK) {
         return;
     };
-    uart_driver_install(_uart_num, 256, 0, 0, NULL, 0);
+    uart_driver_install(_uart_num, rx_buffer_size, 0, UART_EVENT_QUEUE_SIZE, &_event_queue, 0);
+}
+
+// Blocks until the driver reports received data, for at most timeout. Returns true if there is
+// data to read. An event for data that was already read just makes for an early return.
+bool Uart::waitForData(TickType_t timeout) {
+    if (available()) {
+        return true;
+    }
+    if (_event_queue == NULL) {
+        vTaskDelay(timeout);
+    } else {
+        // UART_DATA, a full ring buffer or a FIFO overflow, after which the driver has dropped
+        // what did not fit. Line errors and breaks come without data.
+        uart_event_t event;
+        xQueueReceive(_event_queue, &event, timeout);
+    }
+    return available();
 }
 
 int Uart::available() {
@@ -84,6 +109,13 @@ size_t Uart::write(const char* text) {
 bool Uart::setHalfDuplex() {
     return uart_set_mode(_uart_num, UART_MODE_RS485_HALF_DUPLEX) != ESP_OK;
 }
+bool Uart::setBaudRate(unsigned long baud) {
+    return uart_set_baudrate(_uart_num, baud) != ESP_OK;
+}
+bool Uart::setFlowControl(bool enable) {
+    return uart_set_hw_flow_ctrl(
+               _uart_num, enable ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE, UART_FLOW_CONTROL_THRESHOLD) != ESP_OK;
+}
 bool Uart::setPins(int tx_pin, int rx_pin, int rts_pin, int cts_pin) {
     return uart_set_pin(_uart_num, tx_pin, rx_pin, rts_pin, cts_pin) != ESP_OK;
 }
@@ -4,8 +4,9 @@
 
 class Uart : public Stream {
 private:
-    uart_port_t _uart_num;
-    int         _pushback;
+    uart_port_t   _uart_num;
+    int           _pushback;
+    QueueHandle_t _event_queue;  // Driver events, so readers can block until data arrives
 
 public:
     enum class Data : int {
@@ -30,7 +31,9 @@ public:
     Uart(int uart_num);
     bool          setHalfDuplex();
     bool          setPins(int tx_pin, int rx_pin, int rts_pin = -1, int cts_pin = -1);
-    void          begin(unsigned long baud, Data dataBits, Stop stopBits, Parity parity);
+    void          begin(unsigned long baud, Data dataBits, Stop stopBits, Parity parity, int rx_buffer_size = 256);
+    bool          setBaudRate(unsigned long baud);
+    bool          setFlowControl(bool enable);
     int           available(void) override;
     int           read(void) override;
     int           read(TickType_t timeout);
@@ -44,6 +47,7 @@ public:
     size_t        write(const char* text);
     void          flush() { uart_flush(_uart_num); }
     bool          flushTxTimed(TickType_t ticks);
+    bool          waitForData(TickType_t timeout);
 };
 
 extern Uart Uart0;
@@ -18,6 +18,7 @@
 */
 
 #include "Grbl.h"
+#include "soc/ledc_struct.h"
 
 namespace UserOutput {
     DigitalOutput::DigitalOutput() {}
@@ -43,7 +44,7 @@ namespace UserOutput {
         grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "User Digital Output:%d on Pin:%s", _number, pinName(_pin).c_str());
     }
 
-    bool DigitalOutput::set_level(bool isOn) {
+    bool IRAM_ATTR DigitalOutput::set_level(bool isOn) {
         if (_number == UNDEFINED_PIN && isOn) {
             return false;
         }
@@ -119,4 +120,23 @@ namespace UserOutput {
 
         return true;
     }
+
+    // ledcWrite() takes a mutex, so this loads the duty into the channel registers itself, as
+    // the PWM spindle does. The channels from sys_get_next_PWM_chan_num() are high speed ones.
+    bool IRAM_ATTR AnalogOutput::set_level_isr(uint32_t numerator) {
+        if (!ready()) {
+            return false;
+        }
+        if (_current_value == numerator) {
+            return true;
+        }
+        _current_value = numerator;
+
+        bool on                                                      = numerator != 0;
+        LEDC.channel_group[0].channel[_pwm_channel].duty.duty        = numerator << 4;
+        LEDC.channel_group[0].channel[_pwm_channel].conf0.sig_out_en = on;
+        LEDC.channel_group[0].channel[_pwm_channel].conf1.duty_start = on;
+        LEDC.channel_group[0].channel[_pwm_channel].conf0.clk_en     = on;
+        return true;
+    }
 }
@@ -42,6 +42,8 @@ namespace UserOutput {
         AnalogOutput();
         AnalogOutput(uint8_t number, uint8_t pin, float pwm_frequency);
         bool     set_level(uint32_t numerator);
+        bool     set_level_isr(uint32_t numerator);  // Does not block, for the stepper
+        bool     ready() { return _pin != UNDEFINED_PIN && _pwm_channel != uint8_t(-1); }
         uint32_t denominator() { return 1UL << _resolution_bits; };
 
     protected:
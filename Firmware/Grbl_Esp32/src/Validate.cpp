@@ -0,0 +1,525 @@
+/*
+  Validate.cpp - Background check of job files before they are run
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+const uint32_t VALIDATE_MAGIC      = 0x324B4843;  // "CHK2"
+const int      VALIDATE_CHUNK_SIZE = 512;
+const int64_t  VALIDATE_SLICE_US   = 5000;  // Main loop time taken by each slice
+const int      VALIDATE_PATH_SIZE  = 128;
+
+// The request, written from any task
+static portMUX_TYPE      request_mux = portMUX_INITIALIZER_UNLOCKED;
+static char              request_path[VALIDATE_PATH_SIZE];
+static volatile uint32_t request_gen;
+static uint32_t          check_gen;
+
+// The check in progress, carried from slice to slice
+static File              source;  // Open while a check is in progress
+static char              check_path[VALIDATE_PATH_SIZE];
+static uint32_t          check_pos;  // Bytes read
+static validate_result_t check;
+static parser_state_t    sandbox;
+static float             start_offset[3];  // Work offset when the check started
+static uint8_t           chunk[VALIDATE_CHUNK_SIZE];
+static int               chunk_len;
+static int               chunk_pos;
+static char              line[SD_MAX_LINE_LENGTH + 1];
+static int               line_len;
+static bool              running = false;
+
+// The planner model of the check, see Validate.h. Speeds are in mm/min, as in the planner.
+typedef struct {
+    float    millimeters;
+    float    acceleration;
+    float    nominal_speed;
+    float    max_entry_speed_sqr;
+    float    entry_speed_sqr;  // Only meaningful for the oldest block, the others are replanned
+    uint32_t end_pos;          // File offset after the line of the block
+} eta_block_t;
+
+static eta_block_t eta_window[VALIDATE_ETA_WINDOW];
+static int         eta_tail;  // Oldest block
+static int         eta_count;
+static float       eta_previous_unit_vec[MAX_N_AXIS];
+static float       eta_previous_nominal_speed;
+static float       eta_position[MAX_N_AXIS];
+static double      eta_minutes;  // Of the blocks done
+static float*      eta_table;    // Being filled by the check, VALIDATE_ETA_POINTS entries
+static int         eta_points;   // Entries of eta_table filled
+
+// The job's table, loaded by validate_eta_load()
+static float*   job_eta_table;
+static float    job_eta_total = -1;
+static uint32_t job_eta_step;
+static uint32_t job_eta_size;
+
+bool validate_running() {
+    return running;
+}
+
+void validate_request(const char* path) {
+    portENTER_CRITICAL(&request_mux);
+    strncpy(request_path, path, sizeof(request_path) - 1);
+    request_path[sizeof(request_path) - 1] = '\0';
+    request_gen++;
+    portEXIT_CRITICAL(&request_mux);
+}
+
+bool validate_get(fs::FS& fs, const char* path, validate_result_t* result) {
+    File file = fs.open(path);
+    if (!file) {
+        return false;
+    }
+    uint32_t source_size  = file.size();
+    uint32_t source_mtime = file.getLastWrite();
+    file.close();
+    String chk_path = String(path) + ".chk";
+    File   chk      = fs.open(chk_path.c_str());
+    if (!chk) {
+        return false;
+    }
+    bool valid = chk.read((uint8_t*)result, sizeof(*result)) == sizeof(*result) && result->magic == VALIDATE_MAGIC &&
+                 result->source_size == source_size && result->source_mtime == source_mtime;
+    chk.close();
+    return valid;
+}
+
+bool validate_outside_travel(const validate_result_t* result) {
+    if (!result->has_box || !soft_limits->get()) {
+        return false;
+    }
+    int n_axis = MIN(3, number_axis->get());
+    for (int axis = 0; axis < n_axis; axis++) {
+        if (axis_settings[axis]->max_travel->get() <= 0) {
+            continue;
+        }
+        float offset = gc_state.coord_system[axis] + gc_state.coord_offset[axis];
+        if (result->box_min[axis] + offset < limitsMinPosition(axis) || result->box_max[axis] + offset > limitsMaxPosition(axis)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void validate_report(uint8_t client, const char* path, const validate_result_t* result) {
+    if (result->errors) {
+        grbl_msg_sendf(client,
+                       MsgLevel::Info,
+                       "Check %s: %u lines, %u errors, first at line %u: error %d",
+                       path,
+                       result->lines,
+                       result->errors,
+                       result->first_error_line,
+                       result->first_error);
+    } else {
+        grbl_msg_sendf(client, MsgLevel::Info, "Check %s: %u lines, no errors", path, result->lines);
+    }
+    uint32_t seconds = result->seconds;
+    grbl_msg_sendf(client, MsgLevel::Info, "Check time %u:%02u:%02u", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    if (result->has_box) {
+        grbl_msg_sendf(client,
+                       MsgLevel::Info,
+                       "Check box X%.3f:%.3f Y%.3f:%.3f Z%.3f:%.3f%s",
+                       result->box_min[X_AXIS],
+                       result->box_max[X_AXIS],
+                       result->box_min[Y_AXIS],
+                       result->box_max[Y_AXIS],
+                       result->box_min[Z_AXIS],
+                       result->box_max[Z_AXIS],
+                       validate_outside_travel(result) ? ", outside travel" : "");
+    }
+}
+
+// Minutes through a trapezoid, or a triangle when the block is too short to reach its speed
+static float eta_block_minutes(const eta_block_t* block, float exit_speed_sqr) {
+    float a2      = 2.0f * block->acceleration;
+    float v0      = sqrtf(block->entry_speed_sqr);
+    float v1      = sqrtf(exit_speed_sqr);
+    float vn_sqr  = block->nominal_speed * block->nominal_speed;
+    float accel_d = (vn_sqr - block->entry_speed_sqr) / a2;
+    float decel_d = (vn_sqr - exit_speed_sqr) / a2;
+    if (accel_d + decel_d <= block->millimeters) {
+        float cruise = block->millimeters - accel_d - decel_d;
+        return (block->nominal_speed - v0 + block->nominal_speed - v1) / block->acceleration + cruise / block->nominal_speed;
+    }
+    float peak = sqrtf(0.5f * (a2 * block->millimeters + block->entry_speed_sqr + exit_speed_sqr));
+    return (2.0f * peak - v0 - v1) / block->acceleration;
+}
+
+// Samples the total at the table offsets up to pos, before the block ending there is added
+static void eta_sample(uint32_t pos) {
+    while (eta_table && eta_points < VALIDATE_ETA_POINTS && (uint32_t)eta_points * check.eta_step < pos) {
+        eta_table[eta_points++] = eta_minutes * 60.0;
+    }
+}
+
+// Plans the window backward from a stop after its newest block, as the planner does when
+// that block is the last one it has, then finishes the oldest block
+static void eta_finish_oldest() {
+    float next_entry_sqr  = 0.0f;
+    float oldest_exit_sqr = 0.0f;
+    for (int n = eta_count - 1; n >= 0; n--) {
+        eta_block_t* block = &eta_window[(eta_tail + n) % VALIDATE_ETA_WINDOW];
+        if (n == 0) {
+            oldest_exit_sqr = next_entry_sqr;
+        }
+        next_entry_sqr = MIN(block->max_entry_speed_sqr, next_entry_sqr + 2.0f * block->acceleration * block->millimeters);
+    }
+    eta_block_t* oldest     = &eta_window[eta_tail];
+    oldest->entry_speed_sqr = MIN(oldest->entry_speed_sqr, next_entry_sqr);
+    float exit_sqr          = MIN(oldest_exit_sqr, oldest->entry_speed_sqr + 2.0f * oldest->acceleration * oldest->millimeters);
+    eta_sample(oldest->end_pos);
+    eta_minutes += eta_block_minutes(oldest, exit_sqr);
+    eta_tail = (eta_tail + 1) % VALIDATE_ETA_WINDOW;
+    if (--eta_count) {
+        eta_window[eta_tail].entry_speed_sqr = exit_sqr;
+    }
+}
+
+// Runs the window out to a stop, as a dwell or the end of the job makes the machine do
+static void eta_flush() {
+    while (eta_count) {
+        eta_finish_oldest();
+    }
+    eta_previous_nominal_speed = 0.0f;
+}
+
+// The job is timed from where the machine stands when the check starts
+static void eta_start() {
+    eta_tail                   = 0;
+    eta_count                  = 0;
+    eta_previous_nominal_speed = 0.0f;
+    eta_minutes                = 0.0;
+    eta_points                 = 0;
+    memcpy(eta_position, gc_state.position, sizeof(eta_position));
+    free(eta_table);
+    eta_table      = (float*)malloc(VALIDATE_ETA_POINTS * sizeof(float));
+    check.eta_step = eta_table ? MAX((check.source_size + VALIDATE_ETA_POINTS - 1) / VALIDATE_ETA_POINTS, 1u) : 0;
+}
+
+static void eta_drop() {
+    free(eta_table);
+    eta_table = NULL;
+}
+
+// The planner's geometry for a line: its unit vector, the junction limit against the last
+// line and the axis limits along it, from plan_buffer_line()
+static void eta_add_line(const float* target, const plan_line_data_t* pl_data) {
+    int   n_axis = number_axis->get();
+    float unit_vec[MAX_N_AXIS];
+    for (int idx = 0; idx < n_axis; idx++) {
+        unit_vec[idx] = target[idx] - eta_position[idx];
+    }
+    memcpy(eta_position, target, sizeof(eta_position));
+    float millimeters = convert_delta_vector_to_unit_vector(unit_vec);
+    if (millimeters <= 0.0f) {
+        return;
+    }
+    if (eta_count == VALIDATE_ETA_WINDOW) {
+        eta_finish_oldest();
+    }
+    eta_block_t* block  = &eta_window[(eta_tail + eta_count) % VALIDATE_ETA_WINDOW];
+    block->millimeters  = millimeters;
+    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
+    block->end_pos      = check_pos - (chunk_len - chunk_pos);
+    float rapid_rate    = limit_rate_by_axis_maximum(unit_vec);
+    float rate          = rapid_rate;
+    if (!pl_data->motion.rapidMotion) {
+        rate = pl_data->motion.inverseTime ? pl_data->feed_rate * millimeters : pl_data->feed_rate;
+        rate = MIN(rate, rapid_rate);
+    }
+    block->nominal_speed = MAX(rate, (float)MINIMUM_FEED_RATE);
+
+    float junction_speed_sqr = 0.0f;
+    if (eta_previous_nominal_speed > 0.0f) {
+        float junction_unit_vec[MAX_N_AXIS];
+        float junction_cos_theta = 0.0f;
+        for (int idx = 0; idx < n_axis; idx++) {
+            junction_cos_theta -= eta_previous_unit_vec[idx] * unit_vec[idx];
+            junction_unit_vec[idx] = unit_vec[idx] - eta_previous_unit_vec[idx];
+        }
+        if (junction_cos_theta > 0.999999f) {
+            junction_speed_sqr = MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED;
+        } else if (junction_cos_theta < -0.999999f) {
+            junction_speed_sqr = SOME_LARGE_VALUE;
+        } else {
+            convert_delta_vector_to_unit_vector(junction_unit_vec);
+            float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
+            float sin_theta_d2          = sqrtf(0.5f * (1.0f - junction_cos_theta));
+            junction_speed_sqr          = MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
+                                     (junction_acceleration * junction_deviation->get() * sin_theta_d2) / (1.0f - sin_theta_d2));
+        }
+    }
+    float slower               = MIN(block->nominal_speed, eta_previous_nominal_speed);
+    block->max_entry_speed_sqr = MIN(junction_speed_sqr, slower * slower);
+    block->entry_speed_sqr     = eta_count ? SOME_LARGE_VALUE : 0.0f;  // The first after a stop starts from rest
+    eta_count++;
+    eta_previous_nominal_speed = block->nominal_speed;
+    memcpy(eta_previous_unit_vec, unit_vec, sizeof(unit_vec));
+}
+
+void validate_target(const float* target, const plan_line_data_t* pl_data) {
+    int n_axis = MIN(3, number_axis->get());
+    for (int axis = 0; axis < n_axis; axis++) {
+        float value = target[axis] - start_offset[axis];
+        if (!check.has_box || value < check.box_min[axis]) {
+            check.box_min[axis] = value;
+        }
+        if (!check.has_box || value > check.box_max[axis]) {
+            check.box_max[axis] = value;
+        }
+    }
+    check.has_box = 1;
+    eta_add_line(target, pl_data);
+}
+
+void validate_dwell(int32_t milliseconds) {
+    eta_flush();
+    eta_minutes += milliseconds / 60000.0;
+}
+
+bool validate_eta_load(fs::FS& fs, const char* path) {
+    job_eta_total = -1;
+    validate_result_t result;
+    if (!validate_get(fs, path, &result) || result.eta_step == 0) {
+        return false;
+    }
+    if (!job_eta_table) {
+        job_eta_table = (float*)malloc(VALIDATE_ETA_POINTS * sizeof(float));
+        if (!job_eta_table) {
+            return false;
+        }
+    }
+    String chk_path = String(path) + ".chk";
+    File   chk      = fs.open(chk_path.c_str());
+    if (!chk) {
+        return false;
+    }
+    size_t table_size = VALIDATE_ETA_POINTS * sizeof(float);
+    bool   valid      = chk.seek(sizeof(result)) && chk.read((uint8_t*)job_eta_table, table_size) == table_size;
+    chk.close();
+    if (valid) {
+        job_eta_step  = result.eta_step;
+        job_eta_size  = result.source_size;
+        job_eta_total = result.seconds;
+    }
+    return valid;
+}
+
+// From an ISR too, by closeFile(), so the table is kept for the next job
+void validate_eta_unload() {
+    job_eta_total = -1;
+}
+
+float validate_eta_elapsed(uint32_t pos) {
+    if (job_eta_total < 0) {
+        return -1;
+    }
+    uint32_t point = pos / job_eta_step;
+    if (pos >= job_eta_size) {
+        return job_eta_total;
+    }
+    // The last point is followed by the end of the file, which may be less than a step away
+    float    before = job_eta_table[point];
+    float    after  = point + 1 < VALIDATE_ETA_POINTS ? job_eta_table[point + 1] : job_eta_total;
+    uint32_t from   = point * job_eta_step;
+    uint32_t span   = MIN(job_eta_step, job_eta_size - from);
+    return before + (after - before) * (pos - from) / span;
+}
+
+float validate_eta_total() {
+    return job_eta_total;
+}
+
+static void validate_error(Error status) {
+    if (check.errors++ == 0) {
+        check.first_error_line = check.lines;
+        check.first_error      = static_cast<uint8_t>(status);
+    }
+}
+
+static void validate_line() {
+    check.lines++;
+    line[line_len] = '\0';
+    line_len       = 0;
+    collapseGCode(line);
+    if (line[0] == '\0' || line[0] == '$' || line[0] == '[') {
+        return;  // Only g-code is checked
+    }
+    Error status = gc_execute_line(line, CLIENT_SERIAL);
+    if (status != Error::Ok) {
+        validate_error(status);
+    }
+}
+
+// Takes the request, or reports the cached result for it
+static void validate_start() {
+    char path[VALIDATE_PATH_SIZE];
+    portENTER_CRITICAL(&request_mux);
+    memcpy(path, request_path, sizeof(path));
+    check_gen = request_gen;
+    portEXIT_CRITICAL(&request_mux);
+
+    if (source) {
+        source.close();
+        eta_drop();
+    }
+    validate_result_t cached;
+    if (validate_get(SD, path, &cached)) {
+        validate_report(CLIENT_ALL, path, &cached);
+        return;
+    }
+    source = SD.open(path);
+    if (!source) {
+        return;
+    }
+    if (sd_file_is_gz(source)) {
+        source.close();  // The check reads and times raw bytes; a gzip job runs without it
+        return;
+    }
+    strcpy(check_path, path);
+    check              = {};
+    check.source_size  = source.size();
+    check.source_mtime = source.getLastWrite();
+    check_pos          = 0;
+    chunk_len          = 0;
+    chunk_pos          = 0;
+    line_len           = 0;
+    sandbox            = gc_state;
+    for (int axis = 0; axis < 3; axis++) {
+        start_offset[axis] = gc_state.coord_system[axis] + gc_state.coord_offset[axis];
+    }
+    eta_start();
+}
+
+// Reads on from check_pos. A remount between slices closes the file under us, so a short read
+// reopens it once, as long as it is still the same version.
+static int validate_read() {
+    int n = source.read(chunk, sizeof(chunk));
+    if (n <= 0 && check_pos < check.source_size) {
+        source.close();
+        source = SD.open(check_path);
+        if (source && source.size() == check.source_size && (uint32_t)source.getLastWrite() == check.source_mtime &&
+            source.seek(check_pos)) {
+            n = source.read(chunk, sizeof(chunk));
+        }
+    }
+    return n > 0 ? n : 0;
+}
+
+static void validate_finish() {
+    source.close();
+    eta_flush();
+    eta_sample(UINT32_MAX);
+    check.seconds   = eta_minutes * 60.0;
+    check.magic     = VALIDATE_MAGIC;
+    String chk_path = String(check_path) + ".chk";
+    File   chk      = SD.open(chk_path.c_str(), FILE_WRITE);
+    if (chk) {
+        size_t table_size = eta_table ? VALIDATE_ETA_POINTS * sizeof(float) : 0;
+        if (chk.write((uint8_t*)&check, sizeof(check)) != sizeof(check) ||
+            (table_size && chk.write((uint8_t*)eta_table, table_size) != table_size)) {
+            chk.close();
+            SD.remove(chk_path.c_str());
+        } else {
+            chk.close();
+        }
+    }
+    eta_drop();
+    validate_report(CLIENT_ALL, check_path, &check);
+}
+
+// Runs lines for up to VALIDATE_SLICE_US on the sandbox parser state
+static void validate_slice() {
+    parser_state_t save_gc_state = gc_state;
+    State          save_state    = sys.state;
+    gc_state                     = sandbox;
+    sys.state                    = State::CheckMode;
+    gc_sandbox                   = true;
+    running                      = true;
+
+    bool    done = false;
+    int64_t end  = esp_timer_get_time() + VALIDATE_SLICE_US;
+    while (!done && !sys.abort && esp_timer_get_time() < end) {
+        if (chunk_pos == chunk_len) {
+            chunk_pos = 0;
+            chunk_len = validate_read();
+            check_pos += chunk_len;
+            if (chunk_len == 0) {
+                if (line_len) {
+                    validate_line();
+                }
+                done = true;
+                break;
+            }
+        }
+        // Up to the end of the next line
+        while (chunk_pos < chunk_len) {
+            char c = chunk[chunk_pos++];
+            if (c == '\n') {
+                validate_line();
+                break;
+            } else if (line_len < SD_MAX_LINE_LENGTH - 1) {
+                line[line_len++] = c;
+            } else {
+                check.lines++;
+                validate_error(Error::Overflow);  // Ends the job there, so the check too
+                check_pos = check.source_size;
+                done      = true;
+                break;
+            }
+        }
+    }
+
+    running    = false;
+    gc_sandbox = false;
+    sandbox    = gc_state;
+    gc_state   = save_gc_state;
+    if (sys.abort) {
+        source.close();  // The reset puts sys.state right
+        eta_drop();
+        return;
+    }
+    sys.state = save_state;
+    if (done) {
+        if (check_pos == check.source_size) {
+            validate_finish();
+        } else {
+            source.close();  // The card went away; a part checked is not cached
+            eta_drop();
+        }
+    }
+}
+
+bool validate_poll() {
+    if (request_gen == check_gen && !source) {
+        return false;
+    }
+    if (sys.state != State::Idle || plan_get_current_block() != NULL || mc_line_pending() || get_sd_state(false) != SDState::Idle) {
+        return false;
+    }
+    if (request_gen != check_gen) {
+        validate_start();
+        if (!source) {
+            return false;
+        }
+    }
+    validate_slice();
+    return true;
+}
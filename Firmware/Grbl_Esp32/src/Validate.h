@@ -0,0 +1,89 @@
+#pragma once
+
+/*
+  Validate.h - Background check of job files before they are run
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <FS.h>
+
+// A requested file is run through gc_execute_line() as $C check mode would run it, but on a
+// copy of the parser state and in short slices from the main loop, only while the machine is
+// idle with nothing planned and the SD card is not in use. The parser state is global, so the
+// slices take turns with the other lines instead of running beside them. Nothing moves:
+// mc_line() hands the targets to validate_target() instead of checking soft limits, which
+// would reset the machine, and gc_sandbox keeps the parser from storing offsets.
+//
+// The result goes to path.chk next to path, keyed by the source size and modification time
+// like the job summary in path.idx, so each version of a file is checked once.
+//
+// The check also times the job. The moves go through a model of the planner, with its
+// junction speeds over a window of VALIDATE_ETA_WINDOW blocks and trapezoids at the axis
+// accelerations and rates of the settings, and the running total is sampled at
+// VALIDATE_ETA_POINTS evenly spaced byte offsets. That table follows the result in path.chk,
+// so while the job runs the time left is a lookup by file position. Overrides, spindle
+// spin-up and pauses are not counted.
+const int VALIDATE_ETA_POINTS = 256;
+const int VALIDATE_ETA_WINDOW = 16;
+
+
+typedef struct {
+    uint32_t magic;
+    uint32_t source_size;
+    uint32_t source_mtime;
+    uint32_t lines;
+    uint32_t errors;            // Lines the parser rejected
+    uint32_t first_error_line;  // 1-based, 0 without errors
+    uint8_t  first_error;       // Error of that line
+    uint8_t  has_box;           // The file has motion
+    uint16_t reserved;
+    float    box_min[3];  // XYZ extents of the motion targets, relative to the work offset of the check
+    float    box_max[3];
+    float    seconds;   // Estimated run time
+    uint32_t eta_step;  // Bytes between the points of the time table
+} validate_result_t;
+
+// From any task. Checks path in the background, or reports the result right away when
+// path.chk is up to date. A new request replaces the one in progress.
+void validate_request(const char* path);
+
+// The result in path.chk, false when the file was not checked since it last changed
+bool validate_get(fs::FS& fs, const char* path, validate_result_t* result);
+
+// True when the motion goes past the soft limits with the current work offset
+bool validate_outside_travel(const validate_result_t* result);
+
+// Sends the result as [MSG:] lines
+void validate_report(uint8_t client, const char* path, const validate_result_t* result);
+
+// Runs a slice of the check when the machine is idle. Called from the main loop. Returns true
+// if it ran one, so the loop comes back for the next without waiting.
+bool validate_poll();
+
+// True while a slice is in the parser; mc_line() then calls validate_target() and returns,
+// and mc_dwell() calls validate_dwell()
+bool validate_running();
+void validate_target(const float* target, const plan_line_data_t* pl_data);
+void validate_dwell(int32_t milliseconds);
+
+// The time table of the job being opened, false when path has no current check. The table
+// stays loaded until the next call.
+bool validate_eta_load(fs::FS& fs, const char* path);
+void validate_eta_unload();
+// Seconds of the loaded job before byte offset pos, and in all; -1 without a table
+float validate_eta_elapsed(uint32_t pos);
+float validate_eta_total();
@@ -74,6 +74,7 @@ namespace WebUI {
         COMMANDS::wait(0);
         //in case of restart requested
         if (restart_ESP_module) {
+            client_flush_output(1000 / portTICK_RATE_MS);
             ESP.restart();
             while (1) {}
         }
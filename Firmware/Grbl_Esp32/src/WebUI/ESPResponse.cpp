@@ -26,10 +26,13 @@
 
 namespace WebUI {
 #if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
-    ESPResponseStream::ESPResponseStream(WebServer* webserver) {
-        _header_sent = false;
-        _webserver   = webserver;
-        _client      = CLIENT_WEBUI;
+    ESPResponseStream::ESPResponseStream(WebServer* webserver, const char* contentType) {
+        _header_sent  = false;
+        _webserver    = webserver;
+        _content_type = contentType;
+        _client       = CLIENT_WEBUI;
+        _buffer       = NULL;
+        _buffered     = 0;
     }
 #endif
 
@@ -38,6 +41,8 @@ namespace WebUI {
 #if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
         _header_sent = false;
         _webserver   = NULL;
+        _buffer      = NULL;
+        _buffered    = 0;
 #endif
     }
 
@@ -47,6 +52,14 @@ namespace WebUI {
 #if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
         _header_sent = false;
         _webserver   = NULL;
+        _buffer      = NULL;
+        _buffered    = 0;
+#endif
+    }
+
+    ESPResponseStream::~ESPResponseStream() {
+#if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
+        free(_buffer);
 #endif
     }
 
@@ -61,15 +74,21 @@ namespace WebUI {
 
     //helper to format size to readable string
     String ESPResponseStream::formatBytes(uint64_t bytes) {
+        char buf[16];
+        return String(formatBytes(bytes, buf, sizeof(buf)));
+    }
+
+    const char* ESPResponseStream::formatBytes(uint64_t bytes, char* buf, size_t len) {
         if (bytes < 1024) {
-            return String((uint16_t)bytes) + " B";
+            snprintf(buf, len, "%u B", (uint16_t)bytes);
         } else if (bytes < (1024 * 1024)) {
-            return String((float)(bytes / 1024.0), 2) + " KB";
+            snprintf(buf, len, "%.2f KB", (float)(bytes / 1024.0));
         } else if (bytes < (1024 * 1024 * 1024)) {
-            return String((float)(bytes / 1024.0 / 1024.0), 2) + " MB";
+            snprintf(buf, len, "%.2f MB", (float)(bytes / 1024.0 / 1024.0));
         } else {
-            return String((float)(bytes / 1024.0 / 1024.0 / 1024.0), 2) + " GB";
+            snprintf(buf, len, "%.2f GB", (float)(bytes / 1024.0 / 1024.0 / 1024.0));
         }
+        return buf;
     }
 
     void ESPResponseStream::print(const char* data) {
@@ -80,18 +99,28 @@ namespace WebUI {
         if (_webserver) {
             if (!_header_sent) {
                 _webserver->setContentLength(CONTENT_LENGTH_UNKNOWN);
-                _webserver->sendHeader("Content-Type", "text/html");
+                _webserver->sendHeader("Content-Type", _content_type);
                 _webserver->sendHeader("Cache-Control", "no-cache");
                 _webserver->send(200);
                 _header_sent = true;
             }
 
-            _buffer += data;
-            if (_buffer.length() > 1200) {
-                //send data
-                _webserver->sendContent(_buffer);
-                //reset buffer
-                _buffer = "";
+            if (!_buffer) {
+                _buffer = (char*)malloc(BUFFER_SIZE);
+            }
+            if (!_buffer) {
+                _webserver->sendContent(data);  // Unbuffered, when the heap cannot spare it
+                return;
+            }
+            for (size_t len = strlen(data); len;) {
+                size_t n = MIN(len, BUFFER_SIZE - _buffered);
+                memcpy(_buffer + _buffered, data, n);
+                _buffered += n;
+                data += n;
+                len -= n;
+                if (_buffered == BUFFER_SIZE) {
+                    send_buffer();
+                }
             }
             return;
         }
@@ -104,16 +133,25 @@ namespace WebUI {
         if (_webserver) {
             if (_header_sent) {
                 //send data
-                if (_buffer.length() > 0) {
-                    _webserver->sendContent(_buffer);
-                }
+                send_buffer();
 
                 //close connection
                 _webserver->sendContent("");
             }
             _header_sent = false;
-            _buffer      = "";
+            free(_buffer);
+            _buffer   = NULL;
+            _buffered = 0;
         }
 #endif
     }
+
+#if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
+    void ESPResponseStream::send_buffer() {
+        if (_buffered) {
+            _webserver->sendContent_P(_buffer, _buffered);
+            _buffered = 0;
+        }
+    }
+#endif
 }
@@ -28,25 +28,38 @@ namespace WebUI {
     class ESPResponseStream {
     public:
 #if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
-        ESPResponseStream(WebServer* webserver);
+        ESPResponseStream(WebServer* webserver, const char* contentType = "text/html");
 #endif
         ESPResponseStream(uint8_t client, bool byid = true);
         ESPResponseStream();
+        ~ESPResponseStream();
+        ESPResponseStream(const ESPResponseStream&) = delete;
+        ESPResponseStream& operator=(const ESPResponseStream&) = delete;
 
         void          print(const char* data);
         void          println(const char* data);
         void          flush();
         bool          anyOutput() { return _header_sent; }
         static String formatBytes(uint64_t bytes);
-        uint8_t       client() { return _client; }
+        // Into buf, which is returned, for paths that run while a job does
+        static const char* formatBytes(uint64_t bytes, char* buf, size_t len);
+        uint8_t            client() { return _client; }
 
     private:
         uint8_t _client;
         bool    _header_sent;
 
 #if defined(ENABLE_HTTP) && defined(ENABLE_WIFI)
-        WebServer* _webserver;
-        String     _buffer;
+        // Web output is gathered into chunks of up to this size. The buffer is taken once, when
+        // the headers go out, so a response no longer reallocates a String as it grows.
+        static const size_t BUFFER_SIZE = 1200;
+
+        void send_buffer();
+
+        WebServer*  _webserver;
+        const char* _content_type;
+        char*       _buffer;
+        size_t      _buffered;
 #endif
     };
 }
@@ -0,0 +1,276 @@
+/*
+  FirmwareWriter.cpp - streams a firmware image into the OTA partition
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "../Grbl.h"
+
+#ifdef ENABLE_WIFI
+
+#    include "FirmwareWriter.h"
+#    include <Update.h>
+#    include <rom/crc.h>
+#    include <rom/miniz.h>
+
+namespace WebUI {
+    // The gzip header, RFC 1952: 10 fixed bytes, then the parts the flags ask for
+    static const uint16_t GZ_FIXED    = 10;
+    static const uint8_t  GZ_FHCRC    = 0x02;
+    static const uint8_t  GZ_FEXTRA   = 0x04;
+    static const uint8_t  GZ_FNAME    = 0x08;
+    static const uint8_t  GZ_FCOMMENT = 0x10;
+    static const uint8_t  GZ_PARTS    = GZ_FHCRC | GZ_FEXTRA | GZ_FNAME | GZ_FCOMMENT;
+    static const uint8_t  GZ_RESERVED = 0xE0;
+
+    FirmwareWriter::FirmwareWriter() : _block(NULL), _inflator(NULL), _compressed(false), _received(0), _written(0), _start_ms(0), _error(NULL) {
+        release();
+    }
+
+    FirmwareWriter::~FirmwareWriter() { release(); }
+
+    void FirmwareWriter::release() {
+        free(_block);
+        free(_inflator);
+        _block      = NULL;
+        _inflator   = NULL;
+        _block_len  = 0;
+        _state      = State::Start;
+        _header_pos = 0;
+        _extra_len  = 0;
+        _gz_flags   = 0;
+        _crc        = 0;
+    }
+
+    bool FirmwareWriter::begin() {
+        release();
+        _compressed = false;
+        _received   = 0;
+        _written    = 0;
+        _error      = NULL;
+        _start_ms   = millis();
+        if (!Update.begin()) {  //start with max available size
+            return fail("Not enough space");
+        }
+        return true;
+    }
+
+    uint32_t FirmwareWriter::elapsed_ms() const { return millis() - _start_ms; }
+
+    bool FirmwareWriter::fail(const char* error) {
+        if (!_error) {
+            _error = error;
+        }
+        Update.abort();
+        release();
+        return false;
+    }
+
+    void FirmwareWriter::abort() {
+        if (!_error) {
+            fail("Aborted");
+        }
+    }
+
+    bool FirmwareWriter::write(const uint8_t* data, size_t len) {
+        if (_error) {
+            return false;
+        }
+        _received += len;
+        while (len) {
+            switch (_state) {
+                case State::Start:
+                    if (!start(data, len)) {
+                        return false;
+                    }
+                    break;
+                case State::Plain:
+                    return plain(data, len);
+                case State::Header:
+                    if (!header(data, len)) {
+                        return false;
+                    }
+                    break;
+                case State::Inflate:
+                    if (!inflate(data, len)) {
+                        return false;
+                    }
+                    break;
+                case State::Trailer:
+                    while (len && _header_pos < sizeof(_trailer)) {
+                        _trailer[_header_pos++] = *data++;
+                        len--;
+                    }
+                    if (_header_pos == sizeof(_trailer)) {
+                        _state = State::Done;
+                    }
+                    break;
+                case State::Done:
+                    return true;  // Padding after the gzip member
+            }
+        }
+        return true;
+    }
+
+    // The first byte tells a gzip file (0x1f 0x8b) from an image (0xe9). A plain image goes
+    // through the block too if there is memory for it, and straight to Update if not.
+    bool FirmwareWriter::start(const uint8_t* data, size_t len) {
+        _block = (uint8_t*)malloc(BLOCK_SIZE);
+        if (data[0] != 0x1f) {
+            _state = State::Plain;
+            return true;
+        }
+        _inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        if (!_block || !_inflator) {
+            return fail("Not enough memory to inflate");
+        }
+        tinfl_init(_inflator);
+        _compressed = true;
+        _state      = State::Header;
+        return true;
+    }
+
+    bool FirmwareWriter::plain(const uint8_t* data, size_t len) {
+        if (!_block) {
+            if (Update.write((uint8_t*)data, len) != len) {
+                return fail("Write failed");
+            }
+            _written += len;
+            return true;
+        }
+        while (len) {
+            size_t n = MIN(len, BLOCK_SIZE - _block_len);
+            memcpy(_block + _block_len, data, n);
+            _block_len += n;
+            data += n;
+            len -= n;
+            if (_block_len == BLOCK_SIZE && !flush_block()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FirmwareWriter::header(const uint8_t*& data, size_t& len) {
+        while (len) {
+            if (_header_pos == GZ_FIXED && !(_gz_flags & GZ_PARTS)) {
+                _state = State::Inflate;
+                return true;
+            }
+            uint8_t c = *data++;
+            len--;
+            if (_header_pos < GZ_FIXED) {
+                if ((_header_pos == 1 && c != 0x8b) || (_header_pos == 2 && c != 8) || (_header_pos == 3 && (c & GZ_RESERVED))) {
+                    return fail("Not a firmware image");
+                }
+                if (_header_pos == 3) {
+                    _gz_flags = c;
+                }
+                _header_pos++;
+            } else if (_gz_flags & GZ_FEXTRA) {
+                // Two length bytes, then that many bytes to skip
+                if (_header_pos < GZ_FIXED + 2) {
+                    _extra_len |= c << (8 * (_header_pos - GZ_FIXED));
+                    _header_pos++;
+                } else {
+                    _extra_len--;
+                }
+                if (_header_pos == GZ_FIXED + 2 && _extra_len == 0) {
+                    _gz_flags &= ~GZ_FEXTRA;
+                    _header_pos = GZ_FIXED;
+                }
+            } else if (_gz_flags & GZ_FNAME) {
+                if (!c) {
+                    _gz_flags &= ~GZ_FNAME;
+                }
+            } else if (_gz_flags & GZ_FCOMMENT) {
+                if (!c) {
+                    _gz_flags &= ~GZ_FCOMMENT;
+                }
+            } else if (++_extra_len == 2) {  // The header CRC
+                _gz_flags &= ~GZ_FHCRC;
+                _extra_len = 0;
+            }
+        }
+        return true;
+    }
+
+    // The output goes into the block, which is the inflate window too, and the block is
+    // written out each time it fills, so every write but the last is a whole 32 KB.
+    bool FirmwareWriter::inflate(const uint8_t*& data, size_t& len) {
+        while (true) {
+            size_t       in     = len;
+            size_t       out    = BLOCK_SIZE - _block_len;
+            tinfl_status status = tinfl_decompress(_inflator, data, &in, _block, _block + _block_len, &out, TINFL_FLAG_HAS_MORE_INPUT);
+            data += in;
+            len -= in;
+            _crc = crc32_le(_crc, _block + _block_len, out);
+            _block_len += out;
+            if (status < TINFL_STATUS_DONE) {
+                return fail("Bad compressed image");
+            }
+            if (status == TINFL_STATUS_DONE) {
+                _state      = State::Trailer;
+                _header_pos = 0;
+                return true;
+            }
+            if (_block_len == BLOCK_SIZE) {
+                if (!flush_block()) {
+                    return false;
+                }
+            } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+                return true;
+            }
+        }
+    }
+
+    bool FirmwareWriter::flush_block() {
+        if (_block_len && Update.write(_block, _block_len) != _block_len) {
+            return fail("Write failed");
+        }
+        _written += _block_len;
+        _block_len = 0;
+        return true;
+    }
+
+    bool FirmwareWriter::end() {
+        if (_error) {
+            return false;
+        }
+        if (_state == State::Start) {
+            return fail("Empty image");
+        }
+        if (_compressed) {
+            if (_state != State::Done) {
+                return fail("Compressed image cut short");
+            }
+            uint32_t crc  = _trailer[0] | _trailer[1] << 8 | _trailer[2] << 16 | uint32_t(_trailer[3]) << 24;
+            uint32_t size = _trailer[4] | _trailer[5] << 8 | _trailer[6] << 16 | uint32_t(_trailer[7]) << 24;
+            if (crc != _crc || size != _written + _block_len) {
+                return fail("Compressed image CRC mismatch");
+            }
+        }
+        if (!flush_block()) {
+            return false;
+        }
+        if (!Update.end(true)) {  //true to set the size to the current progress
+            return fail("Image check failed");
+        }
+        release();
+        return true;
+    }
+}
+
+#endif
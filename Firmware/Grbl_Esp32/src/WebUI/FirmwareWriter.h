@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+  FirmwareWriter.h - streams a firmware image into the OTA partition
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+struct tinfl_decompressor_tag;
+
+namespace WebUI {
+    // Takes a firmware image in whatever pieces it arrives in and writes it through Update
+    // in 32 KB blocks. An image starting with the gzip magic (firmware.bin.gz, as made by
+    // gzip -9) is inflated on the fly with the inflater in ROM and checked against the gzip
+    // CRC and length before the update is accepted.
+    class FirmwareWriter {
+    public:
+        static const size_t BLOCK_SIZE = 32768;  // The inflate window, a multiple of the flash sector
+
+        FirmwareWriter();
+        ~FirmwareWriter();
+
+        bool begin();  // False if Update can not start
+        bool write(const uint8_t* data, size_t len);
+        bool end();  // Flushes and checks the image, false if it is not good
+        void abort();
+
+        const char* error() const { return _error; }
+        bool        compressed() const { return _compressed; }
+        uint32_t    received() const { return _received; }
+        uint32_t    written() const { return _written; }
+        uint32_t    elapsed_ms() const;
+
+    private:
+        enum class State : uint8_t {
+            Start,    // Nothing seen yet
+            Plain,    // Copied as it comes
+            Header,   // In the gzip header
+            Inflate,  // In the deflate data
+            Trailer,  // In the CRC and length after it
+            Done,
+        };
+
+        bool fail(const char* error);
+        bool start(const uint8_t* data, size_t len);
+        bool plain(const uint8_t* data, size_t len);
+        bool header(const uint8_t*& data, size_t& len);
+        bool inflate(const uint8_t*& data, size_t& len);
+        bool flush_block();
+        void release();
+
+        State    _state;
+        uint8_t* _block;  // The output block, also the inflate window
+        size_t   _block_len;
+
+        tinfl_decompressor_tag* _inflator;
+        uint8_t                 _gz_flags;
+        uint16_t                _header_pos;  // Bytes of the current header part seen
+        uint16_t                _extra_len;
+        uint8_t                 _trailer[8];
+        uint32_t                _crc;
+
+        bool        _compressed;
+        uint32_t    _received;
+        uint32_t    _written;
+        uint32_t    _start_ms;
+        const char* _error;
+    };
+}
@@ -63,9 +63,11 @@ namespace WebUI {
     }
 
     size_t InputBuffer::write(const uint8_t* buffer, size_t size) {
-        //No need currently
-        //keep for compatibility
-        return size;
+        size_t n = 0;
+        while (n < size && write(buffer[n])) {
+            n++;
+        }
+        return n;
     }
 
     int InputBuffer::peek(void) {
@@ -10,7 +10,45 @@ namespace WebUI {
 
     // Constructor.  If _pretty is true, newlines are
     // inserted into the JSON string for easy reading.
-    JSONencoder::JSONencoder(bool pretty) : pretty(pretty), level(0), str("") { count[level] = 0; }
+    JSONencoder::JSONencoder(bool pretty) : JSONencoder(pretty, NULL) {}
+
+    // Constructor for streaming to out.  With out NULL
+    // the string is collected and returned by end().
+    JSONencoder::JSONencoder(bool pretty, ESPResponseStream* out) : pretty(pretty), level(0), str(""), stream(out), buffered(0) {
+        count[level] = 0;
+    }
+
+    // Private function to append a character, either to
+    // the string or to the buffer in front of the stream.
+    void JSONencoder::add(char c) {
+        if (!stream) {
+            str += c;
+            return;
+        }
+        buffer[buffered++] = c;
+        if (buffered == STREAM_BUFFER_SIZE - 1) {
+            flush_buffer();
+        }
+    }
+
+    void JSONencoder::add(const char* s) {
+        if (!stream) {
+            str.concat(s);
+            return;
+        }
+        while (*s) {
+            add(*s++);
+        }
+    }
+
+    // Private function to pass the buffered text to the stream
+    void JSONencoder::flush_buffer() {
+        if (buffered) {
+            buffer[buffered] = '\0';
+            stream->print(buffer);
+            buffered = 0;
+        }
+    }
 
     // Private function to add commas between
     // elements as needed, omitting the comma
@@ -38,7 +76,7 @@ namespace WebUI {
     // Private function to add a name enclosed with quotes.
     void JSONencoder::quoted(const char* s) {
         add('"');
-        str.concat(s);
+        add(s);
         add('"');
     }
 
@@ -73,6 +111,9 @@ namespace WebUI {
     // and returning the encoded string
     String JSONencoder::end() {
         end_object();
+        if (stream) {
+            flush_buffer();
+        }
         return str;
     }
 
@@ -122,13 +163,17 @@ namespace WebUI {
     }
 
     // Creates a "tag":"value" member from an Arduino string
-    void JSONencoder::member(const char* tag, String value) {
+    void JSONencoder::member(const char* tag, const String& value) {
         begin_member(tag);
         quoted(value.c_str());
     }
 
     // Creates a "tag":"value" member from an integer
-    void JSONencoder::member(const char* tag, int value) { member(tag, String(value)); }
+    void JSONencoder::member(const char* tag, int value) {
+        char strval[12];
+        snprintf(strval, sizeof(strval), "%d", value);
+        member(tag, strval);
+    }
 
     // Creates an Esp32_WebUI configuration item specification from
     // a value passed in as a C-style string.
@@ -144,7 +189,9 @@ namespace WebUI {
     // Creates an Esp32_WebUI configuration item specification from
     // an integer value.
     void JSONencoder::begin_webui(const char* p, const char* help, const char* type, int val) {
-        begin_webui(p, help, type, String(val).c_str());
+        char strval[12];
+        snprintf(strval, sizeof(strval), "%d", val);
+        begin_webui(p, help, type, strval);
     }
 
     // Creates an Esp32_WebUI configuration item specification from
@@ -3,21 +3,29 @@
 // Class for creating JSON-encoded strings.
 
 namespace WebUI {
+    class ESPResponseStream;
+
     class JSONencoder {
     private:
-        static const int MAX_JSON_LEVEL = 16;
-
-        bool   pretty;
-        int    level;
-        String str;
-        int    count[MAX_JSON_LEVEL];
-        void   add(char c) { str += c; }
-        void   comma_line();
-        void   comma();
-        void   quoted(const char* s);
-        void   inc_level();
-        void   dec_level();
-        void   line();
+        static const int MAX_JSON_LEVEL     = 16;
+        static const int STREAM_BUFFER_SIZE = 64;
+
+        bool               pretty;
+        int                level;
+        String             str;
+        int                count[MAX_JSON_LEVEL];
+        ESPResponseStream* stream;
+        char               buffer[STREAM_BUFFER_SIZE];
+        int                buffered;
+        void               add(char c);
+        void               add(const char* s);
+        void               flush_buffer();
+        void               comma_line();
+        void               comma();
+        void               quoted(const char* s);
+        void               inc_level();
+        void               dec_level();
+        void               line();
 
     public:
         // If you don't set _pretty it defaults to false
@@ -26,15 +34,21 @@ namespace WebUI {
         // Constructor; set _pretty true for pretty printing
         JSONencoder(bool pretty);
 
+        // Streaming constructor. The JSON is written to out as it is
+        // built, through a small buffer, instead of being collected in
+        // a String, so a long listing needs no large allocation.
+        JSONencoder(bool pretty, ESPResponseStream* out);
+
         // begin() starts the encoding process.
         void begin();
 
-        // end() returns the encoded string
+        // end() returns the encoded string, or writes out the rest
+        // of it and returns an empty string when streaming
         String end();
 
         // member() creates a "tag":"value" element
         void member(const char* tag, const char* value);
-        void member(const char* tag, String value);
+        void member(const char* tag, const String& value);
         void member(const char* tag, int value);
 
         // begin_array() starts a "tag":[  array element
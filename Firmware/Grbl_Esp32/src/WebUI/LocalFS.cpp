@@ -0,0 +1,247 @@
+#include "../Grbl.h"
+
+#include "LocalFS.h"
+
+#include <SPIFFS.h>
+#ifdef USE_LITTLEFS
+#    include <LITTLEFS.h>
+#endif
+
+namespace WebUI {
+    static bool local_fs_little = false;
+
+    fs::FS& localfs() {
+#ifdef USE_LITTLEFS
+        if (local_fs_little) {
+            return LITTLEFS;
+        }
+#endif
+        return SPIFFS;
+    }
+
+    const char* localfs_name() { return local_fs_little ? "LittleFS" : "SPIFFS"; }
+
+    bool localfs_flat() { return !local_fs_little; }
+
+    size_t localfs_total_bytes() {
+#ifdef USE_LITTLEFS
+        if (local_fs_little) {
+            return LITTLEFS.totalBytes();
+        }
+#endif
+        return SPIFFS.totalBytes();
+    }
+
+    size_t localfs_used_bytes() {
+#ifdef USE_LITTLEFS
+        if (local_fs_little) {
+            return LITTLEFS.usedBytes();
+        }
+#endif
+        return SPIFFS.usedBytes();
+    }
+
+    bool localfs_format() {
+#ifdef USE_LITTLEFS
+        if (local_fs_little) {
+            return LITTLEFS.format();
+        }
+#endif
+        return SPIFFS.format();
+    }
+
+    bool localfs_mkdir(const String& path) {
+        if (!localfs_flat()) {
+            return localfs().mkdir(path);
+        }
+        File r = SPIFFS.open(path + "/.", FILE_WRITE);
+        if (!r) {
+            return false;
+        }
+        r.close();
+        return true;
+    }
+
+    // Creates the directories of path on fs, as FAT and LittleFS need them before the file
+    static void make_parents(fs::FS& fs, const char* path) {
+        char dir[128];
+        for (const char* slash = strchr(path + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+            size_t len = MIN(size_t(slash - path), sizeof(dir) - 1);
+            memcpy(dir, path, len);
+            dir[len] = '\0';
+            fs.mkdir(dir);  // Fails for one that exists, which is fine
+        }
+    }
+
+    File localfs_create(const String& path) {
+        if (!localfs_flat()) {
+            make_parents(localfs(), path.c_str());
+        }
+        return localfs().open(path, FILE_WRITE);
+    }
+
+    bool localfs_rmdir(const String& path) {
+        bool   ok  = true;
+        File   dir = localfs().open(path);
+        String name;
+        if (!dir) {
+            return false;
+        }
+        // Names are taken before each removal, as that can disturb the listing
+        for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+            name         = file.name();
+            bool sub_dir = file.isDirectory();
+            file.close();
+            ok = (sub_dir ? localfs_rmdir(name) : localfs().remove(name)) && ok;
+        }
+        dir.close();
+        return (localfs_flat() || localfs().rmdir(path)) && ok;
+    }
+
+#ifdef USE_LITTLEFS
+    // Where the SPIFFS files wait on the SD card while the partition is formatted
+    static const char* const MIGRATE_DIR = "/localfs.mig";
+
+    static bool copy_file(fs::FS& from_fs, const char* from, fs::FS& to_fs, const char* to) {
+        static uint8_t buf[512];
+        File           src = from_fs.open(from, FILE_READ);
+        if (!src) {
+            return false;
+        }
+        make_parents(to_fs, to);
+        File dst = to_fs.open(to, FILE_WRITE);
+        bool ok  = bool(dst);
+        while (ok && src.available()) {
+            size_t n = src.read(buf, sizeof(buf));
+            ok       = n > 0 && dst.write(buf, n) == n;
+        }
+        src.close();
+        if (dst) {
+            dst.close();
+        }
+        return ok;
+    }
+
+    // Copies the files under dir of from_fs to to_fs, each name prefixed by to_prefix and less
+    // from_prefix. SPIFFS lists every file under the root, LittleFS and FAT by directory. Returns
+    // the count copied, or -1 when one could not be.
+    static int copy_tree(fs::FS& from_fs, const char* dir, const char* from_prefix, fs::FS& to_fs, const char* to_prefix) {
+        int  count = 0;
+        File root  = from_fs.open(dir);
+        if (!root) {
+            return 0;
+        }
+        for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+            String name   = file.name();
+            bool   is_dir = file.isDirectory();
+            file.close();
+            if (is_dir) {
+                int n = copy_tree(from_fs, name.c_str(), from_prefix, to_fs, to_prefix);
+                if (n < 0) {
+                    return -1;
+                }
+                count += n;
+                continue;
+            }
+            String to = String(to_prefix) + name.substring(strlen(from_prefix));
+            if (name.endsWith("/.")) {  // An empty SPIFFS directory
+                to.remove(to.length() - 2);
+                to_fs.mkdir(to);
+                continue;
+            }
+            if (!copy_file(from_fs, name.c_str(), to_fs, to.c_str())) {
+                grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Local FS: cannot copy %s", name.c_str());
+                return -1;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    static void remove_tree(fs::FS& fs, const char* dir) {
+        File root = fs.open(dir);
+        if (!root) {
+            return;
+        }
+        for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+            String name   = file.name();
+            bool   is_dir = file.isDirectory();
+            file.close();
+            if (is_dir) {
+                remove_tree(fs, name.c_str());
+            } else {
+                fs.remove(name);
+            }
+        }
+        root.close();
+        fs.rmdir(dir);
+    }
+
+    // With SPIFFS mounted, moves its files to LittleFS. False if they could not be put aside,
+    // with SPIFFS still mounted.
+    static bool migrate_from_spiffs() {
+#    ifndef ENABLE_SD_CARD
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Local FS: SPIFFS kept, moving its files to LittleFS needs the SD card");
+        return false;
+#    else
+        if (get_sd_state(true) != SDState::Idle) {
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Local FS: SPIFFS kept, an SD card is needed to move its files to LittleFS");
+            return false;
+        }
+        set_sd_state(SDState::BusyUploading);
+        remove_tree(SD, MIGRATE_DIR);
+        SD.mkdir(MIGRATE_DIR);
+        int count = copy_tree(SPIFFS, "/", "", SD, MIGRATE_DIR);
+        if (count < 0) {
+            remove_tree(SD, MIGRATE_DIR);
+            set_sd_state(SDState::Idle);
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Local FS: SPIFFS kept");
+            return false;
+        }
+        SPIFFS.end();
+        if (!LITTLEFS.begin(true)) {
+            set_sd_state(SDState::Idle);
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Local FS: LittleFS format failed, files left in %s on the SD card", MIGRATE_DIR);
+            return false;
+        }
+        local_fs_little = true;
+        if (copy_tree(SD, MIGRATE_DIR, MIGRATE_DIR, LITTLEFS, "") < 0) {
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Local FS: files left in %s on the SD card", MIGRATE_DIR);
+        } else {
+            remove_tree(SD, MIGRATE_DIR);
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Local FS: %d files moved from SPIFFS to LittleFS", count);
+        }
+        set_sd_state(SDState::Idle);
+        return true;
+#    endif
+    }
+#endif
+
+    bool localfs_begin() {
+#ifdef USE_LITTLEFS
+        if (LITTLEFS.begin(false)) {
+            local_fs_little = true;
+            return true;
+        }
+        if (SPIFFS.begin(false)) {
+            local_fs_little = false;
+            migrate_from_spiffs();  // SPIFFS stays mounted when it can not
+            return true;
+        }
+        local_fs_little = LITTLEFS.begin(true);  // Nothing to keep
+        return local_fs_little;
+#else
+        return SPIFFS.begin(true);
+#endif
+    }
+
+    void localfs_end() {
+#ifdef USE_LITTLEFS
+        if (local_fs_little) {
+            LITTLEFS.end();
+            return;
+        }
+#endif
+        SPIFFS.end();
+    }
+}
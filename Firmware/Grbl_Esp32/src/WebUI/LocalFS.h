@@ -0,0 +1,23 @@
+#pragma once
+
+// The internal filesystem, of the WebUI pages and the files uploaded to it. With USE_LITTLEFS it
+// is LittleFS, on the partition SPIFFS used. At the first boot after the change the SPIFFS files
+// are moved over, through the SD card, and until that can be done SPIFFS is kept.
+
+#include <FS.h>
+
+namespace WebUI {
+    bool        localfs_begin();
+    void        localfs_end();
+    fs::FS&     localfs();
+    const char* localfs_name();  // "LittleFS" or "SPIFFS", whichever is mounted
+    size_t      localfs_total_bytes();
+    size_t      localfs_used_bytes();
+    bool        localfs_format();
+
+    // SPIFFS has no directories, only names with slashes, so an empty one is kept as a file "."
+    bool localfs_flat();
+    bool localfs_mkdir(const String& path);
+    bool localfs_rmdir(const String& path);   // With the files in it
+    File localfs_create(const String& path);  // Opened for writing, in new directories as needed
+}
@@ -48,6 +48,14 @@ namespace WebUI {
 
     NotificationsService notificationsservice;
 
+    typedef struct {
+        char title[NOTIFICATION_TITLE_SIZE];
+        char message[NOTIFICATION_MSG_SIZE];
+    } notification_t;
+
+    static QueueHandle_t     notification_queue = NULL;
+    static SemaphoreHandle_t notification_lock  = NULL;  // Held by a send, and by begin() and end()
+
     NotificationsService::NotificationsService() {
         _started          = false;
         _notificationType = 0;
@@ -103,22 +111,63 @@ namespace WebUI {
         if (!_started) {
             return false;
         }
+        bool res = false;
         if (!((strlen(title) == 0) && (strlen(message) == 0))) {
-            switch (_notificationType) {
-                case ESP_PUSHOVER_NOTIFICATION:
-                    return sendPushoverMSG(title, message);
-                    break;
-                case ESP_EMAIL_NOTIFICATION:
-                    return sendEmailMSG(title, message);
-                    break;
-                case ESP_LINE_NOTIFICATION:
-                    return sendLineMSG(title, message);
+            xSemaphoreTake(notification_lock, portMAX_DELAY);
+            if (_started) {
+                switch (_notificationType) {
+                    case ESP_PUSHOVER_NOTIFICATION:
+                        res = sendPushoverMSG(title, message);
+                        break;
+                    case ESP_EMAIL_NOTIFICATION:
+                        res = sendEmailMSG(title, message);
+                        break;
+                    case ESP_LINE_NOTIFICATION:
+                        res = sendLineMSG(title, message);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            xSemaphoreGive(notification_lock);
+        }
+        return res;
+    }
+
+    bool NotificationsService::queueMSG(const char* title, const char* message) {
+        if (!_started || !notification_queue) {
+            return false;
+        }
+        notification_t n;
+        strncpy(n.title, title, sizeof(n.title) - 1);
+        n.title[sizeof(n.title) - 1] = '\0';
+        strncpy(n.message, message, sizeof(n.message) - 1);
+        n.message[sizeof(n.message) - 1] = '\0';
+        if (xQueueSend(notification_queue, &n, 0) != pdTRUE) {
+            log_d("Notification queue full");
+            return false;
+        }
+        return true;
+    }
+
+    void NotificationsService::notificationsTask(void* pvParameters) {
+        notification_t n;
+        heap_track_task();
+        while (true) {
+            xQueueReceive(notification_queue, &n, portMAX_DELAY);
+            uint32_t retry_ms = NOTIFICATION_RETRY_MS;
+            for (int attempt = 1; notificationsservice.started(); attempt++) {
+                if (notificationsservice.sendMSG(n.title, n.message)) {
                     break;
-                default:
+                }
+                if (attempt == NOTIFICATION_ATTEMPTS) {
+                    grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Notification failed: %s", n.title);
                     break;
+                }
+                vTaskDelay(pdMS_TO_TICKS(retry_ms));
+                retry_ms *= 2;
             }
         }
-        return false;
     }
 
     //Messages are currently limited to 1024 4-byte UTF-8 characters
@@ -312,6 +361,17 @@ namespace WebUI {
 
     bool NotificationsService::begin() {
         end();
+        if (!notification_queue) {
+            notification_lock  = xSemaphoreCreateMutex();
+            notification_queue = xQueueCreate(NOTIFICATION_QUEUE_SIZE, sizeof(notification_t));
+            xTaskCreatePinnedToCore(notificationsTask,        // task
+                                    "notificationsTask",      // name for task
+                                    NOTIFICATION_TASK_STACK,  // size of task stack
+                                    NULL,                     // parameters
+                                    1,                        // priority
+                                    NULL,
+                                    NOTIFICATION_TASK_CORE);
+        }
         _notificationType = notification_type->get();
         switch (_notificationType) {
             case 0:  //no notification = no error but no start
@@ -354,7 +414,9 @@ namespace WebUI {
             return;
         }
 
-        _started          = false;
+        _started = false;
+        xSemaphoreTake(notification_lock, portMAX_DELAY);  // Let a send in progress finish
+        xSemaphoreGive(notification_lock);
         _notificationType = 0;
         _token1           = "";
         _token1           = "";
@@ -21,6 +21,17 @@
 */
 
 namespace WebUI {
+    // Queued messages are sent by a task of their own, since a send is a TLS connection and a
+    // wait for the server's answer, seconds with a slow server. A failed send is tried again
+    // after NOTIFICATION_RETRY_MS, doubling each time, up to NOTIFICATION_ATTEMPTS in all.
+    static const int NOTIFICATION_QUEUE_SIZE  = 4;
+    static const int NOTIFICATION_TITLE_SIZE  = 48;
+    static const int NOTIFICATION_MSG_SIZE    = 160;
+    static const int NOTIFICATION_ATTEMPTS    = 4;
+    static const int NOTIFICATION_RETRY_MS    = 2000;
+    static const int NOTIFICATION_TASK_STACK  = 8192;  // TLS handshake
+    static const int NOTIFICATION_TASK_CORE   = 0;     // With the WiFi stack
+
     class NotificationsService {
     public:
         NotificationsService();
@@ -28,7 +39,8 @@ namespace WebUI {
         bool        begin();
         void        end();
         void        handle();
-        bool        sendMSG(const char* title, const char* message);
+        bool        sendMSG(const char* title, const char* message);  // Waits for the send
+        bool        queueMSG(const char* title, const char* message); // Returns at once
         const char* getTypeString();
         bool        started();
 
@@ -49,6 +61,8 @@ namespace WebUI {
         bool getPortFromSettings();
         bool getServerAddressFromSettings();
         bool getEmailFromSettings();
+
+        static void notificationsTask(void* pvParameters);
     };
 
     extern NotificationsService notificationsservice;
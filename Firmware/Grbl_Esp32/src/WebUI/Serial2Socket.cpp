@@ -30,11 +30,24 @@
 namespace WebUI {
     Serial_2_Socket Serial2Socket;
 
+    // What a sender waits for before it sends more
+    static bool is_reply(const uint8_t* line, size_t size) {
+        auto starts = [line, size](const char* s) {
+            size_t n = strlen(s);
+            return size >= n && memcmp(line, s, n) == 0;
+        };
+        return line[0] == '<' || starts("ok") || starts("error:") || starts("ALARM:");
+    }
+
     Serial_2_Socket::Serial_2_Socket() {
         _web_socket   = NULL;
+        _TXbuffer     = NULL;
         _TXbufferSize = 0;
+        _TXbufferMax  = 0;
+        _TXwindow     = 0;
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
+        memset(_rtt, 0, sizeof(_rtt));
     }
 
     void Serial_2_Socket::begin(long speed) {
@@ -53,8 +66,22 @@ namespace WebUI {
 
     bool Serial_2_Socket::attachWS(WebSocketsServer* web_socket) {
         if (web_socket) {
-            _web_socket   = web_socket;
+            if (_TXbuffer == NULL) {
+                _TXbufferMax = TXWINDOWMAX;
+                _TXbuffer    = (uint8_t*)malloc(_TXbufferMax);
+                if (_TXbuffer == NULL) {
+                    _TXbufferMax = TXBUFFERSIZE;
+                    _TXbuffer    = (uint8_t*)malloc(_TXbufferMax);
+                }
+                if (_TXbuffer == NULL) {
+                    _TXbufferMax = 0;
+                    return false;
+                }
+            }
+            _TXwindow     = TXBUFFERSIZE;
             _TXbufferSize = 0;
+            memset(_rtt, 0, sizeof(_rtt));
+            _web_socket = web_socket;
             return true;
         }
         return false;
@@ -65,10 +92,42 @@ namespace WebUI {
         return true;
     }
 
+    void Serial_2_Socket::set_rtt(uint8_t num, uint32_t ms) {
+        if (num >= MAX_CLIENTS) {
+            return;
+        }
+        ms = MAX(1, MIN(ms, 60000));
+        // 3/4 of the last value, so one late echo does not double the window
+        _rtt[num] = _rtt[num] ? (3 * _rtt[num] + ms) / 4 : ms;
+    }
+
+    void Serial_2_Socket::forget_rtt(uint8_t num) {
+        if (num < MAX_CLIENTS) {
+            _rtt[num] = 0;
+        }
+    }
+
+    // Output is broadcast, so the slowest client sizes the window. Only moved in steps and by
+    // more than a quarter, so the flushes keep their size while the round trip jitters.
+    void Serial_2_Socket::resize_window() {
+        uint32_t rtt = 0;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            rtt = MAX(rtt, _rtt[i]);
+        }
+        uint32_t window = MAX(TXBUFFERSIZE, rtt * TXWINDOWPERMS);
+        window          = MIN((window + TXWINDOWSTEP - 1) / TXWINDOWSTEP * TXWINDOWSTEP, _TXbufferMax);
+        if (window * 4 > _TXwindow * 5 || window * 4 < _TXwindow * 3) {
+            log_i("[SOCKET]window %d for rtt %d ms", window, rtt);
+            _TXwindow = window;
+        }
+    }
+
     Serial_2_Socket::operator bool() const { return true; }
 
     int Serial_2_Socket::available() { return _RXbufferSize; }
 
+    int Serial_2_Socket::availableforwrite() { return RXBUFFERSIZE - _RXbufferSize; }
+
     size_t Serial_2_Socket::write(uint8_t c) {
         if (!_web_socket) {
             return 0;
@@ -94,17 +153,32 @@ namespace WebUI {
         }
 
         //send full line
-        if (_TXbufferSize + size > TXBUFFERSIZE) {
+        if (_TXbufferSize + size > _TXwindow) {
             flush();
         }
 
-        //need periodic check to force to flush in case of no end
-        for (int i = 0; i < size; i++) {
-            _TXbuffer[_TXbufferSize] = buffer[i];
-            _TXbufferSize++;
+        // More than a window goes out in frames of one window each
+        const uint8_t* data = buffer;
+        size_t         left = size;
+        while (left) {
+            size_t n = MIN(left, size_t(_TXwindow - _TXbufferSize));
+            memcpy(_TXbuffer + _TXbufferSize, data, n);
+            _TXbufferSize += n;
+            data += n;
+            left -= n;
+            if (_TXbufferSize >= _TXwindow) {
+                flush();
+            }
         }
+        _lastwrite = millis();
         log_i("[SOCKET]buffer size %d", _TXbufferSize);
-        handle_flush();
+        int mode = http_output->get();
+        if (size > 0 && buffer[size - 1] == '\n' &&
+            (mode == OUTPUT_LOW_LATENCY || (mode == OUTPUT_ADAPTIVE && is_reply(buffer, size)))) {
+            flush();  // A finished line, like a status report or an ok, goes at once
+        } else {
+            handle_flush();
+        }
 #    endif
         return size;
     }
@@ -117,9 +191,12 @@ namespace WebUI {
         }
     }
 
-    bool Serial_2_Socket::push(const char* data) {
+    bool Serial_2_Socket::push(const char* data) { return push((const uint8_t*)data, strlen(data)); }
+
+    // Stores all of data or, if it does not fit, none of it
+    bool Serial_2_Socket::push(const uint8_t* data, size_t length) {
 #    if defined(ENABLE_SERIAL2SOCKET_IN)
-        int data_size = strlen(data);
+        int data_size = length;
         if ((data_size + _RXbufferSize) <= RXBUFFERSIZE) {
             int current = _RXbufferpos + _RXbufferSize;
             if (current > RXBUFFERSIZE) {
@@ -134,7 +211,7 @@ namespace WebUI {
                 current++;
             }
 
-            _RXbufferSize += strlen(data);
+            _RXbufferSize += data_size;
             return true;
         }
         return false;
@@ -159,7 +236,13 @@ namespace WebUI {
     }
 
     void Serial_2_Socket::handle_flush() {
-        if (_TXbufferSize > 0 && ((_TXbufferSize >= TXBUFFERSIZE) || ((millis() - _lastflush) > FLUSHTIMEOUT))) {
+        if (_TXbufferSize == 0) {
+            return;
+        }
+        int      mode    = http_output->get();
+        uint32_t timeout = mode == OUTPUT_BULK ? OUTPUT_BULK_MS : FLUSHTIMEOUT;
+        if (_TXbufferSize >= _TXwindow || (millis() - _lastflush) >= timeout ||
+            (mode == OUTPUT_ADAPTIVE && (millis() - _lastwrite) >= ADAPTIVE_IDLE_MS)) {
             log_i("[SOCKET]need flush, buffer size %d", _TXbufferSize);
             flush();
         }
@@ -175,12 +258,19 @@ namespace WebUI {
             //reset buffer
             _TXbufferSize = 0;
         }
+        if (http_output->get() == OUTPUT_ADAPTIVE) {
+            resize_window();
+        } else {
+            _TXwindow = MIN(TXBUFFERSIZE, _TXbufferMax);
+        }
     }
 
     Serial_2_Socket::~Serial_2_Socket() {
         if (_web_socket) {
             detachWS();
         }
+        free(_TXbuffer);
+        _TXbuffer     = NULL;
         _TXbufferSize = 0;
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
@@ -26,10 +26,27 @@
 class WebSocketsServer;
 
 namespace WebUI {
+    // Output is collected and broadcast to the websocket clients as binary frames. How long it
+    // is held depends on Http/Output:
+    //
+    //   LowLatency   every finished line goes at once
+    //   Bulk         held until TXBUFFERSIZE bytes or OUTPUT_BULK_MS passed
+    //   Adaptive     replies (ok, error:, ALARM: and status reports) go at once. Other output is
+    //                held until it pauses for ADAPTIVE_IDLE_MS or fills the window, which grows
+    //                from TXBUFFERSIZE with the round trip of the slowest client that answers
+    //                the RTT probes of the web server, up to TXWINDOWMAX.
+    //
+    // The buffer is allocated at TXWINDOWMAX when a websocket is attached, or at TXBUFFERSIZE
+    // if that fails, so the window never moves the data.
     class Serial_2_Socket : public Print {
-        static const int TXBUFFERSIZE = 1200;
-        static const int RXBUFFERSIZE = 256;
-        static const int FLUSHTIMEOUT = 500;
+        static const int TXBUFFERSIZE     = 1200;
+        static const int TXWINDOWMAX      = 8192;
+        static const int TXWINDOWSTEP     = 512;
+        static const int TXWINDOWPERMS    = 64;    // Bytes held per ms of round trip
+        static const int RXBUFFERSIZE     = 1024;  // Holds a few websocket stream batches
+        static const int FLUSHTIMEOUT     = 500;
+        static const int ADAPTIVE_IDLE_MS = 3;
+        static const int MAX_CLIENTS      = 5;  // WEBSOCKETS_SERVER_CLIENT_MAX
     public:
         Serial_2_Socket();
 
@@ -46,13 +63,17 @@ namespace WebUI {
         void begin(long speed);
         void end();
         int  available();
+        int  availableforwrite();
         int  peek(void);
         int  read(void);
         bool push(const char* data);
+        bool push(const uint8_t* data, size_t length);
         void flush(void);
         void handle_flush();
         bool attachWS(WebSocketsServer* web_socket);
         bool detachWS();
+        void set_rtt(uint8_t num, uint32_t ms);  // From an echoed RTT probe
+        void forget_rtt(uint8_t num);            // The client disconnected
 
         operator bool() const;
 
@@ -60,10 +81,16 @@ namespace WebUI {
 
     private:
         uint32_t          _lastflush;
+        uint32_t          _lastwrite;
         WebSocketsServer* _web_socket;
 
-        uint8_t  _TXbuffer[TXBUFFERSIZE];
+        uint8_t* _TXbuffer;
         uint16_t _TXbufferSize;
+        uint16_t _TXbufferMax;       // As allocated
+        uint16_t _TXwindow;          // Flushed when this full, at most _TXbufferMax
+        uint16_t _rtt[MAX_CLIENTS];  // Smoothed, 0 for clients that do not echo
+
+        void resize_window();
 
         uint8_t  _RXbuffer[RXBUFFERSIZE];
         uint16_t _RXbufferSize;
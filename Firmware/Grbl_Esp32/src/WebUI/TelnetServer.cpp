@@ -27,6 +27,7 @@
 #    include "TelnetServer.h"
 #    include "WifiConfig.h"
 #    include <WiFi.h>
+#    include <lwip/sockets.h>
 
 namespace WebUI {
     Telnet_Server telnet_server;
@@ -40,24 +41,28 @@ namespace WebUI {
 #    endif
 
     Telnet_Server::Telnet_Server() {
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
+        _tx_lock     = NULL;
+        _read_client = -1;
+        _next_client = 0;
+        for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
+            resetClient(i);
+        }
     }
 
     bool Telnet_Server::begin() {
         bool no_error = true;
         end();
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
 
         if (telnet_enable->get() == 0) {
             return false;
         }
         _port = telnet_port->get();
+        if (_tx_lock == NULL) {
+            _tx_lock = xSemaphoreCreateMutex();
+        }
 
         //create instance
         _telnetserver = new WiFiServer(_port, MAX_TLNT_CLIENTS);
-        _telnetserver->setNoDelay(true);
         String s = "[MSG:TELNET Started " + String(_port) + "]\r\n";
         grbl_send(CLIENT_ALL, (char*)s.c_str());
         //start telnet server
@@ -67,15 +72,30 @@ namespace WebUI {
     }
 
     void Telnet_Server::end() {
-        _setupdone    = false;
-        _RXbufferSize = 0;
-        _RXbufferpos  = 0;
+        _setupdone = false;
+        for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
+            if (_telnetClients[i]) {
+                _telnetClients[i].stop();
+            }
+            resetClient(i);
+        }
+        _read_client = -1;
         if (_telnetserver) {
             delete _telnetserver;
             _telnetserver = NULL;
         }
     }
 
+    void Telnet_Server::resetClient(uint8_t i) {
+        _clients[i].rx_size    = 0;
+        _clients[i].rx_pos     = 0;
+        _clients[i].tx_size    = 0;
+        _clients[i].tx_overrun = false;
+        if (_read_client == i) {
+            _read_client = -1;  // Drop the rest of its line
+        }
+    }
+
     void Telnet_Server::clearClients() {
         //check if there are any new clients
         if (_telnetserver->hasClient()) {
@@ -89,7 +109,10 @@ namespace WebUI {
                     if (_telnetClients[i]) {
                         _telnetClients[i].stop();
                     }
+                    resetClient(i);
                     _telnetClients[i] = _telnetserver->available();
+                    // Low latency sends each short line at once, bulk lets Nagle pack segments
+                    _telnetClients[i].setNoDelay(telnet_output->get() == OUTPUT_LOW_LATENCY);
                     break;
                 }
             }
@@ -100,25 +123,53 @@ namespace WebUI {
         }
     }
 
+    // Queues the output for every connected client and returns at once; handle() sends it.
+    // A client whose queue cannot take all of it misses the whole text, so lines stay intact.
     size_t Telnet_Server::write(const uint8_t* buffer, size_t size) {
-        size_t wsize = 0;
         if (!_setupdone || _telnetserver == NULL) {
             log_d("[TELNET out blocked]");
             return 0;
         }
-
-        clearClients();
-
-        //log_d("[TELNET out]");
-        //push UART data to all connected telnet clients
+        xSemaphoreTake(_tx_lock, portMAX_DELAY);
         for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
-            if (_telnetClients[i] && _telnetClients[i].connected()) {
-                //log_d("[TELNET out connected]");
-                wsize = _telnetClients[i].write(buffer, size);
-                COMMANDS::wait(0);
+            Client& client = _clients[i];
+            if (!_telnetClients[i] || !_telnetClients[i].connected()) {
+                continue;
+            }
+            if (client.tx_size + size > TELNETTXBUFFERSIZE) {
+                client.tx_overrun = true;
+                continue;
+            }
+            if (client.tx_size == 0) {
+                client.tx_since = millis();
+            }
+            memcpy(client.tx + client.tx_size, buffer, size);
+            client.tx_size += size;
+        }
+        xSemaphoreGive(_tx_lock);
+        return size;
+    }
+
+    // Sends as much of a client's queue as its socket takes without blocking. With bulk output,
+    // the queue is held until it is half full or OUTPUT_BULK_MS old, so it goes in large segments.
+    void Telnet_Server::drain(uint8_t i) {
+        Client& client = _clients[i];
+        xSemaphoreTake(_tx_lock, portMAX_DELAY);
+        bool due = telnet_output->get() != OUTPUT_BULK || client.tx_size >= TELNETTXBUFFERSIZE / 2 ||
+                   millis() - client.tx_since >= OUTPUT_BULK_MS;
+        if (client.tx_size > 0 && due) {
+            int sent = send(_telnetClients[i].fd(), client.tx, client.tx_size, MSG_DONTWAIT);
+            if (sent > 0) {
+                client.tx_size -= sent;
+                memmove(client.tx, client.tx + sent, client.tx_size);
             }
         }
-        return wsize;
+        bool overrun      = client.tx_overrun;
+        client.tx_overrun = false;
+        xSemaphoreGive(_tx_lock);
+        if (overrun) {
+            log_d("[TELNET]client %d dropped output", i);
+        }
     }
 
     void Telnet_Server::handle() {
@@ -129,7 +180,6 @@ namespace WebUI {
         }
         clearClients();
         //check clients for data
-        //uint8_t c;
         for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
             if (_telnetClients[i] && _telnetClients[i].connected()) {
 #    ifdef ENABLE_TELNET_WELCOME_MSG
@@ -138,22 +188,27 @@ namespace WebUI {
                     _telnetClientsIP[i] = _telnetClients[i].remoteIP();
                 }
 #    endif
+                drain(i);
                 if (_telnetClients[i].available()) {
-                    uint8_t buf[1024];
+                    uint8_t buf[256];
                     COMMANDS::wait(0);
                     int readlen  = _telnetClients[i].available();
-                    int writelen = TELNETRXBUFFERSIZE - available();
-                    if (readlen > 1024) {
-                        readlen = 1024;
+                    int writelen = TELNETRXBUFFERSIZE - _clients[i].rx_size;
+                    if (readlen > int(sizeof(buf))) {
+                        readlen = sizeof(buf);
                     }
                     if (readlen > writelen) {
                         readlen = writelen;
                     }
                     if (readlen > 0) {
-                        _telnetClients[i].read(buf, readlen);
-                        push(buf, readlen);
+                        readlen = _telnetClients[i].read(buf, readlen);
+                        if (readlen > 0) {
+                            readlen = client_realtime_filter(CLIENT_TELNET, buf, readlen);
+                        }
+                        if (readlen > 0) {
+                            push(i, buf, readlen);
+                        }
                     }
-                    return;
                 }
             } else {
                 if (_telnetClients[i]) {
@@ -161,80 +216,95 @@ namespace WebUI {
                     _telnetClientsIP[i] = IPAddress(0, 0, 0, 0);
 #    endif
                     _telnetClients[i].stop();
+                    resetClient(i);
                 }
             }
             COMMANDS::wait(0);
         }
     }
 
+    // Grbl assembles lines per client type, so the clients take turns a line at a time. While
+    // a line is unfinished, the other clients can still get realtime commands through.
+    int Telnet_Server::readable_client() {
+        if (_read_client >= 0 && _clients[_read_client].rx_size > 0) {
+            return _read_client;
+        }
+        for (uint8_t n = 0; n < MAX_TLNT_CLIENTS; n++) {
+            uint8_t i = (_next_client + n) % MAX_TLNT_CLIENTS;
+            if (i == _read_client || _clients[i].rx_size == 0) {
+                continue;
+            }
+            if (_read_client < 0 || is_realtime_command(_clients[i].rx[_clients[i].rx_pos])) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
     int Telnet_Server::peek(void) {
-        if (_RXbufferSize > 0) {
-            return _RXbuffer[_RXbufferpos];
-        } else {
+        int i = readable_client();
+        if (i < 0) {
             return -1;
         }
+        return _clients[i].rx[_clients[i].rx_pos];
     }
 
-    int Telnet_Server::available() { return _RXbufferSize; }
-
-    int Telnet_Server::get_rx_buffer_available() { return TELNETRXBUFFERSIZE - _RXbufferSize; }
+    int Telnet_Server::available() {
+        int i = readable_client();
+        return i < 0 ? 0 : _clients[i].rx_size;
+    }
 
-    bool Telnet_Server::push(uint8_t data) {
-        log_i("[TELNET]push %c", data);
-        if ((1 + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-            int current = _RXbufferpos + _RXbufferSize;
-            if (current > TELNETRXBUFFERSIZE) {
-                current = current - TELNETRXBUFFERSIZE;
-            }
-            if (current > (TELNETRXBUFFERSIZE - 1)) {
-                current = 0;
+    // The least room of any client, which is the streaming one when the others only monitor
+    int Telnet_Server::get_rx_buffer_available() {
+        int room = TELNETRXBUFFERSIZE;
+        for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
+            if (_clients[i].rx_size > 0 && TELNETRXBUFFERSIZE - _clients[i].rx_size < room) {
+                room = TELNETRXBUFFERSIZE - _clients[i].rx_size;
             }
-            _RXbuffer[current] = data;
-            _RXbufferSize++;
-            log_i("[TELNET]buffer size %d", _RXbufferSize);
-            return true;
         }
-        return false;
+        return room;
     }
 
-    bool Telnet_Server::push(const uint8_t* data, int data_size) {
-        if ((data_size + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-            int data_processed = 0;
-            int current        = _RXbufferpos + _RXbufferSize;
-            if (current > TELNETRXBUFFERSIZE) {
+    bool Telnet_Server::push(uint8_t i, const uint8_t* data, int data_size) {
+        Client& client = _clients[i];
+        if ((data_size + client.rx_size) <= TELNETRXBUFFERSIZE) {
+            int current = client.rx_pos + client.rx_size;
+            if (current > (TELNETRXBUFFERSIZE - 1)) {
                 current = current - TELNETRXBUFFERSIZE;
             }
-            for (int i = 0; i < data_size; i++) {
+            for (int n = 0; n < data_size; n++) {
+                client.rx[current] = data[n];
+                current++;
                 if (current > (TELNETRXBUFFERSIZE - 1)) {
                     current = 0;
                 }
-
-                _RXbuffer[current] = data[i];
-                current++;
-                data_processed++;
-
-                COMMANDS::wait(0);
-                //vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
             }
-            _RXbufferSize += data_processed;
+            client.rx_size += data_size;
             return true;
         }
         return false;
     }
 
     int Telnet_Server::read(void) {
-        if (_RXbufferSize > 0) {
-            int v = _RXbuffer[_RXbufferpos];
-            //log_d("[TELNET]read %c",char(v));
-            _RXbufferpos++;
-            if (_RXbufferpos > (TELNETRXBUFFERSIZE - 1)) {
-                _RXbufferpos = 0;
-            }
-            _RXbufferSize--;
-            return v;
-        } else {
+        int i = readable_client();
+        if (i < 0) {
             return -1;
         }
+        Client& client = _clients[i];
+        int     v      = client.rx[client.rx_pos];
+        //log_d("[TELNET]read %c",char(v));
+        client.rx_pos++;
+        if (client.rx_pos > (TELNETRXBUFFERSIZE - 1)) {
+            client.rx_pos = 0;
+        }
+        client.rx_size--;
+        if (v == '\n' || v == '\r') {
+            _read_client = -1;
+            _next_client = (i + 1) % MAX_TLNT_CLIENTS;
+        } else if (!is_realtime_command(v)) {
+            _read_client = i;
+        }
+        return v;
     }
 
     Telnet_Server::~Telnet_Server() { end(); }
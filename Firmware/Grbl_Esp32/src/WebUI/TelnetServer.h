@@ -21,6 +21,7 @@
 */
 
 #include "../Config.h"
+#include <freertos/semphr.h>
 
 class WiFiServer;
 class WiFiClient;
@@ -28,10 +29,10 @@ class WiFiClient;
 namespace WebUI {
     class Telnet_Server {
         //how many clients should be able to telnet to this ESP32
-        static const int MAX_TLNT_CLIENTS = 1;
+        static const int MAX_TLNT_CLIENTS = 3;
 
-        static const int TELNETRXBUFFERSIZE = 1200;
-        static const int FLUSHTIMEOUT       = 500;
+        static const int TELNETRXBUFFERSIZE = 1024;  // per client
+        static const int TELNETTXBUFFERSIZE = 1024;  // per client, drained by handle()
 
     public:
         Telnet_Server();
@@ -44,14 +45,25 @@ namespace WebUI {
         int    peek(void);
         int    available();
         int    get_rx_buffer_available();
-        bool   push(uint8_t data);
-        bool   push(const uint8_t* data, int datasize);
 
         static uint16_t port() { return _port; }
 
         ~Telnet_Server();
 
     private:
+        // Each client has its own input ring, and output is queued per client so a slow peer
+        // only ever delays itself. The rings are filled and read by the client check task; the
+        // output queues are filled from any task, under _tx_lock.
+        struct Client {
+            uint8_t  rx[TELNETRXBUFFERSIZE];
+            uint16_t rx_size;
+            uint16_t rx_pos;
+            uint8_t  tx[TELNETTXBUFFERSIZE];
+            uint16_t tx_size;
+            uint32_t tx_since;    // millis() when the oldest queued output was written
+            bool     tx_overrun;  // Output was dropped since the last drain
+        };
+
         static bool        _setupdone;
         static WiFiServer* _telnetserver;
         static WiFiClient  _telnetClients[MAX_TLNT_CLIENTS];
@@ -61,11 +73,15 @@ namespace WebUI {
         static uint16_t _port;
 
         void clearClients();
-
-        uint32_t _lastflush;
-        uint8_t  _RXbuffer[TELNETRXBUFFERSIZE];
-        uint16_t _RXbufferSize;
-        uint16_t _RXbufferpos;
+        void resetClient(uint8_t i);
+        bool push(uint8_t i, const uint8_t* data, int datasize);
+        void drain(uint8_t i);
+        int  readable_client();
+
+        Client            _clients[MAX_TLNT_CLIENTS];
+        SemaphoreHandle_t _tx_lock;
+        int8_t            _read_client;  // Client whose line is being read, -1 between lines
+        uint8_t           _next_client;  // Round robin start for the next line
     };
 
     extern Telnet_Server telnet_server;
@@ -25,19 +25,23 @@
 #    include "WifiServices.h"
 
 #    include "ESPResponse.h"
+#    include "FirmwareWriter.h"
 #    include "Serial2Socket.h"
 #    include "WebServer.h"
 #    include <WebSocketsServer.h>
 #    include <WiFi.h>
 #    include <FS.h>
-#    include <SPIFFS.h>
+#    include "LocalFS.h"
 #    ifdef ENABLE_SD_CARD
 #        include <SD.h>
 #        include "../SDCard.h"
+#        include <esp_heap_caps.h>
 #    endif
 #    include <WebServer.h>
 #    include <ESP32SSDP.h>
 #    include <StreamString.h>
+#    include <algorithm>
+#    include <vector>
 #    include <Update.h>
 #    include <esp_wifi_types.h>
 #    ifdef ENABLE_MDNS
@@ -83,6 +87,116 @@ namespace WebUI {
     const int ESP_ERROR_NOT_ENOUGH_SPACE = 5;
     const int ESP_ERROR_UPLOAD_CANCELLED = 6;
     const int ESP_ERROR_FILE_CLOSE       = 7;
+    const int ESP_ERROR_UPLOAD_RESUME    = 8;
+
+    const uint32_t WS_STREAM_STATUS_MS    = 200;
+    const uint32_t WS_TELEMETRY_MS        = 50;
+    const int      WS_TELEMETRY_PER_FRAME = 32;  // Samples, more than come in WS_TELEMETRY_MS
+    const uint32_t WS_RTT_PROBE_MS        = 2000;
+
+    // The pages are validated on every load, so a firmware or SPIFFS update shows at once, but
+    // an unchanged page costs a 304 instead of the whole file
+    const char CACHE_CONTROL_PAGES[] = "no-cache";
+
+    // Content hashes of SPIFFS files already served, so the ETag costs one pass over a file
+    // rather than one per request. An entry is only used while size and mtime still match.
+    struct ETagEntry {
+        String   path;
+        size_t   size;
+        time_t   mtime;
+        uint32_t hash;
+    };
+    const int        ETAG_CACHE_SIZE = 8;
+    static ETagEntry etag_cache[ETAG_CACHE_SIZE];
+    static int       etag_cache_next = 0;
+
+    // FNV-1a
+    static uint32_t etag_hash(uint32_t hash, const uint8_t* data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+    const uint32_t ETAG_HASH_INIT = 2166136261u;
+
+    static String etag_format(size_t size, uint32_t hash) {
+        char etag[24];
+        snprintf(etag, sizeof(etag), "\"%x-%08x\"", size, hash);
+        return String(etag);
+    }
+
+    // The embedded page only changes with the firmware, so its tag is worked out once
+    static const String& nofiles_etag() {
+        static String etag;
+        if (etag.length() == 0) {
+            uint32_t hash = ETAG_HASH_INIT;
+            uint8_t  buf[64];
+            for (size_t i = 0; i < PAGE_NOFILES_SIZE; i += sizeof(buf)) {
+                size_t len = MIN(sizeof(buf), PAGE_NOFILES_SIZE - i);
+                memcpy_P(buf, PAGE_NOFILES + i, len);
+                hash = etag_hash(hash, buf, len);
+            }
+            etag = etag_format(PAGE_NOFILES_SIZE, hash);
+        }
+        return etag;
+    }
+
+    static String file_etag(const String& path, File& file) {
+        size_t size  = file.size();
+        time_t mtime = file.getLastWrite();
+        for (int i = 0; i < ETAG_CACHE_SIZE; i++) {
+            ETagEntry& entry = etag_cache[i];
+            if (entry.path == path && entry.size == size && entry.mtime == mtime) {
+                return etag_format(size, entry.hash);
+            }
+        }
+        uint32_t hash = ETAG_HASH_INIT;
+        uint8_t  buf[256];
+        int      len;
+        while ((len = file.read(buf, sizeof(buf))) > 0) {
+            hash = etag_hash(hash, buf, len);
+        }
+        file.seek(0);
+        ETagEntry& entry = etag_cache[etag_cache_next];
+        etag_cache_next  = (etag_cache_next + 1) % ETAG_CACHE_SIZE;
+        entry.path       = path;
+        entry.size       = size;
+        entry.mtime      = mtime;
+        entry.hash       = hash;
+        return etag_format(size, hash);
+    }
+
+    // Wire layouts of the stream frames, see StreamFrame
+    struct __attribute__((packed)) StreamAck {
+        uint8_t  type;
+        uint16_t seq;
+        uint8_t  result;
+        uint8_t  planner_free;
+        uint16_t rx_free;
+    };
+
+    struct __attribute__((packed)) StreamStatus {
+        uint8_t  type;
+        uint16_t seq;
+        uint8_t  state;
+        uint8_t  planner_free;
+        uint16_t rx_free;
+        float    feed_rate;
+        uint32_t spindle_speed;
+        float    mpos[N_AXIS];
+    };
+
+    struct __attribute__((packed)) StreamRtt {
+        uint8_t  type;
+        uint32_t stamp;  // millis() when the probe was sent
+    };
+
+    struct __attribute__((packed)) StreamTelemetry {
+        uint8_t            type;
+        uint32_t           dropped;
+        uint8_t            count;
+        telemetry_sample_t samples[WS_TELEMETRY_PER_FRAME];
+    };
 
     Web_Server        web_server;
     bool              Web_Server::_setupdone     = false;
@@ -91,10 +205,18 @@ namespace WebUI {
     UploadStatusType  Web_Server::_upload_status = UploadStatusType::NONE;
     WebServer*        Web_Server::_webserver     = NULL;
     WebSocketsServer* Web_Server::_socket_server = NULL;
+    int               Web_Server::_stream_client      = -1;
+    uint16_t          Web_Server::_stream_seq         = 0;
+    uint32_t          Web_Server::_stream_status_time = 0;
+    int               Web_Server::_telemetry_client   = -1;
+    uint32_t          Web_Server::_telemetry_time     = 0;
+    uint32_t          Web_Server::_rtt_probe_time     = 0;
 #    ifdef ENABLE_AUTHENTICATION
-    AuthenticationIP* Web_Server::_head  = NULL;
-    uint8_t           Web_Server::_nb_ip = 0;
-    const int         MAX_AUTH_IP        = 10;
+    static AuthenticationIP auth_pool[AUTH_POOL_SIZE];
+    static uint8_t          auth_bucket[AUTH_HASH_SIZE];    // Pool index + 1 of the first session, 0 for none
+    static uint8_t          auth_wheel[AUTH_WHEEL_SLOTS];  // The same for each wheel slot
+    static uint32_t         auth_wheel_minute;             // Of the last sweep, in AUTH_WHEEL_MS
+    static uint8_t          auth_count;
 #    endif
     Web_Server::Web_Server() {}
     Web_Server::~Web_Server() { end(); }
@@ -111,13 +233,15 @@ namespace WebUI {
 
         //create instance
         _webserver = new WebServer(_port);
-#    ifdef ENABLE_AUTHENTICATION
         //here the list of headers to be recorded
-        const char* headerkeys[]   = { "Cookie" };
-        size_t      headerkeyssize = sizeof(headerkeys) / sizeof(char*);
+#    ifdef ENABLE_AUTHENTICATION
+        const char* headerkeys[] = { "If-None-Match", "Cookie" };
+#    else
+        const char* headerkeys[] = { "If-None-Match" };
+#    endif
+        size_t headerkeyssize = sizeof(headerkeys) / sizeof(char*);
         //ask server to track these headers
         _webserver->collectHeaders(headerkeys, headerkeyssize);
-#    endif
         _socket_server = new WebSocketsServer(_port + 1);
         _socket_server->begin();
         _socket_server->onEvent(handle_Websocket_Event);
@@ -158,6 +282,7 @@ namespace WebUI {
 #    ifdef ENABLE_SD_CARD
         //Direct SD management
         _webserver->on("/upload", HTTP_ANY, handle_direct_SDFileList, SDFile_direct_upload);
+        _webserver->on("/upload_check", HTTP_ANY, handle_SDUploadCheck);
         // _webserver->on("/SD", HTTP_ANY, handle_SDCARD);
 #    endif
 
@@ -230,12 +355,10 @@ namespace WebUI {
         }
 
 #    ifdef ENABLE_AUTHENTICATION
-        while (_head) {
-            AuthenticationIP* current = _head;
-            _head                     = _head->_next;
-            delete current;
-        }
-        _nb_ip = 0;
+        memset(auth_pool, 0, sizeof(auth_pool));
+        memset(auth_bucket, 0, sizeof(auth_bucket));
+        memset(auth_wheel, 0, sizeof(auth_wheel));
+        auth_count = 0;
 #    endif
     }
 
@@ -246,23 +369,62 @@ namespace WebUI {
         String contentType = getContentType(path);
         String pathWithGz  = path + ".gz";
         //if have a index.html or gzip version this is default root page
-        if ((SPIFFS.exists(pathWithGz) || SPIFFS.exists(path)) && !_webserver->hasArg("index") &&  // forcefallback
+        if ((localfs().exists(pathWithGz) || localfs().exists(path)) && !_webserver->hasArg("index") &&  // forcefallback
             _webserver->arg("index") != "yes") {
-            if (SPIFFS.exists(pathWithGz)) {
+            if (localfs().exists(pathWithGz)) {
                 path = pathWithGz;
             }
-
-            File file = SPIFFS.open(path, FILE_READ);
-            _webserver->streamFile(file, contentType);
-            file.close();
+            send_cached_file(path, contentType);
             return;
         }
 
-        //if no lets launch the default content
+        //if no lets launch the default content, straight from flash
+        const String& etag = nofiles_etag();
+        _webserver->sendHeader("ETag", etag);
+        _webserver->sendHeader("Cache-Control", CACHE_CONTROL_PAGES);
+        if (not_modified(etag)) {
+            return;
+        }
         _webserver->sendHeader("Content-Encoding", "gzip");
         _webserver->send_P(200, "text/html", PAGE_NOFILES, PAGE_NOFILES_SIZE);
     }
 
+    // Answers 304 when the client already holds this version. The ETag and Cache-Control
+    // headers must already be set, as a 304 repeats them.
+    bool Web_Server::not_modified(const String& etag) {
+        if (!_webserver->hasHeader("If-None-Match")) {
+            return false;
+        }
+        String tags = _webserver->header("If-None-Match");
+        if (tags.indexOf(etag) < 0 && tags != "*") {
+            return false;
+        }
+        _webserver->send(304);
+        return true;
+    }
+
+    // Streams a SPIFFS file, or answers 304 if the client's copy is current
+    void Web_Server::send_cached_file(const String& path, const String& contentType) {
+        File file = localfs().open(path, FILE_READ);
+        if (!file) {
+            _webserver->send(500, "text/plain", "cannot open " + path);
+            return;
+        }
+        String etag = file_etag(path, file);
+        _webserver->sendHeader("ETag", etag);
+        _webserver->sendHeader("Cache-Control", CACHE_CONTROL_PAGES);
+        if (!not_modified(etag)) {
+            _webserver->streamFile(file, contentType);
+        }
+        file.close();
+    }
+
+    void Web_Server::etag_cache_clear() {
+        for (int i = 0; i < ETAG_CACHE_SIZE; i++) {
+            etag_cache[i].path = "";
+        }
+    }
+
     //Handle not registred path on SPIFFS neither SD ///////////////////////
     void Web_Server::handle_not_found() {
         if (is_authenticated() == AuthenticationLevel::LEVEL_GUEST) {
@@ -329,13 +491,11 @@ namespace WebUI {
             return;
         } else
 #    endif
-            if (SPIFFS.exists(pathWithGz) || SPIFFS.exists(path)) {
-            if (SPIFFS.exists(pathWithGz)) {
+            if (localfs().exists(pathWithGz) || localfs().exists(path)) {
+            if (localfs().exists(pathWithGz)) {
                 path = pathWithGz;
             }
-            File file = SPIFFS.open(path, FILE_READ);
-            _webserver->streamFile(file, contentType);
-            file.close();
+            send_cached_file(path, contentType);
             return;
         } else {
             page_not_found = true;
@@ -365,13 +525,11 @@ namespace WebUI {
             path        = "/404.htm";
             contentType = getContentType(path);
             pathWithGz  = path + ".gz";
-            if (SPIFFS.exists(pathWithGz) || SPIFFS.exists(path)) {
-                if (SPIFFS.exists(pathWithGz)) {
+            if (localfs().exists(pathWithGz) || localfs().exists(path)) {
+                if (localfs().exists(pathWithGz)) {
                     path = pathWithGz;
                 }
-                File file = SPIFFS.open(path, FILE_READ);
-                _webserver->streamFile(file, contentType);
-                file.close();
+                send_cached_file(path, contentType);
 
             } else {
                 //if not template use default page
@@ -450,33 +608,44 @@ namespace WebUI {
         //    }
         //}
         AuthenticationLevel auth_level = is_authenticated();
-        String              cmd        = "";
+        heap_count(HeapSite::WebCommand);
+        // The server keeps the arguments as Strings and arg() returns a copy. That copy is the
+        // only allocation left here; the command is taken apart in place.
+        String arg;
         if (_webserver->hasArg("plain")) {
-            cmd = _webserver->arg("plain");
+            arg = _webserver->arg("plain");
         } else if (_webserver->hasArg("commandText")) {
-            cmd = _webserver->arg("commandText");
+            arg = _webserver->arg("commandText");
         } else {
             _webserver->send(200, "text/plain", "Invalid command");
             return;
         }
+        const char* cmd = arg.c_str();
+        const char* end = cmd + arg.length();
+        while (cmd < end && isspace(uint8_t(*cmd))) {
+            cmd++;
+        }
+        while (end > cmd && isspace(uint8_t(end[-1]))) {
+            end--;
+        }
         //if it is internal command [ESPXXX]<parameter>
-        cmd.trim();
-        int ESPpos = cmd.indexOf("[ESP");
-        if (ESPpos > -1) {
-            char line[256];
-            strncpy(line, cmd.c_str(), 255);
-            ESPResponseStream* espresponse = silent ? NULL : new ESPResponseStream(_webserver);
+        if (strstr(cmd, "[ESP")) {
+            char   line[256];
+            size_t len = MIN(size_t(end - cmd), sizeof(line) - 1);
+            memcpy(line, cmd, len);
+            line[len] = '\0';
+            ESPResponseStream  response(_webserver);
+            ESPResponseStream* espresponse = silent ? NULL : &response;
             Error              err         = system_execute_line(line, espresponse, auth_level);
-            String             answer;
+            char               answer[64];
             if (err == Error::Ok) {
-                answer = "ok";
+                strcpy(answer, "ok");
             } else {
                 const char* msg = errorString(err);
-                answer          = "Error: ";
                 if (msg) {
-                    answer += msg;
+                    snprintf(answer, sizeof(answer), "Error: %s", msg);
                 } else {
-                    answer += static_cast<int>(err);
+                    snprintf(answer, sizeof(answer), "Error: %d", static_cast<int>(err));
                 }
             }
             if (silent || !espresponse->anyOutput()) {
@@ -484,39 +653,51 @@ namespace WebUI {
             } else {
                 espresponse->flush();
             }
-            if(espresponse) delete(espresponse);
         } else {  //execute GCODE
             if (auth_level == AuthenticationLevel::LEVEL_GUEST) {
                 _webserver->send(401, "text/plain", "Authentication failed!\n");
                 return;
             }
             //Instead of send several commands one by one by web  / send full set and split here
-            String      scmd;
-            bool hasError =false;
-            uint8_t     sindex = 0;
-            // TODO Settings - this is very inefficient.  get_Splited_Value() is O(n^2)
-            // when it could easily be O(n).  Also, it would be just as easy to push
-            // the entire string into Serial2Socket and pull off lines from there.
-            for (uint8_t sindex = 0; (scmd = get_Splited_Value(cmd, '\n', sindex)) != ""; sindex++) {
+            bool hasError = false;
+            char line[LINE_BUFFER_SIZE + 1];
+            for (const char* next = cmd; next < end;) {
+                const char* eol = (const char*)memchr(next, '\n', end - next);
+                if (!eol) {
+                    eol = end;
+                }
+                const char* text = next;
+                size_t      len  = eol - next;
+                next             = eol + 1;
+                if (len == 0) {
+                    continue;
+                }
+                if (len > LINE_BUFFER_SIZE - 1) {
+                    hasError = true;  // Too long for the line buffer it would go into
+                    continue;
+                }
+                memcpy(line, text, len);
                 // 0xC2 is an HTML encoding prefix that, in UTF-8 mode,
                 // precede 0x90 and 0xa0-0bf, which are GRBL realtime commands.
                 // There are other encodings for 0x91-0x9f, so I am not sure
                 // how - or whether - those commands work.
                 // Ref: https://www.w3schools.com/tags/ref_urlencode.ASP
-                if (!silent && (scmd.length() == 2) && (scmd[0] == 0xC2)) {
-                    scmd[0] = scmd[1];
-                    scmd.remove(1, 1);
+                if (!silent && len == 2 && uint8_t(line[0]) == 0xC2) {
+                    line[0] = line[1];
+                    len     = 1;
                 }
-                if (scmd.length() > 1) {
-                    scmd += "\n";
-                } else if (!is_realtime_command(scmd[0])) {
-                    scmd += "\n";
+                // A one-character realtime command is run at once, lines get their separator back
+                if (len == 1 && is_realtime_command(line[0])) {
+                    execute_realtime_command(static_cast<Cmd>(line[0]), CLIENT_WEBUI);
+                    continue;
                 }
-                if (!Serial2Socket.push(scmd.c_str())) {
+                line[len++] = '\n';
+                line[len]   = '\0';
+                if (!Serial2Socket.push(line)) {
                     hasError = true;
                 }
             }
-            _webserver->send(200, "text/plain", hasError?"Error":"");
+            _webserver->send(200, "text/plain", hasError ? "Error" : "");
         }
     }
 
@@ -625,13 +806,14 @@ namespace WebUI {
                 }
                 //create Session
                 if ((current_auth_level != auth_level) || (auth_level == AuthenticationLevel::LEVEL_GUEST)) {
-                    AuthenticationIP* current_auth = new AuthenticationIP;
-                    current_auth->level            = current_auth_level;
-                    current_auth->ip               = _webserver->client().remoteIP();
-                    strcpy(current_auth->sessionID, create_session_ID());
-                    strcpy(current_auth->userID, sUser.c_str());
-                    current_auth->last_time = millis();
-                    if (AddAuthIP(current_auth)) {
+                    AuthenticationIP new_auth = {};
+                    new_auth.level            = current_auth_level;
+                    new_auth.ip               = _webserver->client().remoteIP();
+                    strcpy(new_auth.sessionID, create_session_ID());
+                    strlcpy(new_auth.userID, sUser.c_str(), sizeof(new_auth.userID));
+                    new_auth.last_time             = millis();
+                    AuthenticationIP* current_auth = AddAuthIP(new_auth);
+                    if (current_auth != NULL) {
                         String tmps = "ESPSESSIONID=";
                         tmps += current_auth->sessionID;
                         _webserver->sendHeader("Set-Cookie", tmps);
@@ -648,7 +830,6 @@ namespace WebUI {
                                 break;
                         }
                     } else {
-                        delete current_auth;
                         msg_alert_error = true;
                         code            = 500;
                         smsg            = "Error: Too many connections";
@@ -729,6 +910,7 @@ namespace WebUI {
 
         //check if query need some action
         if (_webserver->hasArg("action")) {
+            etag_cache_clear();
             //delete a file
             if (_webserver->arg("action") == "delete" && _webserver->hasArg("filename")) {
                 String filename;
@@ -736,10 +918,10 @@ namespace WebUI {
                 shortname.replace("/", "");
                 filename = path + _webserver->arg("filename");
                 filename.replace("//", "/");
-                if (!SPIFFS.exists(filename)) {
+                if (!localfs().exists(filename)) {
                     status = shortname + " does not exists!";
                 } else {
-                    if (SPIFFS.remove(filename)) {
+                    if (localfs().remove(filename)) {
                         status = shortname + " deleted";
                         //what happen if no "/." and no other subfiles ?
                         String ptmp = path;
@@ -747,14 +929,11 @@ namespace WebUI {
                             ptmp = path.substring(0, path.length() - 1);
                         }
 
-                        File dir        = SPIFFS.open(ptmp);
+                        File dir        = localfs().open(ptmp);
                         File dircontent = dir.openNextFile();
-                        if (!dircontent) {
+                        if (!dircontent && localfs_flat()) {
                             //keep directory alive even empty
-                            File r = SPIFFS.open(path + "/.", FILE_WRITE);
-                            if (r) {
-                                r.close();
-                            }
+                            localfs_mkdir(ptmp);
                         }
                     } else {
                         status = "Cannot deleted ";
@@ -771,23 +950,12 @@ namespace WebUI {
                 filename += "/";
                 filename.replace("//", "/");
                 if (filename != "/") {
-                    bool delete_error = false;
-                    File dir          = SPIFFS.open(path + shortname);
-                    {
-                        File file2deleted = dir.openNextFile();
-                        while (file2deleted) {
-                            String fullpath = file2deleted.name();
-                            if (!SPIFFS.remove(fullpath)) {
-                                delete_error = true;
-                                status       = "Cannot deleted ";
-                                status += fullpath;
-                            }
-                            file2deleted = dir.openNextFile();
-                        }
-                    }
-                    if (!delete_error) {
+                    if (localfs_rmdir(path + shortname)) {
                         status = shortname;
                         status += " deleted";
+                    } else {
+                        status = "Cannot deleted ";
+                        status += shortname;
                     }
                 }
             }
@@ -795,99 +963,97 @@ namespace WebUI {
             //create a directory
             if (_webserver->arg("action") == "createdir" && _webserver->hasArg("filename")) {
                 String filename;
-                filename         = path + _webserver->arg("filename") + "/.";
+                filename         = path + _webserver->arg("filename");
                 String shortname = _webserver->arg("filename");
                 shortname.replace("/", "");
                 filename.replace("//", "/");
-                if (SPIFFS.exists(filename)) {
+                if (localfs().exists(localfs_flat() ? filename + "/." : filename)) {
                     status = shortname + " already exists!";
+                } else if (!localfs_mkdir(filename)) {
+                    status = "Cannot create ";
+                    status += shortname;
                 } else {
-                    File r = SPIFFS.open(filename, FILE_WRITE);
-                    if (!r) {
-                        status = "Cannot create ";
-                        status += shortname;
-                    } else {
-                        r.close();
-                        status = shortname + " created";
-                    }
+                    status = shortname + " created";
                 }
             }
         }
 
-        String jsonfile = "{";
-        String ptmp     = path;
+        // Streamed, so a long listing does not have to fit in the heap
+        ESPResponseStream response(_webserver, "application/json");
+        JSONencoder       j(false, &response);
+        String            ptmp = path;
         if ((path != "/") && (path[path.length() - 1] = '/')) {
             ptmp = path.substring(0, path.length() - 1);
         }
 
-        File dir = SPIFFS.open(ptmp);
-        jsonfile += "\"files\":[";
-        bool   firstentry = true;
-        String subdirlist = "";
+        File dir = localfs().open(ptmp);
+        j.begin();
+        j.begin_array("files");
+        // "*name*" for each subdirectory listed so far. A directory past the end of a full list
+        // may be listed more than once.
+        char   subdirlist[256] = "";
+        size_t subdirlen       = 0;
+        char   size[16];
         File   fileparsed = dir.openNextFile();
         while (fileparsed) {
-            String filename  = fileparsed.name();
-            String size      = "";
-            bool   addtolist = true;
             //remove path from name
-            filename = filename.substring(path.length(), filename.length());
+            const char* fullname = fileparsed.name();
+            const char* filename = strlen(fullname) > path.length() ? fullname + path.length() : "";
+            const char* slash    = strchr(filename, '/');
+            char        dirname[64];
+            bool        addtolist = true;
             //check if file or subfile
-            if (filename.indexOf("/") > -1) {
+            if (slash) {
                 //Do not rely on "/." to define directory as SPIFFS upload won't create it but directly files
                 //and no need to overload SPIFFS if not necessary to create "/." if no need
                 //it will reduce SPIFFS available space so limit it to creation
-                filename   = filename.substring(0, filename.indexOf("/"));
-                String tag = "*";
-                tag += filename + "*";
-                if (subdirlist.indexOf(tag) > -1 || filename.length() == 0) {  //already in list
-                    addtolist = false;                                         //no need to add
+                size_t len = MIN(size_t(slash - filename), sizeof(dirname) - 3);
+                dirname[0] = '*';
+                memcpy(dirname + 1, filename, len);
+                dirname[len + 1] = '*';
+                dirname[len + 2] = '\0';
+                if (len == 0 || strstr(subdirlist, dirname)) {  //already in list
+                    addtolist = false;                          //no need to add
                 } else {
-                    size = "-1";  //it is subfile so display only directory, size will be -1 to describe it is directory
-                    if (subdirlist.length() == 0) {
-                        subdirlist += "*";
+                    strcpy(size, "-1");  //it is subfile so display only directory, size will be -1 to describe it is directory
+                    if (subdirlen + len + 2 < sizeof(subdirlist)) {
+                        strcpy(subdirlist + subdirlen, dirname);  //add to list
+                        subdirlen += len + 1;                     // The closing * opens the next
                     }
-                    subdirlist += filename + "*";  //add to list
                 }
+                dirname[len + 1] = '\0';
+                filename         = dirname + 1;
+            } else if (fileparsed.isDirectory()) {
+                strcpy(size, "-1");  // LittleFS lists its directories as entries
             } else {
                 //do not add "." file
-                if (!((filename == ".") || (filename == ""))) {
-                    size = ESPResponseStream::formatBytes(fileparsed.size());
+                if (!((strcmp(filename, ".") == 0) || (filename[0] == '\0'))) {
+                    ESPResponseStream::formatBytes(fileparsed.size(), size, sizeof(size));
                 } else {
                     addtolist = false;
                 }
             }
             if (addtolist) {
-                if (!firstentry) {
-                    jsonfile += ",";
-                } else {
-                    firstentry = false;
-                }
-                jsonfile += "{";
-                jsonfile += "\"name\":\"";
-                jsonfile += filename;
-                jsonfile += "\",\"size\":\"";
-                jsonfile += size;
-                jsonfile += "\"";
-                jsonfile += "}";
+                j.begin_object();
+                j.member("name", filename);
+                j.member("size", size);
+                j.end_object();
             }
             fileparsed = dir.openNextFile();
         }
-        jsonfile += "],";
-        jsonfile += "\"path\":\"" + path + "\",";
-        jsonfile += "\"status\":\"" + status + "\",";
+        j.end_array();
+        j.member("path", path);
+        j.member("status", status);
         size_t totalBytes;
         size_t usedBytes;
-        totalBytes = SPIFFS.totalBytes();
-        usedBytes  = SPIFFS.usedBytes();
-        jsonfile += "\"total\":\"" + ESPResponseStream::formatBytes(totalBytes) + "\",";
-        jsonfile += "\"used\":\"" + ESPResponseStream::formatBytes(usedBytes) + "\",";
-        jsonfile.concat(F("\"occupation\":\""));
-        jsonfile += String(100 * usedBytes / totalBytes);
-        jsonfile += "\"";
-        jsonfile += "}";
+        totalBytes = localfs_total_bytes();
+        usedBytes  = localfs_used_bytes();
+        j.member("total", ESPResponseStream::formatBytes(totalBytes, size, sizeof(size)));
+        j.member("used", ESPResponseStream::formatBytes(usedBytes, size, sizeof(size)));
+        j.member("occupation", int(100 * usedBytes / totalBytes));
+        j.end();
         path = "";
-        _webserver->sendHeader("Cache-Control", "no-cache");
-        _webserver->send(200, "application/json", jsonfile);
+        response.flush();
     }
 
     //push error code and message to websocket
@@ -938,6 +1104,7 @@ namespace WebUI {
                 //**************
                 if (upload.status == UPLOAD_FILE_START) {
                     _upload_status         = UploadStatusType::ONGOING;
+                    etag_cache_clear();
                     String upload_filename = upload.filename;
                     if (upload_filename[0] != '/') {
                         filename = "/" + upload_filename;
@@ -951,8 +1118,14 @@ namespace WebUI {
                         filename        = "/user" + upload_filename;
                     }
 
-                    if (SPIFFS.exists(filename)) {
-                        SPIFFS.remove(filename);
+                    // Flash writes stall the stepper interrupts, see Setting::flashWritesUnsafe()
+                    if (Setting::flashWritesUnsafe()) {
+                        _upload_status = UploadStatusType::FAILED;
+                        grbl_send(CLIENT_ALL, "[MSG:Upload error]\r\n");
+                        pushError(ESP_ERROR_UPLOAD, "Upload rejected, machine is moving");
+                    }
+                    if (_upload_status != UploadStatusType::FAILED && localfs().exists(filename)) {
+                        localfs().remove(filename);
                     }
                     if (fsUploadFile) {
                         fsUploadFile.close();
@@ -960,7 +1133,7 @@ namespace WebUI {
                     String sizeargname = upload.filename + "S";
                     if (_webserver->hasArg(sizeargname)) {
                         uint32_t filesize  = _webserver->arg(sizeargname).toInt();
-                        uint32_t freespace = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+                        uint32_t freespace = localfs_total_bytes() - localfs_used_bytes();
                         if (filesize > freespace) {
                             _upload_status = UploadStatusType::FAILED;
                             grbl_send(CLIENT_ALL, "[MSG:Upload error]\r\n");
@@ -970,7 +1143,7 @@ namespace WebUI {
 
                     if (_upload_status != UploadStatusType::FAILED) {
                         //create file
-                        fsUploadFile = SPIFFS.open(filename, FILE_WRITE);
+                        fsUploadFile = localfs_create(filename);
                         //check If creation succeed
                         if (fsUploadFile) {
                             //if yes upload is started
@@ -1009,7 +1182,7 @@ namespace WebUI {
                         fsUploadFile.close();
                         //check size
                         String sizeargname = upload.filename + "S";
-                        fsUploadFile       = SPIFFS.open(filename, FILE_READ);
+                        fsUploadFile       = localfs().open(filename, FILE_READ);
                         uint32_t filesize  = fsUploadFile.size();
                         fsUploadFile.close();
 
@@ -1041,8 +1214,8 @@ namespace WebUI {
 
         if (_upload_status == UploadStatusType::FAILED) {
             cancelUpload();
-            if (SPIFFS.exists(filename)) {
-                SPIFFS.remove(filename);
+            if (localfs().exists(filename)) {
+                localfs().remove(filename);
             }
         }
         COMMANDS::wait(0);
@@ -1075,6 +1248,10 @@ namespace WebUI {
     }
 
     //File upload for Web update
+    // The image may be gzip compressed, see FirmwareWriter. The rate reported at the end is
+    // of the bytes uploaded, KB/s being bytes per ms.
+    static FirmwareWriter firmware;
+
     void Web_Server::WebUpdateUpload() {
         static size_t   last_upload_update;
         static uint32_t maxSketchSpace = 0;
@@ -1112,7 +1289,7 @@ namespace WebUI {
                     }
                     if (_upload_status != UploadStatusType::FAILED) {
                         last_upload_update = 0;
-                        if (!Update.begin()) {  //start with max available size
+                        if (!firmware.begin()) {
                             _upload_status = UploadStatusType::FAILED;
                             grbl_send(CLIENT_ALL, "[MSG:Update cancelled]\r\n");
                             pushError(ESP_ERROR_NOT_ENOUGH_SPACE, "Upload rejected, not enough space");
@@ -1123,7 +1300,6 @@ namespace WebUI {
                     //Upload write
                     //**************
                 } else if (upload.status == UPLOAD_FILE_WRITE) {
-                    vTaskDelay(1 / portTICK_RATE_MS);
                     //check if no error
                     if (_upload_status == UploadStatusType::ONGOING) {
                         if (((100 * upload.totalSize) / maxSketchSpace) != last_upload_update) {
@@ -1138,22 +1314,33 @@ namespace WebUI {
                             s += "%";
                             grbl_sendf(CLIENT_ALL, "[MSG:%s]\r\n", s.c_str());
                         }
-                        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
+                        if (!firmware.write(upload.buf, upload.currentSize)) {
                             _upload_status = UploadStatusType::FAILED;
-                            grbl_send(CLIENT_ALL, "[MSG:Update write failed]\r\n");
+                            grbl_sendf(CLIENT_ALL, "[MSG:Update write failed: %s]\r\n", firmware.error());
                             pushError(ESP_ERROR_FILE_WRITE, "File write failed");
                         }
                     }
                     //Upload end
                     //**************
                 } else if (upload.status == UPLOAD_FILE_END) {
-                    if (Update.end(true)) {  //true to set the size to the current progress
+                    if (firmware.end()) {
                         //Now Reboot
-                        grbl_send(CLIENT_ALL, "[MSG:Update 100%]\r\n");
+                        uint32_t ms       = MAX(firmware.elapsed_ms(), 1u);
+                        char     from[24] = "";
+                        if (firmware.compressed()) {
+                            snprintf(from, sizeof(from), " from %u KB gzip", firmware.received() / 1024);
+                        }
+                        grbl_sendf(CLIENT_ALL,
+                                   "[MSG:Update 100%%, %u KB%s in %u.%u s, %u KB/s]\r\n",
+                                   firmware.written() / 1024,
+                                   from,
+                                   ms / 1000,
+                                   ms % 1000 / 100,
+                                   firmware.received() / ms);
                         _upload_status = UploadStatusType::SUCCESSFUL;
                     } else {
                         _upload_status = UploadStatusType::FAILED;
-                        grbl_send(CLIENT_ALL, "[MSG:Update failed]\r\n");
+                        grbl_sendf(CLIENT_ALL, "[MSG:Update failed: %s]\r\n", firmware.error());
                         pushError(ESP_ERROR_UPLOAD, "Update upload failed");
                     }
                 } else if (upload.status == UPLOAD_FILE_ABORTED) {
@@ -1166,7 +1353,7 @@ namespace WebUI {
 
         if (_upload_status == UploadStatusType::FAILED) {
             cancelUpload();
-            Update.end();
+            firmware.abort();
         }
 
         COMMANDS::wait(0);
@@ -1213,6 +1400,64 @@ namespace WebUI {
     }
 
     //direct SD files list//////////////////////////////////////////////////
+    // The listing of the last SD directory sent, sorted with the directories first, and the
+    // card totals, which cost a walk of the FAT. It stays good while sd_index_generation() is
+    // unchanged, since everything that changes the card bumps it, so paging through a long
+    // listing or reloading it does not read the card again, and neither does a listing while
+    // a job is running. Only the web server task uses it.
+    struct SdListEntry {
+        uint32_t name;  // Offset into sd_list_names
+        int32_t  size;  // -1 for a directory
+    };
+    static const size_t             SD_LIST_MAX_FILES = 1024;
+    static std::vector<SdListEntry> sd_list;
+    static std::vector<char>        sd_list_names;
+    static String                   sd_list_path;
+    static uint32_t                 sd_list_generation = 0;  // 0 for none
+    static uint64_t                 sd_list_total;
+    static uint64_t                 sd_list_used;
+
+    static bool sd_list_current(const String& path) {
+        return sd_list_generation == sd_index_generation() && sd_list_path == path;
+    }
+
+    static void sd_list_build(const String& path) {
+        uint32_t generation = sd_index_generation();
+        sd_list.clear();
+        sd_list_names.clear();
+        File dir = SD.open(path);
+        if (dir && dir.isDirectory()) {
+            File entry = dir.openNextFile();
+            while (entry && sd_list.size() < SD_LIST_MAX_FILES) {
+                COMMANDS::wait(1);
+                const char* name  = entry.name();
+                const char* slash = strrchr(name, '/');
+                if (slash) {
+                    name = slash + 1;
+                }
+                sd_list.push_back({ uint32_t(sd_list_names.size()), entry.isDirectory() ? -1 : int32_t(entry.size()) });
+                sd_list_names.insert(sd_list_names.end(), name, name + strlen(name) + 1);
+                entry.close();
+                entry = dir.openNextFile();
+            }
+        }
+        dir.close();
+        const char* names = sd_list_names.data();
+        std::sort(sd_list.begin(), sd_list.end(), [names](const SdListEntry& a, const SdListEntry& b) {
+            if ((a.size < 0) != (b.size < 0)) {
+                return a.size < 0;
+            }
+            return strcasecmp(names + a.name, names + b.name) < 0;
+        });
+        sd_list_total      = SD.totalBytes();
+        sd_list_used       = SD.usedBytes();
+        sd_list_path       = path;
+        sd_list_generation = generation;
+    }
+
+    // ?offset and ?limit page through the listing, "count" in the answer being the number of
+    // entries in all. Without ?action the answer carries an ETag, so a reload of an unchanged
+    // directory is a 304.
     void Web_Server::handle_direct_SDFileList() {
         //this is only for admin and user
         if (is_authenticated() == AuthenticationLevel::LEVEL_GUEST) {
@@ -1227,18 +1472,7 @@ namespace WebUI {
             sstatus        = "Upload failed";
         }
         _upload_status = UploadStatusType::NONE;
-        bool     list_files = true;
-        uint64_t totalspace = 0;
-        uint64_t usedspace  = 0;
-        SDState  state      = get_sd_state(true);
-        if (state != SDState::Idle) {
-            String status = "{\"status\":\"";
-            status += state == SDState::NotPresent ? "No SD Card\"}" : "Busy\"}";
-            _webserver->sendHeader("Cache-Control", "no-cache");
-            _webserver->send(200, "application/json", status);
-            return;
-        }
-        set_sd_state(SDState::BusyParsing);
+        bool list_files = true;
 
         //get current path
         if (_webserver->hasArg("path")) {
@@ -1251,8 +1485,26 @@ namespace WebUI {
         if (path[path.length() - 1] != '/') {
             path += "/";
         }
+        String dirpath = path == "/" ? path : path.substring(0, path.length() - 1);
+        bool   action  = _webserver->hasArg("action");
+
+        SDState state = get_sd_state(true);
+        // A running job keeps the card, but a listing already in memory can still be sent
+        bool cached_only = state != SDState::Idle && state != SDState::NotPresent && !action && sd_list_current(dirpath);
+        if (state != SDState::Idle && !cached_only) {
+            String status = "{\"status\":\"";
+            status += state == SDState::NotPresent ? "No SD Card\"}" : "Busy\"}";
+            _webserver->sendHeader("Cache-Control", "no-cache");
+            _webserver->send(200, "application/json", status);
+            return;
+        }
+        if (!cached_only) {
+            set_sd_state(SDState::BusyParsing);
+        }
+
         //check if query need some action
-        if (_webserver->hasArg("action")) {
+        if (action) {
+            sd_index_invalidate();
             //delete a file
             if (_webserver->arg("action") == "delete" && _webserver->hasArg("filename")) {
                 String filename;
@@ -1318,104 +1570,265 @@ namespace WebUI {
             list_files = false;
         }
 
-        // TODO Settings - consider using the JSONEncoder class
-        String jsonfile = "{";
-        jsonfile += "\"files\":[";
-
-        if (path != "/") {
-            path = path.substring(0, path.length() - 1);
+        path = dirpath;
+        if (!sd_list_current(path)) {
+            if (path != "/" && !SD.exists(path)) {
+                String s = "{\"status\":\" ";
+                s += path;
+                s += " does not exist on SD Card\"}";
+                _webserver->send(200, "application/json", s);
+                set_sd_state(SDState::Idle);
+                return;
+            }
+            sd_list_build(path);
         }
-        if (path != "/" && !SD.exists(path)) {
-            String s = "{\"status\":\" ";
-            s += path;
-            s += " does not exist on SD Card\"}";
-            _webserver->send(200, "application/json", s);
-            SD.end();
+        if (!cached_only) {
             set_sd_state(SDState::Idle);
-            return;
         }
-        if (list_files) {
-            File dir = SD.open(path);
-            if (!dir.isDirectory()) {
-                dir.close();
+
+        if (!action) {
+            char etag[24];
+            snprintf(etag,
+                     sizeof(etag),
+                     "\"sd-%x-%08x\"",
+                     sd_list_generation,
+                     etag_hash(ETAG_HASH_INIT, (const uint8_t*)path.c_str(), path.length()));
+            _webserver->sendHeader("ETag", etag);
+            _webserver->sendHeader("Cache-Control", "no-cache");
+            if (not_modified(etag)) {
+                return;
             }
-            dir.rewindDirectory();
-            File entry = dir.openNextFile();
-            int  i     = 0;
-            while (entry) {
-                COMMANDS::wait(1);
-                if (i > 0) {
-                    jsonfile += ",";
-                }
-                jsonfile += "{\"name\":\"";
-                String tmpname = entry.name();
-                int    pos     = tmpname.lastIndexOf("/");
-                tmpname        = tmpname.substring(pos + 1);
-                jsonfile += tmpname;
-                jsonfile += "\",\"shortname\":\"";  //No need here
-                jsonfile += tmpname;
-                jsonfile += "\",\"size\":\"";
-                if (entry.isDirectory()) {
-                    jsonfile += "-1";
+        }
+
+        size_t offset = _webserver->hasArg("offset") ? _webserver->arg("offset").toInt() : 0;
+        size_t limit  = _webserver->hasArg("limit") ? _webserver->arg("limit").toInt() : 0;
+        size_t end    = limit ? MIN(offset + limit, sd_list.size()) : sd_list.size();
+
+        // Streamed, so a long listing does not have to fit in the heap
+        ESPResponseStream response(_webserver, "application/json");
+        JSONencoder       j(false, &response);
+        char              size[16];
+        j.begin();
+        j.begin_array("files");
+        if (list_files) {
+            for (size_t i = offset; i < end; i++) {
+                const char* name = &sd_list_names[sd_list[i].name];
+                j.begin_object();
+                j.member("name", name);
+                j.member("shortname", name);  //No need here
+                if (sd_list[i].size < 0) {
+                    j.member("size", "-1");
                 } else {
                     // files have sizes, directories do not
-                    jsonfile += ESPResponseStream::formatBytes(entry.size());
+                    j.member("size", ESPResponseStream::formatBytes(uint32_t(sd_list[i].size), size, sizeof(size)));
                 }
-                jsonfile += "\",\"datetime\":\"";
                 //TODO - can be done later
-                jsonfile += "\"}";
-                i++;
-                entry.close();
-                entry = dir.openNextFile();
+                j.member("datetime", "");
+                j.end_object();
             }
-            dir.close();
         }
-        jsonfile += "],\"path\":\"";
-        jsonfile += path + "\",";
-        jsonfile += "\"total\":\"";
-        String stotalspace, susedspace;
+        j.end_array();
+        j.member("count", int(sd_list.size()));
+        j.member("path", path);
         //SDCard are in GB or MB but no less
-        totalspace  = SD.totalBytes();
-        usedspace   = SD.usedBytes();
-        stotalspace = ESPResponseStream::formatBytes(totalspace);
-        susedspace  = ESPResponseStream::formatBytes(usedspace + 1);
-
+        uint64_t totalspace   = sd_list_total;
+        uint64_t usedspace    = sd_list_used;
         uint32_t occupedspace = 1;
         uint32_t usedspace2   = usedspace / (1024 * 1024);
         uint32_t totalspace2  = totalspace / (1024 * 1024);
-        occupedspace          = (usedspace2 * 100) / totalspace2;
+        occupedspace          = totalspace2 ? (usedspace2 * 100) / totalspace2 : 0;
         //minimum if even one byte is used is 1%
         if (occupedspace <= 1) {
             occupedspace = 1;
         }
         if (totalspace) {
-            jsonfile += stotalspace;
+            j.member("total", ESPResponseStream::formatBytes(totalspace, size, sizeof(size)));
         } else {
-            jsonfile += "-1";
+            j.member("total", "-1");
         }
-        jsonfile += "\",\"used\":\"";
-        jsonfile += susedspace;
-        jsonfile += "\",\"occupation\":\"";
+        j.member("used", ESPResponseStream::formatBytes(usedspace + 1, size, sizeof(size)));
         if (totalspace) {
-            jsonfile += String(occupedspace);
+            j.member("occupation", int(occupedspace));
         } else {
-            jsonfile += "-1";
+            j.member("occupation", "-1");
         }
-        jsonfile += "\",";
-        jsonfile += "\"mode\":\"direct\",";
-        jsonfile += "\"status\":\"";
-        jsonfile += sstatus + "\"";
-        jsonfile += "}";
-        _webserver->sendHeader("Cache-Control", "no-cache");
-        _webserver->send(200, "application/json", jsonfile);
+        j.member("mode", "direct");
+        j.member("status", sstatus);
+        j.end();
+        response.flush();
+    }
+
+    // Upload chunks arrive about one TCP segment at a time. They are gathered here and written in
+    // multiples of the SD sector size, which FATFS hands straight to the card instead of going
+    // through its one-sector window.
+    const size_t SD_UPLOAD_BUFFER_SIZE     = 32 * 1024;
+    const size_t SD_UPLOAD_BUFFER_SIZE_MIN = 4 * 1024;  // If the heap cannot spare the full size
+
+    static uint8_t* sd_upload_buffer;
+    static size_t   sd_upload_buffer_size;
+    static size_t   sd_upload_buffered;
+    static uint32_t sd_upload_bytes;
+    static uint32_t sd_upload_start;
+
+    static bool sd_upload_begin() {
+        sd_upload_buffered = 0;
+        sd_upload_bytes    = 0;
+        sd_upload_start    = millis();
+        for (size_t size = SD_UPLOAD_BUFFER_SIZE; !sd_upload_buffer && size >= SD_UPLOAD_BUFFER_SIZE_MIN; size /= 2) {
+            sd_upload_buffer      = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_DMA);  // Word aligned, in internal RAM
+            sd_upload_buffer_size = size;
+        }
+        return sd_upload_buffer != NULL;
+    }
+
+    static bool sd_upload_flush(File& file) {
+        size_t length      = sd_upload_buffered;
+        sd_upload_buffered = 0;
+        if (length == 0) {
+            return true;
+        }
+        bool ok = file.write(sd_upload_buffer, length) == length;
+        // Once per buffer rather than per chunk, so the idle task on this core gets to run
+        vTaskDelay(1 / portTICK_RATE_MS);
+        return ok;
+    }
+
+    static bool sd_upload_write(File& file, const uint8_t* data, size_t length) {
+        sd_upload_bytes += length;
+        while (length) {
+            size_t n = MIN(length, sd_upload_buffer_size - sd_upload_buffered);
+            memcpy(sd_upload_buffer + sd_upload_buffered, data, n);
+            sd_upload_buffered += n;
+            data += n;
+            length -= n;
+            if (sd_upload_buffered == sd_upload_buffer_size && !sd_upload_flush(file)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void sd_upload_end() {
+        free(sd_upload_buffer);
+        sd_upload_buffer = NULL;
+    }
+
+    // path.upl records what was last uploaded to path: the hash the client gave for the content,
+    // which the firmware keeps but does not compute, and the size. Until the upload completes the
+    // bytes go to path.prt, so an upload that breaks off leaves the old file as it was and can be
+    // taken up again at the end of path.prt by an upload with the same hash and size. When it
+    // completes path.prt becomes path, and the time it was written is recorded too, so a file
+    // changed on the card since then no longer matches.
+    const uint32_t SD_UPLOAD_INFO_MAGIC = 0x314c5055;  // "UPL1"
+    const size_t   SD_UPLOAD_HASH_MAX   = 64;          // The hex of a SHA-256
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t mtime;
+        bool     complete;
+        char     hash[SD_UPLOAD_HASH_MAX + 1];
+    } sd_upload_info_t;
+
+    static bool sd_upload_info_load(const String& path, sd_upload_info_t* info) {
+        File file = SD.open(path + ".upl", FILE_READ);
+        if (!file) {
+            return false;
+        }
+        bool ok = file.read((uint8_t*)info, sizeof(*info)) == sizeof(*info) && info->magic == SD_UPLOAD_INFO_MAGIC;
+        file.close();
+        info->hash[SD_UPLOAD_HASH_MAX] = '\0';
+        return ok;
+    }
+
+    static void sd_upload_info_save(const String& path, const String& hash, uint32_t size, bool complete) {
+        sd_upload_info_t info = {};
+        info.magic            = SD_UPLOAD_INFO_MAGIC;
+        info.size             = size;
+        info.complete         = complete;
+        strncpy(info.hash, hash.c_str(), SD_UPLOAD_HASH_MAX);
+        if (complete) {
+            File file = SD.open(path, FILE_READ);
+            info.size  = file.size();
+            info.mtime = file.getLastWrite();
+            file.close();
+        }
+        File file = SD.open(path + ".upl", FILE_WRITE);
+        if (file) {
+            file.write((const uint8_t*)&info, sizeof(info));
+            file.close();
+        }
+    }
+
+    // Bytes of the content with hash and size already on the card: size if path holds it, what
+    // path.prt holds of it, or 0
+    static uint32_t sd_upload_have(const String& path, const String& hash, uint32_t size) {
+        sd_upload_info_t info;
+        if (hash.length() == 0 || hash.length() > SD_UPLOAD_HASH_MAX || !sd_upload_info_load(path, &info) || info.size != size ||
+            hash != info.hash) {
+            return 0;
+        }
+        File file = SD.open(info.complete ? path : path + ".prt", FILE_READ);
+        if (!file) {
+            return 0;
+        }
+        uint32_t have  = file.size();
+        time_t   mtime = file.getLastWrite();
+        file.close();
+        if (info.complete) {
+            return (have == info.size && (uint32_t)mtime == info.mtime) ? size : 0;
+        }
+        return have < size ? have : 0;
+    }
+
+    // ?path, ?filename, ?size and ?hash describe a file about to be uploaded. The answer's
+    // "offset" is where its upload should start: the size if the card already has it, so there
+    // is nothing to send, the end of an upload that broke off, or 0.
+    void Web_Server::handle_SDUploadCheck() {
+        if (is_authenticated() == AuthenticationLevel::LEVEL_GUEST) {
+            _webserver->send(401, "application/json", "{\"status\":\"Authentication failed!\"}");
+            return;
+        }
+        if (!_webserver->hasArg("filename") || !_webserver->hasArg("size") || !_webserver->hasArg("hash")) {
+            _webserver->send(400, "application/json", "{\"status\":\"Missing filename, size or hash\"}");
+            return;
+        }
+        String path = "/";
+        if (_webserver->hasArg("path")) {
+            path += _webserver->arg("path") + "/";
+        }
+        path += _webserver->arg("filename");
+        path.replace("//", "/");
+        path.replace("//", "/");
+        uint32_t size = _webserver->arg("size").toInt();
+
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            String status = "{\"status\":\"";
+            status += state == SDState::NotPresent ? "No SD Card\"}" : "Busy\"}";
+            _webserver->send(200, "application/json", status);
+            return;
+        }
+        set_sd_state(SDState::BusyParsing);
+        uint32_t have = sd_upload_have(path, _webserver->arg("hash"), size);
         set_sd_state(SDState::Idle);
-        SD.end();
+
+        JSONencoder j(false);
+        j.begin();
+        j.member("status", have == 0 ? "missing" : have == size ? "exists" : "partial");
+        j.member("offset", String(have));
+        _webserver->sendHeader("Cache-Control", "no-cache");
+        _webserver->send(200, "application/json", j.end());
     }
 
     //SD File upload with direct access to SD///////////////////////////////
+    // Besides <filename>S, the size of the whole file, <filename>H gives its hash, which makes
+    // the upload one that can be resumed, and <filename>O the offset to resume at, as
+    // /upload_check answered it. The body then holds the file from there on.
     void Web_Server::SDFile_direct_upload() {
         static String filename;
         static File   sdUploadFile;
+        static bool   keep_part;  // Leave path.prt as it is if this upload fails
         //this is only for admin and user
         if (is_authenticated() == AuthenticationLevel::LEVEL_GUEST) {
             _upload_status = UploadStatusType::FAILED;
@@ -1429,11 +1842,16 @@ namespace WebUI {
                 //**************
                 if (upload.status == UPLOAD_FILE_START) {
                     _upload_status = UploadStatusType::ONGOING;
+                    keep_part      = true;  // Until this upload has opened it
                     filename       = upload.filename;
                     //on SD need to add / if not present
                     if (filename[0] != '/') {
                         filename = "/" + upload.filename;
                     }
+                    String   sizeargname = upload.filename + "S";
+                    String   hash        = _webserver->hasArg(upload.filename + "H") ? _webserver->arg(upload.filename + "H") : "";
+                    uint32_t offset      = _webserver->hasArg(upload.filename + "O") ? _webserver->arg(upload.filename + "O").toInt() : 0;
+                    uint32_t filesize    = _webserver->hasArg(sizeargname) ? _webserver->arg(sizeargname).toInt() : 0;
                     //check if SD Card is available
                     if (get_sd_state(true) != SDState::Idle) {
                         _upload_status = UploadStatusType::FAILED;
@@ -1442,25 +1860,39 @@ namespace WebUI {
 
                     } else {
                         set_sd_state(SDState::BusyUploading);
-                        //delete file on SD Card if already present
-                        if (SD.exists(filename)) {
-                            SD.remove(filename);
-                        }
-                        String sizeargname = upload.filename + "S";
+                        sd_index_invalidate();
                         if (_webserver->hasArg(sizeargname)) {
-                            uint32_t filesize  = _webserver->arg(sizeargname).toInt();
                             uint64_t freespace = SD.totalBytes() - SD.usedBytes();
-                            if (filesize > freespace) {
+                            if (filesize - MIN(offset, filesize) > freespace) {
                                 _upload_status = UploadStatusType::FAILED;
                                 grbl_send(CLIENT_ALL, "[MSG:Upload error]\r\n");
                                 pushError(ESP_ERROR_NOT_ENOUGH_SPACE, "Upload rejected, not enough space");
                             }
                         }
+                        if (_upload_status != UploadStatusType::FAILED && offset != 0 &&
+                            (offset >= filesize || sd_upload_have(filename, hash, filesize) != offset)) {
+                            _upload_status = UploadStatusType::FAILED;
+                            grbl_send(CLIENT_ALL, "[MSG:Upload cannot resume]\r\n");
+                            pushError(ESP_ERROR_UPLOAD_RESUME, "Upload cannot resume, start it again");
+                        }
                         if (_upload_status != UploadStatusType::FAILED) {
-                            //Create file for writing
-                            sdUploadFile = SD.open(filename, FILE_WRITE);
+                            if (offset != 0) {
+                                sdUploadFile = SD.open(filename + ".prt", FILE_APPEND);
+                                grbl_sendf(CLIENT_ALL, "[MSG:Upload resumed at %u]\r\n", offset);
+                            } else {
+                                //the file on SD Card is only replaced once the upload is complete
+                                if (SD.exists(filename + ".prt")) {
+                                    SD.remove(filename + ".prt");
+                                }
+                                if (hash.length() != 0 && hash.length() <= SD_UPLOAD_HASH_MAX && filesize != 0) {
+                                    sd_upload_info_save(filename, hash, filesize, false);
+                                } else if (SD.exists(filename + ".upl")) {
+                                    SD.remove(filename + ".upl");
+                                }
+                                sdUploadFile = SD.open(filename + ".prt", FILE_WRITE);
+                            }
                             //check if creation succeed
-                            if (!sdUploadFile) {
+                            if (!sdUploadFile || !sd_upload_begin()) {
                                 //if creation failed
                                 _upload_status = UploadStatusType::FAILED;
                                 grbl_send(CLIENT_ALL, "[MSG:Upload failed]\r\n");
@@ -1469,17 +1901,18 @@ namespace WebUI {
                             //if creation succeed set flag UploadStatusType::ONGOING
                             else {
                                 _upload_status = UploadStatusType::ONGOING;
+                                keep_part      = SD.exists(filename + ".upl");
                             }
                         }
                     }
                     //Upload write
                     //**************
                 } else if (upload.status == UPLOAD_FILE_WRITE) {
-                    vTaskDelay(1 / portTICK_RATE_MS);
                     if (sdUploadFile && (_upload_status == UploadStatusType::ONGOING) && (get_sd_state(false) == SDState::BusyUploading)) {
                         //no error write post data
-                        if (upload.currentSize != sdUploadFile.write(upload.buf, upload.currentSize)) {
+                        if (!sd_upload_write(sdUploadFile, upload.buf, upload.currentSize)) {
                             _upload_status = UploadStatusType::FAILED;
+                            keep_part      = false;  // What reached the card is in doubt
                             grbl_send(CLIENT_ALL, "[MSG:Upload failed]\r\n");
                             pushError(ESP_ERROR_FILE_WRITE, "File write failed");
                         }
@@ -1493,25 +1926,52 @@ namespace WebUI {
                 } else if (upload.status == UPLOAD_FILE_END) {
                     //if file is open close it
                     if (sdUploadFile) {
+                        if (!sd_upload_flush(sdUploadFile)) {
+                            _upload_status = UploadStatusType::FAILED;
+                            keep_part      = false;
+                            pushError(ESP_ERROR_FILE_WRITE, "File write failed");
+                        }
                         sdUploadFile.close();
+                        uint32_t elapsed = MAX(millis() - sd_upload_start, 1UL);
+                        grbl_sendf(CLIENT_ALL,
+                                   "[MSG:Upload %u bytes in %u ms, %u KB/s]\r\n",
+                                   sd_upload_bytes,
+                                   elapsed,
+                                   (uint32_t)((uint64_t)sd_upload_bytes * 1000 / 1024 / elapsed));
                         //TODO Check size
                         String sizeargname = upload.filename + "S";
                         if (_webserver->hasArg(sizeargname)) {
                             uint32_t filesize = 0;
-                            sdUploadFile      = SD.open(filename, FILE_READ);
+                            sdUploadFile      = SD.open(filename + ".prt", FILE_READ);
                             filesize          = sdUploadFile.size();
                             sdUploadFile.close();
                             if (_webserver->arg(sizeargname) != String(filesize)) {
                                 _upload_status = UploadStatusType::FAILED;
+                                keep_part      = false;
                                 pushError(ESP_ERROR_UPLOAD, "File upload mismatch");
                                 grbl_send(CLIENT_ALL, "[MSG:Upload failed]\r\n");
                             }
                         }
+                        if (_upload_status == UploadStatusType::ONGOING) {
+                            if (SD.exists(filename)) {
+                                SD.remove(filename);
+                            }
+                            if (!SD.rename(filename + ".prt", filename)) {
+                                _upload_status = UploadStatusType::FAILED;
+                                pushError(ESP_ERROR_FILE_CLOSE, "File close failed");
+                            } else if (keep_part) {
+                                sd_upload_info_t info;
+                                if (sd_upload_info_load(filename, &info)) {
+                                    sd_upload_info_save(filename, info.hash, info.size, true);
+                                }
+                            }
+                        }
                     } else {
                         _upload_status = UploadStatusType::FAILED;
                         grbl_send(CLIENT_ALL, "[MSG:Upload failed]\r\n");
                         pushError(ESP_ERROR_FILE_CLOSE, "File close failed");
                     }
+                    sd_upload_end();
                     if (_upload_status == UploadStatusType::ONGOING) {
                         _upload_status = UploadStatusType::SUCCESSFUL;
                         set_sd_state(SDState::Idle);
@@ -1525,9 +1985,13 @@ namespace WebUI {
                     set_sd_state(SDState::Idle);
                     grbl_send(CLIENT_ALL, "[MSG:Upload failed]\r\n");
                     if (sdUploadFile) {
+                        sd_upload_flush(sdUploadFile);  // What did arrive, for a resume
                         sdUploadFile.close();
                     }
-                    SD.end();
+                    sd_upload_end();
+                    if (!keep_part && SD.exists(filename + ".prt")) {
+                        SD.remove(filename + ".prt");
+                    }
                     return;
                 }
             }
@@ -1535,10 +1999,12 @@ namespace WebUI {
         if (_upload_status == UploadStatusType::FAILED) {
             cancelUpload();
             if (sdUploadFile) {
+                sd_upload_flush(sdUploadFile);
                 sdUploadFile.close();
             }
-            if (SD.exists(filename)) {
-                SD.remove(filename);
+            sd_upload_end();
+            if (!keep_part && SD.exists(filename + ".prt")) {
+                SD.remove(filename + ".prt");
             }
             set_sd_state(SDState::Idle);
         }
@@ -1560,6 +2026,15 @@ namespace WebUI {
         if (_socket_server && _setupdone) {
             _socket_server->loop();
         }
+        if (_stream_client >= 0 && (millis() - _stream_status_time) >= WS_STREAM_STATUS_MS) {
+            send_stream_status();
+        }
+        if (_telemetry_client >= 0 && (millis() - _telemetry_time) >= WS_TELEMETRY_MS) {
+            send_telemetry();
+        }
+        if (_socket_server && http_output->get() == OUTPUT_ADAPTIVE && (millis() - _rtt_probe_time) >= WS_RTT_PROBE_MS) {
+            send_rtt_probe();
+        }
         if ((millis() - timeout) > 10000 && _socket_server) {
             String s = "PING:";
             s += String(_id_connection);
@@ -1572,6 +2047,14 @@ namespace WebUI {
         switch (type) {
             case WStype_DISCONNECTED:
                 //USE_SERIAL.printf("[%u] Disconnected!\n", num);
+                if (num == _stream_client) {
+                    _stream_client = -1;
+                }
+                if (num == _telemetry_client) {
+                    _telemetry_client = -1;
+                    telemetry_stop();
+                }
+                Serial2Socket.forget_rtt(num);
                 grbl_send(CLIENT_SERIAL , "WebUI Disconnected!\n");
                 break;
             case WStype_CONNECTED: {
@@ -1598,33 +2081,103 @@ namespace WebUI {
             case WStype_BIN:
                 //USE_SERIAL.printf("[%u] get binary length: %u\n", num, length);
                 //hexdump(payload, length);
-
-                // send message to client
-                // webSocket.sendBIN(num, payload, length);
+                handle_stream_frame(num, payload, length);
                 break;
             default:
                 break;
         }
     }
 
-    // The separator that is passed in to this function is always '\n'
-    // The string that is returned does not contain the separator
-    // The calling code adds back the separator, unless the string is
-    // a one-character realtime command.
-    String Web_Server::get_Splited_Value(String data, char separator, int index) {
-        int found      = 0;
-        int strIndex[] = { 0, -1 };
-        int maxIndex   = data.length() - 1;
-
-        for (int i = 0; i <= maxIndex && found <= index; i++) {
-            if (data.charAt(i) == separator || i == maxIndex) {
-                found++;
-                strIndex[0] = strIndex[1] + 1;
-                strIndex[1] = (i == maxIndex) ? i + 1 : i;
+    void Web_Server::handle_stream_frame(uint8_t num, uint8_t* payload, size_t length) {
+        if (length < 1) {
+            return;
+        }
+        if (StreamFrame(payload[0]) == StreamFrame::Status) {
+            if (num == _stream_client) {
+                send_stream_status();
             }
+            return;
         }
+        if (StreamFrame(payload[0]) == StreamFrame::Telemetry) {
+            // Read only, so allowed with authentication too. A new subscriber takes it over.
+            if (length >= 2 && payload[1]) {
+                _telemetry_client = num;
+                _telemetry_time   = millis();
+                telemetry_start();
+            } else if (num == _telemetry_client) {
+                _telemetry_client = -1;
+                telemetry_stop();
+            }
+            return;
+        }
+        if (StreamFrame(payload[0]) == StreamFrame::RttEcho) {
+            StreamRtt echo;
+            if (length >= sizeof(echo)) {
+                memcpy(&echo, payload, sizeof(echo));
+                Serial2Socket.set_rtt(num, millis() - echo.stamp);
+            }
+            return;
+        }
+        StreamAck ack;
+        ack.type = uint8_t(StreamFrame::Ack);
+        ack.seq  = 0;
+        if (StreamFrame(payload[0]) != StreamFrame::Lines || length < 3) {
+            ack.result = uint8_t(StreamResult::BadFrame);
+        } else {
+            memcpy(&ack.seq, payload + 1, sizeof(ack.seq));
+#    ifdef ENABLE_AUTHENTICATION
+            // The websocket carries no session, so it cannot be checked like /command
+            ack.result = uint8_t(StreamResult::Denied);
+#    else
+            if (_stream_client >= 0 && num != _stream_client) {
+                ack.result = uint8_t(StreamResult::Busy);
+            } else if (!Serial2Socket.push(payload + 3, client_realtime_filter(CLIENT_WEBUI, payload + 3, length - 3))) {
+                ack.result = uint8_t(StreamResult::NoRoom);
+            } else {
+                _stream_client = num;
+                _stream_seq    = ack.seq;
+                ack.result     = uint8_t(StreamResult::Accepted);
+            }
+#    endif
+        }
+        ack.planner_free = plan_get_block_buffer_available();
+        ack.rx_free      = Serial2Socket.availableforwrite();
+        _socket_server->sendBIN(num, (uint8_t*)&ack, sizeof(ack));
+    }
+
+    void Web_Server::send_stream_status() {
+        StreamStatus status;
+        status.type          = uint8_t(StreamFrame::StatusReport);
+        status.seq           = _stream_seq;
+        status.state         = uint8_t(sys.state);
+        status.planner_free  = plan_get_block_buffer_available();
+        status.rx_free       = Serial2Socket.availableforwrite();
+        status.feed_rate     = st_get_realtime_rate();
+        status.spindle_speed = sys.spindle_speed;
+        float mpos[MAX_N_AXIS];
+        system_convert_array_steps_to_mpos(mpos, sys_position);
+        memcpy(status.mpos, mpos, sizeof(status.mpos));  // The packed field may be unaligned
+        _socket_server->sendBIN(_stream_client, (uint8_t*)&status, sizeof(status));
+        _stream_status_time = millis();
+    }
 
-        return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
+    void Web_Server::send_rtt_probe() {
+        StreamRtt probe;
+        probe.type  = uint8_t(StreamFrame::RttProbe);
+        probe.stamp = millis();
+        _socket_server->broadcastBIN((uint8_t*)&probe, sizeof(probe));
+        _rtt_probe_time = probe.stamp;
+    }
+
+    void Web_Server::send_telemetry() {
+        static StreamTelemetry frame;  // Too big for the stack of the caller
+        frame.type    = uint8_t(StreamFrame::TelemetryData);
+        frame.dropped = telemetry_dropped();
+        while ((frame.count = telemetry_read(frame.samples, WS_TELEMETRY_PER_FRAME)) > 0) {
+            size_t length = offsetof(StreamTelemetry, samples) + frame.count * sizeof(telemetry_sample_t);
+            _socket_server->sendBIN(_telemetry_client, (uint8_t*)&frame, length);
+        }
+        _telemetry_time = millis();
     }
 
     //helper to extract content type from file extension
@@ -1686,15 +2239,96 @@ namespace WebUI {
 
 #    ifdef ENABLE_AUTHENTICATION
 
-    //add the information in the linked list if possible
-    bool Web_Server::AddAuthIP(AuthenticationIP* item) {
-        if (_nb_ip > MAX_AUTH_IP) {
-            return false;
+    static uint8_t auth_hash(const char* sessionID) {
+        uint32_t hash = 2166136261u;  // FNV-1a
+        while (*sessionID) {
+            hash = (hash ^ uint8_t(*sessionID++)) * 16777619u;
         }
-        item->_next = _head;
-        _head       = item;
-        _nb_ip++;
-        return true;
+        return hash & (AUTH_HASH_SIZE - 1);
+    }
+
+    static uint8_t auth_wheel_slot(uint32_t time) { return (time / AUTH_WHEEL_MS) % AUTH_WHEEL_SLOTS; }
+
+    // Takes the pool entry index + 1 off the list that starts at head, linked through field
+    static void auth_unlink(uint8_t* head, uint8_t AuthenticationIP::*field, uint8_t entry) {
+        while (*head != 0) {
+            if (*head == entry) {
+                *head = auth_pool[entry - 1].*field;
+                return;
+            }
+            head = &(auth_pool[*head - 1].*field);
+        }
+    }
+
+    static void auth_remove(AuthenticationIP* auth) {
+        uint8_t entry = auth - auth_pool + 1;
+        auth_unlink(&auth_bucket[auth_hash(auth->sessionID)], &AuthenticationIP::hash_next, entry);
+        auth_unlink(&auth_wheel[auth_wheel_slot(auth->last_time)], &AuthenticationIP::wheel_next, entry);
+        memset(auth, 0, sizeof(AuthenticationIP));
+        auth_count--;
+    }
+
+    // Marks the session as used now, moving it to the wheel slot of this minute
+    static void auth_touch(AuthenticationIP* auth, uint32_t now) {
+        uint8_t entry = auth - auth_pool + 1;
+        uint8_t from  = auth_wheel_slot(auth->last_time);
+        uint8_t to    = auth_wheel_slot(now);
+        if (from != to) {
+            auth_unlink(&auth_wheel[from], &AuthenticationIP::wheel_next, entry);
+            auth->wheel_next = auth_wheel[to];
+            auth_wheel[to]   = entry;
+        }
+        auth->last_time = now;
+    }
+
+    // Drops the sessions of the wheel slots that have come to be more than AUTH_TIMEOUT_MS old
+    // since the last sweep. Only the slot due each minute is looked at.
+    static void auth_sweep(uint32_t now) {
+        uint32_t minute = now / AUTH_WHEEL_MS;
+        uint32_t steps  = MIN(minute - auth_wheel_minute, uint32_t(AUTH_WHEEL_SLOTS));
+        for (uint32_t m = minute - steps + 1; steps > 0; m++, steps--) {
+            uint8_t entry = auth_wheel[(m + 1) % AUTH_WHEEL_SLOTS];  // Last used AUTH_WHEEL_SLOTS - 1 minutes before m
+            while (entry != 0) {
+                AuthenticationIP* auth = &auth_pool[entry - 1];
+                entry                  = auth->wheel_next;
+                if (now - auth->last_time > AUTH_TIMEOUT_MS) {
+                    auth_remove(auth);
+                }
+            }
+        }
+        auth_wheel_minute = minute;
+    }
+
+    static AuthenticationIP* auth_find(IPAddress ip, const char* sessionID) {
+        for (uint8_t entry = auth_bucket[auth_hash(sessionID)]; entry != 0; entry = auth_pool[entry - 1].hash_next) {
+            AuthenticationIP* auth = &auth_pool[entry - 1];
+            if (ip == auth->ip && strcmp(sessionID, auth->sessionID) == 0) {
+                return auth;
+            }
+        }
+        return NULL;
+    }
+
+    //add the information in the session table if possible
+    AuthenticationIP* Web_Server::AddAuthIP(const AuthenticationIP& item) {
+        auth_sweep(millis());
+        if (auth_count == AUTH_POOL_SIZE) {
+            return NULL;
+        }
+        AuthenticationIP* auth = auth_pool;
+        while (auth->sessionID[0] != '\0') {
+            auth++;
+        }
+        uint8_t entry   = auth - auth_pool + 1;
+        uint8_t bucket  = auth_hash(item.sessionID);
+        uint8_t slot    = auth_wheel_slot(item.last_time);
+        *auth           = item;
+        auth->hash_next = auth_bucket[bucket];
+        auth_bucket[bucket] = entry;
+        auth->wheel_next    = auth_wheel[slot];
+        auth_wheel[slot]    = entry;
+        auth_count++;
+        return auth;
     }
 
     //Session ID based on IP and time using 16 char
@@ -1725,82 +2359,31 @@ namespace WebUI {
     }
 
     bool Web_Server::ClearAuthIP(IPAddress ip, const char* sessionID) {
-        AuthenticationIP* current  = _head;
-        AuthenticationIP* previous = NULL;
-        bool              done     = false;
-        while (current) {
-            if ((ip == current->ip) && (strcmp(sessionID, current->sessionID) == 0)) {
-                //remove
-                done = true;
-                if (current == _head) {
-                    _head = current->_next;
-                    _nb_ip--;
-                    delete current;
-                    current = _head;
-                } else {
-                    previous->_next = current->_next;
-                    _nb_ip--;
-                    delete current;
-                    current = previous->_next;
-                }
-            } else {
-                previous = current;
-                current  = current->_next;
-            }
+        AuthenticationIP* auth = auth_find(ip, sessionID);
+        if (auth == NULL) {
+            return false;
         }
-        return done;
+        auth_remove(auth);
+        return true;
     }
 
     //Get info
-    AuthenticationIP* Web_Server::GetAuth(IPAddress ip, const char* sessionID) {
-        AuthenticationIP* current = _head;
-        //AuthenticationIP * previous = NULL;
-        //get time
-        //uint32_t now = millis();
-        while (current) {
-            if (ip == current->ip) {
-                if (strcmp(sessionID, current->sessionID) == 0) {
-                    //found
-                    return current;
-                }
-            }
-            //previous = current;
-            current = current->_next;
-        }
-        return NULL;
-    }
+    AuthenticationIP* Web_Server::GetAuth(IPAddress ip, const char* sessionID) { return auth_find(ip, sessionID); }
 
-    //Review all IP to reset timers
+    //Reset the timer of the session, and clean the expired ones
     AuthenticationLevel Web_Server::ResetAuthIP(IPAddress ip, const char* sessionID) {
-        AuthenticationIP* current  = _head;
-        AuthenticationIP* previous = NULL;
-        //get time
-        //uint32_t now = millis();
-        while (current) {
-            if ((millis() - current->last_time) > 360000) {
-                //remove
-                if (current == _head) {
-                    _head = current->_next;
-                    _nb_ip--;
-                    delete current;
-                    current = _head;
-                } else {
-                    previous->_next = current->_next;
-                    _nb_ip--;
-                    delete current;
-                    current = previous->_next;
-                }
-            } else {
-                if (ip == current->ip && strcmp(sessionID, current->sessionID) == 0) {
-                    //reset time
-                    current->last_time = millis();
-                    return (AuthenticationLevel)current->level;
-                }
-                previous = current;
-                current  = current->_next;
-            }
+        uint32_t now = millis();
+        auth_sweep(now);
+        AuthenticationIP* auth = auth_find(ip, sessionID);
+        if (auth == NULL) {
+            return AuthenticationLevel::LEVEL_GUEST;
         }
-        return AuthenticationLevel::LEVEL_GUEST;
+        if (now - auth->last_time > AUTH_TIMEOUT_MS) {  // Due in a slot not swept yet
+            auth_remove(auth);
+            return AuthenticationLevel::LEVEL_GUEST;
+        }
+        auth_touch(auth, now);
+        return auth->level;
     }
 #    endif
 }
@@ -28,19 +28,75 @@ class WebServer;
 
 namespace WebUI {
 #ifdef ENABLE_AUTHENTICATION
+    // Sessions live in a fixed pool, found through a small hash table on the session ID. For
+    // expiry each one is also on the list of a timer wheel slot, by the minute of its last use,
+    // so a request only looks at the slots whose sessions have all timed out since the last one.
+    const int      MAX_AUTH_IP      = 10;
+    const int      AUTH_POOL_SIZE   = MAX_AUTH_IP + 1;  // One over, as the list used to allow
+    const int      AUTH_HASH_SIZE   = 16;               // A power of 2
+    const uint32_t AUTH_TIMEOUT_MS  = 360000;
+    const uint32_t AUTH_WHEEL_MS    = 60000;
+    const int      AUTH_WHEEL_SLOTS = 8;  // Spans more than AUTH_TIMEOUT_MS
+
     struct AuthenticationIP {
         IPAddress           ip;
         AuthenticationLevel level;
         char                userID[17];
-        char                sessionID[17];
+        char                sessionID[17];  // Empty for a free pool entry
         uint32_t            last_time;
-        AuthenticationIP*   _next;
+        uint8_t             hash_next;   // Pool index + 1 of the next session in the hash bucket, 0 for none
+        uint8_t             wheel_next;  // The same in the timer wheel slot
     };
 #endif
 
     //Upload status
     enum class UploadStatusType : uint8_t { NONE = 0, FAILED = 1, CANCELLED = 2, SUCCESSFUL = 3, ONGOING = 4 };
 
+    // Binary job streaming over the websocket, on top of the text protocol. All fields are
+    // little endian. A client takes the stream with its first Lines frame and holds it until it
+    // disconnects. Each Lines frame is answered with an Ack carrying the credit left, free
+    // planner blocks and RX bytes, and the owner also gets a StatusReport every
+    // WS_STREAM_STATUS_MS. G-code responses still come back as the usual text output.
+    //
+    //   Lines  (to firmware)   u8 type, u16 seq, G-code lines ending in '\n'
+    //   Status (to firmware)   u8 type, asks for a StatusReport now
+    //   Ack    (from firmware) u8 type, u16 seq, u8 StreamResult, u8 planner free, u16 RX free
+    //   StatusReport (from firmware)
+    //                          u8 type, u16 last seq accepted, u8 state, u8 planner free,
+    //                          u16 RX free, f32 feed rate, u32 spindle speed, f32 MPos[N_AXIS]
+    //
+    // Any one client, with or without the stream, can take the motion telemetry of Telemetry.h,
+    // which comes every WS_TELEMETRY_MS with the samples taken since the last frame:
+    //
+    //   Telemetry (to firmware)     u8 type, u8 1 to start or 0 to stop
+    //   TelemetryData (from firmware)
+    //                               u8 type, u32 samples dropped, u8 count, telemetry_sample_t[count]
+    //
+    // With Http/Output=Adaptive every client gets a RttProbe every WS_RTT_PROBE_MS. A client that
+    // sends it back as a RttEcho has its round trip measured, which sizes the output window of
+    // Serial2Socket. Clients that do not echo are served with the default window.
+    //
+    //   RttProbe (from firmware)    u8 type, u32 stamp
+    //   RttEcho  (to firmware)      u8 type, u32 stamp of the probe
+    enum class StreamFrame : uint8_t {
+        Lines         = 0x01,
+        Status        = 0x02,
+        Telemetry     = 0x03,
+        RttEcho       = 0x04,
+        Ack           = 0x81,  // Above ASCII, so never confused with text output
+        StatusReport  = 0x82,
+        TelemetryData = 0x83,
+        RttProbe      = 0x84,
+    };
+
+    enum class StreamResult : uint8_t {
+        Accepted = 0,
+        NoRoom   = 1,  // Not enough RX credit, resend after the next Ack or StatusReport
+        Busy     = 2,  // Another client holds the stream
+        Denied   = 3,  // Streaming is not available with authentication
+        BadFrame = 4,
+    };
+
     class Web_Server {
     public:
         Web_Server();
@@ -59,15 +115,18 @@ namespace WebUI {
         static WebServer*          _webserver;
         static long                _id_connection;
         static WebSocketsServer*   _socket_server;
+        static int                 _stream_client;  // Websocket client number, -1 for none
+        static uint16_t            _stream_seq;     // Last Lines frame accepted
+        static uint32_t            _stream_status_time;
+        static int                 _telemetry_client;  // Websocket client number, -1 for none
+        static uint32_t            _telemetry_time;
+        static uint32_t            _rtt_probe_time;
         static uint16_t            _port;
         static UploadStatusType    _upload_status;
         static String              getContentType(String filename);
-        static String              get_Splited_Value(String data, char separator, int index);
         static AuthenticationLevel is_authenticated();
 #ifdef ENABLE_AUTHENTICATION
-        static AuthenticationIP*   _head;
-        static uint8_t             _nb_ip;
-        static bool                AddAuthIP(AuthenticationIP* item);
+        static AuthenticationIP*   AddAuthIP(const AuthenticationIP& item);
         static char*               create_session_ID();
         static bool                ClearAuthIP(IPAddress ip, const char* sessionID);
         static AuthenticationIP*   GetAuth(IPAddress ip, const char* sessionID);
@@ -77,12 +136,19 @@ namespace WebUI {
         static void handle_SSDP();
 #endif
         static void handle_root();
+        static bool not_modified(const String& etag);
+        static void send_cached_file(const String& path, const String& contentType);
+        static void etag_cache_clear();
         static void handle_login();
         static void handle_not_found();
         static void _handle_web_command(bool);
         static void handle_web_command() { _handle_web_command(false); }
         static void handle_web_command_silent() { _handle_web_command(true); }
         static void handle_Websocket_Event(uint8_t num, uint8_t type, uint8_t* payload, size_t length);
+        static void handle_stream_frame(uint8_t num, uint8_t* payload, size_t length);
+        static void send_stream_status();
+        static void send_telemetry();
+        static void send_rtt_probe();
         static void SPIFFSFileupload();
         static void handleFileList();
         static void handleUpdate();
@@ -92,6 +158,7 @@ namespace WebUI {
 #ifdef ENABLE_SD_CARD
         static void handle_direct_SDFileList();
         static void SDFile_direct_upload();
+        static void handle_SDUploadCheck();
         static bool deleteRecursive(String path);
 #endif
     };
@@ -21,10 +21,11 @@
 */
 
 #include "../Grbl.h"
+#include "../mks/MKS_draw_powerless.h"
 
 #include <WiFi.h>
 #include <FS.h>
-#include <SPIFFS.h>
+#include "LocalFS.h"
 #include <esp_wifi.h>
 #include <esp_ota_ops.h>
 
@@ -55,6 +56,9 @@ namespace WebUI {
     IntSetting*    http_port;
     EnumSetting*   telnet_enable;
     IntSetting*    telnet_port;
+    EnumSetting*   wifi_power_save;
+    EnumSetting*   telnet_output;
+    EnumSetting*   http_output;
 
     typedef std::map<const char*, int8_t, cmp_str> enum_opt_t;
 
@@ -62,6 +66,22 @@ namespace WebUI {
         { "DHCP", DHCP_MODE },
         { "Static", STATIC_MODE },
     };
+
+    enum_opt_t powerSaveOptions = {
+        { "OFF", POWER_SAVE_OFF },
+        { "IDLE", POWER_SAVE_IDLE },
+        { "ON", POWER_SAVE_ON },
+    };
+
+    enum_opt_t outputOptions = {
+        { "LowLatency", OUTPUT_LOW_LATENCY },
+        { "Bulk", OUTPUT_BULK },
+    };
+    enum_opt_t httpOutputOptions = {
+        { "LowLatency", OUTPUT_LOW_LATENCY },
+        { "Bulk", OUTPUT_BULK },
+        { "Adaptive", OUTPUT_ADAPTIVE },
+    };
 #endif
 
 #ifdef WIFI_OR_BLUETOOTH
@@ -105,60 +125,63 @@ namespace WebUI {
 
     static ESPResponseStream* espresponse;
 
+    // A key=value parameter a command takes. get_params() sets value, to "" when it is absent.
     typedef struct {
-        char* key;
-        char* value;
-    } keyval_t;
-
-    static keyval_t params[10];
-    bool            split_params(char* parameter) {
-        int i = 0;
-        for (char* s = parameter; *s; s++) {
-            if (*s == '=') {
-                params[i].value = s + 1;
-                *s              = '\0';
-                // Search backward looking for the start of the key,
-                // either just after a space or at the beginning of the strin
-                if (s == parameter) {
-                    return false;
-                }
-                for (char* k = s - 1; k >= parameter; --k) {
-                    if (*k == '\0') {
-                        // If we find a NUL - i.e. the end of the previous key -
-                        // before finding a space, the string is malformed.
-                        return false;
-                    }
-                    if (*k == ' ') {
-                        *k              = '\0';
-                        params[i++].key = k + 1;
-                        break;
-                    }
-                    if (k == parameter) {
-                        params[i++].key = k;
+        const char* key;
+        bool        allowSpaces;  // Otherwise the value ends at its first space
+        char*       value;
+    } param_t;
+
+    static char nullstr[1] = { '\0' };
+
+    static void match_param(char* key, char* value, param_t* wanted, int n_wanted) {
+        for (param_t* p = wanted; p < wanted + n_wanted; p++) {
+            if (p->value == nullstr && !strcasecmp(key, p->key)) {
+                if (!p->allowSpaces) {
+                    char* space = strchr(value, ' ');
+                    if (space) {
+                        *space = '\0';
                     }
                 }
+                p->value = value;
+                return;  // The first of a repeated key counts
             }
         }
-        params[i].key = NULL;
-        return true;
     }
 
-    char  nullstr[1] = { '\0' };
-    char* get_param(const char* key, bool allowSpaces) {
-        for (keyval_t* p = params; p->key; p++) {
-            if (!strcasecmp(key, p->key)) {
-                if (!allowSpaces) {
-                    for (char* s = p->value; *s; s++) {
-                        if (*s == ' ') {
-                            *s = '\0';
-                            break;
-                        }
-                    }
+    // Splits parameter, "key=value key=value ...", in place and fills in the wanted values, in
+    // one pass. A value runs up to the space before the next key, so it may hold spaces. False
+    // if a key is empty or runs into the previous value's '='.
+    static bool get_params(char* parameter, param_t* wanted, int n_wanted) {
+        for (param_t* p = wanted; p < wanted + n_wanted; p++) {
+            p->value = nullstr;
+        }
+        char* token = parameter;  // Just after the last space
+        char* key   = NULL;
+        char* value = NULL;
+        for (char* s = parameter;; s++) {
+            if (*s == ' ') {
+                token = s + 1;
+            } else if (*s == '=') {
+                if (s == token || (value && token <= value)) {
+                    return false;
+                }
+                if (token > parameter) {
+                    token[-1] = '\0';  // Ends the previous value
+                }
+                if (key) {
+                    match_param(key, value, wanted, n_wanted);
+                }
+                *s    = '\0';
+                key   = token;
+                value = s + 1;
+            } else if (*s == '\0') {
+                if (key) {
+                    match_param(key, value, wanted, n_wanted);
                 }
-                return p->value;
+                return true;
             }
         }
-        return nullstr;
     }
 }
 
@@ -276,8 +299,9 @@ namespace WebUI {
 
     static Error SPIFFSSize(char* parameter, AuthenticationLevel auth_level) {  // ESP720
         webPrint(parameter);
-        webPrint("SPIFFS  Total:", ESPResponseStream::formatBytes(SPIFFS.totalBytes()));
-        webPrintln(" Used:", ESPResponseStream::formatBytes(SPIFFS.usedBytes()));
+        webPrint(localfs_name());
+        webPrint("  Total:", ESPResponseStream::formatBytes(localfs_total_bytes()));
+        webPrintln(" Used:", ESPResponseStream::formatBytes(localfs_used_bytes()));
         return Error::Ok;
     }
 
@@ -287,7 +311,7 @@ namespace WebUI {
             return Error::InvalidValue;
         }
         webPrint("Formatting");
-        SPIFFS.format();
+        localfs_format();
         webPrintln("...Done");
         return Error::Ok;
     }
@@ -301,11 +325,11 @@ namespace WebUI {
         if ((path.length() > 0) && (path[0] != '/')) {
             path = "/" + path;
         }
-        if (!SPIFFS.exists(path)) {
+        if (!localfs().exists(path)) {
             webPrintln("Error: No such file!");
             return Error::FsFileNotFound;
         }
-        File currentfile = SPIFFS.open(path, FILE_READ);
+        File currentfile = localfs().open(path, FILE_READ);
         if (!currentfile) {  //if file open success
             return Error::FsFailedOpenFile;
         }
@@ -337,11 +361,11 @@ namespace WebUI {
         if ((path.length() > 0) && (path[0] != '/')) {
             path = "/" + path;
         }
-        if (!SPIFFS.exists(path)) {
+        if (!localfs().exists(path)) {
             webPrintln("Error: No such file!");
             return Error::FsFileNotFound;
         }
-        File currentfile = SPIFFS.open(path, FILE_READ);
+        File currentfile = localfs().open(path, FILE_READ);
         if (!currentfile) {
             return Error::FsFailedOpenFile;
         }
@@ -363,13 +387,14 @@ namespace WebUI {
             webPrintln(" ", notification_ts->getStringValue());
             return Error::Ok;
         }
-        if (!split_params(parameter)) {
+        param_t params[] = { { "TS" }, { "T2" }, { "T1" }, { "type" } };
+        if (!get_params(parameter, params, 4)) {
             return Error::InvalidValue;
         }
-        char* ts  = get_param("TS", false);
-        char* t2  = get_param("T2", false);
-        char* t1  = get_param("T1", false);
-        char* ty  = get_param("type", false);
+        char* ts  = params[0].value;
+        char* t2  = params[1].value;
+        char* t1  = params[2].value;
+        char* ty  = params[3].value;
         Error err = notification_type->setStringValue(ty);
         if (err == Error::Ok) {
             err = notification_t1->setStringValue(t1);
@@ -447,7 +472,7 @@ namespace WebUI {
                 }
             }
             webPrintln("Available Size for update: ", ESPResponseStream::formatBytes(flashsize));
-            webPrintln("Available Size for SPIFFS: ", ESPResponseStream::formatBytes(SPIFFS.totalBytes()));
+            webPrintln("Available Size for SPIFFS: ", ESPResponseStream::formatBytes(localfs_total_bytes()));
 
 #    if defined(ENABLE_HTTP)
             webPrintln("Web port: ", String(web_server.port()));
@@ -606,7 +631,7 @@ namespace WebUI {
 
 #ifdef ENABLE_WIFI
     static Error listAPs(char* parameter, AuthenticationLevel auth_level) {  // ESP410
-        JSONencoder j(espresponse->client() != CLIENT_WEBUI);
+        JSONencoder j(espresponse->client() != CLIENT_WEBUI, espresponse);
         j.begin();
         j.begin_array("AP_LIST");
         // An initial async scanNetworks was issued at startup, so there
@@ -637,7 +662,7 @@ namespace WebUI {
                 break;
         }
         j.end_array();
-        webPrint(j.end());
+        j.end();
         if (espresponse->client() != CLIENT_WEBUI) {
             espresponse->println("");
         }
@@ -648,11 +673,12 @@ namespace WebUI {
     static Error setWebSetting(char* parameter, AuthenticationLevel auth_level) {  // ESP401
         // We do not need the "T=" (type) parameter because the
         // Setting objects know their own type
-        if (!split_params(parameter)) {
+        param_t params[] = { { "V", true }, { "P" } };
+        if (!get_params(parameter, params, 2)) {
             return Error::InvalidValue;
         }
-        char*       sval = get_param("V", true);
-        const char* spos = get_param("P", false);
+        char*       sval = params[0].value;
+        const char* spos = params[1].value;
         if (*spos == '\0') {
             webPrintln("Missing parameter");
             return Error::InvalidValue;
@@ -662,7 +688,7 @@ namespace WebUI {
     }
 
     static Error listSettings(char* parameter, AuthenticationLevel auth_level) {  // ESP400
-        JSONencoder j(espresponse->client() != CLIENT_WEBUI);
+        JSONencoder j(espresponse->client() != CLIENT_WEBUI, espresponse);
         j.begin();
         j.begin_array("EEPROM");
         for (Setting* js = Setting::List; js; js = js->next()) {
@@ -671,7 +697,7 @@ namespace WebUI {
             }
         }
         j.end_array();
-        webPrint(j.end());
+        j.end();
         return Error::Ok;
     }
 
@@ -733,8 +759,10 @@ namespace WebUI {
         if ((err = openSDFile(parameter)) != Error::Ok) {
             return err;
         }
-        char fileLine[255];
-        if (!readFileLine(fileLine, 255)) {
+        sd_use_compiled(SD);  // Run from the compiled copy if there is an up to date one
+        sd_preparse_enable();
+        sd_block_t fileBlock;
+        if (!readFileBlock(&fileBlock)) {
             //No need notification here it is just a macro
             closeFile();
             webPrintln("");
@@ -743,7 +771,310 @@ namespace WebUI {
         SD_client     = (espresponse) ? espresponse->client() : CLIENT_ALL;
         SD_auth_level = auth_level;
         // execute the first line now; Protocol.cpp handles later ones when SD_ready_next
-        report_status_message(execute_line(fileLine, SD_client, SD_auth_level), SD_client);
+        report_status_message(sd_execute_block(&fileBlock, SD_client, SD_auth_level), SD_client);
+        report_realtime_status(SD_client);
+        webPrintln("");
+        return Error::Ok;
+    }
+
+    static Error compileSDFile(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            webPrintln("Missing file name!");
+            return Error::InvalidValue;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        set_sd_state(SDState::BusyParsing);
+        uint32_t n_lines, n_compiled;
+        Error    err = sd_compile_file(SD, path.c_str(), &n_lines, &n_compiled);
+        set_sd_state(SDState::Idle);
+        if (err != Error::Ok) {
+            webPrintln("Compile failed");
+            return err;
+        }
+        webPrint("Compiled ", String(n_compiled));
+        webPrintln(" of ", String(n_lines) + " lines");
+        return Error::Ok;
+    }
+
+    // Queues a file to run when the current job ends, or lists the queue when given none
+    static Error queueSDFile(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            char path[SD_QUEUE_PATH_MAX];
+            for (uint8_t i = 0; sd_queue_get(i, path); i++) {
+                webPrintln(String(i + 1) + ": " + path);
+            }
+            webPrintln(String(sd_queue_count()) + " queued");
+            return Error::Ok;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);  // Busy while a job runs, and the card stays mounted
+        if (state != SDState::Idle && state != SDState::BusyPrinting) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        File file = SD.open(path.c_str());
+        bool found = file && !file.isDirectory();
+        file.close();
+        if (!found) {
+            webPrintln("File not found");
+            return Error::FsFileNotFound;
+        }
+        if (!sd_queue_add(path.c_str())) {
+            webPrintln("Queue full");
+            return Error::Overflow;
+        }
+        webPrintln(String(sd_queue_count()) + " queued");
+        return Error::Ok;
+    }
+
+    static Error clearSDQueue(char* parameter, AuthenticationLevel auth_level) {
+        sd_queue_clear();
+        webPrintln("");
+        return Error::Ok;
+    }
+
+    static Error showSDJobInfo(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            webPrintln("Missing file name!");
+            return Error::InvalidValue;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        set_sd_state(SDState::BusyParsing);
+        sd_job_info_t info;
+        Error         err = sd_get_job_info(SD, path.c_str(), &info);
+        set_sd_state(SDState::Idle);
+        if (err != Error::Ok) {
+            webPrintln("Cannot read file");
+            return err;
+        }
+        webPrintln("X: ", String(info.x_min, 3) + " to " + String(info.x_max, 3));
+        webPrintln("Y: ", String(info.y_min, 3) + " to " + String(info.y_max, 3));
+        webPrintln("Lines: ", String(info.lines));
+        webPrintln("Time: ", String(info.seconds) + "s");
+        webPrintln("S max: ", String(info.s_max));
+        return Error::Ok;
+    }
+
+    // Background check of the file, see Validate.h. The result comes as [MSG:] lines when done.
+    static Error checkSDFile(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            webPrintln("Missing file name!");
+            return Error::InvalidValue;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        validate_result_t result;
+        if (!validate_get(SD, path.c_str(), &result)) {
+            validate_request(path.c_str());
+            webPrintln("Checking in the background");
+            return Error::Ok;
+        }
+        webPrint("Lines: ", String(result.lines));
+        webPrintln(" errors: ", String(result.errors));
+        if (result.errors) {
+            webPrint("First error at line ", String(result.first_error_line));
+            webPrintln(": ", errorString(static_cast<Error>(result.first_error)));
+        }
+        if (result.has_box) {
+            webPrintln("X: ", String(result.box_min[X_AXIS], 3) + " to " + String(result.box_max[X_AXIS], 3));
+            webPrintln("Y: ", String(result.box_min[Y_AXIS], 3) + " to " + String(result.box_max[Y_AXIS], 3));
+            webPrintln("Z: ", String(result.box_min[Z_AXIS], 3) + " to " + String(result.box_max[Z_AXIS], 3));
+            if (validate_outside_travel(&result)) {
+                webPrintln("Outside travel");
+            }
+        }
+        return Error::Ok;
+    }
+
+    static Error benchSDCard(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            webPrintln("Missing file name!");
+            return Error::InvalidValue;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        set_sd_state(SDState::BusyParsing);
+        uint32_t n_bytes, n_ms;
+        Error    err = sd_bench(SD, path.c_str(), &n_bytes, &n_ms);
+        set_sd_state(SDState::Idle);
+        webPrintln("SPI clock: ", String(sd_get_spi_freq()) + "kHz");
+        if (err != Error::Ok) {
+            webPrintln("Read failed after ", String(n_bytes) + " bytes");
+            return err;
+        }
+        webPrint("Read ", String(n_bytes));
+        webPrint(" bytes in ", String(n_ms));
+        webPrintln(" ms: ", String(n_ms ? n_bytes / n_ms : 0) + " KB/s");
+        return Error::Ok;
+    }
+
+    // Dry runs the file through the parser, planner and step generator, see Simulate.h
+    static Error simulateSDFile(char* parameter, AuthenticationLevel auth_level) {
+        parameter = trim(parameter);
+        if (*parameter == '\0') {
+            webPrintln("Missing file name!");
+            return Error::InvalidValue;
+        }
+        String path = parameter;
+        if (path[0] != '/') {
+            path = "/" + path;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        set_sd_state(SDState::BusyParsing);
+        sim_result_t result;
+        Error        err = sim_file(SD, path.c_str(), &result);
+        set_sd_state(SDState::Idle);
+        if (err != Error::Ok) {
+            webPrintln("Dry run failed after ", String(result.lines) + " lines");
+            return err;
+        }
+        uint64_t hz = (uint64_t)ESP.getCpuFreqMHz() * 1000000;
+        webPrint("Lines: ", String(result.lines));
+        webPrintln(" errors: ", String(result.errors));
+        webPrint("Blocks: ", String(result.blocks));
+        webPrint(" segments: ", String(result.segments));
+        webPrintln(" steps: ", String((uint32_t)result.steps));
+        webPrintln("Motion time: ", String((uint32_t)(result.time_us / 1000)) + " ms");
+        webPrintln("Parser: ", String(result.parse_cycles ? (uint32_t)(hz * result.lines / result.parse_cycles) : 0) + " lines/s");
+        webPrintln("Prep: ", String(result.prep_cycles ? (uint32_t)(hz * result.segments / result.prep_cycles) : 0) + " segments/s");
+        webPrintln("Stepper: ", String(result.step_cycles ? (uint32_t)(hz * result.segments / result.step_cycles) : 0) + " segments/s");
+        webPrintln("Steps: ", path + ".steps");
+        return Error::Ok;
+    }
+
+    // Power-loss resume, see MKS_draw_powerless.h. Run after homing: goes back to the saved
+    // machine position with the spindle off, Z last, restores the G92 offset and the modes, then
+    // carries on from the saved offset in the job file.
+    static Error resumeSDFile(char* parameter, AuthenticationLevel auth_level) {
+        if (sys.state != State::Idle) {
+            webPrintln((sys.state == State::Alarm) ? "Alarm" : "Busy");
+            return Error::IdleError;
+        }
+        SDState state = get_sd_state(true);
+        if (state != SDState::Idle) {
+            webPrintln((state == SDState::NotPresent) ? "No SD card" : "Busy");
+            return (state == SDState::NotPresent) ? Error::FsFailedMount : Error::FsFailedBusy;
+        }
+        MKS_PL_RECORD_T rec;
+        if (!mks_powerless_load(&rec)) {
+            webPrintln("Nothing to resume");
+            return Error::FsFileNotFound;
+        }
+        webPrintln("Resuming ", String(rec.path) + " after line " + String(rec.file_line));
+
+        uint8_t client = (espresponse) ? espresponse->client() : CLIENT_ALL;
+        auto    n_axis = number_axis->get();
+        char    lines[12][80];
+        int     n_line = 0;
+        strcpy(lines[n_line++], "M5 M9 G21 G90 G94");
+        int len = sprintf(lines[n_line], "G53 G0");
+        for (uint8_t axis = 0; axis < n_axis; axis++) {
+            if (axis != Z_AXIS) {
+                len += sprintf(lines[n_line] + len, " %c%.3f", report_get_axis_letter(axis), rec.position[axis]);
+            }
+        }
+        n_line++;
+        if (n_axis > Z_AXIS) {
+            sprintf(lines[n_line++], "G53 G0 Z%.3f", rec.position[Z_AXIS]);
+        }
+        if (rec.coord_select < CoordIndex::NWCSystems) {
+            sprintf(lines[n_line++], "G%d", 54 + rec.coord_select);
+        }
+        if (rec.feed_rate > 0.0f) {
+            sprintf(lines[n_line++], "F%.3f", rec.feed_rate);  // Still in G21, so mm/min as saved
+        }
+        sprintf(lines[n_line++], "G%d G%d G%d", rec.units ? 20 : 21, rec.distance ? 91 : 90, rec.feed_mode ? 93 : 94);
+        if (rec.spindle == static_cast<uint8_t>(SpindleState::Cw) || rec.spindle == static_cast<uint8_t>(SpindleState::Ccw)) {
+            sprintf(lines[n_line++], "M%d S%.0f", rec.spindle == static_cast<uint8_t>(SpindleState::Cw) ? 3 : 4, rec.spindle_speed);
+        }
+        if (rec.coolant_mist) {
+            strcpy(lines[n_line++], "M7");
+        }
+        if (rec.coolant_flood) {
+            strcpy(lines[n_line++], "M8");
+        }
+        if (rec.motion <= static_cast<uint8_t>(Motion::CcwArc)) {
+            sprintf(lines[n_line++], "G%d", rec.motion);
+        }
+
+        for (int i = 0; i < n_line; i++) {
+            Error err = execute_line(lines[i], client, auth_level);
+            if (err != Error::Ok) {
+                webPrintln("Failed: ", lines[i]);
+                return err;
+            }
+            if (i == 0) {
+                // Before the moves, which plan in machine coordinates and do not depend on it
+                memcpy(gc_state.coord_offset, rec.coord_offset, sizeof(gc_state.coord_offset));
+                gc_update_wco();
+                system_flag_wco_change();
+            }
+        }
+
+        Error err;
+        if ((err = openSDFile(rec.path)) != Error::Ok) {
+            return err;
+        }
+        if (!setFilePos(rec.file_pos)) {
+            closeFile();
+            webPrintln("Seek failed");
+            return Error::FsFailedRead;
+        }
+        sd_preparse_enable();
+        sd_set_current_line_number(rec.file_line);
+        sd_block_t fileBlock;
+        if (!readFileBlock(&fileBlock)) {
+            mks_powerless_job_end();  // The job had already run to its end
+            closeFile();
+            webPrintln("");
+            return Error::Ok;
+        }
+        SD_client     = client;
+        SD_auth_level = auth_level;
+        report_status_message(sd_execute_block(&fileBlock, SD_client, SD_auth_level), SD_client);
+        mks_powerless_line_done();
         report_realtime_status(SD_client);
         webPrintln("");
         return Error::Ok;
@@ -764,6 +1095,7 @@ namespace WebUI {
         if (parameter[0] != '/') {
             path = "/" + path;
         }
+        sd_index_invalidate();
         File file2del = SD.open(path);
         if (!file2del) {
             webPrintln("Cannot stat file!");
@@ -806,7 +1138,6 @@ namespace WebUI {
         ssd += " Total:" + ESPResponseStream::formatBytes(SD.totalBytes());
         ssd += "]";
         webPrintln(ssd);
-        SD.end();
         return Error::Ok;
     }
 #endif
@@ -839,10 +1170,10 @@ namespace WebUI {
 
     static Error listLocalFiles(char* parameter, AuthenticationLevel auth_level) {  // No ESP command
         webPrintln("");
-        listDirLocalFS(SPIFFS, "/", 10, espresponse->client());
-        String ssd = "[Local FS Free:" + ESPResponseStream::formatBytes(SPIFFS.totalBytes() - SPIFFS.usedBytes());
-        ssd += " Used:" + ESPResponseStream::formatBytes(SPIFFS.usedBytes());
-        ssd += " Total:" + ESPResponseStream::formatBytes(SPIFFS.totalBytes());
+        listDirLocalFS(localfs(), "/", 10, espresponse->client());
+        String ssd = "[Local FS Free:" + ESPResponseStream::formatBytes(localfs_total_bytes() - localfs_used_bytes());
+        ssd += " Used:" + ESPResponseStream::formatBytes(localfs_used_bytes());
+        ssd += " Total:" + ESPResponseStream::formatBytes(localfs_total_bytes());
         ssd += "]";
         webPrintln(ssd);
         return Error::Ok;
@@ -869,15 +1200,15 @@ namespace WebUI {
     }
 
     static Error listLocalFilesJSON(char* parameter, AuthenticationLevel auth_level) {  // No ESP command
-        JSONencoder j(espresponse->client() != CLIENT_WEBUI);
+        JSONencoder j(espresponse->client() != CLIENT_WEBUI, espresponse);
         j.begin();
         j.begin_array("files");
-        listDirJSON(SPIFFS, "/", 4, &j);
+        listDirJSON(localfs(), "/", 4, &j);
         j.end_array();
-        j.member("total", SPIFFS.totalBytes());
-        j.member("used", SPIFFS.usedBytes());
-        j.member("occupation", String(100 * SPIFFS.usedBytes() / SPIFFS.totalBytes()));
-        webPrint(j.end());
+        j.member("total", localfs_total_bytes());
+        j.member("used", localfs_used_bytes());
+        j.member("occupation", String(100 * localfs_used_bytes() / localfs_total_bytes()));
+        j.end();
         if (espresponse->client() != CLIENT_WEBUI) {
             webPrintln("");
         }
@@ -991,12 +1322,13 @@ namespace WebUI {
             webPrintln(" MSK:", wifi_sta_netmask->getStringValue());
             return Error::Ok;
         }
-        if (!split_params(parameter)) {
+        param_t params[] = { { "GW" }, { "MSK" }, { "IP" } };
+        if (!get_params(parameter, params, 3)) {
             return Error::InvalidValue;
         }
-        char* gateway = get_param("GW", false);
-        char* netmask = get_param("MSK", false);
-        char* ip      = get_param("IP", false);
+        char* gateway = params[0].value;
+        char* netmask = params[1].value;
+        char* ip      = params[2].value;
 
         Error err = wifi_sta_ip->setStringValue(ip);
         if (err == Error::Ok) {
@@ -1086,6 +1418,14 @@ namespace WebUI {
 #ifdef ENABLE_SD_CARD
         new WebCommand("path", WEBCMD, WU, "ESP221", "SD/Show", showSDFile);
         new WebCommand("path", WEBCMD, WU, "ESP220", "SD/Run", runSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Compile", compileSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Queue", queueSDFile, anyState);
+        new WebCommand(NULL, WEBCMD, WU, NULL, "SD/Queue/Clear", clearSDQueue, anyState);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Info", showSDJobInfo);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Check", checkSDFile);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Bench", benchSDCard);
+        new WebCommand("path", WEBCMD, WU, NULL, "SD/Simulate", simulateSDFile);
+        new WebCommand(NULL, WEBCMD, WU, NULL, "SD/Resume", resumeSDFile);
         new WebCommand("file_or_directory_path", WEBCMD, WU, "ESP215", "SD/Delete", deleteSDObject);
         new WebCommand(NULL, WEBCMD, WU, "ESP210", "SD/List", listSDFiles);
 #endif
@@ -1165,12 +1505,16 @@ namespace WebUI {
 #endif
 
 #ifdef ENABLE_WIFI
+        wifi_power_save = new EnumSetting(
+            "WiFi power save", WEBSET, WA, NULL, "WiFi/PowerSave", DEFAULT_WIFI_POWER_SAVE, &powerSaveOptions, NULL);
         telnet_port = new IntSetting(
             "Telnet Port", WEBSET, WA, "ESP131", "Telnet/Port", DEFAULT_TELNETSERVER_PORT, MIN_TELNET_PORT, MAX_TELNET_PORT, NULL);
         telnet_enable = new EnumSetting("Telnet Enable", WEBSET, WA, "ESP130", "Telnet/Enable", DEFAULT_TELNET_STATE, &onoffOptions, NULL);
+        telnet_output = new EnumSetting("Telnet output", WEBSET, WA, NULL, "Telnet/Output", DEFAULT_TELNET_OUTPUT, &outputOptions, NULL);
         http_port =
             new IntSetting("HTTP Port", WEBSET, WA, "ESP121", "Http/Port", DEFAULT_WEBSERVER_PORT, MIN_HTTP_PORT, MAX_HTTP_PORT, NULL);
         http_enable   = new EnumSetting("HTTP Enable", WEBSET, WA, "ESP120", "Http/Enable", DEFAULT_HTTP_STATE, &onoffOptions, NULL);
+        http_output   = new EnumSetting("WebSocket output", WEBSET, WA, NULL, "Http/Output", DEFAULT_HTTP_OUTPUT, &httpOutputOptions, NULL);
         wifi_hostname = new StringSetting("Hostname",
                                           WEBSET,
                                           WA,
@@ -42,6 +42,9 @@ namespace WebUI {
     extern IntSetting*    http_port;
     extern EnumSetting*   telnet_enable;
     extern IntSetting*    telnet_port;
+    extern EnumSetting*   wifi_power_save;
+    extern EnumSetting*   telnet_output;
+    extern EnumSetting*   http_output;
 #endif
 
 #ifdef WIFI_OR_BLUETOOTH
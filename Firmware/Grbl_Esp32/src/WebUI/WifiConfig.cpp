@@ -236,12 +236,14 @@ namespace WebUI {
 
 
 #define WIFI_COUNT              40
+#define WIFI_CACHED_COUNT       10  // Tries on the last access point before scanning
 #define WIFI_DELAY_WAIT         500
+#define WIFI_LAST_AP_KEY        "WiFi/LastAP"
 
-    bool WiFiConfig::mks_ConnectSTA2AP() {
+    bool WiFiConfig::mks_ConnectSTA2AP(uint8_t tries) {
         uint8_t     count  = 0;
         wl_status_t status = WiFi.status();
-        while (status != WL_CONNECTED && count < 40) {
+        while (status != WL_CONNECTED && count < tries) {
             switch (status) {
                 case WL_NO_SSID_AVAIL:
                     return status == WL_CONNECTED;
@@ -269,12 +271,12 @@ namespace WebUI {
      * Connect client to AP
      */
     
-    bool WiFiConfig::ConnectSTA2AP() {
+    bool WiFiConfig::ConnectSTA2AP(uint8_t tries) {
         String      msg, msg_out;
         uint8_t     count  = 0;
         uint8_t     dot    = 0;
         wl_status_t status = WiFi.status();
-        while (status != WL_CONNECTED && count < WIFI_COUNT) {
+        while (status != WL_CONNECTED && count < tries) {
             switch (status) {
                 case WL_NO_SSID_AVAIL:
                     msg = "No SSID";
@@ -302,6 +304,56 @@ namespace WebUI {
         return status == WL_CONNECTED;
     }
 
+    bool WiFiConfig::load_last_ap(const char* ssid, last_ap_t* ap) {
+        size_t len = sizeof(*ap);
+        if (nvs_get_blob(Setting::_handle, WIFI_LAST_AP_KEY, ap, &len) != ESP_OK || len != sizeof(*ap)) {
+            return false;
+        }
+        ap->ssid[MAX_SSID_LENGTH] = '\0';
+        return strcmp(ap->ssid, ssid) == 0 && ap->channel >= MIN_CHANNEL && ap->channel <= MAX_CHANNEL;
+    }
+
+    // Written only when the access point changed, so a normal boot does not wear the flash
+    void WiFiConfig::save_last_ap(const char* ssid) {
+        last_ap_t ap = {};
+        strncpy(ap.ssid, ssid, MAX_SSID_LENGTH);
+        memcpy(ap.bssid, WiFi.BSSID(), sizeof(ap.bssid));
+        ap.channel = WiFi.channel();
+        last_ap_t old;
+        size_t    len = sizeof(old);
+        if (nvs_get_blob(Setting::_handle, WIFI_LAST_AP_KEY, &old, &len) == ESP_OK && len == sizeof(old) &&
+            memcmp(&old, &ap, sizeof(ap)) == 0) {
+            return;
+        }
+        nvs_set_blob(Setting::_handle, WIFI_LAST_AP_KEY, &ap, sizeof(ap));
+        nvs_commit(Setting::_handle);
+    }
+
+    /*
+     * Joins the access point last connected to directly, by its BSSID and channel, and falls
+     * back to scanning for the SSID when that does not connect within WIFI_CACHED_COUNT tries.
+     * A static IP from $Sta/IPMode, set before this, also skips DHCP.
+     */
+    bool WiFiConfig::BeginSTA(const char* ssid, const char* password, bool verbose) {
+        last_ap_t ap;
+        if (load_last_ap(ssid, &ap)) {
+            if (WiFi.begin(ssid, password, ap.channel, ap.bssid) &&
+                (verbose ? ConnectSTA2AP(WIFI_CACHED_COUNT) : mks_ConnectSTA2AP(WIFI_CACHED_COUNT))) {
+                return true;
+            }
+            WiFi.disconnect();
+        }
+        if (!WiFi.begin(ssid, password)) {
+            grbl_send(CLIENT_ALL, "[MSG:Starting client failed]\r\n");
+            return false;
+        }
+        if (!(verbose ? ConnectSTA2AP(WIFI_COUNT) : mks_ConnectSTA2AP(WIFI_COUNT))) {
+            return false;
+        }
+        save_last_ap(ssid);
+        return true;
+    }
+
     /*
      * Start client mode (Station)
      */
@@ -337,16 +389,11 @@ namespace WebUI {
             IPAddress ip(IP), mask(MK), gateway(GW);
             WiFi.config(ip, gateway, mask);
         }
-        if (WiFi.begin(SSID.c_str(), (password.length() > 0) ? password.c_str() : NULL)) {
-            grbl_send(CLIENT_ALL, "\n[MSG:Client Started]\r\n");
-            grbl_sendf(CLIENT_ALL, "[MSG:Connecting %s]\r\n", SSID.c_str());
-            memset(mks_wifi.wifi_name_connect, 0, sizeof(mks_wifi.wifi_name_connect));
-            memcpy(mks_wifi.wifi_name_connect, SSID.c_str(), sizeof(mks_wifi.wifi_name_connect));
-            return ConnectSTA2AP();
-        } else {
-            grbl_send(CLIENT_ALL, "[MSG:Starting client failed]\r\n");
-            return false;
-        }
+        grbl_send(CLIENT_ALL, "\n[MSG:Client Started]\r\n");
+        grbl_sendf(CLIENT_ALL, "[MSG:Connecting %s]\r\n", SSID.c_str());
+        memset(mks_wifi.wifi_name_connect, 0, sizeof(mks_wifi.wifi_name_connect));
+        strncpy(mks_wifi.wifi_name_connect, SSID.c_str(), sizeof(mks_wifi.wifi_name_connect) - 1);
+        return BeginSTA(SSID.c_str(), (password.length() > 0) ? password.c_str() : NULL, true);
     }
 
 
@@ -382,12 +429,7 @@ namespace WebUI {
             IPAddress ip(IP), mask(MK), gateway(GW);
             WiFi.config(ip, gateway, mask);
         }
-        if (WiFi.begin(SSID.c_str(), (password.length() > 0) ? password.c_str() : NULL)) {
-            return mks_ConnectSTA2AP();
-        } else {
-            grbl_send(CLIENT_ALL, "[MSG:Starting client failed]\r\n");
-            return false;
-        }
+        return BeginSTA(SSID.c_str(), (password.length() > 0) ? password.c_str() : NULL, false);
     }
 
 
@@ -551,9 +593,47 @@ namespace WebUI {
     /**
      * Handle not critical actions that must be done in sync environement
      */
+    // Modem sleep holds incoming packets until the next beacon, which is what makes the WebUI
+    // and streaming senders stutter during a job. With WiFi/PowerSave IDLE, it is only used while
+    // the machine is idle. Polled, because the WiFi library sets it again on each connection.
+    void WiFiConfig::update_power_save() {
+        if (WiFi.getMode() == WIFI_OFF) {
+            return;
+        }
+        bool busy = false;
+        switch (sys.state) {
+            case State::Cycle:
+            case State::Hold:
+            case State::Jog:
+            case State::Homing:
+            case State::SafetyDoor:
+                busy = true;
+                break;
+            default:
+                break;
+        }
+#    ifdef ENABLE_SD_CARD
+        busy = busy || get_sd_state(false) == SDState::BusyPrinting;
+#    endif
+        wifi_ps_type_t wanted = WIFI_PS_MIN_MODEM;
+        switch (wifi_power_save->get()) {
+            case POWER_SAVE_OFF:
+                wanted = WIFI_PS_NONE;
+                break;
+            case POWER_SAVE_IDLE:
+                wanted = busy ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM;
+                break;
+        }
+        wifi_ps_type_t current;
+        if (esp_wifi_get_ps(&current) == ESP_OK && current != wanted) {
+            esp_wifi_set_ps(wanted);
+        }
+    }
+
     void WiFiConfig::handle() {
         //Services
         COMMANDS::wait(0);
+        update_power_save();
         wifi_services.handle();
     }
 
@@ -39,6 +39,19 @@ namespace WebUI {
     static const int ESP_SAVE_ONLY = 0;
     static const int ESP_APPLY_NOW = 1;
 
+    //WiFi/PowerSave, modem sleep between beacons saves power but delays incoming packets
+    static const int POWER_SAVE_OFF  = 0;  // Never
+    static const int POWER_SAVE_IDLE = 1;  // Only while no job is running
+    static const int POWER_SAVE_ON   = 2;  // Always, the ESP32 default
+
+    //Telnet/Output and Http/Output, how the output to a client is packed into TCP segments
+    static const int OUTPUT_LOW_LATENCY = 0;  // No Nagle delay; each line goes as soon as it is written
+    static const int OUTPUT_BULK        = 1;  // Held until about a packet is full or OUTPUT_BULK_MS passed
+    static const int OUTPUT_BULK_MS     = 5;
+    // Http/Output only: replies go at once, other output is held until it pauses or fills a
+    // window sized to the round trip of the slowest client, see Serial2Socket.h
+    static const int OUTPUT_ADAPTIVE = 2;
+
     //defaults values
     static const char* DEFAULT_HOSTNAME = "grblesp";
 #ifdef CONNECT_TO_SSID
@@ -64,6 +77,9 @@ namespace WebUI {
     static const char* HIDDEN_PASSWORD           = "********";
     static const char* DEFAULT_TOKEN             = "";
     static const int   DEFAULT_NOTIFICATION_TYPE = 0;
+    static const int   DEFAULT_WIFI_POWER_SAVE   = POWER_SAVE_IDLE;
+    static const int   DEFAULT_TELNET_OUTPUT     = OUTPUT_LOW_LATENCY;
+    static const int   DEFAULT_HTTP_OUTPUT       = OUTPUT_ADAPTIVE;
 
     //boundaries
     static const int MAX_SSID_LENGTH     = 32;
@@ -109,13 +125,25 @@ namespace WebUI {
 
         static void        mks_setup();
         static bool        mks_StartSTA();
-        static bool        mks_ConnectSTA2AP();
+        static bool        mks_ConnectSTA2AP(uint8_t tries);
 
         ~WiFiConfig();
 
     private:
-        static bool   ConnectSTA2AP();
+        // The access point the station last joined, kept in NVS so that a restart can join it
+        // directly on its channel instead of scanning every channel for the SSID first
+        typedef struct {
+            char    ssid[MAX_SSID_LENGTH + 1];
+            uint8_t bssid[6];
+            uint8_t channel;
+        } last_ap_t;
+
+        static bool   ConnectSTA2AP(uint8_t tries);
+        static bool   BeginSTA(const char* ssid, const char* password, bool verbose);
+        static bool   load_last_ap(const char* ssid, last_ap_t* ap);
+        static void   save_last_ap(const char* ssid);
         static void   WiFiEvent(WiFiEvent_t event);
+        static void   update_power_save();
         static String _hostname;
         static bool   _events_registered;
     };
@@ -24,7 +24,7 @@
 
 #    include <WiFi.h>
 #    include <FS.h>
-#    include <SPIFFS.h>
+#    include "LocalFS.h"
 #    include "WifiServices.h"
 #    ifdef ENABLE_MDNS
 #        include <ESPmDNS.h>
@@ -57,8 +57,8 @@ namespace WebUI {
         }
         String h = wifi_hostname->get();
 
-        //Start SPIFFS
-        SPIFFS.begin(true);
+        //Start the local FS
+        localfs_begin();
 #    ifdef ENABLE_OTA
         ArduinoOTA
             .onStart([]() {
@@ -66,9 +66,9 @@ namespace WebUI {
                 if (ArduinoOTA.getCommand() == U_FLASH) {
                     type = "sketch";
                 } else {  // U_SPIFFS
-                    // NOTE: if updating SPIFFS this would be the place to unmount SPIFFS using SPIFFS.end()
+                    // NOTE: if updating the local FS this would be the place to unmount it
                     type = "filesystem";
-                    SPIFFS.end();
+                    localfs_end();
                 }
                 grbl_sendf(CLIENT_ALL, "[MSG:Start OTA updating %s]\r\n", type.c_str());
             })
@@ -137,8 +137,8 @@ namespace WebUI {
 #    ifdef ENABLE_OTA
         ArduinoOTA.end();
 #    endif
-        //Stop SPIFFS
-        SPIFFS.end();
+        //Stop the local FS
+        localfs_end();
 #    ifdef ENABLE_MDNS
         //Stop mDNS
         MDNS.end();
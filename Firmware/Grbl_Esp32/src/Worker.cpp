@@ -0,0 +1,110 @@
+/*
+  Worker.cpp - Background file work off the motion core
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+const int      WORKER_STACK_SIZE = 8192;  // The preview and the framing scan ran in this much
+const int      WORKER_PRIORITY   = 1;     // Below the display, so it keeps drawing during a scan
+
+typedef struct {
+    const char* name;
+    worker_fn_t fn;
+    void*       arg;
+    uint32_t    gen;  // cancel_gen when it was submitted
+} worker_item_t;
+
+static QueueHandle_t        worker_queue;
+static TaskHandle_t         worker_task_handle;
+static volatile uint32_t    cancel_gen;  // Bumped by worker_cancel()
+static uint32_t             item_gen;    // Of the running item
+static const char* volatile item_name;
+static volatile int8_t      item_percent;
+static uint32_t             slice_start;
+
+static void workerTask(void* pvParameters) {
+    heap_track_task();
+    worker_item_t item;
+    while (true) {
+        xQueueReceive(worker_queue, &item, portMAX_DELAY);
+        item_gen     = item.gen;
+        item_percent = -1;
+        item_name    = item.name;
+        slice_start  = millis();
+        item.fn(item.arg);
+        item_name = NULL;
+    }
+}
+
+void worker_init() {
+    if (worker_task_handle) {
+        return;
+    }
+    worker_queue = xQueueCreate(WORKER_QUEUE_LENGTH, sizeof(worker_item_t));
+    xTaskCreatePinnedToCore(workerTask,  // task
+                            "workerTask",
+                            WORKER_STACK_SIZE,
+                            NULL,
+                            WORKER_PRIORITY,
+                            &worker_task_handle,
+                            WORKER_TASK_CORE);
+}
+
+bool worker_submit(const char* name, worker_fn_t fn, void* arg) {
+    if (!worker_queue) {
+        return false;
+    }
+    worker_item_t item = { name, fn, arg, cancel_gen };
+    return xQueueSend(worker_queue, &item, 0) == pdTRUE;
+}
+
+void worker_cancel() {
+    if (!worker_queue) {
+        return;
+    }
+    cancel_gen++;
+    xQueueReset(worker_queue);
+}
+
+bool worker_cancelled() {
+    return item_gen != cancel_gen;
+}
+
+bool worker_yield(uint32_t pos, uint32_t size) {
+    item_percent = size ? (uint64_t)pos * 100 / size : 100;
+    if (millis() - slice_start >= WORKER_SLICE_MS) {
+        vTaskDelay(1);
+        slice_start = millis();
+    }
+    while (sd_reader_wants_card() && !worker_cancelled()) {
+        vTaskDelay(1);  // The job's read-ahead comes first
+        slice_start = millis();
+    }
+    return !worker_cancelled();
+}
+
+const char* worker_current() {
+    return item_name;
+}
+
+int8_t worker_percent() {
+    return item_name ? item_percent : -1;
+}
+
+uint8_t worker_queued() {
+    return worker_queue ? uxQueueMessagesWaiting(worker_queue) : 0;
+}
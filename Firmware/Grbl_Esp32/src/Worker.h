@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+  Worker.h - Background file work off the motion core
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+// One low priority task on WORKER_TASK_CORE runs the long reads of job files that are not the
+// job itself, such as the file preview and the framing scan, one item at a time in the order
+// they were submitted. An item yields by calling worker_yield() between blocks of its work,
+// which also records its progress for $Worker and the display, stands back while the job's
+// read-ahead queue is filling, so the running job always has the card first, and tells the
+// item to stop once it was cancelled.
+//
+// The file check of Validate.h is not an item: it runs the parser, whose state is global, so
+// it stays in the main loop between the lines of the job.
+const int      WORKER_QUEUE_LENGTH = 4;
+const uint32_t WORKER_SLICE_MS     = 20;  // Longest run between yields
+
+typedef void (*worker_fn_t)(void* arg);
+
+void worker_init();
+
+// From any task. Queues fn behind what is already queued; false when the queue is full.
+// name is shown while it runs, so it must outlive the item.
+bool worker_submit(const char* name, worker_fn_t fn, void* arg = NULL);
+
+// Drops the queued items and has worker_yield() of the running one return false
+void worker_cancel();
+
+// From the running item. Reports pos of size as its progress, gives up the CPU at least every
+// WORKER_SLICE_MS and waits while the job wants the card. False once the item is cancelled.
+// Has the sd_progress_t signature, so a scan can take it as its progress callback.
+bool worker_yield(uint32_t pos, uint32_t size);
+bool worker_cancelled();
+
+// The running item, NULL while idle, and its progress, -1 before its first worker_yield()
+const char* worker_current();
+int8_t      worker_percent();
+uint8_t     worker_queued();
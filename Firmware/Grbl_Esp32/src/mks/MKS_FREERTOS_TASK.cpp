@@ -2,51 +2,51 @@
 
 #define DISP_TASK_STACK                 4096*2
 #define DISP_TASK_PRO                   2
-#define DISP_TASK_CORE                  1
+// Defaults to UI_TASK_CORE from the task layout in Config.h
+#ifndef DISPLAY_TASK_CORE
+#define DISPLAY_TASK_CORE               UI_TASK_CORE
+#endif
 
-#define FRAME_TASK_STACK                4096*2
-#define FRAME_TASK_PRO                  3          // 尝试巡边的线程与lvgl线程同优先级
-#define FRAME_TASK_CORE                 1
+#define LOGO_TICK_MS                    5
+#define LOGO_BACKLIGHT_MS               500     // Backlight on once the logo is drawn, and the shortest showing
 
 TaskHandle_t lv_disp_tcb = NULL;
-TaskHandle_t frame_task_tcb = NULL;
-
-#define USE_DelayUntil
 
 static void mks_page_data_updata(void);
+static bool mks_headless_updata(void);
+static uint32_t mks_lv_idle_ms(void);
 
-IRAM_ATTR void lvgl_disp_task(void *parg) { 
-
-#if defined(USE_DelayUntil)
-    TickType_t       xLastWakeTime;
-    const TickType_t xDisplayFrequency = 5;                  
-    xLastWakeTime = xTaskGetTickCount();   
-#endif
+void lvgl_disp_task(void *parg) { 
 
     bool logo_flag = true;   
     uint16_t logo_flag_count = 0; 
+    uint32_t mem_sample_ms = 0;
+    boot_phase_begin(BootPhase::UI);
     mks_lvgl_init();
 
     mks_global_style_init();
 
     mks_draw_logo();
+    boot_phase_end(BootPhase::UI);
+    boot_phase_begin(BootPhase::Logo);
 
-    // 创建二值量
-    is_fram_need = xSemaphoreCreateBinary();
-    frame_task_init();
+    frame_msg_queue = xQueueCreate(1, sizeof(FRAME_MSG_T));
     mks_grbl.wifi_connect_enable = true;
 
+    heap_track_task();
     while(1) {
 
         if(logo_flag == true) {
             lv_task_handler();
-            logo_flag_count++;
-
-            if(logo_flag_count == 100) {
-                 LCD_BLK_ON;
+            if(logo_flag_count < LOGO_BACKLIGHT_MS / LOGO_TICK_MS) {
+                logo_flag_count++;
+                if(logo_flag_count == LOGO_BACKLIGHT_MS / LOGO_TICK_MS) {
+                     LCD_BLK_ON;
+                }
             }
 
-            if(logo_flag_count == 400) {
+            // The page after the logo depends on the SD card check
+            if((logo_flag_count == LOGO_BACKLIGHT_MS / LOGO_TICK_MS) && boot_is_ready()) {
                 mks_lv_clean_ui();
 
                 if(mks_updata.updata_flag == UD_HAD_FILE) {
@@ -59,70 +59,216 @@ IRAM_ATTR void lvgl_disp_task(void *parg) {
                     }
                 }
                 logo_flag = false;
+                boot_phase_end(BootPhase::Logo);
             }
+            vTaskDelay(pdMS_TO_TICKS(LOGO_TICK_MS));
         }else {
+            if(mks_headless_updata() == false) {
+                mks_page_data_updata();
+            }else if(mks_ui_page.mks_ui_page == MKS_UI_Pring) {
+                mks_print_path_updata();    // 轨迹在后面继续画
+            }
+            mks_disp_bench_poll();
+            int64_t handler_start = esp_timer_get_time();
             lv_task_handler();
-            mks_page_data_updata();
+            mks_disp_stats.handler_us += esp_timer_get_time() - handler_start;
+            if((millis() - mem_sample_ms) >= 1000) {
+                mem_sample_ms = millis();
+                mks_lv_mem_sample();
+            }
+            // Sleep until LVGL has work again, which is soon if a page update invalidated a label
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(mks_lv_idle_ms()));
+        }
+    }
+}
+
+// Time until lv_task_handler() has something to do. The refresh and animation tasks run every
+// LV_DISP_DEF_REFR_PERIOD, but only do anything while an area is invalid or an animation runs.
+// Otherwise the touch read task, every LV_INDEV_DEF_READ_PERIOD, sets the pace.
+static uint32_t mks_lv_idle_ms(void) {
+    lv_disp_t* disp = lv_disp_get_default();
+    if ((disp->inv_p != 0) || (lv_anim_count_running() != 0)) {
+        return LV_DISP_DEF_REFR_PERIOD;
+    }
+    return LV_INDEV_DEF_READ_PERIOD;
+}
+
+// $UI/HeadlessJob replaces the page by a plain progress screen, refreshed once a second, while
+// the machine is in cycle. The page stays as it was underneath, and comes back when the cycle
+// ends or the screen is tapped, which leaves it off until the job is over.
+#define HEADLESS_UPDATA_MS              1000
+
+static lv_obj_t* headless_scr = NULL;
+static lv_obj_t* headless_label;
+static uint32_t  headless_time;
+static bool      headless_dismissed = false;
+
+static void event_headless_tap(lv_obj_t* obj, lv_event_t event) {
+    if (event == LV_EVENT_RELEASED) {
+        headless_dismissed = true;
+    }
+}
+
+static bool mks_headless_updata(void) {
+    if ((sys.state == State::Idle) || (sys.state == State::Alarm)) {
+        headless_dismissed = false;  // Job over
+    }
+    if (!ui_headless_job->get() || (sys.state != State::Cycle) || headless_dismissed) {
+        if (headless_scr != NULL) {
+            lv_obj_del(headless_scr);
+            headless_scr = NULL;
         }
+        return false;
+    }
+    if (headless_scr == NULL) {
+        headless_scr = lv_obj_create(lv_layer_top(), NULL);
+        lv_obj_set_size(headless_scr, LV_HOR_RES_MAX, LV_VER_RES_MAX);
+        lv_obj_set_style(headless_scr, &lv_style_scr);
+        lv_obj_set_click(headless_scr, true);
+        lv_obj_set_event_cb(headless_scr, event_headless_tap);
+        headless_label = lv_label_create(headless_scr, NULL);
+        headless_time  = millis() - HEADLESS_UPDATA_MS;
+    }
+    if ((millis() - headless_time) >= HEADLESS_UPDATA_MS) {
+        char text[32];
+        headless_time = millis();
+        snprintf(text, sizeof(text), "Running  %d%%", (uint16_t)sd_report_perc_complete());
+        if (strcmp(lv_label_get_text(headless_label), text) != 0) {
+            lv_label_set_text(headless_label, text);
+            lv_obj_align(headless_label, NULL, LV_ALIGN_CENTER, 0, 0);
+        }
+    }
+    return true;
+}
 
-#if defined(USE_DelayUntil)
-    vTaskDelayUntil(&xLastWakeTime, xDisplayFrequency); //使用相对延时，保证时间精准
-#else
-        vTaskDelay(5); // 5ms 绝对延时
-#endif   
+// What the page labels show. Pages are updated when this changes, not on every tick.
+typedef struct {
+    State    state;
+    int32_t  mpos[3];  // 0.1mm, the display resolution
+    int32_t  wpos[3];
+    Percent  f_override;
+    Percent  r_override;
+    Percent  s_override;
+    uint16_t sd_percent;
+} ui_snapshot_t;
+
+static bool mks_ui_changed(void) {
+    static ui_snapshot_t last;
+    ui_snapshot_t now;
+    memset(&now, 0, sizeof(now));  // Padding too, for memcmp
+    float* position = system_get_mpos();
+    for (int i = 0; i < 3; i++) {
+        now.mpos[i] = lroundf(position[i] * 10.0f);
+    }
+    mpos_to_wpos(position);
+    for (int i = 0; i < 3; i++) {
+        now.wpos[i] = lroundf(position[i] * 10.0f);
     }
+    now.state      = sys.state;
+    now.f_override = sys_rt_f_override;
+    now.r_override = sys_rt_r_override;
+    now.s_override = sys_rt_s_override;
+    now.sd_percent = (uint16_t)sd_report_perc_complete();
+    if (memcmp(&now, &last, sizeof(now)) == 0) {
+        return false;
+    }
+    last = now;
+    return true;
 }
 
-uint8_t count_updata = 0;
 uint8_t fram_count = 0;
+static uint32_t updata_time = 0;    // millis() of the last timed update of the page
+static mks_ui_page_t updata_page;     // Page shown at the last update
+
+static bool ui_pending = true;       // Displayed values changed since the last update
+
+static bool mks_updata_due(uint32_t period_ms) {
+    return (millis() - updata_time) >= period_ms;
+}
+
+// The DRO fields on pages whose other checks keep their own 100ms pace
+static uint32_t dro_time = 0;
+
+static bool mks_dro_due(void) {
+    if ((millis() - dro_time) < MKS_DRO_UPDATA_MS) {
+        return false;
+    }
+    dro_time = millis();
+    return true;
+}
+
+static void mks_updata_done(void) {
+    updata_time = millis();
+    ui_pending  = false;
+}
+
 static void mks_page_data_updata(void) { 
+
+    ui_pending = mks_ui_changed() || ui_pending;
+    if (mks_ui_page.mks_ui_page != updata_page) {  // A new page starts with fresh data
+        updata_page = mks_ui_page.mks_ui_page;
+        updata_time = 0;
+        ui_pending  = true;
+    }
+    bool changed = ui_pending;
     
     if(mks_ui_page.mks_ui_page == MKS_UI_PAGE_LOADING) {
         /* Do not updata */
         return ;
     }
     else if(mks_ui_page.mks_ui_page == MKS_UI_TEST) {
-        if((count_updata == 200) || (count_updata > 200) ) { 
+        if(mks_updata_due(100)) { 
             draw_testing();
+            mks_updata_done();
         }
     }
     else if (mks_ui_page.mks_ui_page == MKS_UI_Ready) {  //只有在当前页面才更新数据
 
-        if((count_updata == 20) || (count_updata > 20) ) {        // 20*5=100ms
+        // Positions when they change, at most every MKS_DRO_UPDATA_MS; the WiFi status every second
+        if((changed && mks_updata_due(MKS_DRO_UPDATA_MS)) || mks_updata_due(1000)) {
             if(SD_ready_next == false) ready_data_updata();
-            count_updata = 0;
+            mks_updata_done();
         }
     }
     else if(mks_ui_page.mks_ui_page == MKS_UI_Pring) { // 雕刻界面更新数据
 
-        if((count_updata == 200) || (count_updata > 200) ) { // 200*5=1000ms = 1s
+        mks_print_path_updata();
+        if((changed && mks_updata_due(100)) || mks_updata_due(1000)) {
 
             if(SD_ready_next == false) {
                 mks_print_data_updata();
             } 
-            count_updata = 0;
+            mks_updata_done();
         }
     }
     else if(mks_ui_page.mks_ui_page == MKS_UI_inFile) { // 雕刻界面更新数据
 
-        if((count_updata == 200) || (count_updata > 200) ) { // 200*5=1000ms = 1s
+        infile_preview_updata();
+        if(mks_updata_due(1000)) {
             move_pos_update();
             probe_check();
+            mks_updata_done();
         }
     }
     else if(mks_ui_page.mks_ui_page == MKS_UI_Control) {  //控制界面
 
-        if((count_updata == 20) || (count_updata > 20) ) { // 20*5=100ms = 1s
+        if(changed && mks_dro_due()) {
+            move_pos_update();
+            ui_pending = false;
+        }
+        if(mks_updata_due(100)) {
             hard_home_check();
             soft_home_check();
-            move_pos_update();
+            if(changed) move_pos_update();
             probe_check();
-            count_updata = 0;
+            mks_updata_done();
         }
     }
     else if(mks_ui_page.mks_ui_page == MKS_UI_Frame) { 
         
-        if((count_updata == 100) || (count_updata > 100) ) { // 100*5=100ms = 1s
+        mks_frame_msg_updata();
+        if(mks_updata_due(100)) {       // Done once the frame status holds for 10 checks
+            mks_updata_done();
             if(frame_ctrl.is_begin_run == true) {
                     if(mks_get_frame_status() == true) {
 
@@ -172,7 +318,6 @@ static void mks_page_data_updata(void) {
                 mks_draw_wifi();
             }
         }
-        count_updata = 0;
     }
 #endif
     else if(mks_ui_page.mks_ui_page == MKS_UI_UPDATA) {
@@ -191,11 +336,10 @@ static void mks_page_data_updata(void) {
             mks_updata.updata_flag = UD_NONE;
         }
     }
-    count_updata++;
 }
 
 // // tskNO_AFFINIT 
-IRAM_ATTR void disp_task_init(void) {
+void disp_task_init(void) {
 
     xTaskCreatePinnedToCore(lvgl_disp_task,     // task
                             "lvglTask",         // name for task
@@ -204,47 +348,11 @@ IRAM_ATTR void disp_task_init(void) {
                             DISP_TASK_PRO,      // priority
                             // nullptr,
                             &lv_disp_tcb,
-                            DISP_TASK_CORE      // must run the task on same core
+                            DISPLAY_TASK_CORE   // must run the task on same core
                                                 // core
     );
 }
 
-/*-------------------------------------------------------------------------------------------------*/
-
-IRAM_ATTR void frame_task(void *parg) {
-
-    grbl_send(CLIENT_SERIAL,"Creat frame task succeed\n");
-    // 定义一个信号量返回值
-    BaseType_t sem_receive = pdPASS;
-
-    while(1) {  
-
-        sem_receive = xSemaphoreTake(is_fram_need, portMAX_DELAY);
-
-        if(sem_receive == pdTRUE) {
-            // 触发信号量
-            grbl_send(CLIENT_SERIAL,"receive sem succeed\n");
-            vTaskSuspend(lv_disp_tcb); // 挂起任务da
-            mks_run_frame(frame_ctrl.file_name);
-            vTaskResume(lv_disp_tcb);   // 恢复任务
-        }
-    }
-}
-
-IRAM_ATTR void frame_task_init(void ) {
-
-    xTaskCreatePinnedToCore(frame_task,             // task
-                            "Frame task",           // name for task
-                            FRAME_TASK_STACK,       // size of task stack
-                            NULL,                   // parameters
-                            FRAME_TASK_PRO,         // priority
-                            // nullptr,
-                            &frame_task_tcb,
-                            FRAME_TASK_CORE         // must run the task on same core
-                                                    // core
-    );
-}
-
 /*-------------------------------------------测试模式----------------------------------------------*/
 
 #define TEST_CODE_TASK_STACK                4096
@@ -254,10 +362,12 @@ IRAM_ATTR void frame_task_init(void ) {
 TaskHandle_t test_code_handle = NULL;
 
 
+// Runs the step timing check each time mks_step_test_start() wakes it
 void dlc32_test_debug(void *parg) {
 
     while(1) {
-    
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        mks_step_test_run();
     }
 }
 
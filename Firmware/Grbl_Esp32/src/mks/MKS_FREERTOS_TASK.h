@@ -7,9 +7,9 @@
 
 
 extern TaskHandle_t lv_disp_tcb;
-extern TaskHandle_t frame_task_tcb;
 void disp_task_init(void);
 void disp_task_data_updata(void);
 
-void frame_task_init(void );
+extern TaskHandle_t test_code_handle;
+void test_code_task_init(void);
 #endif
@@ -3,13 +3,18 @@
 // Global variables
 uint8_t mks_machine_mode = MODE_NONE; // Default mode is none
 TaskHandle_t i2cTaskHandle = NULL;    // Task handle for the polling task
-char i2c_buffer[48];                 // Buffer for I2C data
 
-// Variables for throttled JSON reporting
-uint32_t last_json_report_time = 0;   // Last time JSON was reported
-uint32_t mode_change_time = 0;        // Time when mode change was detected
-bool throttled_reporting_active = false; // Flag to indicate if throttled reporting is active
-char last_json_content[48] = {0};    // Store the last JSON content for repeat sending
+static const char* i2c_color_names[I2C_COLOR_COUNT] = { "cyan", "magenta", "yellow", "black" };
+
+#ifdef I2C_SLAVE_READY_PIN
+static void IRAM_ATTR i2c_ready_isr() {
+    BaseType_t higher_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(i2cTaskHandle, &higher_woken);
+    if (higher_woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+#endif
 
 // Initialize I2C functionality
 void mks_i2c_slave_init() {
@@ -20,7 +25,7 @@ void mks_i2c_slave_init() {
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
     Wire.setClock(I2C_CLOCK_FREQ); // Set clock frequency to 100 kHz
     
-    // Create a task for polling I2C
+    // Create a task for reading the slave
     xTaskCreate(
         mks_i2c_poll_task,    // Function that implements the task
         "i2cPollTask",        // Text name for the task
@@ -29,173 +34,105 @@ void mks_i2c_slave_init() {
         1,                    // Priority (0 is lowest, configMAX_PRIORITIES-1 is highest)
         &i2cTaskHandle        // Task handle
     );
-    
+
+#ifdef I2C_SLAVE_READY_PIN
+    pinMode(I2C_SLAVE_READY_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(I2C_SLAVE_READY_PIN), i2c_ready_isr, FALLING);
+    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "I2C initialized on pins %d (SDA) and %d (SCL) at %d Hz, ready on %s", 
+                  I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_FREQ, pinName(I2C_SLAVE_READY_PIN).c_str());
+#else
     // Log initialization
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "I2C initialized with polling on pins %d (SDA) and %d (SCL) at %d Hz", 
                   I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_FREQ);
+#endif
+}
+
+// Reads len bytes from the slave, false if it did not send them all
+static bool i2c_read_slave(uint8_t* data, size_t len) {
+    if (Wire.requestFrom((uint8_t)I2C_SLAVE_ADDRESS, (uint8_t)len) != len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = Wire.read();
+    }
+    return true;
+}
+
+static uint8_t i2c_last_color = I2C_COLOR_NONE;
+
+// Applies a new status message and reports what it changed, once
+static void i2c_apply_status(const i2c_status_msg_t* status) {
+    uint8_t new_mode = status->mode <= MODE_DRAWING ? status->mode : MODE_NONE;
+    // Only report if the mode actually changed
+    if (new_mode != mks_machine_mode) {
+        mks_machine_mode = new_mode;
+        // Report mode change to all clients
+        report_machine_mode();
+    }
+    if (status->color != i2c_last_color) {
+        i2c_last_color = status->color;
+        if (status->color < I2C_COLOR_COUNT) {
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Color %s reached at %u", i2c_color_names[status->color], status->position);
+        }
+    }
 }
 
-// FreeRTOS task for periodically polling I2C
+// FreeRTOS task for reading the slave. It touches the bus only when the slave has something
+// new, which it learns from the ready line or, without one, from the sequence number.
 void mks_i2c_poll_task(void* parameter) {
+    int last_seq = -1;  // None yet
+    heap_track_task();
     for (;;) {
-        uint32_t current_time = millis();
-        
-        if (throttled_reporting_active) {
-            if ((current_time - mode_change_time) <= JSON_REPORT_DURATION) {
-                if ((current_time - last_json_report_time) >= JSON_REPORT_INTERVAL) {
-                    grbl_sendf(CLIENT_SERIAL, "[JSON:%s]\r\n", last_json_content);
-                    last_json_report_time = current_time;
-                }
-            } else {
-                throttled_reporting_active = false;
-            }
+#ifdef I2C_SLAVE_READY_PIN
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2C_READY_POLL_INTERVAL));
+#else
+        vTaskDelay(pdMS_TO_TICKS(I2C_POLL_INTERVAL));
+#endif
+        uint8_t seq;
+        if (!i2c_read_slave(&seq, sizeof(seq)) || seq == last_seq) {
+            continue;
         }
-        if (Serial.available() > 0) {
-            size_t len = Serial.readBytesUntil('\n', i2c_buffer, sizeof(i2c_buffer) - 2);
-            if (len > 0) {
-                i2c_buffer[len] = '\0';
-                
-                // Process commands that start with J: as JSON commands
-                if (len > 2 && i2c_buffer[0] == 'J' && i2c_buffer[1] == ':' && len > 3) {
-                    // Store JSON for throttled reporting
-                    strncpy(last_json_content, &i2c_buffer[2], sizeof(last_json_content) - 1);
-                    last_json_content[sizeof(last_json_content) - 1] = '\0';
-                    
-                    // Start throttled reporting
-                    if (!throttled_reporting_active) {
-                        // Send first report immediately
-                        forward_json_to_console(&i2c_buffer[2]);
-                        mode_change_time = current_time;
-                        last_json_report_time = current_time;
-                        throttled_reporting_active = true;
-                    }
-                    
-                    // Process the command regardless of throttling
-                    mks_i2c_process_json(&i2c_buffer[2]);
-                }
-            }
+        i2c_status_msg_t status;
+        if (!i2c_read_slave((uint8_t*)&status, sizeof(status))) {
+            continue;
         }
-        
-        // Poll Arduino Nano (slave at address 0x08) for JSON data
-        Wire.requestFrom(0x08, 32); 
-        if (Wire.available()) {
-            size_t i = 0;
-            while (Wire.available() && i < sizeof(i2c_buffer) - 2) {
-                i2c_buffer[i++] = Wire.read();
-            }
-            i2c_buffer[i] = '\0';
-            
-            if (i > 0) {
-                // Check if received data is valid JSON 
-                if (i2c_buffer[0] == '{') {
-                    // Store JSON for throttled reporting
-                    strncpy(last_json_content, i2c_buffer, sizeof(last_json_content) - 1);
-                    last_json_content[sizeof(last_json_content) - 1] = '\0';
-                    
-                    // Start throttled reporting if not already active
-                    if (!throttled_reporting_active) {
-                        // Send first report immediately
-                        forward_json_to_console(i2c_buffer);
-                        mode_change_time = current_time;
-                        last_json_report_time = current_time;
-                        throttled_reporting_active = true;
-                    }
-                    
-                    // Process the JSON command regardless of throttling
-                    mks_i2c_process_json(i2c_buffer);
-                }
-            }
+        if ((status.version != I2C_PROTOCOL_VERSION) || (status.type != I2C_MSG_STATUS) || !i2c_crc_ok(&status, sizeof(status))) {
+            continue;  // Try again on the next pulse or poll
         }
-        
-        // This task should run at a low priority and not interfere with G-code processing
-        // Ensure a minimum delay to prevent excessive CPU usage
-        const TickType_t minDelay = 10 / portTICK_PERIOD_MS; // Minimum delay of 10ms
-        TickType_t delay = (I2C_POLL_INTERVAL / portTICK_PERIOD_MS) > minDelay ? 
-                           (I2C_POLL_INTERVAL / portTICK_PERIOD_MS) : minDelay;
-        vTaskDelay(delay);
+        last_seq = status.seq;
+        i2c_apply_status(&status);
     }
 }
 
-// Forward JSON to UGS console - now only used for the first immediate report
-void forward_json_to_console(const char* json) {
-    grbl_sendf(CLIENT_SERIAL, "[JSON:%s]\r\n", json);
-}
+// Send a color message to the Arduino slave
+bool send_color_to_arduino(const char* color) {
+    static uint8_t seq = 0;
 
-// Process JSON commands
-void mks_i2c_process_json(const char* json) {
-    // Parse JSON
-    StaticJsonDocument<48> doc;
-    DeserializationError error = deserializeJson(doc, json);
-    
-    if (error) {
-        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "JSON parse error: %s", error.c_str());
-        return;
-    }
-    
-    // Check for mode command
-    if (doc.containsKey("mode")) {
-        const char* mode = doc["mode"];
-        if (mode) {
-            uint8_t previous_mode = mks_machine_mode;
-            uint8_t new_mode = MODE_NONE;
-            
-            if (strncmp(mode, "spindle", 7) == 0) {
-                new_mode = MODE_SPINDLE;
-            }
-            else if (strncmp(mode, "laser", 5) == 0) {
-                new_mode = MODE_LASER;
-            }
-            else if (strncmp(mode, "drawing", 7) == 0) {
-                new_mode = MODE_DRAWING;
-            }
-            else if (strncmp(mode, "none", 4) == 0) {
-                new_mode = MODE_NONE;
-            }
-            
-            // Only report if the mode actually changed
-            if (previous_mode != new_mode) {
-                mks_machine_mode = new_mode;
-                // Report mode change to all clients
-                report_machine_mode();
-                
-                // Disable throttled reporting for mode changes
-                throttled_reporting_active = false;
-            }
+    i2c_color_msg_t msg;
+    msg.color = I2C_COLOR_NONE;
+    for (uint8_t i = 0; i < I2C_COLOR_COUNT; i++) {
+        if (color && strcasecmp(color, i2c_color_names[i]) == 0) {
+            msg.color = i;
         }
     }
-    
-    // Other commands can be handled here
-}
-
-// Send JSON payload to Arduino slave
-bool send_json_to_arduino(const char* json) {
-    // Max json payload size we will send
-    const size_t maxPayloadSize = 32;
-    
-    // Only send if we have valid json data
-    if (!json || strlen(json) == 0 || strlen(json) > maxPayloadSize) {
-        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Invalid JSON payload or size exceeded");
+    if (msg.color == I2C_COLOR_NONE) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Unknown color %s", color ? color : "");
         return false;
     }
-    
-    // Start transmission to slave device
-    Wire.beginTransmission(0x08); // Arduino address
-    
-    // Send the JSON payload - cast to uint8_t* to match Wire.write signature
-    size_t bytesWritten = Wire.write((const uint8_t*)json, strlen(json));
-    
-    // End transmission
-    uint8_t result = Wire.endTransmission();
-    
-    // Log result
-    if (result == 0 && bytesWritten == strlen(json)) {
-        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Sent to Arduino: %s", json);
-        
-        // Forward to console for visibility
-        grbl_sendf(CLIENT_SERIAL, "[JSON_SENT:%s]\r\n", json);
+    msg.version = I2C_PROTOCOL_VERSION;
+    msg.type    = I2C_MSG_COLOR;
+    msg.seq     = ++seq;
+    msg.crc     = i2c_crc8(&msg, sizeof(msg) - 1);
+
+    Wire.beginTransmission(I2C_SLAVE_ADDRESS); // Arduino address
+    size_t  bytesWritten = Wire.write((const uint8_t*)&msg, sizeof(msg));
+    uint8_t result       = Wire.endTransmission();
+
+    if (result == 0 && bytesWritten == sizeof(msg)) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Sent to Arduino: color %s", i2c_color_names[msg.color]);
         return true;
     } else {
-        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Failed to send JSON to Arduino, error: %d", result);
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Failed to send color to Arduino, error: %d", result);
         return false;
     }
 }
@@ -7,11 +7,31 @@ LVGL_UI_PAGE_t mks_ui_page;
 
 static lv_disp_buf_t    disp_buf;
 static lv_color_t       bmp_public_buf[LV_BUF_SIZE];
-// static lv_color_t       bmp_private_buf1[LV_BUF_SIZE]; 
+#if defined(USE_LCD_DMA)
+// LVGL renders into one buffer while the other is still going out by DMA
+static lv_color_t       bmp_private_buf1[LV_BUF_SIZE];
+static lv_disp_drv_t*   lcd_flush_drv;
+static bool             lcd_write_open = false;  // TFT selected since the last DMA flush
+#endif
 
 /* Function */
 void my_disp_flush(lv_disp_drv_t * disp, const lv_area_t * area, lv_color_t * color_p);
 bool my_indev_touch(struct _lv_indev_drv_t * indev_drv, lv_indev_data_t * data);
+#if defined(USE_LCD_DMA)
+static void lcd_dma_done(void);
+#endif
+#if defined(TOUCH_IRQ)
+static void touch_irq(void);
+static volatile bool touch_pen_down = false;   // A press started since the last read
+#endif
+
+MKS_DISP_STATS_T mks_disp_stats;
+
+#define DISP_BENCH_TIMEOUT_MS   10000
+
+static volatile bool    disp_bench_pending = false;
+static uint16_t         disp_bench_frames;
+static MKS_DISP_BENCH_T disp_bench_result;
 
 // 1ms
 void mks_lvgl_init(void) {
@@ -23,8 +43,12 @@ void mks_lvgl_init(void) {
         lv_disp_buf_init(&disp_buf_2, buf2_1, buf2_2, LV_HOR_RES_MAX * 10);  
     */
     lv_init();
-    // lv_disp_buf_init(&disp_buf, bmp_public_buf, bmp_private_buf1, LV_BUF_SIZE); // Initialize the display buffer
+    mks_disp_stats.since_us = esp_timer_get_time();
+#if defined(USE_LCD_DMA)
+    lv_disp_buf_init(&disp_buf, bmp_public_buf, bmp_private_buf1, LV_BUF_SIZE); // Initialize the display buffer
+#else
     lv_disp_buf_init(&disp_buf, bmp_public_buf, NULL, LV_BUF_SIZE);  
+#endif
 
     /* display driver register */
     lv_disp_drv_t disp_drv;
@@ -33,32 +57,155 @@ void mks_lvgl_init(void) {
     disp_drv.ver_res = LV_VER_RES_MAX;
     disp_drv.flush_cb = my_disp_flush;
     disp_drv.buffer = &disp_buf;
-    lv_disp_drv_register(&disp_drv);
+    lv_disp_t* disp = lv_disp_drv_register(&disp_drv);
+#if defined(USE_LCD_DMA)
+    lcd_flush_drv = &disp->driver;
+    tft.setDMADoneCallback(lcd_dma_done);
+#endif
 
     lv_indev_drv_t indev_drv;
     lv_indev_drv_init(&indev_drv);  
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     indev_drv.read_cb = my_indev_touch;
     lv_indev_drv_register(&indev_drv);
+
+#if defined(TOUCH_IRQ)
+    pinMode(TOUCH_IRQ, INPUT_PULLUP);
+    attachInterrupt(TOUCH_IRQ, touch_irq, FALLING);
+#endif
+}
+
+#if defined(TOUCH_IRQ)
+// Latches a press, so a tap shorter than the LVGL read period is still read
+static void IRAM_ATTR touch_irq(void) {
+    touch_pen_down = true;
+}
+#endif
+
+#if defined(USE_LCD_DMA)
+// SPI interrupt, the buffer LVGL handed to my_disp_flush() is free again
+static void IRAM_ATTR lcd_dma_done(void) {
+    lcd_flush_drv->buffer->flushing = 0;  // What lv_disp_flush_ready() does, kept in IRAM
 }
 
+// Waits for the last DMA flush and deselects the TFT, so the SPI bus can be used for other things
+void mks_lcd_release(void) {
+    if (lcd_write_open) {
+        tft.dmaWait();
+        tft.endWrite();
+        lcd_write_open = false;
+    }
+}
+#endif
+
 void my_disp_flush(lv_disp_drv_t * disp, const lv_area_t * area, lv_color_t * color_p) {
 
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
+    int64_t  start = esp_timer_get_time();
 
+#if defined(USE_LCD_DMA)
+    // The TFT stays selected from one flush to the next. The transfer is only queued here, and
+    // lcd_dma_done() releases the buffer when it ends.
+    if (!lcd_write_open) {
+        tft.startWrite();
+        lcd_write_open = true;
+    }
+    tft.dmaWait();  // The window can only move once the last pixels are out
+    tft.setAddrWindow(area->x1, area->y1, w, h);
+    tft.pushColorsDMA(&color_p->full, w * h, LV_COLOR_16_SWAP == 0);
+#else 
     tft.startWrite();
     tft.setAddrWindow(area->x1, area->y1, w, h);
-    
+    tft.pushColors(&color_p->full, w * h, LV_COLOR_16_SWAP == 0);  // LVGL renders in panel byte order
+    tft.endWrite();
+    lv_disp_flush_ready(disp);
+#endif
+    mks_disp_stats.flushes++;
+    mks_disp_stats.bytes += w * h * sizeof(lv_color_t);
+    mks_disp_stats.flush_us += esp_timer_get_time() - start;
+}
+
+// Redraws area frames times, each frame refreshed at once and out on the panel before the next
+static void disp_bench_pass(const lv_area_t* area, uint16_t frames, MKS_DISP_BENCH_PASS_T* pass) {
+    lv_disp_t* disp     = lv_disp_get_default();
+    uint64_t   bytes    = mks_disp_stats.bytes;
+    uint64_t   flush_us = mks_disp_stats.flush_us;
+    int64_t    start    = esp_timer_get_time();
+    for (uint16_t i = 0; i < frames; i++) {
+        lv_inv_area(disp, area);
+        lv_refr_now(disp);
 #if defined(USE_LCD_DMA)
-    tft.pushColorsDMA(&color_p->full, w * h, true);
-#else 
-    tft.pushColors(&color_p->full, w * h, true);
+        int64_t wait = esp_timer_get_time();
+        mks_lcd_release();  // The last flush of the frame is still going out
+        mks_disp_stats.flush_us += esp_timer_get_time() - wait;
 #endif
-    
+    }
+    pass->frames   = frames;
+    pass->frame_us = esp_timer_get_time() - start;
+    pass->bytes    = mks_disp_stats.bytes - bytes;
+    pass->flush_us = mks_disp_stats.flush_us - flush_us;
+}
 
+// The bus alone: one screen of black pushed from the draw buffer, blocking
+static void disp_bench_spi(MKS_DISP_BENCH_T* result) {
+#if defined(USE_LCD_DMA)
+    mks_lcd_release();
+#endif
+    const uint32_t pixels = LV_HOR_RES_MAX * LV_VER_RES_MAX;
+    memset(bmp_public_buf, 0, sizeof(bmp_public_buf));
+    int64_t start = esp_timer_get_time();
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, LV_HOR_RES_MAX, LV_VER_RES_MAX);
+    for (uint32_t done = 0; done < pixels; done += LV_BUF_SIZE) {
+        tft.pushColors(&bmp_public_buf[0].full, MIN(LV_BUF_SIZE, pixels - done), false);
+    }
     tft.endWrite();
-    lv_disp_flush_ready(disp);
+    result->spi_us    = esp_timer_get_time() - start;
+    result->spi_bytes = pixels * sizeof(lv_color_t);
+    result->spi_hz    = SPI_FREQUENCY;
+}
+
+/*
+ * Author   :MKS
+ * Describe :Run the display benchmark in the display task, which owns LVGL. Waits until it is
+ *           done; false if the display task did not get to it.
+ * Data     :2021/03/16
+*/
+bool mks_disp_bench(uint16_t frames, MKS_DISP_BENCH_T* result) {
+    if ((lv_disp_tcb == NULL) || disp_bench_pending) {
+        return false;
+    }
+    disp_bench_frames  = frames;
+    disp_bench_pending = true;
+    xTaskNotifyGive(lv_disp_tcb);
+    for (uint32_t waited = 0; disp_bench_pending; waited += 10) {
+        if (waited >= DISP_BENCH_TIMEOUT_MS) {
+            return false;  // Still pending, the display task runs it and drops the result
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    *result = disp_bench_result;
+    return true;
+}
+
+/*
+ * Author   :MKS
+ * Describe :Called by the display task before lv_task_handler(). The screen is redrawn in full
+ *           afterwards.
+ * Data     :2021/03/16
+*/
+void mks_disp_bench_poll(void) {
+    if (!disp_bench_pending) {
+        return;
+    }
+    lv_area_t full  = { 0, 0, LV_HOR_RES_MAX - 1, LV_VER_RES_MAX - 1 };
+    lv_area_t strip = { 0, 0, LV_HOR_RES_MAX - 1, MKS_DISP_BENCH_STRIP - 1 };
+    disp_bench_pass(&full, disp_bench_frames, &disp_bench_result.full);
+    disp_bench_pass(&strip, disp_bench_frames, &disp_bench_result.strip);
+    disp_bench_spi(&disp_bench_result);
+    lv_inv_area(lv_disp_get_default(), &full);
+    disp_bench_pending = false;
 }
 
 bool my_indev_touch(struct _lv_indev_drv_t * indev_drv, lv_indev_data_t * data) {
@@ -66,7 +213,24 @@ bool my_indev_touch(struct _lv_indev_drv_t * indev_drv, lv_indev_data_t * data)
     uint16_t touchX=0, touchY=0;
     static uint16_t last_x = 0;
     static uint16_t last_y = 0;
-    boolean touched = tft.getTouch(&touchY, &touchX);
+    boolean touched = false;
+
+#if defined(TOUCH_IRQ)
+    // Nobody is touching the screen, leave the bus to the display
+    if((touch_pen_down == false) && (digitalRead(TOUCH_IRQ) == HIGH)) {
+        data->point.x = last_x;
+        data->point.y = last_y;
+        data->state = LV_INDEV_STATE_REL;
+        BEEP_OFF;
+        return false;
+    }
+    touch_pen_down = false;  // The conversions below toggle PENIRQ, which sets it again once
+#endif
+#if defined(USE_LCD_DMA)
+    mks_lcd_release();  // The touch controller shares the TFT SPI bus
+#endif
+    // One transaction with no delays, where getTouch() takes up to a dozen and sleeps between them
+    touched = tft.getTouchFiltered(&touchY, &touchX);
 
     if(touchX > 480) {
         touchX = 480;
@@ -119,9 +119,38 @@ typedef struct {
 extern LVGL_UI_PAGE_t mks_ui_page;
 
 
+// Display timing since the last $Bench/Display. The flush time is spent in my_disp_flush(),
+// waits for the bus included, the handler time in lv_task_handler() in the display task.
+typedef struct {
+    uint32_t flushes;
+    uint64_t bytes;
+    uint64_t flush_us;
+    uint64_t handler_us;
+    int64_t  since_us;
+}MKS_DISP_STATS_T;
+extern MKS_DISP_STATS_T mks_disp_stats;
+
+#define MKS_DISP_BENCH_STRIP        40      // Lines of the strip pass, about a label row
 
+typedef struct {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t frame_us;                  // Over all the frames, flushes included
+    uint32_t flush_us;
+}MKS_DISP_BENCH_PASS_T;
+
+typedef struct {
+    MKS_DISP_BENCH_PASS_T full;         // The whole screen redrawn
+    MKS_DISP_BENCH_PASS_T strip;        // MKS_DISP_BENCH_STRIP lines across it
+    uint32_t spi_bytes;                 // One screen pushed from a buffer, without LVGL
+    uint32_t spi_us;
+    uint32_t spi_hz;                    // SPI_FREQUENCY of TFT_eSPI
+}MKS_DISP_BENCH_T;
 
 void mks_lvgl_init(void);
+void mks_lcd_release(void);
+bool mks_disp_bench(uint16_t frames, MKS_DISP_BENCH_T* result);
+void mks_disp_bench_poll(void);
 void lvgl_test(void);
 SDState mks_readSD_Status(void);
 float mks_caving_persen(void);
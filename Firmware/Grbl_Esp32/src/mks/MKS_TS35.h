@@ -26,6 +26,10 @@
 #define TFT_TOUCH_CS_H      digitalWrite(TOUCH_CS, HIGH)
 #define TFT_TOUCH_CS_L      digitalWrite(TOUCH_CS, LOW)
 
+// The touch controller's PENIRQ output, low while the panel is pressed. Define TOUCH_IRQ in the
+// machine file on boards that wire it, and the touch controller is only read while it is low.
+// #define TOUCH_IRQ           GPIO_NUM_xx
+
 #if defined(USE_BEEP)
 #define BEEP_ON             digitalWrite(BEEPER, HIGH)
 #define BEEP_OFF            digitalWrite(BEEPER, LOW)
@@ -75,36 +75,63 @@ char WIFI_PASSWORD_CMD[128]="ESP101";
 char WIFI_CONNECT_CMD[]="ESP210";
 char mks_wifi_send[128];
 
-void mks_wifi_scanf(void) {
+// The scan runs in the WiFi driver. When it is done, the event task copies the results into
+// a queue, and the UI task takes them from there on its next refresh, so it neither waits on
+// the scan nor reads the driver's result list while another scan could replace it.
+typedef struct {
+    char   ssid[33];
+    int8_t rssi;
+} mks_wifi_ap_t;
+
+static QueueHandle_t wifi_scan_queue    = NULL;
+static volatile bool wifi_scan_finished = false;  // Set once every result of the scan is queued
+
+static void mks_wifi_scan_done(WiFiEvent_t event) {
     int n = WiFi.scanComplete();
+    for (int i = 0; i < n && i < MKS_WIFI_NUM; i++) {
+        mks_wifi_ap_t ap = {};
+        strncpy(ap.ssid, WiFi.SSID(i).c_str(), sizeof(ap.ssid) - 1);
+        ap.rssi = WiFi.RSSI(i);
+        xQueueSend(wifi_scan_queue, &ap, 0);
+    }
+    WiFi.scanDelete();
+    wifi_scan_finished = true;
+}
+
+static void mks_wifi_scan_start(void) {
+    if (wifi_scan_queue == NULL) {
+        wifi_scan_queue = xQueueCreate(MKS_WIFI_NUM, sizeof(mks_wifi_ap_t));
+        WiFi.onEvent(mks_wifi_scan_done, SYSTEM_EVENT_SCAN_DONE);
+    }
+    xQueueReset(wifi_scan_queue);
+    memset(mks_wifi.wifi_name_str, 0, sizeof(mks_wifi.wifi_name_str));
+    memset(mks_wifi.wifi_rssi, 0, sizeof(mks_wifi.wifi_rssi));
     mks_wifi.begin_scanf_num = 0;
-    switch (n) {
-        case -2:                      // Scan not triggered
-            WiFi.scanNetworks(true);  // Begin async scan
-            // grbl_send(CLIENT_SERIAL ,"scanNetworks\n\n");
-            mks_wifi.wifi_scanf_status = wifi_scanf_begin;
-            break;
-        case -1:  // Scan in progress
-            // grbl_send(CLIENT_SERIAL ,"waitting\n\n");
-            mks_wifi.wifi_scanf_status = wifi_scanf_waitting;
-            break;
-        default:
-            // 获取16个wifi名
-            for (int i = 0; i < MKS_WIFI_NUM; ++i) {  
-                memcpy(mks_wifi.wifi_name_str[mks_wifi.begin_scanf_num], WiFi.SSID(i).c_str(), 128);
-                mks_wifi.wifi_rssi[i] = WiFi.RSSI(i);
-                mks_wifi.begin_scanf_num++;
-            }
-            mks_wifi.wifi_scanf_status = wifi_scanf_succeed;
-            WiFi.scanDelete();
-            // Restart the scan in async mode so new data will be available
-            // when we ask again.
-            n = WiFi.scanComplete();
-            if (n == -2) {
-                WiFi.scanNetworks(true);
-            }
-            break;
-        }
+    wifi_scan_finished       = false;
+    WiFi.scanDelete();
+    if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+        mks_wifi.wifi_scanf_status = wifi_scanf_succeed;  // Shows the empty list, from which it can scan again
+        return;
+    }
+    mks_wifi.wifi_scanf_status = wifi_scanf_waitting;
+}
+
+// Called from the UI task: starts a scan, or takes the results that have arrived
+void mks_wifi_scanf(void) {
+    if (mks_wifi.wifi_scanf_status != wifi_scanf_waitting) {
+        mks_wifi_scan_start();
+        return;
+    }
+    bool          finished = wifi_scan_finished;  // Read first, so no result queued before it is missed
+    mks_wifi_ap_t ap;
+    while (mks_wifi.begin_scanf_num < MKS_WIFI_NUM && xQueueReceive(wifi_scan_queue, &ap, 0) == pdTRUE) {
+        strcpy(mks_wifi.wifi_name_str[mks_wifi.begin_scanf_num], ap.ssid);
+        mks_wifi.wifi_rssi[mks_wifi.begin_scanf_num] = ap.rssi;
+        mks_wifi.begin_scanf_num++;
+    }
+    if (finished) {
+        mks_wifi.wifi_scanf_status = wifi_scanf_succeed;
+    }
 }
 
 bool mks_get_wifi_status(void) { 
@@ -78,15 +78,31 @@ char file_print_send[128];
 #define FIEL_NAME		128
 char filename[FILE_NUM][FIEL_NAME];
 
+/* 
+ * Author   :MKS
+ * Describe :Show mks_file_list.file_page. The files come from the SD file index, so the card
+ *           is only mounted when the index has to be built again.
+ * Data     :2021/03/16
+*/
+static void carving_show_page(void) {
+
+	mks_del_file_obj();
+	mks_file_list.file_begin_num = 0;
+
+	if(sd_index_valid()) {
+		mks_listDir(SD, "/",MKS_FILE_DEEP);
+	}else if(mks_readSD_Status() != SDState::NotPresent) {
+		mks_listDir(SD, "/",MKS_FILE_DEEP);
+	}
+}
+
 static void event_handler_up(lv_obj_t* obj, lv_event_t event) {
 
 	if (event == LV_EVENT_RELEASED) {
 
-		char p[30];
-
 		if(file_popup_select_flag == true) return;
 
-		if(mks_readSD_Status() == SDState::NotPresent)  // check sdcard is work
+		if(get_sd_state(false) == SDState::NotPresent)  // check sdcard is work
 		{
 
 		}
@@ -95,18 +111,8 @@ static void event_handler_up(lv_obj_t* obj, lv_event_t event) {
 			if(mks_file_list.file_page == 1) {
 
 			}else {
-			mks_file_list.file_count = 0;
 				mks_file_list.file_page--;
-				// mks_draw_file_loadig();
-				// lv_refr_now(lv_refr_get_disp_refreshing());
-				// mks_del_file_obj_1(mks_file_list.file_begin_num);
-				mks_del_file_obj();
-				mks_file_list.file_begin_num = 0;
-				mks_listDir(SD, "/",MKS_FILE_DEEP);
-				// draw_file_btmimg();
-				// draw_file_btmimg_1(mks_file_list.file_begin_num);
-				// lv_obj_del(caving_read_file_src1);
-				SD.end();
+				carving_show_page();
 			}
 		}
 	}
@@ -114,28 +120,18 @@ static void event_handler_up(lv_obj_t* obj, lv_event_t event) {
 
 static void event_handler_next(lv_obj_t* obj, lv_event_t event) {
 
-		if (event == LV_EVENT_RELEASED) {
+	if (event == LV_EVENT_RELEASED) {
 
-			if(file_popup_select_flag == true) return;
+		if(file_popup_select_flag == true) return;
 
-			if(mks_readSD_Status() == SDState::NotPresent)  // check sdcard is work
-			{ 
-				
-			}
-			else {
-			if (event == LV_EVENT_RELEASED) {
-				if(mks_file_list.file_begin_num >= MKS_FILE_NUM) {
-					mks_file_list.file_count = 0;
-					mks_file_list.file_page++;
-					// mks_draw_file_loadig();
-					// lv_refr_now(lv_refr_get_disp_refreshing());
-					mks_del_file_obj();
-					mks_file_list.file_begin_num = 0;
-					mks_listDir(SD, "/",MKS_FILE_DEEP);
-					// draw_file_btmimg();
-					// lv_obj_del(caving_read_file_src1);
-					SD.end();
-				}
+		if(get_sd_state(false) == SDState::NotPresent)  // check sdcard is work
+		{ 
+			
+		}
+		else {
+			if((mks_file_list.file_page * MKS_FILE_NUM) < sd_index_count()) {
+				mks_file_list.file_page++;
+				carving_show_page();
 			}
 		}
 	}
@@ -325,7 +321,6 @@ void mks_draw_craving(void) {
 		mks_grbl.mks_sd_status = 1; // sd had inserted
 
 		mks_listDir(SD, "/",MKS_FILE_DEEP);
-		SD.end();
 	}	
 	mks_ui_page.mks_ui_page = MKS_UI_Caving;
     mks_ui_page.wait_count = DEFAULT_UI_COUNT;
@@ -895,6 +890,7 @@ void start_print(void) {
 
 	mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING; 
 	mks_ui_page.wait_count = DEFAULT_UI_COUNT;
+	mks_preview_stop();			// 预览还在读文件时 SD 卡是忙的
  
 	strcat(str_cmd, file_print_send);
 	strcat(str_cmd,"\n");
@@ -1074,6 +1070,6 @@ void mks_draw_file_loadig(void) {
 
 void mks_clear_craving(void) {
 	
-	lv_obj_clean(mks_global.mks_src);
+	mks_lv_clean_src();
 
 }
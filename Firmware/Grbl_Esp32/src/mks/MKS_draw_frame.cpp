@@ -7,13 +7,17 @@
 FRAME_CRTL_T frame_ctrl;
 FRAME_PAGE_T frame_page;
 
-uint8_t x1point_flag = false;
-uint8_t x2point_flag = false;
-uint8_t y1point_flag = false;
-uint8_t y2point_flag = false;
+QueueHandle_t frame_msg_queue = NULL;      // worker 线程 -> lvgl线程, 只保留最新的状态
 
-// 创建内核对象句柄
-SemaphoreHandle_t is_fram_need = NULL;
+static uint8_t frame_last_percent;
+
+// 在 worker 线程中运行, 离开巡边界面后不再执行
+static void frame_work(void *arg) {
+
+    if(mks_ui_page.mks_ui_page == MKS_UI_Frame) {
+        mks_run_frame(frame_ctrl.file_name);
+    }
+}
 
 LV_IMG_DECLARE(back);		
 
@@ -22,9 +26,10 @@ static void event_handler_cancle(lv_obj_t* obj, lv_event_t event) {
     if(event == LV_EVENT_RELEASED) {
         
         if(frame_ctrl.cancle_enable == true) {
+            frame_ctrl.is_read_file = false;        // 通知 worker 线程停止读文件
             mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
             mks_ui_page.wait_count = 1;
-            lv_obj_clean(mks_src);
+            mks_lv_clean_ui();
             mks_draw_ready();
         }
     }
@@ -34,8 +39,6 @@ void mks_draw_frame(void) {
 
     mks_frame_init();
 
-    BaseType_t sem_give = pdPASS;
-
     lv_style_copy(&frame_page.frame_src_style, &lv_style_scr);
     frame_page.frame_src_style.body.main_color = LV_COLOR_MAKE(0x1F, 0x23, 0x33); 
     frame_page.frame_src_style.body.grad_color = LV_COLOR_MAKE(0x1F, 0x23, 0x33); 
@@ -48,6 +51,15 @@ void mks_draw_frame(void) {
 	lv_obj_set_pos(frame_page.frame_src, FRAME_SRC_X, FRAME_SRC_Y);
 	lv_obj_set_style(frame_page.frame_src, &frame_page.frame_src_style);
 
+    frame_page.btn_cancle = lv_imgbtn_creat_mks(frame_page.frame_src, 
+                                                frame_page.btn_cancle, 
+                                                &back, 
+                                                &back, 
+                                                LV_ALIGN_IN_TOP_LEFT, 
+                                                FRAME_IMGBTN_X, 
+                                                FRAME_IMGBTN_Y, 
+                                                event_handler_cancle);
+
     frame_page.label_text = mks_lvgl_long_sroll_label_with_wight_set_center(frame_page.frame_src, 
                                                                             frame_page.label_text, 
                                                                             FRAME_LABEL_RUN_STATUS_X, 
@@ -63,148 +75,59 @@ void mks_draw_frame(void) {
 	memcpy(frame_ctrl.current_file_name, frame_ctrl.file_name, 128);
     frame_ctrl.current_file_size = mks_file_list.file_size[mks_file_list.file_choose]; 
 
-    // 发送信号量通知线程进入巡边
-    sem_give = xSemaphoreGive(is_fram_need);
-
-    if(sem_give == pdTRUE) {
-        grbl_send(CLIENT_SERIAL ,"sem send succeed\n");
+    // 交给 worker 线程巡边, 见 Worker.h
+    xQueueReset(frame_msg_queue);
+    if(worker_submit("Frame", frame_work)) {
+        grbl_send(CLIENT_SERIAL ,"frame queued\n");
     }
     else{
-        grbl_send(CLIENT_SERIAL ,"sem send fail\n");
+        grbl_send(CLIENT_SERIAL ,"frame queue full\n");
     }
 }
 
-void mks_openSDFile(char* parameter) {
-    
-    if (*parameter == '\0') {    // 用来判断文件名是否为空
-        return;
-    }
-
-    String path = trim(parameter);
-    
-    SDState state = get_sd_state(true);
-    if (state != SDState::Idle) {
-        if (state == SDState::NotPresent) {
-            // webPrintln("No SD Card");
-            return;
-        } 
-        else 
-        {
-            // webPrintln("SD Card Busy");
-            return;
-        }
-    }
+static void frame_post_msg(FRAME_MSG_TYPE type, uint8_t percent) {
+    FRAME_MSG_T msg = { type, percent };
+    xQueueOverwrite(frame_msg_queue, &msg);
+}
 
-    if (!openFile(SD, path.c_str())) {
-        
-        return;
+// 扫描文件时的进度回调, 返回 false 时停止扫描
+static bool frame_scan_progress(uint32_t pos, uint32_t size) {
+    uint8_t percent = size ? (uint64_t)pos * 100 / size : 100;
+    if(percent != frame_last_percent) {
+        frame_last_percent = percent;
+        frame_post_msg(FRAME_MSG_PROGRESS, percent);
     }
+    return worker_yield(pos, size) && frame_ctrl.is_read_file;
 }
 
-// uint8_t *p;
+// 读取文件的范围, 有 .idx 缓存时不用再扫描整个文件
+bool mks_get_frame_info(char* parameter) {
 
-void polocte_cmd(char *str) {
-    
-    if(strstr(str, "G0")) {
-        frame_ctrl.have_g0 = true;
+    if (*parameter == '\0') {    // 用来判断文件名是否为空
+        return false;
     }
 
-    else if(strstr(str, "G1")) {
-        frame_ctrl.have_g1 = true;
-    }
-    frame_ctrl.safe_count = 0;
-    while( *str != '\n' && frame_ctrl.safe_count < FRAME_BUFF_SIZE -1 ) {      
-        if((frame_ctrl.have_g0 == true) || (frame_ctrl.have_g1 == true)) {
-            if(*str == 'X') {
-                str++;
-                memset(frame_ctrl.x_value, '\0', sizeof(frame_ctrl.x_value));
-                frame_ctrl.x_or_y = &frame_ctrl.x_value[0];
-                while(*str !=' ' && *str!='\r' && *str!='\n') {
-                    *frame_ctrl.x_or_y = *str;
-                    str++;
-                    frame_ctrl.x_or_y++;
-                }
-                frame_ctrl.x_temp = atof(frame_ctrl.x_value);
-                
-                if(frame_ctrl.x_temp > frame_ctrl.x_max) frame_ctrl.x_max = frame_ctrl.x_temp;
-                if(frame_ctrl.x_temp < frame_ctrl.x_min) frame_ctrl.x_min = frame_ctrl.x_temp;
-                // else if(frame_ctrl.x_min == 0) frame_ctrl.x_min = frame_ctrl.x_temp;
-            }
-            
-            if(*str == 'Y') {
-                str++;
-                memset(frame_ctrl.y_value, '\0', sizeof(frame_ctrl.x_value));
-                frame_ctrl.x_or_y = &frame_ctrl.y_value[0];
-                while(*str !=' ' && *str!='\r' && *str!='\n') {
-                    *frame_ctrl.x_or_y = *str;
-                    str++;
-                    frame_ctrl.x_or_y++;
-                }
-                frame_ctrl.y_temp = atof(frame_ctrl.y_value);
-                if(frame_ctrl.y_temp > frame_ctrl.y_max) frame_ctrl.y_max = frame_ctrl.y_temp;
-                if(frame_ctrl.y_temp < frame_ctrl.y_min) frame_ctrl.y_min = frame_ctrl.y_temp;
-            }
-        } // end
-        str++;
-        frame_ctrl.safe_count++;
-    }
-    frame_ctrl.have_g0 = false;
-    frame_ctrl.have_g1 = false;
-}
+    String path = trim(parameter);
 
-void lb_polocte_cmd(char *str) {
-
-    frame_ctrl.safe_count = 0;
-    while (*str != '\n' && (frame_ctrl.safe_count < FRAME_BUFF_SIZE)) {
-        grbl_send(CLIENT_SERIAL, "\n enter find buff");
-        grbl_sendf(CLIENT_SERIAL, "safe_count=:%d\n", frame_ctrl.safe_count);
-        if (*str == 'X') {
-            str++;
-            memset(frame_ctrl.x_value, '\0', sizeof(frame_ctrl.x_value));
-            frame_ctrl.x_or_y = &frame_ctrl.x_value[0];
-
-            while (*str != ' ' && *str != '\r' && *str != '\n') {
-                *frame_ctrl.x_or_y = *str;
-                str++;
-                frame_ctrl.x_or_y++;
-            }
-
-            frame_ctrl.x_temp = atof(frame_ctrl.x_value);
-
-            if (x1point_flag == false) {
-
-                frame_ctrl.x_min = frame_ctrl.x_temp;
-                x1point_flag = true;
-            }
-            else if (x2point_flag == false) {
-                frame_ctrl.x_max = frame_ctrl.x_temp;
-                x2point_flag = true;
-            }
-        }
+    SDState state = get_sd_state(true);
+    if (state != SDState::Idle) {
+        return false;           // No SD Card or SD Card Busy
+    }
 
-        if (*str == 'Y') {
-            str++;
-            memset(frame_ctrl.y_value, '\0', sizeof(frame_ctrl.y_value));
-            frame_ctrl.x_or_y = &frame_ctrl.y_value[0];
-            while (*str != ' ' && *str != '\r' && *str != '\n') {
-                *frame_ctrl.x_or_y = *str;
-                str++;
-                frame_ctrl.x_or_y++;
-            }
-            frame_ctrl.y_temp = atof(frame_ctrl.y_value);
-
-            if (y1point_flag == false) {
-                frame_ctrl.y_min = frame_ctrl.y_temp;
-                y1point_flag = true;
-            }
-            else if (y2point_flag == false) {
-                frame_ctrl.y_max = frame_ctrl.y_temp;
-                y2point_flag = true;
-            }
-        }
-        str++;
-        frame_ctrl.safe_count++;
+    sd_job_info_t info;
+    frame_last_percent = 0;
+    set_sd_state(SDState::BusyParsing);
+    Error err = sd_get_job_info(SD, path.c_str(), &info, frame_scan_progress);
+    set_sd_state(SDState::Idle);
+    if (err != Error::Ok) {
+        return false;
     }
+    frame_ctrl.x_min = info.x_min;
+    frame_ctrl.x_max = info.x_max;
+    frame_ctrl.y_min = info.y_min;
+    frame_ctrl.y_max = info.y_max;
+    grbl_sendf(CLIENT_SERIAL, "lines:%d time:%ds S max:%.0f\n", info.lines, info.seconds, info.s_max);
+    return true;
 }
 
 void mks_frame_init(void) { 
@@ -223,7 +146,7 @@ void mks_frame_init(void) {
     frame_ctrl.have_g0 = false;
     frame_ctrl.have_g1 = false;
     frame_ctrl.have_G91 = false;
-    frame_ctrl.cancle_enable = false;
+    frame_ctrl.cancle_enable = true;          // 读文件时也可以取消
     frame_ctrl.is_begin_run = false;
     frame_ctrl.is_finsh_run = false;
     frame_ctrl.is_read_file = true;
@@ -256,56 +179,30 @@ void event_handle_no(lv_obj_t* obj, lv_event_t event) {
 }
 
 
+// 在 worker 线程中运行, 不能直接操作lvgl, 状态通过 frame_msg_queue 发给lvgl线程
 void mks_run_frame(char *parameter) {
 
-    char frame_cmd[20];
-    frame_ctrl.cancle_enable = true;
+    char frame_cmd[FRAME_BUFF_SIZE];
     frame_ctrl.out = true;
 
     if (sys.state != State::Idle && sys.state != State::Alarm) {    // 判断SD卡状态
-        mks_lv_label_updata(frame_page.label_text, "SD is busy...");
-        lv_refr_now(lv_refr_get_disp_refreshing());
-        frame_ctrl.cancle_enable = true;
+        frame_post_msg(FRAME_MSG_BUSY, 0);
         return ;
     }
 
     if(frame_ctrl.file_name[0] != '/') frame_ctrl.file_name[0] = '/';
     grbl_sendf(CLIENT_SERIAL, "frame file:%s\n", frame_ctrl.file_name);
-    mks_openSDFile(parameter);
-
-    char fileLine[255];
-    uint8_t point_last_num = 1;
-    uint32_t point_count = 0;
-    uint32_t get_current_line = sd_get_current_line_number(); // 获取当前
-    char *b = NULL;
-    bool need_fine = true;
-
-    x1point_flag = false;
-    x2point_flag = false;
-    y1point_flag = false;
-    y2point_flag = false;
-
-    while ( (readFileLine(fileLine, 255))   && 
-            (frame_ctrl.is_read_file)       && 
-            (frame_ctrl.is_use_same_file == false)) {
-        
-        grbl_send(CLIENT_SERIAL ,"enter while \n");
-        if(get_current_line < 10) {
-            get_current_line = sd_get_current_line_number();
-            b = strstr(fileLine, "Bounds");
-            if(b != NULL) {
-                grbl_send(CLIENT_SERIAL, "have Bounds\n");
-                grbl_send(CLIENT_SERIAL, fileLine);
-                lb_polocte_cmd(fileLine);
-                frame_ctrl.is_read_file = false;
-                frame_ctrl.is_use_lb = true;
-                // frame_ctrl.is_use_same_file = true;
-                break;
-            }
+
+    if(frame_ctrl.is_use_same_file == false) {
+        if(!mks_get_frame_info(parameter)) {
+            if(frame_ctrl.is_read_file) frame_post_msg(FRAME_MSG_FAIL, 0);
+            return ;
         }
-        polocte_cmd(fileLine);
     }
 
+    if(frame_ctrl.is_read_file == false) {          // 已取消
+        return ;
+    }
     frame_ctrl.is_use_same_file = true;
 
     grbl_sendf(CLIENT_SERIAL ,"(%.2f, %.2f), (%.2f, %.2f)", 
@@ -313,9 +210,7 @@ void mks_run_frame(char *parameter) {
                                 frame_ctrl.y_min, 
                                 frame_ctrl.x_max, 
                                 frame_ctrl.y_max);
-    closeFile();
-    mks_lv_label_updata(frame_page.label_text, "Running...");
-    lv_refr_now(lv_refr_get_disp_refreshing()); 
+    frame_post_msg(FRAME_MSG_RUNNING, 100);
 
     MKS_GRBL_CMD_SEND("M3 S5\n");
 
@@ -344,11 +239,42 @@ void mks_run_frame(char *parameter) {
 
     // frame_run(frame_ctrl.is_use_lb);
     frame_ctrl.is_begin_run = true;
-    frame_ctrl.cancle_enable = true;
     grbl_send(CLIENT_SERIAL ,"frame finsh\n");
     return ;
 }
 
+// 在lvgl线程中调用, 显示 worker 线程发来的状态
+static char frame_msg_str[32];  // Shown by frame_page.label_text, so it must outlive this call
+
+void mks_frame_msg_updata(void) {
+
+    FRAME_MSG_T msg;
+    char text[32];
+
+    if(xQueueReceive(frame_msg_queue, &msg, 0) != pdTRUE) {
+        return ;
+    }
+
+    switch(msg.type) {
+        case FRAME_MSG_PROGRESS:
+            sprintf(text, "Loading File... %d%%", msg.percent);
+            mks_lv_label_updata_buf(frame_page.label_text, frame_msg_str, sizeof(frame_msg_str), text);
+        break;
+
+        case FRAME_MSG_RUNNING:
+            mks_lv_label_updata(frame_page.label_text, "Running...");
+        break;
+
+        case FRAME_MSG_BUSY:
+            mks_lv_label_updata(frame_page.label_text, "SD is busy...");
+        break;
+
+        case FRAME_MSG_FAIL:
+            mks_lv_label_updata(frame_page.label_text, "Read file fail...");
+        break;
+    }
+}
+
 void frame_run(bool is_lb) {
     char frame_cmd[20];
 
@@ -406,7 +332,7 @@ static void event_handler_cave_yes(lv_obj_t* obj, lv_event_t event) {
 		#if defined(USR_RELASE)
 			lv_obj_clean(mks_src);
 		#else 
-			lv_obj_clean(mks_global.mks_src);
+			mks_lv_clean_src();
 		#endif
 			start_print();
 	}
@@ -420,7 +346,7 @@ static void event_handler_cave_no(lv_obj_t* obj, lv_event_t event) {
 		
         cavre_popup_del();
 
-        lv_obj_clean(mks_global.mks_src);
+        mks_lv_clean_src();
 
         memset(temp, 0, sizeof(temp));
         memcpy(temp, mks_file_list.filename_str[mks_file_list.file_choose], sizeof(temp));
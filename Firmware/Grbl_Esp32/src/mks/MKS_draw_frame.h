@@ -87,14 +87,27 @@ typedef struct {
 }FRAME_CRTL_T;
 extern FRAME_CRTL_T frame_ctrl;
 
-extern SemaphoreHandle_t is_fram_need;
+// worker 线程发给lvgl线程的状态
+typedef enum {
+    FRAME_MSG_PROGRESS,         // 正在读取文件, percent 为进度
+    FRAME_MSG_RUNNING,
+    FRAME_MSG_BUSY,
+    FRAME_MSG_FAIL,
+}FRAME_MSG_TYPE;
+
+typedef struct {
+    FRAME_MSG_TYPE  type;
+    uint8_t         percent;
+}FRAME_MSG_T;
+
+extern QueueHandle_t frame_msg_queue;
 
 void mks_draw_frame(void);
 void mks_run_frame(char *parameter);
+void mks_frame_msg_updata(void);
 void mks_frame_init(void);
 bool mks_get_frame_status(void);
 void frame_finsh_popup(void);
 void frame_run(void);
-void lb_polocte_cmd(char *str);
 void frame_run(bool is_lb);
 #endif
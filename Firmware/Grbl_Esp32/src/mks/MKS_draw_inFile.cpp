@@ -69,6 +69,7 @@ static void disp_imgbtn_2(void);
 static void disp_imgbtn_2_del(void);
 static void disp_label(void);
 static void disp_btn(void);
+static void preview_request(const char *fn);
 static uint8_t get_id(lv_obj_t* obj) {
 
     if      (obj == move_page.y_n)  			return ID_INF_UP;
@@ -95,7 +96,7 @@ static void event_handler_cave_yes(lv_obj_t* obj, lv_event_t event) {
 	if (event == LV_EVENT_RELEASED) {
 		mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
 		cavre_popup_del();
-		lv_obj_clean(mks_global.mks_src);
+		mks_lv_clean_src();
 		start_print();
 	}
 }
@@ -127,7 +128,7 @@ static void set_cooling(lv_obj_t* obj, lv_event_t event) {
 static void event_handler_back(void) {
 
 	mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
-	lv_obj_clean(mks_global.mks_src);
+	mks_lv_clean_src();
 	mks_draw_ready();
 }
 
@@ -305,8 +306,14 @@ void mks_draw_inFile(char *fn) {
 	// label_for_infile_name(mks_global.mks_src_1, infile_page.label_file_name, -120, 0, fn);
 	
 	disp_label();
+
+	infile_page.img_preview = lv_img_create(mks_global.mks_src_2, NULL);
+	lv_obj_set_pos(infile_page.img_preview, inFILE_PREVIEW_X, inFILE_PREVIEW_Y);
+	lv_obj_set_hidden(infile_page.img_preview, true);
 	
 	mks_ui_page.mks_ui_page = MKS_UI_inFile;
+
+	preview_request(fn);
 }
 
 static void disp_imgbtn(void) {
@@ -423,9 +430,9 @@ static void disp_label(void) {
 
 	label_for_imgbtn_name(mks_global.mks_src_1, move_page.Label_back, move_page.Back, 0, 0, "Back");
 	
-	move_page.label_xpos = label_for_text(mks_global.mks_src_1, move_page.label_xpos, NULL, 93, 5, LV_ALIGN_IN_TOP_LEFT,  	"X:0");
-	move_page.label_ypos = label_for_text(mks_global.mks_src_1, move_page.label_ypos, NULL, 93, 36, LV_ALIGN_IN_TOP_LEFT,	"Y:0");
-	move_page.label_zpos = label_for_text(mks_global.mks_src_1, move_page.label_zpos, NULL, 93, 66, LV_ALIGN_IN_TOP_LEFT,  	"Z:0");
+	move_page.label_xpos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 5, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "X:0");
+	move_page.label_ypos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 36, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "Y:0");
+	move_page.label_zpos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 66, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "Z:0");
 
 	if(mks_grbl.move_dis == M_0_1_MM) {
 		move_page.label_len = mks_lvgl_long_sroll_label_with_wight_set_center(move_page.btn_len, move_page.label_len, 0, 0, "0.1mm", 50);
@@ -446,6 +453,116 @@ static void disp_label(void) {
 	infile_page.label_sculpture = mks_lvgl_long_sroll_label_with_wight_set_center(infile_page.btn_sculpture, infile_page.label_sculpture, 0, 0, "Sculpture", 100);
 }
 
+/* 
+ * Author   :MKS
+ * Describe :File preview. The thumbnail is made by the worker task (Worker.h), at a lower
+ *           priority than lvgl, from the path.pvw cache or by reading the file. It gives way
+ *           to a frame, a job or leaving the page: any of them stops the read within one block.
+ * Data     :2021/03/16
+*/
+static lv_color_t preview_buf[inFILE_PREVIEW_SIZE * inFILE_PREVIEW_SIZE];
+static lv_img_dsc_t preview_dsc;
+static char preview_path[128];
+static volatile uint32_t preview_gen;           // 每次请求加一, 旧的请求随之作废
+static volatile bool preview_pending;           // 已请求, 等待 worker 线程
+static volatile bool preview_running;
+static volatile bool preview_done;              // 预览图已生成, 等待lvgl线程显示
+static uint32_t preview_run_gen;
+static volatile bool preview_box_valid;         // 文件加工范围, 雕刻界面的轨迹按它缩放
+static float preview_box[4];
+
+static void preview_request(const char *fn) {
+	strncpy(preview_path, fn, sizeof(preview_path) - 1);
+	if(preview_path[0] != '/') preview_path[0] = '/';
+	preview_done = false;
+	preview_box_valid = false;
+	preview_gen++;
+	if(preview_pending == false) {
+		preview_pending = true;                 // 已排队时只换文件名
+		if(worker_submit("Preview", mks_preview_run) == false) {
+			preview_pending = false;
+		}
+	}
+}
+
+static bool preview_progress(uint32_t pos, uint32_t size) {
+	return worker_yield(pos, size)
+			&& (preview_run_gen == preview_gen) 
+			&& (mks_ui_page.mks_ui_page == MKS_UI_inFile)
+			&& ((sys.state == State::Idle) || (sys.state == State::Alarm) || (sys.state == State::Jog));
+}
+
+// 在 worker 线程中运行, 不能直接操作lvgl
+void mks_preview_run(void *arg) {
+
+	if(preview_pending == false) return;
+	preview_pending = false;
+	preview_run_gen = preview_gen;
+
+	if(get_sd_state(true) != SDState::Idle) {
+		return;
+	}
+	preview_running = true;
+	set_sd_state(SDState::BusyParsing);
+	Error err = sd_get_job_preview(SD, preview_path, (uint16_t*)preview_buf, inFILE_PREVIEW_SIZE, 
+									LV_COLOR_WHITE.full, LV_COLOR_MAKE(0x17, 0x1A, 0x26).full, preview_progress);
+	if((err == Error::Ok) && (preview_run_gen == preview_gen)) {
+		preview_done = true;
+	}
+	if(err == Error::Ok) {
+		sd_job_info_t info;
+		// 预览图做好后 path.idx 已经有了, 这里只读缓存
+		if((sd_get_job_info(SD, preview_path, &info, preview_progress) == Error::Ok) && (preview_run_gen == preview_gen)) {
+			preview_box[0] = info.x_min;
+			preview_box[1] = info.x_max;
+			preview_box[2] = info.y_min;
+			preview_box[3] = info.y_max;
+			preview_box_valid = true;
+		}
+		if(preview_run_gen == preview_gen) {
+			validate_request(preview_path);     // 机器空闲时后台检查文件, 见 Validate.h
+		}
+	}
+	set_sd_state(SDState::Idle);
+	preview_running = false;
+}
+
+// 预览过的文件的加工范围 {x_min, x_max, y_min, y_max}, 工件坐标
+bool mks_preview_job_box(const char *path, float *box) {
+
+	if((preview_box_valid == false) || (path[0] == 0)) return false;
+	if(strcmp(preview_path + 1, path + 1) != 0) return false;     // 首字符同 preview_request 一样不比
+	if((preview_box[0] >= preview_box[1]) || (preview_box[2] >= preview_box[3])) return false;
+	memcpy(box, preview_box, sizeof(preview_box));
+	return true;
+}
+
+// 开始雕刻前调用, 等预览线程放开SD卡
+void mks_preview_stop(void) {
+
+	preview_gen++;
+	preview_pending = false;
+	for(uint8_t i = 0; preview_running && (i < 100); i++) {
+		vTaskDelay(pdMS_TO_TICKS(5));
+	}
+}
+
+void infile_preview_updata(void) {
+
+	if(preview_done == false) return;
+	preview_done = false;
+
+	preview_dsc.header.always_zero = 0;
+	preview_dsc.header.w = inFILE_PREVIEW_SIZE;
+	preview_dsc.header.h = inFILE_PREVIEW_SIZE;
+	preview_dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
+	preview_dsc.data_size = sizeof(preview_buf);
+	preview_dsc.data = (const uint8_t *)preview_buf;
+	lv_img_cache_invalidate_src(&preview_dsc);
+	lv_img_set_src(infile_page.img_preview, &preview_dsc);
+	lv_obj_set_hidden(infile_page.img_preview, false);
+}
+
 void infile_clean_obj(lv_obj_t *obj_src) {
 	lv_obj_clean(obj_src);
 }
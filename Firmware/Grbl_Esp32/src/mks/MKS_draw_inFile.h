@@ -33,6 +33,10 @@ typedef enum {
     inFILE_BTN_SIZE_Y = 55,
     inFILE_BTN_X_OFFSET = inFILE_BTN_SIZE_X + 0,
     inFILE_BTN_Y_OFFSET = inFILE_BTN_SIZE_Y + 10,
+
+    inFILE_PREVIEW_X = 18,              // 方向键左上角的空位
+    inFILE_PREVIEW_Y = 12,
+    inFILE_PREVIEW_SIZE = 56,
 }inFILE_XY_POS;
 
 
@@ -80,6 +84,8 @@ typedef struct {
     lv_obj_t *label_len;                // 步长
     lv_obj_t *label_sculpture;
 
+    lv_obj_t *img_preview;              // 文件预览图
+
 }inFILE_PAGE_T;
 
 
@@ -88,4 +94,9 @@ void mks_draw_freaure(void);
 void mks_draw_setting(void);
 void infile_clean_obj(lv_obj_t *obj_src);
 void mks_draw_cavre_popup(char *fn);
+
+bool mks_preview_job_box(const char *path, float *box);
+void mks_preview_run(void *arg);
+void mks_preview_stop(void);
+void infile_preview_updata(void);
 #endif
\ No newline at end of file
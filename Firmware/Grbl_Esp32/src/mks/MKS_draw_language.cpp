@@ -93,6 +93,7 @@ static void set_language(uint8_t language) {
 		break;
 	}
 	mc_language_init();
+	mks_ready_release();		// 主界面的文字随语言重建
 }
 
 static void enent_handler_back(void) {
@@ -193,6 +194,6 @@ void draw_language(void) {
 }
 
 void mks_clear_language(void) {
-    lv_obj_clean(mks_global.mks_src);
+    mks_lv_clean_src();
 }
 
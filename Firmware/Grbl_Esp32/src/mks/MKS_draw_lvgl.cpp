@@ -327,10 +327,33 @@ lv_obj_t* mks_lv_bar_updata(lv_obj_t* bar, int16_t value) {
 }
 
 lv_obj_t* mks_lv_label_updata(lv_obj_t* lab, const char *str) {
+    const char* shown = lv_label_get_text(lab);
+    // Same text from another string: nothing to redraw. The same buffer may have been
+    // rewritten in place, so that is always redrawn.
+    if ((shown != str) && (shown != NULL) && (strcmp(shown, str) == 0)) {
+        return lab;
+    }
     lv_label_set_static_text(lab ,str);
     return lab;
 }
 
+/* 
+ * Describe :Updata a label showing buf, formatted into text first. The label is only
+ *           invalidated, and redrawn over SPI, when the text changes.
+*/
+lv_obj_t* mks_lv_label_updata_buf(lv_obj_t* lab, char* buf, size_t size, const char *text) {
+    if (lab == NULL) {
+        return lab;
+    }
+    if ((lv_label_get_text(lab) == buf) && (strcmp(buf, text) == 0)) {
+        return lab;
+    }
+    strncpy(buf, text, size - 1);
+    buf[size - 1] = '\0';
+    lv_label_set_static_text(lab, buf);
+    return lab;
+}
+
 /* 
  * Author   :MKS
  * Describe :Updata bar value
@@ -381,7 +404,59 @@ lv_obj_t* mks_lv_set_line(lv_obj_t* scr, lv_obj_t * line, lv_point_t *line_point
 
 void mks_lv_clean_ui(void) { 
     mks_grbl.popup_1_flag = false;
-    lv_obj_clean(mks_global.mks_src);
+    mks_lv_clean_src();
+}
+
+/* 
+ * Author   :MKS
+ * Describe :Clear the page off mks_src. The kept ready page is only hidden, everything else
+ *           is deleted. Pages must be cleared through here, lv_obj_clean() would delete the
+ *           ready page under ready_src.
+ * Data     :2021/03/16
+*/
+void mks_lv_clean_src(void) {
+
+    lv_obj_t* child = lv_obj_get_child(mks_global.mks_src, NULL);
+
+    mks_lv_mem_sample();       // 页面删除前, 记录该页面的内存占用峰值
+
+    while (child != NULL) {
+        lv_obj_t* next = lv_obj_get_child(mks_global.mks_src, child);
+        if (child == ready_src.ready_page) {
+            lv_obj_set_hidden(child, true);
+        } else {
+            lv_obj_del(child);
+        }
+        child = next;
+    }
+}
+
+MKS_LV_MEM_T mks_lv_mem;
+
+/* 
+ * Author   :MKS
+ * Describe :Record the LVGL heap use and its high water. lv_mem_monitor() walks the heap, so
+ *           it is only called from the display task, at page clear and once a second.
+ * Data     :2021/03/16
+*/
+void mks_lv_mem_sample(void) {
+
+    lv_mem_monitor_t mon;
+    uint32_t used;
+
+    lv_mem_monitor(&mon);
+    used = mon.total_size - mon.free_size;
+
+    mks_lv_mem.total_size = mon.total_size;
+    mks_lv_mem.used_size = used;
+    mks_lv_mem.free_biggest_size = mon.free_biggest_size;
+    mks_lv_mem.frag_pct = mon.frag_pct;
+    if (used > mks_lv_mem.used_max) {
+        mks_lv_mem.used_max = used;
+    }
+    if ((mks_lv_mem.free_biggest_min == 0) || (mon.free_biggest_size < mks_lv_mem.free_biggest_min)) {
+        mks_lv_mem.free_biggest_min = mon.free_biggest_size;
+    }
 }
 
 static void event_handler_globel_popup_sure(lv_obj_t* obj, lv_event_t event) { 
@@ -563,10 +638,44 @@ static void event_handler_cave_dec(lv_obj_t* obj, lv_event_t event) {
 	}
 }
 
+// 旋转工件: 开始前发 $Job/Transform, 绕预览的加工范围中心转, 不用重新上传文件
+static int16_t cavre_degrees;
+static lv_event_cb_t cavre_cb_yes;
+static lv_obj_t *cavre_btn_rotate;
+static lv_obj_t *cavre_label_rotate;
+
+static void event_handler_cave_rotate(lv_obj_t* obj, lv_event_t event) {
+
+	if (event == LV_EVENT_RELEASED) {
+		char buff[20];
+		cavre_degrees = (cavre_degrees + 90) % 360;
+		sprintf(buff, "rotate:%d", cavre_degrees);
+		lv_label_set_text(cavre_label_rotate, buff);
+	}
+}
+
+static void event_handler_cave_start(lv_obj_t* obj, lv_event_t event) {
+
+	if (event == LV_EVENT_RELEASED) {
+		char cmd[96];
+		float box[4];
+		float pivot_x = 0, pivot_y = 0;
+		if (mks_preview_job_box(file_print_send, box) == true) {
+			pivot_x = (box[0] + box[1]) / 2;
+			pivot_y = (box[2] + box[3]) / 2;
+		}
+		sprintf(cmd, "$Job/Transform=1,%d,0,0,%.3f,%.3f\n", cavre_degrees, pivot_x, pivot_y);
+		MKS_GRBL_CMD_SEND(cmd);			// 0度也发, 清掉上次的
+	}
+	cavre_cb_yes(obj, event);
+}
+
 void mks_draw_cavre_popup(char *fn, lv_event_cb_t event_cb_yes, lv_event_cb_t event_cb_no) {
 	
 	char buff[20];
 	mks_grbl.carve_times = 1;
+	cavre_degrees = 0;
+	cavre_cb_yes = event_cb_yes;
 
     if(cavre_pupop.mux == true) return;
     cavre_pupop.com_popup_src = lv_obj_create(mks_global.mks_src, NULL);
@@ -607,7 +716,7 @@ void mks_draw_cavre_popup(char *fn, lv_event_cb_t event_cb_yes, lv_event_cb_t ev
                         &confirm, 
                         LV_ALIGN_IN_LEFT_MID, 
                         print_pwr_popup_add_btn_x+160,
-                        print_pwr_popup_add_btn_y, event_cb_yes);
+                        print_pwr_popup_add_btn_y, event_handler_cave_start);
     
     cavre_pupop.btn_cancle = 
 	lv_imgbtn_creat_mks(cavre_pupop.com_popup_src, 
@@ -630,6 +739,18 @@ void mks_draw_cavre_popup(char *fn, lv_event_cb_t event_cb_yes, lv_event_cb_t ev
 											0,
 											0,
 											buff);
+
+	lv_style_copy(&cavre_pupop.com_btn_sytle, &lv_style_scr);
+	cavre_pupop.com_btn_sytle.body.main_color = LV_COLOR_MAKE(0x3F, 0x46, 0x66);
+	cavre_pupop.com_btn_sytle.body.grad_color = LV_COLOR_MAKE(0x3F, 0x46, 0x66);
+	cavre_pupop.com_btn_sytle.body.radius = 10;
+	cavre_pupop.com_btn_sytle.body.opa = LV_OPA_COVER;
+	cavre_pupop.com_btn_sytle.text.color = LV_COLOR_WHITE;
+
+	cavre_btn_rotate = mks_lv_btn_set_for_screen(cavre_pupop.com_popup_src, cavre_btn_rotate, 120, 30, 0, -65, event_handler_cave_rotate);
+	lv_btn_set_style(cavre_btn_rotate, LV_BTN_STYLE_REL, &cavre_pupop.com_btn_sytle);
+	lv_btn_set_style(cavre_btn_rotate, LV_BTN_STYLE_PR, &cavre_pupop.com_btn_sytle);
+	cavre_label_rotate = label_for_btn_name(cavre_btn_rotate, cavre_label_rotate, 0, 0, "rotate:0");
     cavre_pupop.mux = true;
 }
 
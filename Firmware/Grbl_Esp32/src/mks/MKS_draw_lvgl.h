@@ -16,8 +16,11 @@
 #include "MKS_draw_wifi.h"
 #include "MKS_draw_frame.h"
 #include "mks_ringbuff.h"
+#include "MKS_dro.h"
+#include "MKS_font_cache.h"
 #include "MKS_updata.h"
 #include "mks_test.h"
+#include "MKS_step_test.h"
 #include "draw_ui.h"
 
 #include "language_en.h"
@@ -84,6 +87,7 @@ lv_obj_t* mks_lvgl_long_sroll_label_with_wight_set(lv_obj_t* scr, lv_obj_t* lab,
 lv_obj_t* mks_lvgl_long_sroll_label_with_wight_set_center(lv_obj_t* scr, lv_obj_t* lab, lv_coord_t x, lv_coord_t y, const char* text, lv_coord_t w);
 lv_obj_t* mks_lv_static_label(lv_obj_t* scr, lv_obj_t* lab, lv_coord_t x, lv_coord_t y, const char* text, lv_coord_t w);
 lv_obj_t* mks_lv_label_updata(lv_obj_t* lab, const char *str);
+lv_obj_t* mks_lv_label_updata_buf(lv_obj_t* lab, char* buf, size_t size, const char *text);
 
 
 lv_obj_t* label_for_file(lv_obj_t* scr, lv_obj_t* lab, lv_coord_t x, lv_coord_t y, const char* text, lv_coord_t w);
@@ -131,6 +135,20 @@ void global_popup_del(void);
 void common_popup_com_del(void);
 void cavre_popup_del(void);
 void mks_lv_clean_ui(void);
+void mks_lv_clean_src(void);
+
+// LVGL 堆使用情况, 由 $UI/Mem 查看
+typedef struct {
+    uint32_t total_size;
+    uint32_t used_size;
+    uint32_t free_biggest_size;
+    uint8_t  frag_pct;
+    uint32_t used_max;              // 使用量最高值
+    uint32_t free_biggest_min;      // 最大空闲块的最低值
+}MKS_LV_MEM_T;
+extern MKS_LV_MEM_T mks_lv_mem;
+
+void mks_lv_mem_sample(void);
 uint8_t get_current_page(void);
 void disable_btn(void);
 #endif 
@@ -92,9 +92,17 @@ static void set_cooling(lv_obj_t* obj, lv_event_t event) {
 	}
 }
 
+static bool move_holding = false;	// A direction button is held down and jogs continuously
+
+static uint32_t get_move_speed(void) {
+	if(mks_grbl.move_speed == LOW_SPEED) 		return 500;
+	else if(mks_grbl.move_speed == MID_SPEED)	return 1000;
+	else if(mks_grbl.move_speed == HIGHT_SPEED)	return 2000;
+	return 1000;
+}
+
 void move_ctrl(char axis, uint8_t dir) {
 	float step;
-	uint32_t speed;
 
 	if(dir == 0) {
 		if(mks_grbl.move_dis == M_0_1_MM) 			step = -0.1;
@@ -106,11 +114,16 @@ void move_ctrl(char axis, uint8_t dir) {
 		else if(mks_grbl.move_dis == M_10_MM)		step = 10;
 	}
 	
-	if(mks_grbl.move_speed == LOW_SPEED) 		speed = 500;
-	else if(mks_grbl.move_speed == MID_SPEED)	speed = 1000;
-	else if(mks_grbl.move_speed == HIGHT_SPEED)	speed = 2000;
+	set_move(axis, step, get_move_speed());
+}
 
-	set_move(axis, step, speed);
+// Held down, a direction button jogs continuously with $JV, repeated on every long press
+// repeat to keep the stream alive, and stopped on release
+void move_hold(char axis, uint8_t dir) {
+	char str[30];
+	int speed = get_move_speed();
+	sprintf(str, "$JV=%c%d\n", axis, dir ? speed : -speed);
+	MKS_GRBL_CMD_SEND(str);
 }
 
 void mc_unlock(void) {
@@ -339,19 +352,42 @@ void set_move_back(void) {
         mks_draw_ready();
 }
 
-static void event_handler(lv_obj_t* obj, lv_event_t event) {
+static bool get_move_axis(uint8_t id, char* axis, uint8_t* dir) {
+	switch(id) {
+		case ID_M_UP	:	*axis = 'Y'; *dir = 1; return true;
+		case ID_M_DOWN	:	*axis = 'Y'; *dir = 0; return true;
+		case ID_M_LEFT	:	*axis = 'X'; *dir = 0; return true;
+		case ID_M_RIGHT	:	*axis = 'X'; *dir = 1; return true;
+		case ID_M_Z_UP	:	*axis = 'Z'; *dir = 1; return true;
+		case ID_M_Z_DOWN:	*axis = 'Z'; *dir = 0; return true;
+		default			:	return false;
+	}
+}
 
-	if(event != LV_EVENT_RELEASED) return;
+static void event_handler(lv_obj_t* obj, lv_event_t event) {
 
 	uint8_t id = get_event(obj);
+	char axis;
+	uint8_t dir;
+
+	if(get_move_axis(id, &axis, &dir)) {
+		if(event == LV_EVENT_LONG_PRESSED || event == LV_EVENT_LONG_PRESSED_REPEAT) {
+			move_holding = true;
+			move_hold(axis, dir);
+		}else if(event == LV_EVENT_RELEASED || event == LV_EVENT_PRESS_LOST) {
+			if(move_holding) {
+				move_holding = false;
+				MKS_GRBL_CMD_SEND("$JV\n");
+			}else if(event == LV_EVENT_RELEASED) {
+				move_ctrl(axis, dir);
+			}
+		}
+		return;
+	}
+
+	if(event != LV_EVENT_RELEASED) return;
 
 	switch(id) {
-		case ID_M_UP	:	move_ctrl('Y', 1); 	break;
-		case ID_M_DOWN	:	move_ctrl('Y', 0); 	break;
-		case ID_M_LEFT	:	move_ctrl('X', 0); 	break;
-		case ID_M_RIGHT	:	move_ctrl('X', 1); 	break;
-		case ID_M_Z_UP	:	move_ctrl('Z', 1);	break;
-		case ID_M_Z_DOWN:	move_ctrl('Z', 0);	break;
 		case ID_M_STEP	:	set_step_len();		break;
 		case ID_M_SPEED	:	set_speed();		break;
 		case ID_M_UNLOCK:	mc_unlock();		break;
@@ -483,19 +519,19 @@ void move_pos_update(void) {
     float* print_position = system_get_mpos();
 
 	mpos_to_wpos(print_position);
-	
-	sprintf(xpos_str, "X:%.1f", print_position[0]);
-    sprintf(ypos_str, "Y:%.1f", print_position[1]);
-    sprintf(zpos_str, "Z:%.1f", print_position[2]);
 
 	if( (move_page.label_xpos != NULL) && 
 		(move_page.label_ypos != NULL) &&
 		(move_page.label_zpos != NULL)
 	) {
-
-		lv_label_set_static_text(move_page.label_xpos, xpos_str);
-		lv_label_set_static_text(move_page.label_ypos, ypos_str);
-		lv_label_set_static_text(move_page.label_zpos, zpos_str);
+		char text[50];
+
+		snprintf(text, sizeof(text), "X:%.1f", print_position[0]);
+		mks_dro_set_text(move_page.label_xpos, text);
+		snprintf(text, sizeof(text), "Y:%.1f", print_position[1]);
+		mks_dro_set_text(move_page.label_ypos, text);
+		snprintf(text, sizeof(text), "Z:%.1f", print_position[2]);
+		mks_dro_set_text(move_page.label_zpos, text);
 	}
 }
 
@@ -540,9 +576,9 @@ static void disp_label(void) {
 
 	label_for_imgbtn_name(mks_global.mks_src_1, move_page.Label_back, move_page.Back, 0, 0, "Back");
 
-	move_page.label_xpos = label_for_text(mks_global.mks_src_1, move_page.label_xpos, NULL, 93, 5, LV_ALIGN_IN_TOP_LEFT,  	"X:0");
-	move_page.label_ypos = label_for_text(mks_global.mks_src_1, move_page.label_ypos, NULL, 93, 36, LV_ALIGN_IN_TOP_LEFT,	"Y:0");
-	move_page.label_zpos = label_for_text(mks_global.mks_src_1, move_page.label_zpos, NULL, 93, 66, LV_ALIGN_IN_TOP_LEFT,  	"Z:0");
+	move_page.label_xpos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 5, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "X:0");
+	move_page.label_ypos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 36, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "Y:0");
+	move_page.label_zpos = mks_dro_create(mks_global.mks_src_1, NULL, 93, 66, LV_ALIGN_IN_TOP_LEFT, MOVE_DRO_CHARS, "Z:0");
 
 	if(mks_grbl.move_dis == M_0_1_MM) {
 		move_page.label_len = mks_lvgl_long_sroll_label_with_wight_set_center(move_page.btn_len, move_page.label_len, 0, 0, "0.1mm", 50);
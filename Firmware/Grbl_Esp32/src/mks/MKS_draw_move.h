@@ -5,6 +5,7 @@
 #include "MKS_draw_lvgl.h"
 #include "MKS_LVGL.h"
 
+#define MOVE_DRO_CHARS      7       // Up to the XY clear button, "X:123.4"
 
 typedef enum {
 
@@ -137,6 +138,7 @@ void draw_pos_popup_2(const char *text);
 bool mks_get_motor_status(void);
 void set_click_status(bool status);
 void move_ctrl(char axis, uint8_t dir);
+void move_hold(char axis, uint8_t dir);
 void set_xy_home(void);
 void set_z_home(void);
 void move_pos_update(void);
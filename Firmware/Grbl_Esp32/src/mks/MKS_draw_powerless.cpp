@@ -3,6 +3,37 @@
 
 MKS_PL_T powerless;
 
+static_assert(sizeof(MKS_PL_RECORD_T) == PL_RECORD_SIZE, "power-loss record size");
+
+// Lines executed but not yet moved. A line is done once the planner has discarded every block
+// queued up to the end of it, which is when plan_path_head() reaches its tag.
+typedef struct {
+    uint32_t        tag;
+    MKS_PL_RECORD_T rec;                // 不含 path，写入时再填
+}MKS_PL_PENDING_T;
+
+static MKS_PL_PENDING_T pl_pending[PL_PENDING_NUM];
+static uint8_t          pl_pending_head;
+static uint8_t          pl_pending_count;
+static MKS_PL_RECORD_T  pl_done;        // 最近一条运动已完成的行
+static bool             pl_have_done;
+static File             pl_file;
+static uint32_t         pl_seq;
+static uint32_t         pl_write_ms;
+
+static uint32_t mks_powerless_hash(const MKS_PL_RECORD_T* rec) {
+    const uint8_t* p    = (const uint8_t*)rec;
+    uint32_t       hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(MKS_PL_RECORD_T, check); i++) {
+        hash = (hash ^ p[i]) * 16777619u;  // FNV-1a
+    }
+    return hash;
+}
+
+static bool mks_powerless_valid(const MKS_PL_RECORD_T* rec) {
+    return rec->magic == PL_RECORD_MAGIC && rec->check == mks_powerless_hash(rec) && rec->path[0] == '/';
+}
+
 void mks_powerless_init(void) {
 
     powerless.file_line = 0;
@@ -11,28 +42,135 @@ void mks_powerless_init(void) {
 }
 
 void mks_powerless_check(void) {
-    powerless.is_pl_flag = sd_file_check(PL_FILE_PATG);
+    MKS_PL_RECORD_T rec;
+    powerless.is_pl_flag = mks_powerless_load(&rec);
 
     if(powerless.is_pl_flag == true) {
-        grbl_send(CLIENT_SERIAL,"PLA file had found\n");
-        
-        
+        strncpy(powerless.pl_file_name, rec.path, sizeof(powerless.pl_file_name) - 1);
+        powerless.file_line = rec.file_line;
+        grbl_sendf(CLIENT_SERIAL, "PLA file had found: %s line %u\n", rec.path, rec.file_line);
     }
 }
 
+void mks_powerless_line_done(void) {
+    uint32_t pos;
+    if (!sd_get_resume_pos(&pos)) {
+        return;                         // 编译后的任务，偏移与源文件不对应
+    }
+    uint8_t index;
+    if (pl_pending_count == PL_PENDING_NUM) {
+        // Full: the newest entry is overwritten, which only makes the resume point coarser
+        index = (pl_pending_head + PL_PENDING_NUM - 1) % PL_PENDING_NUM;
+    } else {
+        index = (pl_pending_head + pl_pending_count++) % PL_PENDING_NUM;
+    }
+    MKS_PL_PENDING_T* p   = &pl_pending[index];
+    MKS_PL_RECORD_T*  rec = &p->rec;
+    // A line held back by mc_line() is one more block to come
+    p->tag                = plan_path_head() + plan_get_block_buffer_count() + (mc_line_pending() ? 1 : 0);
+    rec->file_pos         = pos;
+    rec->file_line        = sd_get_current_line_number();
+    memcpy(rec->position, gc_state.position, sizeof(rec->position));
+    memcpy(rec->coord_offset, gc_state.coord_offset, sizeof(rec->coord_offset));
+    rec->feed_rate        = gc_state.feed_rate;
+    rec->spindle_speed    = gc_state.spindle_speed;
+    rec->motion           = static_cast<uint8_t>(gc_state.modal.motion);
+    rec->units            = static_cast<uint8_t>(gc_state.modal.units);
+    rec->distance         = static_cast<uint8_t>(gc_state.modal.distance);
+    rec->feed_mode        = static_cast<uint8_t>(gc_state.modal.feed_rate);
+    rec->coord_select     = static_cast<uint8_t>(gc_state.modal.coord_select);
+    rec->spindle          = static_cast<uint8_t>(gc_state.modal.spindle);
+    rec->coolant_mist     = gc_state.modal.coolant.Mist;
+    rec->coolant_flood    = gc_state.modal.coolant.Flood;
+}
 
-void sd_read_line_num_change() {
-
-    if(powerless.is_pl_flag == true) {
-
-        sd_current_line_number = powerless.file_line;
-
-    }else {
+// Opens the record file for the job, creating it at full size so the slots never move
+static bool mks_powerless_open(void) {
+    if (pl_file) {
+        return true;
+    }
+    if (!SD.exists(PL_FILE_PATG)) {
+        File f = SD.open(PL_FILE_PATG, FILE_WRITE);
+        if (!f) {
+            return false;
+        }
+        MKS_PL_RECORD_T empty;
+        memset(&empty, 0, sizeof(empty));
+        for (int i = 0; i < PL_RECORD_NUM; i++) {
+            f.write((const uint8_t*)&empty, sizeof(empty));
+        }
+        f.close();
+    }
+    // Sequence numbers carry on from what is in the file, so the newest record stays newest
+    MKS_PL_RECORD_T rec;
+    pl_seq = mks_powerless_load(&rec) ? rec.seq : 0;
+    pl_file = SD.open(PL_FILE_PATG, "r+");
+    return (bool)pl_file;
+}
 
+void mks_powerless_update(void) {
+    while (pl_pending_count != 0 && (int32_t)(plan_path_head() - pl_pending[pl_pending_head].tag) >= 0) {
+        pl_done         = pl_pending[pl_pending_head].rec;
+        pl_have_done    = true;
+        pl_pending_head = (pl_pending_head + 1) % PL_PENDING_NUM;
+        pl_pending_count--;
+    }
+    if (!pl_have_done || millis() - pl_write_ms < PL_CHECKPOINT_MS) {
+        return;
+    }
+    pl_write_ms  = millis();
+    pl_have_done = false;
 
+    char name[256];
+    sd_get_current_filename(name);
+    if (strlen(name) >= PL_PATH_SIZE || !mks_powerless_open()) {
+        return;
     }
+    memset(pl_done.path, 0, sizeof(pl_done.path));
+    strcpy(pl_done.path, name);
+    memset(pl_done.reserved, 0, sizeof(pl_done.reserved));
+    pl_done.magic = PL_RECORD_MAGIC;
+    pl_done.seq   = ++pl_seq;
+    pl_done.check = mks_powerless_hash(&pl_done);
+    pl_file.seek((pl_seq % PL_RECORD_NUM) * PL_RECORD_SIZE);
+    pl_file.write((const uint8_t*)&pl_done, sizeof(pl_done));
+    pl_file.flush();
 }
 
+void mks_powerless_close(void) {
+    pl_pending_count = 0;
+    pl_have_done     = false;
+    if (pl_file) {
+        pl_file.close();
+    }
+}
 
+void mks_powerless_job_end(void) {
+    mks_powerless_close();
+    if (SD.exists(PL_FILE_PATG)) {
+        SD.remove(PL_FILE_PATG);
+    }
+}
 
-
+bool mks_powerless_load(MKS_PL_RECORD_T* rec) {
+    if (!SD.exists(PL_FILE_PATG)) {
+        return false;
+    }
+    File f = SD.open(PL_FILE_PATG);
+    if (!f) {
+        return false;
+    }
+    bool            found = false;
+    MKS_PL_RECORD_T slot;
+    for (int i = 0; i < PL_RECORD_NUM; i++) {
+        if (f.read((uint8_t*)&slot, sizeof(slot)) != sizeof(slot)) {
+            break;
+        }
+        if (mks_powerless_valid(&slot) && (!found || (int32_t)(slot.seq - rec->seq) > 0)) {
+            *rec  = slot;
+            found = true;
+        }
+    }
+    f.close();
+    return found;
+}
@@ -3,14 +3,64 @@
 
 #include "MKS_draw_lvgl.h"
 
-#define PL_FILE_PATG           "/PLA.txt"
+/*
+    Power-loss resume. While an SD job runs, the byte offset and modal state after the last line
+    whose motion has finished are saved every PL_CHECKPOINT_MS into a ring of fixed-size records
+    in PL_FILE_PATG. Each save goes to the next slot, so the writes are spread over the file
+    instead of rewriting one sector, and the newest record with a good check value wins. The
+    file stays open for the job and is removed when the job finishes. $SD/Resume moves back to
+    the saved position, restores the modes and seeks straight to the saved offset.
+*/
+#define PL_FILE_PATG            "/PLA.bin"
+#define PL_RECORD_NUM           16          // 环形记录数
+#define PL_RECORD_SIZE          256
+#define PL_RECORD_MAGIC         0x31414c50  // "PLA1"
+#define PL_CHECKPOINT_MS        300
+#define PL_PENDING_NUM          24          // 已执行但运动未完成的行
+#define PL_PATH_SIZE            (PL_RECORD_SIZE - 56 - 8 * MAX_N_AXIS)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                       // 写入序号，最大的为最新
+    uint32_t file_pos;                  // 下一行在文件中的字节偏移
+    uint32_t file_line;                 // 已完成的行数
+    float    position[MAX_N_AXIS];      // 机器坐标 (mm)
+    float    coord_offset[MAX_N_AXIS];  // G92 偏移 (mm)
+    float    feed_rate;                 // mm/min
+    float    spindle_speed;
+    uint8_t  motion;                    // Motion
+    uint8_t  units;                     // Units
+    uint8_t  distance;                  // Distance
+    uint8_t  feed_mode;                 // FeedRate
+    uint8_t  coord_select;              // CoordIndex
+    uint8_t  spindle;                   // SpindleState
+    uint8_t  coolant_mist;
+    uint8_t  coolant_flood;
+    uint8_t  reserved[20];
+    char     path[PL_PATH_SIZE];        // 任务文件
+    uint32_t check;                     // 以上所有字节的 FNV-1a
+}MKS_PL_RECORD_T;
 
 typedef struct {
 
     bool is_pl_flag;
     char pl_file_name[128];
-    uint32_t file_line;                 // 从PLA.txt文件中读取行数
+    uint32_t file_line;                 // 从PLA.bin文件中读取行数
 }MKS_PL_T;
+extern MKS_PL_T powerless;
+
+void mks_powerless_init(void);
+void mks_powerless_check(void);
 
+// Called by the SD loop after each line of the job has been executed
+void mks_powerless_line_done(void);
+// Called from the main loop, saves a record when one is due
+void mks_powerless_update(void);
+// The job finished normally, so there is nothing to resume
+void mks_powerless_job_end(void);
+// Closes the record file, before the card is unmounted
+void mks_powerless_close(void);
+// Newest good record on the card, false if there is none
+bool mks_powerless_load(MKS_PL_RECORD_T* rec);
 
 #endif
@@ -50,7 +50,7 @@ static void event_handler_suspend(lv_obj_t* obj, lv_event_t event) {
             lv_label_set_static_text(print_src.print_Label_p_suspend, "Star");
             MKS_GRBL_CMD_SEND("~");
             if(print_setting._need_to_start_write) {
-                sys_rt_s_override = print_setting.cur_spindle_pwr;
+                set_spindle_override(print_setting.cur_spindle_pwr);
             }
         }   
         else if(sys.state == State::Cycle)    {
@@ -84,6 +84,16 @@ static void event_handler_adj(lv_obj_t* obj, lv_event_t event) {
     }
 }
 
+static void print_path_init(void);
+static void print_path_show(bool show);
+static bool path_show = false;              // 记住上次的选择
+
+static void event_handler_path(lv_obj_t* obj, lv_event_t event) {
+    if (event == LV_EVENT_RELEASED) {
+        print_path_show(!path_show);
+    }
+}
+
 static void event_handler_none(lv_obj_t* obj, lv_event_t event) {
     if (event == LV_EVENT_RELEASED) {
 
@@ -137,6 +147,8 @@ void mks_draw_print(void) {
 
     lv_bar_set_style(print_src.print_bar_print, LV_BAR_STYLE_BG , &print_src.print_bar_bg_style);
     lv_bar_set_style(print_src.print_bar_print, LV_BAR_STYLE_INDIC , &print_src.print_bar_indic_style);
+    lv_obj_set_click(print_src.print_bar_print, true);
+    lv_obj_set_event_cb(print_src.print_bar_print, event_handler_path);
 
     print_src.print_Label_p_suspend = label_for_imgbtn_name_mid(mks_global.mks_src, print_src.print_Label_p_suspend, print_src.print_imgbtn_suspend ,-35 ,0 ,"Pause");
     print_src.print_Label_p_stop = label_for_imgbtn_name_mid(mks_global.mks_src, print_src.print_Label_p_stop, print_src.print_imgbtn_stop ,-40 ,0 ,"Stop");
@@ -153,6 +165,8 @@ void mks_draw_print(void) {
 
     print_src.print_bar_print_percen = label_for_btn_name(print_src.print_bar_print, print_src.print_bar_print_percen, 190, 0, "0%");
 
+    print_path_init();
+
     mks_ui_page.mks_ui_page = MKS_UI_Pring;  //进入雕刻界面
 	mks_ui_page.wait_count = DEFAULT_UI_COUNT;
 }
@@ -283,8 +297,14 @@ void mks_draw_finsh_pupop(void) {
 char bar_percen_str[20];
 void mks_print_bar_updata(void) {
     print_src.print_bar_print = mks_lv_bar_updata(print_src.print_bar_print, (uint16_t)sd_report_perc_complete());
-    sprintf(bar_percen_str, "%d%%", (uint16_t)sd_report_perc_complete());
-    print_src.print_bar_print_percen = mks_lv_label_updata(print_src.print_bar_print_percen, bar_percen_str);
+    char text[20];
+    int32_t left = sd_report_remaining_seconds();      // 文件检查过才有时间估计
+    if(left >= 0) {
+        snprintf(text, sizeof(text), "%d%% %d:%02d:%02d", (uint16_t)sd_report_perc_complete(), left / 3600, left / 60 % 60, left % 60);
+    }else {
+        sprintf(text, "%d%%", (uint16_t)sd_report_perc_complete());
+    }
+    print_src.print_bar_print_percen = mks_lv_label_updata_buf(print_src.print_bar_print_percen, bar_percen_str, sizeof(bar_percen_str), text);
 }
 
 /****************************************************************************************pwr_popup****************************************************************************************/
@@ -382,7 +402,7 @@ static void event_pwr_setting_confirm(lv_obj_t* obj, lv_event_t event) {
         if(sys.state == State::Hold) {
             print_setting._need_to_start_write = true;
         }else{
-            sys_rt_s_override = print_setting.cur_spindle_pwr;
+            set_spindle_override(print_setting.cur_spindle_pwr);
         }
 
         lv_obj_set_click(print_src.print_imgbtn_suspend, true);
@@ -539,7 +559,7 @@ static void event_speed_setting_dec(lv_obj_t* obj, lv_event_t event) {
 static void event_speed_setting_confirm(lv_obj_t* obj, lv_event_t event) {
     if (event == LV_EVENT_RELEASED) {
 
-        sys_rt_f_override = print_setting.cur_spindle_speed;
+        set_feed_override(print_setting.cur_spindle_speed);
 
         lv_obj_set_click(print_src.print_imgbtn_suspend, true);
         lv_obj_set_click(print_src.print_imgbtn_stop, true);
@@ -874,9 +894,9 @@ static void sp_add_dec(uint8_t num, uint8_t step, bool dir) {
 
 static void set_comfirm(uint8_t num) {
     grbl_sendf(CLIENT_SERIAL, "Set num:%d\n", num);
-    if(num == 0) sys_rt_s_override = print_setting.cur_spindle_pwr;
-    else if(num == 1) sys_rt_f_override = print_setting.cur_spindle_speed;
-    else if(num == 2) sys_rt_r_override = print_setting.cur_spindle_rapid;
+    if(num == 0) set_spindle_override(print_setting.cur_spindle_pwr);
+    else if(num == 1) set_feed_override(print_setting.cur_spindle_speed);
+    else if(num == 2) set_rapid_override(print_setting.cur_spindle_rapid);
 }
 
 
@@ -1030,14 +1050,16 @@ void set_print_click(bool status) {
 char pl_info[128];
 void mks_print_data_updata(void) {
 
-    sprintf(print_data_updata.print_pwr_str, "S:%d%%", sys_rt_s_override);
-    print_src.print_Label_power = mks_lv_label_updata(print_src.print_Label_power, print_data_updata.print_pwr_str);
+    char text[10];
 
-    sprintf(print_data_updata.print_speed_str, "F:%2d%%", sys_rt_f_override);  
-    print_src.print_Label_caveSpeed = mks_lv_label_updata(print_src.print_Label_caveSpeed, print_data_updata.print_speed_str);
+    snprintf(text, sizeof(text), "S:%d%%", sys_rt_s_override);
+    print_src.print_Label_power = mks_lv_label_updata_buf(print_src.print_Label_power, print_data_updata.print_pwr_str, sizeof(print_data_updata.print_pwr_str), text);
 
-    sprintf(print_data_updata.print_rapid_str, "R:%2d%%", sys_rt_r_override);
-    print_src.print_Label_caveR = mks_lv_label_updata(print_src.print_Label_caveR, print_data_updata.print_rapid_str);
+    snprintf(text, sizeof(text), "F:%2d%%", sys_rt_f_override);
+    print_src.print_Label_caveSpeed = mks_lv_label_updata_buf(print_src.print_Label_caveSpeed, print_data_updata.print_speed_str, sizeof(print_data_updata.print_speed_str), text);
+
+    snprintf(text, sizeof(text), "R:%2d%%", sys_rt_r_override);
+    print_src.print_Label_caveR = mks_lv_label_updata_buf(print_src.print_Label_caveR, print_data_updata.print_rapid_str, sizeof(print_data_updata.print_rapid_str), text);
 
     if (SD_ready_next == false) {
         if (mks_grbl.is_mks_ts35_flag == true) {
@@ -1058,9 +1080,156 @@ uint8_t get_print_power(void) {
 
 
 void mks_clear_print(void) {
-    lv_obj_clean(mks_global.mks_src);
+    mks_lv_clean_src();
 }
 
 void mks_del_obj(lv_obj_t *obj) { 
     lv_obj_del(obj);
-}
\ No newline at end of file
+}
+
+
+/*
+ * Author   :MKS
+ * Describe :Live toolpath. The planner logs the XY end point of every block it hands to the
+ *           stepper, so the log runs at most the segment buffer ahead of the tool. Each pass of
+ *           the display loop draws only the new lines straight into a 1 bit canvas buffer and
+ *           invalidates the box around them, so the view costs little enough to leave open for
+ *           the whole job.
+ * Data     :2021/03/16
+*/
+#define PATH_REFR_MS            100         // 合并多次画线后再刷新
+
+static uint8_t path_buf[LV_CANVAS_BUF_SIZE_INDEXED_1BIT(print_path_size_x, print_path_size_y)];
+static uint32_t path_index;                 // 已画到规划器轨迹记录的哪一点
+static int16_t path_last_x, path_last_y;
+static float path_scale, path_min_x, path_max_y;
+static int16_t path_offset_x, path_offset_y;
+static lv_area_t path_dirty;
+static bool path_dirty_valid;
+static uint32_t path_refr_ms;
+
+// 机器坐标步数转为画布像素
+static void path_steps_to_px(const int32_t* xy_steps, int16_t* px, int16_t* py) {
+    int32_t steps[MAX_N_AXIS] = { 0 };
+    float mpos[MAX_N_AXIS];
+    float* wco = get_wco();
+
+    steps[X_AXIS] = xy_steps[0];
+    steps[Y_AXIS] = xy_steps[1];
+    system_convert_array_steps_to_mpos(mpos, steps);
+    // 画布外的点限制在附近, 线段不会太长
+    *px = path_offset_x + (int16_t)constrain((mpos[X_AXIS] - wco[X_AXIS] - path_min_x) * path_scale, -1024.0f, 2048.0f);
+    *py = path_offset_y + (int16_t)constrain((path_max_y - (mpos[Y_AXIS] - wco[Y_AXIS])) * path_scale, -1024.0f, 2048.0f);
+}
+
+static void path_set_px(int16_t x, int16_t y) {
+    if ((x < 0) || (y < 0) || (x >= print_path_size_x) || (y >= print_path_size_y)) {
+        return;
+    }
+    uint8_t* bits = path_buf + sizeof(lv_color32_t) * 2;  // 跳过调色板
+    bits[((print_path_size_x + 7) >> 3) * y + (x >> 3)] |= 0x80 >> (x & 7);
+}
+
+static void path_draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    int16_t dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+    int16_t dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+    int16_t err = dx + dy;
+    lv_area_t area = { LV_MATH_MIN(x0, x1), LV_MATH_MIN(y0, y1), LV_MATH_MAX(x0, x1), LV_MATH_MAX(y0, y1) };
+
+    while (1) {
+        path_set_px(x0, y0);
+        if ((x0 == x1) && (y0 == y1)) break;
+        int16_t e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+
+    if (path_dirty_valid == false) {
+        path_dirty = area;
+        path_dirty_valid = true;
+    } else {
+        path_dirty.x1 = LV_MATH_MIN(path_dirty.x1, area.x1);
+        path_dirty.y1 = LV_MATH_MIN(path_dirty.y1, area.y1);
+        path_dirty.x2 = LV_MATH_MAX(path_dirty.x2, area.x2);
+        path_dirty.y2 = LV_MATH_MAX(path_dirty.y2, area.y2);
+    }
+}
+
+// 用文件的加工范围定比例, 没有就用整个行程
+static void path_set_extents(void) {
+    float box[4];
+    float* wco = get_wco();
+
+    if (mks_preview_job_box(file_print_send, box) == false) {
+        box[0] = limitsMinPosition(X_AXIS) - wco[X_AXIS];
+        box[1] = limitsMaxPosition(X_AXIS) - wco[X_AXIS];
+        box[2] = limitsMinPosition(Y_AXIS) - wco[Y_AXIS];
+        box[3] = limitsMaxPosition(Y_AXIS) - wco[Y_AXIS];
+    }
+    float width = box[1] - box[0];
+    float height = box[3] - box[2];
+
+    path_scale = 1.0f;
+    if ((width > 0) && (height > 0)) {
+        path_scale = LV_MATH_MIN((print_path_size_x - 1) / width, (print_path_size_y - 1) / height);
+    }
+    path_min_x = box[0];
+    path_max_y = box[3];
+    path_offset_x = (int16_t)((print_path_size_x - 1) - width * path_scale) / 2;
+    path_offset_y = (int16_t)((print_path_size_y - 1) - height * path_scale) / 2;
+}
+
+static void print_path_init(void) {
+    int32_t xy_steps[2];
+
+    memset(path_buf, 0, sizeof(path_buf));
+    print_src.print_canvas = lv_canvas_create(mks_global.mks_src, NULL);
+    lv_canvas_set_buffer(print_src.print_canvas, path_buf, print_path_size_x, print_path_size_y, LV_IMG_CF_INDEXED_1BIT);
+    lv_canvas_set_palette(print_src.print_canvas, 0, LV_COLOR_MAKE(0x17, 0x1A, 0x26));
+    lv_canvas_set_palette(print_src.print_canvas, 1, LV_COLOR_MAKE(0x52, 0xCC, 0x82));
+    lv_obj_set_pos(print_src.print_canvas, print_path_x, print_path_y);
+    lv_obj_set_click(print_src.print_canvas, true);
+    lv_obj_set_event_cb(print_src.print_canvas, event_handler_path);
+    lv_obj_set_hidden(print_src.print_canvas, !path_show);
+
+    path_set_extents();
+    path_index = plan_path_head();
+    xy_steps[0] = sys_position[X_AXIS];
+    xy_steps[1] = sys_position[Y_AXIS];
+    path_steps_to_px(xy_steps, &path_last_x, &path_last_y);
+    path_dirty_valid = false;
+}
+
+static void print_path_show(bool show) {
+    path_show = show;
+    lv_obj_set_hidden(print_src.print_canvas, !show);
+}
+
+// 每次显示循环调用, 只画新增的线段
+void mks_print_path_updata(void) {
+    plan_path_point_t point;
+    int16_t x, y;
+
+    while (plan_path_read(&path_index, &point)) {
+        path_steps_to_px(point.xy_steps, &x, &y);
+        if (point.cut) {
+            path_draw_line(path_last_x, path_last_y, x, y);
+        }
+        path_last_x = x;
+        path_last_y = y;
+    }
+
+    if ((path_dirty_valid == false) || ((millis() - path_refr_ms) < PATH_REFR_MS)) {
+        return;
+    }
+    path_refr_ms = millis();
+    path_dirty_valid = false;
+    if (lv_obj_get_hidden(print_src.print_canvas) == false) {
+        lv_area_t area;
+        area.x1 = print_src.print_canvas->coords.x1 + LV_MATH_MAX(path_dirty.x1, 0);
+        area.y1 = print_src.print_canvas->coords.y1 + LV_MATH_MAX(path_dirty.y1, 0);
+        area.x2 = print_src.print_canvas->coords.x1 + LV_MATH_MIN(path_dirty.x2, print_path_size_x - 1);
+        area.y2 = print_src.print_canvas->coords.y1 + LV_MATH_MIN(path_dirty.y2, print_path_size_y - 1);
+        lv_inv_area(NULL, &area);
+    }
+}
@@ -52,6 +52,11 @@ typedef enum {
 
     print_src2_first_pic_x = 70,
     print_src2_first_pic_y = 95,
+
+    print_path_x = 48,
+    print_path_y = 104,
+    print_path_size_x = 384,
+    print_path_size_y = 136,
     
 }PRINT_XY_t;
 
@@ -103,6 +108,9 @@ typedef struct {
     lv_obj_t* print_bar_print;              //打印进度条
     lv_obj_t* print_bar_print_percen;       //打印进度
 
+    /* canvas */
+    lv_obj_t* print_canvas;                 //实时轨迹, 点进度条显示
+
     //样式
     lv_style_t printf_src_bg;   
     lv_style_t printf_popup_style;
@@ -197,6 +205,7 @@ void mks_draw_print_popup(const char* text);
 void mks_del_obj(lv_obj_t *obj);
 void mks_draw_finsh_pupop(void);
 void mks_print_bar_updata(void);
+void mks_print_path_updata(void);
 void mks_draw_operation(void);
 void mks_print_pwr_set(void);
 void mks_print_speed_set(void);
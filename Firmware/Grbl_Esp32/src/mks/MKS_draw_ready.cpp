@@ -2,10 +2,12 @@
 
 MKS_PAGE_READY ready_src;
 lv_style_t bkl_color;    // main
+static int8_t wifi_shown = -1;  // WiFi status on the label, -1 on a new page
 
 static void disp_imgbtn(void);
 static void disp_label(void);
 static void disp_img(void);
+static void disp_wifi_status(void);
 
 enum {
     ID_R_CONTRL,
@@ -73,11 +75,31 @@ void mks_draw_logo(void) {
     logo = mks_lvgl_img_set(mks_global.mks_src, logo, &mks_logo, 0 ,0);
 }
 
+/* 
+ * Author   :MKS
+ * Describe :The ready page is the hub every other page returns to, so its objects are built
+ *           once inside ready_src.ready_page and kept. mks_lv_clean_ui() hides that container
+ *           instead of deleting it, and showing the page again only unhides it.
+ * Data     :2021/03/16
+*/
 void mks_draw_ready(void) {
 
     mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
 
-    mks_global.mks_src_1 = lv_obj_create(mks_global.mks_src, NULL);
+    if (ready_src.ready_page != NULL) {
+        disp_wifi_status();
+        lv_obj_set_hidden(ready_src.ready_page, false);
+        mks_ui_page.mks_ui_page = MKS_UI_Ready;
+        return;
+    }
+
+    ready_src.ready_page = lv_obj_create(mks_global.mks_src, NULL);
+    wifi_shown = -1;
+    lv_obj_set_size(ready_src.ready_page, LV_HOR_RES_MAX, LV_VER_RES_MAX);
+    lv_obj_set_pos(ready_src.ready_page, 0, 0);
+    lv_obj_set_style(ready_src.ready_page, &lv_style_transp);
+
+    mks_global.mks_src_1 = lv_obj_create(ready_src.ready_page, NULL);
     lv_obj_set_size(mks_global.mks_src_1, READY_src1_x_size, READY_src1_y_size);
     lv_obj_set_pos(mks_global.mks_src_1, READY_src1_x, READY_src1_y);
     lv_obj_set_style(mks_global.mks_src_1 ,&mks_global.mks_src_1_style);
@@ -89,13 +111,39 @@ void mks_draw_ready(void) {
     mks_ui_page.mks_ui_page = MKS_UI_Ready;
 }
 
+/* 
+ * Author   :MKS
+ * Describe :Drop the kept ready page, so the next mks_draw_ready() builds it again. Needed
+ *           when its fixed texts change, like after a language switch.
+ * Data     :2021/03/16
+*/
+void mks_ready_release(void) {
+
+    if (ready_src.ready_page != NULL) {
+        lv_obj_del(ready_src.ready_page);
+        memset(&ready_src, 0, sizeof(ready_src));
+    }
+}
+
+static void disp_wifi_status(void) {
+
+    if (mks_get_wifi_status() == false){ 
+        lv_imgbtn_set_src(ready_src.ready_imgbtn_wifi_status, LV_BTN_STATE_PR, &png_wifi_disconnect);
+        lv_imgbtn_set_src(ready_src.ready_imgbtn_wifi_status, LV_BTN_STATE_REL, &png_wifi_disconnect);
+    }
+    else{
+        lv_imgbtn_set_src(ready_src.ready_imgbtn_wifi_status, LV_BTN_STATE_PR, &png_wifi_connect);
+        lv_imgbtn_set_src(ready_src.ready_imgbtn_wifi_status, LV_BTN_STATE_REL, &png_wifi_connect);
+    }
+}
+
 static void disp_imgbtn(void) {
 
     if (mks_get_wifi_status() == false){ 
-        ready_src.ready_imgbtn_wifi_status = lv_imgbtn_creat_n_mks(mks_global.mks_src ,ready_src.ready_imgbtn_wifi_status, &png_wifi_disconnect, &png_wifi_disconnect, 0, 0, event_handler);
+        ready_src.ready_imgbtn_wifi_status = lv_imgbtn_creat_n_mks(ready_src.ready_page ,ready_src.ready_imgbtn_wifi_status, &png_wifi_disconnect, &png_wifi_disconnect, 0, 0, event_handler);
     }
     else{
-        ready_src.ready_imgbtn_wifi_status = lv_imgbtn_creat_n_mks(mks_global.mks_src ,ready_src.ready_imgbtn_wifi_status, &png_wifi_connect, &png_wifi_connect, 0, 0, event_handler);
+        ready_src.ready_imgbtn_wifi_status = lv_imgbtn_creat_n_mks(ready_src.ready_page ,ready_src.ready_imgbtn_wifi_status, &png_wifi_connect, &png_wifi_connect, 0, 0, event_handler);
     }
 
     ready_src.ready_imgbtn_Control = lv_imgbtn_creat_mks(mks_global.mks_src_1, ready_src.ready_imgbtn_Control, &png_ctrl_pre, &Control, LV_ALIGN_IN_TOP_LEFT,102, 10, event_handler);
@@ -105,8 +153,8 @@ static void disp_imgbtn(void) {
 
 static void disp_img(void) {
 
-    ready_src.ready_img_wpos = mks_lvgl_img_set_algin(mks_global.mks_src ,ready_src.ready_img_wpos, &png_w_pos, LV_ALIGN_IN_TOP_LEFT, 20, 40);
-    ready_src.ready_img_mpos = mks_lvgl_img_set_algin(mks_global.mks_src ,ready_src.ready_img_mpos, &png_m_pos, LV_ALIGN_IN_TOP_LEFT, 250, 40);
+    ready_src.ready_img_wpos = mks_lvgl_img_set_algin(ready_src.ready_page ,ready_src.ready_img_wpos, &png_w_pos, LV_ALIGN_IN_TOP_LEFT, 20, 40);
+    ready_src.ready_img_mpos = mks_lvgl_img_set_algin(ready_src.ready_page ,ready_src.ready_img_mpos, &png_m_pos, LV_ALIGN_IN_TOP_LEFT, 250, 40);
 }
 
 
@@ -116,24 +164,24 @@ static void disp_label(void) {
     label_for_imgbtn_name(mks_global.mks_src_1, ready_src.ready_label_Sculpture, ready_src.ready_imgbtn_Sculpture, 0, 0, mc_language.sculpture);
     label_for_imgbtn_name(mks_global.mks_src_1, ready_src.ready_label_Tool, ready_src.ready_imgbtn_Tool, 0, 0, mc_language.tool);
 
-    label_for_text(mks_global.mks_src, ready_src.ready_label_mpos, ready_src.ready_img_mpos, 0, 0, LV_ALIGN_OUT_RIGHT_MID, mc_language.Mpos);
-    label_for_text(mks_global.mks_src, ready_src.ready_label_wpos, ready_src.ready_img_wpos, 0, 0, LV_ALIGN_OUT_RIGHT_MID, mc_language.Wpos);
+    label_for_text(ready_src.ready_page, ready_src.ready_label_mpos, ready_src.ready_img_mpos, 0, 0, LV_ALIGN_OUT_RIGHT_MID, mc_language.Mpos);
+    label_for_text(ready_src.ready_page, ready_src.ready_label_wpos, ready_src.ready_img_wpos, 0, 0, LV_ALIGN_OUT_RIGHT_MID, mc_language.Wpos);
 
 
-    ready_src.ready_label_xpos = label_for_text(mks_global.mks_src,   ready_src.ready_label_xpos, NULL , 40, 86,  LV_ALIGN_IN_TOP_LEFT, "X:0");
-    ready_src.ready_label_ypos = label_for_text(mks_global.mks_src,   ready_src.ready_label_ypos, NULL , 40, 126, LV_ALIGN_IN_TOP_LEFT, "Y:0");
-    ready_src.ready_label_zpos = label_for_text(mks_global.mks_src,   ready_src.ready_label_zpos, NULL , 40, 166, LV_ALIGN_IN_TOP_LEFT, "Z:0");
+    ready_src.ready_label_xpos = mks_dro_create(ready_src.ready_page, NULL, 40, 86,  LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "X:0");
+    ready_src.ready_label_ypos = mks_dro_create(ready_src.ready_page, NULL, 40, 126, LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "Y:0");
+    ready_src.ready_label_zpos = mks_dro_create(ready_src.ready_page, NULL, 40, 166, LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "Z:0");
 
-    ready_src.ready_label_m_xpos = label_for_text(mks_global.mks_src,   ready_src.ready_label_m_xpos, NULL , 280, 86,  LV_ALIGN_IN_TOP_LEFT, "X:0");
-    ready_src.ready_label_m_ypos = label_for_text(mks_global.mks_src,   ready_src.ready_label_m_ypos, NULL , 280, 126, LV_ALIGN_IN_TOP_LEFT, "Y:0");
-    ready_src.ready_label_m_zpos = label_for_text(mks_global.mks_src,   ready_src.ready_label_m_zpos, NULL , 280, 166, LV_ALIGN_IN_TOP_LEFT, "Z:0");
+    ready_src.ready_label_m_xpos = mks_dro_create(ready_src.ready_page, NULL, 280, 86,  LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "X:0");
+    ready_src.ready_label_m_ypos = mks_dro_create(ready_src.ready_page, NULL, 280, 126, LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "Y:0");
+    ready_src.ready_label_m_zpos = mks_dro_create(ready_src.ready_page, NULL, 280, 166, LV_ALIGN_IN_TOP_LEFT, READY_DRO_CHARS, "Z:0");
 
 
     #if defined(ENABLE_WIFI)
         if (mks_get_wifi_status() == false){ 
-            ready_src.ready_label_wifi_status = label_for_text(mks_global.mks_src, ready_src.ready_label_wifi_status, NULL, 34, 6, LV_ALIGN_IN_TOP_LEFT, mc_language.wifi_disconnect);
+            ready_src.ready_label_wifi_status = label_for_text(ready_src.ready_page, ready_src.ready_label_wifi_status, NULL, 34, 6, LV_ALIGN_IN_TOP_LEFT, mc_language.wifi_disconnect);
         }else {
-            ready_src.ready_label_wifi_status = label_for_text(mks_global.mks_src, ready_src.ready_label_wifi_status, NULL, 34, 6, LV_ALIGN_IN_TOP_LEFT, mc_language.wifi_connect);
+            ready_src.ready_label_wifi_status = label_for_text(ready_src.ready_page, ready_src.ready_label_wifi_status, NULL, 34, 6, LV_ALIGN_IN_TOP_LEFT, mc_language.wifi_connect);
         }
     #else 
         // ready_src.ready_label_wifi_status = mks_lv_static_label(ready_src.ready_btn_wifi, ready_src.ready_label_wifi_status, 40, 0, "Disconnect", 110);
@@ -141,14 +189,6 @@ static void disp_label(void) {
     #endif
 }
 
-char xpos_str[50] = "X:0.0";
-char ypos_str[50] = "Y:0.0";
-char zpos_str[50] = "Z:0.0";
-
-char m_xpos_str[50] = "X:0.0";
-char m_ypos_str[50] = "Y:0.0";
-char m_zpos_str[50] = "Z:0.0";
-
 char wifi_status_str[50];
 char wifi_ip_str[100];
 
@@ -165,30 +205,34 @@ void ready_data_updata(void) {
     static uint8_t wifi_ref_count = 0;
     static float mks_print_position[MAX_N_AXIS];
     float* print_position = system_get_mpos();
+    char text[50];
 
-    sprintf(xpos_str, "X:%.1f", print_position[0]);
-    sprintf(ypos_str, "Y:%.1f", print_position[1]);
-    sprintf(zpos_str, "Z:%.1f", print_position[2]);
-
-    lv_label_set_static_text(ready_src.ready_label_m_xpos, xpos_str);
-    lv_label_set_static_text(ready_src.ready_label_m_ypos, ypos_str);
-    lv_label_set_static_text(ready_src.ready_label_m_zpos, zpos_str);
+    snprintf(text, sizeof(text), "X:%.1f", print_position[0]);
+    mks_dro_set_text(ready_src.ready_label_m_xpos, text);
+    snprintf(text, sizeof(text), "Y:%.1f", print_position[1]);
+    mks_dro_set_text(ready_src.ready_label_m_ypos, text);
+    snprintf(text, sizeof(text), "Z:%.1f", print_position[2]);
+    mks_dro_set_text(ready_src.ready_label_m_zpos, text);
 
     mpos_to_wpos(print_position);
-    sprintf(m_xpos_str, "X:%.1f", print_position[0]);
-    sprintf(m_ypos_str, "Y:%.1f", print_position[1]);
-    sprintf(m_zpos_str, "Z:%.1f", print_position[2]);
-
-    lv_label_set_static_text(ready_src.ready_label_xpos, m_xpos_str);
-    lv_label_set_static_text(ready_src.ready_label_ypos, m_ypos_str);
-    lv_label_set_static_text(ready_src.ready_label_zpos, m_zpos_str);
+    snprintf(text, sizeof(text), "X:%.1f", print_position[0]);
+    mks_dro_set_text(ready_src.ready_label_xpos, text);
+    snprintf(text, sizeof(text), "Y:%.1f", print_position[1]);
+    mks_dro_set_text(ready_src.ready_label_ypos, text);
+    snprintf(text, sizeof(text), "Z:%.1f", print_position[2]);
+    mks_dro_set_text(ready_src.ready_label_zpos, text);
     
     #if defined(ENABLE_WIFI)
-    if (mks_get_wifi_status() == false){
-        ready_src.ready_label_wifi_status = mks_lv_label_updata(ready_src.ready_label_wifi_status, "WIFI:Disconnect");
-    }
-    else {
-        ready_src.ready_label_wifi_status = mks_lv_label_updata(ready_src.ready_label_wifi_status, "WIFI:Connect");
+    // Set again only when it changes, as this runs at the position rate
+    bool wifi = mks_get_wifi_status();
+    if ((wifi_shown < 0) || (wifi != (bool)wifi_shown)) {
+        wifi_shown = wifi;
+        if (wifi == false){
+            ready_src.ready_label_wifi_status = mks_lv_label_updata(ready_src.ready_label_wifi_status, "WIFI:Disconnect");
+        }
+        else {
+            ready_src.ready_label_wifi_status = mks_lv_label_updata(ready_src.ready_label_wifi_status, "WIFI:Connect");
+        }
     }
     #endif
 }
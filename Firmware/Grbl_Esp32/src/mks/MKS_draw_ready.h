@@ -7,9 +7,7 @@
 
 #define LV_DESKTOP      lv_disp_get_scr_act(NULL)
 
-extern char xpos_str[50];
-extern char ypos_str[50];
-extern char zpos_str[50];
+#define READY_DRO_CHARS     10      // "X:-1234.5" and one over
 
 typedef enum {
 
@@ -35,6 +33,8 @@ typedef enum {
 
 typedef struct {
 
+    lv_obj_t* ready_page;               // 主界面常驻, 切换页面时只隐藏
+
     // lv_obj_t* ready_imgbtn_Adjustment;  //用于创建图片按键
     lv_obj_t* ready_imgbtn_Control;
     lv_obj_t* ready_imgbtn_Sculpture;
@@ -81,6 +81,7 @@ typedef struct {
 
 
 void mks_draw_ready(void);
+void mks_ready_release(void);
 void ready_data_updata(void);
 void mks_draw_logo(void);
 
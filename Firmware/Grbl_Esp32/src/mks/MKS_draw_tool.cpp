@@ -120,7 +120,7 @@ void mks_draw_tool(void) {
 }
 
 void mks_clear_tool(void) {
-    lv_obj_clean(mks_global.mks_src);
+    mks_lv_clean_src();
 }
 
 
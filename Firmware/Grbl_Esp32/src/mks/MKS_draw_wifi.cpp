@@ -639,7 +639,7 @@ void mks_wifi_connect(char *username, char *password) {
 }
 
 void mks_clear_wifi(void) {
-	lv_obj_clean(mks_global.mks_src);
+	mks_lv_clean_src();
 }
 
 
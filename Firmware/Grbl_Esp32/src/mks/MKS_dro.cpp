@@ -0,0 +1,251 @@
+#include "MKS_dro.h"
+#include "MKS_draw_lvgl.h"
+#include "MKS_LVGL.h"
+
+#define DRO_GLYPH_NUM           (sizeof(MKS_DRO_GLYPHS) - 1)
+
+typedef struct {
+    char text[MKS_DRO_TEXT_MAX];
+} mks_dro_ext_t;
+
+// The glyphs, one byte a pixel holding the coverage as 0..15. Glyph i takes columns x[i] up
+// to x[i + 1], its advance and the letter space, so a text is copied in cell by cell.
+typedef struct {
+    const lv_font_t* font;
+    lv_coord_t       letter_space;
+    uint16_t         w;
+    uint16_t         h;
+    uint16_t         x[DRO_GLYPH_NUM + 1];
+    uint8_t*         px;
+} mks_dro_strip_t;
+
+static mks_dro_strip_t dro_strip;
+static TFT_eSprite*    dro_sprite = NULL;  // Shared, made again when a field of another size is drawn
+
+static bool mks_dro_strip_build(const lv_font_t* font, lv_coord_t letter_space) {
+    if ((dro_strip.font == font) && (dro_strip.letter_space == letter_space)) {
+        return dro_strip.px != NULL;
+    }
+    free(dro_strip.px);
+    memset(&dro_strip, 0, sizeof(dro_strip));
+    dro_strip.font         = font;
+    dro_strip.letter_space = letter_space;
+    if (font->subpx != LV_FONT_SUBPX_NONE) {
+        return false;
+    }
+
+    uint16_t w = 0;
+    for (int i = 0; i < (int)DRO_GLYPH_NUM; i++) {
+        dro_strip.x[i] = w;
+        w += lv_font_get_glyph_width(font, MKS_DRO_GLYPHS[i], 0) + letter_space;
+    }
+    dro_strip.x[DRO_GLYPH_NUM] = w;
+    dro_strip.w                = w;
+    dro_strip.h                = lv_font_get_line_height(font);
+    dro_strip.px               = (uint8_t*)calloc(dro_strip.w * dro_strip.h, 1);
+    if (dro_strip.px == NULL) {
+        return false;
+    }
+
+    // Placed in the cell as lv_draw_letter() places it, and cut at the cell
+    for (int i = 0; i < (int)DRO_GLYPH_NUM; i++) {
+        lv_font_glyph_dsc_t g;
+        const uint8_t*      map;
+        if (!lv_font_get_glyph_dsc(font, &g, MKS_DRO_GLYPHS[i], 0) || ((map = lv_font_get_glyph_bitmap(font, MKS_DRO_GLYPHS[i])) == NULL)) {
+            continue;
+        }
+        uint8_t    bpp  = (g.bpp == 3) ? 4 : g.bpp;
+        lv_coord_t left = dro_strip.x[i] + g.ofs_x;
+        lv_coord_t top  = (font->line_height - font->base_line) - g.box_h - g.ofs_y;
+        for (lv_coord_t row = 0; row < g.box_h; row++) {
+            for (lv_coord_t col = 0; col < g.box_w; col++) {
+                lv_coord_t px_x = left + col;
+                lv_coord_t px_y = top + row;
+                if ((px_x < dro_strip.x[i]) || (px_x >= dro_strip.x[i + 1]) || (px_y < 0) || (px_y >= dro_strip.h)) {
+                    continue;
+                }
+                uint32_t bit = (row * g.box_w + col) * bpp;  // The rows are not padded
+                uint8_t  v   = (map[bit >> 3] >> (8 - (bit & 7) - bpp)) & ((1 << bpp) - 1);
+                switch (bpp) {
+                    case 1: v *= 15; break;
+                    case 2: v *= 5; break;
+                    case 8: v >>= 4; break;
+                }
+                dro_strip.px[px_y * dro_strip.w + px_x] = v;
+            }
+        }
+    }
+    return true;
+}
+
+// True if nothing else is drawn over or under the field: it is on the active screen, none of
+// it or its parents is hidden, no newer object overlaps it and the first parent with a body
+// fills it with one colour, which is *bg. The parent's corner radius is not checked.
+static bool mks_dro_exposed(lv_obj_t* dro, lv_color_t* bg) {
+    if ((lv_obj_get_screen(dro) != lv_scr_act()) || (lv_obj_get_child(lv_layer_top(), NULL) != NULL)) {
+        return false;
+    }
+    lv_area_t area, other, common;
+    lv_obj_get_coords(dro, &area);
+    bool      found = false;
+    lv_obj_t* obj   = dro;
+    for (lv_obj_t* par = lv_obj_get_parent(obj); par != NULL; obj = par, par = lv_obj_get_parent(par)) {
+        if (lv_obj_get_hidden(obj)) {
+            return false;
+        }
+        // The newest children come first and are drawn last. Above the background only the
+        // ones over obj matter.
+        bool above = true;
+        for (lv_obj_t* child = lv_obj_get_child(par, NULL); child != NULL; child = lv_obj_get_child(par, child)) {
+            if (child == obj) {
+                above = false;
+                continue;
+            }
+            lv_obj_get_coords(child, &other);
+            if ((above || !found) && !lv_obj_get_hidden(child) && lv_area_intersect(&common, &other, &area)) {
+                return false;
+            }
+        }
+        if (!found) {
+            const lv_style_t* style = lv_obj_get_style(par);
+            lv_obj_get_coords(par, &other);
+            if ((style->body.opa == LV_OPA_COVER) && (style->body.main_color.full == style->body.grad_color.full) && lv_area_is_in(&area, &other)) {
+                *bg   = style->body.main_color;
+                found = true;
+            } else if (style->body.opa > LV_OPA_MIN) {
+                return false;
+            }
+        }
+    }
+    return found && !lv_obj_get_hidden(obj);
+}
+
+static bool mks_dro_push(lv_obj_t* dro) {
+    mks_dro_ext_t*    ext   = (mks_dro_ext_t*)lv_obj_get_ext_attr(dro);
+    const lv_style_t* style = lv_obj_get_style(dro);
+    lv_color_t        bg;
+    lv_coord_t        w = lv_obj_get_width(dro);
+    lv_coord_t        h = lv_obj_get_height(dro);
+
+    if (!mks_dro_exposed(dro, &bg) || !mks_dro_strip_build(style->text.font, style->text.letter_space) || (h != dro_strip.h)) {
+        return false;
+    }
+    for (const char* c = ext->text; *c; c++) {
+        if (strchr(MKS_DRO_GLYPHS, *c) == NULL) {
+            return false;
+        }
+    }
+    if (dro_sprite == NULL) {
+        dro_sprite = new TFT_eSprite(&tft);
+    }
+    if ((dro_sprite->width() != w) || (dro_sprite->height() != h)) {
+        dro_sprite->deleteSprite();
+        if (dro_sprite->createSprite(w, h) == NULL) {
+            return false;
+        }
+    }
+
+    // The colour of each coverage, blended as lv_draw_letter() blends it. The sprite holds
+    // pixels in panel byte order, as lv_color_t does with LV_COLOR_16_SWAP.
+    uint16_t  lut[16];
+    uint16_t* buf       = (uint16_t*)dro_sprite->getPointer();
+    lv_opa_t  opa_scale = lv_obj_get_opa_scale(dro);
+    lv_opa_t  opa       = (opa_scale == LV_OPA_COVER) ? style->text.opa : ((uint16_t)style->text.opa * opa_scale) >> 8;
+    for (int i = 0; i < 16; i++) {
+        lv_opa_t px_opa = (opa == LV_OPA_COVER) ? i * 17 : ((uint16_t)(i * 17) * opa) >> 8;
+        if (px_opa > LV_OPA_MAX) {
+            lut[i] = style->text.color.full;
+        } else if (px_opa > LV_OPA_MIN) {
+            lut[i] = lv_color_mix(style->text.color, bg, px_opa).full;
+        } else {
+            lut[i] = bg.full;
+        }
+    }
+    lv_coord_t x = 0;
+    for (const char* c = ext->text; *c && (x < w); c++) {
+        int        i     = strchr(MKS_DRO_GLYPHS, *c) - MKS_DRO_GLYPHS;
+        lv_coord_t cells = MIN(dro_strip.x[i + 1] - dro_strip.x[i], w - x);
+        for (lv_coord_t row = 0; row < h; row++) {
+            const uint8_t* src = &dro_strip.px[row * dro_strip.w + dro_strip.x[i]];
+            uint16_t*      dst = &buf[row * w + x];
+            for (lv_coord_t col = 0; col < cells; col++) {
+                dst[col] = lut[src[col]];
+            }
+        }
+        x += cells;
+    }
+    for (lv_coord_t row = 0; row < h; row++) {
+        for (lv_coord_t col = x; col < w; col++) {
+            buf[row * w + col] = lut[0];
+        }
+    }
+
+    lv_area_t area;
+    lv_obj_get_coords(dro, &area);
+#if defined(USE_LCD_DMA)
+    mks_lcd_release();  // The last LVGL flush may still be going out
+#endif
+    dro_sprite->pushSprite(area.x1, area.y1);
+    return true;
+}
+
+// LVGL's own drawing, for a refresh of the screen under or over the field
+static bool mks_dro_design(lv_obj_t* dro, const lv_area_t* mask, lv_design_mode_t mode) {
+    if (mode == LV_DESIGN_COVER_CHK) {
+        return false;
+    }
+    if (mode == LV_DESIGN_DRAW_MAIN) {
+        mks_dro_ext_t* ext = (mks_dro_ext_t*)lv_obj_get_ext_attr(dro);
+        lv_area_t      coords;
+        lv_obj_get_coords(dro, &coords);
+        lv_draw_label(&coords, mask, lv_obj_get_style(dro), lv_obj_get_opa_scale(dro), ext->text, LV_TXT_FLAG_NONE, NULL, NULL, NULL, LV_BIDI_DIR_LTR);
+    }
+    return true;
+}
+
+/*
+ * Author   :MKS
+ * Describe :A DRO field chars glyphs of '0' wide, placed as label_for_text() places a label
+ * Data     :2021/03/16
+*/
+lv_obj_t* mks_dro_create(lv_obj_t* scr, lv_obj_t* base, lv_coord_t x, lv_coord_t y, lv_align_t align, uint8_t chars, const char* text) {
+    lv_obj_t*      dro = lv_obj_create(scr, NULL);
+    mks_dro_ext_t* ext = (mks_dro_ext_t*)lv_obj_allocate_ext_attr(dro, sizeof(mks_dro_ext_t));
+    LV_ASSERT_MEM(ext);
+    if (ext == NULL) {
+        return NULL;
+    }
+    strncpy(ext->text, text, sizeof(ext->text) - 1);
+    ext->text[sizeof(ext->text) - 1] = '\0';
+
+    lv_obj_set_style(dro, NULL);  // Inherit the parent's, as a label does
+    lv_obj_set_click(dro, false);
+    lv_obj_set_design_cb(dro, mks_dro_design);
+
+    const lv_style_t* style = lv_obj_get_style(dro);
+    lv_obj_set_size(dro,
+                    chars * (lv_font_get_glyph_width(style->text.font, '0', 0) + style->text.letter_space),
+                    lv_font_get_line_height(style->text.font));
+    lv_obj_align(dro, base, align, x, y);
+    return dro;
+}
+
+/*
+ * Author   :MKS
+ * Describe :Show a new text. Drawn straight to the panel if it can be, left for LVGL if not.
+ * Data     :2021/03/16
+*/
+void mks_dro_set_text(lv_obj_t* dro, const char* text) {
+    if (dro == NULL) {
+        return;
+    }
+    mks_dro_ext_t* ext = (mks_dro_ext_t*)lv_obj_get_ext_attr(dro);
+    if (strcmp(ext->text, text) == 0) {
+        return;
+    }
+    strncpy(ext->text, text, sizeof(ext->text) - 1);
+    ext->text[sizeof(ext->text) - 1] = '\0';
+    if (!mks_dro_push(dro)) {
+        lv_obj_invalidate(dro);
+    }
+}
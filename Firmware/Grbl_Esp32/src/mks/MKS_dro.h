@@ -0,0 +1,23 @@
+#ifndef __MKS_DRO_H
+#define __MKS_DRO_H
+
+#include "lvgl.h"
+
+/*
+ * A DRO field shows one coordinate, like "X:-12.5". It is an LVGL object of a fixed size, so
+ * LVGL draws it as it would a label whenever it redraws that part of the screen. A new value
+ * is not drawn by LVGL, though: the text is put together from a strip of the glyphs below,
+ * rasterized once per font, in a TFT_eSPI sprite of the field's size, and only that rectangle
+ * goes to the panel. The font and colours come from the parent, as for a label.
+ *
+ * A field that is under a popup, hidden, or on anything but a flat background is invalidated
+ * for LVGL to draw instead.
+ */
+#define MKS_DRO_GLYPHS          "0123456789.-:XYZ"
+#define MKS_DRO_TEXT_MAX        16
+#define MKS_DRO_UPDATA_MS       40          // Positions are updated at up to 25 Hz
+
+lv_obj_t* mks_dro_create(lv_obj_t* scr, lv_obj_t* base, lv_coord_t x, lv_coord_t y, lv_align_t align, uint8_t chars, const char* text);
+void mks_dro_set_text(lv_obj_t* dro, const char* text);
+
+#endif
@@ -0,0 +1,162 @@
+#include "MKS_font_cache.h"
+#include "../Grbl.h"
+
+#define FONT_CACHE_BUCKETS      64          // A power of 2
+#define FONT_CACHE_NONE         -1
+
+typedef struct {
+    uint32_t            letter;
+    int8_t              chain;              // Next in the same bucket
+    int8_t              newer;              // The LRU list, newest at cache_newest
+    int8_t              older;
+    bool                has_bitmap;
+    lv_font_glyph_dsc_t dsc;
+} font_cache_entry_t;
+
+MKS_FONT_CACHE_STATS_T mks_font_cache_stats;
+
+static lv_font_t*          cache_font = NULL;
+static font_cache_entry_t* cache_entry;
+static uint8_t*            cache_bitmap;    // MKS_FONT_CACHE_BITMAP bytes for each entry
+static int8_t              cache_bucket[FONT_CACHE_BUCKETS];
+static int8_t              cache_newest;
+static int8_t              cache_oldest;
+
+static bool (*font_get_glyph_dsc)(const lv_font_t*, lv_font_glyph_dsc_t*, uint32_t, uint32_t);
+static const uint8_t* (*font_get_glyph_bitmap)(const lv_font_t*, uint32_t);
+
+static void font_cache_unlink(int8_t i) {
+    font_cache_entry_t* e = &cache_entry[i];
+    if (e->newer != FONT_CACHE_NONE) {
+        cache_entry[e->newer].older = e->older;
+    } else {
+        cache_newest = e->older;
+    }
+    if (e->older != FONT_CACHE_NONE) {
+        cache_entry[e->older].newer = e->newer;
+    } else {
+        cache_oldest = e->newer;
+    }
+}
+
+static void font_cache_link_newest(int8_t i) {
+    cache_entry[i].newer = FONT_CACHE_NONE;
+    cache_entry[i].older = cache_newest;
+    if (cache_newest != FONT_CACHE_NONE) {
+        cache_entry[cache_newest].newer = i;
+    } else {
+        cache_oldest = i;
+    }
+    cache_newest = i;
+}
+
+static int8_t font_cache_find(uint32_t letter) {
+    for (int8_t i = cache_bucket[letter & (FONT_CACHE_BUCKETS - 1)]; i != FONT_CACHE_NONE; i = cache_entry[i].chain) {
+        if (cache_entry[i].letter == letter) {
+            if (i != cache_newest) {
+                font_cache_unlink(i);
+                font_cache_link_newest(i);
+            }
+            return i;
+        }
+    }
+    return FONT_CACHE_NONE;
+}
+
+// A free entry while there is one, the least recently used after that
+static int8_t font_cache_insert(uint32_t letter, const lv_font_glyph_dsc_t* dsc) {
+    int8_t i;
+    if (mks_font_cache_stats.used < MKS_FONT_CACHE_NUM) {
+        i = mks_font_cache_stats.used++;
+    } else {
+        i = cache_oldest;
+        font_cache_unlink(i);
+        int8_t* p = &cache_bucket[cache_entry[i].letter & (FONT_CACHE_BUCKETS - 1)];
+        while (*p != i) {
+            p = &cache_entry[*p].chain;
+        }
+        *p = cache_entry[i].chain;
+    }
+    font_cache_entry_t* e = &cache_entry[i];
+    e->letter             = letter;
+    e->dsc                = *dsc;
+    e->has_bitmap         = false;
+    e->chain              = cache_bucket[letter & (FONT_CACHE_BUCKETS - 1)];
+    cache_bucket[letter & (FONT_CACHE_BUCKETS - 1)] = i;
+    font_cache_link_newest(i);
+    return i;
+}
+
+static bool font_cache_get_glyph_dsc(const lv_font_t* font, lv_font_glyph_dsc_t* dsc_out, uint32_t letter, uint32_t letter_next) {
+    int8_t i = font_cache_find(letter);
+    if (i != FONT_CACHE_NONE) {
+        mks_font_cache_stats.hits++;
+        *dsc_out = cache_entry[i].dsc;
+        return true;
+    }
+    mks_font_cache_stats.misses++;
+    if (!font_get_glyph_dsc(font, dsc_out, letter, letter_next)) {
+        return false;  // LVGL draws a missing glyph as nothing, no need to remember
+    }
+    font_cache_insert(letter, dsc_out);
+    return true;
+}
+
+static const uint8_t* font_cache_get_glyph_bitmap(const lv_font_t* font, uint32_t letter) {
+    int8_t i = font_cache_find(letter);
+    if (i == FONT_CACHE_NONE) {
+        lv_font_glyph_dsc_t dsc;
+        if (!font_cache_get_glyph_dsc(font, &dsc, letter, 0)) {
+            return NULL;
+        }
+        i = cache_newest;
+    }
+    font_cache_entry_t* e      = &cache_entry[i];
+    uint8_t*            bitmap = &cache_bitmap[i * MKS_FONT_CACHE_BITMAP];
+    if (e->has_bitmap) {
+        return bitmap;
+    }
+    const uint8_t* src = font_get_glyph_bitmap(font, letter);
+    uint8_t        bpp = (e->dsc.bpp == 3) ? 4 : e->dsc.bpp;  // As lv_draw_letter() reads it
+    uint32_t       len = ((uint32_t)e->dsc.box_w * e->dsc.box_h * bpp + 7) / 8;
+    if ((src == NULL) || (len > MKS_FONT_CACHE_BITMAP)) {
+        return src;
+    }
+    memcpy(bitmap, src, len);
+    e->has_bitmap = true;
+    return bitmap;
+}
+
+/*
+ * Author   :MKS
+ * Describe :Put the cache in front of font's own lookups. One font only, the first one given.
+ * Data     :2021/03/16
+*/
+void mks_font_cache_attach(lv_font_t* font) {
+    if (cache_font != NULL) {
+        return;
+    }
+    if (font->get_glyph_dsc == lv_font_get_glyph_dsc_fmt_txt) {
+        lv_font_fmt_txt_dsc_t* fdsc = (lv_font_fmt_txt_dsc_t*)font->dsc;
+        if (fdsc->kern_dsc != NULL) {
+            return;
+        }
+    }
+    cache_entry  = (font_cache_entry_t*)malloc(MKS_FONT_CACHE_NUM * sizeof(font_cache_entry_t));
+    cache_bitmap = (uint8_t*)malloc(MKS_FONT_CACHE_NUM * MKS_FONT_CACHE_BITMAP);
+    if ((cache_entry == NULL) || (cache_bitmap == NULL)) {
+        free(cache_entry);
+        free(cache_bitmap);
+        return;
+    }
+    memset(cache_bucket, FONT_CACHE_NONE, sizeof(cache_bucket));
+    memset(&mks_font_cache_stats, 0, sizeof(mks_font_cache_stats));
+    cache_newest = FONT_CACHE_NONE;
+    cache_oldest = FONT_CACHE_NONE;
+
+    cache_font             = font;
+    font_get_glyph_dsc     = font->get_glyph_dsc;
+    font_get_glyph_bitmap  = font->get_glyph_bitmap;
+    font->get_glyph_dsc    = font_cache_get_glyph_dsc;
+    font->get_glyph_bitmap = font_cache_get_glyph_bitmap;
+}
@@ -0,0 +1,25 @@
+#ifndef __MKS_FONT_CACHE_H
+#define __MKS_FONT_CACHE_H
+
+#include "lvgl.h"
+
+/*
+ * The glyphs of the UI font most recently used, kept in RAM. LVGL asks the font for a glyph's
+ * descriptor several times per character as it lays out and draws a label, and then for its
+ * bitmap, which is read out of flash. The cache answers both from RAM for the characters the
+ * pages actually use, least recently used out first. Only for a font without kerning, as the
+ * descriptor is kept per character.
+ */
+#define MKS_FONT_CACHE_NUM          48      // Glyphs
+#define MKS_FONT_CACHE_BITMAP       192     // Bytes per bitmap, a bigger glyph comes from the font each time
+
+typedef struct {
+    uint16_t used;
+    uint32_t hits;
+    uint32_t misses;
+} MKS_FONT_CACHE_STATS_T;
+extern MKS_FONT_CACHE_STATS_T mks_font_cache_stats;
+
+void mks_font_cache_attach(lv_font_t* font);
+
+#endif
@@ -0,0 +1,302 @@
+#include "MKS_step_test.h"
+#include "MKS_draw_lvgl.h"
+#include "MKS_FREERTOS_TASK.h"
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+
+#define STEP_TEST_TICK_MHZ          20          // RMT clock, 50 ns a tick and up to 1.6 ms a level
+#define STEP_TEST_ITEMS             64          // One memory block, the only one channel 7 has
+#define STEP_TEST_WINDOW_PERIODS    48          // Leaves the rest of the block for a late stop
+#define STEP_TEST_IDLE_MS           5000
+#define STEP_TEST_START_MS          1000
+#define STEP_TEST_DRAIN_MS          50          // I2S streaming sends the last steps after the ISR is done
+
+volatile MKS_STEP_TEST_STATUS_T mks_step_test_status = MKS_STEP_TEST_IDLE;
+
+#ifdef USE_I2S_STEPS
+static const stepper_id_t step_test_steppers[] = { ST_I2S_STREAM, ST_I2S_STATIC };
+#else
+static const stepper_id_t step_test_steppers[] = { DEFAULT_STEPPER };
+#endif
+static const uint32_t step_test_rates[]     = MKS_STEP_TEST_RATES;
+static const float    step_test_jitter_us[] = { 0.25, 1, 4, 16 };  // Upper ends of the bins, the last has the rest
+
+static esp_timer_handle_t step_test_timer = NULL;
+static TaskHandle_t       step_test_task  = NULL;
+static int16_t            step_test_last_raw;
+
+static void step_test_window_end(void* arg) {
+    rmt_rx_stop(MKS_STEP_TEST_RMT_CHANNEL);
+    xTaskNotifyGive(step_test_task);
+}
+
+static bool step_test_init(void) {
+    if (step_test_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback                = step_test_window_end;
+        args.name                    = "step test";
+        if (esp_timer_create(&args, &step_test_timer) != ESP_OK) {
+            step_test_timer = NULL;
+            return false;
+        }
+    }
+
+    pcnt_config_t count  = {};
+    count.pulse_gpio_num = MKS_STEP_TEST_PIN;
+    count.ctrl_gpio_num  = PCNT_PIN_NOT_USED;
+    count.channel        = PCNT_CHANNEL_0;
+    count.unit           = MKS_STEP_TEST_PCNT_UNIT;
+    bool invert          = bitnum_istrue(step_invert_mask->get(), MKS_STEP_TEST_AXIS);
+    count.pos_mode       = invert ? PCNT_COUNT_DIS : PCNT_COUNT_INC;  // The leading edge of the pulse
+    count.neg_mode       = invert ? PCNT_COUNT_INC : PCNT_COUNT_DIS;
+    count.hctrl_mode     = PCNT_MODE_KEEP;
+    count.lctrl_mode     = PCNT_MODE_KEEP;
+    count.counter_h_lim  = INT16_MAX;
+    count.counter_l_lim  = INT16_MIN;
+    if (pcnt_unit_config(&count) != ESP_OK) {
+        return false;
+    }
+    pcnt_filter_disable(count.unit);
+    pcnt_counter_clear(count.unit);
+    pcnt_counter_resume(count.unit);
+    pcnt_get_counter_value(count.unit, &step_test_last_raw);
+
+    // Routed after the PCNT, both take the pin through the GPIO matrix
+    rmt_config_t rx                  = {};
+    rx.rmt_mode                      = RMT_MODE_RX;
+    rx.channel                       = MKS_STEP_TEST_RMT_CHANNEL;
+    rx.gpio_num                      = gpio_num_t(MKS_STEP_TEST_PIN);
+    rx.clk_div                       = 80 / STEP_TEST_TICK_MHZ;
+    rx.mem_block_num                 = 1;
+    rx.rx_config.filter_en           = true;
+    rx.rx_config.filter_ticks_thresh = 40;      // 0.5 us of APB clock, shorter is noise
+    rx.rx_config.idle_threshold      = 0x7fff;  // A level never outlasts an item
+    rmt_set_source_clk(rx.channel, RMT_BASECLK_APB);
+    return rmt_config(&rx) == ESP_OK;
+}
+
+// Pulses since the last call. The counter only goes up and wraps at 32767.
+static int32_t step_test_count(void) {
+    int16_t raw;
+    pcnt_get_counter_value(MKS_STEP_TEST_PCNT_UNIT, &raw);
+    int32_t delta = int32_t(raw) - step_test_last_raw;
+    step_test_last_raw = raw;
+    return (delta < 0) ? delta + INT16_MAX : delta;
+}
+
+static bool step_test_wait_idle(uint32_t timeout_ms) {
+    for (uint32_t ms = 0; ms < timeout_ms; ms += 10) {
+        if (sys.state == State::Alarm) {
+            return false;
+        }
+        if ((sys.state == State::Idle) && stepper_idle && (plan_get_current_block() == NULL) && !client_input_pending()) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+// Records the pulses for us and adds their periods to r. Each item holds a high and a low
+// level, so a whole period, whichever level the window starts on.
+static void step_test_window(uint32_t us, MKS_STEP_TEST_RESULT_T* r, uint64_t* ticks, float* squares) {
+    for (int i = 0; i < STEP_TEST_ITEMS; i++) {
+        RMTMEM.chan[MKS_STEP_TEST_RMT_CHANNEL].data32[i].val = 0;
+    }
+    rmt_rx_start(MKS_STEP_TEST_RMT_CHANNEL, true);
+    esp_timer_start_once(step_test_timer, us);
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(us / 1000 + 10)) == 0) {
+        esp_timer_stop(step_test_timer);
+        rmt_rx_stop(MKS_STEP_TEST_RMT_CHANNEL);
+    }
+
+    uint32_t period[STEP_TEST_ITEMS];
+    uint32_t n   = 0;
+    uint32_t sum = 0;
+    for (int i = 1; i < STEP_TEST_ITEMS; i++) {  // The first item starts part way into a level
+        rmt_item32_t item;
+        item.val = RMTMEM.chan[MKS_STEP_TEST_RMT_CHANNEL].data32[i].val;
+        if ((item.duration0 == 0) || (item.duration1 == 0)) {
+            break;
+        }
+        period[n] = item.duration0 + item.duration1;
+        sum += period[n++];
+    }
+    if (n == 0) {
+        return;
+    }
+
+    float mean = (float)sum / n;
+    for (uint32_t i = 0; i < n; i++) {
+        float dev = fabsf(period[i] - mean) / STEP_TEST_TICK_MHZ;
+        int   bin = 0;
+        while ((bin < MKS_STEP_TEST_JITTER_BINS - 1) && (dev >= step_test_jitter_us[bin])) {
+            bin++;
+        }
+        r->jitter[bin]++;
+        r->jitter_max = MAX(r->jitter_max, dev);
+        *squares += dev * dev;
+    }
+    r->periods += n;
+    *ticks += sum;
+}
+
+// One move of the test axis with a cruise at rate, sampled in the middle of the cruise. False
+// if it did not start or finish in time.
+static bool step_test_move(uint32_t rate, float sign, MKS_STEP_TEST_RESULT_T* r) {
+    uint8_t axis   = MKS_STEP_TEST_AXIS;
+    float   spm    = axis_settings[axis]->steps_per_mm->get();
+    float   accel  = axis_settings[axis]->acceleration->get() * spm;  // steps/s^2
+    float   feed   = roundf(rate * 600.0f / spm) / 10.0f;             // mm/min, as it is sent
+    float   v      = feed * spm / 60.0f;
+    float   cruise = MKS_STEP_TEST_CRUISE_MS / 1000.0f;
+    float   t_acc  = v / accel;
+    float   dist   = (v * cruise + v * v / accel) / spm;
+    char    cmd[64];
+
+    memset(r, 0, sizeof(MKS_STEP_TEST_RESULT_T));
+    r->stepper = current_stepper;
+    r->rate    = v;
+
+    snprintf(cmd, sizeof(cmd), "G91G1%c%.3fF%.1f\nG90\n", "XYZABC"[axis], sign * dist, feed);
+    int32_t start = sys_position[axis];
+    step_test_count();
+    MKS_GRBL_CMD_SEND(cmd);
+    for (uint32_t ms = 0; stepper_idle; ms++) {
+        if (ms >= STEP_TEST_START_MS) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+
+    int64_t  t0      = esp_timer_get_time();
+    int64_t  from    = t0 + (int64_t)((t_acc + 0.1f * cruise) * 1000000);
+    int64_t  to      = t0 + (int64_t)((t_acc + 0.9f * cruise) * 1000000);
+    int64_t  end     = t0 + (int64_t)((2 * t_acc + cruise) * 1000000) + STEP_TEST_START_MS * 1000;
+    uint32_t window  = STEP_TEST_WINDOW_PERIODS * 1000000.0f / v;
+    uint64_t ticks   = 0;
+    float    squares = 0;
+    while (!stepper_idle || (plan_get_current_block() != NULL)) {
+        int64_t now = esp_timer_get_time();
+        if ((now > end) || (sys.state == State::Alarm)) {
+            return false;
+        }
+        if ((now >= from) && (now + window <= to)) {
+            step_test_window(window, r, &ticks, &squares);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+        r->counted += step_test_count();
+    }
+    vTaskDelay(pdMS_TO_TICKS(STEP_TEST_DRAIN_MS));
+    r->counted += step_test_count();
+    r->commanded = abs(sys_position[axis] - start);
+
+    if (r->periods) {
+        r->measured   = (float)r->periods * STEP_TEST_TICK_MHZ * 1000000 / ticks;
+        r->jitter_rms = sqrtf(squares / r->periods);
+    }
+    return true;
+}
+
+static bool step_test_report(const MKS_STEP_TEST_RESULT_T* r) {
+    float err = r->periods ? (r->measured - r->rate) * 100 / r->rate : 0;
+    grbl_msg_sendf(CLIENT_ALL,
+                   MsgLevel::Info,
+                   "Step test %s, %.0f/s: %.1f/s (%+.3f%%) over %u periods, %d of %d pulses",
+                   stepper_names[r->stepper],
+                   r->rate,
+                   r->measured,
+                   err,
+                   r->periods,
+                   r->counted,
+                   r->commanded);
+
+    char   bins[96];
+    size_t len = 0;
+    for (int i = 0; i < MKS_STEP_TEST_JITTER_BINS && len < sizeof(bins); i++) {
+        if (i < MKS_STEP_TEST_JITTER_BINS - 1) {
+            len += snprintf(&bins[len], sizeof(bins) - len, "<%gus %u, ", step_test_jitter_us[i], r->jitter[i]);
+        } else {
+            len += snprintf(&bins[len], sizeof(bins) - len, "more %u", r->jitter[i]);
+        }
+    }
+    grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Step test jitter: %s, max %.2fus, rms %.3fus", bins, r->jitter_max, r->jitter_rms);
+    return (r->periods > 0) && (r->counted == r->commanded) && (fabsf(err) <= MKS_STEP_TEST_MAX_ERR);
+}
+
+/*
+ * Author   :MKS
+ * Describe :Start the step timing check on the test task. Nothing if one is running.
+ * Data     :2021/03/16
+*/
+void mks_step_test_start(void) {
+    if (mks_step_test_busy()) {
+        return;
+    }
+    mks_step_test_status = MKS_STEP_TEST_RUNNING;
+    if (test_code_handle == NULL) {
+        test_code_task_init();
+    }
+    xTaskNotifyGive(test_code_handle);
+}
+
+bool mks_step_test_busy(void) {
+    return mks_step_test_status == MKS_STEP_TEST_RUNNING;
+}
+
+/*
+ * Author   :MKS
+ * Describe :The reference profile for each stepper mode, each result sent as a message
+ * Data     :2021/03/16
+*/
+void mks_step_test_run(void) {
+    step_test_task = xTaskGetCurrentTaskHandle();
+    MKS_GRBL_CMD_SEND("M5\n");
+    if (!step_test_init() || !step_test_wait_idle(STEP_TEST_IDLE_MS)) {
+        grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Step test: not idle");
+        mks_step_test_status = MKS_STEP_TEST_FAIL;
+        return;
+    }
+
+    uint8_t      axis     = MKS_STEP_TEST_AXIS;
+    float        max_rate = axis_settings[axis]->max_rate->get() * axis_settings[axis]->steps_per_mm->get() / 60.0f;
+    stepper_id_t save     = current_stepper;
+    bool         pass     = true;
+    bool         stop     = false;
+    int32_t      counted  = 0;
+    float        sign     = 1;
+    for (auto stepper : step_test_steppers) {
+        stepper_switch(stepper);
+        for (auto rate : step_test_rates) {
+            if (rate > max_rate) {
+                grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Step test %s, %u/s: over the max rate", stepper_names[stepper], rate);
+                continue;
+            }
+            MKS_STEP_TEST_RESULT_T r;
+            if (!step_test_move(rate, sign, &r) || !step_test_wait_idle(STEP_TEST_IDLE_MS)) {
+                grbl_msg_sendf(CLIENT_ALL, MsgLevel::Info, "Step test %s, %u/s: the move did not finish", stepper_names[stepper], rate);
+                pass = false;
+                stop = true;
+                break;
+            }
+            sign = -sign;  // Back and forth, to stay where the test started
+            pass = step_test_report(&r) && pass;
+            counted += r.counted;
+        }
+        if (stop) {
+            break;
+        }
+    }
+    stepper_switch(save);
+
+    if (counted == 0) {
+        mks_step_test_status = MKS_STEP_TEST_NO_SIGNAL;
+    } else {
+        mks_step_test_status = pass ? MKS_STEP_TEST_PASS : MKS_STEP_TEST_FAIL;
+    }
+    grbl_msg_sendf(CLIENT_ALL,
+                   MsgLevel::Info,
+                   "Step test: %s",
+                   (mks_step_test_status == MKS_STEP_TEST_PASS) ? "pass" : (counted == 0) ? "no pulse on the loopback pin" : "fail");
+}
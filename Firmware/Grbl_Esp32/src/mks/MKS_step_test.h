@@ -0,0 +1,56 @@
+#ifndef __MKS_STEP_TEST_H
+#define __MKS_STEP_TEST_H
+
+#include "../Grbl.h"
+
+/*
+ * Step timing check of the factory test. A jig wire brings the STEP signal of one driver socket
+ * back to MKS_STEP_TEST_PIN, and the board runs a reference profile on that axis: one move at
+ * each rate of MKS_STEP_TEST_RATES, for each stepper mode of the build. During the cruise an RMT
+ * receive channel records the step periods in short windows, and a PCNT unit counts every pulse
+ * of the move. Each run reports the rate measured against the one commanded, how far the periods
+ * stray from their mean, and the pulses counted against the steps in sys_position.
+ *
+ * The steps of this board go out through I2S and the shift registers, so nothing reaches a pin
+ * the ESP32 can read without the wire. A check that counts no pulse at all says so.
+ */
+#ifndef MKS_STEP_TEST_PIN
+#define MKS_STEP_TEST_PIN           PROBE_PIN       // Wired to the STEP pin of MKS_STEP_TEST_AXIS
+#endif
+#ifndef MKS_STEP_TEST_AXIS
+#define MKS_STEP_TEST_AXIS          X_AXIS
+#endif
+#define MKS_STEP_TEST_RATES         { 1000, 5000, 20000, 50000, 100000 }   // Steps/s, the ones over $11x are left out
+#define MKS_STEP_TEST_CRUISE_MS     300             // Cruise of each move
+#define MKS_STEP_TEST_RMT_CHANNEL   RMT_CHANNEL_7   // The motors take theirs from channel 1 up
+#define MKS_STEP_TEST_PCNT_UNIT     PCNT_UNIT_7     // Step verify takes one per axis from unit 0
+#define MKS_STEP_TEST_MAX_ERR       0.5             // Rate error of a pass (%)
+#define MKS_STEP_TEST_JITTER_BINS   5
+
+typedef enum {
+    MKS_STEP_TEST_IDLE,
+    MKS_STEP_TEST_RUNNING,
+    MKS_STEP_TEST_PASS,
+    MKS_STEP_TEST_FAIL,
+    MKS_STEP_TEST_NO_SIGNAL,
+} MKS_STEP_TEST_STATUS_T;
+
+typedef struct {
+    stepper_id_t stepper;
+    float        rate;                                  // Commanded (steps/s)
+    float        measured;                              // Over the sampled periods (steps/s)
+    uint32_t     periods;                               // Sampled
+    uint32_t     jitter[MKS_STEP_TEST_JITTER_BINS];     // Periods by distance from the mean of their window
+    float        jitter_max;                            // us
+    float        jitter_rms;                            // us
+    int32_t      commanded;                             // Steps in sys_position
+    int32_t      counted;                               // Pulses on the pin
+} MKS_STEP_TEST_RESULT_T;
+
+extern volatile MKS_STEP_TEST_STATUS_T mks_step_test_status;
+
+void mks_step_test_start(void);
+bool mks_step_test_busy(void);
+void mks_step_test_run(void);
+
+#endif
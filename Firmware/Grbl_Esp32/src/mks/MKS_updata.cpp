@@ -8,7 +8,8 @@ void mks_updata_init(void) {
     mks_updata.updata_flag = UD_NONE;       // 默认初始没有flag
     mks_updata.updata_persen = 0;           // 默认初始0%
     mks_updata.updata_cont = 0;             // 默认初始第0个 
-    mks_updata.updata_line = 0;             // 默认初始第0行
+    mks_updata.updata_bytes = 0;
+    mks_updata.updata_size = 0;
     tf.init();
 
     mks_updata.updata_flag = UD_CHEAK;
@@ -22,56 +23,140 @@ void mks_updata_init(void) {
     }
 }
 
-void mks_cfg_find(void) {
-    String p;
-    char send_data[128];
-
-    p = tf.readFileLine(CFG_FILE_PATG, mks_updata.updata_line);
-    if( (strstr(p.c_str() ,"-") == NULL) 
-         && (strstr(p.c_str() ,"/*") == NULL) 
-         && (strstr(p.c_str() ,"*-") == NULL) 
-         && (strstr(p.c_str() ,"//") == NULL)
-         && (p.length() < 127) 
-        )  
-    {   
-        if( (strstr(p.c_str() ,"=") != NULL)) {
-            mks_updata.is_have_data_ud = true;
-        }else if(strstr(p.c_str() ,"[ESP110]") != NULL) {
-            mks_updata.is_have_data_ud = true;
-        }else if(strstr(p.c_str() ,"[ESP100]") != NULL) {
-            mks_updata.is_have_data_ud = true;
-        }else if(strstr(p.c_str() ,"[ESP101]") != NULL) {
-            mks_updata.is_have_data_ud = true;
-        }else if(strstr(p.c_str() ,"[ESP131]") != NULL) {
-            mks_updata.is_have_data_ud = true;
-        }else {
-            mks_updata.is_have_data_ud = false;
-        }
-    }else{
+// The config file is read once, front to back, a chunk per call. Each setting line goes into
+// the input buffer between $Settings/Begin and $Settings/Commit, so the whole file is applied
+// as one settings batch with a single NVS commit. When the input buffer is full the line is
+// kept and sent on a later call, once the protocol loop has taken some of the buffer.
+static File cfg_file;
+static char cfg_chunk[CFG_FILE_CHUNK_SIZE];
+static int  cfg_chunk_len;
+static int  cfg_chunk_pos;
+static char cfg_line[CFG_FILE_LINE_SIZE + 1];
+static int  cfg_line_len;
+static bool cfg_line_long;            // 当前行超长，丢弃
+static char cfg_pending[CFG_FILE_LINE_SIZE + 2];
+static bool cfg_have_pending;
 
+// The old line filter: comments and over-long lines are skipped, the rest must set something
+static bool mks_cfg_is_entry(const char* p) {
+    if( (strstr(p ,"-") != NULL)
+         || (strstr(p ,"/*") != NULL)
+         || (strstr(p ,"*-") != NULL)
+         || (strstr(p ,"//") != NULL)
+         || (strlen(p) >= 127)
+        )
+    {
+        return false;
     }
+    return (strstr(p ,"=") != NULL)
+        || (strstr(p ,"[ESP110]") != NULL)
+        || (strstr(p ,"[ESP100]") != NULL)
+        || (strstr(p ,"[ESP101]") != NULL)
+        || (strstr(p ,"[ESP131]") != NULL);
+}
 
-    if(mks_updata.is_have_data_ud == true) {
-        mks_updata.updata_cont++;
-        memset(send_data, 0, sizeof(send_data));
-        strcpy(send_data, p.c_str());
-        strcat(send_data, "\n");
-        MKS_GRBL_CMD_SEND(send_data);
-        mks_updata_data(); // 更新进度条
-        mks_updata.is_have_data_ud = false;
+static bool mks_cfg_send(const char* cmd) {
+    if(cfg_have_pending) {
+        return false;
     }
+    if(!WebUI::inputBuffer.push(cmd)) {
+        strcpy(cfg_pending, cmd);
+        cfg_have_pending = true;
+        return false;
+    }
+    return true;
+}
 
-    mks_updata.updata_line++;
+// A complete line from the file, trimmed like readFileLine() did
+static bool mks_cfg_line_end(void) {
+    char* p = cfg_line;
+    cfg_line[cfg_line_len] = '\0';
+    bool  is_long = cfg_line_long;
+    cfg_line_len  = 0;
+    cfg_line_long = false;
+    if(is_long) {
+        return true;
+    }
+    while(isspace((unsigned char)*p)) p++;
+    char* e = p + strlen(p);
+    while(e > p && isspace((unsigned char)e[-1])) *--e = '\0';
+    if(!mks_cfg_is_entry(p)) {
+        return true;
+    }
+    mks_updata.updata_cont++;
+    *e++ = '\n';
+    *e   = '\0';
+    return mks_cfg_send(p);
+}
 
-    if(mks_updata.updata_line > CFG_FILE_MAX_LINE) {   //搜索完毕，开始校验
+static void mks_cfg_finish(void) {
+    cfg_file.close();
+    mks_updata.updata_bytes = mks_updata.updata_size;
+    mks_updata_data();
+    if(mks_updata.updata_cont >= CFG_FILE_NUM) {
+        mks_updata.updata_flag = UD_UPDATA_FINSH;
+    }else {
+        mks_updata.updata_flag = UD_UPDATA_FAIL;
+    }
+}
 
-        if(mks_updata.updata_cont >= CFG_FILE_NUM ) {
-            
-            mks_updata.updata_flag = UD_UPDATA_FINSH;
-        }else {
+void mks_cfg_find(void) {
+    if(!cfg_file) {
+        cfg_file = SD.open(CFG_FILE_PATG);
+        if(!cfg_file) {
             mks_updata.updata_flag = UD_UPDATA_FAIL;
-        } 
+            return;
+        }
+        mks_updata.updata_size  = cfg_file.size();
+        mks_updata.updata_bytes = 0;
+        mks_updata.updata_cont  = 0;
+        cfg_chunk_len = cfg_chunk_pos = 0;
+        cfg_line_len  = 0;
+        cfg_line_long = false;
+        cfg_have_pending = false;
+        mks_cfg_send("$Settings/Begin\n");
     }
+
+    if(cfg_have_pending) {
+        if(!WebUI::inputBuffer.push(cfg_pending)) {
+            return;                     // 输入缓冲区仍然满
+        }
+        cfg_have_pending = false;
+        if(strcmp(cfg_pending, "$Settings/Commit\n") == 0) {
+            mks_cfg_finish();
+            return;
+        }
+    }
+
+    if(cfg_chunk_pos == cfg_chunk_len) {
+        cfg_chunk_len = cfg_file.read((uint8_t*)cfg_chunk, sizeof(cfg_chunk));
+        cfg_chunk_pos = 0;
+        if(cfg_chunk_len <= 0) {        // 读取完毕，提交并开始校验
+            cfg_chunk_len = 0;
+            if(cfg_line_len != 0 && !mks_cfg_line_end()) {
+                return;
+            }
+            if(mks_cfg_send("$Settings/Commit\n")) {
+                mks_cfg_finish();
+            }
+            return;
+        }
+    }
+
+    while(cfg_chunk_pos < cfg_chunk_len) {
+        char c = cfg_chunk[cfg_chunk_pos++];
+        mks_updata.updata_bytes++;
+        if(c == '\n') {
+            if(!mks_cfg_line_end()) {
+                break;                  // 输入缓冲区已满，下次继续
+            }
+        }else if(cfg_line_len < CFG_FILE_LINE_SIZE) {
+            cfg_line[cfg_line_len++] = c;
+        }else {
+            cfg_line_long = true;
+        }
+    }
+    mks_updata_data(); // 更新进度条
 }
 
 void mks_cfg_rename(const char* path1) {
@@ -89,8 +174,9 @@ void mks_draw_updata(void) {
 void mks_updata_data(void) {
     uint8_t percent = 0;
     char str[16];
-    if(mks_updata.updata_cont > CFG_FILE_NUM) mks_updata.updata_cont = CFG_FILE_NUM;
-    percent = (mks_updata.updata_cont *100 / CFG_FILE_NUM);
+    if(mks_updata.updata_size != 0) {
+        percent = ((uint64_t)mks_updata.updata_bytes * 100 / mks_updata.updata_size);
+    }
     updata_page.bar_updata = mks_lv_bar_updata(updata_page.bar_updata, percent);
     sprintf(str, "%d%%", percent);
 }
\ No newline at end of file
@@ -10,7 +10,8 @@
 #define CFG_FILE_CHECK_FAIL     "CFG is no exit"
 
 #define CFG_FILE_NUM            38    // 一共配置项
-#define CFG_FILE_MAX_LINE       128
+#define CFG_FILE_LINE_SIZE      128   // 更长的行被跳过
+#define CFG_FILE_CHUNK_SIZE     512   // 每次从文件读取的字节数
 
 /*
     [ESP110]STA   		//设置wifi模式, STA/AP两种，如[ESP110]STA。
@@ -31,7 +32,8 @@ typedef enum{
 typedef struct {
     UPDATA_CHECK_FLAG_T updata_flag;    // 标记更新执行的状态
     uint32_t updata_cont;               // 用于选择更新第几个
-    uint32_t updata_line;               // 用于记录更新到第几行
+    uint32_t updata_bytes;              // 已读取的字节数，用于进度条
+    uint32_t updata_size;               // 配置文件的大小
     uint8_t updata_persen;              // 更新百分比
     bool is_have_data_ud;               // 确定读到了数据进行更新
     bool is_have_board_1;               // 读到了主板信息1
@@ -1,6 +1,8 @@
 #include "draw_ui.h"
 
 void mks_global_style_init(void) {
+    mks_font_cache_attach(&dlc32Font);  // The font of every page
+
     // 背景页面style
     lv_style_copy(&mks_global.mks_src_style, &lv_style_scr);
     mks_global.mks_src_style.body.grad_color = LV_COLOR_MAKE(0x13, 0x12, 0x1a);
@@ -9,15 +9,21 @@ char test_y_limit_str[30] = "Y_limit Check:";
 char test_z_limit_str[30] = "Z_limit Check:";
 char test_I2C_str[30] = "I2C Check:";
 char test_CPU_T_str[30] = "CPU_TEMP:";
+char test_step_str[30] = "Step Check:";
 
 char test_OK[30] = "OK";
 char test_ERR[30] = "#FF0000 ERR#";
 char test_WAR[30] = "#FF0000 Warning!#";
+char test_NO_SIGNAL[30] = "#FF0000 No signal#";
+char test_RUNNING[30] = "Testing...";
 
 
 static void event_handler_test(lv_obj_t* obj, lv_event_t event) { 
 	
 	if (event == LV_EVENT_RELEASED) {
+        if(mks_step_test_busy()) {
+            return;
+        }
         mks_lv_clean_ui();
         mks_ui_page.mks_ui_page = MKS_UI_PAGE_LOADING;
         phy_init_reinit();
@@ -28,6 +34,13 @@ static void event_handler_test(lv_obj_t* obj, lv_event_t event) {
 	}
 }
 
+static void event_handler_step(lv_obj_t* obj, lv_event_t event) { 
+
+	if (event == LV_EVENT_RELEASED) {
+        mks_step_test_start();
+	}
+}
+
 void mks_draw_test_ui(void) {
 
     char dis_str[60];
@@ -128,6 +141,17 @@ void mks_draw_test_ui(void) {
                                             LV_ALIGN_IN_TOP_LEFT, 
                                             FW_NAME);
 
+    memset(dis_str, 0, sizeof(dis_str));
+    strcpy(dis_str, test_step_str);
+    strcat(dis_str, (mks_step_test_status == MKS_STEP_TEST_IDLE) ? "-" : test_RUNNING);
+    test_page.label_step = label_for_text(mks_global.mks_src, 
+                                            test_page.label_step, 
+                                            NULL, 
+                                            TITLE_X_POS, 
+                                            TITLE_Y_POS + TITLE_Y_OFFSET*9, 
+                                            LV_ALIGN_IN_TOP_LEFT, 
+                                            dis_str);
+
     test_page.btn_back = mks_lv_btn_set(mks_global.mks_src, 
                                         test_page.btn_back, 
                                         100, 
@@ -137,6 +161,16 @@ void mks_draw_test_ui(void) {
                                         event_handler_test);
 
     test_page.label_back = label_for_btn_name(test_page.btn_back, test_page.label_back, 0, 0, "Exit");
+
+    test_page.btn_step = mks_lv_btn_set(mks_global.mks_src, 
+                                        test_page.btn_step, 
+                                        100, 
+                                        100, 
+                                        370, 
+                                        120, 
+                                        event_handler_step);
+
+    test_page.label_step_btn = label_for_btn_name(test_page.btn_step, test_page.label_step_btn, 0, 0, "Step");
     mks_ui_page.mks_ui_page = MKS_UI_TEST;
 }
 
@@ -215,6 +249,23 @@ void draw_testing(void) {
         lv_label_set_text(test_page.label_mcu_temp, dis_str);
     }
 
+    if(mks_step_test_status != MKS_STEP_TEST_IDLE) {
+        memset(dis_str, 0, sizeof(dis_str));
+        strcpy(dis_str, test_step_str);
+        switch(mks_step_test_status) {
+            case MKS_STEP_TEST_PASS:        strcat(dis_str, test_OK); break;
+            case MKS_STEP_TEST_FAIL:        strcat(dis_str, test_ERR); break;
+            case MKS_STEP_TEST_NO_SIGNAL:   strcat(dis_str, test_NO_SIGNAL); break;
+            default:                        strcat(dis_str, test_RUNNING); break;
+        }
+        lv_label_set_text(test_page.label_step, dis_str);
+    }
+
+    // The step timing check runs its own moves
+    if(mks_step_test_busy()) {
+        return;
+    }
+
     // test_count++;
     // if(test_count == 10 && stepper_idle) {
      if(stepper_idle) {
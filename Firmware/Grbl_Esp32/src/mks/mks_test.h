@@ -28,6 +28,9 @@ typedef struct {
     lv_obj_t *label_mcu_temp;
     lv_obj_t *label_version;
     lv_obj_t *label_i2c;
+    lv_obj_t *label_step;
+    lv_obj_t *btn_step;
+    lv_obj_t *label_step_btn;
 }MKS_PAGE_TEST_T;
 
 typedef struct {
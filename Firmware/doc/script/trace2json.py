@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""\
+
+Convert a $Trace/Dump capture to Chrome trace JSON
+
+Firmware built with USE_TRACE records motion pipeline events in a ring.
+$Trace/Dump sends them as [TRACE:] lines. Save the terminal output to a
+file, then run
+
+    python3 trace2json.py capture.txt trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev.
+Lines that are not [TRACE:] lines are skipped, so the capture can hold
+other output too. Each core is shown as its own thread. The two cores'
+cycle counters are not synchronized exactly, so compare events across
+cores with a few microseconds of slack.
+"""
+
+import argparse
+import base64
+import json
+import re
+import struct
+import sys
+
+EVENTS = ["PlanBufferLine", "PrepBuffer", "SegmentLoad", "SdLine", "GCodeLine", "ClientRx"]
+
+TRACE_BEGIN = 1
+TRACE_END = 2
+TRACE_CORE1 = 0x80
+
+RECORD = struct.Struct("<IBBH")  # trace_record_t in Trace.h
+
+HEADER_RE = re.compile(r"\[TRACE:V(\d+),(\d+),(\d+),(\d+)\]")
+DATA_RE = re.compile(r"\[TRACE:([A-Za-z0-9+/=]+)\]")
+
+
+def read_dump(f):
+    mhz = None
+    data = b""
+    for line in f:
+        m = HEADER_RE.search(line)
+        if m:
+            if int(m.group(1)) != 1:
+                sys.exit("Unsupported trace version %s" % m.group(1))
+            # A later dump replaces an earlier one in the same capture
+            mhz = int(m.group(2))
+            data = b""
+            dropped = int(m.group(4))
+            if dropped:
+                print("%d older events were overwritten in the ring" % dropped, file=sys.stderr)
+            continue
+        m = DATA_RE.search(line)
+        if m and mhz is not None:
+            data += base64.b64decode(m.group(1))
+    if mhz is None:
+        sys.exit("No [TRACE:] header found")
+    return mhz, data
+
+
+def convert(mhz, data):
+    events = []
+    last = [None, None]  # Per core, to unwrap the 32-bit cycle counts
+    high = [0, 0]
+    for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        ccount, event, flags, arg = RECORD.unpack_from(data, offset)
+        core = 1 if flags & TRACE_CORE1 else 0
+        if last[core] is not None and ccount < last[core]:
+            high[core] += 1 << 32
+        last[core] = ccount
+        phase = flags & 0x7F
+        name = EVENTS[event] if event < len(EVENTS) else "Event%d" % event
+        e = {
+            "name": name,
+            "ph": "B" if phase == TRACE_BEGIN else "E" if phase == TRACE_END else "i",
+            "ts": (high[core] + ccount) / mhz,
+            "pid": 0,
+            "tid": core,
+        }
+        if e["ph"] == "i":
+            e["s"] = "t"
+            e["args"] = {"arg": arg}
+        events.append(e)
+    # Start the timeline at the first event
+    if events:
+        start = min(e["ts"] for e in events)
+        for e in events:
+            e["ts"] -= start
+    events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": 0, "args": {"name": "Core 0"}})
+    events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": 1, "args": {"name": "Core 1"}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a $Trace/Dump capture to Chrome trace JSON.")
+    parser.add_argument("capture", type=argparse.FileType("r"), help="terminal output holding the dump")
+    parser.add_argument("output", type=argparse.FileType("w"), help="Chrome trace JSON file to write")
+    args = parser.parse_args()
+    mhz, data = read_dump(args.capture)
+    json.dump(convert(mhz, data), args.output)
+
+
+if __name__ == "__main__":
+    main()
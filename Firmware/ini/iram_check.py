@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""\
+
+Check that the interrupt handlers only call code in IRAM
+
+While the SPI flash is written, as when settings are saved, the flash
+cache is off and an interrupt handler that reaches code in flash crashes
+the CPU; the rest of the time it stalls on cache misses, which shows up
+as step jitter. This walks the calls
+from the handlers in ROOTS through the disassembly of the linked
+firmware and reports every function reached that is not in IRAM, then
+the IRAM use and the largest IRAM functions no handler reaches.
+
+Calls through pointers and virtual methods cannot be followed, so their
+targets are listed in ROOTS too. Long calls (l32r + callx) are resolved
+from the literal they load.
+
+Run by PlatformIO after linking (extra_scripts = post:ini/iram_check.py).
+With custom_iram_check = strict in the environment, a handler reaching
+flash fails the build; with off it is skipped. It also runs on its own:
+
+    python3 iram_check.py .pio/build/<env>/firmware.elf
+"""
+
+import argparse
+import re
+import struct
+import subprocess
+import sys
+
+# Interrupt handlers, and the targets of the pointers and virtual calls they make
+ROOTS = [
+    "onStepperDriverTimer",
+    "onStepperOffTimer",
+    "i2s_out_intr_handler",
+    "isr_limit_switches",
+    "isr_control_inputs",
+    "isr_probe",
+    "touch_irq",
+    "lcd_dma_done",
+    "i2c_ready_isr",
+    "task_stats_tick",
+    # stepper_pulse_path and stepper_i2s_fill_path, one per axis count
+    "stepper_pulse<",
+    "stepper_i2s_fill<",
+    # Motor methods called from motors_step() and the others
+    "Motors::StandardStepper::step",
+    "Motors::StandardStepper::unstep",
+    "Motors::StandardStepper::set_direction",
+    "Motors::UnipolarMotor::step",
+    "Motors::UnipolarMotor::set_direction",
+    # Spindle methods called at segment loads and raster pixels
+    "Spindles::PWM::set_rpm_isr",
+    "Spindles::Laser::set_rpm_ramp",
+]
+
+IRAM = (0x40080000, 0x400A0000)
+ROM = (0x40000000, 0x40070000)
+FLASH = (0x400C2000, 0x40C00000)
+
+FUNC_RE = re.compile(r"^([0-9a-f]{8}) <(.+)>:$")
+CALL_RE = re.compile(r"\tcall(?:0|4|8|12)\s+([0-9a-f]+)\b")
+L32R_RE = re.compile(r"\tl32r\s+(a\d+), ([0-9a-f]+)\b")
+CALLX_RE = re.compile(r"\tcallx(?:0|4|8|12)\s+(a\d+)")
+
+
+def in_range(addr, r):
+    return r[0] <= addr < r[1]
+
+
+class Elf:
+    """Just enough of ELF32 to read the literal pool words"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, stype, _, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            if addr and stype != 8:  # NOBITS sections have no data
+                self.sections.append((addr, offset, size))
+
+    def word(self, addr):
+        for base, offset, size in self.sections:
+            if base <= addr < base + size - 3:
+                return struct.unpack_from("<I", self.data, offset + addr - base)[0]
+        return None
+
+
+def short_name(name):
+    """enclosing::function<args> without the return type and parameters"""
+    depth = 0
+    start = 0
+    for i, c in enumerate(name):
+        if c == "<":
+            depth += 1
+        elif c == ">":
+            depth -= 1
+        elif c == " " and depth == 0:
+            start = i + 1
+        elif c == "(" and depth == 0:
+            return name[start:i]
+    return name[start:]
+
+
+def disassemble(objdump, elf_path, elf):
+    """Functions by address: (name, set of called addresses)"""
+    out = subprocess.run([objdump, "-d", "-C", elf_path], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    funcs = {}
+    calls = None
+    loaded = {}
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            calls = set()
+            loaded = {}
+            funcs[int(m.group(1), 16)] = (m.group(2), calls)
+            continue
+        if calls is None:
+            continue
+        m = CALL_RE.search(line)
+        if m:
+            calls.add(int(m.group(1), 16))
+            continue
+        m = L32R_RE.search(line)
+        if m:
+            loaded[m.group(1)] = elf.word(int(m.group(2), 16))
+            continue
+        m = CALLX_RE.search(line)
+        if m and loaded.get(m.group(1)) is not None:
+            calls.add(loaded[m.group(1)])
+    return funcs
+
+
+def section_sizes(objdump, elf_path):
+    out = subprocess.run([objdump, "-h", elf_path], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    sizes = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) >= 4 and fields[1].startswith("."):
+            sizes[fields[1]] = int(fields[2], 16)
+    return sizes
+
+
+def check(elf_path, objdump="xtensa-esp32-elf-objdump", top=20):
+    """Prints the report, returns the number of flash functions the handlers reach"""
+    elf = Elf(elf_path)
+    funcs = disassemble(objdump, elf_path, elf)
+    by_name = {}
+    for addr, (name, _) in funcs.items():
+        by_name.setdefault(short_name(name), []).append(addr)
+
+    roots = []
+    for root in ROOTS:
+        found = [a for n, addrs in by_name.items() if n == root or (root.endswith("<") and n.startswith(root)) for a in addrs]
+        if not found:
+            print("IRAM check: %s not in the image" % root)
+        roots += found
+
+    # Breadth first, keeping one caller of each function for the report
+    caller = {a: None for a in roots}
+    queue = list(roots)
+    while queue:
+        addr = queue.pop(0)
+        if not in_range(addr, IRAM) or addr not in funcs:
+            continue  # Flash is reported, ROM is always there
+        for callee in funcs[addr][1]:
+            if callee not in caller:
+                caller[callee] = addr
+                queue.append(callee)
+
+    flash = sorted(a for a in caller if in_range(a, FLASH))
+    for addr in flash:
+        chain = []
+        a = addr
+        while a is not None:
+            chain.append(short_name(funcs[a][0]) if a in funcs else "%08x" % a)
+            a = caller[a]
+        print("IRAM check: in flash: %s" % " <- ".join(chain))
+
+    sizes = section_sizes(objdump, elf_path)
+    used = sum(size for name, size in sizes.items() if name.startswith(".iram0"))
+    print("IRAM check: %d of %d bytes of IRAM used, %d handler callees in flash" % (used, IRAM[1] - IRAM[0], len(flash)))
+
+    # What IRAM holds that no handler reaches, the candidates to move out
+    addrs = sorted(funcs)
+    unused = []
+    for i, addr in enumerate(addrs):
+        if in_range(addr, IRAM) and addr not in caller and i + 1 < len(addrs):
+            unused.append((min(addrs[i + 1], IRAM[1]) - addr, short_name(funcs[addr][0])))
+    for size, name in sorted(unused, reverse=True)[:top]:
+        print("IRAM check: not reached: %6d %s" % (size, name))
+    return len(flash)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Check that the interrupt handlers only call code in IRAM.")
+    parser.add_argument("elf", help="linked firmware, firmware.elf")
+    parser.add_argument("--objdump", default="xtensa-esp32-elf-objdump")
+    parser.add_argument("--strict", action="store_true", help="exit with an error if a handler reaches flash")
+    args = parser.parse_args()
+    if check(args.elf, args.objdump) and args.strict:
+        sys.exit(1)
+
+
+def platformio_check(source, target, env):
+    mode = env.GetProjectOption("custom_iram_check", "report")
+    if mode == "off":
+        return
+    objdump = env.subst("$OBJCOPY").replace("objcopy", "objdump")
+    if check(env.subst("$BUILD_DIR/${PROGNAME}.elf"), objdump) and mode == "strict":
+        env.Exit(1)
+
+
+if __name__ == "__main__":
+    main()
+else:
+    Import("env")  # noqa: F821, provided by PlatformIO
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", platformio_check)  # noqa: F821
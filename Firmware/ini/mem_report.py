@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""\
+
+Report the static DRAM of the firmware by subsystem
+
+Every global buffer sits in .dram0.data or .dram0.bss for good, whether
+it is in use or not, and whatever they take is lost to the heap that
+the planner, the segment buffer and the SD read-ahead are allocated
+from at boot. This reads the linker map and sums the input sections of
+those two output sections by the object file they came from, grouped
+into subsystems, then lists the largest objects.
+
+Run by PlatformIO after linking (extra_scripts = post:ini/mem_report.py),
+which also asks the linker for the map. The report is printed and
+written next to the map as mem_report.txt. $Mem on the running firmware
+gives the totals. It also runs on its own:
+
+    python3 mem_report.py .pio/build/<env>/firmware.map
+"""
+
+import argparse
+import os
+import re
+import sys
+
+SECTIONS = (".dram0.data", ".dram0.bss")
+
+# First match wins, on the object path with / separators
+GROUPS = [
+    ("MKS UI", "/src/mks/"),
+    ("WebUI", "/src/WebUI/"),
+    ("Motors", "/src/Motors/"),
+    ("Spindles", "/src/Spindles/"),
+    ("Grbl", "/src/"),
+    ("LVGL", "lvgl"),
+    ("Arduino libraries", "framework-arduinoespressif32/libraries/"),
+    ("Libraries", "/libdeps/"),
+    ("Arduino core and ESP-IDF", ""),
+]
+
+INPUT_RE = re.compile(r"^ (\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+NAME_RE = re.compile(r"^ (\S+)$")
+
+
+def parse(map_path):
+    """Bytes by (output section, object file)"""
+    sizes = {}
+    section = None
+    pending = None  # An input section name on a line of its own, its address and size follow
+    with open(map_path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("."):
+                name = line.split()[0]
+                section = name if name in SECTIONS else None
+                pending = None
+                continue
+            if section is None:
+                continue
+            m = NAME_RE.match(line)
+            if m:
+                pending = m.group(1)
+                continue
+            m = INPUT_RE.match(line)
+            name = m and (m.group(1) or pending)
+            pending = None
+            if not name or name.startswith("*"):
+                continue  # Fill and the linker script patterns
+            size = int(m.group(3), 16)
+            if size:
+                key = (section, m.group(4).strip())
+                sizes[key] = sizes.get(key, 0) + size
+    return sizes
+
+
+def group_of(obj):
+    path = obj.replace("\\", "/")
+    for name, pattern in GROUPS:
+        if pattern in path:
+            return name
+    return GROUPS[-1][0]
+
+
+def short_obj(obj):
+    path = obj.replace("\\", "/")
+    m = re.match(r"(.*/)?([^/(]+\.a)\(([^)]+)\)$", path)
+    if m:
+        return "%s(%s)" % (m.group(2), m.group(3))
+    if "/src/" in path:
+        return path[path.rindex("/src/") + 5:]
+    return os.path.basename(path)
+
+
+def report(map_path, top=20):
+    sizes = parse(map_path)
+    groups = {}
+    objects = {}
+    for (section, obj), size in sizes.items():
+        g = groups.setdefault(group_of(obj), [0, 0])
+        o = objects.setdefault(obj, [0, 0])
+        i = SECTIONS.index(section)
+        g[i] += size
+        o[i] += size
+
+    lines = ["%-28s %8s %8s %8s" % ("Static DRAM", "data", "bss", "total")]
+    for name, (data, bss) in sorted(groups.items(), key=lambda kv: -sum(kv[1])):
+        lines.append("%-28s %8d %8d %8d" % (name, data, bss, data + bss))
+    data = sum(g[0] for g in groups.values())
+    bss = sum(g[1] for g in groups.values())
+    lines.append("%-28s %8d %8d %8d" % ("All", data, bss, data + bss))
+    lines.append("")
+    lines.append("Largest objects")
+    for obj, (d, b) in sorted(objects.items(), key=lambda kv: -sum(kv[1]))[:top]:
+        lines.append("%-44s %8d %8d %8d" % (short_obj(obj)[:44], d, b, d + b))
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report the static DRAM of the firmware by subsystem.")
+    parser.add_argument("map", help="linker map, firmware.map")
+    parser.add_argument("--top", type=int, default=20, help="objects to list")
+    args = parser.parse_args()
+    sys.stdout.write(report(args.map, args.top))
+
+
+def platformio_report(source, target, env):
+    map_path = env.subst("$BUILD_DIR/${PROGNAME}.map")
+    if not os.path.isfile(map_path):
+        return
+    text = report(map_path)
+    with open(os.path.join(os.path.dirname(map_path), "mem_report.txt"), "w") as f:
+        f.write(text)
+    print(text.split("\n\n")[0])
+
+
+if __name__ == "__main__":
+    main()
+else:
+    Import("env")  # noqa: F821, provided by PlatformIO
+    env.Append(LINKFLAGS=["-Wl,-Map," + env.subst("$BUILD_DIR/${PROGNAME}.map")])  # noqa: F821
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", platformio_report)  # noqa: F821
@@ -201,6 +201,63 @@ uint8_t TFT_eSPI::getTouch(uint16_t *x, uint16_t *y, uint16_t threshold){
   return valid;
 }
 
+/***************************************************************************************
+** Function name:           getTouchFiltered    // mks
+** Description:             read callibrated position in one transaction. Return false if
+**                          not pressed.
+***************************************************************************************/
+#define _TOUCH_SAMPLES 5 // Conversions per axis, the median is used
+uint8_t TFT_eSPI::getTouchFiltered(uint16_t *x, uint16_t *y, uint16_t threshold){
+  // Each command byte is followed by its 12 bit result in the next two bytes, the second of
+  // which carries the next command. Z1, Z2, then one settling and _TOUCH_SAMPLES conversions
+  // per axis; 29 bytes, which go through the SPI FIFO in one go.
+  const uint8_t n_cmd = 2 + 2 * (_TOUCH_SAMPLES + 1);
+  uint8_t  buf[2 * n_cmd + 1];
+  uint16_t xs[_TOUCH_SAMPLES], ys[_TOUCH_SAMPLES];
+
+  memset(buf, 0, sizeof(buf));
+  buf[0] = 0xb0;
+  buf[2] = 0xc0;
+  for (uint8_t i = 0; i <= _TOUCH_SAMPLES; i++) {
+    buf[4 + 2 * i]                         = 0x90;
+    buf[4 + 2 * (_TOUCH_SAMPLES + 1 + i)]  = 0xd0;
+  }
+
+  begin_touch_read_write();
+  spi.transfer(buf, sizeof(buf));
+  end_touch_read_write();
+
+  #define _TOUCH_RESULT(i) ((((uint16_t)buf[2 * (i) + 1] << 8) | buf[2 * (i) + 2]) >> 3)
+  if (threshold<20) threshold = 20;
+  if (_pressTime > millis()) threshold=20;
+  int16_t z = 0xFFF + _TOUCH_RESULT(0) - _TOUCH_RESULT(1);
+  if (z <= (int16_t)threshold) { _pressTime = 0; return false; }
+
+  for (uint8_t i = 0; i < _TOUCH_SAMPLES; i++) {
+    xs[i] = _TOUCH_RESULT(3 + i);
+    ys[i] = _TOUCH_RESULT(3 + _TOUCH_SAMPLES + 1 + i);
+  }
+  #undef _TOUCH_RESULT
+  // Insertion sort, there are only a few
+  for (uint8_t i = 1; i < _TOUCH_SAMPLES; i++) {
+    for (uint8_t j = i; j > 0 && xs[j - 1] > xs[j]; j--) { uint16_t t = xs[j]; xs[j] = xs[j - 1]; xs[j - 1] = t; }
+    for (uint8_t j = i; j > 0 && ys[j - 1] > ys[j]; j--) { uint16_t t = ys[j]; ys[j] = ys[j - 1]; ys[j - 1] = t; }
+  }
+  uint16_t x_tmp = xs[_TOUCH_SAMPLES / 2], y_tmp = ys[_TOUCH_SAMPLES / 2];
+
+  _pressTime = millis() + 50;
+
+  convertRawXY(&x_tmp, &y_tmp);
+
+  if (x_tmp >= _width || y_tmp >= _height) return false;
+
+  _pressX = x_tmp;
+  _pressY = y_tmp;
+  *x = _pressX;
+  *y = _pressY;
+  return true;
+}
+
 /***************************************************************************************
 ** Function name:           convertRawXY
 ** Description:             convert raw touch x,y values to screen coordinates 
@@ -13,6 +13,9 @@
            // The returned value can be treated as a bool type, false or 0 means touch not detected
            // In future the function may return an 8 "quality" (jitter) value.
   uint8_t  getTouch(uint16_t *x, uint16_t *y, uint16_t threshold = 600);
+           // As getTouch, but from one short bus transaction with no delays: the pressure and
+           // the median of several conversions per axis  // mks
+  uint8_t  getTouchFiltered(uint16_t *x, uint16_t *y, uint16_t threshold = 600);
 
            // Run screen calibration and test, report calibration values to the serial port
   void     calibrateTouch(uint16_t *data, uint32_t color_fg, uint32_t color_bg, uint8_t size);
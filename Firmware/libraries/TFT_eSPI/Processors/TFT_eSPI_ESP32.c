@@ -718,6 +718,22 @@ void IRAM_ATTR dc_callback(spi_transaction_t *spi_tx)
   else {DC_C;}
 }
 
+/***************************************************************************************
+** Function name:           dma_done_callback    // mks
+** Description:             Reports the end of a pixel transfer, from the SPI interrupt
+***************************************************************************************/
+static void (*dmaDone)(void) = nullptr;
+
+static void IRAM_ATTR dma_done_callback(spi_transaction_t *spi_tx)
+{
+  if (dmaDone && (bool)spi_tx->user) dmaDone();
+}
+
+void TFT_eSPI::setDMADoneCallback(void (*done)(void))
+{
+  dmaDone = done;
+}
+
 /***************************************************************************************
 ** Function name:           initDMA
 ** Description:             Initialise the DMA engine - returns true if init OK
@@ -755,7 +771,7 @@ bool TFT_eSPI::initDMA(bool ctrl_cs)
     .flags = SPI_DEVICE_NO_DUMMY, //0,
     .queue_size = 1,
     .pre_cb = 0, //dc_callback, //Callback to handle D/C line
-    .post_cb = 0
+    .post_cb = dma_done_callback  // mks
   };
   ret = spi_bus_initialize(spi_host, &buscfg, 1);
   ESP_ERROR_CHECK(ret);
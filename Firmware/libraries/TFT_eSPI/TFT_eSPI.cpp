@@ -3477,11 +3477,12 @@ void TFT_eSPI::pushColors(uint8_t *data, uint32_t len)
 void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
 {
   begin_tft_write();
-  if (swap) {swap = _swapBytes; _swapBytes = true; }
+  bool oldSwap = _swapBytes;
+  _swapBytes = swap; // mks: false sends the data as it is, whatever setSwapBytes() said
 
   pushPixels(data, len);
 
-  _swapBytes = swap; // Restore old value
+  _swapBytes = oldSwap; // Restore old value
   end_tft_write();
 }
 
@@ -3489,11 +3490,12 @@ void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
 void TFT_eSPI::pushColorsDMA(uint16_t *data, uint32_t len, bool swap) {
 
     begin_tft_write();
-    if (swap) {swap = _swapBytes; _swapBytes = true; }
+    bool oldSwap = _swapBytes;
+    _swapBytes = swap;
 
     pushPixelsDMA(data, len);
     
-    _swapBytes = swap; // Restore old value
+    _swapBytes = oldSwap; // Restore old value
     end_tft_write();
 }
 
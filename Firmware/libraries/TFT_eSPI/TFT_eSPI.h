@@ -659,6 +659,9 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
   bool     dmaBusy(void); // returns true if DMA is still in progress
   void     dmaWait(void); // wait until DMA is complete
 
+           // Called from the SPI interrupt as each pixel DMA transfer completes (ESP32 only)  // mks
+  void     setDMADoneCallback(void (*done)(void));
+
   bool     DMA_Enabled = false;   // Flag for DMA enabled state
   uint8_t  spiBusyCheck = 0;      // Number of ESP32 transfer buffers to check
 
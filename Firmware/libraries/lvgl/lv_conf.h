@@ -33,7 +33,9 @@
 
 /* Swap the 2 bytes of RGB565 color.
  * Useful if the display has a 8 bit interface (e.g. SPI)*/
-#define LV_COLOR_16_SWAP   0
+/* mks: on, so images come from the panel byte order copy in the lv_pic arrays and
+ * my_disp_flush() sends the buffer as it is, without swapping every pixel */
+#define LV_COLOR_16_SWAP   1
 
 /* 1: Enable screen transparency.
  * Useful for OSD or other overlapping GUIs.